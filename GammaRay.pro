@@ -77,6 +77,8 @@ SOURCES += main.cpp\
     domain/file.cpp \
     gs/ghostscript.cpp \
     gslib/gslib.cpp \
+    gslib/gslibjobscheduler.cpp \
+    gslib/gslibjobsdialog.cpp \
     gslib/gslibparams/gslibpartype.cpp \
     gslib/gslibparams/gslibparinputdata.cpp \
     gslib/gslibparams/gslibparvarweight.cpp \
@@ -124,6 +126,7 @@ SOURCES += main.cpp\
     viewer3d/view3dconfigwidgets/v3dcfgwidforattributeinpointset.cpp \
     viewer3d/view3dtextconfigwidget.cpp \
     widgets/linechartwidget.cpp \
+    widgets/nativeplotwidget.cpp \
     widgets/listbuilder.cpp \
     widgets/qlistwidgetdnd.cpp \
     widgets/transiogrambandchartview.cpp \
@@ -173,6 +176,7 @@ SOURCES += main.cpp\
     dialogs/distributionmodelingdialog.cpp \
     dialogs/distributioncolumnrolesdialog.cpp \
     dialogs/displayplotdialog.cpp \
+    dialogs/nativeplotdialog.cpp \
     dialogs/declusteringdialog.cpp \
     dialogs/datafiledialog.cpp \
     dialogs/creategriddialog.cpp \
@@ -208,11 +212,13 @@ SOURCES += main.cpp\
     dialogs/multivariogramdialog.cpp \
     imagejockey/imagejockeydialog.cpp \
     imagejockey/imagejockeygridplot.cpp \
+    imagejockey/ijrastertilecache.cpp \
     imagejockey/spectrogram1dparameters.cpp \
     imagejockey/spectrogram1dplot.cpp \
     imagejockey/spectrogram1dplotpicker.cpp \
     imagejockey/equalizer/equalizerwidget.cpp \
     imagejockey/equalizer/equalizerslider.cpp \
+    imagejockey/equalizer/spectralequalizer.cpp \
     dialogs/sgsimdialog.cpp \
     widgets/distributionfieldselector.cpp \
     viewer3d/view3dverticalexaggerationwidget.cpp \
@@ -220,6 +226,7 @@ SOURCES += main.cpp\
     spectral/svd.cpp \
     spectral/pca.cpp \
     spectral/spectral.cpp \
+    spectral/filters.cpp \
     algorithms/ialgorithmdatasource.cpp \
     algorithms/bootstrap.cpp \
     dialogs/machinelearningdialog.cpp \
@@ -243,6 +250,7 @@ SOURCES += main.cpp\
     imagejockey/ijabstractcartesiangrid.cpp \
     imagejockey/ijabstractvariable.cpp \
     imagejockey/imagejockeyutils.cpp \
+    imagejockey/scattereddatainterpolator.cpp \
     imagejockey/ijexperimentalvariogramparameters.cpp \
     imagejockey/ijmatrix3x3.cpp \
 	imagejockey/ijspatiallocation.cpp \
@@ -254,6 +262,7 @@ SOURCES += main.cpp\
     calculator/calclinenumberarea.cpp \
 	calculator/calccodeeditor.cpp \
 	imagejockey/vardecomp/variographicdecompositiondialog.cpp \
+	imagejockey/vardecomp/variographicoptimizer.cpp \
 	imagejockey/widgets/ijquick3dviewer.cpp \
 	dialogs/factorialkrigingdialog.cpp \
     geostats/fkestimation.cpp \
@@ -281,6 +290,7 @@ SOURCES += main.cpp\
     imagejockey/gabor/gaborfrequencyazimuthselections.cpp \
     imagejockey/wavelet/wavelettransformdialog.cpp \
     imagejockey/wavelet/waveletutils.cpp \
+    imagejockey/wavelet/liftingwavelettransform.cpp \
     imagejockey/ijvariographicmodel2d.cpp \
     dialogs/automaticvarfitdialog.cpp \
     dialogs/emptydialog.cpp \
@@ -310,8 +320,16 @@ SOURCES += main.cpp\
     dialogs/mcrfsimdialog.cpp \
     dialogs/lvadatasetdialog.cpp \
     geostats/mcrfsim.cpp \
+    geostats/postsimulationengine.cpp \
+    geostats/realizationstore.cpp \
+    geostats/celldeclustering.cpp \
+    geostats/normalscoretransform.cpp \
+    geostats/multivariatevariogramengine.cpp \
+    geostats/ensemblevariogramchecker.cpp \
+    domain/datamemorymanager.cpp \
     gslib/gslibparameterfiles/commonsimulationparameters.cpp \
     spatialindex/spatialindex.cpp \
+    spatialindex/geogridcelllocator.cpp \
     geostats/taumodel.cpp \
     dialogs/mcmcdataimputationdialog.cpp \
     imagejockey/paraviewscalarbar/vtkBoundingRectContextDevice2D.cpp \
@@ -363,6 +381,8 @@ HEADERS  += mainwindow.h \
     domain/file.h \
     gs/ghostscript.h \
     gslib/gslib.h \
+    gslib/gslibjobscheduler.h \
+    gslib/gslibjobsdialog.h \
     gslib/gslibparams/gslibpartype.h \
     gslib/gslibparams/gslibparinputdata.h \
     gslib/gslibparams/gslibparvarweight.h \
@@ -414,6 +434,7 @@ HEADERS  += mainwindow.h \
     viewer3d/view3dconfigwidgets/v3dcfgwidforattributeinpointset.h \
     viewer3d/view3dtextconfigwidget.h \
     widgets/linechartwidget.h \
+    widgets/nativeplotwidget.h \
     widgets/listbuilder.h \
     widgets/qlistwidgetdnd.h \
     widgets/transiogrambandchartview.h \
@@ -456,6 +477,7 @@ HEADERS  += mainwindow.h \
     dialogs/datafiledialog.h \
     dialogs/declusteringdialog.h \
     dialogs/displayplotdialog.h \
+    dialogs/nativeplotdialog.h \
     dialogs/distributioncolumnrolesdialog.h \
     dialogs/distributionmodelingdialog.h \
     dialogs/filecontentsdialog.h \
@@ -498,11 +520,13 @@ HEADERS  += mainwindow.h \
     dialogs/multivariogramdialog.h \
     imagejockey/imagejockeydialog.h \
     imagejockey/imagejockeygridplot.h \
+    imagejockey/ijrastertilecache.h \
     imagejockey/spectrogram1dparameters.h \
     imagejockey/spectrogram1dplot.h \
     imagejockey/spectrogram1dplotpicker.h \
     imagejockey/equalizer/equalizerwidget.h \
     imagejockey/equalizer/equalizerslider.h \
+    imagejockey/equalizer/spectralequalizer.h \
     dialogs/sgsimdialog.h \
     widgets/distributionfieldselector.h \
     viewer3d/view3dverticalexaggerationwidget.h \
@@ -510,6 +534,7 @@ HEADERS  += mainwindow.h \
     spectral/svd.h \
     spectral/pca.h \
     spectral/spectral.h \
+    spectral/filters.h \
     algorithms/ialgorithmdatasource.h \
     algorithms/bootstrap.h \
     dialogs/machinelearningdialog.h \
@@ -533,6 +558,7 @@ HEADERS  += mainwindow.h \
     imagejockey/ijabstractcartesiangrid.h \
     imagejockey/ijabstractvariable.h \
     imagejockey/imagejockeyutils.h \
+    imagejockey/scattereddatainterpolator.h \
     imagejockey/ijexperimentalvariogramparameters.h \
     imagejockey/ijmatrix3x3.h \
 	imagejockey/ijspatiallocation.h \
@@ -547,6 +573,7 @@ HEADERS  += mainwindow.h \
     calculator/calclinenumberarea.h \
 	calculator/calccodeeditor.h \
 	imagejockey/vardecomp/variographicdecompositiondialog.h \
+	imagejockey/vardecomp/variographicoptimizer.h \
 	imagejockey/widgets/ijquick3dviewer.h \
 	dialogs/factorialkrigingdialog.h \
     geostats/fkestimation.h \
@@ -574,6 +601,7 @@ HEADERS  += mainwindow.h \
     imagejockey/gabor/gaborfrequencyazimuthselections.h \
     imagejockey/wavelet/wavelettransformdialog.h \
     imagejockey/wavelet/waveletutils.h \
+    imagejockey/wavelet/liftingwavelettransform.h \
     imagejockey/ijvariographicmodel2d.h \
     dialogs/automaticvarfitdialog.h \
     dialogs/emptydialog.h \
@@ -603,8 +631,16 @@ HEADERS  += mainwindow.h \
     dialogs/mcrfsimdialog.h \
     dialogs/lvadatasetdialog.h \
     geostats/mcrfsim.h \
+    geostats/postsimulationengine.h \
+    geostats/realizationstore.h \
+    geostats/celldeclustering.h \
+    geostats/normalscoretransform.h \
+    geostats/multivariatevariogramengine.h \
+    geostats/ensemblevariogramchecker.h \
+    domain/datamemorymanager.h \
     gslib/gslibparameterfiles/commonsimulationparameters.h \
     spatialindex/spatialindex.h \
+    spatialindex/geogridcelllocator.h \
     geostats/taumodel.h \
     dialogs/mcmcdataimputationdialog.h \
     imagejockey/paraviewscalarbar/vtkBoundingRectContextDevice2D.h \
@@ -629,6 +665,7 @@ FORMS    += mainwindow.ui \
     gslib/gslibparams/widgets/widgetgslibparfile.ui \
     gslib/gslibparams/widgets/widgetgslibparinputdata.ui \
     gslib/gslibparametersdialog.ui \
+    gslib/gslibjobsdialog.ui \
     gslib/gslibparams/widgets/widgetgslibparmultivaluedvariable.ui \
     gslib/gslibparams/widgets/widgetgslibparint.ui \
     gslib/gslibparams/widgets/widgetgslibparlimitsdouble.ui \
@@ -667,6 +704,7 @@ FORMS    += mainwindow.ui \
     dialogs/datafiledialog.ui \
     dialogs/declusteringdialog.ui \
     dialogs/displayplotdialog.ui \
+    dialogs/nativeplotdialog.ui \
     dialogs/distributioncolumnrolesdialog.ui \
     dialogs/distributionmodelingdialog.ui \
     dialogs/filecontentsdialog.ui \
@@ -7,6 +7,7 @@
 #include "domain/attribute.h"
 #include "domain/project.h"
 #include "gslib/gslib.h"
+#include "geostats/celldeclustering.h"
 #include "gslib/gslibparameterfiles/gslibparamtypes.h"
 #include <cmath>
 #include <QMessageBox>
@@ -112,12 +113,16 @@ void DeclusteringDialog::onDeclus()
     GSLibParametersDialog gslibpardiag ( m_gpf_declus );
     int result = gslibpardiag.exec();
     if( result == QDialog::Accepted ){
-        //Generate the parameter file
-        QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
-        m_gpf_declus->save( par_file_path );
-        //run declus program
-        Application::instance()->logInfo("Starting declus program...");
-        GSLib::instance()->runProgram( "declus", par_file_path );
+        PointSet* input_data_file = (PointSet*)m_attribute->getContainingFile();
+        uint var_index = input_data_file->getFieldGEOEASIndex( m_attribute->getName() );
+        //compute the declustering weights in-process with the declus settings
+        CellDeclustering declus( input_data_file, var_index - 1 );
+        declus.setFromParameters( m_gpf_declus );
+        if( ! declus.run() )
+            return;
+        //write the summary and the data with weights as declus would, so the other actions work on them.
+        declus.writeSummary( m_gpf_declus->getParameter<GSLibParFile*>(3)->_path );
+        declus.writeDataWithWeights( m_gpf_declus->getParameter<GSLibParFile*>(4)->_path );
     } else {
         delete m_gpf_declus;
         m_gpf_declus = nullptr;
@@ -233,7 +233,7 @@ void DriftAnalysisDialog::onRunFitTrendModel()
     //fit a trend model to the data
     Quadratic3DTrendModelFitting q3dtmf( m_dataFile, m_attribute );
     Quad3DTrendModelFittingAuxDefs::Parameters modelParameters =
-            q3dtmf.processWithNonLinearLeastSquares();
+            q3dtmf.processWithLinearLeastSquares();
 
     //update the trend model disaply in this dialog
     displayParamaters( modelParameters );
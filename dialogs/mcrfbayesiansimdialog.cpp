@@ -23,6 +23,7 @@
 #include "gslib/gslibparametersdialog.h"
 #include "gslib/gslibparameterfiles/commonsimulationparameters.h"
 #include "geostats/mcrfsim.h"
+#include "dialogs/mcrfsimdialog.h"
 
 MCRFBayesianSimDialog::MCRFBayesianSimDialog(QWidget *parent) :
     QDialog(parent),
@@ -184,6 +185,7 @@ void MCRFBayesianSimDialog::onRun()
         QMessageBox::critical( this, "Error", QString("Simulation failed.  Check the messages panel for more details of the error."));
         Application::instance()->logError( "MCRFBayesianSimDialog::onRun(): Simulation ended with error: ");
         Application::instance()->logError( "    Last error:" + markovSim.getLastError() );
-    }
+    } else
+        MCRFSimDialog::offerPostsim( markovSim, this );
 }
 
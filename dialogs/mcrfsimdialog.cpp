@@ -4,6 +4,7 @@
 #include <QDragEnterEvent>
 #include <QMimeData>
 #include <QMessageBox>
+#include <QInputDialog>
 #include <thread> //for std::thread::hardware_concurrency()
 
 #include "domain/application.h"
@@ -19,6 +20,8 @@
 #include "widgets/variableselector.h"
 #include "widgets/cartesiangridselector.h"
 #include "gslib/gslibparametersdialog.h"
+#include "gslib/gslibparameterfiles/gslibparameterfile.h"
+#include "gslib/gslibparameterfiles/gslibparamtypes.h"
 #include "gslib/gslibparameterfiles/commonsimulationparameters.h"
 #include "geostats/mcrfsim.h"
 
@@ -172,6 +175,46 @@ void MCRFSimDialog::onRun()
         QMessageBox::critical( this, "Error", QString("Simulation failed.  Check the messages panel for more details of the error."));
         Application::instance()->logError( "MCRFSimDialog::onRun(): Simulation ended with error: ");
         Application::instance()->logError( "    Last error:" + markovSim.getLastError() );
+    } else
+        offerPostsim( markovSim, this );
+}
+
+void MCRFSimDialog::offerPostsim(const MCRFSim &markovSim, QWidget *parent)
+{
+    if( QMessageBox::question( parent, "Post-process realizations",
+                               "Post-process the realizations (e.g. probability of a facies)?" ) != QMessageBox::Yes )
+        return;
+
+    //only the number of realizations, the trimming limits and the output option are used in the post-processing
+    GSLibParameterFile gpf_postsim( "postsim" );
+    gpf_postsim.getParameter<GSLibParFile*>(0)->_path = markovSim.m_cgSim->getPath();
+    gpf_postsim.getParameter<GSLibParUInt*>(1)->_value = markovSim.m_commonSimulationParameters->getNumberOfRealizations();
+    GSLibParMultiValuedFixed* par3 = gpf_postsim.getParameter<GSLibParMultiValuedFixed*>(3);
+    par3->getParameter<GSLibParUInt*>(0)->_value = markovSim.m_cgSim->getNX();
+    par3->getParameter<GSLibParUInt*>(1)->_value = markovSim.m_cgSim->getNY();
+    par3->getParameter<GSLibParUInt*>(2)->_value = markovSim.m_cgSim->getNZ();
+    QString outputPath = Application::instance()->getProject()->generateUniqueTmpFilePath( "dat" );
+    gpf_postsim.getParameter<GSLibParFile*>(4)->_path = outputPath;
+
+    GSLibParametersDialog gsd( &gpf_postsim, parent );
+    if( gsd.exec() != QDialog::Accepted )
+        return;
+
+    if( ! markovSim.runPostsim( &gpf_postsim, outputPath ) ){
+        QMessageBox::critical( parent, "Error", "Post-processing failed.  Check the messages panel for more details of the error." );
+        return;
+    }
+
+    bool ok;
+    QString new_cg_name = QInputDialog::getText( parent, "Name the new grid file",
+                                                 "New grid file name:", QLineEdit::Normal,
+                                                 markovSim.m_cgSim->getName() + "_MCRF_postsim.grid", &ok );
+    if( ok && ! new_cg_name.isEmpty() ){
+        //the post-processed grid has the geometry of the simulation grid and -999 as no-data value, like postsim.
+        CartesianGrid postsim_cg( outputPath );
+        postsim_cg.setInfoFromOtherCGonlyGridSpecs( markovSim.m_cgSim );
+        postsim_cg.setNoDataValue( "-999.0" );
+        Application::instance()->getProject()->importCartesianGrid( &postsim_cg, new_cg_name );
     }
 }
 
@@ -12,6 +12,7 @@ class FileSelectorWidget;
 class VariableSelector;
 class CartesianGridSelector;
 class CommonSimulationParameters;
+class MCRFSim;
 
 /** The Markov Chains Random Field Simulation Dialog. */
 class MCRFSimDialog : public QDialog
@@ -22,6 +23,9 @@ public:
     explicit MCRFSimDialog(QWidget *parent = nullptr);
     ~MCRFSimDialog();
 
+    /** Offers the post-processing of the realizations of a completed simulation (e.g. facies probabilities)
+     * and imports the results into the project as a new grid.  Also used by the Bayesian MCRF dialog. */
+    static void offerPostsim( const MCRFSim& markovSim, QWidget* parent );
 
 private:
     Ui::MCRFSimDialog *ui;
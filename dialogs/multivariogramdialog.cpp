@@ -6,13 +6,18 @@
 #include "domain/file.h"
 #include "domain/cartesiangrid.h"
 #include "domain/project.h"
+#include "domain/experimentalvariogram.h"
+#include "geostats/multivariatevariogramengine.h"
 #include "util.h"
 #include "gslib/gslibparameterfiles/gslibparamtypes.h"
 #include "gslib/gslibparameterfiles/gslibparameterfile.h"
 #include "gslib/gslibparametersdialog.h"
 #include "gslib/gslib.h"
+#include "gslib/gslibjobscheduler.h"
 #include "dialogs/displayplotdialog.h"
 
+#include <QFile>
+
 MultiVariogramDialog::MultiVariogramDialog(const std::vector<Attribute *> attributes,
                                            QWidget *parent) :
     QDialog(parent),
@@ -106,6 +111,19 @@ void MultiVariogramDialog::onGam()
     if( result == QDialog::Accepted ){
         std::vector<QString> expVarFilePaths;
 
+        //the semivariograms of grids with the same dimensions are computed all at once in-process
+        if( computeVariogramsInProcess( validAttributes, expVarFilePaths ) ){
+            Application::instance()->logInfo("MultiVariogramDialog::onGam(): the semivariograms were computed in-process "
+                                             "(FFT-based, same pair-difference definition as gam).");
+            onVargplt( expVarFilePaths );
+            return;
+        }
+        Application::instance()->logInfo("MultiVariogramDialog::onGam(): running gam for each variable (the in-process "
+                                         "computation requires grids with the same dimensions, the first realization "
+                                         "and semivariograms only).");
+        //discards the output of an in-process computation that failed halfway
+        expVarFilePaths.clear();
+
         //set attributes that must vary for each variable...
         //TODO: these can be done in parallel
         it = validAttributes.begin();
@@ -158,26 +176,93 @@ void MultiVariogramDialog::onGam()
             // Letting the user change it (one may do some weird cross-simulation analysis...)
             //m_gpf_gam->getParameter<GSLibParUInt*>(4)->_value = 1;
 
+            //the gam runs are jobs of the scheduler, so they run concurrently, each in its own working directory
+            GSLibJobPtr job = GSLibJobScheduler::instance()->createJob( "gam" );
+
             //set an output file with experimental variogram values
-            m_gpf_gam->getParameter<GSLibParFile*>(3)->_path =
-                    Application::instance()->getProject()->generateUniqueTmpFilePath("out");
+            m_gpf_gam->getParameter<GSLibParFile*>(3)->_path = job->makeFilePath( "gam.out" );
             expVarFilePaths.push_back( m_gpf_gam->getParameter<GSLibParFile*>(3)->_path );
 
             //Generate the parameter file
-            QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
-            m_gpf_gam->save( par_file_path );
+            m_gpf_gam->save( job->parFilePath );
 
             //...run gam program
             Application::instance()->logInfo("Starting gam program for variable " +
                                              at->getName() + " in file " + cg->getName() + "...");
-            GSLib::instance()->runProgram( "gam", par_file_path );
+            GSLibJobScheduler::instance()->submit( job );
         }
 
+        //wait for all the gam runs before plotting their outputs
+        GSLibJobScheduler::instance()->waitForAll();
+
 
         onVargplt( expVarFilePaths );
     }
 }
 
+bool MultiVariogramDialog::computeVariogramsInProcess(const std::vector<Attribute *> &attributes,
+                                                      std::vector<QString> &expVarFilePaths)
+{
+    //only semivariograms of the first realization are computed in-process
+    if( m_gpf_gam->getParameter<GSLibParUInt*>(4)->_value != 1 )
+        return false;
+    uint nVariograms = m_gpf_gam->getParameter<GSLibParUInt*>(9)->_value;
+    GSLibParRepeat *par10 = m_gpf_gam->getParameter<GSLibParRepeat*>(10); //repeat nvarios-times
+    for( uint i = 0; i < nVariograms; ++i ){
+        GSLibParMultiValuedFixed *par10_0 = par10->getParameter<GSLibParMultiValuedFixed*>(i, 0);
+        if( par10_0->getParameter<GSLibParOption*>(2)->_selected_value != 1 )
+            return false;
+    }
+
+    //the grids must have the same dimensions and cell sizes (the lags are in cells), otherwise gam runs for each grid
+    CartesianGrid* firstGrid = (CartesianGrid*)attributes.front()->getContainingFile();
+    for( Attribute* at : attributes ){
+        CartesianGrid* cg = (CartesianGrid*)at->getContainingFile();
+        if( cg->getNX() != firstGrid->getNX() || cg->getNY() != firstGrid->getNY() || cg->getNZ() != firstGrid->getNZ() ||
+            cg->getDX() != firstGrid->getDX() || cg->getDY() != firstGrid->getDY() || cg->getDZ() != firstGrid->getDZ() )
+            return false;
+    }
+
+    int nLags;
+    std::vector<VariogramLagStep> steps = MultivariateVariogramEngine::getLagSteps( m_gpf_gam, nLags );
+
+    //trimming limits
+    GSLibParMultiValuedFixed *par2 = m_gpf_gam->getParameter<GSLibParMultiValuedFixed*>(2);
+
+    MultivariateVariogramEngine engine;
+    engine.setTrimmingLimits( par2->getParameter<GSLibParDouble*>(0)->_value,
+                              par2->getParameter<GSLibParDouble*>(1)->_value );
+    engine.setComputeCrossVariograms( false );
+    engine.setMaximumLags( steps, nLags );
+    engine.setStandardizeSills( m_gpf_gam->getParameter<GSLibParOption*>(8)->_selected_value == 1 );
+    for( Attribute* at : attributes ){
+        CartesianGrid* cg = (CartesianGrid*)at->getContainingFile();
+        Application::instance()->logInfo("Processing attribute " + at->getName() + " of file " + cg->getName() + "...");
+        cg->loadData();
+        if( engine.addVariable( cg, cg->getFieldGEOEASIndex( at->getName() ) - 1 ) < 0 )
+            return false;
+    }
+    if( ! engine.run() )
+        return false;
+
+    for( int iVariable = 0; iVariable < engine.getVariableCount(); ++iVariable ){
+        QString path = Application::instance()->getProject()->generateUniqueTmpFilePath("out");
+        ExperimentalVariogram* expVar = engine.makeExperimentalVariogram( iVariable, iVariable, steps, nLags, path );
+        if( ! expVar )
+            return false;
+        delete expVar;
+        //the same variogram is repeated for each variogram requested in the parameters
+        QFile file( path );
+        if( nVariograms > 1 && file.open( QFile::ReadWrite | QFile::Text ) ){
+            QByteArray content = file.readAll();
+            for( uint i = 1; i < nVariograms; ++i )
+                file.write( content );
+        }
+        expVarFilePaths.push_back( path );
+    }
+    return true;
+}
+
 void MultiVariogramDialog::onVargplt( std::vector<QString> &expVarFilePaths )
 {
     //compute a number of variogram curves to plot depending on
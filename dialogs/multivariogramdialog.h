@@ -25,6 +25,10 @@ private:
     GSLibParameterFile* m_gpf_gam;
     GSLibParameterFile* m_gpf_vargplt;
 
+    /** Computes the experimental semivariograms of the attributes in-process (one output file per attribute
+     * like gam's) if the gam parameters and the grids allow it.  Returns false otherwise. */
+    bool computeVariogramsInProcess( const std::vector<Attribute *>& attributes, std::vector<QString>& expVarFilePaths );
+
 private slots:
     void onGam();
     void onVargplt(std::vector<QString> &expVarFilePaths);
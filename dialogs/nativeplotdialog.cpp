@@ -0,0 +1,257 @@
+#include "nativeplotdialog.h"
+#include "ui_nativeplotdialog.h"
+
+#include "widgets/nativeplotwidget.h"
+#include "domain/attribute.h"
+#include "domain/datafile.h"
+#include "domain/pointset.h"
+#include "domain/cartesiangrid.h"
+#include "domain/categorydefinition.h"
+#include "util.h"
+
+#include <QFileDialog>
+#include <QMessageBox>
+#include <cmath>
+#include <limits>
+
+NativePlotDialog::NativePlotDialog(NativePlotWidget *plotWidget, const QString title, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::NativePlotDialog),
+    m_plotWidget( plotWidget ),
+    m_histogram( dynamic_cast<HistogramPlotWidget*>( plotWidget ) ),
+    m_scatterPlot( dynamic_cast<ScatterPlotWidget*>( plotWidget ) ),
+    m_locationMap( dynamic_cast<LocationMapWidget*>( plotWidget ) ),
+    m_pixelPlot( dynamic_cast<PixelPlotWidget*>( plotWidget ) )
+{
+    ui->setupUi(this);
+
+    //deletes dialog from memory upon user closing it
+    this->setAttribute(Qt::WA_DeleteOnClose);
+
+    //set dialog title
+    this->setWindowTitle( title );
+    m_plotWidget->setTitle( title );
+
+    //add the plot widget (not originally present in .UI file)
+    QVBoxLayout *vbl = new QVBoxLayout();
+    vbl->setSpacing(0);
+    vbl->setMargin(0);
+    ui->widgetPlace->setLayout( vbl );
+    vbl->addWidget( m_plotWidget );
+
+    //show only the controls relevant for the plot type
+    ui->lblBins->setVisible( m_histogram );
+    ui->spinBins->setVisible( m_histogram );
+    ui->chkLogScale->setVisible( m_histogram );
+    ui->chkCumulative->setVisible( m_histogram );
+    ui->lblSlice->setVisible( m_pixelPlot );
+    ui->spinSlice->setVisible( m_pixelPlot );
+    ui->lblColorScale->setVisible( m_locationMap || m_pixelPlot );
+    ui->dblSpinColorMin->setVisible( m_locationMap || m_pixelPlot );
+    ui->dblSpinColorMax->setVisible( m_locationMap || m_pixelPlot );
+    ui->lblMaxPoints->setVisible( m_scatterPlot || m_locationMap );
+    ui->spinMaxPoints->setVisible( m_scatterPlot || m_locationMap );
+
+    //initialize the controls with the current plot settings
+    if( m_histogram )
+        ui->spinBins->setValue( m_histogram->getNumberOfBins() );
+    if( m_scatterPlot )
+        ui->spinMaxPoints->setValue( m_scatterPlot->getMaxPointsToDraw() );
+    if( m_locationMap ){
+        ui->spinMaxPoints->setValue( m_locationMap->getMaxPointsToDraw() );
+        ui->dblSpinColorMin->setValue( m_locationMap->getColorScaleMin() );
+        ui->dblSpinColorMax->setValue( m_locationMap->getColorScaleMax() );
+    }
+    if( m_pixelPlot ){
+        ui->spinSlice->setMaximum( std::max( 1U, m_pixelPlot->getNK() ) );
+        ui->spinSlice->setValue( m_pixelPlot->getSlice() + 1 );
+        ui->dblSpinColorMin->setValue( m_pixelPlot->getColorScaleMin() );
+        ui->dblSpinColorMax->setValue( m_pixelPlot->getColorScaleMax() );
+    }
+
+    connect( ui->spinBins,        SIGNAL(valueChanged(int)),    this, SLOT(onSettingsChanged()) );
+    connect( ui->chkLogScale,     SIGNAL(toggled(bool)),        this, SLOT(onSettingsChanged()) );
+    connect( ui->chkCumulative,   SIGNAL(toggled(bool)),        this, SLOT(onSettingsChanged()) );
+    connect( ui->spinSlice,       SIGNAL(valueChanged(int)),    this, SLOT(onSettingsChanged()) );
+    connect( ui->dblSpinColorMin, SIGNAL(valueChanged(double)), this, SLOT(onSettingsChanged()) );
+    connect( ui->dblSpinColorMax, SIGNAL(valueChanged(double)), this, SLOT(onSettingsChanged()) );
+    connect( ui->spinMaxPoints,   SIGNAL(valueChanged(int)),    this, SLOT(onSettingsChanged()) );
+    connect( ui->btnSave,         SIGNAL(clicked()),            this, SLOT(onSave()) );
+
+    adjustSize();
+}
+
+NativePlotDialog::~NativePlotDialog()
+{
+    delete ui;
+}
+
+NativePlotDialog *NativePlotDialog::makeHistogram(Attribute *at, QWidget *parent)
+{
+    DataFile* dataFile = dynamic_cast<DataFile*>( at->getContainingFile() );
+    dataFile->loadData();
+    uint column = dataFile->getFieldGEOEASIndex( at->getName() ) - 1;
+
+    //collect the values, excluding the no-data values
+    bool hasNDV = dataFile->hasNoDataValue();
+    double NDV = dataFile->getNoDataValueAsDouble();
+    uint nRows = dataFile->getDataLineCount();
+    std::vector<double> values;
+    values.reserve( nRows );
+    for( uint iRow = 0; iRow < nRows; ++iRow ){
+        double value = dataFile->dataConst( iRow, column );
+        if( ! hasNDV || ! Util::almostEqual2sComplement( NDV, value, 1 ) )
+            values.push_back( value );
+    }
+
+    HistogramPlotWidget* histogram = new HistogramPlotWidget();
+    histogram->setXLabel( at->getName() );
+    histogram->setData( values );
+
+    return new NativePlotDialog( histogram, dataFile->getName() + "/" + at->getName() + " histogram", parent );
+}
+
+NativePlotDialog *NativePlotDialog::makeCrossPlot(Attribute *xVariable, Attribute *yVariable, Attribute *zVariable, QWidget *parent)
+{
+    DataFile* dataFile = dynamic_cast<DataFile*>( xVariable->getContainingFile() );
+    dataFile->loadData();
+    uint xColumn = dataFile->getFieldGEOEASIndex( xVariable->getName() ) - 1;
+    uint yColumn = dataFile->getFieldGEOEASIndex( yVariable->getName() ) - 1;
+    int zColumn = zVariable ? static_cast<int>( dataFile->getFieldGEOEASIndex( zVariable->getName() ) ) - 1 : -1;
+
+    //collect the value pairs (or triplets), excluding those with any no-data value
+    bool hasNDV = dataFile->hasNoDataValue();
+    double NDV = dataFile->getNoDataValueAsDouble();
+    uint nRows = dataFile->getDataLineCount();
+    std::vector<double> xs, ys, zs;
+    xs.reserve( nRows );
+    ys.reserve( nRows );
+    if( zColumn >= 0 )
+        zs.reserve( nRows );
+    for( uint iRow = 0; iRow < nRows; ++iRow ){
+        double x = dataFile->dataConst( iRow, xColumn );
+        double y = dataFile->dataConst( iRow, yColumn );
+        double z = zColumn >= 0 ? dataFile->dataConst( iRow, zColumn ) : 0.0;
+        if( hasNDV && ( Util::almostEqual2sComplement( NDV, x, 1 ) ||
+                        Util::almostEqual2sComplement( NDV, y, 1 ) ||
+                        ( zColumn >= 0 && Util::almostEqual2sComplement( NDV, z, 1 ) ) ) )
+            continue;
+        xs.push_back( x );
+        ys.push_back( y );
+        if( zColumn >= 0 )
+            zs.push_back( z );
+    }
+
+    ScatterPlotWidget* scatterPlot = new ScatterPlotWidget();
+    scatterPlot->setXLabel( xVariable->getName() );
+    scatterPlot->setYLabel( yVariable->getName() );
+    scatterPlot->setData( xs, ys, zs );
+
+    QString title = "Crossplot " + dataFile->getName() + ": " + xVariable->getName() + " x " + yVariable->getName();
+    if( zVariable )
+        title += " x " + zVariable->getName();
+    return new NativePlotDialog( scatterPlot, title, parent );
+}
+
+NativePlotDialog *NativePlotDialog::makeLocationMap(Attribute *variable, QWidget *parent)
+{
+    PointSet* pointSet = dynamic_cast<PointSet*>( variable->getContainingFile() );
+    pointSet->loadData();
+    uint column = pointSet->getFieldGEOEASIndex( variable->getName() ) - 1;
+    uint xColumn = pointSet->getXindex() - 1;
+    uint yColumn = pointSet->getYindex() - 1;
+
+    //collect the locations and values, excluding the no-data values
+    bool hasNDV = pointSet->hasNoDataValue();
+    double NDV = pointSet->getNoDataValueAsDouble();
+    uint nRows = pointSet->getDataLineCount();
+    std::vector<double> xs, ys, values;
+    xs.reserve( nRows );
+    ys.reserve( nRows );
+    values.reserve( nRows );
+    for( uint iRow = 0; iRow < nRows; ++iRow ){
+        double value = pointSet->dataConst( iRow, column );
+        if( hasNDV && Util::almostEqual2sComplement( NDV, value, 1 ) )
+            continue;
+        xs.push_back( pointSet->dataConst( iRow, xColumn ) );
+        ys.push_back( pointSet->dataConst( iRow, yColumn ) );
+        values.push_back( value );
+    }
+
+    LocationMapWidget* locationMap = new LocationMapWidget();
+    locationMap->setData( xs, ys, values );
+
+    return new NativePlotDialog( locationMap, pointSet->getName() + "/" + variable->getName() + " map", parent );
+}
+
+NativePlotDialog *NativePlotDialog::makePixelPlot(Attribute *variable, CategoryDefinition *cd, QWidget *parent)
+{
+    //the pixel plot is axis-aligned, so it only depicts non-rotated Cartesian grids
+    CartesianGrid* cg = dynamic_cast<CartesianGrid*>( variable->getContainingFile() );
+    if( ! cg || cg->getRot() != 0.0 )
+        return nullptr;
+    cg->loadData();
+    uint column = cg->getFieldGEOEASIndex( variable->getName() ) - 1;
+
+    //collect the values of the first realization, with the no-data values replaced by NaNs
+    bool hasNDV = cg->hasNoDataValue();
+    double NDV = cg->getNoDataValueAsDouble();
+    uint nCells = cg->getNX() * cg->getNY() * cg->getNZ();
+    nCells = std::min( nCells, cg->getDataLineCount() );
+    std::vector<double> values( nCells );
+    for( uint iCell = 0; iCell < nCells; ++iCell ){
+        double value = cg->dataConst( iCell, column );
+        if( hasNDV && Util::almostEqual2sComplement( NDV, value, 1 ) )
+            value = std::numeric_limits<double>::quiet_NaN();
+        values[iCell] = value;
+    }
+
+    PixelPlotWidget* pixelPlot = new PixelPlotWidget();
+    pixelPlot->setData( cg->getNX(), cg->getNY(), cg->getNZ(),
+                        cg->getX0(), cg->getY0(), cg->getDX(), cg->getDY(), values );
+
+    if( cd ){
+        //make sure the category definition info is loaded from the file
+        cd->loadQuintuplets();
+        std::map<int, QColor> categoryColors;
+        std::map<int, QString> categoryNames;
+        for( int iCat = 0; iCat < cd->getCategoryCount(); ++iCat ){
+            categoryColors[ cd->getCategoryCode( iCat ) ] = cd->getCustomColor( iCat );
+            categoryNames[ cd->getCategoryCode( iCat ) ] = cd->getCategoryName( iCat );
+        }
+        pixelPlot->setCategories( categoryColors, categoryNames );
+    }
+
+    return new NativePlotDialog( pixelPlot, cg->getName() + "/" + variable->getName() + " grid", parent );
+}
+
+void NativePlotDialog::onSettingsChanged()
+{
+    if( m_histogram ){
+        m_histogram->setNumberOfBins( ui->spinBins->value() );
+        m_histogram->setLogScaleX( ui->chkLogScale->isChecked() );
+        m_histogram->setCumulative( ui->chkCumulative->isChecked() );
+    }
+    if( m_scatterPlot )
+        m_scatterPlot->setMaxPointsToDraw( ui->spinMaxPoints->value() );
+    if( m_locationMap ){
+        m_locationMap->setMaxPointsToDraw( ui->spinMaxPoints->value() );
+        m_locationMap->setColorScaleRange( ui->dblSpinColorMin->value(), ui->dblSpinColorMax->value() );
+    }
+    if( m_pixelPlot ){
+        m_pixelPlot->setSlice( ui->spinSlice->value() - 1 );
+        m_pixelPlot->setColorScaleRange( ui->dblSpinColorMin->value(), ui->dblSpinColorMax->value() );
+    }
+}
+
+void NativePlotDialog::onSave()
+{
+    QString filePath = QFileDialog::getSaveFileName( this, "Save plot image", QString(), "PNG image (*.png)" );
+    if( filePath.isEmpty() )
+        return;
+    if( ! filePath.endsWith( ".png", Qt::CaseInsensitive ) )
+        filePath += ".png";
+    QImage image = m_plotWidget->renderToImage( m_plotWidget->size() );
+    if( ! image.save( filePath, "PNG" ) )
+        QMessageBox::critical( this, "Error", "Failed to save " + filePath + "." );
+}
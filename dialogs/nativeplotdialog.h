@@ -0,0 +1,64 @@
+#ifndef NATIVEPLOTDIALOG_H
+#define NATIVEPLOTDIALOG_H
+
+#include <QDialog>
+
+namespace Ui {
+class NativePlotDialog;
+}
+
+class Attribute;
+class CategoryDefinition;
+class NativePlotWidget;
+class HistogramPlotWidget;
+class ScatterPlotWidget;
+class LocationMapWidget;
+class PixelPlotWidget;
+
+/**
+ * The NativePlotDialog displays the plots rendered in-process by the NativePlotWidget subclasses.  It is
+ * the counterpart of DisplayPlotDialog (which displays the PostScript output of GSLib plot programs).
+ * The plot settings (bins, slice, color scale, etc.) are changed with the controls below the plot
+ * and take effect immediately.
+ * Use the make*() factory functions to create dialogs for the different plot types.
+ */
+class NativePlotDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    ~NativePlotDialog();
+
+    /** Makes a dialog with the histogram of a variable (equivalent to GSLib's histplt). */
+    static NativePlotDialog* makeHistogram( Attribute* at, QWidget *parent = nullptr );
+
+    /** Makes a dialog with the cross plot of two variables, optionally colored by a third one
+     * (equivalent to GSLib's scatplt).  All variables must belong to the same file. */
+    static NativePlotDialog* makeCrossPlot( Attribute* xVariable, Attribute* yVariable, Attribute* zVariable,
+                                            QWidget *parent = nullptr );
+
+    /** Makes a dialog with the map of a point set variable (equivalent to GSLib's locmap). */
+    static NativePlotDialog* makeLocationMap( Attribute* variable, QWidget *parent = nullptr );
+
+    /** Makes a dialog with the map of a Cartesian grid variable (equivalent to GSLib's pixelplt).
+     * Returns nullptr if the variable is not of a Cartesian grid or if the grid is rotated.
+     * @param cd If informed, the variable is rendered as categorical. */
+    static NativePlotDialog* makePixelPlot( Attribute* variable, CategoryDefinition* cd, QWidget *parent = nullptr );
+
+private:
+    NativePlotDialog( NativePlotWidget* plotWidget, const QString title, QWidget *parent );
+
+    Ui::NativePlotDialog *ui;
+    NativePlotWidget* m_plotWidget;
+    //only one of the following points to m_plotWidget (the others are null)
+    HistogramPlotWidget* m_histogram;
+    ScatterPlotWidget* m_scatterPlot;
+    LocationMapWidget* m_locationMap;
+    PixelPlotWidget* m_pixelPlot;
+
+private slots:
+    void onSettingsChanged();
+    void onSave();
+};
+
+#endif // NATIVEPLOTDIALOG_H
@@ -10,6 +10,7 @@
 #include "gslib/gslibparameterfiles/gslibparamtypes.h"
 #include "gslib/gslibparametersdialog.h"
 #include "gslib/gslib.h"
+#include "geostats/normalscoretransform.h"
 #include "displayplotdialog.h"
 #include "util.h"
 #include <QMessageBox>
@@ -87,7 +88,7 @@ void NScoreDialog::onParams()
     par5->getParameter<GSLibParUInt*>(0)->_value = 0;
     par5->getParameter<GSLibParUInt*>(1)->_value = 0;
 
-    //output file
+    //output file (not written: the normal scores are kept in memory until saved to the input file)
     m_gpf_nscore->getParameter<GSLibParFile*>(6)->_path = Application::instance()->getProject()->generateUniqueTmpFilePath("out");
 
     //file with transform table
@@ -99,12 +100,9 @@ void NScoreDialog::onParams()
         GSLibParametersDialog gslibpardiag ( m_gpf_nscore );
         int result = gslibpardiag.exec();
         if( result == QDialog::Accepted ){
-            //Generate the parameter file
-            QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
-            m_gpf_nscore->save( par_file_path );
-            //run nscore program
-            Application::instance()->logInfo("Starting nscore program...");
-            GSLib::instance()->runProgram( "nscore", par_file_path );
+            //compute the normal scores in-process with the nscore settings
+            if( ! NormalScoreTransform::runNScore( m_gpf_nscore, input_file, m_nScores, &m_transform ) )
+                discard_parameters = true;
         } else {
             discard_parameters = true;
         }
@@ -125,15 +123,13 @@ void NScoreDialog::onHistogram()
     //get the original data file.
     DataFile* original_data_file = dynamic_cast<DataFile*>(m_attribute->getContainingFile());
 
-    //determine whether it is a point set or grid
-    bool isPointSet = ( original_data_file->getFileType() == "POINTSET" );
+    //histplt reads the normal scores from a file with just them (the locations do not matter for a histogram)
+    QString nScoresFilePath = Application::instance()->getProject()->generateUniqueTmpFilePath("dat");
+    Util::createGEOEASGrid( "Normal Score value", m_nScores, nScoresFilePath );
+    PointSet* input_data_file = new PointSet( nScoresFilePath );
+    input_data_file->setInfo( 0, 0, 0, original_data_file->hasNoDataValue() ? original_data_file->getNoDataValue() : "-999" );
 
-    //histogram computation is different for each data file type
-    if( isPointSet ){
-        doHistogramPointSet();
-    } else {
-        doHistogramGrid();
-    }
+    doHistogramCommon( input_data_file );
 }
 
 void NScoreDialog::onSave()
@@ -143,88 +139,29 @@ void NScoreDialog::onSave()
         return;
     }
 
-    //get the original data file before n-score
+    //get the original data file
     DataFile* original_data_file = dynamic_cast<DataFile*>(m_attribute->getContainingFile());
 
-    //determine whether the original data file is a point set or grid
-    bool isPointSet = ( original_data_file->getFileType() == "POINTSET" );
-
-    //get the DataFile resulted from n-score
-    DataFile* input_data_file;
-    if( isPointSet ){
-        input_data_file = new PointSet( m_gpf_nscore->getParameter<GSLibParFile*>(6)->_path );
-        PointSet *pointset_aspect = (PointSet*)input_data_file;
-        pointset_aspect->setInfo( pointset_aspect->getXindex(),
-                                  pointset_aspect->getYindex(),
-                                  pointset_aspect->getZindex(),
-                                  "-999");
-    } else {
-        input_data_file = new CartesianGrid( m_gpf_nscore->getParameter<GSLibParFile*>(6)->_path );
-        ((CartesianGrid*)input_data_file)->setInfoFromOtherCG( (CartesianGrid*)original_data_file );
-    }
-
-    //nscore writes the normal variable as the last one in the data file
-    ProjectComponent* pc = input_data_file->getChildByIndex( input_data_file->getChildCount()-1 );
-
-    //get the variable name generated by nscore
-    QString last_attr_name = pc->getName();
-
-    //presents a dialog so the user can change the default name given by nscores.
+    //presents a dialog so the user can change the default name of the normal variable.
     bool ok;
     QString proposed_name(m_attribute->getName());
     proposed_name = proposed_name.append("_ns");
-    QString new_var_name = QInputDialog::getText(this, "Rename the normal variable",
+    QString new_var_name = QInputDialog::getText(this, "Name the normal variable",
                                              "New variable name:", QLineEdit::Normal,
                                              proposed_name, &ok);
     if (ok && !new_var_name.isEmpty()){
-        //renames the new variable in the physical file.
-        Util::renameGEOEASvariable( input_data_file->getPath(), last_attr_name, new_var_name );
         //get the variable index in the GEO-EAS file
         uint indexGEOEASvariable = original_data_file->getFieldGEOEASIndex( m_attribute->getName() );
-        //get the normal variable index in the GEO-EAS file
-        uint indexGEOEASweight = input_data_file->getFieldGEOEASIndex( new_var_name );
-        //copies the transform table to the project directory
-        Util::copyFileToDir( m_gpf_nscore->getParameter<GSLibParFile*>(7)->_path,
-                        Application::instance()->getProject()->getPath() );
-        //get the file name of the transform table
-        QString trn_file_name = QFileInfo( m_gpf_nscore->getParameter<GSLibParFile*>(7)->_path ).fileName();
-        //sets the variable-normal variable relationship
-        original_data_file->addVariableNScoreVariableRelationship( indexGEOEASvariable, indexGEOEASweight, trn_file_name);
-        //replaces the data file's physical file with the generated one.
-        original_data_file->replacePhysicalFile( input_data_file->getPath() );
+        //adds the normal scores to the data file, saves the transform table in the project directory
+        //and sets the variable-normal variable relationship
+        if( ! NormalScoreTransform::addNormalScoreVariable( original_data_file, indexGEOEASvariable,
+                                                            m_nScores, m_transform, new_var_name ) )
+            QMessageBox::critical( this, "Error", "Failed to add the normal variable.  Check the message panel.");
+        Application::instance()->refreshProjectTree();
     }
 
 }
 
-void NScoreDialog::doHistogramPointSet()
-{
-    //get the original data file.
-    PointSet* original_data_file = (PointSet*)m_attribute->getContainingFile();
-
-    //parse and get input data file
-    //the resulting file of nscore in this case is a point set
-    PointSet* input_data_file = new PointSet( m_gpf_nscore->getParameter<GSLibParFile*>(6)->_path );
-    input_data_file->setInfo( original_data_file->getXindex(),
-                              original_data_file->getYindex(),
-                              original_data_file->getZindex(),
-                              "-999");
-
-    doHistogramCommon( input_data_file );
-}
-
-void NScoreDialog::doHistogramGrid()
-{
-    //get the original data file.
-    CartesianGrid* original_data_file = (CartesianGrid*)m_attribute->getContainingFile();
-
-    //parse and get input data file
-    //the resulting file of nscore in this case is a point set
-    CartesianGrid* input_data_file = new CartesianGrid( m_gpf_nscore->getParameter<GSLibParFile*>(6)->_path );
-    input_data_file->setInfoFromOtherCG( original_data_file );
-
-    doHistogramCommon( input_data_file );
-}
-
 void NScoreDialog::doHistogramCommon(DataFile *input_data_file)
 {
     //load file data.
@@ -2,6 +2,7 @@
 #define NSCOREDIALOG_H
 
 #include <QDialog>
+#include "geostats/normalscoretransform.h"
 
 namespace Ui {
 class NScoreDialog;
@@ -23,6 +24,9 @@ private:
     Ui::NScoreDialog *ui;
     Attribute* m_attribute;
     GSLibParameterFile* m_gpf_nscore;
+    /** The normal scores computed with the settings in m_gpf_nscore (one per data line) and their table. */
+    std::vector<double> m_nScores;
+    NormalScoreTransform m_transform;
 
 private slots:
     void onParams();
@@ -30,8 +34,6 @@ private slots:
     void onSave();
 
 private:
-    void doHistogramPointSet();
-    void doHistogramGrid();
     void doHistogramCommon(DataFile* input_data_file);
 };
 
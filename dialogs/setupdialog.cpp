@@ -2,6 +2,7 @@
 #include "ui_setupdialog.h"
 #include <QFileDialog>
 #include "domain/application.h"
+#include "domain/datamemorymanager.h"
 #include "util.h"
 
 SetupDialog::SetupDialog(QWidget *parent) :
@@ -14,6 +15,8 @@ SetupDialog::SetupDialog(QWidget *parent) :
     ui->txtGSPath->setText( Application::instance()->getGhostscriptPathSetting() );
     ui->txtGVPath->setText( Application::instance()->getGraphVizPathSetting() );
     ui->spinMaxGridCells3DView->setValue( Application::instance()->getMaxGridCellCountFor3DVisualizationSetting() );
+    ui->chkUseNativePlots->setChecked( Application::instance()->getUseNativePlotsSetting() );
+    ui->spinDataMemoryBudget->setValue( Application::instance()->getDataMemoryBudgetSetting() );
     adjustSize();
 }
 
@@ -50,6 +53,9 @@ void SetupDialog::accept()
     Application::instance()->setGhostscriptPathSetting( ui->txtGSPath->text() );
     Application::instance()->setGraphVizPathSetting( ui->txtGVPath->text() );
     Application::instance()->setMaxGridCellCountFor3DVisualizationSetting( ui->spinMaxGridCells3DView->value() );
+    Application::instance()->setUseNativePlotsSetting( ui->chkUseNativePlots->isChecked() );
+    Application::instance()->setDataMemoryBudgetSetting( ui->spinDataMemoryBudget->value() );
+    DataMemoryManager::instance()->setBudget( (int64_t)ui->spinDataMemoryBudget->value() * 1024 * 1024 );
     //make dialog close.
     this->reject();
 }
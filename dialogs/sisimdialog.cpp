@@ -7,6 +7,8 @@
 #include "widgets/variogrammodelselector.h"
 #include "widgets/distributionfieldselector.h"
 #include "dialogs/displayplotdialog.h"
+#include "dialogs/emptydialog.h"
+#include "widgets/linechartwidget.h"
 #include "dialogs/variograminputdialog.h"
 #include "domain/file.h"
 #include "domain/pointset.h"
@@ -22,11 +24,17 @@
 #include "gslib/gslibparameterfiles/gslibparameterfile.h"
 #include "gslib/gslibparametersdialog.h"
 #include "gslib/gslib.h"
+#include "gslib/gslibjobscheduler.h"
+#include "geostats/postsimulationengine.h"
+#include "geostats/realizationstore.h"
+#include "geostats/ensemblevariogramchecker.h"
 #include "util.h"
 
 #include <QFileInfo>
 #include <QInputDialog>
 #include <QMessageBox>
+#include <cmath>
+#include <memory>
 
 SisimDialog::SisimDialog(IKVariableType varType, QWidget *parent) :
     QDialog(parent),
@@ -755,48 +763,25 @@ void SisimDialog::onRealizationHistogram()
                        &ok);
     if(!ok) return;
 
-    //construct a parameter file for the addcoord program
-    //We use the addcoord program to extract data from a specific realization
-    //for the histogram
-    GSLibParameterFile gpfForAddcoord( "addcoord" );
-
-    //input file
-    GSLibParFile* par0 = gpfForAddcoord.getParameter<GSLibParFile*>( 0 );
-    par0->_path = cg->getPath();
-
-    //output file (temporary)
-    GSLibParFile* par1 = gpfForAddcoord.getParameter<GSLibParFile*>( 1 );
-    par1->_path = Application::instance()->getProject()->generateUniqueTmpFilePath( "xyz" );
-
-    //realization number
-    GSLibParUInt* par2 = gpfForAddcoord.getParameter<GSLibParUInt*>( 2 );
-    par2->_value = realNumber;
-
-    //grid parameters
-    GSLibParGrid* par3 = gpfForAddcoord.getParameter<GSLibParGrid*>( 3 );
-    par3->setFromCG( cg );
-
-    //Generate the parameter file for the addcoord program
-    QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
-    gpfForAddcoord.save( par_file_path );
-
-    //run addcoord program
-    Application::instance()->logInfo("Starting addcoord program...");
-    GSLib::instance()->runProgram( "addcoord", par_file_path );
-    Application::instance()->logInfo("addcoord completed.");
-
-    //make the point set object from the temporary point set file created by addcoord
-    //TODO: memory leak. delete the object pointed by ps somewhere (destructor?)
-    PointSet *ps = new PointSet( par1->_path );
-
-    //addcoord always adds the X,Y,Z fields as 1st, 2nd and 3rd variables in the data file
+    //read the realization from the realization store kept along the simulation output
+    //(it is created from the simulation output the first time).
+    RealizationStore store;
+    if( ! store.openForGrid( cg ) )
+        return;
+    std::vector<double> values = store.getRealization( realNumber - 1 );
+
+    //make a temporary grid with the values of the target realization
+    QString realizationName = "realization " + QString::number( realNumber );
+    QString tmp_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath( "dat" );
+    Util::createGEOEASGrid( realizationName, values, tmp_file_path );
+    //the temporary grid lives until the user closes the histogram, which is shown modally for that.
+    std::unique_ptr<CartesianGrid> realization_cg( new CartesianGrid( tmp_file_path ) );
+    realization_cg->setInfoFromOtherCGonlyGridSpecs( cg );
     //the ndv value is the same as the original Cartesian grid.
-    ps->setInfo( 1, 2, 3, cg->getNoDataValue() );
+    realization_cg->setNoDataValue( cg->getNoDataValue() );
 
-    //the simulated values of the target realization is the 4th GEO-EAS column in the point set file
-    //generated by addcord
-    Attribute *at = ps->getAttributeFromGEOEASIndex( 4 );
-    Util::viewHistogram( at, this );
+    Attribute *at = realization_cg->getAttributeFromGEOEASIndex( 1 );
+    Util::viewHistogram( at, this, true );
 }
 
 void SisimDialog::onEnsembleHistogram()
@@ -890,13 +875,14 @@ void SisimDialog::onEnsembleHistogram()
 
     //----------------------------------------------------------------------------------
 
-    //Generate the parameter file
-    QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
-    gpf.save( par_file_path );
-
-    //run histpltsim program
+    //run histpltsim program as a job of the scheduler (in its own working directory)
+    GSLibJobPtr job = GSLibJobScheduler::instance()->createJob( "histpltsim" );
+    gpf.save( job->parFilePath );
     Application::instance()->logInfo("Starting histpltsim program...");
-    GSLib::instance()->runProgram( "histpltsim", par_file_path );
+    GSLibJobScheduler::instance()->submit( job );
+    GSLibJobScheduler::instance()->waitForAll();
+    if( job->status != GSLibJobStatus::FINISHED )
+        return;
 
     //display the plot output
     DisplayPlotDialog *dpd = new DisplayPlotDialog(gpf.getParameter<GSLibParFile*>(10)->_path, title, gpf, this);
@@ -926,7 +912,7 @@ void SisimDialog::onEnsembleVariogram()
     uint nReals = m_cg_simulation->getNReal();
 
     //-------------------------------------------------------------------------------------------
-    //-----------1) Run gam on each realization--------------------------------------------------
+    //-----------1) Set the directions and lags of the variograms-------------------------------
     //-------------------------------------------------------------------------------------------
 
     //if the parameter file object was not constructed
@@ -986,176 +972,52 @@ void SisimDialog::onEnsembleVariogram()
     }
     //--------------------------------------------------------------------------------
 
-    //show the parameter dialog so the user can adjust other settings before running gam
+    //show the parameter dialog so the user can adjust other settings (directions and lags) of the variograms
     GSLibParametersDialog gslibpardiag( m_gpf_gam );
     int result = gslibpardiag.exec();
-    std::vector<QString> expVarFilePaths;
-    if( result == QDialog::Accepted ){
-        //save the realization number setting for the variogram modeling workflow
-        int oldNReal = m_gpf_gam->getParameter<GSLibParUInt*>(4)->_value;
-        //for each realization number...
-        for( uint iRealNum = 0 ; iRealNum < nReals; ++iRealNum ){
-            //...change the realization number parameter for gam
-            m_gpf_gam->getParameter<GSLibParUInt*>(4)->_value = iRealNum + 1;
-            //...set an output file with experimental variogram values
-            m_gpf_gam->getParameter<GSLibParFile*>(3)->_path =
-                    Application::instance()->getProject()->generateUniqueTmpFilePath("out");
-            expVarFilePaths.push_back( m_gpf_gam->getParameter<GSLibParFile*>(3)->_path );
-            //...Generate the parameter file
-            QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
-            m_gpf_gam->save( par_file_path );
-            //...run gam program
-            Application::instance()->logInfo("Starting gam program for realization " +
-                                             QString::number(iRealNum + 1) + "...");
-            GSLib::instance()->runProgram( "gam", par_file_path );
-        }
-        //restore the realization number setting for the variogram modeling workflow
-        m_gpf_gam->getParameter<GSLibParUInt*>(4)->_value = oldNReal;
-    }
-
-    //---------------------------------------------------------------------------------------------------------------
-    //-------------------------- 2) Run vmodel to generate the variogram model (reference)---------------------------
-    //---------------------------------------------------------------------------------------------------------------
-
-    //these are useful to compute lag, azimuth and dip from gam regular grid parameters
-    double xsize = 1.0;
-    double ysize = 1.0;
-    double zsize = 1.0;
-    if( m_gpf_gam )
-    {
-        GSLibParGrid* par5 = m_gpf_gam->getParameter<GSLibParGrid*>(5);
-        xsize = par5->_specs_x->getParameter<GSLibParDouble*>(2)->_value; //cell size x
-        ysize = par5->_specs_y->getParameter<GSLibParDouble*>(2)->_value; //cell size y
-        zsize = par5->_specs_z->getParameter<GSLibParDouble*>(2)->_value; //cell size z
-    }
+    if( result != QDialog::Accepted )
+        return;
 
-    //Construct an object composition based on the parameter file template for the vmodel program.
-    GSLibParameterFile gpf_vmodel = GSLibParameterFile( "vmodel" );
-    //Set default values so we need to change less parameters and let
-    //the user change the others as one may see fit.
-    gpf_vmodel.setDefaultValues();
-
-    //fills the variogram model paramaters.
-    gpf_vmodel.setValuesFromParFile( variogramModelInputVariable->getPath() );
-
-    //output variography data for vargplt
-    gpf_vmodel.getParameter<GSLibParFile*>(0)->_path = Application::instance()->getProject()->generateUniqueTmpFilePath("var");
-
-    //match the number of lags and azimuths with that set for the gam on the realizations
-    GSLibParMultiValuedFixed *gam_par6 = m_gpf_gam->getParameter<GSLibParMultiValuedFixed*>(6);
-    GSLibParMultiValuedFixed *par1 = gpf_vmodel.getParameter<GSLibParMultiValuedFixed*>(1);
-    par1->getParameter<GSLibParUInt*>(0)->_value = gam_par6->getParameter<GSLibParUInt*>(0)->_value; //ndir
-    par1->getParameter<GSLibParUInt*>(1)->_value = gam_par6->getParameter<GSLibParUInt*>(1)->_value;
-
-    //get the number of directions
-    uint ndir = gam_par6->getParameter<GSLibParUInt*>(0)->_value;
-
-    //compute azimuth and dip from the grid cell dimensions and steps set in gam
-    GSLibParRepeat *gam_par7 = m_gpf_gam->getParameter<GSLibParRepeat*>(7); //repeat ndir-times
-    QList<double> azimuths;
-    QList<double> dips;
-    QList<double> lags;
-    for(uint i = 0; i < ndir; ++i)
-    {
-        GSLibParMultiValuedFixed *par7_0 = gam_par7->getParameter<GSLibParMultiValuedFixed*>(i, 0);
-        int xstep = par7_0->getParameter<GSLibParInt*>(0)->_value;
-        int ystep = par7_0->getParameter<GSLibParInt*>(1)->_value;
-        int zstep = par7_0->getParameter<GSLibParInt*>(2)->_value;
-        azimuths.append( Util::getAzimuth( xsize, ysize, xstep, ystep ) );
-        dips.append( Util::getDip(xsize, ysize, zsize, xstep, ystep, zstep) );
-        double xlag = xstep * xsize;
-        double ylag = ystep * ysize;
-        double zlag = zstep * zsize;
-        double lag = std::sqrt( xlag*xlag + ylag*ylag + zlag*zlag );
-        lags.append( lag );
-    }
+    //-------------------------------------------------------------------------------------------
+    //-----------2) Compute the variograms of all realizations in a single pass------------------
+    //-------------------------------------------------------------------------------------------
 
-    //match the azimuths, dips and lags with those of the gam
-    GSLibParRepeat *par2 = gpf_vmodel.getParameter<GSLibParRepeat*>(2); //repeat ndir-times
-    par2->setCount( ndir );
-    for( uint i = 0; i < ndir; ++i)
-    {
-        GSLibParMultiValuedFixed *par2_0 = par2->getParameter<GSLibParMultiValuedFixed*>(i, 0);
-        par2_0->getParameter<GSLibParDouble*>(0)->_value = azimuths[i];
-        par2_0->getParameter<GSLibParDouble*>(1)->_value = dips[i];
-        par2_0->getParameter<GSLibParDouble*>(2)->_value = lags[i];
+    EnsembleVariogramChecker checker( m_cg_simulation );
+    checker.setFromParameters( m_gpf_gam );
+    checker.setVariogramModel( variogramModelInputVariable );
+    Application::instance()->logInfo("Computing the variograms of " + QString::number( nReals ) + " realizations...");
+    if( ! checker.run() ){
+        Application::instance()->logError("SisimDialog::onEnsembleVariogram(): failed to compute the variograms of the realizations.");
+        return;
     }
 
-    //Generate the vmodel parameter file
-    QString vmodel_par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
-    gpf_vmodel.save( vmodel_par_file_path );
-    //run vmodel program )
-    Application::instance()->logInfo("Starting vmodel program...");
-    GSLib::instance()->runProgram( "vmodel", vmodel_par_file_path );
-
     //-------------------------------------------------------------------------------------------
-    //-------------------------- 3) Run vargplt to show the variograms---------------------------
+    //-----------3) Show the envelopes of the variograms against the model-----------------------
     //-------------------------------------------------------------------------------------------
 
-    //make a GLSib parameter object if it wasn't done yet.
-    GSLibParameterFile gpf = GSLibParameterFile( "vargplt" );
-
-    //Set default values so we need to change less parameters and let
-    //the user change the others as one may see fit.
-    gpf.setDefaultValues();
-
-    //make plot/window title
     QString title = m_InputPointSetFileSelector->getSelectedDataFile()->getName() + "/" +
             m_InputVariableSelector->getSelectedVariableName() + ": SISIM";
-
-    //--------------------set some parameter values-----------------------
-
-    //postscript file
-    gpf.getParameter<GSLibParFile*>(0)->_path =
-            Application::instance()->getProject()->generateUniqueTmpFilePath("ps");
-
-    //number of curves
-    gpf.getParameter<GSLibParUInt*>(1)->_value = nReals + 1; // nvarios (realizations + variogram model)
-
-    //plot title
-    gpf.getParameter<GSLibParString*>(5)->_value = title;
-
-    //suggest display settings for each variogram curve
-    GSLibParRepeat *par6 = gpf.getParameter<GSLibParRepeat*>(6); //repeat nvarios-times
-    par6->setCount( nReals + 1 ); //the realizations plus the variogram model (reference)
-    //the realization curves
-    for(uint iReal = 0; iReal < nReals; ++iReal){
-        par6->getParameter<GSLibParFile*>(iReal, 0)->_path = expVarFilePaths[iReal];
-        GSLibParMultiValuedFixed *par6_0_1 = par6->getParameter<GSLibParMultiValuedFixed*>(iReal, 1);
-        par6_0_1->getParameter<GSLibParUInt*>(0)->_value = 1;
-        par6_0_1->getParameter<GSLibParUInt*>(1)->_value = 0;
-        par6_0_1->getParameter<GSLibParOption*>(2)->_selected_value = 0;
-        par6_0_1->getParameter<GSLibParOption*>(3)->_selected_value = 1;
-        par6_0_1->getParameter<GSLibParColor*>(4)->_color_code = 1;
+    EmptyDialog* ed = new EmptyDialog( this );
+    for( int iDir = 0; iDir < checker.getDirectionCount(); ++iDir ){
+        const VariogramLagStep& step = checker.getLagStep( iDir );
+        QString chartTitle = "STEP X=" + QString::number( step.x ) +
+                             " STEP Y=" + QString::number( step.y ) +
+                             " STEP Z=" + QString::number( step.z );
+        double coverage = checker.getModelCoverage( iDir );
+        if( std::isfinite( coverage ) )
+            chartTitle += ": model within P5-P95 in " + QString::number( coverage * 100.0, 'f', 0 ) + "% of lags";
+        LineChartWidget* lcw = new LineChartWidget( ed );
+        lcw->setSharedYaxis( true );
+        lcw->setChartTitle( chartTitle );
+        lcw->setData( checker.getChartData( iDir ), 0, true,
+                      {{1, "min"}, {2, "P5"}, {3, "median"}, {4, "P95"}, {5, "max"}, {6, "model"}},
+                      {{6, "semivariance"}}, // shared y-axis is enabled, set only the last one
+                      {{1, Qt::lightGray}, {2, Qt::gray}, {3, Qt::black}, {4, Qt::gray}, {5, Qt::lightGray}, {6, Qt::red}} );
+        lcw->setXaxisCaption( "lag distance" );
+        ed->addWidget( lcw );
     }
-    par6->getParameter<GSLibParFile*>(nReals, 0)->_path = gpf_vmodel.getParameter<GSLibParFile*>(0)->_path;
-    GSLibParMultiValuedFixed *par6_0_1 = par6->getParameter<GSLibParMultiValuedFixed*>(nReals, 1);
-    par6_0_1->getParameter<GSLibParUInt*>(0)->_value = 1;
-    par6_0_1->getParameter<GSLibParUInt*>(1)->_value = 0;
-    par6_0_1->getParameter<GSLibParOption*>(2)->_selected_value = 1;
-    par6_0_1->getParameter<GSLibParOption*>(3)->_selected_value = 0;
-    par6_0_1->getParameter<GSLibParColor*>(4)->_color_code = 10;
-    //the variogram model curve
-
-
-    //----------------------display plot------------------------------------------------------------
-
-    //Generate the parameter file
-    QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
-    gpf.save( par_file_path );
-
-    //run vargplt program
-    Application::instance()->logInfo("Starting vargplt program...");
-    GSLib::instance()->runProgram( "vargplt", par_file_path );
-
-    //display the plot output
-    DisplayPlotDialog *dpd = new DisplayPlotDialog(gpf.getParameter<GSLibParFile*>(0)->_path,
-                                                   gpf.getParameter<GSLibParString*>(5)->_value,
-                                                   gpf,
-                                                   this);
-    dpd->show();
-
-
+    ed->setWindowTitle( title + " (" + QString::number( checker.getRealizationCount() ) + " realizations)" );
+    ed->show();
 }
 
 void SisimDialog::onSaveEnsemble()
@@ -1230,13 +1092,10 @@ void SisimDialog::onPostsim()
 
 	//if user didn't cancel the dialog
 	if( result == QDialog::Accepted ){
-		//Generate the parameter file
-		QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath( "par" );
-		m_gpf_postsim->save( par_file_path );
-
-		//run postsim program asynchronously
-		Application::instance()->logInfo("Starting postsim program...");
-		GSLib::instance()->runProgram( "postsim", par_file_path );
+		//post-process the realizations, reading them through the realization store of the simulation grid
+		if( ! PostSimulationEngine::runPostsim( m_gpf_postsim, m_cg_simulation,
+		                                        m_gpf_postsim->getParameter<GSLibParFile*>(4)->_path ) )
+			return;
 
 		previewPostsim();
 	}
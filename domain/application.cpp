@@ -1,10 +1,12 @@
 #include "application.h"
 #include "project.h"
 #include "mainwindow.h"
+#include "gslib/gslibparameterfiles/gslibparameterfile.h"
 
 #include <QDir>
 #include <QSettings>
 #include <QMessageBox>
+#include <QThread>
 
 //global instance pointer in the heap.
 Application* Application::_instance = nullptr;
@@ -41,6 +43,8 @@ void Application::closeProject()
         this->_open_project->freeLoadedData(); //TODO: this is unnecessary if a ProjectComponent deletes its children in its destructor
         delete this->_open_project;
         this->_open_project = nullptr;
+        //the parsed templates belong to the closed project's templates directory
+        GSLibParameterFile::clearTemplateRegistry();
     }
 }
 
@@ -91,6 +95,51 @@ void Application::setMaxGridCellCountFor3DVisualizationSetting(int value)
     qs.setValue("maxcellgrid3dview", value);
 }
 
+int Application::getMaxConcurrentGSLibJobsSetting()
+{
+    QSettings qs;
+    bool ok;
+    int setting = qs.value("maxconcurrentgslibjobs").toInt( &ok );
+    if( ! ok || setting < 1 )
+        return qMax( 1, QThread::idealThreadCount() ); //default
+    else
+        return setting;
+}
+
+void Application::setMaxConcurrentGSLibJobsSetting(int value)
+{
+    QSettings qs;
+    qs.setValue("maxconcurrentgslibjobs", value);
+}
+
+bool Application::getUseNativePlotsSetting()
+{
+    QSettings qs;
+    return qs.value("usenativeplots", true).toBool();
+}
+
+void Application::setUseNativePlotsSetting(bool value)
+{
+    QSettings qs;
+    qs.setValue("usenativeplots", value);
+}
+
+int Application::getDataMemoryBudgetSetting()
+{
+    QSettings qs;
+    bool ok;
+    int setting = qs.value("datamemorybudget").toInt( &ok );
+    if( ! ok || setting < 0 )
+        return 0; //default (no limit)
+    return setting;
+}
+
+void Application::setDataMemoryBudgetSetting(int value)
+{
+    QSettings qs;
+    qs.setValue("datamemorybudget", value);
+}
+
 void Application::logInfo(const QString text, bool showMessageBox)
 {
     Q_ASSERT(_mw != 0);
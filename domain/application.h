@@ -87,6 +87,26 @@ public:
     void setMaxGridCellCountFor3DVisualizationSetting(int value);
     //!@}
 
+    //!@{
+    //! Reads and saves the maximum number of GSLib programs the GSLibJobScheduler runs at the same time.
+    int getMaxConcurrentGSLibJobsSetting();
+    void setMaxConcurrentGSLibJobsSetting(int value);
+    //!@}
+
+    //!@{
+    //! Reads and saves whether histograms, crossplots and maps are rendered natively (true) or
+    //! with the GSLib plot programs and Ghostscript (false).
+    bool getUseNativePlotsSetting();
+    void setUseNativePlotsSetting(bool value);
+    //!@}
+
+    //!@{
+    //! Reads and saves the memory budget in MiB for the loaded data files (see DataMemoryManager).
+    //! Zero means no limit.
+    int getDataMemoryBudgetSetting();
+    void setDataMemoryBudgetSetting(int value);
+    //!@}
+
     /**
      * @brief Treats the text as an information text.
      */
@@ -4,6 +4,8 @@
 #include "domain/application.h"
 
 #include <limits>
+#include <map>
+#include <algorithm>
 
 //VTK is used here for its geometry algorithms
 //#include <vtkSmartPointer.h>
@@ -16,43 +18,6 @@
 //#include <vtkCleanPolyData.h>
 //#include <vtkStripper.h>
 
-//-------------------specializations of the getTrajectoryLength() template function---------------//
-namespace FTMMakerAdapters {
-
-    template <>
-    double getTrajectoryLength<SegmentSet>( SegmentSet* dataFile ){
-        double result = 0.0;
-        for( int i = 0; i < dataFile->getDataLineCount(); ++i ){
-            result += dataFile->getSegmentLenght( i ) + dataFile->getDistanceToNextSegment( i );
-        }
-        return result;
-    }
-
-    template <>
-    double getTrajectoryLength<PointSet>( PointSet* dataFile ){
-        double result = 0.0;
-        double lastX, lastY, lastZ;
-        assert( dataFile->getDataLineCount() > 0 && "getTrajectoryLength<PointSet>: no data.  "
-                                                    "Make sure there is a prior call to a data loading method." );
-        dataFile->getDataSpatialLocation( 0, lastX, lastY, lastZ );
-        for( int i = 1; i < dataFile->getDataLineCount(); ++i ){
-            double x, y, z;
-            dataFile->getDataSpatialLocation( i, x, y, z );
-            double dx = x - lastX;
-            double dy = y - lastY;
-            double dz = z - lastZ;
-            result += std::sqrt( dx*dx + dy*dy + dz*dz );
-            lastX = x;
-            lastY = y;
-            lastZ = z;
-        }
-        return result;
-    }
-
-}
-//------------------------------------------------------------------------------------//
-
-
 //-------------------specializations of the getAssociatedCategoryDefinition() template function---------------//
 namespace FTMMakerAdapters {
 
@@ -76,73 +41,176 @@ namespace FTMMakerAdapters {
 //------------------------------------------------------------------------------------//
 
 
-//-------------------specializations of the getValueInTrajectory() template function---------------//
+//-------------------implementation of the TrajectoryIndex class---------------//
+namespace FTMMakerAdapters {
+
+    TrajectoryIndex::TrajectoryIndex( bool recordsArePoints ) :
+        m_recordsArePoints( recordsArePoints ),
+        m_length( 0.0 ),
+        m_isSorted( true )
+    {
+    }
+
+    void TrajectoryIndex::append( double start, double end, double value )
+    {
+        if( ! std::isfinite( start ) || ! std::isfinite( end ) || start > end ||
+            ( ! m_ends.empty() && start < m_ends.back() ) )
+            m_isSorted = false;
+        m_starts.push_back( start );
+        m_ends.push_back( end );
+        m_values.push_back( value );
+    }
+
+    size_t TrajectoryIndex::lowerBound( double distance, size_t &hint ) const
+    {
+        //walk from the previous position, which is close to the next one when traversing the trajectory.
+        size_t i = std::min( hint, m_ends.size() );
+        while( i > 0 && m_ends[i-1] >= distance )
+            --i;
+        while( i < m_ends.size() && m_ends[i] < distance )
+            ++i;
+        hint = i;
+        return i;
+    }
+
+    long TrajectoryIndex::locate( double distance, double tolerance, Cursor &cursor ) const
+    {
+        if( ! m_isSorted )
+            return locateByScan( distance, tolerance );
+        const double lower = distance - tolerance;
+        const double upper = distance + tolerance;
+        const size_t n = m_values.size();
+        if( m_recordsArePoints ){
+            //the first sample not before distance - tolerance, if it is not after distance + tolerance.
+            size_t i = lowerBound( lower, cursor.lower );
+            if( i < n && m_starts[i] <= upper )
+                return i;
+            return -1;
+        }
+        //the first segment containing either distance - tolerance or distance + tolerance.
+        long result = -1;
+        size_t i = lowerBound( lower, cursor.lower );
+        if( i < n && m_starts[i] <= lower )
+            result = i;
+        size_t j = lowerBound( upper, cursor.upper );
+        if( j < n && m_starts[j] <= upper && ( result < 0 || (long)j < result ) )
+            result = j;
+        return result;
+    }
+
+    long TrajectoryIndex::locateByScan( double distance, double tolerance ) const
+    {
+        for( size_t i = 0; i < m_values.size(); ++i ){
+            if( m_recordsArePoints ){
+                if( m_starts[i] >= (distance - tolerance) && m_starts[i] <= (distance + tolerance) )
+                    return i;
+            } else {
+                if(     ((distance - tolerance) <= m_ends[i] && (distance - tolerance) >= m_starts[i])
+                     ||
+                        ((distance + tolerance) <= m_ends[i] && (distance + tolerance) >= m_starts[i]) )
+                    return i;
+            }
+        }
+        return -1;
+    }
+
+    void TrajectoryIndex::countTransitions( double h, double tolerance,
+                                            const std::vector<int> &faciesIndexes, int nFacies,
+                                            std::vector<double> &counts ) const
+    {
+        if( ! ( h > 0.0 ) )
+            return;
+        //the trajectory is traversed from the end, so the search starts there.
+        Cursor cursor;
+        cursor.lower = cursor.upper = m_values.size();
+        bool hasPrevious = false;
+        int previousFaciesIndex = -1;
+        for( double distance = m_length; distance >= 0.0; distance -= h ){
+            long record = locate( distance, tolerance, cursor );
+            if( record < 0 || ! std::isfinite( m_values[ record ] ) )
+                continue;
+            int faciesIndex = faciesIndexes[ record ];
+            //transitions from or to unknown facies codes are not counted.
+            if( hasPrevious && previousFaciesIndex >= 0 && faciesIndex >= 0 )
+                counts[ previousFaciesIndex * nFacies + faciesIndex ] += 1.0;
+            previousFaciesIndex = faciesIndex;
+            hasPrevious = true;
+        }
+    }
+
+    std::vector<int> TrajectoryIndex::getFaciesIndexes( const FaciesTransitionMatrix &ftm ) const
+    {
+        std::vector<int> result( m_values.size(), -1 );
+        //look up each distinct code only once.
+        std::map<int, int> faciesIndexOfCode;
+        int nUnknown = 0;
+        for( size_t i = 0; i < m_values.size(); ++i ){
+            if( ! std::isfinite( m_values[i] ) )
+                continue;
+            int faciesCode = static_cast<int>( m_values[i] );
+            std::map<int, int>::iterator it = faciesIndexOfCode.find( faciesCode );
+            if( it == faciesIndexOfCode.end() )
+                it = faciesIndexOfCode.insert( { faciesCode, ftm.getIndexOfFaciesCode( faciesCode ) } ).first;
+            result[i] = it->second;
+            if( it->second < 0 )
+                ++nUnknown;
+        }
+        if( nUnknown > 0 )
+            Application::instance()->logWarn( "FTMMakerAdapters::TrajectoryIndex::getFaciesIndexes(): " + QString::number( nUnknown ) +
+                                              " value(s) with facies codes not found in the categorical definition." );
+        return result;
+    }
+
+}
+//------------------------------------------------------------------------------------//
+
+//-------------------specializations of the makeTrajectoryIndex() template function---------------//
 namespace FTMMakerAdapters {
 
     template <>
-    double getValueInTrajectory<SegmentSet>( SegmentSet* dataFile, int variableIndex,
-                                             double distance, double tolerance ){
+    TrajectoryIndex makeTrajectoryIndex<SegmentSet>( SegmentSet* dataFile, int variableIndex ){
+        TrajectoryIndex result( false );
         //keep track of distance traversed in the trajectory
         double distanceBeforeCurrentSegment = 0.0;
-        //for each segment
         for( int i = 0; i < dataFile->getDataLineCount(); ++i ){
-            //get segment length
             double segmentLength = dataFile->getSegmentLenght( i );
-            //if queried distance (plus or minus tolerance) falls within the segment
-//            std::cout << "distance = " << distance << "; tolerance = " << tolerance
-//                      << "; distancet = " << distanceBeforeCurrentSegment << "; segL = " << segmentLength << std::endl;
-            if(     ((distance - tolerance) <= distanceBeforeCurrentSegment + segmentLength
-                    &&
-                    (distance - tolerance) >= distanceBeforeCurrentSegment)
-                 ||
-                    ((distance + tolerance) <= distanceBeforeCurrentSegment + segmentLength
-                    &&
-                    (distance + tolerance) >= distanceBeforeCurrentSegment)
-              ){
-                //returns the value assigned to the segment.
-//                std::cout << dataFile->data( i, variableIndex ) << std::endl;
-                return dataFile->data( i, variableIndex );
-            }
-            //keep track of distance traversed
+            result.append( distanceBeforeCurrentSegment,
+                           distanceBeforeCurrentSegment + segmentLength,
+                           dataFile->data( i, variableIndex ) );
             distanceBeforeCurrentSegment += segmentLength + dataFile->getDistanceToNextSegment( i );
         }
+        result.setLength( distanceBeforeCurrentSegment );
         if( dataFile->getDataLineCount() == 0 )
-            Application::instance()->logWarn( "FTMMakerAdapters::getValueInTrajectory<SegmentSet>(): No data.  Did you forget to load the file beforehand?" );
-        return std::numeric_limits<double>::quiet_NaN();
+            Application::instance()->logWarn( "FTMMakerAdapters::makeTrajectoryIndex<SegmentSet>(): No data.  Did you forget to load the file beforehand?" );
+        return result;
     }
 
     template <>
-    double getValueInTrajectory<PointSet>( PointSet* dataFile, int variableIndex,
-                                           double distance, double tolerance ){
-        double lastX = 0.0, lastY = 0.0, lastZ = 0.0;
-        //keep track of distance traversed in the trajectory
+    TrajectoryIndex makeTrajectoryIndex<PointSet>( PointSet* dataFile, int variableIndex ){
+        TrajectoryIndex result( true );
+        if( dataFile->getDataLineCount() == 0 ){
+            Application::instance()->logWarn( "FTMMakerAdapters::makeTrajectoryIndex<PointSet>(): No data.  Did you forget to load the file beforehand?" );
+            return result;
+        }
+        double lastX, lastY, lastZ;
+        //keep track of distance traversed up to current sample.
         double distanceUpToCurrentSample = 0.0;
-        //for each segment
-        for( int i = 0; i < dataFile->getDataLineCount(); ++i ){
-            //keep track of distance traversed up to current sample.
-            if( i > 0 ) {
-                double x, y, z;
-                dataFile->getDataSpatialLocation( i, x, y, z );
-                double dx = x - lastX;
-                double dy = y - lastY;
-                double dz = z - lastZ;
-                distanceUpToCurrentSample += std::sqrt( dx*dx + dy*dy + dz*dz );
-                lastX = x;
-                lastY = y;
-                lastZ = z;
-            } else
-                dataFile->getDataSpatialLocation( 0, lastX, lastY, lastZ );
-            //if current sample falls within the queried distance plus or minus tolerance
-            if( distanceUpToCurrentSample >= (distance - tolerance)
-                &&
-                distanceUpToCurrentSample <= (distance + tolerance) )
-            {
-                return dataFile->data( i, variableIndex );
-            }
+        dataFile->getDataSpatialLocation( 0, lastX, lastY, lastZ );
+        result.append( 0.0, 0.0, dataFile->data( 0, variableIndex ) );
+        for( int i = 1; i < dataFile->getDataLineCount(); ++i ){
+            double x, y, z;
+            dataFile->getDataSpatialLocation( i, x, y, z );
+            double dx = x - lastX;
+            double dy = y - lastY;
+            double dz = z - lastZ;
+            distanceUpToCurrentSample += std::sqrt( dx*dx + dy*dy + dz*dz );
+            lastX = x;
+            lastY = y;
+            lastZ = z;
+            result.append( distanceUpToCurrentSample, distanceUpToCurrentSample, dataFile->data( i, variableIndex ) );
         }
-        if( dataFile->getDataLineCount() == 0 )
-            Application::instance()->logWarn( "FTMMakerAdapters::getValueInTrajectory<PointSet>(): No data.  Did you forget to load the file beforehand?" );
-        return std::numeric_limits<double>::quiet_NaN();
+        result.setLength( distanceUpToCurrentSample );
+        return result;
     }
 
 }
@@ -188,23 +256,29 @@ namespace FTMMakerAdapters {
             return result;
         }
 
-        //the outer vector is the data set split into several data tables
-        // (may be just one if data is not grouped).
-        std::vector< std::vector< std::vector< double > > > dataGroups;
-        if( groupByVariableIndex != -1 )
-            dataGroups = segmentSet->getDataGroupedBy( groupByVariableIndex );
-        else
-            dataGroups.push_back( segmentSet->getDataTable() ); //just one group: the whole data set.
+        //the data set split into several groups of row indexes sorted to meet the sequence criterion wanted by
+        // the user (may be just one group if data is not grouped).  These are views cached in the segment set,
+        // so no data are copied and the sorting is not repeated in subsequent calls.
+        std::vector< DataFileRowIndexRange > dataGroups;
+        if( groupByVariableIndex != -1 ) {
+            const DataFileGroupsView& groupsView = segmentSet->getRowIndexesGroupedBy( groupByVariableIndex,
+                                                                                       sortByColumnIndex,
+                                                                                       ascendingOrDescending );
+            for( size_t iGroup = 0; iGroup < groupsView.getGroupCount(); ++iGroup )
+                dataGroups.push_back( groupsView.getGroup( iGroup ) );
+        } else {
+            //just one group: the whole data set.
+            const std::vector< uint >& sortedRowIndexes = segmentSet->getRowIndexesSortedBy( sortByColumnIndex,
+                                                                                             ascendingOrDescending );
+            dataGroups.push_back( { sortedRowIndexes.data(), sortedRowIndexes.data() + sortedRowIndexes.size() } );
+        }
 
         Application::instance()->logInfo("FTMMakerAdapters::getFaciesSequence<SegmentSet>(): Number of data groups: " + QString::number( dataGroups.size() ));
 
         //for each data group (may be just one if the user opted to not group data (e.g. by drill hole id)).
-        for( std::vector< std::vector< double > >& dataGroup : dataGroups ){
+        for( const DataFileRowIndexRange& dataGroup : dataGroups ){
             std::vector< int > faciesSequence;
 
-            //Sort the data group to meet the sequence criterion wanted by the user.
-            Util::sortDataFrame( dataGroup, sortByColumnIndex, ascendingOrDescending );
-
 
             double previousHeadX = std::numeric_limits<double>::quiet_NaN();
             double previousHeadY = std::numeric_limits<double>::quiet_NaN();
@@ -214,7 +288,8 @@ namespace FTMMakerAdapters {
             double previousTailZ = std::numeric_limits<double>::quiet_NaN();
 
             //for each segment in the group
-            for( const std::vector< double >& segmentData : dataGroup ){
+            for( uint segmentIndex : dataGroup ){
+                const std::vector< double >& segmentData = segmentSet->getDataRow( segmentIndex );
 
                 // get segment geometry
                 double currentHeadX = segmentData[ segmentSet->getXindex()-1 ];
@@ -4,6 +4,7 @@
 #include "domain/faciestransitionmatrix.h"
 #include "domain/categorydefinition.h"
 #include <cassert>
+#include <vector>
 
 /// Defines how a data set is trasversed so the resulting facies string has some spatial characteristic.
 enum class DataSetOrderForFaciesString : uint {
@@ -16,16 +17,77 @@ enum class DataSetOrderForFaciesString : uint {
  *  object types other than those already implemented.*/
 namespace FTMMakerAdapters {
 
-    /** Returns the total length of the trajectory. */
-    template <typename Klass> double getTrajectoryLength( Klass* dataFile );
-
-    /** Returns the value at given distance in trajectory.  Zero corresponds to the
-     * beginning of the trajectory and the distance equalling getTrajectoryLength() corresponds
-     * to the end of the trajectory.  Negative distances, distances beyond getTrajectoryLength() or
-     * distances falling on gaps will cause this function to return std::numeric_limits::quiet_NaN().
+    /**
+     * Positions of the data of a file along its trajectory, so values can be sampled at any distance without
+     * rescanning the data.  Zero corresponds to the beginning of the trajectory and getLength() to its end.
+     * The distance of a sample is the length of the polyline through the previous samples and the distance of
+     * a segment accounts for the segment lengths and the gaps between segments.  Make one with makeTrajectoryIndex().  A TrajectoryIndex does not refer to the file, so it can be
+     * used concurrently after the file is unloaded.
      */
-    template <typename Klass> double getValueInTrajectory( Klass* dataFile, int variableIndex,
-                                                           double distance, double tolerance );
+    class TrajectoryIndex {
+    public:
+        /** Remembers the last position found to speed up sequences of queries with monotonically varying distances. */
+        struct Cursor {
+            size_t lower = 0;
+            size_t upper = 0;
+        };
+
+        /** @param recordsArePoints If true, the records have no length (e.g. point set samples).
+         *  Otherwise they are intervals (e.g. segment set segments). */
+        explicit TrajectoryIndex( bool recordsArePoints );
+
+        /** Appends a record located between the given distances (equal for points) along the trajectory.
+         * Records must be appended in trajectory order. */
+        void append( double start, double end, double value );
+
+        void setLength( double length ) { m_length = length; }
+        double getLength() const { return m_length; }
+        size_t getRecordCount() const { return m_values.size(); }
+        double getValue( size_t record ) const { return m_values[ record ]; }
+
+        /**
+         * Returns the record at the given distance in the trajectory within the tolerance or -1 if there is none
+         * (e.g. the distance falls on a gap).  A sample is found if it is within the tolerance of the distance and
+         * a segment is found if it contains either the distance minus or the distance plus the tolerance.
+         * The cost is amortized constant if the distances of successive calls with the same cursor vary monotonically.
+         */
+        long locate( double distance, double tolerance, Cursor& cursor ) const;
+
+        /**
+         * Counts facies transitions at separation h from the end to the beginning of the trajectory as
+         * FaciesTransitionMatrixMaker::makeAlongTrajectory() does.
+         * @param faciesIndexes The row/column of the FTM corresponding to the value of each record (see
+         *        FaciesTransitionMatrix::getIndexOfFaciesCode()), -1 for unknown facies codes.
+         * @param counts The counts are added to this row-major matrix of nFacies x nFacies elements.
+         * This method only reads this object, so it can be called concurrently.
+         */
+        void countTransitions( double h, double tolerance,
+                               const std::vector<int>& faciesIndexes, int nFacies,
+                               std::vector<double>& counts ) const;
+
+        /** Returns the FTM row/column of the value of each record (-1 for unknown facies codes or non-finite values).
+         * A warning is issued if there are unknown facies codes. */
+        std::vector<int> getFaciesIndexes( const FaciesTransitionMatrix& ftm ) const;
+
+    private:
+        bool m_recordsArePoints;
+        std::vector<double> m_starts;
+        std::vector<double> m_ends;
+        std::vector<double> m_values;
+        double m_length;
+        /** Whether the records are sorted and disjoint (false if there are non-finite coordinates),
+         * which is required to search them with cursors. */
+        bool m_isSorted;
+
+        /** Returns the first record whose end is not before the given distance. */
+        size_t lowerBound( double distance, size_t& hint ) const;
+
+        /** Same as locate(), but scanning all records (for unsorted records). */
+        long locateByScan( double distance, double tolerance ) const;
+    };
+
+    /** Makes a TrajectoryIndex with the values of the given variable.  The data must be loaded beforehand. */
+    template <typename Klass> TrajectoryIndex makeTrajectoryIndex( Klass* dataFile, int variableIndex );
 
     /** Returns the CategoryDefinition object associated with the given variable.
      * If the variable is not categorical, it returns nullptr.
@@ -81,30 +143,7 @@ public:
      *                  located in points (zero size).
      */
     FaciesTransitionMatrix makeAlongTrajectory( double h, double tolerance ){
-        //retrieve category definition
-        CategoryDefinition* cd = FTMMakerAdapters::getAssociatedCategoryDefinition( m_dataFileWithFacies, m_variableIndex );
-        assert( cd && "FaciesTransitionMatrixMaker::makeAlongTrajectory(): null CategoryDefinition." );
-        //create an empty FTM
-        FaciesTransitionMatrix ftm("");
-        ftm.setInfo( cd->getName() );
-        ftm.initialize();
-        //traverse trajectory in steps of size h counting facies transitions
-        //from end (early in geologic time) to begining (late in geologic time).
-        double trajectoryLength = FTMMakerAdapters::getTrajectoryLength( m_dataFileWithFacies );
-        int previousFaciesCode = -9999; //hopefully no one uses -9999 as code.
-        for( double distance = trajectoryLength; distance >= 0.0; distance -= h ){
-            int faciesCode = -9998;
-            double readValue = FTMMakerAdapters::getValueInTrajectory
-                               ( m_dataFileWithFacies, m_variableIndex, distance, tolerance );
-            if( std::isfinite( readValue ) ){
-                faciesCode = static_cast<int>( readValue );
-                if( /*faciesCode != previousFaciesCode &&*/ previousFaciesCode != -9999 ){
-                    ftm.incrementCount( previousFaciesCode, faciesCode );
-                }
-                previousFaciesCode = faciesCode;
-            }
-        }
-        return ftm;
+        return makeAlongTrajectoryWithTolerances( { h }, { tolerance } ).front();
     }
 
     /**
@@ -159,6 +198,36 @@ private:
     Klass* m_dataFileWithFacies;
     int m_variableIndex;
     int m_groupByColumn;
+
+    std::vector<FaciesTransitionMatrix> makeAlongTrajectoryWithTolerances( const std::vector<double>& separations,
+                                                                           const std::vector<double>& tolerances ){
+        //retrieve category definition
+        CategoryDefinition* cd = FTMMakerAdapters::getAssociatedCategoryDefinition( m_dataFileWithFacies, m_variableIndex );
+        assert( cd && "FaciesTransitionMatrixMaker::makeAlongTrajectory(): null CategoryDefinition." );
+        //create an empty FTM
+        FaciesTransitionMatrix emptyFTM("");
+        emptyFTM.setInfo( cd->getName() );
+        emptyFTM.initialize();
+        //locate the data along the trajectory and their facies in the FTM only once for all separations
+        FTMMakerAdapters::TrajectoryIndex trajectory =
+                FTMMakerAdapters::makeTrajectoryIndex( m_dataFileWithFacies, m_variableIndex );
+        std::vector<int> faciesIndexes = trajectory.getFaciesIndexes( emptyFTM );
+        int nFacies = emptyFTM.getRowCount();
+        std::vector<FaciesTransitionMatrix> result;
+        for( size_t iSeparation = 0; iSeparation < separations.size(); ++iSeparation ){
+            //traverse trajectory in steps of size h counting facies transitions
+            //from end (early in geologic time) to begining (late in geologic time).
+            std::vector<double> counts( nFacies * nFacies, 0.0 );
+            trajectory.countTransitions( separations[iSeparation], tolerances[iSeparation],
+                                         faciesIndexes, nFacies, counts );
+            FaciesTransitionMatrix ftm = emptyFTM;
+            for( int i = 0; i < nFacies; ++i )
+                for( int j = 0; j < nFacies; ++j )
+                    ftm.addCount( i, j, counts[ i * nFacies + j ] );
+            result.push_back( ftm );
+        }
+        return result;
+    }
 };
 
 #endif // FACIESTRANSITIONMATRIXMAKER_H
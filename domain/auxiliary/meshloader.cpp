@@ -1,109 +1,401 @@
 #include "meshloader.h"
 
 #include <QFileInfo>
-#include <QTextStream>
+
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <thread>
 
 #include "util.h"
 #include "../application.h"
 
+/*static*/ const char MeshLoader::BINARY_MESH_MAGIC[16] = "GAMMARAYMESHBIN";
+
+static_assert( sizeof( GeoGridMeshFileHeader ) == 64, "GeoGridMeshFileHeader must be 64 bytes long." );
+
+//=================================== ASCII parsing functions ============================================
+namespace {
+
+/** Returns whether a character can be part of a number in a mesh file (same criterion of Util::fastSplit()). */
+inline bool isNumberChar( char c ){
+    return ( c >= '0' && c <= '9' ) || c == '-' || c == '+' || c == '.' || c == 'E' || c == 'e';
+}
+
+/** Returns the position of the line break ending the line that starts at p (or end if it is the last line). */
+inline const char* findLineEnd( const char* p, const char* end ){
+    const char* lineEnd = static_cast<const char*>( std::memchr( p, '\n', end - p ) );
+    return lineEnd ? lineEnd : end;
+}
+
+/** Returns whether the line has only white space (e.g. a trailing empty line). */
+inline bool isBlankLine( const char* p, const char* lineEnd ){
+    for( ; p < lineEnd; ++p )
+        if( ! std::isspace( static_cast<unsigned char>( *p ) ) )
+            return false;
+    return true;
+}
+
+/** Returns whether the line starts with the given text, ignoring case. */
+bool lineStartsWith( const char* p, const char* lineEnd, const char* text ){
+    for( ; *text; ++p, ++text )
+        if( p == lineEnd || std::toupper( static_cast<unsigned char>( *p ) ) != *text )
+            return false;
+    return true;
+}
+
+/**
+ * Parses the number starting at p and advances p past it.  This is much faster than QString::toDouble()
+ * and, unlike std::strtod(), does not depend on the locale set for the program (the mesh files always
+ * use dot as decimal separator).  The result has the precision of the ASCII mesh files (12 significant digits).
+ * @param ok Set to false if the characters do not form a valid number.  Left untouched otherwise.
+ */
+double parseNumber( const char*& p, const char* end, bool& ok ){
+    bool isNegative = false;
+    if( p < end && ( *p == '-' || *p == '+' ) ){
+        isNegative = ( *p == '-' );
+        ++p;
+    }
+    //digits that do not fit in the 64-bit mantissa are not significant for a double anyway.
+    const quint64 MANTISSA_LIMIT = 100000000000000000ULL;
+    quint64 mantissa = 0;
+    int exponent = 0;
+    int nDigits = 0;
+    for( ; p < end && *p >= '0' && *p <= '9'; ++p, ++nDigits ){
+        if( mantissa < MANTISSA_LIMIT )
+            mantissa = mantissa * 10 + ( *p - '0' );
+        else
+            ++exponent;
+    }
+    if( p < end && *p == '.' ){
+        ++p;
+        for( ; p < end && *p >= '0' && *p <= '9'; ++p, ++nDigits ){
+            if( mantissa < MANTISSA_LIMIT ){
+                mantissa = mantissa * 10 + ( *p - '0' );
+                --exponent;
+            }
+        }
+    }
+    if( nDigits == 0 )
+        ok = false;
+    if( p < end && ( *p == 'e' || *p == 'E' ) ){
+        ++p;
+        bool isExponentNegative = false;
+        if( p < end && ( *p == '-' || *p == '+' ) ){
+            isExponentNegative = ( *p == '-' );
+            ++p;
+        }
+        int explicitExponent = 0;
+        int nExponentDigits = 0;
+        for( ; p < end && *p >= '0' && *p <= '9'; ++p, ++nExponentDigits )
+            if( explicitExponent < 10000 )
+                explicitExponent = explicitExponent * 10 + ( *p - '0' );
+        if( nExponentDigits == 0 )
+            ok = false;
+        exponent += isExponentNegative ? -explicitExponent : explicitExponent;
+    }
+    //garbage like "1.2.3" or "1-2"
+    if( p < end && isNumberChar( *p ) ){
+        ok = false;
+        while( p < end && isNumberChar( *p ) )
+            ++p;
+    }
+    double value = static_cast<double>( mantissa );
+    if( exponent < 0 )
+        value /= std::pow( 10.0, -exponent );
+    else if( exponent > 0 )
+        value *= std::pow( 10.0, exponent );
+    return isNegative ? -value : value;
+}
+
+/** Parses the numbers in a line.  Any non-number characters are separators.
+ * @return The count of numbers in the line, which may be greater than maxValues (the excess is not stored). */
+int parseLine( const char* p, const char* lineEnd, double* values, int maxValues, bool& ok ){
+    int count = 0;
+    while( p < lineEnd ){
+        if( ! isNumberChar( *p ) ){
+            ++p;
+            continue;
+        }
+        double value = parseNumber( p, lineEnd, ok );
+        if( count < maxValues )
+            values[count] = value;
+        ++count;
+    }
+    return count;
+}
 
-MeshLoader::MeshLoader(QFile & file, std::vector<VertexRecordPtr> & vertexes,
-					   std::vector<CellDefRecordPtr> & cellDefs,
+/** Returns the limits of nChunks chunks of text of about the same size, each beginning at the start of a line. */
+std::vector< const char* > splitAtLineBreaks( const char* begin, const char* end, unsigned int nChunks ){
+    std::vector< const char* > limits( nChunks + 1, end );
+    limits[0] = begin;
+    for( unsigned int i = 1; i < nChunks; ++i ){
+        const char* p = std::max( limits[i-1], begin + ( end - begin ) / nChunks * i );
+        //the chunk boundary is moved to the start of the next line.
+        if( p > begin && p < end && *(p-1) != '\n' ){
+            p = findLineEnd( p, end );
+            if( p < end )
+                ++p;
+        }
+        limits[i] = p;
+    }
+    return limits;
+}
+
+/** The code for multithreaded counting of the (non-blank) lines in a chunk of text. */
+void taskCountLines( const char* begin, const char* end,
+                     qint64& count //-->output parameter
+                     ){
+    count = 0;
+    for( const char* p = begin; p < end; ){
+        const char* lineEnd = findLineEnd( p, end );
+        if( ! isBlankLine( p, lineEnd ) )
+            ++count;
+        p = lineEnd + 1;
+    }
+}
+
+/** The code for multithreaded parsing of a chunk of the vertex section. */
+void taskParseVertexes( const char* begin, const char* end,
+                        VertexRecord* vertexes, //-->output parameter (must have room for all the vertexes in the chunk)
+                        qint64& nErrors         //-->output parameter
+                        ){
+    nErrors = 0;
+    double values[3];
+    for( const char* p = begin; p < end; ){
+        const char* lineEnd = findLineEnd( p, end );
+        if( ! isBlankLine( p, lineEnd ) ){
+            bool ok = true;
+            if( parseLine( p, lineEnd, values, 3, ok ) != 3 ){
+                ok = false;
+                values[0] = values[1] = values[2] = 0.0;
+            }
+            if( ! ok )
+                ++nErrors;
+            *vertexes++ = VertexRecord{ values[0], values[1], values[2] };
+        }
+        p = lineEnd + 1;
+    }
+}
+
+/** The code for multithreaded parsing of a chunk of the cell definitions section. */
+void taskParseCellDefs( const char* begin, const char* end,
+                        CellDefRecord* cellDefs, //-->output parameter (must have room for all the cells in the chunk)
+                        qint64& nErrors          //-->output parameter
+                        ){
+    nErrors = 0;
+    double values[8];
+    for( const char* p = begin; p < end; ){
+        const char* lineEnd = findLineEnd( p, end );
+        if( ! isBlankLine( p, lineEnd ) ){
+            bool ok = true;
+            if( parseLine( p, lineEnd, values, 8, ok ) != 8 ){
+                ok = false;
+                std::fill( values, values + 8, 0.0 );
+            }
+            CellDefRecord& cellDef = *cellDefs++;
+            for( int i = 0; i < 8; ++i ){
+                cellDef.vId[i] = static_cast<int>( values[i] );
+                if( cellDef.vId[i] != values[i] || values[i] < 0.0 )
+                    ok = false; //vertex ids must be non-negative integers
+            }
+            if( ! ok )
+                ++nErrors;
+        }
+        p = lineEnd + 1;
+    }
+}
+
+/**
+ * Parses a section of the ASCII mesh file with several threads.  Each thread parses the lines of a chunk
+ * of the section directly into the output array.
+ * @return The number of lines with errors.
+ */
+template< typename Record >
+qint64 parseSectionInParallel( const char* begin, const char* end, unsigned int nThreads,
+                               void (*taskParse)( const char*, const char*, Record*, qint64& ),
+                               std::vector< Record >& records //-->output parameter
+                               ){
+    std::vector< const char* > chunkLimits = splitAtLineBreaks( begin, end, nThreads );
+
+    //count the lines in each chunk, so each thread knows where its records go in the output array.
+    std::vector< qint64 > counts( nThreads, 0 );
+    {
+        std::thread threads[nThreads];
+        for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+            threads[iThread] = std::thread( taskCountLines, chunkLimits[iThread], chunkLimits[iThread+1],
+                                            std::ref( counts[iThread] ) );
+        for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+            threads[iThread].join();
+    }
+    qint64 total = 0;
+    for( qint64 count : counts )
+        total += count;
+    records.resize( total );
+
+    //parse the chunks.
+    std::vector< qint64 > nErrors( nThreads, 0 );
+    {
+        std::thread threads[nThreads];
+        qint64 offset = 0;
+        for( unsigned int iThread = 0; iThread < nThreads; ++iThread ){
+            threads[iThread] = std::thread( taskParse, chunkLimits[iThread], chunkLimits[iThread+1],
+                                            records.data() + offset, std::ref( nErrors[iThread] ) );
+            offset += counts[iThread];
+        }
+        for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+            threads[iThread].join();
+    }
+    qint64 totalErrors = 0;
+    for( qint64 n : nErrors )
+        totalErrors += n;
+    return totalErrors;
+}
+
+} //anonymous namespace
+//===========================================================================================================
+
+MeshLoader::MeshLoader(QFile & file, std::vector<VertexRecord> & vertexes,
+					   std::vector<CellDefRecord> & cellDefs,
 					   uint & data_line_count, QObject * parent) :
 	QObject(parent),
 	_file(file),
 	m_vertexes( vertexes ),
 	m_cellDefs( cellDefs ),
 	_data_line_count(data_line_count),
-	_finished(false)
+	_finished(false),
+	m_wasASCII(false)
 {
 
 }
 
 void MeshLoader::doLoad()
 {
-	QTextStream in(&_file);
-	long bytesReadSofar = 0;
-	QStringList valuesAsString;
-
-	bool isInVertexesSection = false;
-
-	bool isInCellDefsSection = false;
-
-	for (int i = 0; !in.atEnd(); ++i)
-	{
-	   //read file line by line
-	   QString line = in.readLine();
-
-	   //Clear the list with the tokenized data values as string
-	   valuesAsString.clear();
-
-	   //updates the progress
-	   bytesReadSofar += line.size() + 1; //account for line break char (in Windows may have 2, though.)
-
-	   if( ! ( i % 100 ) ){ //update progress for each 100 lines to not impact performance much
-		   // allows tracking progress of a file up to about 400GB
-		   emit progress( (int)(bytesReadSofar / 100) );
-	   }
-
-	   if( i == 0 || i == 1 ){} //first and second lines are ignored
-	   else { //parse lines containing data (must be within the target interval)
-
-		   if( !isInVertexesSection && !isInCellDefsSection &&
-			   line.startsWith( "VERTEX LOCATIONS", Qt::CaseInsensitive ) ){
-			   isInVertexesSection = true;
-			   continue; //move on to the next file line
-		   }
-
-		   if( isInVertexesSection && !isInCellDefsSection &&
-			   line.startsWith( "CELL VERTEX INDEXES", Qt::CaseInsensitive ) ){
-			   isInVertexesSection = false;
-			   isInCellDefsSection = true;
-			   continue; //move on to the next file line
-		   }
-
-		   //read line from the GSLib data file
-		   Util::fastSplit( line, valuesAsString );
-
-		   if( isInVertexesSection ){
-			   if( valuesAsString.size() != 3 ){
-				   Application::instance()->logError( QString("MeshLoader::doLoad(): vertex coordinate count different from 3 in line ").append(QString::number(i)) );
-				   m_vertexes.push_back( VertexRecordPtr( new VertexRecord{ 0.0, 0.0, 0.0 } ) );
-			   } else {
-				   bool ok[] = {true, true, true};
-				   double x = valuesAsString[0].toDouble( &ok[0] );
-				   double y = valuesAsString[1].toDouble( &ok[1] );
-				   double z = valuesAsString[2].toDouble( &ok[2] );
-				   if( !ok[0] || !ok[1] || !ok[2] )
-					   Application::instance()->logError( QString("MeshLoader::doLoad(): error in vertex section of mesh file (line ").
-														  append(QString::number(i)).append("): could not convert a value to double.") );
-				   m_vertexes.push_back( VertexRecordPtr( new VertexRecord{ x, y, z } ) ) ;
-			   }
-		   } else if( isInCellDefsSection ) {
-			   if( valuesAsString.size() != 8 ){
-				   Application::instance()->logError( QString("MeshLoader::doLoad(): vertex id count in cell definition different from 8 in line ").append(QString::number(i)) );
-				   m_cellDefs.push_back( CellDefRecordPtr( new CellDefRecord{ {0, 0, 0, 0, 0, 0, 0, 0} } ) );
-			   } else {
-				   bool ok[] = {true, true, true, true, true, true, true, true};
-				   int vId[8];
-				   vId[0] = valuesAsString[0].toInt( &ok[0] );
-				   vId[1] = valuesAsString[1].toInt( &ok[1] );
-				   vId[2] = valuesAsString[2].toInt( &ok[2] );
-				   vId[3] = valuesAsString[3].toInt( &ok[3] );
-				   vId[4] = valuesAsString[4].toInt( &ok[4] );
-				   vId[5] = valuesAsString[5].toInt( &ok[5] );
-				   vId[6] = valuesAsString[6].toInt( &ok[6] );
-				   vId[7] = valuesAsString[7].toInt( &ok[7] );
-				   if( !ok[0] || !ok[1] || !ok[2] || !ok[3] || !ok[4] || !ok[5] || !ok[6] || !ok[7] )
-					   Application::instance()->logError( QString("MeshLoader::doLoad(): error in cell definition section of mesh file (line ").
-														  append(QString::number(i)).append("): could not convert a value to unsigned integer.") );
-				   m_cellDefs.push_back( CellDefRecordPtr( new CellDefRecord{ { vId[0], vId[1], vId[2], vId[3], vId[4], vId[5], vId[6], vId[7] } } ) );
-			   }
-		   }
-
-		   ++_data_line_count;
-	   }
-	}
+	if( ! loadBinary() )
+		loadASCII();
+
+	_data_line_count = m_vertexes.size() + m_cellDefs.size();
+
+	// allows tracking progress of a file up to about 400GB
+	emit progress( (int)( _file.size() / 100 ) );
 
 	_finished = true;
 }
+
+bool MeshLoader::isBinaryMeshFile(const QString &path)
+{
+	QFile file( path );
+	if( ! file.open( QFile::ReadOnly ) )
+		return false;
+	char magic[ sizeof( BINARY_MESH_MAGIC ) ];
+	return file.read( magic, sizeof( magic ) ) == sizeof( magic ) &&
+		   std::memcmp( magic, BINARY_MESH_MAGIC, sizeof( BINARY_MESH_MAGIC ) ) == 0;
+}
+
+bool MeshLoader::loadBinary()
+{
+	//read and check the header
+	GeoGridMeshFileHeader header;
+	_file.seek( 0 );
+	if( _file.read( reinterpret_cast<char*>( &header ), sizeof( header ) ) != sizeof( header ) ||
+		std::memcmp( header.magic, BINARY_MESH_MAGIC, sizeof( BINARY_MESH_MAGIC ) ) != 0 )
+		return false; //not a binary mesh file
+
+	if( header.byteOrderMark != BINARY_MESH_BYTE_ORDER_MARK ){
+		Application::instance()->logError( "MeshLoader::loadBinary(): the mesh file was written by a computer with a different"
+										   " byte order.  Mesh not loaded." );
+		return true;
+	}
+	if( header.version > BINARY_MESH_VERSION ){
+		Application::instance()->logError( "MeshLoader::loadBinary(): the mesh file was written by a newer version of " +
+										   QString( APP_NAME ) + " (mesh format version " + QString::number( header.version ) +
+										   ").  Mesh not loaded." );
+		return true;
+	}
+	if( header.vertexRecordSize != sizeof( VertexRecord ) || header.cellDefRecordSize != sizeof( CellDefRecord ) ){
+		Application::instance()->logError( "MeshLoader::loadBinary(): unexpected record sizes in mesh file.  Mesh not loaded." );
+		return true;
+	}
+	qint64 vertexesSize = header.nVertexes * sizeof( VertexRecord );
+	qint64 cellDefsSize = header.nCells * sizeof( CellDefRecord );
+	qint64 expectedFileSize = sizeof( header ) + vertexesSize + cellDefsSize;
+	if( _file.size() < expectedFileSize ){
+		Application::instance()->logError( "MeshLoader::loadBinary(): the mesh file is truncated.  Mesh not loaded." );
+		return true;
+	}
+
+	m_vertexes.resize( header.nVertexes );
+	m_cellDefs.resize( header.nCells );
+
+	//the records are laid out in the file as in memory, so they are copied in bulk from the memory-mapped file.
+	uchar* contents = _file.map( 0, expectedFileSize );
+	if( contents ){
+		std::memcpy( m_vertexes.data(), contents + sizeof( header ), vertexesSize );
+		std::memcpy( m_cellDefs.data(), contents + sizeof( header ) + vertexesSize, cellDefsSize );
+		_file.unmap( contents );
+	} else {
+		//some file systems do not support mapping.
+		if( ! _file.seek( sizeof( header ) ) ||
+			_file.read( reinterpret_cast<char*>( m_vertexes.data() ), vertexesSize ) != vertexesSize ||
+			_file.read( reinterpret_cast<char*>( m_cellDefs.data() ), cellDefsSize ) != cellDefsSize ){
+			Application::instance()->logError( "MeshLoader::loadBinary(): failed to read the mesh file.  Mesh not loaded." );
+			m_vertexes.clear();
+			m_cellDefs.clear();
+			return true;
+		}
+	}
+
+	return true;
+}
+
+void MeshLoader::loadASCII()
+{
+	m_wasASCII = true;
+
+	//read the entire file into memory
+	_file.seek( 0 );
+	QByteArray contents = _file.readAll();
+	const char* begin = contents.constData();
+	const char* end = begin + contents.size();
+
+	// allows tracking progress of a file up to about 400GB
+	emit progress( (int)( contents.size() / 100 / 4 ) );
+
+	//locate the sections (first and second lines are ignored)
+	const char* vertexesBegin = nullptr;
+	const char* vertexesEnd = nullptr;
+	const char* cellDefsBegin = nullptr;
+	const char* p = begin;
+	for( int i = 0; p < end && ! cellDefsBegin; ++i ){
+		const char* lineEnd = findLineEnd( p, end );
+		const char* nextLine = std::min( lineEnd + 1, end );
+		if( i > 1 ){
+			if( ! vertexesBegin && lineStartsWith( p, lineEnd, "VERTEX LOCATIONS" ) )
+				vertexesBegin = nextLine;
+			else if( vertexesBegin && lineStartsWith( p, lineEnd, "CELL VERTEX INDEXES" ) ){
+				vertexesEnd = p;
+				cellDefsBegin = nextLine;
+			}
+		}
+		p = nextLine;
+	}
+	if( ! vertexesBegin || ! cellDefsBegin ){
+		Application::instance()->logError( "MeshLoader::loadASCII(): VERTEX LOCATIONS and/or CELL VERTEX INDEXES sections"
+										   " not found in mesh file.  Mesh not loaded." );
+		return;
+	}
+
+	unsigned int nThreads = std::max( 1U, std::thread::hardware_concurrency() );
+
+	qint64 nErrors = parseSectionInParallel( vertexesBegin, vertexesEnd, nThreads, taskParseVertexes, m_vertexes );
+	if( nErrors )
+		Application::instance()->logError( "MeshLoader::loadASCII(): " + QString::number( nErrors ) + " line(s) in vertex section "
+										   "of mesh file without exactly three valid coordinates.  They were loaded as (0,0,0)." );
+
+	emit progress( (int)( contents.size() / 100 / 2 ) );
+
+	nErrors = parseSectionInParallel( cellDefsBegin, end, nThreads, taskParseCellDefs, m_cellDefs );
+	if( nErrors )
+		Application::instance()->logError( "MeshLoader::loadASCII(): " + QString::number( nErrors ) + " line(s) in cell definition "
+										   "section of mesh file without exactly eight valid vertex ids." );
+}
@@ -5,8 +5,30 @@
 #include <QFile>
 #include "../geogrid.h"
 
+/**
+ * The header of the binary GeoGrid mesh file.  It is followed by the array of VertexRecords and then
+ * by the array of CellDefRecords exactly as they are laid out in memory, so the file can be memory-mapped
+ * and the arrays copied in one go.  The values are stored in the byte order of the machine that wrote
+ * the file, which is detected with the byteOrderMark field.
+ */
+struct GeoGridMeshFileHeader {
+    char    magic[16];          //!< Always MeshLoader::BINARY_MESH_MAGIC.
+    quint32 version;            //!< Version of the binary format (see MeshLoader::BINARY_MESH_VERSION).
+    quint32 byteOrderMark;      //!< Always MeshLoader::BINARY_MESH_BYTE_ORDER_MARK as written by the machine.
+    quint64 nVertexes;          //!< Number of elements in the vertex array.
+    quint64 nCells;             //!< Number of elements in the cell definition array.
+    quint32 vertexRecordSize;   //!< sizeof(VertexRecord) when the file was written.
+    quint32 cellDefRecordSize;  //!< sizeof(CellDefRecord) when the file was written.
+    char    reserved[16];       //!< For future use.  Also pads the header to 64 bytes.
+};
+
 /** This is an auxiliary class used in GeoGrid::loadMesh() to enable the progress dialog.
  * The file is read in a separate thread, so the progress bar updates.
+ * Two formats are supported:
+ * 1) The binary format (see GeoGridMeshFileHeader), which is what GeoGrid::saveMesh() writes.
+ *    It is memory-mapped and copied directly to the mesh arrays.
+ * 2) The legacy ASCII format (semicolon-separated values in the VERTEX LOCATIONS and CELL VERTEX INDEXES
+ *    sections), written by older versions of the program.  It is parsed in parallel.
  */
 class MeshLoader : public QObject
 {
@@ -15,24 +37,41 @@ class MeshLoader : public QObject
 
 public:
 	explicit MeshLoader(QFile &file,
-						std::vector< VertexRecordPtr > &vertexes,
-						std::vector< CellDefRecordPtr > &cellDefs,
+						std::vector< VertexRecord > &vertexes,
+						std::vector< CellDefRecord > &cellDefs,
 						uint &data_line_count,
 						QObject *parent = 0);
 
 	bool isFinished(){ return _finished; }
 
+	/** Returns whether the loaded file was in the legacy ASCII format.  Only valid after loading finishes. */
+	bool wasASCII(){ return m_wasASCII; }
+
+	/** Returns whether the file at the given path is a mesh file in the binary format. */
+	static bool isBinaryMeshFile( const QString& path );
+
+	static const char BINARY_MESH_MAGIC[16];
+	static const quint32 BINARY_MESH_VERSION = 1;
+	static const quint32 BINARY_MESH_BYTE_ORDER_MARK = 0x01020304;
+
 public slots:
 	void doLoad( );
 signals:
 	void progress(int);
 
 private:
+	/** Loads a binary mesh file.  Returns false if the file is not in the binary format. */
+	bool loadBinary();
+
+	/** Loads a legacy ASCII mesh file with as many threads as there are logical processors. */
+	void loadASCII();
+
 	QFile &_file;
-	std::vector< VertexRecordPtr > &m_vertexes;
-	std::vector< CellDefRecordPtr > &m_cellDefs;
+	std::vector< VertexRecord > &m_vertexes;
+	std::vector< CellDefRecord > &m_cellDefs;
 	uint &_data_line_count;
 	bool _finished;
+	bool m_wasASCII;
 };
 
 #endif // MESHLOADER_H
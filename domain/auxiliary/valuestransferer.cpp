@@ -7,10 +7,136 @@
 #include "domain/cartesiangrid.h"
 #include "domain/pointset.h"
 #include "domain/section.h"
+#include "util.h"
 
 #include <QProgressDialog>
 #include <QApplication>
 #include <iostream>
+#include <thread>
+#include <cassert>
+#include <cmath>
+
+namespace {
+
+    /** Computes the run-length addresses of the cells of a non-rotated Cartesian grid containing a range of
+     * locations (inclusive).  -1 means the location is outside the grid.  This is the job of a thread in
+     * locateCells().  It receives the grid geometry by value, so it touches no shared object. */
+    void taskLocateCells( double x0, double y0, double z0,
+                          double dx, double dy, double dz,
+                          int nI, int nJ, int nK,
+                          const std::vector<double>* xs,
+                          const std::vector<double>* ys,
+                          const std::vector<double>* zs,
+                          int iFirst, int iLast,
+                          std::vector<int>* cellIndexes ){
+        for( int iRow = iFirst; iRow <= iLast; ++iRow ){
+            double i = std::floor( ( (*xs)[iRow] - x0 ) / dx );
+            double j = std::floor( ( (*ys)[iRow] - y0 ) / dy );
+            double k = 0.0;
+            if( nK > 1 )
+                k = std::floor( ( (*zs)[iRow] - z0 ) / dz );
+            if( i < 0.0 || i >= nI || j < 0.0 || j >= nJ || k < 0.0 || k >= nK )
+                (*cellIndexes)[iRow] = -1;
+            else
+                (*cellIndexes)[iRow] = (int)k * nJ * nI + (int)j * nI + (int)i;
+        }
+    }
+
+    /** Computes the run-length addresses of the cells of a Cartesian grid containing the given locations
+     * (-1 == outside the grid).  Must be called from the GUI thread: the checks that may log messages, the
+     * loading of meshes and the building of cell locators are done here, before any worker thread starts.
+     * Returns false if the grid is not supported (the reason is logged). */
+    bool locateCells( CartesianGrid* cg,
+                      const std::vector<double>& xs,
+                      const std::vector<double>& ys,
+                      const std::vector<double>& zs,
+                      std::vector<int>& cellIndexes ){
+        int nLocations = xs.size();
+        unsigned int nThreads = std::max( 1U, std::min<unsigned int>( std::thread::hardware_concurrency(), std::max( 1, nLocations ) ) );
+
+        //the data store of a GeoGrid: use the GeoGrid's parallel cell locator
+        if( cg->isUVWOfAGeoGrid() ){
+            GeoGrid* gg = dynamic_cast<GeoGrid*>( cg->getParent() );
+            gg->XYZtoCellIndexes( xs, ys, zs, cellIndexes, nThreads );
+            return true;
+        }
+
+        if( ! Util::almostEqual2sComplement( cg->getRot(), 0.0, 1 ) ){
+            Application::instance()->logError( "ValuesTransferer: collocating values of a rotated Cartesian grid is not supported yet." );
+            return false;
+        }
+
+        if( cg->isDataStoreOfaGeologicSection() ){
+            Application::instance()->logError( "ValuesTransferer: collocating values of the Cartesian grid of a geologic section"
+                                               " is not currently supported." );
+            return false;
+        }
+
+        cellIndexes.resize( nLocations );
+        if( nLocations == 0 )
+            return true;
+        std::vector< std::pair< int, int > > ranges = Util::generateSubRanges( 0, nLocations - 1, nThreads );
+        std::thread threads[nThreads];
+        for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+            threads[iThread] = std::thread( taskLocateCells,
+                                            cg->getX0(), cg->getY0(), cg->getZ0(),
+                                            cg->getDX(), cg->getDY(), cg->getDZ(),
+                                            (int)cg->getNX(), (int)cg->getNY(), (int)cg->getNZ(),
+                                            &xs, &ys, &zs,
+                                            ranges[iThread].first,
+                                            ranges[iThread].second,
+                                            &cellIndexes );
+        for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+            threads[iThread].join();
+        return true;
+    }
+
+    /** Fetches the values of a grid variable at the given locations.  The cells are located in parallel
+     * (see locateCells()).  The grid's data must be loaded beforehand.
+     * Returns false if the grid is not supported (the reason is logged). */
+    bool computeValuesAtLocations( CartesianGrid* cgOrig,
+                                   uint atIndex,
+                                   double NDVofDest,
+                                   const std::vector<double>& xs,
+                                   const std::vector<double>& ys,
+                                   const std::vector<double>& zs,
+                                   std::vector<double>& values ){
+        std::vector<int> cellIndexes;
+        if( ! locateCells( cgOrig, xs, ys, zs, cellIndexes ) )
+            return false;
+        //DataFile::isNDV() is slow for intensive use, so the NDV is fetched only once.
+        bool hasNDVofOrig = cgOrig->hasNoDataValue();
+        double NDVofOrig = cgOrig->getNoDataValueAsDouble();
+        int nLocations = xs.size();
+        values.assign( nLocations, NDVofDest );
+        for( int iRow = 0; iRow < nLocations; ++iRow ){
+            if( cellIndexes[iRow] < 0 )
+                continue; //location is outside the origin grid
+            double value = cgOrig->dataConst( cellIndexes[iRow], atIndex );
+            if( std::isfinite( value ) &&
+                ! ( hasNDVofOrig && Util::almostEqual2sComplement( NDVofOrig, value, 1 ) ) )
+                values[iRow] = value;
+        }
+        return true;
+    }
+
+    /** Collects the cell centers of a GeoGrid in scan order, which is spatially coherent and benefits
+     * the cell walks performed by GeoGrid::XYZtoCellIndexes(). */
+    void getCellCenters( GeoGrid* gg,
+                         std::vector<double>& xs,
+                         std::vector<double>& ys,
+                         std::vector<double>& zs ){
+        uint rowCount = gg->getDataLineCount();
+        xs.resize( rowCount );
+        ys.resize( rowCount );
+        zs.resize( rowCount );
+        for( uint iRow = 0; iRow < rowCount; ++iRow ){
+            uint i, j, k;
+            gg->indexToIJK( iRow, i, j, k );
+            gg->IJKtoXYZ( i, j, k, xs[iRow], ys[iRow], zs[iRow] );
+        }
+    }
+}
 
 ValuesTransferer::ValuesTransferer(const QString newAttributeName,
                                    DataFile *dfDestination,
@@ -88,38 +214,25 @@ bool ValuesTransferer::transferFromCGtoGG()
     uint atIndex = m_atOrigin->getAttributeGEOEASgivenIndex()-1;
     double NDVofDest = ggDest->getNoDataValueAsDouble();
 
-    //create a vector to hold the collocated values
-    std::vector< double > collocatedValues;
-    collocatedValues.reserve( rowCount );
-
     //////////////////////////////////
     QProgressDialog progressDialog;
     progressDialog.show();
     progressDialog.setLabelText("Transfering collocated values...");
     progressDialog.setMinimum( 0 );
     progressDialog.setValue( 0 );
-    progressDialog.setMaximum( rowCount );
+    progressDialog.setMaximum( 0 );
+    QApplication::processEvents();
     /////////////////////////////////
 
-    int progressUpdateStep = rowCount / 100;
+    //get the locations of the GeoGrid cells (one cell == one data record)
+    std::vector< double > xs, ys, zs;
+    getCellCenters( ggDest, xs, ys, zs );
 
-    //loop over the GeoGrid cells (one cell == one data record)
-    for( int iRow = 0; iRow < rowCount; ++iRow ){
-        uint i, j, k;
-        double x, y, z;
-        ggDest->indexToIJK( iRow, i, j, k );
-        ggDest->IJKtoXYZ( i, j, k, x, y, z );
-        double collocatedValue = cgOrig->valueAt( atIndex, x, y, z );
-        if( std::isfinite( collocatedValue ) && ! cgOrig->isNDV( collocatedValue ) )
-            collocatedValues.push_back( collocatedValue );
-        else
-            collocatedValues.push_back( NDVofDest );
-
-        if( ! ( iRow % progressUpdateStep ) ){
-            progressDialog.setValue( iRow );
-            QApplication::processEvents();
-        }
-    }
+    //locate the origin cells in parallel and fetch the collocated values
+    std::vector< double > collocatedValues;
+    if( ! computeValuesAtLocations( cgOrig, atIndex, NDVofDest, xs, ys, zs, collocatedValues ) )
+        return false;
+    assert( collocatedValues.size() == rowCount && "ValuesTransferer::transferFromCGtoGG(): collocated value count differs from the cell count." );
 
     //if the original variable is categorical, obtain the category definition object
     //so it stays so in the destination data set.
@@ -351,31 +464,42 @@ bool ValuesTransferer::transferFromPStoCG()
     progressDialog.setLabelText("Transfering collocated values...");
     progressDialog.setMinimum( 0 );
     progressDialog.setValue( 0 );
-    progressDialog.setMaximum( dataCount );
+    progressDialog.setMaximum( 0 );
+    QApplication::processEvents();
     /////////////////////////////////
 
-    int progressUpdateStep = dataCount / 100;
-
-    //loop over the point set samples
-    //to transfer values
-    for( int iRow = 0; iRow < dataCount; ++iRow ){
+    //get the locations of the samples
+    std::vector< double > xs( dataCount ), ys( dataCount ), zs( dataCount );
+    for( uint iRow = 0; iRow < dataCount; ++iRow ){
+        int i, j, k; //not used, required by PointSet::getSpatialAndTopologicalCoordinates()
+        psOrig->getSpatialAndTopologicalCoordinates( iRow, xs[iRow], ys[iRow], zs[iRow], i, j, k );
+    }
 
-        //get location of sample
-        double x, y, z;
-        {
-            int i, j, k; //not used, required by PointSet::getSpatialAndTopologicalCoordinates()
-            psOrig->getSpatialAndTopologicalCoordinates( iRow, x, y, z, i, j, k );
+    //get the run-length addresses of the destination grid's collocated cells (-1 == sample outside the grid)
+    std::vector< int > runLengthIndexes;
+    if( cgDest->isUVWOfAGeoGrid() ){
+        //the destination is the data store of a GeoGrid: use its parallel cell locator
+        GeoGrid* ggDest = dynamic_cast<GeoGrid*>( cgDest->getParent() );
+        ggDest->XYZtoCellIndexes( xs, ys, zs, runLengthIndexes, std::thread::hardware_concurrency() );
+    } else {
+        //regular grids compute the cell addresses directly
+        runLengthIndexes.resize( dataCount );
+        for( uint iRow = 0; iRow < dataCount; ++iRow ){
+            uint i, j, k;
+            if( cgDest->XYZtoIJK( xs[iRow], ys[iRow], zs[iRow], i, j, k ) )
+                runLengthIndexes[iRow] = cgDest->IJKtoIndex( i, j, k );
+            else
+                runLengthIndexes[iRow] = -1;
         }
+    }
 
-        //get the run-length address of the destination grid's collocated cell
-        int runLengthIndex = -1;
-        {
-            uint i, j, k; //not used, required by PointSet::getSpatialAndTopologicalCoordinates()
-            bool isInside = cgDest->XYZtoIJK( x, y, z, i, j, k );
-            if( ! isInside )
-                continue; //abort current iteration if the sample fell outside the grid
-            runLengthIndex = cgDest->IJKtoIndex( i, j, k );
-        }
+    //loop over the point set samples to transfer values.  This is done serially and in sample order
+    //so the last sample in a cell prevails, as before.
+    for( uint iRow = 0; iRow < dataCount; ++iRow ){
+
+        int runLengthIndex = runLengthIndexes[iRow];
+        if( runLengthIndex < 0 )
+            continue; //skip samples that fell outside the grid
 
         //get the sample value
         double collocatedValue = psOrig->dataConst( iRow, atIndex );
@@ -385,12 +509,6 @@ bool ValuesTransferer::transferFromPStoCG()
             valuesForDestCG[ runLengthIndex ] = collocatedValue ;
         else
             valuesForDestCG[ runLengthIndex ] = NDVofDest ;
-
-        //update progress
-        if( progressUpdateStep > 0 && ! ( iRow % progressUpdateStep ) ){
-            progressDialog.setValue( iRow );
-            QApplication::processEvents();
-        }
     }
 
     //if the original variable is categorical, obtain the category definition object
@@ -428,37 +546,35 @@ bool ValuesTransferer::transferFromGGtoGG()
     uint atIndex = m_atOrigin->getAttributeGEOEASgivenIndex()-1;
     double NDVofDest = ggDest->getNoDataValueAsDouble();
 
-    //create a vector to hold the collocated values
-    std::vector< double > collocatedValues;
-    collocatedValues.reserve( rowCount );
-
     //////////////////////////////////
     QProgressDialog progressDialog;
     progressDialog.show();
     progressDialog.setLabelText("Transfering collocated values...");
     progressDialog.setMinimum( 0 );
     progressDialog.setValue( 0 );
-    progressDialog.setMaximum( rowCount );
+    progressDialog.setMaximum( 0 );
+    QApplication::processEvents();
     /////////////////////////////////
 
-    int progressUpdateStep = rowCount / 100;
-
-    //loop over the destination GeoGrid cells (one cell == one data record)
-    for( int iRow = 0; iRow < rowCount; ++iRow ){
-        uint i, j, k;
-        double x, y, z;
-        ggDest->indexToIJK( iRow, i, j, k );
-        ggDest->IJKtoXYZ( i, j, k, x, y, z );
-        double collocatedValue = ggOrig->valueAt( atIndex, x, y, z );
-        if( std::isfinite( collocatedValue ) && ! ggOrig->isNDV( collocatedValue ) )
-            collocatedValues.push_back( collocatedValue );
-        else
-            collocatedValues.push_back( NDVofDest );
-
-        if( progressUpdateStep > 0 && ! ( iRow % progressUpdateStep ) ){
-            progressDialog.setValue( iRow );
-            QApplication::processEvents();
-        }
+    //get the locations of the destination GeoGrid cells (one cell == one data record)
+    std::vector< double > xs, ys, zs;
+    getCellCenters( ggDest, xs, ys, zs );
+
+    //locate the cells of the origin GeoGrid containing the cell centers of the destination GeoGrid in parallel
+    std::vector< int > origCellIndexes;
+    ggOrig->XYZtoCellIndexes( xs, ys, zs, origCellIndexes, std::thread::hardware_concurrency() );
+
+    //fetch the collocated values
+    bool hasNDVofOrig = ggOrig->hasNoDataValue();
+    double NDVofOrig = ggOrig->getNoDataValueAsDouble();
+    std::vector< double > collocatedValues( rowCount, NDVofDest );
+    for( uint iRow = 0; iRow < rowCount; ++iRow ){
+        if( origCellIndexes[iRow] < 0 )
+            continue; //cell center is outside the origin GeoGrid
+        double collocatedValue = ggOrig->dataConst( origCellIndexes[iRow], atIndex );
+        if( std::isfinite( collocatedValue ) &&
+            ! ( hasNDVofOrig && Util::almostEqual2sComplement( NDVofOrig, collocatedValue, 1 ) ) )
+            collocatedValues[iRow] = collocatedValue;
     }
 
     //if the original variable is categorical, obtain the category definition object
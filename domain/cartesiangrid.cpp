@@ -18,10 +18,6 @@
 #include "spectral/spectral.h" //eigen third party library
 
 #include <QFileInfo>
-#include <boost/geometry.hpp>
-#include <boost/geometry/geometries/point_xy.hpp>
-#include <boost/geometry/geometries/polygon.hpp>
-#include <boost/scoped_array.hpp>
 
 CartesianGrid::CartesianGrid( QString path )  : GridFile( path ), IJAbstractCartesianGrid()
 {
@@ -66,7 +62,7 @@ void CartesianGrid::setInfo(double x0, double y0, double z0,
     this->updateChildObjectsCollection();
 }
 
-void CartesianGrid::setInfoFromMetadataFile()
+std::function<void()> CartesianGrid::readMetadataFile()
 {
     QString md_file_path( this->_path );
     QFile md_file( md_file_path.append(".md") );
@@ -137,8 +133,20 @@ void CartesianGrid::setInfoFromMetadataFile()
            }
         }
         md_file.close();
-        this->setInfo( x0, y0, z0, dx, dy, dz, nx, ny, nz, rot, nreal, ndv, nsvar_var_trn, categorical_attributes);
+        //the variable names are read here as well, so the child objects are made without file reads
+        QStringList fieldNames = Util::getFieldNames( this->_path );
+        return [=](){
+            setFieldNamesRead( fieldNames );
+            this->setInfo( x0, y0, z0, dx, dy, dz, nx, ny, nz, rot, nreal, ndv, nsvar_var_trn, categorical_attributes);
+            clearFieldNamesRead();
+        };
     }
+    return [](){};
+}
+
+void CartesianGrid::setInfoFromMetadataFile()
+{
+    readMetadataFile()();
 }
 
 void CartesianGrid::setInfoFromOtherCG(CartesianGrid *other_cg, bool copyCategoricalAttributesList)
@@ -421,80 +429,31 @@ SpatialLocation CartesianGrid::getCenter()
     return result;
 }
 
-void CartesianGrid::equalizeValues(QList<QPointF> &area, double delta_dB, int dataColumn, double dB_reference,
-                                   const QList<QPointF> &secondArea)
-{
-    //some typedefs to shorten code
-    typedef boost::geometry::model::d2::point_xy<double> boostPoint2D;
-    typedef boost::geometry::model::polygon<boostPoint2D> boostPolygon;
-
-    //define a Boost polygon from the area geometry points
-    const std::size_t n = area.size();
-    boost::scoped_array<boostPoint2D> points(new boostPoint2D[n]); //scoped_array frees memory when its scope ends.
-    for(std::size_t i = 0; i < n; ++i)
-        points[i] = boostPoint2D( area[i].x(), area[i].y() );
-    boostPolygon poly;
-    boost::geometry::assign_points( poly, std::make_pair(&points[0], &points[0] + n));
-
-    //define a Boost polygon from the second area (if not empty)
-    boostPolygon secondPoly;
-    if( ! secondArea.empty() ){
-        const std::size_t n = secondArea.size();
-        boost::scoped_array<boostPoint2D> secondPoints(new boostPoint2D[n]); //scoped_array frees memory when its scope ends.
-        for(std::size_t i = 0; i < n; ++i)
-            secondPoints[i] = boostPoint2D( secondArea[i].x(), secondArea[i].y() );
-        boost::geometry::assign_points( secondPoly, std::make_pair(&secondPoints[0], &secondPoints[0] + n));
-    }
-
-    //get the 2D bounding box of the polygon
-    double minX = std::numeric_limits<double>::max();
-    double maxX = std::numeric_limits<double>::lowest();
-    double minY = std::numeric_limits<double>::max();
-    double maxY = std::numeric_limits<double>::lowest();
-    QList<QPointF>::iterator it = area.begin();
-    for( ; it != area.end(); ++it){
-        minX = std::min<double>( minX, (*it).x() );
-        maxX = std::max<double>( maxX, (*it).x() );
-        minY = std::min<double>( minY, (*it).y() );
-        maxY = std::max<double>( maxY, (*it).y() );
-    }
-
-    //scan the grid, testing each cell whether it lies within the area.
-    //TODO: this code assumes no grid rotation and that the grid is 2D.
-    for( uint k = 0; k < getNZ(); ++k ){
-        // z coordinate is ignored in 2D spectrograms
-        for( uint j = 0; j < getNY(); ++j ){
-            double cellCenterY = getY0() + j * getDY();
-            for( uint i = 0; i < getNX(); ++i ){
-                double cellCenterX = getX0() + i * getDX();
-                boostPoint2D p(cellCenterX, cellCenterY);
-                // if the cell center lies within the area
-                // The bounding box test is a faster test to promplty discard cells obviously outside.
-                if(     Util::isWithinBBox( cellCenterX, cellCenterY, minX, minY, maxX, maxY )
-                        &&
-                        boost::geometry::within(p, poly)
-                        &&
-                        ( secondArea.isEmpty() || boost::geometry::within(p, secondPoly) )   ){
-                    // get the grid value as is
-                    double value = dataIJK( dataColumn, i, j, k );
-                    // determine whether the value is negative
-                    bool isNegative = value < 0.0;
-                    // get the absolute value
-                    value = std::abs(value);
-                    // get the absolute value in dB
-                    double value_dB = Util::dB( value, dB_reference, 0.00001);
-                    // apply adjustment in dB
-                    value_dB += delta_dB;
-                    // attenuate/amplify the absolute value
-					value = std::pow( 10.0, value_dB / DECIBEL_SCALE_FACTOR ) * dB_reference;
-                    // add negative sign if the original value was negative
-                    if( isNegative )
-                        value = -value;
-                    // set the amplified/attenuated value to the grid
-                    setDataIJK( dataColumn, i, j, k, value );
-                }
-            }
-        }
+void CartesianGrid::equalizeCells(const std::vector<long> &cells, double delta_dB, int dataColumn, double dB_reference)
+{
+    const long nI = getNI();
+    const long nJ = getNJ();
+    for( long cell : cells ){
+        uint i = cell % nI;
+        uint j = ( cell / nI ) % nJ;
+        uint k = cell / ( nI * nJ );
+        // get the grid value as is
+        double value = dataIJK( dataColumn, i, j, k );
+        // determine whether the value is negative
+        bool isNegative = value < 0.0;
+        // get the absolute value
+        value = std::abs(value);
+        // get the absolute value in dB
+        double value_dB = Util::dB( value, dB_reference, 0.00001);
+        // apply adjustment in dB
+        value_dB += delta_dB;
+        // attenuate/amplify the absolute value
+        value = std::pow( 10.0, value_dB / DECIBEL_SCALE_FACTOR ) * dB_reference;
+        // add negative sign if the original value was negative
+        if( isNegative )
+            value = -value;
+        // set the amplified/attenuated value to the grid
+        setDataIJK( dataColumn, i, j, k, value );
     }
 }
 
@@ -4,6 +4,7 @@
 #include "gridfile.h"
 #include "imagejockey/ijabstractcartesiangrid.h"
 #include <set>
+#include <functional>
 
 class GSLibParGrid;
 class GridCell;
@@ -28,6 +29,10 @@ public:
      #setInfo() with the metadata read from the .md file.*/
     void setInfoFromMetadataFile();
 
+    /** Reads the .md file into plain data without changing this object, so it can be called from a background
+     * thread.  Returns the function that applies the metadata read, which must be called in the GUI thread. */
+    std::function<void()> readMetadataFile();
+
     /** Sets the cartesian grid metadata by copying the values from another grid, specified by
      * the given pointer.
      * @param copyCategoricalAttributesList If false, unlink any categorical variables to category definitions
@@ -179,8 +184,7 @@ public:
     virtual IJAbstractVariable* getVariableByName( QString variableName );
     virtual void getAllVariables(  std::vector<IJAbstractVariable*>& result );
     virtual IJAbstractVariable* getVariableByIndex( int variableIndex );
-    virtual void equalizeValues(QList<QPointF>& area, double delta_dB, int dataColumn, double dB_reference,
-                        const QList<QPointF>& secondArea = QList<QPointF>());
+    virtual void equalizeCells(const std::vector<long>& cells, double delta_dB, int dataColumn, double dB_reference);
     virtual void saveData();
 	virtual spectral::array* createSpectralArray( int nDataColumn );
     virtual spectral::complex_array* createSpectralComplexArray( int variableIndex1,
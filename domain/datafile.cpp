@@ -22,7 +22,12 @@
 #include <cmath>
 #include <iomanip> // std::setprecision
 #include <limits>
+#include <numeric> // std::iota
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <sstream> // std::stringstream
+#include <thread>
 #include "auxiliary/dataloader.h"
 #include "auxiliary/variableremover.h"
 #include "auxiliary/datasaver.h"
@@ -30,6 +35,7 @@
 #include "calculator/icalcproperty.h"
 #include "geogrid.h"
 #include "geometry/boundingbox.h"
+#include "datamemorymanager.h"
 
 /****************************** THE DATASOURCE INTERFACE TO THE ALGORITHM CLASSES
  * ****************************/
@@ -114,11 +120,17 @@ protected:
 
 DataFile::DataFile(QString path)
     : File(path), ICalcPropertyCollection(), _lastModifiedDateTimeLastLoad(), _dataPageFirstLine(0),
-      _dataPageLastLine(std::numeric_limits<long>::max())
+      _dataPageLastLine(std::numeric_limits<long>::max()), _hasLastFilteredRowIndexes(false),
+      _lastFilterGeneration(0), _dataGeneration(0), _hasFieldNamesRead(false), _loadedDataModified(false), _lastAccessTime(0)
 {
     _algorithmDataSourceInterface.reset(new AlgorithmDataSource(*this));
 }
 
+DataFile::~DataFile()
+{
+    DataMemoryManager::instance()->notifyFreed(this);
+}
+
 void DataFile::loadData()
 {
     QFile file(this->_path);
@@ -126,17 +138,14 @@ void DataFile::loadData()
     uint data_line_count = 0;
     QFileInfo info(_path);
 
-    // if loaded data is not empty and was loaded before
-    if (!_data.empty() && !_lastModifiedDateTimeLastLoad.isNull()) {
-        QDateTime currentLastModified = info.lastModified();
-        // if modified datetime didn't change since last call to loadData
-        if (currentLastModified <= _lastModifiedDateTimeLastLoad) {
-            Application::instance()->logInfo(
-                QString("File ")
-                    .append(this->_path)
-                    .append(" already loaded and up to date.  Did nothing."));
-            return; // does nothing
-        }
+    // if loaded data is not empty and modified datetime didn't change since last call to loadData
+    if (isLoadedDataUpToDate()) {
+        markLoadedDataAccessed();
+        Application::instance()->logInfo(
+            QString("File ")
+                .append(this->_path)
+                .append(" already loaded and up to date.  Did nothing."));
+        return; // does nothing
     }
 
     // record the current datetime of file change
@@ -148,6 +157,7 @@ void DataFile::loadData()
     // make sure _data is empty
     _data.clear();
 	std::vector< std::vector<double> >().swap(_data); //clear() may not actually free memory
+    invalidateDataViews();
 
     // data load takes place in another thread, so we can show and update a progress bar
     //////////////////////////////////
@@ -180,6 +190,107 @@ void DataFile::loadData()
 
     file.close();
 
+    checkLoadedDataLineCount(data_line_count);
+
+    // account for the loaded data, which may free other files if the memory budget is exceeded
+    _loadedDataModified = false;
+    DataMemoryManager::instance()->notifyLoaded(this);
+    markLoadedDataAccessed();
+
+    Application::instance()->logInfo("Finished loading data.");
+}
+
+void DataFile::loadData(const std::vector<DataFile *> &dataFiles)
+{
+    std::vector<DataFile *> filesToLoad;
+    for (DataFile *dataFile : dataFiles)
+        if (std::find(filesToLoad.begin(), filesToLoad.end(), dataFile) == filesToLoad.end()
+            && !dataFile->isLoadedDataUpToDate())
+            filesToLoad.push_back(dataFile);
+    if (filesToLoad.empty())
+        return;
+    if (filesToLoad.size() == 1) {
+        filesToLoad[0]->loadData();
+        return;
+    }
+
+    Application::instance()->logInfo(
+        QString("Loading data from ").append(QString::number(filesToLoad.size())).append(" files..."));
+
+    // the files are parsed into these buffers in other threads, so the DataFile objects are
+    // only changed in this thread
+    int nFiles = filesToLoad.size();
+    std::vector<std::vector<std::vector<double> > > loadedData(nFiles);
+    std::vector<uint> dataLineCounts(nFiles, 0);
+    std::vector<QDateTime> lastModifiedDateTimes(nFiles);
+    std::vector<QString> paths(nFiles);
+    std::vector<long> firstLines(nFiles), lastLines(nFiles);
+    for (int i = 0; i < nFiles; ++i) {
+        paths[i] = filesToLoad[i]->_path;
+        lastModifiedDateTimes[i] = QFileInfo(paths[i]).lastModified();
+        firstLines[i] = filesToLoad[i]->_dataPageFirstLine;
+        lastLines[i] = filesToLoad[i]->_dataPageLastLine;
+    }
+
+    std::atomic<int> nFilesLoaded(0);
+    unsigned int nThreads = std::max(1u, std::thread::hardware_concurrency());
+    nThreads = std::min(nThreads, (unsigned int)nFiles);
+    std::vector<std::pair<int, int> > ranges = Util::generateSubRanges(0, nFiles - 1, nThreads);
+    std::vector<std::thread> threads;
+    for (const std::pair<int, int> &range : ranges)
+        threads.push_back(std::thread([&, range]() {
+            for (int i = range.first; i <= range.second; ++i) {
+                QFile file(paths[i]);
+                file.open(QFile::ReadOnly | QFile::Text);
+                DataLoader dl(file, loadedData[i], dataLineCounts[i], firstLines[i], lastLines[i]);
+                dl.doLoad();
+                file.close();
+                ++nFilesLoaded;
+            }
+        }));
+
+    // wait for the data load to finish while updating the progress
+    QProgressDialog progressDialog;
+    progressDialog.show();
+    progressDialog.setLabelText("Loading and parsing " + QString::number(nFiles) + " files...");
+    progressDialog.setMinimum(0);
+    progressDialog.setMaximum(nFiles);
+    while (nFilesLoaded < nFiles) {
+        progressDialog.setValue(nFilesLoaded);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        QCoreApplication::processEvents(); // let Qt repaint widgets
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    for (int i = 0; i < nFiles; ++i) {
+        DataFile *dataFile = filesToLoad[i];
+        dataFile->_data.swap(loadedData[i]);
+        std::vector<std::vector<double> >().swap(loadedData[i]);
+        dataFile->_lastModifiedDateTimeLastLoad = lastModifiedDateTimes[i];
+        dataFile->invalidateDataViews();
+        dataFile->_loadedDataModified = false;
+        dataFile->checkLoadedDataLineCount(dataLineCounts[i]);
+        // the files prefetched together are pinned until all are accounted for, so they do not
+        // free one another
+        DataMemoryManager::instance()->pin(dataFile);
+        DataMemoryManager::instance()->notifyLoaded(dataFile);
+        dataFile->markLoadedDataAccessed();
+    }
+    for (DataFile *dataFile : filesToLoad)
+        DataMemoryManager::instance()->unpin(dataFile);
+
+    Application::instance()->logInfo("Finished loading data.");
+}
+
+bool DataFile::isLoadedDataUpToDate() const
+{
+    return !_data.empty() && !_lastModifiedDateTimeLastLoad.isNull()
+           && QFileInfo(_path).lastModified() <= _lastModifiedDateTimeLastLoad;
+}
+
+void DataFile::checkLoadedDataLineCount(uint data_line_count)
+{
 	// geo- and cartesian grids must have a given number of read lines
 	if (this->getFileType() == "CARTESIANGRID" || this->getFileType() == "GEOGRID" ) {
 		GridFile *gf = (GridFile *)this;
@@ -197,8 +308,6 @@ void DataFile::loadData()
                 true);
         }
     }
-
-    Application::instance()->logInfo("Finished loading data.");
 }
 
 double DataFile::data(uint line, uint column)
@@ -207,6 +316,7 @@ double DataFile::data(uint line, uint column)
     case 0:
         loadData(); // loads the data from disk.
     }
+    markLoadedDataAccessed();
     return (this->_data.at(line)).at(column);
 }
 
@@ -216,6 +326,7 @@ double DataFile::dataConst(uint line, uint column) const
     case 0:
         assert( false && "DataFile::dataConst(): data not loaded.  Make sure you call loadData() prior to fetching data with dataConst()." );
     }
+    markLoadedDataAccessed();
     return (this->_data.at(line)).at(column);
 }
 
@@ -520,6 +631,10 @@ void DataFile::writeToFS()
     currentFile.remove();
     // renames the .new file, effectively replacing the current file.
     outputFile.rename(this->getPath());
+    // the data in memory are now the same as in the file, so they can be freed and reloaded
+    _loadedDataModified = false;
+    DataMemoryManager::instance()->notifyLoaded(this);
+    markLoadedDataAccessed();
     // updates properties list so any changes appear in the project tree.
     updateChildObjectsCollection();
     // update the project tree in the main window.
@@ -569,12 +684,16 @@ void DataFile::updateChildObjectsCollection()
 		CartesianGrid* cgUVW = new CartesianGrid( this->_path );
 		this->_children.push_back( cgUVW );
 		cgUVW->setParent( this );
+		//the UVW grid shares the file, hence the variable names
+		if( _hasFieldNamesRead )
+			cgUVW->setFieldNamesRead( _fieldNamesRead );
 		GeoGrid* thisGeoGridAspect = dynamic_cast<GeoGrid*>( this );
 		cgUVW->setInfoFromGeoGrid( thisGeoGridAspect );
         cgUVW->updateChildObjectsCollection();
+		cgUVW->clearFieldNamesRead();
 	} else {
-		// list fields from data file
-		QStringList fields = Util::getFieldNames(this->_path);
+		// list fields from data file, unless they were read beforehand
+		QStringList fields = _hasFieldNamesRead ? _fieldNamesRead : Util::getFieldNames(this->_path);
 
 		// create children objects (Attributes)
 		for (int i = 0; i < fields.size(); ++i) {
@@ -614,6 +733,18 @@ void DataFile::updateChildObjectsCollection()
     }
 }
 
+void DataFile::setFieldNamesRead(const QStringList &fieldNames)
+{
+    _fieldNamesRead = fieldNames;
+    _hasFieldNamesRead = true;
+}
+
+void DataFile::clearFieldNamesRead()
+{
+    _fieldNamesRead.clear();
+    _hasFieldNamesRead = false;
+}
+
 std::vector< std::vector<double> > DataFile::getDataSortedBy(int variableIndex, SortingOrder sortingOrder) const
 {
     std::vector< std::vector<double> > result;
@@ -628,11 +759,11 @@ std::vector< std::vector<double> > DataFile::getDataSortedBy(int variableIndex,
         return result;
     }
 
-    // Make a duplicate of the original data.
-    result = _data;
-
-    // Sort the data by given column.
-    Util::sortDataFrame( result, variableIndex, sortingOrder );
+    // Make a copy of the original data in the sorted order.
+    const std::vector<uint>& sortedRowIndexes = getRowIndexesSortedBy( variableIndex, sortingOrder );
+    result.reserve( sortedRowIndexes.size() );
+    for( uint rowIndex : sortedRowIndexes )
+        result.push_back( _data[rowIndex] );
 
     return result;
 }
@@ -651,24 +782,18 @@ std::vector< std::vector< std::vector<double> > > DataFile::getDataGroupedBy(int
         return result;
     }
 
-    std::vector< std::vector<double> > orderedData = getDataSortedBy( variableIndex, SortingOrder::ASCENDING );
-
-    double previousGroupByValue = std::numeric_limits<double>::quiet_NaN();
-    std::vector< std::vector<double> > group;
-    for( const std::vector<double>& row : orderedData ){
-        double currentGroupByValue = row[ variableIndex ];
-        if( currentGroupByValue != previousGroupByValue && !group.empty() ){
-            result.push_back( group );
-            group = std::vector< std::vector<double> >();
-        }
-        group.push_back( row );
-        previousGroupByValue = currentGroupByValue;
+    // Make a copy of each group of data rows.
+    const DataFileGroupsView& groupsView = getRowIndexesGroupedBy( variableIndex );
+    result.reserve( groupsView.getGroupCount() );
+    for( size_t iGroup = 0; iGroup < groupsView.getGroupCount(); ++iGroup ){
+        DataFileRowIndexRange groupRowIndexes = groupsView.getGroup( iGroup );
+        std::vector< std::vector<double> > group;
+        group.reserve( groupRowIndexes.size() );
+        for( uint rowIndex : groupRowIndexes )
+            group.push_back( _data[rowIndex] );
+        result.push_back( std::move( group ) );
     }
 
-    //adds the last group
-    if( ! group.empty() )
-        result.push_back( group );
-
     return result;
 }
 
@@ -684,24 +809,123 @@ std::vector<std::vector<double> > DataFile::getDataFilteredBy(int variableIndex,
     if( _data.empty() )
         Application::instance()->logError("DataFile::getDataFilteredBy(): no data to filter.  Perhaps loading data from the filesystem was not performed.");
 
-    for( int i = 0; i < getDataLineCount(); ++i ){
-        double value = dataConst( i, variableIndex );
+    const std::vector<uint>& filteredRowIndexes = getRowIndexesFilteredBy( variableIndex, value0, value1 );
+    result.reserve( filteredRowIndexes.size() );
+    for( uint rowIndex : filteredRowIndexes )
+        result.push_back( _data[rowIndex] );
+
+    if( result.empty() )
+        Application::instance()->logWarn("DataFile::getDataFilteredBy(): filtering resulted in an empty data frame.");
+
+    return result;
+}
+
+const std::vector<uint> &DataFile::getRowIndexesSortedBy(int variableIndex, SortingOrder sortingOrder) const
+{
+    std::pair<uint64_t, std::vector<uint> >& cached = _sortedRowIndexesCache[ { variableIndex, sortingOrder } ];
+    std::vector<uint>& result = cached.second;
+
+    //the cached index was made from the current data: nothing to do.
+    if( cached.first == _dataGeneration && result.size() == _data.size() )
+        return result;
+    cached.first = _dataGeneration;
+
+    result.resize( _data.size() );
+    std::iota( result.begin(), result.end(), 0 );
+
+    //a stable sort keeps the file order of rows with equal values, so the views are reproducible.
+    const std::vector< std::vector<double> >& data = _data;
+    if( sortingOrder == SortingOrder::ASCENDING )
+        std::stable_sort( result.begin(), result.end(), [&data, variableIndex]( uint a, uint b ){
+            return data[a][variableIndex] < data[b][variableIndex];
+        });
+    else
+        std::stable_sort( result.begin(), result.end(), [&data, variableIndex]( uint a, uint b ){
+            return data[a][variableIndex] > data[b][variableIndex];
+        });
+
+    return result;
+}
+
+const DataFileGroupsView &DataFile::getRowIndexesGroupedBy(int groupByVariableIndex,
+                                                           int sortByVariableIndex,
+                                                           SortingOrder sortingOrder) const
+{
+    std::pair<uint64_t, DataFileGroupsView>& cached =
+            _groupsViewsCache[ std::make_tuple( groupByVariableIndex, sortByVariableIndex, sortingOrder ) ];
+    DataFileGroupsView& result = cached.second;
+
+    //the cached view was made from the current data: nothing to do.
+    if( cached.first == _dataGeneration && result.rowIndexes.size() == _data.size() )
+        return result;
+    cached.first = _dataGeneration;
+
+    result.rowIndexes.clear();
+    result.groupOffsets.clear();
+    if( _data.empty() )
+        return result;
+
+    //sort the rows by the within-group criterion first (if any), then by the grouping variable.
+    //The second sort being stable preserves the within-group order of the first.
+    if( sortByVariableIndex >= 0 )
+        result.rowIndexes = getRowIndexesSortedBy( sortByVariableIndex, sortingOrder );
+    else {
+        result.rowIndexes.resize( _data.size() );
+        std::iota( result.rowIndexes.begin(), result.rowIndexes.end(), 0 );
+    }
+    const std::vector< std::vector<double> >& data = _data;
+    std::stable_sort( result.rowIndexes.begin(), result.rowIndexes.end(), [&data, groupByVariableIndex]( uint a, uint b ){
+        return data[a][groupByVariableIndex] < data[b][groupByVariableIndex];
+    });
+
+    //find where each group begins.
+    result.groupOffsets.push_back( 0 );
+    for( size_t i = 1; i < result.rowIndexes.size(); ++i )
+        if( data[ result.rowIndexes[i] ][groupByVariableIndex] != data[ result.rowIndexes[i-1] ][groupByVariableIndex] )
+            result.groupOffsets.push_back( i );
+    result.groupOffsets.push_back( result.rowIndexes.size() );
+
+    return result;
+}
+
+const std::vector<uint> &DataFile::getRowIndexesFilteredBy(int variableIndex, double value0, double value1) const
+{
+    std::tuple<int, double, double> filterCriteria = std::make_tuple( variableIndex, value0, value1 );
+
+    //the last filtering was the same and of the current data: nothing to do.
+    if( _hasLastFilteredRowIndexes && _lastFilterCriteria == filterCriteria && _lastFilterGeneration == _dataGeneration )
+        return _lastFilteredRowIndexes;
+
+    _lastFilteredRowIndexes.clear();
+    for( uint i = 0; i < _data.size(); ++i ){
+        double value = _data[i][variableIndex];
         if( ! isNDV( value ) ){
             if( value >= value0 && value <= value1 ){
-                result.push_back( getDataRow( i ) );
+                _lastFilteredRowIndexes.push_back( i );
             }
         }
     }
+    _lastFilterCriteria = filterCriteria;
+    _lastFilterGeneration = _dataGeneration;
+    _hasLastFilteredRowIndexes = true;
 
-    if( result.empty() )
-        Application::instance()->logWarn("DataFile::getDataFilteredBy(): filtering resulted in an empty data frame.");
+    return _lastFilteredRowIndexes;
+}
 
-    return result;
+void DataFile::invalidateDataViews()
+{
+    ++_dataGeneration;
+    _loadedDataModified = true;
+    _sortedRowIndexesCache.clear();
+    _groupsViewsCache.clear();
+    _lastFilteredRowIndexes.clear();
+    _hasLastFilteredRowIndexes = false;
 }
 
 void DataFile::replaceDataFrame( const std::vector<std::vector<double> > &dataTable )
 {
     _data = dataTable;
+    invalidateDataViews();
 }
 
 bool DataFile::getCenter(double &x, double &y, double &z) const
@@ -1009,6 +1233,22 @@ void DataFile::freeLoadedData() {
 	_data.clear();
 	//clear() does not guarantee memory is actually freed.
 	std::vector< std::vector<double> >().swap( _data );
+    invalidateDataViews();
+    _loadedDataModified = false;
+    DataMemoryManager::instance()->notifyFreed( this );
+}
+
+void DataFile::markLoadedDataAccessed() const
+{
+    _lastAccessTime.store( DataMemoryManager::getClock(), std::memory_order_relaxed );
+}
+
+int64_t DataFile::getLoadedDataSize() const
+{
+    int64_t size = _data.capacity() * sizeof(std::vector<double>);
+    for (const std::vector<double> &row : _data)
+        size += row.capacity() * sizeof(double);
+    return size;
 }
 
 void DataFile::setDataPage(long firstDataLine, long lastDataLine)
@@ -1051,6 +1291,7 @@ void DataFile::addDataColumns(std::vector< std::complex<double> > &columns,
                                               "values to add mismatched number of data "
                                               "rows.");
     }
+    invalidateDataViews();
 
     // get the GEO-EAS index for new attributes
     uint indexGEOEASreal
@@ -1095,6 +1336,7 @@ long DataFile::addEmptyDataColumn(const QString columnName, long numberOfDataEle
                                               "values to add mismatched number of data "
                                               "rows.");
     }
+    invalidateDataViews();
 
     // get the GEO-EAS index for new attribute
     uint indexGEOEAS
@@ -1142,6 +1384,7 @@ int DataFile::addNewDataColumn(const QString columnName,
     // remainder with the default value
     for (; itData != _data.end(); ++itData)
         (*itData).push_back(defaultValue);
+    invalidateDataViews();
 
     // get the GEO-EAS index for new attribute
     uint indexGEOEAS
@@ -1339,6 +1582,7 @@ void DataFile::setData(uint line, uint column, double value)
 		loadData(); // loads the data from disk.
 	}
     this->_data.at(line).at(column) = value;
+    invalidateDataViews();
 }
 
 std::vector<double> DataFile::getDataColumn(uint column)
@@ -1374,4 +1618,5 @@ double DataFile::getProportion(int variableIndex, double value0, double value1)
 void DataFile::removeDataLine(uint line)
 {
 	_data.erase( _data.begin() + line );
+    invalidateDataViews();
 }
@@ -7,8 +7,12 @@
 #include <vector>
 #include <QMap>
 #include <QDateTime>
+#include <QStringList>
 #include <complex>
 #include <memory>
+#include <map>
+#include <tuple>
+#include <atomic>
 
 class Attribute;
 class UnivariateCategoryClassification;
@@ -22,6 +26,38 @@ enum class CartesianCoord : int {
 	Z
 };
 
+/**
+ * A contiguous range of row indexes of a DataFile (e.g. a group of rows in a DataFileGroupsView).
+ * It can be used in range-based for loops.
+ */
+struct DataFileRowIndexRange {
+    const uint* first;
+    const uint* last; //one past the last element
+    const uint* begin() const { return first; }
+    const uint* end() const { return last; }
+    size_t size() const { return last - first; }
+};
+
+/**
+ * A read-only view of the rows of a DataFile split into groups by the value of a variable (e.g. drill hole id).
+ * The view holds only row indexes, which are to be used with DataFile::getDataRow() or DataFile::dataConst(),
+ * so no data are copied.  See DataFile::getRowIndexesGroupedBy().
+ */
+struct DataFileGroupsView {
+    /** The row indexes ordered by group (and by the sorting variable within each group, if one was given). */
+    std::vector<uint> rowIndexes;
+    /** The rows of the i-th group are those in rowIndexes[groupOffsets[i]] to rowIndexes[groupOffsets[i+1]-1].
+     * Thus, this vector has the number of groups plus one elements. */
+    std::vector<size_t> groupOffsets;
+
+    size_t getGroupCount() const { return groupOffsets.empty() ? 0 : groupOffsets.size() - 1; }
+
+    /** Returns the row indexes of the i-th group. */
+    DataFileRowIndexRange getGroup( size_t iGroup ) const {
+        return { rowIndexes.data() + groupOffsets[iGroup], rowIndexes.data() + groupOffsets[iGroup+1] };
+    }
+};
+
 /**
  * @brief The DataFile class is the base class of all project components that are
  *  files with scientific data, namely Point Set and Cartesian Grid.
@@ -32,12 +68,19 @@ class DataFile : public File, public ICalcPropertyCollection
 {
 public:
     DataFile(QString path);
+    virtual ~DataFile();
 
     /**
       *  Loads the tabular data in file into the _data table.
       */
     void loadData();
 
+    /**
+     * Loads the data of several files concurrently, one file per thread, while a progress dialog is shown.
+     * Files whose data are already loaded and up to date are skipped.
+     */
+    static void loadData( const std::vector<DataFile*>& dataFiles );
+
     /**
       *  Returns the data at the given position.
       *  This does not follow GEO_EAS convention, so the first data value, at the first line and first column of the file
@@ -250,6 +293,15 @@ public:
     /** De-allocates the data loaded with loadData(). */
     virtual void freeLoadedData();
 
+    /** Returns the approximate number of bytes taken by the contents loaded in memory (see DataMemoryManager). */
+    virtual int64_t getLoadedDataSize() const;
+
+    /** Returns whether the loaded data were changed in memory since they were last loaded or saved. */
+    bool isLoadedDataModified() const { return _loadedDataModified; }
+
+    /** Returns the time (see DataMemoryManager::getClock()) of the last access to the loaded data. */
+    uint64_t getLastAccessTime() const { return _lastAccessTime.load( std::memory_order_relaxed ); }
+
     /** Sets the data page (first and last data line to load).
      * Setting a page, causes a reload in next calls to data() or loadData().  The interval is inclusive,
      * for example, 0 and 2 causes the first three lines of the data file to be loaded, so pay attention when computing
@@ -374,6 +426,11 @@ public:
      */
     void updateChildObjectsCollection();
 
+    /** Sets the variable names read from the file header beforehand (e.g. in a background thread), which
+     * updateChildObjectsCollection() uses instead of reading the file until clearFieldNamesRead() is called. */
+    void setFieldNamesRead( const QStringList& fieldNames );
+    void clearFieldNamesRead();
+
     /**
      * Returns a new data table sorted (ascending or descending) by the given data column.
      * ATTENTION: calling this for gridded data will modify the location of each data value in space.
@@ -389,6 +446,35 @@ public:
      */
     std::vector< std::vector< std::vector<double> > > getDataGroupedBy( int variableIndex ) const;
 
+    /**
+     * Returns the indexes of the data rows in the order given by the values of a variable.  This is the
+     * copy-free alternative to getDataSortedBy(): the rows can be visited in the sorted order with getDataRow().
+     * The result is computed once and cached in this object until its data change (e.g. reload or setData()).
+     * ATTENTION: the returned reference is only valid until the data change or are freed (e.g. by the
+     * DataMemoryManager): any change discards the cached views.  Copy the view if it must outlive a change.
+     * Also, the caches are not thread-safe.  Get the views before spawning threads that read them.
+     */
+    const std::vector<uint>& getRowIndexesSortedBy( int variableIndex, SortingOrder sortingOrder ) const;
+
+    /**
+     * Returns the indexes of the data rows split into groups by the value of a variable (e.g. drill hole id).
+     * This is the copy-free alternative to getDataGroupedBy().  Optionally, the rows in each group are sorted
+     * by another variable (e.g. by the Z coordinate, to follow the segments down a drill hole).  The result
+     * is cached just like in getRowIndexesSortedBy().
+     * @param sortByVariableIndex The variable to sort the rows within each group by.  Pass -1 to keep
+     *        the rows of each group in file order.
+     */
+    const DataFileGroupsView& getRowIndexesGroupedBy( int groupByVariableIndex,
+                                                      int sortByVariableIndex = -1,
+                                                      SortingOrder sortingOrder = SortingOrder::ASCENDING ) const;
+
+    /**
+     * Returns the indexes of the data rows whose values of the given variable are within the given interval.
+     * This is the copy-free alternative to getDataFilteredBy() (same filtering criteria).  The result of
+     * the last filtering is cached just like in getRowIndexesSortedBy().
+     */
+    const std::vector<uint>& getRowIndexesFilteredBy( int variableIndex, double value0, double value1 ) const;
+
     /** Returns a read-only reference to the internal data table. */
     const std::vector< std::vector<double> >& getDataTable() const { return _data; }
 
@@ -510,6 +596,45 @@ protected:
     /** The pointer to the internal interface to the algorithms' data source (see classes in /algorithms subdirectory). */
     std::shared_ptr<IAlgorithmDataSource> _algorithmDataSourceInterface;
 
+    /** Discards the cached row index views (see getRowIndexesSortedBy() and the like), advances the data
+     * generation they are checked against and marks the data as modified (see isLoadedDataModified()).
+     * This must be called whenever the contents of _data change. */
+    void invalidateDataViews();
+
+    /** Returns whether the loaded data are up to date with respect to the file. */
+    bool isLoadedDataUpToDate() const;
+
+    /** Records an access to the loaded contents for the DataMemoryManager's least recently used policy. */
+    void markLoadedDataAccessed() const;
+
+    /** Warns the user if the number of data lines read differs from that expected from the grid metadata. */
+    void checkLoadedDataLineCount( uint data_line_count );
+
+private:
+    /** Caches of the row index views keyed by the query parameters.  Each view is stored with the
+     *  _dataGeneration it was made from. */
+    mutable std::map< std::pair<int, SortingOrder>, std::pair<uint64_t, std::vector<uint> > > _sortedRowIndexesCache;
+    mutable std::map< std::tuple<int, int, SortingOrder>, std::pair<uint64_t, DataFileGroupsView> > _groupsViewsCache;
+    mutable std::tuple<int, double, double> _lastFilterCriteria;
+    mutable std::vector<uint> _lastFilteredRowIndexes;
+    mutable bool _hasLastFilteredRowIndexes;
+    mutable uint64_t _lastFilterGeneration;
+
+    /** Incremented whenever the contents of _data change (see invalidateDataViews()).  A cached view is only
+     *  used if it was made from the current generation. */
+    uint64_t _dataGeneration;
+
+    /** The variable names set with setFieldNamesRead(). */
+    QStringList _fieldNamesRead;
+    bool _hasFieldNamesRead;
+
+    /** Whether _data were changed since they were last loaded or saved (see invalidateDataViews()). */
+    bool _loadedDataModified;
+
+    /** The DataMemoryManager's clock at the last access to _data.  Atomic because the algorithms read
+     *  the loaded data (see dataConst()) from worker threads. */
+    mutable std::atomic<uint64_t> _lastAccessTime;
+
 };
 
 #endif // DATAFILE_H
@@ -0,0 +1,167 @@
+#include "datamemorymanager.h"
+#include "domain/application.h"
+#include "domain/datafile.h"
+#include "util.h"
+
+#include <QAbstractEventDispatcher>
+#include <QCoreApplication>
+#include <QThread>
+#include <algorithm>
+#include <vector>
+
+std::atomic<uint64_t> DataMemoryManager::s_clock( 0 );
+
+DataMemoryManager *DataMemoryManager::instance()
+{
+    static DataMemoryManager s_instance;
+    return &s_instance;
+}
+
+DataMemoryManager::DataMemoryManager() :
+    m_budget( (int64_t)Application::instance()->getDataMemoryBudgetSetting() * 1024 * 1024 ),
+    m_enforcementPending( false )
+{
+    //aboutToBlock() is emitted in the GUI thread, so the budget is always enforced there
+    QAbstractEventDispatcher* guiDispatcher = QAbstractEventDispatcher::instance( qApp->thread() );
+    if( guiDispatcher )
+        QObject::connect( guiDispatcher, &QAbstractEventDispatcher::aboutToBlock,
+                          qApp, [this](){ onEventLoopIdle(); } );
+}
+
+void DataMemoryManager::setBudget(int64_t bytes)
+{
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_budget = bytes;
+    }
+    m_enforcementPending = true;
+}
+
+int64_t DataMemoryManager::getBudget() const
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    return m_budget;
+}
+
+void DataMemoryManager::notifyLoaded(DataFile *dataFile)
+{
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_usages[ dataFile ] = dataFile->getLoadedDataSize();
+        //the file just loaded is more recent than any access so far
+        ++s_clock;
+    }
+    m_enforcementPending = true;
+}
+
+void DataMemoryManager::notifyFreed(DataFile *dataFile)
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_usages.erase( dataFile );
+}
+
+void DataMemoryManager::pin(DataFile *dataFile)
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    ++m_pinCounts[ dataFile ];
+}
+
+void DataMemoryManager::unpin(DataFile *dataFile)
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    std::map<const DataFile*, int>::iterator it = m_pinCounts.find( dataFile );
+    if( it != m_pinCounts.end() && --it->second <= 0 )
+        m_pinCounts.erase( it );
+}
+
+bool DataMemoryManager::isPinned(const DataFile *dataFile) const
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    return m_pinCounts.find( dataFile ) != m_pinCounts.end();
+}
+
+int64_t DataMemoryManager::getUsage() const
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    int64_t usage = 0;
+    for( const std::pair<const DataFile* const, int64_t>& fileUsage : m_usages )
+        usage += fileUsage.second;
+    return usage;
+}
+
+int64_t DataMemoryManager::getUsage(const DataFile *dataFile) const
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    std::map<const DataFile*, int64_t>::const_iterator it = m_usages.find( dataFile );
+    return it != m_usages.end() ? it->second : 0;
+}
+
+void DataMemoryManager::onEventLoopIdle()
+{
+    //nested loops (e.g. a modal dialog's or a progress dialog's) mean some algorithm may still be using the files
+    if( ! m_enforcementPending || QThread::currentThread()->loopLevel() > 1 )
+        return;
+    m_enforcementPending = false;
+    enforceBudget();
+}
+
+void DataMemoryManager::enforceBudget()
+{
+    std::vector< std::pair<DataFile*, int64_t> > filesToFree;
+    int64_t usage = 0;
+    int64_t budget;
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        budget = m_budget;
+        for( const std::pair<const DataFile* const, int64_t>& fileUsage : m_usages )
+            usage += fileUsage.second;
+        if( budget <= 0 || usage <= budget )
+            return;
+
+        //the files that can be freed, least recently used first
+        std::vector<DataFile*> candidates;
+        for( const std::pair<const DataFile* const, int64_t>& fileUsage : m_usages ){
+            const DataFile* dataFile = fileUsage.first;
+            if( m_pinCounts.find( dataFile ) == m_pinCounts.end() &&
+                ! dataFile->isLoadedDataModified() )
+                candidates.push_back( const_cast<DataFile*>( dataFile ) );
+        }
+        std::sort( candidates.begin(), candidates.end(), []( const DataFile* a, const DataFile* b ){
+            return a->getLastAccessTime() < b->getLastAccessTime();
+        });
+
+        for( DataFile* dataFile : candidates ){
+            if( usage <= budget )
+                break;
+            int64_t fileUsage = m_usages[ dataFile ];
+            filesToFree.push_back( { dataFile, fileUsage } );
+            usage -= fileUsage;
+        }
+    }
+
+    //freeing calls notifyFreed(), so it is done without holding the lock
+    for( const std::pair<DataFile*, int64_t>& fileToFree : filesToFree ){
+        Application::instance()->logInfo( "DataMemoryManager: freeing the loaded data of " +
+                                          fileToFree.first->getName() + " (" +
+                                          Util::humanReadable( fileToFree.second ) + "B) to stay within the budget." );
+        fileToFree.first->freeLoadedData();
+    }
+
+    if( usage > budget )
+        Application::instance()->logWarn( "DataMemoryManager: the loaded data (" + Util::humanReadable( usage ) +
+                                          "B) exceed the budget (" + Util::humanReadable( budget ) +
+                                          "B), but the remaining files are in use or have unsaved changes." );
+}
+
+DataFilePin::DataFilePin(DataFile *dataFile) :
+    m_dataFile( dataFile )
+{
+    if( m_dataFile )
+        DataMemoryManager::instance()->pin( m_dataFile );
+}
+
+DataFilePin::~DataFilePin()
+{
+    if( m_dataFile )
+        DataMemoryManager::instance()->unpin( m_dataFile );
+}
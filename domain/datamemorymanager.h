@@ -0,0 +1,95 @@
+#ifndef DATAMEMORYMANAGER_H
+#define DATAMEMORYMANAGER_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+class DataFile;
+
+/**
+ * The DataMemoryManager class keeps the memory taken by the loaded contents of the data files (data tables and
+ * GeoGrid meshes) within a budget.  When a file finishes loading and the budget is exceeded, the contents of the
+ * least recently used files are freed, except for those changed in memory since they were loaded or saved (they
+ * would lose the changes) and for those pinned by a running algorithm (see DataFilePin).  The freed contents are
+ * reloaded on demand, e.g. by DataFile::data() or DataFile::loadData().
+ *
+ * The files are never freed from within a load, as the caller may be holding references to the contents of other
+ * files (e.g. from DataFile::getDataColumn()) or reading them from worker threads.  Instead, the eviction is
+ * deferred to when the GUI thread's main event loop is about to wait for events, that is, when no algorithm
+ * or modal dialog is running.
+ *
+ * The recency of the files is given by a logical clock that advances on every load, so marking an access to a
+ * file (see DataFile::data()) costs just an atomic read.
+ */
+class DataMemoryManager
+{
+public:
+    static DataMemoryManager* instance();
+
+    /** Sets the budget in bytes.  Zero means no limit.  Files are freed when the main event loop is idle. */
+    void setBudget( int64_t bytes );
+    int64_t getBudget() const;
+
+    /**
+     * Called by the data files after their contents are loaded, saved or replaced to account for their memory.
+     * If the budget is exceeded, other files are freed later, when the main event loop is idle.  This is safe
+     * to call from any thread.
+     */
+    void notifyLoaded( DataFile* dataFile );
+
+    /** Called by the data files after their contents are freed and when they are destroyed. */
+    void notifyFreed( DataFile* dataFile );
+
+    /** Pinned files are never freed by the manager.  Pins are counted, so each pin() needs an unpin(). */
+    void pin( DataFile* dataFile );
+    void unpin( DataFile* dataFile );
+    bool isPinned( const DataFile* dataFile ) const;
+
+    /** Returns the bytes taken by the loaded contents of all files or of the given file. */
+    int64_t getUsage() const;
+    int64_t getUsage( const DataFile* dataFile ) const;
+
+    /** The current time of the logical clock used to find the least recently used files. */
+    static uint64_t getClock(){ return s_clock.load( std::memory_order_relaxed ); }
+
+private:
+    DataMemoryManager();
+
+    /** Called when the GUI thread is about to wait for events.  Enforces the budget if outside nested loops. */
+    void onEventLoopIdle();
+
+    /** Frees least recently used files until the usage is within the budget.  Must run in the GUI thread. */
+    void enforceBudget();
+
+    static std::atomic<uint64_t> s_clock;
+
+    int64_t m_budget;
+    /** Bytes accounted for each file with loaded contents. */
+    std::map<const DataFile*, int64_t> m_usages;
+    std::map<const DataFile*, int> m_pinCounts;
+    /** Serializes the accesses to the maps above. */
+    mutable std::mutex m_mutex;
+    /** Set when the usage or the budget changed since the budget was last enforced. */
+    std::atomic<bool> m_enforcementPending;
+};
+
+/**
+ * Keeps the loaded contents of a data file from being freed by the DataMemoryManager while the pin exists.
+ * Algorithms create one for each data file they read from.
+ */
+class DataFilePin
+{
+public:
+    explicit DataFilePin( DataFile* dataFile );
+    ~DataFilePin();
+
+    DataFilePin( const DataFilePin& ) = delete;
+    DataFilePin& operator=( const DataFilePin& ) = delete;
+
+private:
+    DataFile* m_dataFile;
+};
+
+#endif // DATAMEMORYMANAGER_H
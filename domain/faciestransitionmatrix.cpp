@@ -46,7 +46,7 @@ void FaciesTransitionMatrix::setInfo(QString associatedCategoryDefinitionName)
     m_associatedCategoryDefinitionName = associatedCategoryDefinitionName;
 }
 
-void FaciesTransitionMatrix::setInfoFromMetadataFile()
+std::function<void()> FaciesTransitionMatrix::readMetadataFile()
 {
     QString md_file_path( this->_path );
     QFile md_file( md_file_path.append(".md") );
@@ -63,7 +63,14 @@ void FaciesTransitionMatrix::setInfoFromMetadataFile()
         }
         md_file.close();
     }
-    this->setInfo( associatedCDname );
+    return [=](){
+        this->setInfo( associatedCDname );
+    };
+}
+
+void FaciesTransitionMatrix::setInfoFromMetadataFile()
+{
+    readMetadataFile()();
 }
 
 void FaciesTransitionMatrix::initialize()
@@ -137,6 +144,23 @@ void FaciesTransitionMatrix::incrementCount(int faciesCodeFrom, int faciesCodeTo
         Application::instance()->logError( "FaciesTransitionMatrix::incrementCount(): categorical definition no found." );
 }
 
+int FaciesTransitionMatrix::getIndexOfFaciesCode(int faciesCode) const
+{
+    CategoryDefinition* cd = getAssociatedCategoryDefinition();
+    if( ! cd )
+        return -1;
+    if( ! cd->codeExists( faciesCode ) )
+        return -1;
+    QString faciesName = cd->getCategoryNameByCode( faciesCode );
+    int currentRow = 0;
+    for( const QString& name : m_lineHeadersFaciesNames ){
+        if( name == faciesName )
+            return currentRow;
+        ++currentRow;
+    }
+    return -1;
+}
+
 void FaciesTransitionMatrix::add(const FaciesTransitionMatrix &otherFTM)
 {
     if( getColumnCount() == otherFTM.getColumnCount() &&
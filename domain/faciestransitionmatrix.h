@@ -3,6 +3,7 @@
 
 #include "domain/file.h"
 #include "spectral/spectral.h"
+#include <functional>
 
 class CategoryDefinition;
 
@@ -51,6 +52,10 @@ public:
      */
     void setInfoFromMetadataFile();
 
+    /** Reads the .md file into plain data without changing this object, so it can be called from a background
+     * thread.  Returns the function that applies the metadata read, which must be called in the GUI thread. */
+    std::function<void()> readMetadataFile();
+
     /**
      * This method populates m_columnHeadersFaciesNames and m_columnHeadersFaciesNames with
      * the facies names of the category definition refered by m_associatedCategoryDefinitionName.
@@ -71,6 +76,17 @@ public:
      */
     void incrementCount( int faciesCodeFrom, int faciesCodeTo );
 
+    /**
+     * Returns the index of the row (and of the column) of the given facies code in a matrix made with
+     * initialize().  Returns -1 if the code does not exist in the associated CategoryDefinition.
+     * Use this with addCount() to count many transitions without repeating the facies lookups
+     * of incrementCount().
+     */
+    int getIndexOfFaciesCode( int faciesCode ) const;
+
+    /** Adds the given amount to the value in the given row and column. */
+    void addCount( int rowIndex, int colIndex, double amount ) { m_transitionCounts[ rowIndex ][ colIndex ] += amount; }
+
     /**
      * Adds the values of this matrix with those of the passed FTM.
      * Nothing happens if both FTMs are not compatible for addition like mathematical matrices.
@@ -3,8 +3,9 @@
 #include "viewer3d/view3dbuilders.h"
 #include "domain/attribute.h"
 #include "domain/cartesiangrid.h"
-#include "spatialindex/spatialindex.h"
+#include "spatialindex/geogridcelllocator.h"
 #include "domain/application.h"
+#include "domain/datamemorymanager.h"
 #include "auxiliary/meshloader.h"
 #include "domain/pointset.h"
 #include "domain/segmentset.h"
@@ -24,11 +25,13 @@
 #include <QApplication>
 
 #include <cassert>
+#include <cstring>
 
 GeoGrid::GeoGrid( QString path ) :
 	GridFile( path ),
-	m_spatialIndex( new SpatialIndex() ),
-	m_lastModifiedDateTimeLastMeshLoad()
+	m_cellLocator( new GeoGridCellLocator() ),
+	m_lastModifiedDateTimeLastMeshLoad(),
+	m_lastLocatedCellIndex( -1 )
 {
 	this->_no_data_value = "";
 	this->m_nreal = 1;
@@ -39,8 +42,9 @@ GeoGrid::GeoGrid( QString path ) :
 
 GeoGrid::GeoGrid(QString path, Attribute * atTop, Attribute * atBase, uint nHorizonSlices) :
 	GridFile( path ),
-	m_spatialIndex( new SpatialIndex() ),
-	m_lastModifiedDateTimeLastMeshLoad()
+	m_cellLocator( new GeoGridCellLocator() ),
+	m_lastModifiedDateTimeLastMeshLoad(),
+	m_lastLocatedCellIndex( -1 )
 {
 	CartesianGrid *cgTop = dynamic_cast<CartesianGrid*>( atTop->getContainingFile() );
 	CartesianGrid *cgBase = dynamic_cast<CartesianGrid*>( atBase->getContainingFile() );
@@ -71,12 +75,12 @@ GeoGrid::GeoGrid(QString path, Attribute * atTop, Attribute * atBase, uint nHori
 				//compute the depth (z) of the current vertex.
 				double depth = vBase + ( k / (double)nHorizonSlices ) * ( vTop - vBase );
 				//create and set the position of the vertex
-				VertexRecordPtr vertex( new VertexRecord() );
+				VertexRecord vertex;
 				double x, y, z;
 				cgBase->IJKtoXYZ( i, j, 0, x, y, z );
-				vertex->X = x;
-				vertex->Y = y;
-				vertex->Z = depth;
+				vertex.X = x;
+				vertex.Y = y;
+				vertex.Z = depth;
 				m_vertexesPart.push_back( vertex );
 			}
 		}
@@ -95,17 +99,17 @@ GeoGrid::GeoGrid(QString path, Attribute * atTop, Attribute * atBase, uint nHori
 	for( uint k = 0; k < nKCells; ++k ){
 		for( uint j = 0; j < nJCells; ++j ){
 			for( uint i = 0; i < nICells; ++i ){
-				CellDefRecordPtr cellDef( new CellDefRecord() );
-				//see Doxygen of CellDefRecordPtr in geogrid.h for a diagram of vertex arrangement in space
+				CellDefRecord cellDef;
+				//see Doxygen of CellDefRecord in geogrid.h for a diagram of vertex arrangement in space
 				// and how they form the edges and faces of the visual representation of the cell.
-				cellDef->vId[0] = ( k + 0 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 0 );
-				cellDef->vId[1] = ( k + 0 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 1 );
-				cellDef->vId[2] = ( k + 0 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 1 );
-				cellDef->vId[3] = ( k + 0 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 0 );
-				cellDef->vId[4] = ( k + 1 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 0 );
-				cellDef->vId[5] = ( k + 1 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 1 );
-				cellDef->vId[6] = ( k + 1 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 1 );
-				cellDef->vId[7] = ( k + 1 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 0 );
+				cellDef.vId[0] = ( k + 0 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 0 );
+				cellDef.vId[1] = ( k + 0 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 1 );
+				cellDef.vId[2] = ( k + 0 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 1 );
+				cellDef.vId[3] = ( k + 0 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 0 );
+				cellDef.vId[4] = ( k + 1 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 0 );
+				cellDef.vId[5] = ( k + 1 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 1 );
+				cellDef.vId[6] = ( k + 1 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 1 );
+				cellDef.vId[7] = ( k + 1 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 0 );
 				m_cellDefsPart.push_back( cellDef );
 			}
 		}
@@ -121,8 +125,9 @@ GeoGrid::GeoGrid(QString path, Attribute * atTop, Attribute * atBase, uint nHori
 
 GeoGrid::GeoGrid(QString path, std::vector<GeoGridZone> zones) :
     GridFile( path ),
-    m_spatialIndex( new SpatialIndex() ),
-    m_lastModifiedDateTimeLastMeshLoad()
+    m_cellLocator( new GeoGridCellLocator() ),
+    m_lastModifiedDateTimeLastMeshLoad(),
+    m_lastLocatedCellIndex( -1 )
 {
     //get origin Cartesian grid and do some sanity checks
     CartesianGrid *cg = nullptr;
@@ -168,12 +173,12 @@ GeoGrid::GeoGrid(QString path, std::vector<GeoGridZone> zones) :
                     //compute the depth (z) of the current vertex.
                     double depth = vBase + ( k / (double)(nKVertexesZone-1) ) * ( vTop - vBase );
                     //create and set the position of the vertex
-                    VertexRecordPtr vertex( new VertexRecord() );
+                    VertexRecord vertex;
                     double x, y, z;
                     cg->IJKtoXYZ( i, j, 0, x, y, z );
-                    vertex->X = x;
-                    vertex->Y = y;
-                    vertex->Z = depth;
+                    vertex.X = x;
+                    vertex.Y = y;
+                    vertex.Z = depth;
                     m_vertexesPart.push_back( vertex );
                 }
             }
@@ -202,17 +207,17 @@ GeoGrid::GeoGrid(QString path, std::vector<GeoGridZone> zones) :
         for( uint k = 0; k < nKCellsZone; ++k ){
             for( uint j = 0; j < nJCells; ++j ){
                 for( uint i = 0; i < nICells; ++i ){
-                    CellDefRecordPtr cellDef( new CellDefRecord() );
-                    //see Doxygen of CellDefRecordPtr in geogrid.h for a diagram of vertex arrangement in space
+                    CellDefRecord cellDef;
+                    //see Doxygen of CellDefRecord in geogrid.h for a diagram of vertex arrangement in space
                     // and how they form the edges and faces of the visual representation of the cell.
-                    cellDef->vId[0] = ( vertexKoffset + k + 0 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 0 );
-                    cellDef->vId[1] = ( vertexKoffset + k + 0 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 1 );
-                    cellDef->vId[2] = ( vertexKoffset + k + 0 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 1 );
-                    cellDef->vId[3] = ( vertexKoffset + k + 0 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 0 );
-                    cellDef->vId[4] = ( vertexKoffset + k + 1 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 0 );
-                    cellDef->vId[5] = ( vertexKoffset + k + 1 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 1 );
-                    cellDef->vId[6] = ( vertexKoffset + k + 1 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 1 );
-                    cellDef->vId[7] = ( vertexKoffset + k + 1 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 0 );
+                    cellDef.vId[0] = ( vertexKoffset + k + 0 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 0 );
+                    cellDef.vId[1] = ( vertexKoffset + k + 0 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 1 );
+                    cellDef.vId[2] = ( vertexKoffset + k + 0 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 1 );
+                    cellDef.vId[3] = ( vertexKoffset + k + 0 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 0 );
+                    cellDef.vId[4] = ( vertexKoffset + k + 1 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 0 );
+                    cellDef.vId[5] = ( vertexKoffset + k + 1 ) * nJVertexes * nIVertexes + ( j + 0 ) * nIVertexes + ( i + 1 );
+                    cellDef.vId[6] = ( vertexKoffset + k + 1 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 1 );
+                    cellDef.vId[7] = ( vertexKoffset + k + 1 ) * nJVertexes * nIVertexes + ( j + 1 ) * nIVertexes + ( i + 0 );
                     m_cellDefsPart.push_back( cellDef );
                 }
             }
@@ -237,18 +242,18 @@ void GeoGrid::getCellBoundingBox(uint cellIndex,
     minX = minY = minZ =  std::numeric_limits<double>::max();
     maxX = maxY = maxZ = -std::numeric_limits<double>::max();
 	//Get the cell
-	CellDefRecordPtr cellDef = m_cellDefsPart.at( cellIndex );
+	const CellDefRecord& cellDef = m_cellDefsPart.at( cellIndex );
 	//for each of the eight vertexes of the cell
 	for( uint i = 0; i < 8; ++i ){
 		//Get the vertex
-		VertexRecordPtr vertex = m_vertexesPart.at( cellDef->vId[i] );
+		const VertexRecord& vertex = m_vertexesPart.at( cellDef.vId[i] );
 		//set the max's and min's
-		minX = std::min( minX, vertex->X );
-		minY = std::min( minY, vertex->Y );
-		minZ = std::min( minZ, vertex->Z );
-		maxX = std::max( maxX, vertex->X );
-		maxY = std::max( maxY, vertex->Y );
-		maxZ = std::max( maxZ, vertex->Z );
+		minX = std::min( minX, vertex.X );
+		minY = std::min( minY, vertex.Y );
+		minZ = std::min( minZ, vertex.Z );
+		maxX = std::max( maxX, vertex.X );
+		maxY = std::max( maxY, vertex.Y );
+		maxZ = std::max( maxZ, vertex.Z );
 	}
 }
 
@@ -258,55 +263,62 @@ QString GeoGrid::getMeshFilePath()
 	return mesh_file_path.append(".mesh");
 }
 
+QString GeoGrid::getMeshCacheFilePath()
+{
+	return getMeshFilePath().append(".bin");
+}
+
 void GeoGrid::saveMesh()
 {
-	if( m_vertexesPart.empty() || m_vertexesPart.empty() ){
+	if( m_vertexesPart.empty() || m_cellDefsPart.empty() ){
 		Application::instance()->logInfo("GeoGrid::saveMesh(): No mesh or mesh not loaded.  Nothing done.");
 		return;
 	}
 
-	//close mesh file and write header
-	QFile file( this->getMeshFilePath() );
-	file.open( QFile::WriteOnly | QFile::Text );
-	QTextStream out(&file);
-	out << APP_NAME << " GeoGrid mesh file.  This file is generated automatically.  Do not edit this file.\n";
-	out << "version=" << APP_VERSION << '\n';
+	//the user's legacy ASCII mesh file is left untouched
+	QString path = getMeshFilePath();
+	if( QFileInfo::exists( path ) && ! MeshLoader::isBinaryMeshFile( path ) )
+		path = getMeshCacheFilePath();
 
-	out << "VERTEX LOCATIONS:\n";
-	{
-		std::vector< VertexRecordPtr >::iterator it = m_vertexesPart.begin();
-		for( ; it != m_vertexesPart.end(); ++it ){
-			//making sure the values are written in GSLib-like precision
-			std::stringstream ss;
-			ss << std::setprecision( 12 ) << (*it)->X << ';';
-			ss << std::setprecision( 12 ) << (*it)->Y << ';';
-			ss << std::setprecision( 12 ) << (*it)->Z ;
-			out << ss.str().c_str() << '\n';
-		}
-	}
+	if( writeBinaryMesh( path ) )
+		Application::instance()->logInfo("GeoGrid::saveMesh(): Mesh saved to " + path + ".");
+}
 
-	out << "CELL VERTEX INDEXES:\n";
-	{
-		std::vector< CellDefRecordPtr >::iterator it = m_cellDefsPart.begin();
-		for( ; it != m_cellDefsPart.end(); ++it ){
-			std::stringstream ss;
-			for( int i = 0; i < 7; ++i)
-				ss << (*it)->vId[i] << ';';
-			ss << (*it)->vId[7];
-			out << ss.str().c_str() << "\n";
-		}
+bool GeoGrid::writeBinaryMesh(const QString &path)
+{
+	//make the header
+	GeoGridMeshFileHeader header;
+	std::memset( &header, 0, sizeof( header ) );
+	std::memcpy( header.magic, MeshLoader::BINARY_MESH_MAGIC, sizeof( header.magic ) );
+	header.version = MeshLoader::BINARY_MESH_VERSION;
+	header.byteOrderMark = MeshLoader::BINARY_MESH_BYTE_ORDER_MARK;
+	header.nVertexes = m_vertexesPart.size();
+	header.nCells = m_cellDefsPart.size();
+	header.vertexRecordSize = sizeof( VertexRecord );
+	header.cellDefRecordSize = sizeof( CellDefRecord );
+
+	//write the header followed by the mesh arrays as they are in memory
+	QFile file( path );
+	if( ! file.open( QFile::WriteOnly ) ){
+		Application::instance()->logError("GeoGrid::writeBinaryMesh(): could not open " + path + " for writing.");
+		return false;
 	}
+	qint64 vertexesSize = m_vertexesPart.size() * sizeof( VertexRecord );
+	qint64 cellDefsSize = m_cellDefsPart.size() * sizeof( CellDefRecord );
+	bool ok = file.write( reinterpret_cast<const char*>( &header ), sizeof( header ) ) == sizeof( header ) &&
+			  file.write( reinterpret_cast<const char*>( m_vertexesPart.data() ), vertexesSize ) == vertexesSize &&
+			  file.write( reinterpret_cast<const char*>( m_cellDefsPart.data() ), cellDefsSize ) == cellDefsSize;
 
 	//close mesh file
 	file.close();
 
-	Application::instance()->logInfo("GeoGrid::saveMesh(): Mesh saved.");
+	if( ! ok )
+		Application::instance()->logError("GeoGrid::writeBinaryMesh(): error while writing " + path + ".");
+	return ok;
 }
 
 void GeoGrid::loadMesh()
 {
-	QFile file( this->getMeshFilePath() );
-	file.open(QFile::ReadOnly | QFile::Text);
 	uint data_line_count = 0;
 	QFileInfo info( this->getMeshFilePath() );
 
@@ -315,6 +327,7 @@ void GeoGrid::loadMesh()
 		QDateTime currentLastModified = info.lastModified();
 		// if modified datetime didn't change since last call to loadMesh
 		if (currentLastModified <= m_lastModifiedDateTimeLastMeshLoad) {
+			markLoadedDataAccessed();
 			Application::instance()->logInfo(
 				QString("Mesh file ")
 					.append( this->getMeshFilePath() )
@@ -326,25 +339,40 @@ void GeoGrid::loadMesh()
 	// record the current datetime of file change
 	m_lastModifiedDateTimeLastMeshLoad = info.lastModified();
 
+	// a binary copy of a legacy ASCII mesh file is loaded instead if the ASCII file did not change since
+	QString meshPath = this->getMeshFilePath();
+	QFileInfo cacheInfo( this->getMeshCacheFilePath() );
+	if( cacheInfo.exists() && cacheInfo.lastModified() >= info.lastModified() &&
+		MeshLoader::isBinaryMeshFile( cacheInfo.filePath() ) ){
+		meshPath = cacheInfo.filePath();
+		info = cacheInfo;
+	}
+
+	QFile file( meshPath );
+	file.open(QFile::ReadOnly);
+
 	Application::instance()->logInfo(
-		QString("Loading mesh from ").append( this->getMeshFilePath() ).append("..."));
+		QString("Loading mesh from ").append( meshPath ).append("..."));
 
 	// make sure mesh data is empty
 	m_cellDefsPart.clear();
 	m_vertexesPart.clear();
-	std::vector< CellDefRecordPtr >().swap( m_cellDefsPart ); //clear() may not actually free memory
-	std::vector< VertexRecordPtr >().swap( m_vertexesPart ); //clear() may not actually free memory
+	std::vector< CellDefRecord >().swap( m_cellDefsPart ); //clear() may not actually free memory
+	std::vector< VertexRecord >().swap( m_vertexesPart ); //clear() may not actually free memory
+
+	// the cell locator refers to the previous mesh
+	m_cellLocator->clear();
 
 	// mesh load takes place in another thread, so we can show and update a progress bar
 	//////////////////////////////////
 	QProgressDialog progressDialog;
 	progressDialog.show();
-	progressDialog.setLabelText("Loading and parsing mesh file " + this->getMeshFilePath() + "...");
+	progressDialog.setLabelText("Loading mesh file " + meshPath + "...");
 	progressDialog.setMinimum(0);
 	progressDialog.setValue(0);
-	progressDialog.setMaximum(getFileSize() / 100); // see MeshLoader::doLoad(). Dividing
-													// by 100 allows a max value of ~400GB
-													// when converting from long to int
+	progressDialog.setMaximum(info.size() / 100); // see MeshLoader::doLoad(). Dividing
+												  // by 100 allows a max value of ~400GB
+												  // when converting from long to int
 	QThread *thread = new QThread(); // does it need to set parent (a QObject)?
 	MeshLoader *ml = new MeshLoader(file, m_vertexesPart, m_cellDefsPart, data_line_count ); // Do not set a parent. The object
 																							 // cannot be moved if it has a
@@ -362,13 +390,25 @@ void GeoGrid::loadMesh()
 		thread->wait(200); // reduces cpu usage, refreshes at each 500 milliseconds
 		QCoreApplication::processEvents(); // let Qt repaint widgets
 	}
+	bool wasASCII = ml->wasASCII();
 
 	file.close();
 
 	Application::instance()->logInfo("Finished loading mesh.");
+
+	// keep a binary copy of legacy ASCII mesh files, which loads much faster.
+	if( wasASCII && ! m_vertexesPart.empty() && ! m_cellDefsPart.empty() ){
+		Application::instance()->logInfo("GeoGrid::loadMesh(): saving a binary copy of the mesh file to " +
+										 getMeshCacheFilePath() + ".");
+		writeBinaryMesh( getMeshCacheFilePath() );
+	}
+
+	// account for the mesh, which may free other files if the memory budget is exceeded
+	DataMemoryManager::instance()->notifyLoaded( this );
+	markLoadedDataAccessed();
 }
 
-void GeoGrid::setInfoFromMetadataFile()
+std::function<void()> GeoGrid::readMetadataFile()
 {
 	QString md_file_path( this->_path );
 	QFile md_file( md_file_path.append(".md") );
@@ -415,8 +455,20 @@ void GeoGrid::setInfoFromMetadataFile()
 		   }
 		}
 		md_file.close();
-		this->setInfo( nI, nJ, nK, nreal, ndv, nsvar_var_trn, categorical_attributes);
+		//the variable names are read here as well, so the child objects are made without file reads
+		QStringList fieldNames = Util::getFieldNames( this->_path );
+		return [=](){
+			setFieldNamesRead( fieldNames );
+			this->setInfo( nI, nJ, nK, nreal, ndv, nsvar_var_trn, categorical_attributes);
+			clearFieldNamesRead();
+		};
 	}
+	return [](){};
+}
+
+void GeoGrid::setInfoFromMetadataFile()
+{
+	readMetadataFile()();
 }
 
 void GeoGrid::setInfo(int nI, int nJ, int nK, int nreal, const QString no_data_value,
@@ -445,9 +497,9 @@ uint GeoGrid::getMeshNumberOfVertexes()
 
 void GeoGrid::getMeshVertexLocation(uint index, double & x, double & y, double & z) const
 {
-	x = m_vertexesPart[index]->X;
-	y = m_vertexesPart[index]->Y;
-	z = m_vertexesPart[index]->Z;
+	x = m_vertexesPart[index].X;
+	y = m_vertexesPart[index].Y;
+	z = m_vertexesPart[index].Z;
 }
 
 uint GeoGrid::getMeshNumberOfCells()
@@ -458,14 +510,14 @@ uint GeoGrid::getMeshNumberOfCells()
 
 void GeoGrid::getMeshCellDefinition(uint index, uint (&vIds)[8]) const
 {
-	vIds[0] = m_cellDefsPart[index]->vId[0];
-	vIds[1] = m_cellDefsPart[index]->vId[1];
-	vIds[2] = m_cellDefsPart[index]->vId[2];
-	vIds[3] = m_cellDefsPart[index]->vId[3];
-	vIds[4] = m_cellDefsPart[index]->vId[4];
-	vIds[5] = m_cellDefsPart[index]->vId[5];
-	vIds[6] = m_cellDefsPart[index]->vId[6];
-    vIds[7] = m_cellDefsPart[index]->vId[7];
+	vIds[0] = m_cellDefsPart[index].vId[0];
+	vIds[1] = m_cellDefsPart[index].vId[1];
+	vIds[2] = m_cellDefsPart[index].vId[2];
+	vIds[3] = m_cellDefsPart[index].vId[3];
+	vIds[4] = m_cellDefsPart[index].vId[4];
+	vIds[5] = m_cellDefsPart[index].vId[5];
+	vIds[6] = m_cellDefsPart[index].vId[6];
+    vIds[7] = m_cellDefsPart[index].vId[7];
 }
 
 PointSet *GeoGrid::unfold( PointSet *inputPS, QString nameForNewPointSet )
@@ -720,18 +772,18 @@ bool GeoGrid::XYZtoUVW(double x, double y, double z, double &u, double &v, doubl
 std::vector<Face3D> GeoGrid::getFaces( uint cellIndex )
 {
 	//get the cell geometry definition (vertexes' indexes).
-	CellDefRecordPtr cellDef = m_cellDefsPart.at( cellIndex );
+	const CellDefRecord& cellDef = m_cellDefsPart.at( cellIndex );
 
 	//get the vertex data of the cell
-	VertexRecordPtr vd[8];
-	vd[0] = m_vertexesPart.at( cellDef->vId[0] );
-	vd[1] = m_vertexesPart.at( cellDef->vId[1] );
-	vd[2] = m_vertexesPart.at( cellDef->vId[2] );
-	vd[3] = m_vertexesPart.at( cellDef->vId[3] );
-	vd[4] = m_vertexesPart.at( cellDef->vId[4] );
-	vd[5] = m_vertexesPart.at( cellDef->vId[5] );
-	vd[6] = m_vertexesPart.at( cellDef->vId[6] );
-	vd[7] = m_vertexesPart.at( cellDef->vId[7] );
+	const VertexRecord* vd[8];
+	vd[0] = &m_vertexesPart.at( cellDef.vId[0] );
+	vd[1] = &m_vertexesPart.at( cellDef.vId[1] );
+	vd[2] = &m_vertexesPart.at( cellDef.vId[2] );
+	vd[3] = &m_vertexesPart.at( cellDef.vId[3] );
+	vd[4] = &m_vertexesPart.at( cellDef.vId[4] );
+	vd[5] = &m_vertexesPart.at( cellDef.vId[5] );
+	vd[6] = &m_vertexesPart.at( cellDef.vId[6] );
+	vd[7] = &m_vertexesPart.at( cellDef.vId[7] );
 
 	//------------make the six face geometries------------
 	std::vector<Face3D> fs( 6 );
@@ -772,18 +824,18 @@ std::vector<Face3D> GeoGrid::getFaces( uint cellIndex )
 std::vector<Face3D> GeoGrid::getFacesInvertedWinding(uint cellIndex)
 {
     //get the cell geometry definition (vertexes' indexes).
-    CellDefRecordPtr cellDef = m_cellDefsPart.at( cellIndex );
+    const CellDefRecord& cellDef = m_cellDefsPart.at( cellIndex );
 
     //get the vertex data of the cell
-    VertexRecordPtr vd[8];
-    vd[0] = m_vertexesPart.at( cellDef->vId[0] );
-    vd[1] = m_vertexesPart.at( cellDef->vId[1] );
-    vd[2] = m_vertexesPart.at( cellDef->vId[2] );
-    vd[3] = m_vertexesPart.at( cellDef->vId[3] );
-    vd[4] = m_vertexesPart.at( cellDef->vId[4] );
-    vd[5] = m_vertexesPart.at( cellDef->vId[5] );
-    vd[6] = m_vertexesPart.at( cellDef->vId[6] );
-    vd[7] = m_vertexesPart.at( cellDef->vId[7] );
+    const VertexRecord* vd[8];
+    vd[0] = &m_vertexesPart.at( cellDef.vId[0] );
+    vd[1] = &m_vertexesPart.at( cellDef.vId[1] );
+    vd[2] = &m_vertexesPart.at( cellDef.vId[2] );
+    vd[3] = &m_vertexesPart.at( cellDef.vId[3] );
+    vd[4] = &m_vertexesPart.at( cellDef.vId[4] );
+    vd[5] = &m_vertexesPart.at( cellDef.vId[5] );
+    vd[6] = &m_vertexesPart.at( cellDef.vId[6] );
+    vd[7] = &m_vertexesPart.at( cellDef.vId[7] );
 
     //------------make the six face geometries------------
     std::vector<Face3D> fs( 6 );
@@ -1105,31 +1157,31 @@ void GeoGrid::exportToEclipseGridGRDECL(const QString filePath, bool invertSignZ
 void GeoGrid::IJKtoXYZ(uint i, uint j, uint k, double & x, double & y, double & z) const
 {
 	uint cellIndex = k * m_nJ * m_nI + j * m_nI + i;
-	CellDefRecordPtr cellDef = m_cellDefsPart.at( cellIndex );
-	x = ( m_vertexesPart.at( cellDef->vId[0] )->X +
-		  m_vertexesPart.at( cellDef->vId[1] )->X +
-		  m_vertexesPart.at( cellDef->vId[2] )->X +
-		  m_vertexesPart.at( cellDef->vId[3] )->X +
-		  m_vertexesPart.at( cellDef->vId[4] )->X +
-		  m_vertexesPart.at( cellDef->vId[5] )->X +
-		  m_vertexesPart.at( cellDef->vId[6] )->X +
-		  m_vertexesPart.at( cellDef->vId[7] )->X ) / 8 ;
-	y = ( m_vertexesPart.at( cellDef->vId[0] )->Y +
-		  m_vertexesPart.at( cellDef->vId[1] )->Y +
-		  m_vertexesPart.at( cellDef->vId[2] )->Y +
-		  m_vertexesPart.at( cellDef->vId[3] )->Y +
-		  m_vertexesPart.at( cellDef->vId[4] )->Y +
-		  m_vertexesPart.at( cellDef->vId[5] )->Y +
-		  m_vertexesPart.at( cellDef->vId[6] )->Y +
-		  m_vertexesPart.at( cellDef->vId[7] )->Y ) / 8 ;
-	z = ( m_vertexesPart.at( cellDef->vId[0] )->Z +
-		  m_vertexesPart.at( cellDef->vId[1] )->Z +
-		  m_vertexesPart.at( cellDef->vId[2] )->Z +
-		  m_vertexesPart.at( cellDef->vId[3] )->Z +
-		  m_vertexesPart.at( cellDef->vId[4] )->Z +
-		  m_vertexesPart.at( cellDef->vId[5] )->Z +
-		  m_vertexesPart.at( cellDef->vId[6] )->Z +
-		  m_vertexesPart.at( cellDef->vId[7] )->Z ) / 8 ;
+	const CellDefRecord& cellDef = m_cellDefsPart.at( cellIndex );
+	x = ( m_vertexesPart.at( cellDef.vId[0] ).X +
+		  m_vertexesPart.at( cellDef.vId[1] ).X +
+		  m_vertexesPart.at( cellDef.vId[2] ).X +
+		  m_vertexesPart.at( cellDef.vId[3] ).X +
+		  m_vertexesPart.at( cellDef.vId[4] ).X +
+		  m_vertexesPart.at( cellDef.vId[5] ).X +
+		  m_vertexesPart.at( cellDef.vId[6] ).X +
+		  m_vertexesPart.at( cellDef.vId[7] ).X ) / 8 ;
+	y = ( m_vertexesPart.at( cellDef.vId[0] ).Y +
+		  m_vertexesPart.at( cellDef.vId[1] ).Y +
+		  m_vertexesPart.at( cellDef.vId[2] ).Y +
+		  m_vertexesPart.at( cellDef.vId[3] ).Y +
+		  m_vertexesPart.at( cellDef.vId[4] ).Y +
+		  m_vertexesPart.at( cellDef.vId[5] ).Y +
+		  m_vertexesPart.at( cellDef.vId[6] ).Y +
+		  m_vertexesPart.at( cellDef.vId[7] ).Y ) / 8 ;
+	z = ( m_vertexesPart.at( cellDef.vId[0] ).Z +
+		  m_vertexesPart.at( cellDef.vId[1] ).Z +
+		  m_vertexesPart.at( cellDef.vId[2] ).Z +
+		  m_vertexesPart.at( cellDef.vId[3] ).Z +
+		  m_vertexesPart.at( cellDef.vId[4] ).Z +
+		  m_vertexesPart.at( cellDef.vId[5] ).Z +
+		  m_vertexesPart.at( cellDef.vId[6] ).Z +
+		  m_vertexesPart.at( cellDef.vId[7] ).Z ) / 8 ;
 }
 
 SpatialLocation GeoGrid::getCenter()
@@ -1154,37 +1206,37 @@ SpatialLocation GeoGrid::getCenter()
 
 bool GeoGrid::XYZtoIJK( double x, double y, double z, uint& i, uint& j, uint& k )
 {
-	if( m_spatialIndex->isEmpty() )
-        m_spatialIndex->fillWithCenters( this, 0.0001 );
+    prepareCellLocator();
 
-    assert( ! m_spatialIndex->isEmpty() && "GeoGrid::XYZtoIJK(): the spatial index is not supposed to be"
-                                           " empty when calling this method." );
-
-	//Get the nearest cells.
-    QList<uint> cellIndexes = m_spatialIndex->getNearest( x, y, z, 1 );
+    //locate the cell containing the location, starting the search from the last hit
+    //as consecutive queries are often close to each other.
+    uint cellIndex;
+    if( ! m_cellLocator->locate( x, y, z, cellIndex, m_lastLocatedCellIndex ) )
+        return false;
 
-	//if the spatial search failed, assumes it fell outside the grid
-    if( cellIndexes.empty() )
-		return false;
+    //return the cell's topological coordinates
+    m_lastLocatedCellIndex = cellIndex;
+    this->indexToIJK( cellIndex, i, j, k );
+    return true;
+}
 
-	//the test location
-	Vertex3D p{ x, y, z };
-
-	//for each one of the closest cells returned by the spatial index
-	QList<uint>::iterator itCellIndex = cellIndexes.begin();
-	for( ; itCellIndex != cellIndexes.end(); ++itCellIndex ){
-		//get the cell's faces geometry .
-        Hexahedron hexa = makeHexahedron( *itCellIndex );
-		//if the location is inside the cell
-        if( hexa.isInside( p ) ){
-            //return the cell's topological coordinates
-			this->indexToIJK( *itCellIndex, i, j, k );
-			return true;
-		}
-	}
+void GeoGrid::XYZtoCellIndexes( const std::vector<double>& xs,
+                                const std::vector<double>& ys,
+                                const std::vector<double>& zs,
+                                std::vector<int>& cellIndexes,
+                                unsigned int nThreads )
+{
+    prepareCellLocator();
+    m_cellLocator->locate( xs, ys, zs, cellIndexes, nThreads );
+}
 
-	//if execution reaches this point, the search failed.
-	return false;
+void GeoGrid::prepareCellLocator()
+{
+    if( m_cellLocator->isEmpty() ){
+        loadMesh();
+        m_cellLocator->build( this );
+        m_lastLocatedCellIndex = -1;
+    }
 }
 
 double GeoGrid::getDataSpatialLocation(uint line, CartesianCoord whichCoord) const
@@ -1224,16 +1276,23 @@ void GeoGrid::freeLoadedData()
     m_vertexesPart.clear();
     m_cellDefsPart.clear();
     //clear() does not guarantee memory is actually freed.
-    std::vector< VertexRecordPtr >().swap( m_vertexesPart );
-    std::vector< CellDefRecordPtr >().swap( m_cellDefsPart );
+    std::vector< VertexRecord >().swap( m_vertexesPart );
+    std::vector< CellDefRecord >().swap( m_cellDefsPart );
 
-    // free spatial index data
-    m_spatialIndex->clear();
+    // free cell locator data
+    m_cellLocator->clear();
 
     // call superclass's free data method.
     DataFile::freeLoadedData();
 }
 
+int64_t GeoGrid::getLoadedDataSize() const
+{
+    return DataFile::getLoadedDataSize() +
+           m_vertexesPart.capacity() * sizeof(VertexRecord) +
+           m_cellDefsPart.capacity() * sizeof(CellDefRecord);
+}
+
 BoundingBox GeoGrid::getBoundingBox() const
 {
     if( m_vertexesPart.empty() || m_cellDefsPart.empty() ){
@@ -1316,6 +1375,8 @@ void GeoGrid::deleteFromFS()
 	QFile file(this->getMeshFilePath());
 	file.remove(); // TODO: throw exception if remove() returns false (fails).  Also see
     // QIODevice::errorString() to see error message.
+	//as well as the binary copy of a legacy ASCII mesh file, if any.
+	QFile::remove( this->getMeshCacheFilePath() );
 }
 
 File *GeoGrid::duplicatePhysicalFiles(const QString new_file_name)
@@ -5,26 +5,29 @@
 #include "geometry/face3d.h"
 #include "geometry/hexahedron.h"
 
+#include <atomic>
+#include <functional>
+
 class CartesianGrid;
-class SpatialIndex;
+class GeoGridCellLocator;
 class PointSet;
 class SegmentSet;
 
 /** The data record holding the spatial position of a vertex.
- * It's id is the index in the m_vertexes container.
+ * It's id is the index in the m_vertexesPart container.  The records are stored by value, so the mesh
+ * vertexes form a contiguous array of coordinates (this is also the layout in the binary mesh file).
  */
 typedef struct {
 	double X;
 	double Y;
 	double Z;
 } VertexRecord;
-typedef std::shared_ptr< VertexRecord > VertexRecordPtr;
 
 
 /**
  * The data record holding the ids of the vertexes forming the geometry of a cell.
  * The cell it refers to is identified by and id.  This id is the index in m_cellDefs
- * container.  The cell index is computed from its topological coordinates following
+ * container (a contiguous connectivity array).  The cell index is computed from its topological coordinates following
  * GSLib convention: K * nJ * nI + J * nI + I.  So the first element of index 0 in m_cellDefs
  * is the cell with I = 0; J = 0; K = 0.
  *
@@ -56,7 +59,6 @@ typedef std::shared_ptr< VertexRecord > VertexRecordPtr;
 typedef struct{
 	int vId[8];
 } CellDefRecord;
-typedef std::shared_ptr< CellDefRecord > CellDefRecordPtr;
 
 
 /**
@@ -107,13 +109,19 @@ public:
 	 */
 	QString getMeshFilePath();
 
+	/** Returns the path to the binary copy of a legacy ASCII mesh file (see loadMesh()). */
+	QString getMeshCacheFilePath();
+
 	/**
-	 * Saves the geometry data to file system.
+	 * Saves the geometry data to file system in binary format (see GeoGridMeshFileHeader).
+	 * A legacy ASCII mesh file is never overwritten: the binary copy is saved in the mesh cache file instead.
 	 */
 	void saveMesh();
 
 	/**
-	 * Loads the grid's mesh.
+	 * Loads the grid's mesh.  Legacy ASCII mesh files are left untouched, but a binary copy of them is saved
+	 * in the mesh cache file (see getMeshCacheFilePath()), which is loaded instead while it is newer than the
+	 * ASCII file, so subsequent loads are faster.
 	 */
 	void loadMesh();
 
@@ -122,6 +130,10 @@ public:
 	 #setInfo() with the metadata read from the .md file.*/
 	void setInfoFromMetadataFile();
 
+	/** Reads the .md file into plain data without changing this object, so it can be called from a background
+	 * thread.  Returns the function that applies the metadata read, which must be called in the GUI thread. */
+	std::function<void()> readMetadataFile();
+
 	/** Sets GeoGrid metadata.  It also populates the file's attribute collection. */
 	void setInfo( int nI, int nJ, int nK,
 				  int nreal, const QString no_data_value,
@@ -213,6 +225,19 @@ public:
 	virtual SpatialLocation getCenter();
 	virtual bool XYZtoIJK( double x, double y, double z, uint &i, uint &j, uint &k );
 
+    /**
+     * Does the same as XYZtoIJK() for many locations at once, in parallel.  This is much faster than
+     * calling XYZtoIJK() in a loop, especially if the locations are passed in a spatially coherent order
+     * (e.g. the cell centers of another grid in scan order).
+     * @param cellIndexes Output vector with the index of the cell containing each location (see IJKtoIndex())
+     *                    or -1 if the location is outside the grid mesh.
+     */
+    void XYZtoCellIndexes( const std::vector<double>& xs,
+                           const std::vector<double>& ys,
+                           const std::vector<double>& zs,
+                           std::vector<int>& cellIndexes,
+                           unsigned int nThreads );
+
 //DataFile interface
 public:
 	/** GeoGrids never have declustering weights.  At least they are not supposed to have. */
@@ -227,6 +252,8 @@ public:
     /** NOTE: override the default counting-only behavior of DataFile::getProportion(). */
     virtual double getProportion(int variableIndex, double value0, double value1 );
     virtual void freeLoadedData();
+    /** NOTE: also accounts for the mesh. */
+    virtual int64_t getLoadedDataSize() const;
     virtual BoundingBox getBoundingBox( ) const;
 
 // File interface
@@ -252,10 +279,10 @@ public:
 
 private:
 	//--------------mesh data-----------------------
-	std::vector< VertexRecordPtr > m_vertexesPart;
-	std::vector< CellDefRecordPtr > m_cellDefsPart;
+	std::vector< VertexRecord > m_vertexesPart;
+	std::vector< CellDefRecord > m_cellDefsPart;
 	//----------------------------------------------
-    std::unique_ptr< SpatialIndex > m_spatialIndex;
+    std::unique_ptr< GeoGridCellLocator > m_cellLocator;
 
 	/**
 	 * Stores the file timestamp in the last call to loadMesh().
@@ -263,6 +290,16 @@ private:
 	 * unnecessary data reloads.
 	 */
 	QDateTime m_lastModifiedDateTimeLastMeshLoad;
+
+    /** The cell index found in the last call to XYZtoIJK().  It is used as starting point for the
+     * next search, as consecutive queries are often close to each other. */
+    std::atomic<int> m_lastLocatedCellIndex;
+
+    /** Builds the cell locator used in XYZtoIJK() and XYZtoCellIndexes() if it has not been built yet. */
+    void prepareCellLocator();
+
+	/** Writes the mesh in binary format (see GeoGridMeshFileHeader) to the given path.  Returns false on failure. */
+	bool writeBinaryMesh( const QString& path );
 };
 
 typedef std::shared_ptr<GeoGrid> GeoGridPtr;
@@ -144,6 +144,7 @@ void GridFile::setDataIJK(uint column, uint i, uint j, uint k, double value)
 	//TODO: verify any data update flags (specially in DataFile class)
 	uint dataRow = i + j*m_nI + k*m_nJ*m_nI;
 	_data[dataRow][column] = value;
+    invalidateDataViews();
 }
 
 void GridFile::indexToIJK(uint index, uint & i, uint & j, uint & k) const
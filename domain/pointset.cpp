@@ -239,7 +239,7 @@ BoundingBox PointSet::getBoundingBox() const
     }
 }
 
-void PointSet::setInfoFromMetadataFile()
+std::function<void()> PointSet::readMetadataFile()
 {
     QString md_file_path( this->_path );
     QFile md_file( md_file_path.append(".md") );
@@ -290,8 +290,20 @@ void PointSet::setInfoFromMetadataFile()
            }
         }
         md_file.close();
-        this->setInfo( x_index, y_index, z_index, ndv, wgt_var_pairs, nsvar_var_trn, categorical_attributes );
+        //the variable names are read here as well, so the child objects are made without file reads
+        QStringList fieldNames = Util::getFieldNames( this->_path );
+        return [=](){
+            setFieldNamesRead( fieldNames );
+            this->setInfo( x_index, y_index, z_index, ndv, wgt_var_pairs, nsvar_var_trn, categorical_attributes );
+            clearFieldNamesRead();
+        };
     }
+    return [](){};
+}
+
+void PointSet::setInfoFromMetadataFile()
+{
+    readMetadataFile()();
 }
 
 void PointSet::setInfoFromOtherPointSet(PointSet *otherPS)
@@ -351,6 +363,7 @@ PointSet *PointSet::createPointSetByFiltering(uint column, double vMin, double v
     std::vector< std::vector< double > > filteredData = getDataFilteredBy( column, vMin, vMax );
     //Assign it as the new point set's data.
     newPS->_data = filteredData;
+    newPS->invalidateDataViews();
     //Set the same metadata.
     newPS->setInfoFromOtherPointSet( this );
     //Return the new filtered data set.
@@ -369,6 +382,7 @@ void PointSet::cloneDataLine(uint row)
     //std::vector.insert() inserts elements BEFORE the given index, hence we increase the
     //given index by 1 so the copied data row is added AFTER the original data record.
     _data.insert( itFirstElement + row + 1, rowDataToCopy );
+    invalidateDataViews();
 }
 
 bool PointSet::canHaveMetaData()
@@ -3,6 +3,7 @@
 #include "datafile.h"
 #include <QString>
 #include <QMap>
+#include <functional>
 
 class Attribute;
 
@@ -32,6 +33,10 @@ public:
      #setInfo(int,int,int,const QString) with the metadata read from the .md file.*/
     void setInfoFromMetadataFile();
 
+    /** Reads the .md file into plain data without changing this object, so it can be called from a background
+     * thread.  Returns the function that applies the metadata read, which must be called in the GUI thread. */
+    std::function<void()> readMetadataFile();
+
     /** Sets point set metadata from the passed point set. This is useful to make
      * duplicates of or to extend existing point sets.
      */
@@ -29,8 +29,16 @@
 #include "domain/verticaltransiogrammodel.h"
 #include "domain/verticalproportioncurve.h"
 #include "domain/section.h"
+#include "domain/datamemorymanager.h"
 
-Project::Project(const QString path) : QAbstractItemModel()
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+
+Project::Project(const QString path) : QAbstractItemModel(),
+    _metadata_loader_finished( false ),
+    _metadata_poll_timer( nullptr ),
+    _setting_metadata( false )
 {
     this->_project_directory = new QDir( path );
 
@@ -88,8 +96,8 @@ Project::Project(const QString path) : QAbstractItemModel()
                 //add the object to project tree structure
                 this->_data_files->addChild( ps );
                 ps->setParent( this->_data_files );
-                //reads point set metadata from the .md file
-                ps->setInfoFromMetadataFile();
+                //point set metadata are read from the .md file in the background
+                this->_metadata_readers.push_back( { ps, [ps](){ return ps->readMetadataFile(); } } );
            }
            //found a cartesian grid file reference in gammaray.prj
            if( line.startsWith( "CARTESIANGRID:" ) ){
@@ -102,8 +110,8 @@ Project::Project(const QString path) : QAbstractItemModel()
                 //add the object to project tree structure
                 this->_data_files->addChild( cg );
                 cg->setParent( this->_data_files );
-                //reads point set metadata from the .md file
-                cg->setInfoFromMetadataFile();
+                //grid metadata are read from the .md file in the background
+                this->_metadata_readers.push_back( { cg, [cg](){ return cg->readMetadataFile(); } } );
            }
            //found a plot file reference in gammaray.prj
            if( line.startsWith( "PLOT:" ) ){
@@ -231,8 +239,8 @@ Project::Project(const QString path) : QAbstractItemModel()
 				//add the object to project tree structure
 				this->_data_files->addChild( gg );
 				gg->setParent( this->_data_files );
-				//reads GeoGrid metadata from the .md file
-				gg->setInfoFromMetadataFile();
+				//GeoGrid metadata are read from the .md file in the background
+				this->_metadata_readers.push_back( { gg, [gg](){ return gg->readMetadataFile(); } } );
 		   }
            //found a Segment Set file reference in gammaray.prj
            if( line.startsWith( "SEGMENTSET:" )){
@@ -245,8 +253,8 @@ Project::Project(const QString path) : QAbstractItemModel()
                 //add the object to project tree structure
                 this->_data_files->addChild( ss );
                 ss->setParent( this->_data_files );
-                //reads SegmentSet metadata from the .md file
-                ss->setInfoFromMetadataFile();
+                //SegmentSet metadata are read from the .md file in the background
+                this->_metadata_readers.push_back( { ss, [ss](){ return ss->readMetadataFile(); } } );
            }
            //found a Transition Probability Matrix file reference in gammaray.prj
            if( line.startsWith( "FACIESTRANSITIONMATRIX:" )){
@@ -259,8 +267,8 @@ Project::Project(const QString path) : QAbstractItemModel()
                 //add the object to its correct directory in the project tree structure
                 this->_resources->addChild( ftm );
                 ftm->setParent( this->_resources );
-                //reads FaciesTransitionMatrix metadata from the .md file
-                ftm->setInfoFromMetadataFile();
+                //FaciesTransitionMatrix metadata are read from the .md file in the background
+                this->_metadata_readers.push_back( { ftm, [ftm](){ return ftm->readMetadataFile(); } } );
            }
            //found a Vertical Transiogram Model file reference in gammaray.prj
            if( line.startsWith( "VERTICALTRANSIOGRAMMODEL:" )){
@@ -312,11 +320,18 @@ Project::Project(const QString path) : QAbstractItemModel()
         prj_file.close();
     }
 
-    this->save();
+    //the project is saved once the metadata are loaded (save() needs them to rewrite the .md files)
+    if( this->_metadata_readers.empty() )
+        this->save();
+    else
+        this->startMetadataLoading();
 }
 
 Project::~Project()
 {
+    //the background threads must not outlive the objects they fill
+    if( this->_metadata_loader.joinable() )
+        this->_metadata_loader.join();
     delete this->_project_directory;
     delete this->_data_files;
     delete this->_variograms;
@@ -328,6 +343,9 @@ Project::~Project()
 
 void Project::save()
 {
+    //the .md files of files with metadata still loading would be overwritten with defaults
+    this->waitForMetadata();
+
     QFile file( this->_project_directory->absoluteFilePath( "gammaray.prj" ) );
     file.open( QFile::WriteOnly | QFile::Text );
     QTextStream out(&file);
@@ -363,6 +381,8 @@ QString Project::getName()
 
 ObjectGroup *Project::getDataFilesGroup()
 {
+    //client code may traverse the data files' variables
+    this->waitForMetadata();
     return this->_data_files;
 }
 
@@ -378,6 +398,7 @@ ObjectGroup *Project::getDistributionsGroup()
 
 ObjectGroup *Project::getResourcesGroup()
 {
+    this->waitForMetadata();
     return this->_resources;
 }
 
@@ -695,6 +716,7 @@ QModelIndexList Project::getIndexList(const QModelIndex &parent)
 
 void Project::removeFile(File *file, bool delete_the_file)
 {
+    this->waitForMetadata();
     _data_files->removeChild( file );
     _plots->removeChild( file );
     _variograms->removeChild( file );
@@ -762,11 +784,13 @@ bool Project::fileIsChild(File *file)
 
 ProjectComponent *Project::findObject(const QString object_locator)
 {
+    this->waitForMetadata();
     return _root->findObject( object_locator );
 }
 
 void Project::freeLoadedData()
 {
+    this->waitForMetadata();
     std::vector<ProjectComponent*> objects;
     //retrieve all objects in Data Files group
     _data_files->getAllObjects( objects );
@@ -802,6 +826,121 @@ std::vector<IJAbstractCartesianGrid *> Project::getAllCartesianGrids()
 	return grids;
 }
 
+void Project::waitForMetadata()
+{
+    //other threads may end up here (e.g. via Application::getProject()->findObject())
+    if( QThread::currentThread() != this->thread() )
+        return;
+    if( ! this->_metadata_loader.joinable() )
+        return;
+    this->_metadata_loader.join();
+    this->onMetadataRead();
+}
+
+bool Project::isLoadingMetadata(const ProjectComponent *object) const
+{
+    std::unique_lock<std::mutex> lock( this->_metadata_mutex );
+    return this->_files_loading_metadata.find( object ) != this->_files_loading_metadata.end();
+}
+
+void Project::prefetchData(const std::vector<DataFile *> &dataFiles)
+{
+    //the line counts of grid files are checked against their metadata
+    this->waitForMetadata();
+    DataFile::loadData( dataFiles );
+}
+
+void Project::startMetadataLoading()
+{
+    for( const std::pair< File*, std::function< std::function<void()>() > >& reader : this->_metadata_readers )
+        this->_files_loading_metadata.insert( reader.first );
+
+    //the files are shown in the tree as their metadata are read, a few at a time so the GUI stays responsive
+    const int MAX_FILES_SET_PER_TICK = 20;
+    this->_metadata_poll_timer = new QTimer( this );
+    connect( this->_metadata_poll_timer, &QTimer::timeout, this,
+             [this, MAX_FILES_SET_PER_TICK](){ this->onMetadataRead( MAX_FILES_SET_PER_TICK ); } );
+    this->_metadata_poll_timer->start( 20 );
+
+    Application::instance()->logInfo( "Reading the metadata of " + QString::number( this->_metadata_readers.size() ) +
+                                      " file(s) in the background..." );
+
+    this->_metadata_loader = std::thread( [this](){
+        //the reading is mostly I/O bound, so more threads than processors pay off when files are
+        //in a network drive
+        unsigned int nThreads = std::max( 1u, std::thread::hardware_concurrency() ) * 2;
+        nThreads = std::min( nThreads, (unsigned int)this->_metadata_readers.size() );
+        std::vector< std::pair< int, int > > ranges = Util::generateSubRanges( 0,
+                                                                              this->_metadata_readers.size() - 1,
+                                                                              nThreads );
+        std::vector< std::thread > threads;
+        for( const std::pair< int, int >& range : ranges )
+            threads.push_back( std::thread( [this, range](){
+                for( int i = range.first; i <= range.second; ++i ){
+                    //only the .md file is read here, the file object is changed in the GUI thread
+                    std::function<void()> applyMetadata = this->_metadata_readers[i].second();
+                    std::unique_lock<std::mutex> lock( this->_metadata_mutex );
+                    this->_files_with_metadata_read.push_back( { this->_metadata_readers[i].first, applyMetadata } );
+                }
+            }));
+        for( std::thread& thread : threads )
+            thread.join();
+        this->_metadata_loader_finished = true;
+    });
+}
+
+void Project::onMetadataRead( int maxFiles )
+{
+    //setting the metadata of a file may look up other objects, which calls waitForMetadata() and so this again
+    if( this->_setting_metadata )
+        return;
+    this->_setting_metadata = true;
+
+    //checked first, so no file read before the loader finished is left out below
+    bool loaderFinished = this->_metadata_loader_finished;
+
+    std::vector< std::pair< File*, std::function<void()> > > files;
+    bool allFilesTaken;
+    {
+        std::unique_lock<std::mutex> lock( this->_metadata_mutex );
+        std::vector< std::pair< File*, std::function<void()> > >& filesRead = this->_files_with_metadata_read;
+        size_t nFiles = maxFiles < 0 ? filesRead.size() : std::min<size_t>( maxFiles, filesRead.size() );
+        files.assign( filesRead.begin(), filesRead.begin() + nFiles );
+        filesRead.erase( filesRead.begin(), filesRead.begin() + nFiles );
+        allFilesTaken = filesRead.empty();
+    }
+
+    //set the metadata read, which builds the variables of the files, and make them visible in the tree
+    for( const std::pair< File*, std::function<void()> >& fileAndMetadata : files ){
+        File* file = fileAndMetadata.first;
+        fileAndMetadata.second();
+        QModelIndex index = createIndex( file->getIndexInParent(), 0, file );
+        int nChildren = file->getChildCount();
+        if( nChildren > 0 )
+            beginInsertRows( index, 0, nChildren - 1 );
+        {
+            std::unique_lock<std::mutex> lock( this->_metadata_mutex );
+            this->_files_loading_metadata.erase( file );
+        }
+        if( nChildren > 0 )
+            endInsertRows();
+        //the file is enabled now
+        emit dataChanged( index, index );
+    }
+
+    this->_setting_metadata = false;
+
+    if( loaderFinished && allFilesTaken && ! this->_metadata_readers.empty() ){
+        if( this->_metadata_loader.joinable() )
+            this->_metadata_loader.join();
+        this->_metadata_poll_timer->stop();
+        Application::instance()->logInfo( "Finished reading the metadata of " +
+                                          QString::number( this->_metadata_readers.size() ) + " file(s)." );
+        this->_metadata_readers.clear();
+        this->save();
+    }
+}
+
 //-------------- QAbstractItemModel interface------------
 QModelIndex Project::index(int row, int column, const QModelIndex &parent) const
 {
@@ -848,6 +987,9 @@ int Project::rowCount(const QModelIndex &parent) const
         parentItem = this->_root;
     else
         parentItem = static_cast<ProjectComponent*>(parent.internalPointer());
+    //the variables of a file are hidden while its metadata are read in the background
+    if( isLoadingMetadata( parentItem ) )
+        return 0;
     return parentItem->getChildCount();
 }
 int Project::columnCount(const QModelIndex &/*parent*/) const
@@ -863,12 +1005,28 @@ QVariant Project::data(const QModelIndex &index, int role) const
         return QVariant( item->getPresentationName() );
      if( role == Qt::DecorationRole )
         return QVariant( item->getIcon() );
+     //shows the memory taken by the loaded data of the data files (see DataMemoryManager)
+     if( role == Qt::ToolTipRole && item->isFile() && ((File*)item)->isDataFile() ){
+        DataFile* dataFile = dynamic_cast<DataFile*>( item );
+        int64_t usage = DataMemoryManager::instance()->getUsage( dataFile );
+        if( usage == 0 )
+            return QVariant( "Data not loaded." );
+        QString text = "Loaded data: " + Util::humanReadable( usage ) + "B";
+        if( DataMemoryManager::instance()->isPinned( dataFile ) )
+            text += " (in use)";
+        else if( dataFile->isLoadedDataModified() )
+            text += " (unsaved changes)";
+        return QVariant( text );
+     }
      return QVariant();
 }
 Qt::ItemFlags Project::flags(const QModelIndex &index) const
 {
     if (!index.isValid())
         return 0;
+    //the user can only use a file once its metadata are loaded
+    if( isLoadingMetadata( static_cast<ProjectComponent*>(index.internalPointer()) ) )
+        return Qt::NoItemFlags;
     return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
 }
 QVariant Project::headerData(int /*section*/, Qt::Orientation /*orientation*/, int /*role*/) const
@@ -7,7 +7,15 @@
 #include <QModelIndexList>
 #include "domain/roles.h"
 
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
 class QDir;
+class QTimer;
 class ObjectGroup;
 class DataFile;
 class ProjectRoot;
@@ -29,6 +37,11 @@ class FaciesTransitionMatrix;
 
 /**
  * @brief The Project class holds all information about a geostats study.
+ * When a project is opened, the tree is built right away from the entries in gammaray.prj and the metadata of the
+ * data files (.md files and the variable names in the GEO-EAS headers) are read concurrently in background threads.
+ * The metadata read are set, and the variables are added to the files, in the GUI thread, a few files at a time.
+ * A file is disabled in the tree and its variables are hidden until then.  The data themselves
+ * are only loaded when first accessed (see DataFile::loadData()) or when requested with prefetchData().
  */
 class Project : public QAbstractItemModel
 {
@@ -248,6 +261,23 @@ public:
 	/** Returns a collection with the Cartesian grids of the project. */
 	std::vector<IJAbstractCartesianGrid *> getAllCartesianGrids( );
 
+    /**
+     * Blocks until the metadata of all files being read in the background are loaded.  This is called by the
+     * methods that depend on the metadata of all files (e.g. save()), so client code normally does not need to.
+     * Does nothing if called from a thread other than the GUI thread.
+     */
+    void waitForMetadata();
+
+    /** Returns whether the metadata of the given object are still being read in the background. */
+    bool isLoadingMetadata( const ProjectComponent* object ) const;
+
+    /**
+     * Loads the data of the given data files concurrently (see DataFile::loadData( const std::vector<DataFile*>& )).
+     * Meant for workflows that know beforehand which files they will need, since the data are otherwise loaded
+     * one file at a time on first access.
+     */
+    void prefetchData( const std::vector<DataFile*>& dataFiles );
+
 private:
     QDir* _project_directory;
     ObjectGroup* _data_files;
@@ -257,6 +287,27 @@ private:
     ObjectGroup* _resources;
     ProjectRoot* _root;
 
+    /** The files whose metadata are read in the background and the functions that read them.  The functions
+     * only read the .md files and return the functions that set the metadata read, which run in the GUI thread. */
+    std::vector< std::pair< File*, std::function< std::function<void()>() > > > _metadata_readers;
+    /** The files whose metadata are not yet shown in the tree. */
+    std::set<const ProjectComponent*> _files_loading_metadata;
+    /** The files whose metadata were read but are not yet set and shown in the tree. */
+    std::vector< std::pair< File*, std::function<void()> > > _files_with_metadata_read;
+    mutable std::mutex _metadata_mutex;
+    std::thread _metadata_loader;
+    std::atomic<bool> _metadata_loader_finished;
+    QTimer* _metadata_poll_timer;
+    /** Whether onMetadataRead() is setting the metadata of files. */
+    bool _setting_metadata;
+
+    /** Starts reading the metadata of the files in _metadata_readers in background threads. */
+    void startMetadataLoading();
+
+    /** Sets the metadata read of the files and shows them in the tree.  Runs in the GUI thread.
+     * @param maxFiles The maximum number of files to set.  A negative number means all files read so far. */
+    void onMetadataRead( int maxFiles = -1 );
+
     // QAbstractItemModel interface
 public:
     QModelIndex index(int row, int column, const QModelIndex &parent) const;
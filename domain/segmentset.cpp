@@ -43,7 +43,7 @@ void SegmentSet::setInfo(int x_intial_index, int y_intial_index, int z_intial_in
     PointSet::setInfo( x_intial_index, y_intial_index, z_intial_index, no_data_value );
 }
 
-void SegmentSet::setInfoFromMetadataFile()
+std::function<void()> SegmentSet::readMetadataFile()
 {
     QString md_file_path( this->_path );
     QFile md_file( md_file_path.append(".md") );
@@ -104,10 +104,22 @@ void SegmentSet::setInfoFromMetadataFile()
            }
         }
         md_file.close();
-        setInfo( x_initial_index, y_initial_index, z_initial_index,
-                 x_final_index, y_final_index, z_final_index,
-                 ndv, wgt_var_pairs, nsvar_var_trn, categorical_attributes );
+        //the variable names are read here as well, so the child objects are made without file reads
+        QStringList fieldNames = Util::getFieldNames( this->_path );
+        return [=](){
+            setFieldNamesRead( fieldNames );
+            setInfo( x_initial_index, y_initial_index, z_initial_index,
+                     x_final_index, y_final_index, z_final_index,
+                     ndv, wgt_var_pairs, nsvar_var_trn, categorical_attributes );
+            clearFieldNamesRead();
+        };
     }
+    return [](){};
+}
+
+void SegmentSet::setInfoFromMetadataFile()
+{
+    readMetadataFile()();
 }
 
 void SegmentSet::setInfoFromAnotherSegmentSet(SegmentSet *otherSS)
@@ -384,6 +396,7 @@ SegmentSet* SegmentSet::createSegmentSetByFiltering(uint column, double vMin, do
     std::vector< std::vector< double > > filteredData = getDataFilteredBy( column, vMin, vMax );
     //Assign it as the new point set's data.
     newSS->_data = filteredData;
+    newSS->invalidateDataViews();
     //Set the same metadata.
     newSS->setInfoFromAnotherSegmentSet( this );
     //Return the new filtered data set.
@@ -2,6 +2,7 @@
 #define SEGMENTSET_H
 
 #include "domain/pointset.h"
+#include <functional>
 
 class SegmentSet : public PointSet
 {
@@ -29,6 +30,10 @@ public:
      #setInfo() with the metadata read from the .md file.*/
     void setInfoFromMetadataFile();
 
+    /** Reads the .md file into plain data without changing this object, so it can be called from a background
+     * thread.  Returns the function that applies the metadata read, which must be called in the GUI thread. */
+    std::function<void()> readMetadataFile();
+
     /**
      * Sets segment set metadata from the passed segment set. This is useful to make
      * duplicates of or to extend existing segment sets.
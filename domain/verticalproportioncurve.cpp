@@ -417,13 +417,15 @@ void VerticalProportionCurve::writeToFS()
             record.push_back( proportion );
         _data.push_back( record );
     }
+    invalidateDataViews();
 
     //save the proportions
     DataFile::writeToFS();
 
     //after saving, we can discard the data frame, which is only necessary
-    //to reuse DataFile's IO functionalities.
-    _data.clear();
+    //to reuse DataFile's IO functionalities.  freeLoadedData() also tells the
+    //DataMemoryManager the table is gone, so it is not accounted for.
+    freeLoadedData();
 }
 
 void VerticalProportionCurve::readFromFS()
@@ -455,7 +457,7 @@ void VerticalProportionCurve::readFromFS()
     }
 
     //The data table is no longer needed.
-    _data.clear();
+    freeLoadedData();
 }
 
 BoundingBox VerticalProportionCurve::getBoundingBox() const
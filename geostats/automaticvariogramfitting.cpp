@@ -544,7 +544,8 @@ spectral::array AutomaticVariogramFitting::computeFIM( const spectral::array &gr
 
     //de-centralize de covariance values (h=0 goes to the corners of the grid)
     // the multiplication by ( nI * nJ * nK ) is to keep simmetry with the division by the same value further down.
-    spectral::array covarianceDecentralized = spectral::shiftByHalf( gridWithCovariance ) * static_cast<double>( nI * nJ * nK );
+    spectral::array covarianceDecentralized = spectral::shiftByHalf( gridWithCovariance );
+    covarianceDecentralized *= static_cast<double>( nI * nJ * nK );
 
     //compute FFT of the variographic surface (into polar form)
     spectral::complex_array variographicSurfaceFFT( nI, nJ, nK );
@@ -552,29 +553,26 @@ spectral::array AutomaticVariogramFitting::computeFIM( const spectral::array &gr
     spectral::foward( variographicSurfaceFFT, covarianceDecentralized);  // FFTW crashes when called concurrently
     FFTWlock.unlock();                                                   //
 
-    //convert the FFT result (as complex numbers in a + bi form) to polar form (amplitudes and phases)
-    spectral::complex_array variographicSurfaceFFTpolar = spectral::to_polar_form( variographicSurfaceFFT );
-
-    //get the FFT amplitudes of the covariance values to get the spectral density
-    spectral::array spectralDensity = spectral::real( variographicSurfaceFFTpolar );
-
-    //get the square root of the spectral density to get the FFT amplitude spectrum of the resulting map
-    spectral::array mapFFTamplitudes = spectralDensity.sqrt();
-
-    //convert the FFT amplitudes and phases (passad as parameter) of the future result to rectangular form (a + bi)
-    spectral::complex_array mapFFTpolar = spectral::to_complex_array(
-                                                   mapFFTamplitudes,
-                                                   gridWithFFTphases
-                                                );
-    spectral::complex_array mapFFT = spectral::to_rectangular_form( mapFFTpolar );
+    //in a single pass over the FFT result (as complex numbers in a + bi form): get the FFT amplitudes of the
+    //covariance values (the spectral density), take their square root to get the FFT amplitude spectrum of the
+    //resulting map and combine them with the FFT phases (passed as parameter) of the future result in rectangular form (a + bi)
+    const spectral::index nCells = variographicSurfaceFFT.size();
+    fftw_complex* mapFFT = variographicSurfaceFFT.d_;
+    const double* phases = gridWithFFTphases.d_.data();
+    for( spectral::index i = 0; i < nCells; ++i ){
+        std::complex<double> value = std::polar( std::sqrt( std::abs( std::complex<double>( mapFFT[i][0], mapFFT[i][1] ) ) ),
+                                                 phases[i] );
+        mapFFT[i][0] = value.real();
+        mapFFT[i][1] = value.imag();
+    }
 
     //compute the reverse FFT to get "factorial kriging"
     FFTWlock.lock();                      //
-    spectral::backward( result, mapFFT ); // FFTW crashes when called concurrently
+    spectral::backward( result, variographicSurfaceFFT ); // FFTW crashes when called concurrently
     FFTWlock.unlock();                    //
 
     //fftw3's reverse FFT requires that the values of output be divided by the number of cells
-    result = result / static_cast<double>( nI * nJ * nK );
+    result /= static_cast<double>( nI * nJ * nK );
 
     //return the result
     return result;
@@ -0,0 +1,250 @@
+#include "celldeclustering.h"
+#include "domain/pointset.h"
+#include "domain/application.h"
+#include "gslib/gslibparameterfiles/gslibparameterfile.h"
+#include "gslib/gslibparameterfiles/gslibparamtypes.h"
+#include "util.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+CellDeclustering::CellDeclustering(PointSet *pointSet, uint variableColumn) :
+    m_pointSet( pointSet ),
+    m_variableColumn( variableColumn ),
+    m_trimMin( -1.0e21 ),
+    m_trimMax( 1.0e21 ),
+    m_yAnisotropy( 1.0 ),
+    m_zAnisotropy( 1.0 ),
+    m_nSizes( 20 ),
+    m_minSize( 1.0 ),
+    m_maxSize( 20.0 ),
+    m_nOffsets( 4 ),
+    m_lookForMinimum( true ),
+    m_nThreads( 0 ),
+    m_naiveMean( 0.0 ),
+    m_declusteredMean( 0.0 ),
+    m_optimalCellSize( 0.0 )
+{
+}
+
+void CellDeclustering::setFromParameters(GSLibParameterFile *declusParameters)
+{
+    GSLibParMultiValuedFixed* par2 = declusParameters->getParameter<GSLibParMultiValuedFixed*>(2);
+    setTrimmingLimits( par2->getParameter<GSLibParDouble*>(0)->_value,
+                       par2->getParameter<GSLibParDouble*>(1)->_value );
+    GSLibParMultiValuedFixed* par5 = declusParameters->getParameter<GSLibParMultiValuedFixed*>(5);
+    setAnisotropy( par5->getParameter<GSLibParDouble*>(0)->_value,
+                   par5->getParameter<GSLibParDouble*>(1)->_value );
+    setLookForMinimum( declusParameters->getParameter<GSLibParOption*>(6)->_selected_value == 0 );
+    GSLibParMultiValuedFixed* par7 = declusParameters->getParameter<GSLibParMultiValuedFixed*>(7);
+    setCellSizes( par7->getParameter<GSLibParUInt*>(0)->_value,
+                  par7->getParameter<GSLibParDouble*>(1)->_value,
+                  par7->getParameter<GSLibParDouble*>(2)->_value );
+    setNumberOfOriginOffsets( declusParameters->getParameter<GSLibParUInt*>(8)->_value );
+}
+
+bool CellDeclustering::run()
+{
+    if( m_nSizes < 1 || m_nOffsets < 1 || m_minSize <= 0.0 || m_maxSize < m_minSize ){
+        Application::instance()->logError( "CellDeclustering::run(): invalid cell sizes or number of origin offsets." );
+        return false;
+    }
+
+    m_pointSet->loadData();
+    const long nDataLines = m_pointSet->getDataLineCount();
+    const int xColumn = m_pointSet->getXindex() - 1;
+    const int yColumn = m_pointSet->getYindex() - 1;
+    const int zColumn = m_pointSet->getZindex() - 1; //negative for 2D data
+    const bool hasNDV = m_pointSet->hasNoDataValue();
+    const double NDV = m_pointSet->getNoDataValueAsDouble();
+    if( m_yAnisotropy <= 0.0 || ( zColumn >= 0 && m_zAnisotropy <= 0.0 ) ){
+        Application::instance()->logError( "CellDeclustering::run(): the anisotropy factors must be positive." );
+        return false;
+    }
+
+    //collect the valid samples
+    std::vector<double> xs, ys, zs, values;
+    std::vector<long> dataLines;
+    for( long iLine = 0; iLine < nDataLines; ++iLine ){
+        double value = m_pointSet->dataConst( iLine, m_variableColumn );
+        if( ! std::isfinite( value ) || value < m_trimMin || value >= m_trimMax ||
+            ( hasNDV && Util::almostEqual2sComplement( value, NDV, 1 ) ) )
+            continue;
+        xs.push_back( m_pointSet->dataConst( iLine, xColumn ) );
+        ys.push_back( m_pointSet->dataConst( iLine, yColumn ) );
+        zs.push_back( zColumn >= 0 ? m_pointSet->dataConst( iLine, zColumn ) : 0.0 );
+        values.push_back( value );
+        dataLines.push_back( iLine );
+    }
+    const long nSamples = values.size();
+    if( nSamples == 0 ){
+        Application::instance()->logError( "CellDeclustering::run(): no valid samples." );
+        return false;
+    }
+
+    const double xMin = *std::min_element( xs.begin(), xs.end() );
+    const double xMax = *std::max_element( xs.begin(), xs.end() );
+    const double yMin = *std::min_element( ys.begin(), ys.end() );
+    const double yMax = *std::max_element( ys.begin(), ys.end() );
+    const double zMin = *std::min_element( zs.begin(), zs.end() );
+    const double zMax = *std::max_element( zs.begin(), zs.end() );
+
+    m_naiveMean = 0.0;
+    for( double value : values )
+        m_naiveMean += value;
+    m_naiveMean /= nSamples;
+
+    //Computes the (unnormalized) weights for a cell size, accumulated over the origin offsets,
+    //and returns the declustered mean.
+    auto declusterForCellSize = [&]( double xCellSize, std::vector<double>& weights ){
+        const double yCellSize = xCellSize * m_yAnisotropy;
+        const double zCellSize = zColumn >= 0 ? xCellSize * m_zAnisotropy : 1.0;
+        //the origins are shifted by a fraction of the cell size, but not more than half the data extent (as declus).
+        const double xShift = std::min( xCellSize / m_nOffsets, 0.5 * ( xMax - xMin ) );
+        const double yShift = std::min( yCellSize / m_nOffsets, 0.5 * ( yMax - yMin ) );
+        const double zShift = std::min( zCellSize / m_nOffsets, 0.5 * ( zMax - zMin ) );
+        std::fill( weights.begin(), weights.end(), 0.0 );
+        std::vector<int64_t> cellOfSample( nSamples );
+        std::unordered_map<int64_t, int> sampleCountOfCell;
+        sampleCountOfCell.reserve( nSamples );
+        for( int iOffset = 0; iOffset < m_nOffsets; ++iOffset ){
+            const double xOrigin = xMin - iOffset * xShift;
+            const double yOrigin = yMin - iOffset * yShift;
+            const double zOrigin = zMin - iOffset * zShift;
+            const int64_t nCellsX = (int64_t)( ( xMax - xOrigin ) / xCellSize ) + 1;
+            const int64_t nCellsY = (int64_t)( ( yMax - yOrigin ) / yCellSize ) + 1;
+            sampleCountOfCell.clear();
+            for( long iSample = 0; iSample < nSamples; ++iSample ){
+                int64_t i = (int64_t)( ( xs[iSample] - xOrigin ) / xCellSize );
+                int64_t j = (int64_t)( ( ys[iSample] - yOrigin ) / yCellSize );
+                int64_t k = (int64_t)( ( zs[iSample] - zOrigin ) / zCellSize );
+                int64_t cell = i + nCellsX * ( j + nCellsY * k );
+                cellOfSample[iSample] = cell;
+                ++sampleCountOfCell[ cell ];
+            }
+            //each occupied cell gets the same total weight, shared among its samples.
+            double sumOfWeights = 0.0;
+            for( long iSample = 0; iSample < nSamples; ++iSample )
+                sumOfWeights += 1.0 / sampleCountOfCell[ cellOfSample[iSample] ];
+            for( long iSample = 0; iSample < nSamples; ++iSample )
+                weights[iSample] += 1.0 / sampleCountOfCell[ cellOfSample[iSample] ] / sumOfWeights;
+        }
+        double sumOfWeights = 0.0, sumOfWeightedValues = 0.0;
+        for( long iSample = 0; iSample < nSamples; ++iSample ){
+            sumOfWeights += weights[iSample];
+            sumOfWeightedValues += weights[iSample] * values[iSample];
+        }
+        return sumOfWeightedValues / sumOfWeights;
+    };
+
+    auto isBetter = [this]( double mean, double bestMean ){
+        return m_lookForMinimum ? mean < bestMean : mean > bestMean;
+    };
+
+    //the candidate cell sizes are distributed among the threads, each keeping the weights of its best cell size.
+    const int nCellSizes = m_nSizes + 1;
+    const double sizeIncrement = ( m_maxSize - m_minSize ) / m_nSizes;
+    unsigned int nThreads = m_nThreads ? m_nThreads : std::max( 1u, std::thread::hardware_concurrency() );
+    nThreads = std::min( nThreads, (unsigned int)nCellSizes );
+    std::vector< std::pair< int, int > > ranges = Util::generateSubRanges( 0, nCellSizes - 1, nThreads );
+    std::vector< std::vector<double> > bestWeightsOfThread( ranges.size() );
+    std::vector< double > bestMeanOfThread( ranges.size(), 0.0 );
+    std::vector< double > bestCellSizeOfThread( ranges.size(), 0.0 );
+    std::vector< double > meanOfCellSize( nCellSizes );
+    std::vector< std::thread > threads;
+    for( size_t iThread = 0; iThread < ranges.size(); ++iThread )
+        threads.push_back( std::thread( [&, iThread](){
+            std::vector<double> weights( nSamples );
+            for( int iSize = ranges[iThread].first; iSize <= ranges[iThread].second; ++iSize ){
+                double cellSize = m_minSize + iSize * sizeIncrement;
+                double mean = declusterForCellSize( cellSize, weights );
+                meanOfCellSize[iSize] = mean;
+                if( bestWeightsOfThread[iThread].empty() || isBetter( mean, bestMeanOfThread[iThread] ) ){
+                    bestMeanOfThread[iThread] = mean;
+                    bestCellSizeOfThread[iThread] = cellSize;
+                    bestWeightsOfThread[iThread] = weights;
+                }
+            }
+        }));
+    for( std::thread& thread : threads )
+        thread.join();
+
+    //pick the best in increasing cell size order, as the sequential search would.
+    //Like declus, the first cell size is the initial best, even if it does not improve the naive mean.
+    std::vector<double> bestWeights;
+    for( size_t iThread = 0; iThread < ranges.size(); ++iThread )
+        if( ! bestWeightsOfThread[iThread].empty() &&
+            ( bestWeights.empty() || isBetter( bestMeanOfThread[iThread], m_declusteredMean ) ) ){
+            m_declusteredMean = bestMeanOfThread[iThread];
+            m_optimalCellSize = bestCellSizeOfThread[iThread];
+            bestWeights.swap( bestWeightsOfThread[iThread] );
+        }
+
+    //normalize the weights so they average one.
+    double sumOfWeights = 0.0;
+    for( double weight : bestWeights )
+        sumOfWeights += weight;
+    m_weights.assign( nDataLines, 0.0 );
+    for( long iSample = 0; iSample < nSamples; ++iSample )
+        m_weights[ dataLines[iSample] ] = bestWeights[iSample] * nSamples / sumOfWeights;
+
+    m_summary.clear();
+    m_summary.push_back( { 0.0, m_naiveMean } );
+    for( int iSize = 0; iSize < nCellSizes; ++iSize )
+        m_summary.push_back( { m_minSize + iSize * sizeIncrement, meanOfCellSize[iSize] } );
+
+    Application::instance()->logInfo( "CellDeclustering::run(): naive mean = " + QString::number( m_naiveMean ) +
+                                       "; declustered mean = " + QString::number( m_declusteredMean ) +
+                                       " with cell size = " + QString::number( m_optimalCellSize ) + "." );
+    return true;
+}
+
+bool CellDeclustering::writeSummary(const QString &path) const
+{
+    QFile file( path );
+    if( ! file.open( QFile::WriteOnly | QFile::Text ) ){
+        Application::instance()->logError( "CellDeclustering::writeSummary(): could not write " + path + "." );
+        return false;
+    }
+    QTextStream out( &file );
+    out << "Declustering Summary\n";
+    out << "2\n";
+    out << "Cell Size\n";
+    out << "Declustered Mean\n";
+    for( const std::pair<double, double>& sizeAndMean : m_summary )
+        out << QString::number( sizeAndMean.first, 'g', 12 ) << '\t'
+            << QString::number( sizeAndMean.second, 'g', 12 ) << '\n';
+    return true;
+}
+
+bool CellDeclustering::writeDataWithWeights(const QString &path) const
+{
+    QFile in( m_pointSet->getPath() );
+    QFile out( path );
+    if( ! in.open( QFile::ReadOnly | QFile::Text ) || ! out.open( QFile::WriteOnly | QFile::Text ) ){
+        Application::instance()->logError( "CellDeclustering::writeDataWithWeights(): could not read " +
+                                           m_pointSet->getPath() + " or write " + path + "." );
+        return false;
+    }
+    //copy the header adding the weight variable.
+    out.write( in.readLine() );
+    int nVariables = Util::getFirstNumber( QString( in.readLine() ) );
+    out.write( QByteArray::number( nVariables + 1 ) + '\n' );
+    for( int iVariable = 0; iVariable < nVariables; ++iVariable )
+        out.write( in.readLine() );
+    out.write( "Declustering Weight\n" );
+    //copy the data lines verbatim (no loss of precision) appending the weights.
+    for( size_t iLine = 0; iLine < m_weights.size() && ! in.atEnd(); ){
+        QByteArray line = in.readLine();
+        while( line.endsWith( '\n' ) || line.endsWith( '\r' ) )
+            line.chop( 1 );
+        if( line.trimmed().isEmpty() )
+            continue;
+        out.write( line + '\t' + QByteArray::number( m_weights[iLine++], 'g', 12 ) + '\n' );
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+#ifndef CELLDECLUSTERING_H
+#define CELLDECLUSTERING_H
+
+#include <vector>
+#include <QString>
+
+class PointSet;
+class GSLibParameterFile;
+
+/**
+ * The CellDeclustering class computes cell declustering weights for a variable of a point set.  It is an
+ * in-process replacement of GSLib's declus program and follows its algorithm: for each candidate cell size (and
+ * origin offset), the samples are assigned to cells and each sample receives a weight inversely proportional to
+ * the number of samples in its cell; the cell size yielding the minimum (or maximum) declustered mean is kept.
+ *
+ * The samples are hashed into cells, so the cost does not depend on the number of cells covering the data extent.
+ * The candidate cell sizes are evaluated concurrently.
+ */
+class CellDeclustering
+{
+public:
+    /**
+     * @param pointSet The point set with the data.  Its data are loaded if necessary.
+     * @param variableColumn The column (starting with 0) of the variable to decluster.
+     */
+    CellDeclustering( PointSet* pointSet, uint variableColumn );
+
+    /** Samples outside [min, max) are ignored and receive zero weight. */
+    void setTrimmingLimits( double min, double max ){ m_trimMin = min; m_trimMax = max; }
+
+    /** Cell size in Y = cell size * yAnisotropy and in Z = cell size * zAnisotropy.  The factors must be positive
+     * (the Z factor only for 3D data), otherwise run() fails. */
+    void setAnisotropy( double yAnisotropy, double zAnisotropy ){ m_yAnisotropy = yAnisotropy; m_zAnisotropy = zAnisotropy; }
+
+    /** Sets the nSizes+1 candidate cell sizes equally spaced between minSize and maxSize. */
+    void setCellSizes( int nSizes, double minSize, double maxSize ){ m_nSizes = nSizes; m_minSize = minSize; m_maxSize = maxSize; }
+
+    void setNumberOfOriginOffsets( int nOffsets ){ m_nOffsets = nOffsets; }
+
+    /** If true, the cell size with the minimum declustered mean is chosen (clustering in high values).
+     *  Otherwise, the one with the maximum declustered mean is chosen. */
+    void setLookForMinimum( bool minimum ){ m_lookForMinimum = minimum; }
+
+    /** Zero means the number of logical processors. */
+    void setNumberOfThreads( unsigned int nThreads ){ m_nThreads = nThreads; }
+
+    /** Reads the settings from the parameters of GSLib's declus program (the file paths are not used). */
+    void setFromParameters( GSLibParameterFile* declusParameters );
+
+    /** Computes the weights.  Returns false if there are no valid samples or the settings are invalid. */
+    bool run();
+
+    /** The weights per data line of the point set (they average one over the valid samples). */
+    const std::vector<double>& getWeights() const { return m_weights; }
+
+    double getNaiveMean() const { return m_naiveMean; }
+    double getDeclusteredMean() const { return m_declusteredMean; }
+
+    /** Returns the chosen cell size.  As in declus, the smallest cell size is chosen unless a larger one yields
+     * a declustered mean further in the desired direction. */
+    double getOptimalCellSize() const { return m_optimalCellSize; }
+
+    /** Writes the declustered mean for each cell size as a GEO-EAS file, like declus's summary output. */
+    bool writeSummary( const QString& path ) const;
+
+    /** Writes the point set's data with the weights as an additional last column, like declus's output. */
+    bool writeDataWithWeights( const QString& path ) const;
+
+private:
+    PointSet* m_pointSet;
+    uint m_variableColumn;
+    double m_trimMin;
+    double m_trimMax;
+    double m_yAnisotropy;
+    double m_zAnisotropy;
+    int m_nSizes;
+    double m_minSize;
+    double m_maxSize;
+    int m_nOffsets;
+    bool m_lookForMinimum;
+    unsigned int m_nThreads;
+
+    std::vector<double> m_weights;
+    double m_naiveMean;
+    double m_declusteredMean;
+    double m_optimalCellSize;
+    /** Pairs of cell size and declustered mean. */
+    std::vector< std::pair<double, double> > m_summary;
+};
+
+#endif // CELLDECLUSTERING_H
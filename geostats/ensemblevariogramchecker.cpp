@@ -0,0 +1,201 @@
+#include "ensemblevariogramchecker.h"
+#include "domain/application.h"
+#include "domain/cartesiangrid.h"
+#include "domain/variogrammodel.h"
+#include "geostats/geostatsutils.h"
+#include "geostats/realizationstore.h"
+#include "geostats/spatiallocation.h"
+#include "util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace {
+    /** Returns the percentile of sorted values with linear interpolation. */
+    double percentile( const std::vector<double>& sortedValues, double probability ){
+        double position = probability * ( sortedValues.size() - 1 );
+        size_t below = (size_t)std::floor( position );
+        size_t above = std::min( below + 1, sortedValues.size() - 1 );
+        double fraction = position - below;
+        return sortedValues[below] + fraction * ( sortedValues[above] - sortedValues[below] );
+    }
+}
+
+EnsembleVariogramChecker::EnsembleVariogramChecker(CartesianGrid *realizations) :
+    m_realizations( realizations ),
+    m_nLags( 0 ),
+    m_variogramModel( nullptr ),
+    m_lowPercentile( 0.05 ),
+    m_highPercentile( 0.95 ),
+    m_nThreads( 0 ),
+    m_nRealizations( 0 )
+{
+}
+
+void EnsembleVariogramChecker::setFromParameters(GSLibParameterFile *gamParameters)
+{
+    m_steps = MultivariateVariogramEngine::getLagSteps( gamParameters, m_nLags );
+}
+
+bool EnsembleVariogramChecker::run()
+{
+    m_variograms.clear();
+    m_nRealizations = 0;
+    if( m_steps.empty() || m_nLags < 1 ){
+        Application::instance()->logError( "EnsembleVariogramChecker::run(): no lags to compute." );
+        return false;
+    }
+
+    RealizationStore store;
+    if( ! store.openForGrid( m_realizations ) )
+        return false;
+
+    const long nI = m_realizations->getNX();
+    const long nJ = m_realizations->getNY();
+    const long nK = m_realizations->getNZ();
+    const int nDirections = m_steps.size();
+    const bool hasNDV = m_realizations->hasNoDataValue();
+    const double NDV = m_realizations->getNoDataValueAsDouble();
+    m_nRealizations = store.getRealizationCount();
+    if( m_nRealizations < 1 ){
+        Application::instance()->logError( "EnsembleVariogramChecker::run(): " + m_realizations->getName() +
+                                           " has no realizations." );
+        return false;
+    }
+    m_variograms.resize( (size_t)m_nRealizations * nDirections * m_nLags );
+
+    unsigned int nThreads = m_nThreads ? m_nThreads : std::max( 1u, std::thread::hardware_concurrency() );
+    nThreads = std::min( nThreads, (unsigned int)m_nRealizations );
+    std::vector< std::pair< int, int > > ranges = Util::generateSubRanges( 0, m_nRealizations - 1, nThreads );
+    std::vector< std::thread > threads;
+    for( size_t iThread = 0; iThread < ranges.size(); ++iThread )
+        threads.push_back( std::thread( [&, iThread](){
+            std::vector<double> sums( m_nLags );
+            std::vector<long> counts( m_nLags );
+            for( int iReal = ranges[iThread].first; iReal <= ranges[iThread].second; ++iReal ){
+                std::vector<double> values = store.getRealization( iReal );
+                if( hasNDV )
+                    for( double& value : values )
+                        if( Util::almostEqual2sComplement( value, NDV, 1 ) )
+                            value = std::numeric_limits<double>::quiet_NaN();
+                for( int iDir = 0; iDir < nDirections; ++iDir ){
+                    const VariogramLagStep& step = m_steps[iDir];
+                    std::fill( sums.begin(), sums.end(), 0.0 );
+                    std::fill( counts.begin(), counts.end(), 0 );
+                    for( long k = 0; k < nK; ++k )
+                        for( long j = 0; j < nJ; ++j )
+                            for( long i = 0; i < nI; ++i ){
+                                double tail = values[ i + nI * ( j + nJ * k ) ];
+                                if( ! std::isfinite( tail ) )
+                                    continue;
+                                for( int iLag = 0; iLag < m_nLags; ++iLag ){
+                                    long hi = i + ( iLag + 1 ) * step.x;
+                                    long hj = j + ( iLag + 1 ) * step.y;
+                                    long hk = k + ( iLag + 1 ) * step.z;
+                                    //the lags beyond the grid in this direction are all beyond it
+                                    if( hi < 0 || hi >= nI || hj < 0 || hj >= nJ || hk < 0 || hk >= nK )
+                                        break;
+                                    double head = values[ hi + nI * ( hj + nJ * hk ) ];
+                                    if( std::isfinite( head ) ){
+                                        sums[iLag] += ( head - tail ) * ( head - tail );
+                                        ++counts[iLag];
+                                    }
+                                }
+                            }
+                    for( int iLag = 0; iLag < m_nLags; ++iLag )
+                        m_variograms[ ( (size_t)iReal * nDirections + iDir ) * m_nLags + iLag ] =
+                                counts[iLag] ? sums[iLag] / ( 2.0 * counts[iLag] ) :
+                                               std::numeric_limits<double>::quiet_NaN();
+                }
+            }
+        }));
+    for( std::thread& thread : threads )
+        thread.join();
+
+    return true;
+}
+
+double EnsembleVariogramChecker::getLagDistance(int iDirection, int iLag) const
+{
+    const VariogramLagStep& step = m_steps[iDirection];
+    double dx = ( iLag + 1 ) * step.x * m_realizations->getDX();
+    double dy = ( iLag + 1 ) * step.y * m_realizations->getDY();
+    double dz = ( iLag + 1 ) * step.z * m_realizations->getDZ();
+    return std::sqrt( dx*dx + dy*dy + dz*dz );
+}
+
+double EnsembleVariogramChecker::getVariogram(int iRealization, int iDirection, int iLag) const
+{
+    return m_variograms[ ( (size_t)iRealization * m_steps.size() + iDirection ) * m_nLags + iLag ];
+}
+
+double EnsembleVariogramChecker::getModelVariogram(int iDirection, int iLag) const
+{
+    if( ! m_variogramModel )
+        return std::numeric_limits<double>::quiet_NaN();
+    const VariogramLagStep& step = m_steps[iDirection];
+    SpatialLocation origin( 0.0, 0.0, 0.0 );
+    SpatialLocation lag( ( iLag + 1 ) * step.x * m_realizations->getDX(),
+                         ( iLag + 1 ) * step.y * m_realizations->getDY(),
+                         ( iLag + 1 ) * step.z * m_realizations->getDZ() );
+    return GeostatsUtils::getGamma( m_variogramModel, origin, lag );
+}
+
+EnsembleVariogramChecker::Envelope EnsembleVariogramChecker::getEnvelope(int iDirection, int iLag) const
+{
+    std::vector<double> values;
+    values.reserve( m_nRealizations );
+    for( int iReal = 0; iReal < m_nRealizations; ++iReal ){
+        double value = getVariogram( iReal, iDirection, iLag );
+        if( std::isfinite( value ) )
+            values.push_back( value );
+    }
+    if( values.empty() ){
+        double NaN = std::numeric_limits<double>::quiet_NaN();
+        return { NaN, NaN, NaN, NaN, NaN, NaN };
+    }
+    std::sort( values.begin(), values.end() );
+    double sum = 0.0;
+    for( double value : values )
+        sum += value;
+    return { values.front(),
+             percentile( values, m_lowPercentile ),
+             percentile( values, 0.5 ),
+             percentile( values, m_highPercentile ),
+             values.back(),
+             sum / values.size() };
+}
+
+double EnsembleVariogramChecker::getModelCoverage(int iDirection) const
+{
+    int nLagsChecked = 0;
+    int nLagsCovered = 0;
+    for( int iLag = 0; iLag < m_nLags; ++iLag ){
+        double model = getModelVariogram( iDirection, iLag );
+        Envelope envelope = getEnvelope( iDirection, iLag );
+        if( ! std::isfinite( model ) || ! std::isfinite( envelope.low ) )
+            continue;
+        ++nLagsChecked;
+        if( model >= envelope.low && model <= envelope.high )
+            ++nLagsCovered;
+    }
+    return nLagsChecked ? (double)nLagsCovered / nLagsChecked : std::numeric_limits<double>::quiet_NaN();
+}
+
+std::vector<std::vector<double> > EnsembleVariogramChecker::getChartData(int iDirection) const
+{
+    std::vector< std::vector<double> > chartData;
+    for( int iLag = 0; iLag < m_nLags; ++iLag ){
+        Envelope envelope = getEnvelope( iDirection, iLag );
+        chartData.push_back( { getLagDistance( iDirection, iLag ),
+                               envelope.min,
+                               envelope.low,
+                               envelope.median,
+                               envelope.high,
+                               envelope.max,
+                               getModelVariogram( iDirection, iLag ) } );
+    }
+    return chartData;
+}
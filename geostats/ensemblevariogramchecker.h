@@ -0,0 +1,95 @@
+#ifndef ENSEMBLEVARIOGRAMCHECKER_H
+#define ENSEMBLEVARIOGRAMCHECKER_H
+
+#include <vector>
+#include "geostats/multivariatevariogramengine.h"
+
+class CartesianGrid;
+class VariogramModel;
+class GSLibParameterFile;
+
+/**
+ * The EnsembleVariogramChecker class checks the variogram reproduction of an ensemble of realizations (e.g. the
+ * output of sgsim) against the input variogram model.  It computes the directional experimental semivariograms of
+ * every realization (like GSLib's gam) and summarizes them per lag with an envelope (minimum, lower percentile,
+ * median, upper percentile and maximum) to compare with the model.
+ *
+ * The realizations are read from the grid's RealizationStore and processed concurrently, one realization per
+ * thread at a time, in a single run instead of one gam run (and one read of the whole grid file) per realization.
+ * The variograms are accumulated lag by lag along the directions, which costs less than computing full variogram
+ * maps for the few directions and lags normally checked.
+ */
+class EnsembleVariogramChecker
+{
+public:
+    /** The statistics of the variogram values of the realizations at a lag. */
+    struct Envelope {
+        double min;
+        double low;
+        double median;
+        double high;
+        double max;
+        double mean;
+    };
+
+    /** @param realizations A grid with the realizations stacked in its first variable. */
+    EnsembleVariogramChecker( CartesianGrid* realizations );
+
+    void setLagSteps( const std::vector<VariogramLagStep>& steps, int nLags ){ m_steps = steps; m_nLags = nLags; }
+
+    /** Reads the directions and the number of lags from the parameters of GSLib's gam program. */
+    void setFromParameters( GSLibParameterFile* gamParameters );
+
+    /** The model to check the realizations against (optional). */
+    void setVariogramModel( VariogramModel* model ){ m_variogramModel = model; }
+
+    /** The probabilities of the lower and upper percentiles of the envelopes (default 0.05 and 0.95). */
+    void setEnvelopePercentiles( double low, double high ){ m_lowPercentile = low; m_highPercentile = high; }
+
+    /** Zero means the number of logical processors. */
+    void setNumberOfThreads( unsigned int nThreads ){ m_nThreads = nThreads; }
+
+    /** Computes the variograms of all realizations.  Returns false on failure. */
+    bool run();
+
+    int getRealizationCount() const { return m_nRealizations; }
+    int getDirectionCount() const { return m_steps.size(); }
+    int getLagCount() const { return m_nLags; }
+    const VariogramLagStep& getLagStep( int iDirection ) const { return m_steps[iDirection]; }
+
+    /** Returns the distance of a lag (starting with 0, which is the first step) of a direction. */
+    double getLagDistance( int iDirection, int iLag ) const;
+
+    /** Returns the variogram of a realization at a lag or NaN if there are no pairs. */
+    double getVariogram( int iRealization, int iDirection, int iLag ) const;
+
+    /** Returns the model's variogram at a lag or NaN if no model was set. */
+    double getModelVariogram( int iDirection, int iLag ) const;
+
+    /** Returns the envelope of the realizations' variograms at a lag (NaNs if no realization has pairs). */
+    Envelope getEnvelope( int iDirection, int iLag ) const;
+
+    /** Returns the fraction of the lags of a direction whose model value is within the percentile envelope. */
+    double getModelCoverage( int iDirection ) const;
+
+    /**
+     * Returns the results of a direction for plotting with LineChartWidget: one row per lag with
+     * distance, minimum, lower percentile, median, upper percentile, maximum and model (NaN if none).
+     */
+    std::vector< std::vector<double> > getChartData( int iDirection ) const;
+
+private:
+    CartesianGrid* m_realizations;
+    std::vector<VariogramLagStep> m_steps;
+    int m_nLags;
+    VariogramModel* m_variogramModel;
+    double m_lowPercentile;
+    double m_highPercentile;
+    unsigned int m_nThreads;
+
+    int m_nRealizations;
+    /** Variogram values indexed by (iRealization * nDirections + iDirection) * nLags + iLag. */
+    std::vector<double> m_variograms;
+};
+
+#endif // ENSEMBLEVARIOGRAMCHECKER_H
@@ -5,6 +5,7 @@
 #include "domain/pointset.h"
 #include "domain/attribute.h"
 #include "domain/application.h"
+#include "domain/datamemorymanager.h"
 #include "domain/segmentset.h"
 #include "fkestimationrunner.h"
 #include "datacell.h"
@@ -172,6 +173,10 @@ std::vector<double> FKEstimation::run( )
         }
     }
 
+    //the estimation reads the data from another thread, so they cannot be freed to stay within the memory budget
+    DataFilePin inputDataPin( input_datafile );
+    DataFilePin estimationGridPin( m_cg_estimation );
+
     //loads data previously to prevent clash with the progress dialog of both data
     //loading and estimation running.
     input_datafile->loadData();
@@ -10,6 +10,7 @@
 #include "domain/project.h"
 
 #include <random>
+#include <numeric>
 
 
 MCMCDataImputation::MCMCDataImputation() :
@@ -58,19 +59,32 @@ bool MCMCDataImputation::run()
         //get the empty realization dataframe
         std::vector< std::vector<double> >& imputedDataRealization = m_imputedData[iReal];
 
-        //get the data set as either grouped by some variable or as is.
-        std::vector< std::vector< std::vector<double> > > dataFrame;
+        //get the data rows as either grouped by some variable or as is, sorted to meet the sequence criterion
+        //wanted by the user.  These are views (row indexes) cached in the data set, so no data are copied and
+        //the sorting is done only once for all realizations.
+        std::vector< DataFileRowIndexRange > dataFrame;
         m_dataSet->loadData();
-        if( m_atVariableGroupBy )
-            dataFrame = m_dataSet->getDataGroupedBy( m_atVariableGroupBy->getAttributeGEOEASgivenIndex()-1 );
-        else
-            dataFrame.push_back( m_dataSet->getDataTable() );
+        std::vector< uint > allRowIndexes;
+        if( m_atVariableGroupBy ) {
+            const DataFileGroupsView& groupsView = m_dataSet->getRowIndexesGroupedBy(
+                        m_atVariableGroupBy->getAttributeGEOEASgivenIndex()-1, sortByColumnIndex, ascendingOrDescending );
+            for( size_t iGroup = 0; iGroup < groupsView.getGroupCount(); ++iGroup )
+                dataFrame.push_back( groupsView.getGroup( iGroup ) );
+        } else {
+            if( sortByColumnIndex >= 0 )
+                allRowIndexes = m_dataSet->getRowIndexesSortedBy( sortByColumnIndex, ascendingOrDescending );
+            else {
+                allRowIndexes.resize( m_dataSet->getDataLineCount() );
+                std::iota( allRowIndexes.begin(), allRowIndexes.end(), 0 );
+            }
+            dataFrame.push_back( { allRowIndexes.data(), allRowIndexes.data() + allRowIndexes.size() } );
+        }
 
         //keep track of the data row in the data file
         int currentDataRow = 0;
 
         //for each data group (may be just one)
-        for( std::vector< std::vector< double > >& dataGroup : dataFrame ){
+        for( const DataFileRowIndexRange& dataGroup : dataFrame ){
 
             double previousHeadX = std::numeric_limits<double>::quiet_NaN();
             double previousHeadY = std::numeric_limits<double>::quiet_NaN();
@@ -81,11 +95,9 @@ bool MCMCDataImputation::run()
 
             int previousFaciesCode = m_dataSet->getNoDataValueAsDouble();
 
-            //Sort the data group to meet the sequence criterion wanted by the user.
-            Util::sortDataFrame( dataGroup, sortByColumnIndex, ascendingOrDescending );
-
             //for each data row (for each segment)
-            for( std::vector< double >& dataRow : dataGroup ){
+            for( uint dataRowIndex : dataGroup ){
+                const std::vector< double >& dataRow = m_dataSet->getDataRow( dataRowIndex );
 
                 // get segment geometry
                 double currentHeadX = dataRow[ m_dataSet->getXindex()-1 ];
@@ -235,8 +247,8 @@ bool MCMCDataImputation::run()
 
                     } //while imputing
                 } else { //informed data is just copied to the output
-                    dataRow.push_back( 0 ); //apends the imputed=no flag to the output
                     imputedDataRealization.push_back( dataRow );
+                    imputedDataRealization.back().push_back( 0 ); //apends the imputed=no flag to the output
                 }
 
                 // keep track of segment geometry for the next iteration to determine connectivity.
@@ -16,6 +16,7 @@
 #include "geostats/pointsetcell.h"
 #include "geostats/segmentsetcell.h"
 #include "geostats/pointsetcell.h"
+#include "geostats/postsimulationengine.h"
 #include "spatialindex/spatialindex.h"
 #include "util.h"
 
@@ -23,6 +24,7 @@
 #include <QApplication>
 #include <QProgressDialog>
 #include <QDir>
+#include <QFileInfo>
 #include <QRegularExpression>
 #include <fstream>
 
@@ -873,6 +875,19 @@ bool MCRFSim::run()
                                       m_tauFactorForProbabilityFields );
     }
 
+    //the realizations that do not go to the simulation grid are also written to a realization store
+    //(as 32-bit floats, which hold the facies codes exactly)
+    m_realizationStore.close();
+    if( m_commonSimulationParameters->getSaveRealizationsOption() != 0 ){
+        QString storePath = Application::instance()->getProject()->getTmpPath() + '/' +
+                            QFileInfo( m_cgSim->getPath() ).fileName() + ".mcrf.rstore";
+        if( ! m_realizationStore.create( storePath, (long)nI * nJ * nK, nRealizations,
+                                         RealizationStore::ValueType::FLOAT32 ) ){
+            m_lastError = "Could not create the realization store " + storePath + ".";
+            return false;
+        }
+    }
+
     //configure and display a progress bar for the simulation task
     //////////////////////////////////
     m_progressDialog = new QProgressDialog;
@@ -934,6 +949,10 @@ bool MCRFSim::run()
     //hide the progress dialog
     delete m_progressDialog;
 
+    //the realizations remain saved where the user opted even if the store fails.
+    if( m_realizationStore.isOpen() && ! m_realizationStore.finish() )
+        Application::instance()->logWarn( "MCRFSim::run(): the realizations will not be available for post-processing." );
+
     //define the realization variables as categorical (depending on how user opted for
     //saving them).
     switch ( m_commonSimulationParameters->getSaveRealizationsOption() ) {
@@ -945,6 +964,10 @@ bool MCRFSim::run()
             m_cgSim->updateChildObjectsCollection();
             //Get the number of variables of the simulation grid after the simulation.
             uint nVariablesAfter = m_cgSim->getDataColumnCount();
+            //keep the columns of the realizations for runPostsim()
+            m_realizationColumns.clear();
+            for( uint iVar = nVariablesAfter - nRealizations; iVar < nVariablesAfter; ++iVar )
+                m_realizationColumns.push_back( iVar );
             //set the new variables as categorical
             //iStop is used to stop iterating from back towards first variable.
             for( uint iVar = nVariablesAfter-1, iStop = 0; iStop < nRealizations; --iVar, ++iStop ){
@@ -1122,6 +1145,19 @@ void MCRFSim::saveRealizationMT( const spectral::arrayPtr simulatedData,
             reportFile.close();
         } // if( m_mode == MCRFMode::BAYESIAN )
 
+        //the realization also goes to the realization store, if any, with the cells in GEO-EAS order.
+        if( m_realizationStore.isOpen() ){
+            uint nI = simulatedData->M();
+            uint nJ = simulatedData->N();
+            uint nK = simulatedData->K();
+            std::vector<double> values( (size_t)nI * nJ * nK );
+            for( uint k = 0; k < nK; ++k )
+                for( uint j = 0; j < nJ; ++j )
+                    for( uint i = 0; i < nI; ++i )
+                        values[ i + nI * ( j + (size_t)nJ * k ) ] = (*simulatedData)( i, j, k );
+            m_realizationStore.writeRealization( m_realNumberForSaving - 1, values );
+        }
+
         //increases the realization number for the next realization to be saved
         m_realNumberForSaving++;
     }
@@ -1130,6 +1166,23 @@ void MCRFSim::saveRealizationMT( const spectral::arrayPtr simulatedData,
     lck.unlock();
 }
 
+QString MCRFSim::getRealizationStorePath() const
+{
+    if( m_commonSimulationParameters && m_commonSimulationParameters->getSaveRealizationsOption() != 0 )
+        return m_realizationStore.getPath();
+    return "";
+}
+
+bool MCRFSim::runPostsim(GSLibParameterFile *postsimParameters, const QString &outputPath) const
+{
+    if( m_commonSimulationParameters->getSaveRealizationsOption() == 0 )
+        return PostSimulationEngine::runPostsim( postsimParameters, m_cgSim, m_realizationColumns, outputPath );
+    RealizationStore store;
+    if( ! store.open( getRealizationStorePath() ) )
+        return false;
+    return PostSimulationEngine::runPostsim( postsimParameters, store, m_cgSim, outputPath );
+}
+
 MCRFMode MCRFSim::getMode() const
 {
     return m_mode;
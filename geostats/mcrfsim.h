@@ -10,6 +10,7 @@
 #include "geostats/searchstrategy.h"
 #include "geostats/gridcell.h"
 #include "geostats/taumodel.h"
+#include "geostats/realizationstore.h"
 
 class Attribute;
 class CartesianGrid;
@@ -18,6 +19,7 @@ class VerticalTransiogramModel;
 class CommonSimulationParameters;
 class QProgressDialog;
 class SpatialIndex;
+class GSLibParameterFile;
 
 /** Enum used to avoid the slow File::getFileType() in performance-critical code. */
 typedef DataSetType PrimaryDataType; //DataSetType is defined in util.h
@@ -197,6 +199,15 @@ public:
      */
     static int runUnattended();
 
+    /** Returns the path to the realization store written by the last run() if the realizations were not saved
+     * in the simulation grid (see RealizationStore), otherwise returns an empty string. */
+    QString getRealizationStorePath() const;
+
+    /** Post-processes the realizations of the last run() like GSLib's postsim (see PostSimulationEngine::runPostsim()).
+     * The realizations are read from the variables of the simulation grid or from the realization store,
+     * depending on where they were saved.  Returns false on failure. */
+    bool runPostsim( GSLibParameterFile* postsimParameters, const QString& outputPath ) const;
+
 private:
     /** The simulation execution mode.
      * NORMAL  : hyperparameters (e.g. Tau Model factors) remain the same across realizations.
@@ -254,6 +265,13 @@ private:
      */
     uint m_realNumberForSaving;
 
+    /** The realizations not saved in the simulation grid are also written here (in the project's tmp directory),
+     * so they can be post-processed without re-reading the realization files. */
+    RealizationStore m_realizationStore;
+
+    /** The data columns (starting with 0) of the realizations saved in the simulation grid by the last run(). */
+    std::vector<int> m_realizationColumns;
+
     /** Returns whether the simulation parameters are valid and consistent. */
     bool isOKtoRun();
 
@@ -0,0 +1,401 @@
+#include "multivariatevariogramengine.h"
+#include "domain/application.h"
+#include "domain/attribute.h"
+#include "domain/cartesiangrid.h"
+#include "domain/experimentalvariogram.h"
+#include "gslib/gslibparameterfiles/gslibparameterfile.h"
+#include "gslib/gslibparameterfiles/gslibparamtypes.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    /** Index of a (possibly negative) lag in a circular dimension of size n. */
+    inline long wrap( long h, long n ){
+        return h < 0 ? h + n : h;
+    }
+
+    /** Returns the forward transform of the grid values (in spectral::array order) padded with zeros. */
+    spectral::complex_array padAndTransform( const std::vector<double>& values,
+                                             long nI, long nJ, long nK,
+                                             long K1, long K2, long K3 ){
+        spectral::array padded( K1, K2, K3, 0.0 );
+        long idx = 0;
+        for( long i = 0; i < nI; ++i )
+            for( long j = 0; j < nJ; ++j )
+                for( long k = 0; k < nK; ++k, ++idx )
+                    padded( i, j, k ) = values[idx];
+        spectral::complex_array transform;
+        spectral::foward( transform, padded.d_, K1, K2, K3 );
+        return transform;
+    }
+}
+
+MultivariateVariogramEngine::MultivariateVariogramEngine() :
+    m_nI( 0 ), m_nJ( 0 ), m_nK( 0 ),
+    m_K1( 0 ), m_K2( 0 ), m_K3( 0 ),
+    m_dx( 1.0 ), m_dy( 1.0 ), m_dz( 1.0 ),
+    m_trimMin( -1e21 ), m_trimMax( 1e21 ),
+    m_maxLagI( -1 ), m_maxLagJ( -1 ), m_maxLagK( -1 ),
+    m_computeCrossVariograms( true ),
+    m_standardizeSills( false )
+{
+}
+
+int MultivariateVariogramEngine::addVariable(const spectral::array &values, const QString &name)
+{
+    if( m_names.empty() ){
+        m_nI = values.M();
+        m_nJ = values.N();
+        m_nK = values.K();
+        m_K1 = 2 * m_nI - 1;
+        m_K2 = 2 * m_nJ - 1;
+        m_K3 = 2 * m_nK - 1;
+    } else if( values.M() != m_nI || values.N() != m_nJ || values.K() != m_nK ){
+        Application::instance()->logError( "MultivariateVariogramEngine::addVariable(): variable " + name +
+                                           " does not have the dimensions of the first variable." );
+        return -1;
+    }
+
+    //no-data and trimmed values are set to zero and out of the mask
+    std::vector<double> masked( m_nI * m_nJ * m_nK, 0.0 );
+    std::vector<double> squares( m_nI * m_nJ * m_nK, 0.0 );
+    std::vector<char> mask( m_nI * m_nJ * m_nK, 0 );
+    double sum = 0.0, sum2 = 0.0;
+    long count = 0;
+    long idx = 0;
+    for( long i = 0; i < m_nI; ++i )
+        for( long j = 0; j < m_nJ; ++j )
+            for( long k = 0; k < m_nK; ++k, ++idx ){
+                double value = values( i, j, k );
+                if( std::isfinite( value ) && value >= m_trimMin && value < m_trimMax ){
+                    masked[idx] = value;
+                    squares[idx] = value * value;
+                    mask[idx] = 1;
+                    sum += value;
+                    sum2 += value * value;
+                    ++count;
+                }
+            }
+
+    //the mask transform is shared with a previous variable with the same mask
+    int iMask = -1;
+    for( uint m = 0; m < m_masks.size() && iMask < 0; ++m )
+        if( m_masks[m] == mask )
+            iMask = m;
+    if( iMask < 0 ){
+        std::vector<double> maskValues( mask.begin(), mask.end() );
+        m_maskTransforms.push_back( padAndTransform( maskValues, m_nI, m_nJ, m_nK, m_K1, m_K2, m_K3 ) );
+        m_masks.push_back( std::move( mask ) );
+        iMask = m_masks.size() - 1;
+    }
+
+    m_valueTransforms.push_back( padAndTransform( masked, m_nI, m_nJ, m_nK, m_K1, m_K2, m_K3 ) );
+    m_squareTransforms.push_back( padAndTransform( squares, m_nI, m_nJ, m_nK, m_K1, m_K2, m_K3 ) );
+    m_values.push_back( std::move( masked ) );
+    m_maskOfVariable.push_back( iMask );
+    double mean = count > 0 ? sum / count : 0.0;
+    m_variances.push_back( count > 0 ? sum2 / count - mean * mean : 0.0 );
+    m_names.push_back( name );
+    return m_names.size() - 1;
+}
+
+int MultivariateVariogramEngine::addVariable(CartesianGrid *grid, uint column)
+{
+    grid->loadData();
+    if( m_names.empty() )
+        setCellSizes( grid->getDX(), grid->getDY(), grid->getDZ() );
+    else if( grid->getDX() != m_dx || grid->getDY() != m_dy || grid->getDZ() != m_dz ){
+        Application::instance()->logError( "MultivariateVariogramEngine::addVariable(): grid " + grid->getName() +
+                                           " does not have the cell sizes of the first grid." );
+        return -1;
+    }
+    spectral::array* values = grid->createSpectralArray( column );
+    Attribute* attribute = grid->getAttributeFromGEOEASIndex( column + 1 );
+    int index = addVariable( *values, grid->getName() + ":" + ( attribute ? attribute->getName() : QString::number( column + 1 ) ) );
+    delete values;
+    return index;
+}
+
+void MultivariateVariogramEngine::setMaximumLags(const std::vector<VariogramLagStep> &steps, int nLags)
+{
+    m_maxLagI = m_maxLagJ = m_maxLagK = 0;
+    for( const VariogramLagStep& step : steps ){
+        m_maxLagI = std::max( m_maxLagI, std::abs( step.x ) * nLags );
+        m_maxLagJ = std::max( m_maxLagJ, std::abs( step.y ) * nLags );
+        m_maxLagK = std::max( m_maxLagK, std::abs( step.z ) * nLags );
+    }
+}
+
+bool MultivariateVariogramEngine::run()
+{
+    m_results.clear();
+    if( m_names.empty() ){
+        Application::instance()->logError( "MultivariateVariogramEngine::run(): no variables." );
+        return false;
+    }
+
+    long Li = m_maxLagI < 0 ? m_nI - 1 : std::min<long>( m_maxLagI, m_nI - 1 );
+    long Lj = m_maxLagJ < 0 ? m_nJ - 1 : std::min<long>( m_maxLagJ, m_nJ - 1 );
+    long Lk = m_maxLagK < 0 ? m_nK - 1 : std::min<long>( m_maxLagK, m_nK - 1 );
+    long K = m_K1 * m_K2 * m_K3;
+
+    std::vector<double> np( K ), s( K ), ma( K ), mb( K );
+    //the sums of the pair-difference semivariograms
+    std::vector<double> productTail( K ), productHead( K ), sBA( K );
+
+    for( int a = 0; a < getVariableCount(); ++a ){
+        for( int b = a; b < getVariableCount(); ++b ){
+            if( a != b && ! m_computeCrossVariograms )
+                continue;
+
+            //the correlations of the transforms (the backward transforms overwrite their inputs).
+            //backward( X.conj(Y) ) at h is Sum y(x)x(x+h): Y is the tail and X is the head.
+            const spectral::complex_array& A = m_valueTransforms[a];
+            const spectral::complex_array& B = m_valueTransforms[b];
+            const spectral::complex_array& NPA = m_maskTransforms[ m_maskOfVariable[a] ];
+            const spectral::complex_array& NPB = m_maskTransforms[ m_maskOfVariable[b] ];
+            const bool pairDifference = m_maskOfVariable[a] == m_maskOfVariable[b];
+            {
+                spectral::complex_array product( A.size() );
+                product.dot_conj( NPB, NPA );
+                spectral::backward( np, product, m_K1, m_K2, m_K3 );
+                product.dot_conj( B, A );
+                spectral::backward( s, product, m_K1, m_K2, m_K3 );
+                product.dot_conj( NPB, A );
+                spectral::backward( ma, product, m_K1, m_K2, m_K3 );
+                product.dot_conj( B, NPA );
+                spectral::backward( mb, product, m_K1, m_K2, m_K3 );
+                if( pairDifference ){
+                    //the transform of a*b is that of the square for the direct variograms
+                    spectral::complex_array productOfVariablesTransform;
+                    if( a != b ){
+                        std::vector<double> productOfVariables( m_values[a].size() );
+                        for( size_t idx = 0; idx < productOfVariables.size(); ++idx )
+                            productOfVariables[idx] = m_values[a][idx] * m_values[b][idx];
+                        productOfVariablesTransform = padAndTransform( productOfVariables, m_nI, m_nJ, m_nK, m_K1, m_K2, m_K3 );
+                    }
+                    const spectral::complex_array& P = a != b ? productOfVariablesTransform : m_squareTransforms[a];
+                    product.dot_conj( NPA, P );
+                    spectral::backward( productTail, product, m_K1, m_K2, m_K3 );
+                    product.dot_conj( P, NPA );
+                    spectral::backward( productHead, product, m_K1, m_K2, m_K3 );
+                    if( a != b ){
+                        product.dot_conj( A, B );
+                        spectral::backward( sBA, product, m_K1, m_K2, m_K3 );
+                    }
+                }
+            }
+            const std::vector<double>& sumBtailAhead = a != b ? sBA : s;
+
+            //the pair count and the tail and head means at a lag in the padded (circular) arrays.
+            //Returns the index of the lag in the arrays or -1 if there are no pairs.
+            auto pairsAt = [&]( long hi, long hj, long hk, double& pairs, double& tailMean, double& headMean ){
+                long idx = ( wrap( hi, m_K1 ) * m_K2 + wrap( hj, m_K2 ) ) * m_K3 + wrap( hk, m_K3 );
+                pairs = std::round( np[idx] / K );
+                if( pairs < 1.0 ){
+                    tailMean = headMean = std::numeric_limits<double>::quiet_NaN();
+                    return -1L;
+                }
+                tailMean = ma[idx] / K / pairs;
+                headMean = mb[idx] / K / pairs;
+                return idx;
+            };
+
+            //the covariance at a lag
+            auto covarianceAt = [&]( long hi, long hj, long hk, double& pairs, double& tailMean, double& headMean ){
+                long idx = pairsAt( hi, hj, hk, pairs, tailMean, headMean );
+                if( idx < 0 )
+                    return std::numeric_limits<double>::quiet_NaN();
+                return s[idx] / K / pairs - tailMean * headMean;
+            };
+
+            //the pair-difference semivariogram at a lag
+            auto semivariogramAt = [&]( long hi, long hj, long hk, double& pairs, double& tailMean, double& headMean ){
+                long idx = pairsAt( hi, hj, hk, pairs, tailMean, headMean );
+                if( idx < 0 )
+                    return std::numeric_limits<double>::quiet_NaN();
+                return ( productTail[idx] + productHead[idx] - s[idx] - sumBtailAhead[idx] ) / K / ( 2.0 * pairs );
+            };
+
+            PairMaps maps;
+            maps.a = a;
+            maps.b = b;
+            maps.pairDifference = pairDifference;
+            maps.variogram = spectral::array( 2*Li+1, 2*Lj+1, 2*Lk+1, 0.0 );
+            maps.pairs = spectral::array( 2*Li+1, 2*Lj+1, 2*Lk+1, 0.0 );
+            maps.tailMean = spectral::array( 2*Li+1, 2*Lj+1, 2*Lk+1, 0.0 );
+            maps.headMean = spectral::array( 2*Li+1, 2*Lj+1, 2*Lk+1, 0.0 );
+
+            double pairs, tailMean, headMean;
+            double c0 = covarianceAt( 0, 0, 0, pairs, tailMean, headMean );
+            double sill = 1.0;
+            if( m_standardizeSills ){
+                sill = std::sqrt( m_variances[a] * m_variances[b] );
+                if( sill <= 0.0 || ! std::isfinite( sill ) )
+                    sill = 1.0;
+            }
+
+            for( long hi = -Li; hi <= Li; ++hi )
+                for( long hj = -Lj; hj <= Lj; ++hj )
+                    for( long hk = -Lk; hk <= Lk; ++hk ){
+                        double gamma;
+                        if( pairDifference ){
+                            gamma = semivariogramAt( hi, hj, hk, pairs, tailMean, headMean );
+                        } else {
+                            double cPlus = covarianceAt( hi, hj, hk, pairs, tailMean, headMean );
+                            double pairsMinus, tailMeanMinus, headMeanMinus;
+                            double cMinus = covarianceAt( -hi, -hj, -hk, pairsMinus, tailMeanMinus, headMeanMinus );
+                            //heterotopic cross-variograms may have pairs in only one of the directions
+                            double c;
+                            if( std::isfinite( cPlus ) && std::isfinite( cMinus ) )
+                                c = ( cPlus + cMinus ) / 2.0;
+                            else if( std::isfinite( cPlus ) )
+                                c = cPlus;
+                            else
+                                c = cMinus;
+                            gamma = c0 - c;
+                        }
+                        maps.variogram( hi+Li, hj+Lj, hk+Lk ) = gamma / sill;
+                        maps.pairs( hi+Li, hj+Lj, hk+Lk ) = pairs;
+                        maps.tailMean( hi+Li, hj+Lj, hk+Lk ) = tailMean;
+                        maps.headMean( hi+Li, hj+Lj, hk+Lk ) = headMean;
+                    }
+
+            m_results.push_back( std::move( maps ) );
+        }
+    }
+    return true;
+}
+
+const MultivariateVariogramEngine::PairMaps *MultivariateVariogramEngine::findPair(int a, int b) const
+{
+    for( const PairMaps& maps : m_results )
+        if( maps.a == a && maps.b == b )
+            return &maps;
+    return nullptr;
+}
+
+long MultivariateVariogramEngine::getMapIndex(const PairMaps &maps, int hi, int hj, int hk) const
+{
+    long Li = maps.variogram.M() / 2;
+    long Lj = maps.variogram.N() / 2;
+    long Lk = maps.variogram.K() / 2;
+    if( std::abs( hi ) > Li || std::abs( hj ) > Lj || std::abs( hk ) > Lk )
+        return -1;
+    return ( ( hi + Li ) * maps.variogram.N() + ( hj + Lj ) ) * maps.variogram.K() + ( hk + Lk );
+}
+
+bool MultivariateVariogramEngine::hasVariogram(int a, int b) const
+{
+    return findPair( std::min( a, b ), std::max( a, b ) ) != nullptr;
+}
+
+bool MultivariateVariogramEngine::isPairDifferenceVariogram(int a, int b) const
+{
+    const PairMaps* maps = findPair( std::min( a, b ), std::max( a, b ) );
+    return maps && maps->pairDifference;
+}
+
+double MultivariateVariogramEngine::getVariogram(int a, int b, int hi, int hj, int hk) const
+{
+    //the variograms are symmetric: gamma_ab(h) = gamma_ba(h) = gamma_ab(-h)
+    const PairMaps* maps = findPair( std::min( a, b ), std::max( a, b ) );
+    if( ! maps )
+        return std::numeric_limits<double>::quiet_NaN();
+    long idx = getMapIndex( *maps, hi, hj, hk );
+    if( idx < 0 )
+        return std::numeric_limits<double>::quiet_NaN();
+    return maps->variogram.d_[idx];
+}
+
+long MultivariateVariogramEngine::getPairCount(int a, int b, int hi, int hj, int hk) const
+{
+    //the pairs with tail in b and head in a at h are those with tail in a and head in b at -h
+    const PairMaps* maps = findPair( std::min( a, b ), std::max( a, b ) );
+    if( ! maps )
+        return 0;
+    long idx = a <= b ? getMapIndex( *maps, hi, hj, hk ) : getMapIndex( *maps, -hi, -hj, -hk );
+    if( idx < 0 )
+        return 0;
+    return (long)maps->pairs.d_[idx];
+}
+
+const spectral::array &MultivariateVariogramEngine::getVariogramMap(int a, int b) const
+{
+    static const spectral::array empty;
+    const PairMaps* maps = findPair( std::min( a, b ), std::max( a, b ) );
+    return maps ? maps->variogram : empty;
+}
+
+ExperimentalVariogram *MultivariateVariogramEngine::makeExperimentalVariogram(int a, int b,
+                                                                              const std::vector<VariogramLagStep> &steps,
+                                                                              int nLags,
+                                                                              const QString &path) const
+{
+    const PairMaps* maps = findPair( std::min( a, b ), std::max( a, b ) );
+    if( ! maps ){
+        Application::instance()->logError( "MultivariateVariogramEngine::makeExperimentalVariogram(): the variogram of "
+                                           "variables " + QString::number( a + 1 ) + " and " + QString::number( b + 1 ) +
+                                           " was not computed." );
+        return nullptr;
+    }
+
+    QFile file( path );
+    if( ! file.open( QFile::WriteOnly | QFile::Text ) ){
+        Application::instance()->logError( "MultivariateVariogramEngine::makeExperimentalVariogram(): could not write " +
+                                           path + "." );
+        return nullptr;
+    }
+    QTextStream out( &file );
+    //tail and head are swapped if the variables are in reverse order
+    int sign = a <= b ? 1 : -1;
+    for( uint iDir = 0; iDir < steps.size(); ++iDir ){
+        const VariogramLagStep& step = steps[iDir];
+        out << ( a == b ? "Semivariogram" : "Cross Semivariogram" )
+            << " tail:" << QString::number( a + 1 ).rightJustified( 3 )
+            << " head:" << QString::number( b + 1 ).rightJustified( 3 )
+            << " direction" << QString::number( iDir + 1 ).rightJustified( 3 ) << '\n';
+        for( int iLag = 1; iLag <= nLags; ++iLag ){
+            long idx = getMapIndex( *maps, sign * iLag * step.x, sign * iLag * step.y, sign * iLag * step.z );
+            double variogram = 0.0, pairs = 0.0, tailMean = 0.0, headMean = 0.0;
+            if( idx >= 0 && std::isfinite( maps->variogram.d_[idx] ) ){
+                variogram = maps->variogram.d_[idx];
+                pairs = maps->pairs.d_[idx];
+                tailMean = a <= b ? maps->tailMean.d_[idx] : maps->headMean.d_[idx];
+                headMean = a <= b ? maps->headMean.d_[idx] : maps->tailMean.d_[idx];
+            }
+            double distance = std::sqrt( std::pow( iLag * step.x * m_dx, 2 ) +
+                                         std::pow( iLag * step.y * m_dy, 2 ) +
+                                         std::pow( iLag * step.z * m_dz, 2 ) );
+            out << QString::number( iLag ).rightJustified( 4 ) << ' '
+                << QString::number( distance, 'f', 3 ).rightJustified( 12 ) << ' '
+                << QString::number( variogram, 'f', 5 ).rightJustified( 12 ) << ' '
+                << QString::number( (long)pairs ).rightJustified( 8 ) << ' '
+                << QString::number( tailMean, 'f', 5 ).rightJustified( 14 ) << ' '
+                << QString::number( headMean, 'f', 5 ).rightJustified( 14 ) << '\n';
+        }
+    }
+    file.close();
+
+    return new ExperimentalVariogram( path );
+}
+
+std::vector<VariogramLagStep> MultivariateVariogramEngine::getLagSteps(GSLibParameterFile *gamParameters, int &nLags)
+{
+    std::vector<VariogramLagStep> steps;
+    GSLibParMultiValuedFixed *par6 = gamParameters->getParameter<GSLibParMultiValuedFixed*>(6);
+    uint nDirections = par6->getParameter<GSLibParUInt*>(0)->_value;
+    nLags = par6->getParameter<GSLibParUInt*>(1)->_value;
+    GSLibParRepeat *par7 = gamParameters->getParameter<GSLibParRepeat*>(7); //repeat ndir-times
+    for( uint iDir = 0; iDir < nDirections; ++iDir ){
+        GSLibParMultiValuedFixed *par7_0 = par7->getParameter<GSLibParMultiValuedFixed*>(iDir, 0);
+        steps.push_back( { par7_0->getParameter<GSLibParInt*>(0)->_value,
+                           par7_0->getParameter<GSLibParInt*>(1)->_value,
+                           par7_0->getParameter<GSLibParInt*>(2)->_value } );
+    }
+    return steps;
+}
@@ -0,0 +1,156 @@
+#ifndef MULTIVARIATEVARIOGRAMENGINE_H
+#define MULTIVARIATEVARIOGRAMENGINE_H
+
+#include <vector>
+#include <QString>
+#include "spectral/spectral.h"
+
+class CartesianGrid;
+class ExperimentalVariogram;
+class GSLibParameterFile;
+
+/** A lag direction as the unit offsets (in cells) of GSLib's gam program. */
+struct VariogramLagStep {
+    int x;
+    int y;
+    int z;
+};
+
+/**
+ * The MultivariateVariogramEngine class computes the matrix of direct and cross-variograms of K variables
+ * defined on the same grid geometry (e.g. for fitting a linear model of coregionalization), replacing repeated
+ * runs of GSLib's gam program.
+ *
+ * The direct variograms and the cross-variograms of variables with the same no-data mask are the pair-difference
+ * semivariograms of gam (variogram types 1 and 2): with the values set to zero where the mask m is zero,
+ * 2 gamma_ab(h) N(h) = Sum m(x)m(x+h) [a(x+h)-a(x)][b(x+h)-b(x)]
+ *                    = Sum m(x)(ab)(x+h) + Sum (ab)(x)m(x+h) - Sum a(x)b(x+h) - Sum b(x)a(x+h),
+ * where N(h) = Sum m(x)m(x+h) is the number of pairs.  Each sum is a correlation computed with FFTs.  The
+ * cross-variograms of variables with different masks (heterotopic data) have no common pairs to difference, so they
+ * are computed from the FFT cross-covariances, like spectral::covariance(): C_ab(h) = E[a(x)b(x+h)] - m_a(h)m_b(h),
+ * where the means are taken over the pairs at lag h, and gamma_ab(h) = C_ab(0) - (C_ab(h) + C_ab(-h))/2.
+ *
+ * The forward transforms of each variable, of its square and of its mask are computed only once when the variable is
+ * added (variables with the same mask share its transform), so K variables cost at most 3K forward FFTs.  Each
+ * direct variogram map costs six backward FFTs and each cross-variogram map of variables with the same mask costs
+ * one more forward FFT (of the product of the variables) and seven backward FFTs.
+ *
+ * The transforms are kept in memory until the engine is destroyed: each takes about 8 bytes per cell of the grid
+ * padded to (2nI-1)(2nJ-1)(2nK-1) cells.  The values outside the trimming limits are no-data, like in gam.  The resulting maps are cropped to the lags set with setMaximumLags().
+ */
+class MultivariateVariogramEngine
+{
+public:
+    MultivariateVariogramEngine();
+
+    /**
+     * Adds a variable (NaN or infinite values are no-data).  All variables must have the dimensions of the first one.
+     * Returns the index of the variable or -1 on failure.
+     */
+    int addVariable( const spectral::array& values, const QString& name );
+
+    /** Adds a variable of a Cartesian grid given its column (starting with 0).  The grid's data are loaded if needed.
+     * The first grid sets the cell sizes, so a grid with other cell sizes is refused (-1 is returned). */
+    int addVariable( CartesianGrid* grid, uint column );
+
+    int getVariableCount() const { return m_names.size(); }
+
+    /** Values below tmin or greater than or equal to tmax are treated as no-data, like gam's trimming limits.
+     *  Must be set before the variables are added. */
+    void setTrimmingLimits( double tmin, double tmax ){ m_trimMin = tmin; m_trimMax = tmax; }
+
+    /** Whether the variogram of the given pair of variables is gam's pair-difference semivariogram (true)
+     *  or the covariance-based variogram used for variables with different no-data masks (false). */
+    bool isPairDifferenceVariogram( int a, int b ) const;
+
+    /** The cell sizes used to compute the lag distances. */
+    void setCellSizes( double dx, double dy, double dz ){ m_dx = dx; m_dy = dy; m_dz = dz; }
+
+    /** Limits the computed maps to lags within +/- the given number of cells.  Negative values mean no limit. */
+    void setMaximumLags( int nI, int nJ, int nK ){ m_maxLagI = nI; m_maxLagJ = nJ; m_maxLagK = nK; }
+
+    /** Limits the computed maps to the lags needed to sample nLags lags along the given directions. */
+    void setMaximumLags( const std::vector<VariogramLagStep>& steps, int nLags );
+
+    /** If false, only the direct variograms are computed. */
+    void setComputeCrossVariograms( bool compute ){ m_computeCrossVariograms = compute; }
+
+    /** If true, the variograms are divided by the variance (sqrt(var_a*var_b) for cross-variograms),
+     *  like gam's option to standardize sills. */
+    void setStandardizeSills( bool standardize ){ m_standardizeSills = standardize; }
+
+    /** Computes the variogram maps of all pairs of variables.  Returns false if there are no variables. */
+    bool run();
+
+    /** Whether the variogram of the given pair of variables was computed. */
+    bool hasVariogram( int a, int b ) const;
+
+    /** Returns the variogram at the lag (in cells) or NaN if there are no pairs or the lag is beyond the maps. */
+    double getVariogram( int a, int b, int hi, int hj, int hk ) const;
+
+    /** Returns the number of pairs (tail in a, head in b) at the lag. */
+    long getPairCount( int a, int b, int hi, int hj, int hk ) const;
+
+    /**
+     * Returns the variogram map of a pair of variables as an array with (2Li+1, 2Lj+1, 2Lk+1) cells, where L are the
+     * maximum lags, such that lag zero is at the center.  Lags without pairs are NaN.
+     */
+    const spectral::array& getVariogramMap( int a, int b ) const;
+
+    /**
+     * Writes the variogram of a pair of variables along the given directions in the format of gam's output
+     * (a header line for each direction followed by one line per lag: lag number, distance, variogram,
+     * number of pairs, tail mean and head mean) and returns an ExperimentalVariogram object for the file.
+     * The object is not added to the project; the caller takes its ownership.  Returns nullptr on failure.
+     */
+    ExperimentalVariogram* makeExperimentalVariogram( int a, int b,
+                                                      const std::vector<VariogramLagStep>& steps,
+                                                      int nLags,
+                                                      const QString& path ) const;
+
+    /** Reads the lag directions and the number of lags from the parameters of GSLib's gam program. */
+    static std::vector<VariogramLagStep> getLagSteps( GSLibParameterFile* gamParameters, int& nLags );
+
+private:
+    /** The variogram map, pair counts and lag means of a pair of variables. */
+    struct PairMaps {
+        int a;
+        int b;
+        /** See isPairDifferenceVariogram(). */
+        bool pairDifference;
+        spectral::array variogram;
+        spectral::array pairs;
+        spectral::array tailMean;
+        spectral::array headMean;
+    };
+
+    std::vector<QString> m_names;
+    /** Grid dimensions of the variables and of the padded transforms. */
+    long m_nI, m_nJ, m_nK;
+    long m_K1, m_K2, m_K3;
+    /** The variables (no-data set to zero) and their forward transforms and those of their squares. */
+    std::vector< std::vector<double> > m_values;
+    std::vector<spectral::complex_array> m_valueTransforms;
+    std::vector<spectral::complex_array> m_squareTransforms;
+    /** Forward transforms of the distinct masks and the mask used by each variable. */
+    std::vector<spectral::complex_array> m_maskTransforms;
+    std::vector< std::vector<char> > m_masks;
+    std::vector<int> m_maskOfVariable;
+    /** Variances of the variables (for standardizing sills). */
+    std::vector<double> m_variances;
+
+    double m_dx, m_dy, m_dz;
+    double m_trimMin, m_trimMax;
+    int m_maxLagI, m_maxLagJ, m_maxLagK;
+    bool m_computeCrossVariograms;
+    bool m_standardizeSills;
+
+    std::vector<PairMaps> m_results;
+
+    const PairMaps* findPair( int a, int b ) const;
+
+    /** Index in the cropped maps of a lag or -1 if the lag is beyond the maps. */
+    long getMapIndex( const PairMaps& maps, int hi, int hj, int hk ) const;
+};
+
+#endif // MULTIVARIATEVARIOGRAMENGINE_H
@@ -3,6 +3,7 @@
 #include "domain/cartesiangrid.h"
 #include "domain/attribute.h"
 #include "domain/application.h"
+#include "domain/datamemorymanager.h"
 #include "gridcell.h"
 #include "ndvestimationrunner.h"
 #include <limits>
@@ -47,6 +48,9 @@ std::vector<double> NDVEstimation::run()
         }
     }
 
+    //the estimation reads the data from another thread, so they cannot be freed to stay within the memory budget
+    DataFilePin dataPin( cg );
+
     //loads data previously to prevent clash with the progress dialog of both data
     //loading and estimation running.
     cg->loadData();
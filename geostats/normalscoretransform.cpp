@@ -0,0 +1,386 @@
+#include "normalscoretransform.h"
+#include "domain/application.h"
+#include "domain/datafile.h"
+#include "domain/project.h"
+#include "gslib/gslibparameterfiles/gslibparameterfile.h"
+#include "gslib/gslibparameterfiles/gslibparamtypes.h"
+#include "util.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QDir>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace {
+    /** Interpolates between (xLow, yLow) and (xHigh, yHigh) with the given power, like GSLib's powint(). */
+    inline double powerInterpolation( double xLow, double xHigh, double yLow, double yHigh, double x, double power ){
+        if( xHigh - xLow < 1.0e-20 )
+            return ( yHigh + yLow ) / 2.0;
+        return yLow + ( yHigh - yLow ) * std::pow( ( x - xLow ) / ( xHigh - xLow ), power );
+    }
+
+    /** Reads the values and, optionally, the weights (column index zero means no weights) in a GEO-EAS file.
+     * The column indexes are GEO-EAS indexes (starting with 1). */
+    bool readGEOEASColumns( const QString& path, uint valueColumn, uint weightColumn,
+                            std::vector<double>& values, std::vector<double>& weights ){
+        QFile file( path );
+        if( ! file.open( QFile::ReadOnly | QFile::Text ) )
+            return false;
+        file.readLine();
+        int nVariables = Util::getFirstNumber( QString( file.readLine() ) );
+        for( int iVariable = 0; iVariable < nVariables; ++iVariable )
+            file.readLine();
+        while( ! file.atEnd() ){
+            QByteArray line = file.readLine();
+            if( line.trimmed().isEmpty() )
+                continue;
+            values.push_back( Util::getGEOEASLineValue( line.constData(), line.size(), valueColumn - 1 ) );
+            if( weightColumn > 0 )
+                weights.push_back( Util::getGEOEASLineValue( line.constData(), line.size(), weightColumn - 1 ) );
+        }
+        return true;
+    }
+}
+
+NormalScoreTransform::NormalScoreTransform() :
+    m_lowerTailModel( NormalScoreTailModel::LINEAR ),
+    m_zMin( 0.0 ),
+    m_lowerTailParameter( 1.0 ),
+    m_upperTailModel( NormalScoreTailModel::LINEAR ),
+    m_zMax( 0.0 ),
+    m_upperTailParameter( 1.0 )
+{
+}
+
+bool NormalScoreTransform::build(const std::vector<double> &values,
+                                 const std::vector<double> &weights,
+                                 double trimMin,
+                                 double trimMax)
+{
+    //gather the valid (value, weight) pairs
+    std::vector< std::pair<double, double> > data;
+    data.reserve( values.size() );
+    for( size_t i = 0; i < values.size(); ++i ){
+        double value = values[i];
+        double weight = weights.empty() ? 1.0 : weights[i];
+        if( std::isfinite( value ) && value >= trimMin && value < trimMax && std::isfinite( weight ) && weight > 0.0 )
+            data.push_back( { value, weight } );
+    }
+    m_values.clear();
+    m_scores.clear();
+    if( data.empty() ){
+        Application::instance()->logError( "NormalScoreTransform::build(): no valid values." );
+        return false;
+    }
+    std::sort( data.begin(), data.end() );
+
+    double totalWeight = 0.0;
+    for( const std::pair<double, double>& datum : data )
+        totalWeight += datum.second;
+
+    //each group of tied values gets the score of the mid-point of its cumulative probability interval.
+    double cumulativeWeight = 0.0;
+    for( size_t i = 0; i < data.size(); ){
+        double value = data[i].first;
+        double groupWeight = 0.0;
+        for( ; i < data.size() && data[i].first == value; ++i )
+            groupWeight += data[i].second;
+        double probability = ( cumulativeWeight + groupWeight / 2.0 ) / totalWeight;
+        cumulativeWeight += groupWeight;
+        m_values.push_back( value );
+        m_scores.push_back( gaussianInverse( probability ) );
+    }
+
+    //by default, no extrapolation beyond the data
+    m_zMin = m_values.front();
+    m_zMax = m_values.back();
+    return true;
+}
+
+bool NormalScoreTransform::readTable(const QString &path)
+{
+    QFile file( path );
+    if( ! file.open( QFile::ReadOnly | QFile::Text ) ){
+        Application::instance()->logError( "NormalScoreTransform::readTable(): could not open " + path + "." );
+        return false;
+    }
+    m_values.clear();
+    m_scores.clear();
+    while( ! file.atEnd() ){
+        QByteArray line = file.readLine();
+        double value = Util::getGEOEASLineValue( line.constData(), line.size(), 0 );
+        double score = Util::getGEOEASLineValue( line.constData(), line.size(), 1 );
+        if( ! std::isfinite( value ) || ! std::isfinite( score ) )
+            continue;
+        //nscore writes one entry per datum, so tied values are repeated.
+        if( ! m_values.empty() && value <= m_values.back() ){
+            if( value < m_values.back() ){
+                Application::instance()->logError( "NormalScoreTransform::readTable(): " + path + " is not sorted." );
+                m_values.clear();
+                m_scores.clear();
+                return false;
+            }
+            continue;
+        }
+        m_values.push_back( value );
+        m_scores.push_back( score );
+    }
+    if( m_values.empty() ){
+        Application::instance()->logError( "NormalScoreTransform::readTable(): " + path + " has no entries." );
+        return false;
+    }
+    m_zMin = m_values.front();
+    m_zMax = m_values.back();
+    return true;
+}
+
+bool NormalScoreTransform::writeTable(const QString &path) const
+{
+    QFile file( path );
+    if( ! file.open( QFile::WriteOnly | QFile::Text ) ){
+        Application::instance()->logError( "NormalScoreTransform::writeTable(): could not write " + path + "." );
+        return false;
+    }
+    QTextStream out( &file );
+    for( size_t i = 0; i < m_values.size(); ++i )
+        out << QString::number( m_values[i], 'g', 12 ) << ' ' << QString::number( m_scores[i], 'g', 12 ) << '\n';
+    return true;
+}
+
+void NormalScoreTransform::setLowerTail(NormalScoreTailModel model, double zMin, double parameter)
+{
+    if( model == NormalScoreTailModel::HYPERBOLIC ){
+        Application::instance()->logWarn( "NormalScoreTransform::setLowerTail(): the hyperbolic model is for the upper"
+                                          " tail only.  Using the linear model." );
+        model = NormalScoreTailModel::LINEAR;
+    }
+    m_lowerTailModel = model;
+    m_zMin = zMin;
+    m_lowerTailParameter = parameter;
+}
+
+void NormalScoreTransform::setUpperTail(NormalScoreTailModel model, double zMax, double parameter)
+{
+    m_upperTailModel = model;
+    m_zMax = zMax;
+    m_upperTailParameter = parameter;
+}
+
+double NormalScoreTransform::forward(double value) const
+{
+    if( ! std::isfinite( value ) || m_values.empty() )
+        return std::numeric_limits<double>::quiet_NaN();
+    if( value <= m_values.front() )
+        return m_scores.front();
+    if( value >= m_values.back() )
+        return m_scores.back();
+    size_t j = std::upper_bound( m_values.begin(), m_values.end(), value ) - m_values.begin();
+    return powerInterpolation( m_values[j-1], m_values[j], m_scores[j-1], m_scores[j], value, 1.0 );
+}
+
+double NormalScoreTransform::backward(double score) const
+{
+    if( ! std::isfinite( score ) || m_values.empty() )
+        return std::numeric_limits<double>::quiet_NaN();
+    double result;
+    if( score <= m_scores.front() ){
+        //lower tail (GSLib's backtr)
+        double cdfLow = gaussianCDF( m_scores.front() );
+        double cdf = gaussianCDF( score );
+        double power = m_lowerTailModel == NormalScoreTailModel::POWER ? 1.0 / m_lowerTailParameter : 1.0;
+        result = powerInterpolation( 0.0, cdfLow, m_zMin, m_values.front(), cdf, power );
+    } else if( score >= m_scores.back() ){
+        //upper tail
+        double cdfHigh = gaussianCDF( m_scores.back() );
+        double cdf = gaussianCDF( score );
+        if( m_upperTailModel == NormalScoreTailModel::HYPERBOLIC ){
+            double lambda = std::pow( m_values.back(), m_upperTailParameter ) * ( 1.0 - cdfHigh );
+            result = std::pow( lambda / std::max( 1.0 - cdf, 1.0e-20 ), 1.0 / m_upperTailParameter );
+            return std::max( result, m_values.back() );
+        }
+        double power = m_upperTailModel == NormalScoreTailModel::POWER ? 1.0 / m_upperTailParameter : 1.0;
+        result = powerInterpolation( cdfHigh, 1.0, m_values.back(), m_zMax, cdf, power );
+    } else {
+        size_t j = std::upper_bound( m_scores.begin(), m_scores.end(), score ) - m_scores.begin();
+        return powerInterpolation( m_scores[j-1], m_scores[j], m_values[j-1], m_values[j], score, 1.0 );
+    }
+    return std::min( std::max( result, m_zMin ), m_zMax );
+}
+
+template <typename F>
+void NormalScoreTransform::forEachRange(long count, unsigned int nThreads, F f)
+{
+    if( nThreads == 0 )
+        nThreads = std::max( 1u, std::thread::hardware_concurrency() );
+    //not worth a thread for small arrays.
+    const long minimumPerThread = 10000;
+    nThreads = std::max( 1L, std::min( (long)nThreads, count / minimumPerThread ) );
+    if( nThreads == 1 ){
+        f( 0, count );
+        return;
+    }
+    std::vector< std::thread > threads;
+    for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+        threads.push_back( std::thread( f, count * iThread / nThreads, count * ( iThread + 1 ) / nThreads ) );
+    for( std::thread& thread : threads )
+        thread.join();
+}
+
+void NormalScoreTransform::forward(const double *in, double *out, long count, unsigned int nThreads) const
+{
+    forEachRange( count, nThreads, [this, in, out]( long first, long end ){
+        for( long i = first; i < end; ++i )
+            out[i] = forward( in[i] );
+    });
+}
+
+void NormalScoreTransform::backward(const double *in, double *out, long count, unsigned int nThreads) const
+{
+    forEachRange( count, nThreads, [this, in, out]( long first, long end ){
+        for( long i = first; i < end; ++i )
+            out[i] = backward( in[i] );
+    });
+}
+
+bool NormalScoreTransform::runNScore(GSLibParameterFile *nscoreParameters,
+                                     DataFile *dataFile,
+                                     std::vector<double> &nScores,
+                                     NormalScoreTransform *transform)
+{
+    GSLibParMultiValuedFixed* par1 = nscoreParameters->getParameter<GSLibParMultiValuedFixed*>(1);
+    uint variableColumn = par1->getParameter<GSLibParUInt*>(0)->_value;
+    uint weightColumn = par1->getParameter<GSLibParUInt*>(1)->_value;
+    GSLibParMultiValuedFixed* par2 = nscoreParameters->getParameter<GSLibParMultiValuedFixed*>(2);
+    double trimMin = par2->getParameter<GSLibParDouble*>(0)->_value;
+    double trimMax = par2->getParameter<GSLibParDouble*>(1)->_value;
+    bool useReferenceDistribution = nscoreParameters->getParameter<GSLibParOption*>(3)->_selected_value == 1;
+
+    //the data to transform
+    dataFile->loadData();
+    const long nDataLines = dataFile->getDataLineCount();
+    const bool hasNDV = dataFile->hasNoDataValue();
+    const double NDV = hasNDV ? dataFile->getNoDataValueAsDouble() : -999.0;
+    std::vector<double> values( nDataLines );
+    std::vector<double> weights;
+    for( long iLine = 0; iLine < nDataLines; ++iLine ){
+        values[iLine] = dataFile->dataConst( iLine, variableColumn - 1 );
+        if( hasNDV && Util::almostEqual2sComplement( values[iLine], NDV, 1 ) )
+            values[iLine] = std::numeric_limits<double>::quiet_NaN();
+    }
+    if( weightColumn > 0 ){
+        weights.resize( nDataLines );
+        for( long iLine = 0; iLine < nDataLines; ++iLine )
+            weights[iLine] = dataFile->dataConst( iLine, weightColumn - 1 );
+    }
+
+    //the table is made from the data or from the reference distribution.
+    NormalScoreTransform localTransform;
+    if( ! transform )
+        transform = &localTransform;
+    bool ok;
+    if( useReferenceDistribution ){
+        GSLibParMultiValuedFixed* par5 = nscoreParameters->getParameter<GSLibParMultiValuedFixed*>(5);
+        std::vector<double> referenceValues, referenceWeights;
+        QString referencePath = nscoreParameters->getParameter<GSLibParFile*>(4)->_path;
+        if( ! readGEOEASColumns( referencePath,
+                                 par5->getParameter<GSLibParUInt*>(0)->_value,
+                                 par5->getParameter<GSLibParUInt*>(1)->_value,
+                                 referenceValues, referenceWeights ) ){
+            Application::instance()->logError( "NormalScoreTransform::runNScore(): could not read " + referencePath + "." );
+            return false;
+        }
+        ok = transform->build( referenceValues, referenceWeights, trimMin, trimMax );
+    } else
+        ok = transform->build( values, weights, trimMin, trimMax );
+    if( ! ok )
+        return false;
+
+    //invalid or trimmed values get the no-data value.
+    nScores.resize( nDataLines );
+    transform->forward( values.data(), nScores.data(), nDataLines );
+    for( long iLine = 0; iLine < nDataLines; ++iLine )
+        if( ! std::isfinite( nScores[iLine] ) || values[iLine] < trimMin || values[iLine] >= trimMax )
+            nScores[iLine] = NDV;
+
+    return transform->writeTable( nscoreParameters->getParameter<GSLibParFile*>(7)->_path );
+}
+
+uint NormalScoreTransform::addNormalScoreVariable(DataFile *dataFile,
+                                                  uint variableGEOEASindex,
+                                                  uint weightGEOEASindex,
+                                                  const QString &nScoreVariableName)
+{
+    dataFile->loadData();
+    const long nDataLines = dataFile->getDataLineCount();
+    const bool hasNDV = dataFile->hasNoDataValue();
+    const double NDV = hasNDV ? dataFile->getNoDataValueAsDouble() : -999.0;
+    std::vector<double> values( nDataLines );
+    std::vector<double> weights;
+    for( long iLine = 0; iLine < nDataLines; ++iLine ){
+        values[iLine] = dataFile->dataConst( iLine, variableGEOEASindex - 1 );
+        if( hasNDV && Util::almostEqual2sComplement( values[iLine], NDV, 1 ) )
+            values[iLine] = std::numeric_limits<double>::quiet_NaN();
+    }
+    if( weightGEOEASindex > 0 ){
+        weights.resize( nDataLines );
+        for( long iLine = 0; iLine < nDataLines; ++iLine )
+            weights[iLine] = dataFile->dataConst( iLine, weightGEOEASindex - 1 );
+    }
+
+    NormalScoreTransform transform;
+    if( ! transform.build( values, weights ) )
+        return 0;
+    std::vector<double> nScores( nDataLines );
+    transform.forward( values.data(), nScores.data(), nDataLines );
+    for( double& nScore : nScores )
+        if( ! std::isfinite( nScore ) )
+            nScore = NDV;
+
+    return addNormalScoreVariable( dataFile, variableGEOEASindex, nScores, transform, nScoreVariableName );
+}
+
+uint NormalScoreTransform::addNormalScoreVariable(DataFile *dataFile,
+                                                  uint variableGEOEASindex,
+                                                  const std::vector<double> &nScores,
+                                                  const NormalScoreTransform &transform,
+                                                  const QString &nScoreVariableName)
+{
+    //the transform table goes to the project directory.
+    QString trnFileName = dataFile->getName() + "_" + nScoreVariableName + ".trn";
+    QString trnPath = Application::instance()->getProject()->getPath() + QDir::separator() + trnFileName;
+    if( ! transform.writeTable( trnPath ) )
+        return 0;
+
+    uint nScoreGEOEASindex = dataFile->addNewDataColumn( nScoreVariableName, nScores ) + 1;
+    dataFile->addVariableNScoreVariableRelationship( variableGEOEASindex, nScoreGEOEASindex, trnFileName );
+    //the new variable is shown as the normal variable of the transformed one
+    dataFile->updateChildObjectsCollection();
+    return nScoreGEOEASindex;
+}
+
+double NormalScoreTransform::gaussianCDF(double score)
+{
+    return 0.5 * std::erfc( -score / std::sqrt( 2.0 ) );
+}
+
+double NormalScoreTransform::gaussianInverse(double probability)
+{
+    //Odeh and Evans (1974) rational approximation, as in GSLib's gauinv().
+    const double lim = 1.0e-10;
+    const double p0 = -0.322232431088, p1 = -1.0, p2 = -0.342242088547, p3 = -0.0204231210245, p4 = -0.0000453642210148;
+    const double q0 = 0.0993484626060, q1 = 0.588581570495, q2 = 0.531103462366, q3 = 0.103537752850, q4 = 0.0038560700634;
+    if( probability < lim )
+        return -1.0e10;
+    if( probability > 1.0 - lim )
+        return 1.0e10;
+    if( probability == 0.5 )
+        return 0.0;
+    double pp = probability > 0.5 ? 1.0 - probability : probability;
+    double y = std::sqrt( std::log( 1.0 / ( pp * pp ) ) );
+    double xp = y + ( ( ( ( y * p4 + p3 ) * y + p2 ) * y + p1 ) * y + p0 ) /
+                    ( ( ( ( y * q4 + q3 ) * y + q2 ) * y + q1 ) * y + q0 );
+    return probability < 0.5 ? -xp : xp;
+}
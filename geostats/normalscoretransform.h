@@ -0,0 +1,124 @@
+#ifndef NORMALSCORETRANSFORM_H
+#define NORMALSCORETRANSFORM_H
+
+#include <vector>
+#include <QString>
+
+class DataFile;
+class GSLibParameterFile;
+
+/** The models to extrapolate the back-transformed values beyond the transform table (GSLib's codes). */
+enum class NormalScoreTailModel : int {
+    LINEAR = 1,     //!< linear interpolation of the cdf to the minimum or maximum value.
+    POWER = 2,      //!< power model with the given parameter (omega).
+    HYPERBOLIC = 4  //!< hyperbolic model with the given parameter (upper tail only).
+};
+
+/**
+ * The NormalScoreTransform class is an in-process normal score transform table, like the .trn files made by GSLib's
+ * nscore program and used by backtr, sgsim, etc.  The table is built from (optionally declustered) data and maps
+ * values to standard normal scores and back.  Transforming values costs O(log n) per value (binary search in the
+ * table followed by linear interpolation) and the array versions of forward() and backward() run in parallel.
+ */
+class NormalScoreTransform
+{
+public:
+    NormalScoreTransform();
+
+    /**
+     * Builds the transform table from the given values.  Each value gets the normal score of the mid-point of its
+     * cumulative probability; tied values get the same score.
+     * @param weights Weights of the values (e.g. declustering weights).  If empty, all values have the same weight.
+     * Non-finite values, values outside [trimMin, trimMax) and values with non-positive weights are ignored.
+     * Returns false if no value is left.
+     */
+    bool build( const std::vector<double>& values,
+                const std::vector<double>& weights = std::vector<double>(),
+                double trimMin = -1.0e21,
+                double trimMax = 1.0e21 );
+
+    /** Reads a GSLib transform table (two columns: value and normal score).  Returns false on failure. */
+    bool readTable( const QString& path );
+
+    /** Writes the transform table in GSLib's format.  Returns false on failure. */
+    bool writeTable( const QString& path ) const;
+
+    /** Sets how values are back-transformed below the table's minimum (down to zMin).  HYPERBOLIC is not allowed. */
+    void setLowerTail( NormalScoreTailModel model, double zMin, double parameter = 1.0 );
+
+    /** Sets how values are back-transformed above the table's maximum (up to zMax). */
+    void setUpperTail( NormalScoreTailModel model, double zMax, double parameter = 1.0 );
+
+    /** Returns the number of distinct values in the table. */
+    int getTableSize() const { return m_values.size(); }
+    const std::vector<double>& getValues() const { return m_values; }
+    const std::vector<double>& getScores() const { return m_scores; }
+
+    /** Returns the normal score of a value (interpolated between table entries, clamped to the extreme scores).
+     * Non-finite values yield NaN. */
+    double forward( double value ) const;
+
+    /** Returns the back-transformed value of a normal score, extrapolating beyond the table with the tail models.
+     * Non-finite scores yield NaN. */
+    double backward( double score ) const;
+
+    //@{
+    /** Transform count values from in into out (which may be the same array) in parallel.
+     * @param nThreads Zero means the number of logical processors. */
+    void forward( const double* in, double* out, long count, unsigned int nThreads = 0 ) const;
+    void backward( const double* in, double* out, long count, unsigned int nThreads = 0 ) const;
+    //@}
+
+    /**
+     * Normal scores a variable of a data file in-process as GSLib's nscore with the given parameters would do
+     * (including the optional reference distribution).  The data file is not changed: the normal scores
+     * (no-data value where the input is invalid) are returned in nScores, one per data line, and the table
+     * is written to the path in the parameters.  Returns false on failure.
+     * @param transform If not null, receives the transform table.
+     */
+    static bool runNScore( GSLibParameterFile* nscoreParameters, DataFile* dataFile, std::vector<double>& nScores,
+                           NormalScoreTransform* transform = nullptr );
+
+    /**
+     * Adds the normal scores of a variable of a data file as a new variable and registers the relationship with
+     * DataFile::addVariableNScoreVariableRelationship(), writing the transform table in the project directory.
+     * Returns the GEO-EAS index of the new variable or zero on failure.
+     */
+    static uint addNormalScoreVariable( DataFile* dataFile,
+                                        uint variableGEOEASindex,
+                                        uint weightGEOEASindex,
+                                        const QString& nScoreVariableName );
+
+    /**
+     * Same as the other addNormalScoreVariable(), but with normal scores already computed (e.g. by runNScore()),
+     * one per data line, and the table they were computed with.
+     */
+    static uint addNormalScoreVariable( DataFile* dataFile,
+                                        uint variableGEOEASindex,
+                                        const std::vector<double>& nScores,
+                                        const NormalScoreTransform& transform,
+                                        const QString& nScoreVariableName );
+
+    /** Standard normal cumulative distribution function. */
+    static double gaussianCDF( double score );
+
+    /** Inverse of the standard normal cdf (GSLib's gauinv approximation, scores within +/-1e10). */
+    static double gaussianInverse( double probability );
+
+private:
+    /** Distinct values in ascending order and their normal scores. */
+    std::vector<double> m_values;
+    std::vector<double> m_scores;
+
+    NormalScoreTailModel m_lowerTailModel;
+    double m_zMin;
+    double m_lowerTailParameter;
+    NormalScoreTailModel m_upperTailModel;
+    double m_zMax;
+    double m_upperTailParameter;
+
+    /** Runs f( first, last ) over sub-ranges of [0, count) in parallel. */
+    template <typename F> static void forEachRange( long count, unsigned int nThreads, F f );
+};
+
+#endif // NORMALSCORETRANSFORM_H
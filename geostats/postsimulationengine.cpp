@@ -0,0 +1,409 @@
+#include "postsimulationengine.h"
+#include "realizationstore.h"
+#include "domain/application.h"
+#include "domain/datafile.h"
+#include "domain/cartesiangrid.h"
+#include "gslib/gslibparameterfiles/gslibparameterfile.h"
+#include "gslib/gslibparameterfiles/gslibparamtypes.h"
+#include "spectral/spectral.h"
+#include "util.h"
+
+#include <QFile>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <thread>
+
+const size_t PostSimulationEngine::EXACT_QUANTILES_MAX_BYTES = 512 * 1024 * 1024;
+
+namespace {
+    /** Number of doubles of the P-square state of a quantile (five heights and five positions). */
+    const int P2_STATE_SIZE = 10;
+
+    /** Updates the P-square markers of a quantile with the count-th value of a cell (Jain and Chlamtac, 1985). */
+    void updateP2( double* heights, double* positions, double probability, int count, double value ){
+        //the first five values are just stored.
+        if( count <= 5 ){
+            heights[ count - 1 ] = value;
+            if( count == 5 ){
+                std::sort( heights, heights + 5 );
+                for( int i = 0; i < 5; ++i )
+                    positions[i] = i + 1;
+            }
+            return;
+        }
+        //find the cell k of the markers such that heights[k] <= value < heights[k+1], extending the extremes if needed.
+        int k;
+        if( value < heights[0] ){
+            heights[0] = value;
+            k = 0;
+        } else if( value >= heights[4] ){
+            heights[4] = value;
+            k = 3;
+        } else {
+            k = 0;
+            while( value >= heights[k+1] )
+                ++k;
+        }
+        for( int i = k + 1; i < 5; ++i )
+            positions[i] += 1.0;
+        //adjust the heights of the middle markers if they are off their desired positions.
+        const double desiredIncrements[5] = { 0.0, probability / 2.0, probability, ( 1.0 + probability ) / 2.0, 1.0 };
+        for( int i = 1; i <= 3; ++i ){
+            double d = 1.0 + ( count - 1 ) * desiredIncrements[i] - positions[i];
+            if( ( d >= 1.0 && positions[i+1] - positions[i] > 1.0 ) ||
+                ( d <= -1.0 && positions[i-1] - positions[i] < -1.0 ) ){
+                int s = d > 0.0 ? 1 : -1;
+                //piecewise-parabolic prediction
+                double height = heights[i] + s / ( positions[i+1] - positions[i-1] ) *
+                        ( ( positions[i] - positions[i-1] + s ) * ( heights[i+1] - heights[i] ) / ( positions[i+1] - positions[i] ) +
+                          ( positions[i+1] - positions[i] - s ) * ( heights[i] - heights[i-1] ) / ( positions[i] - positions[i-1] ) );
+                //fall back to linear prediction if the parabolic one is not between the neighbors.
+                if( heights[i-1] < height && height < heights[i+1] )
+                    heights[i] = height;
+                else
+                    heights[i] = heights[i] + s * ( heights[i+s] - heights[i] ) / ( positions[i+s] - positions[i] );
+                positions[i] += s;
+            }
+        }
+    }
+}
+
+PostSimulationEngine::PostSimulationEngine(long nCells,
+                                           int nRealizations,
+                                           const std::vector<double> &thresholds,
+                                           const std::vector<double> &probabilities,
+                                           double trimMin,
+                                           double trimMax,
+                                           unsigned int nThreads) :
+    m_nCells( std::max( 0L, nCells ) ),
+    m_nRealizations( std::max( 0, nRealizations ) ),
+    m_thresholds( thresholds ),
+    m_probabilities( probabilities ),
+    m_trimMin( trimMin ),
+    m_trimMax( trimMax ),
+    m_hasNoDataValue( false ),
+    m_noDataValue( 0.0 ),
+    m_nThreads( nThreads ),
+    m_nRealizationsAdded( 0 ),
+    m_counts( m_nCells, 0 ),
+    m_means( m_nCells, 0.0 ),
+    m_M2s( m_nCells, 0.0 ),
+    m_countsAbove( m_nCells * thresholds.size(), 0 ),
+    m_sumsAbove( m_nCells * thresholds.size(), 0.0 ),
+    m_exactQuantiles( false )
+{
+    if( m_nThreads == 0 )
+        m_nThreads = std::max( 1u, std::thread::hardware_concurrency() );
+    if( ! m_probabilities.empty() ){
+        m_exactQuantiles = (size_t)m_nCells * m_nRealizations * sizeof(double) <= EXACT_QUANTILES_MAX_BYTES;
+        if( m_exactQuantiles )
+            m_values.resize( (size_t)m_nCells * m_nRealizations );
+        else
+            m_values.resize( (size_t)m_nCells * m_probabilities.size() * P2_STATE_SIZE );
+    }
+}
+
+void PostSimulationEngine::setNoDataValue(double noDataValue)
+{
+    m_hasNoDataValue = true;
+    m_noDataValue = noDataValue;
+}
+
+template <typename F>
+void PostSimulationEngine::forEachCellRange(F f) const
+{
+    if( m_nCells == 0 )
+        return;
+    long nThreads = std::min( (long)m_nThreads, m_nCells );
+    std::vector< std::thread > threads;
+    for( long iThread = 0; iThread < nThreads; ++iThread ){
+        long firstCell = m_nCells * iThread / nThreads;
+        long lastCell = m_nCells * ( iThread + 1 ) / nThreads - 1;
+        threads.push_back( std::thread( f, firstCell, lastCell ) );
+    }
+    for( std::thread& thread : threads )
+        thread.join();
+}
+
+void PostSimulationEngine::accumulate(long cell, double value)
+{
+    //trimming follows GSLib's convention: valid values are in [tmin, tmax).
+    if( ! std::isfinite( value ) || value < m_trimMin || value >= m_trimMax ||
+        ( m_hasNoDataValue && Util::almostEqual2sComplement( value, m_noDataValue, 1 ) ) )
+        return;
+
+    int count = ++m_counts[ cell ];
+
+    //Welford's online mean and variance
+    double delta = value - m_means[ cell ];
+    m_means[ cell ] += delta / count;
+    m_M2s[ cell ] += delta * ( value - m_means[ cell ] );
+
+    for( size_t iThreshold = 0; iThreshold < m_thresholds.size(); ++iThreshold )
+        if( value > m_thresholds[ iThreshold ] ){
+            size_t index = cell * m_thresholds.size() + iThreshold;
+            ++m_countsAbove[ index ];
+            m_sumsAbove[ index ] += value;
+        }
+
+    if( m_probabilities.empty() )
+        return;
+    if( m_exactQuantiles ){
+        if( count <= m_nRealizations )
+            m_values[ (size_t)cell * m_nRealizations + count - 1 ] = value;
+    } else {
+        for( size_t iProbability = 0; iProbability < m_probabilities.size(); ++iProbability ){
+            double* heights = &m_values[ ( (size_t)cell * m_probabilities.size() + iProbability ) * P2_STATE_SIZE ];
+            updateP2( heights, heights + 5, m_probabilities[ iProbability ], count, value );
+        }
+    }
+}
+
+void PostSimulationEngine::addRealization(const std::vector<double> &values)
+{
+    if( (long)values.size() != m_nCells ){
+        Application::instance()->logError( "PostSimulationEngine::addRealization(): the realization has " +
+                                           QString::number( values.size() ) + " values instead of " +
+                                           QString::number( m_nCells ) + ".  Nothing done." );
+        return;
+    }
+    if( m_exactQuantiles && m_nRealizationsAdded == m_nRealizations )
+        Application::instance()->logWarn( "PostSimulationEngine::addRealization(): more realizations than declared.  "
+                                          "The extra realizations do not count for the quantiles." );
+    forEachCellRange( [this, &values]( long firstCell, long lastCell ){
+        for( long cell = firstCell; cell <= lastCell; ++cell )
+            accumulate( cell, values[ cell ] );
+    });
+    ++m_nRealizationsAdded;
+}
+
+bool PostSimulationEngine::addRealizationsFromStore(const RealizationStore &store)
+{
+    if( store.getCellCount() != m_nCells || store.getRealizationCount() < m_nRealizations ){
+        Application::instance()->logError( "PostSimulationEngine::addRealizationsFromStore(): the store " + store.getPath() +
+                                           " has " + QString::number( store.getRealizationCount() ) + " realizations of " +
+                                           QString::number( store.getCellCount() ) + " cells instead of " +
+                                           QString::number( m_nRealizations ) + " realizations of " +
+                                           QString::number( m_nCells ) + " cells.  Nothing done." );
+        return false;
+    }
+    for( int iRealization = 0; iRealization < m_nRealizations; ++iRealization )
+        addRealization( store.getRealization( iRealization ) );
+    return true;
+}
+
+bool PostSimulationEngine::addRealizationsFromColumns(DataFile *dataFile, const std::vector<int> &columns)
+{
+    dataFile->loadData();
+    if( dataFile->hasNoDataValue() )
+        setNoDataValue( dataFile->getNoDataValueAsDouble() );
+    if( (long)dataFile->getDataLineCount() < m_nCells ){
+        Application::instance()->logError( "PostSimulationEngine::addRealizationsFromColumns(): " + dataFile->getName() +
+                                           " has fewer data lines than cells.  Nothing done." );
+        return false;
+    }
+    std::vector<double> values( m_nCells );
+    for( int column : columns ){
+        for( long cell = 0; cell < m_nCells; ++cell )
+            values[ cell ] = dataFile->dataConst( cell, column );
+        addRealization( values );
+    }
+    return true;
+}
+
+std::vector<double> PostSimulationEngine::getMean() const
+{
+    std::vector<double> result( m_nCells, std::numeric_limits<double>::quiet_NaN() );
+    for( long cell = 0; cell < m_nCells; ++cell )
+        if( m_counts[ cell ] > 0 )
+            result[ cell ] = m_means[ cell ];
+    return result;
+}
+
+std::vector<double> PostSimulationEngine::getVariance() const
+{
+    //the population variance, like postsim.
+    std::vector<double> result( m_nCells, std::numeric_limits<double>::quiet_NaN() );
+    for( long cell = 0; cell < m_nCells; ++cell )
+        if( m_counts[ cell ] > 0 )
+            result[ cell ] = m_M2s[ cell ] / m_counts[ cell ];
+    return result;
+}
+
+std::vector<double> PostSimulationEngine::getProbabilityAbove(int iThreshold) const
+{
+    std::vector<double> result( m_nCells, std::numeric_limits<double>::quiet_NaN() );
+    for( long cell = 0; cell < m_nCells; ++cell )
+        if( m_counts[ cell ] > 0 )
+            result[ cell ] = m_countsAbove[ cell * m_thresholds.size() + iThreshold ] / (double)m_counts[ cell ];
+    return result;
+}
+
+std::vector<double> PostSimulationEngine::getMeanAbove(int iThreshold) const
+{
+    std::vector<double> result( m_nCells, std::numeric_limits<double>::quiet_NaN() );
+    for( long cell = 0; cell < m_nCells; ++cell ){
+        size_t index = cell * m_thresholds.size() + iThreshold;
+        if( m_countsAbove[ index ] > 0 )
+            result[ cell ] = m_sumsAbove[ index ] / m_countsAbove[ index ];
+    }
+    return result;
+}
+
+double PostSimulationEngine::quantileOfSorted(const double *values, int count, double probability)
+{
+    //the i-th of n sorted values has cumulative probability (i + 0.5) / n; linear interpolation in between.
+    double position = probability * count - 0.5;
+    if( position <= 0.0 )
+        return values[0];
+    if( position >= count - 1 )
+        return values[ count - 1 ];
+    int i = (int)position;
+    double weight = position - i;
+    return values[i] * ( 1.0 - weight ) + values[i+1] * weight;
+}
+
+std::vector<double> PostSimulationEngine::getQuantile(int iProbability) const
+{
+    std::vector<double> result( m_nCells, std::numeric_limits<double>::quiet_NaN() );
+    const double probability = m_probabilities[ iProbability ];
+    forEachCellRange( [&]( long firstCell, long lastCell ){
+        std::vector<double> sorted;
+        for( long cell = firstCell; cell <= lastCell; ++cell ){
+            int count = m_counts[ cell ];
+            if( count == 0 )
+                continue;
+            const double* values;
+            if( m_exactQuantiles ){
+                count = std::min( count, m_nRealizations );
+                values = &m_values[ (size_t)cell * m_nRealizations ];
+            } else {
+                values = &m_values[ ( (size_t)cell * m_probabilities.size() + iProbability ) * P2_STATE_SIZE ];
+                if( count > 5 ){
+                    //the middle P-square marker estimates the quantile.
+                    result[ cell ] = values[2];
+                    continue;
+                }
+            }
+            sorted.assign( values, values + count );
+            std::sort( sorted.begin(), sorted.end() );
+            result[ cell ] = quantileOfSorted( sorted.data(), count, probability );
+        }
+    });
+    return result;
+}
+
+bool PostSimulationEngine::runPostsim(GSLibParameterFile *postsimParameters,
+                                      CartesianGrid *realizations,
+                                      const QString &outputPath)
+{
+    return runPostsim( postsimParameters, realizations, outputPath, [realizations]( PostSimulationEngine& engine ){
+        RealizationStore store;
+        return store.openForGrid( realizations ) && engine.addRealizationsFromStore( store );
+    });
+}
+
+bool PostSimulationEngine::runPostsim(GSLibParameterFile *postsimParameters,
+                                      CartesianGrid *grid,
+                                      const std::vector<int> &columns,
+                                      const QString &outputPath)
+{
+    return runPostsim( postsimParameters, grid, outputPath, [grid, &columns]( PostSimulationEngine& engine ){
+        return engine.addRealizationsFromColumns( grid, columns );
+    });
+}
+
+bool PostSimulationEngine::runPostsim(GSLibParameterFile *postsimParameters,
+                                      const RealizationStore &store,
+                                      CartesianGrid *grid,
+                                      const QString &outputPath)
+{
+    return runPostsim( postsimParameters, grid, outputPath, [&store]( PostSimulationEngine& engine ){
+        return engine.addRealizationsFromStore( store );
+    });
+}
+
+bool PostSimulationEngine::runPostsim(GSLibParameterFile *postsimParameters,
+                                      CartesianGrid *grid,
+                                      const QString &outputPath,
+                                      const std::function<bool (PostSimulationEngine &)> &addRealizations)
+{
+    //   number of realizations
+    int nRealizations = postsimParameters->getParameter<GSLibParUInt*>(1)->_value;
+    //   trimming limits
+    GSLibParMultiValuedFixed* par2 = postsimParameters->getParameter<GSLibParMultiValuedFixed*>(2);
+    double trimMin = par2->getParameter<GSLibParDouble*>(0)->_value;
+    double trimMax = par2->getParameter<GSLibParDouble*>(1)->_value;
+    //output option, output parameter
+    GSLibParMultiValuedFixed* par5 = postsimParameters->getParameter<GSLibParMultiValuedFixed*>(5);
+    int option = par5->getParameter<GSLibParOption*>(0)->_selected_value;
+    double parameter = par5->getParameter<GSLibParDouble*>(1)->_value;
+
+    std::vector<double> thresholds;
+    std::vector<double> probabilities;
+    switch( option ){
+    case 1: break; //E-type mean and conditional variance
+    case 2: thresholds.push_back( parameter ); break; //probability and mean above threshold
+    case 3: probabilities.push_back( parameter ); break; //quantile
+    case 4: probabilities.push_back( ( 1.0 - parameter ) / 2.0 ); //symmetric probability interval
+            probabilities.push_back( ( 1.0 + parameter ) / 2.0 ); break;
+    default:
+        Application::instance()->logError( "PostSimulationEngine::runPostsim(): unknown output option: " + QString::number( option ) + "." );
+        return false;
+    }
+
+    const long nI = grid->getNX();
+    const long nJ = grid->getNY();
+    const long nK = grid->getNZ();
+    PostSimulationEngine engine( nI * nJ * nK, nRealizations, thresholds, probabilities, trimMin, trimMax );
+    if( grid->hasNoDataValue() )
+        engine.setNoDataValue( grid->getNoDataValueAsDouble() );
+
+    Application::instance()->logInfo( "Post-processing " + QString::number( nRealizations ) + " realizations of " +
+                                      grid->getName() + "..." );
+    if( ! addRealizations( engine ) )
+        return false;
+    if( ! probabilities.empty() && ! engine.areQuantilesExact() )
+        Application::instance()->logWarn( "PostSimulationEngine::runPostsim(): the ensemble is too large for exact quantiles.  "
+                                          "The quantiles were estimated." );
+
+    //the engine's values are in GEO-EAS order.
+    auto toArray = [nI, nJ, nK]( const std::vector<double>& values ){
+        spectral::array result( (spectral::index)nI, (spectral::index)nJ, (spectral::index)nK );
+        for( long i = 0; i < nI; ++i )
+            for( long j = 0; j < nJ; ++j )
+                for( long k = 0; k < nK; ++k )
+                    result( i, j, k ) = values[ i + nI * ( j + nJ * k ) ];
+        return result;
+    };
+
+    //the output grid is built from scratch, so a previous output file must not contribute variables.
+    QFile::remove( outputPath );
+    CartesianGrid outputGrid( outputPath );
+    outputGrid.setInfoFromOtherCGonlyGridSpecs( grid );
+    outputGrid.setNoDataValue( "-999.0" );
+    CartesianGrid* output = &outputGrid;
+
+    switch( option ){
+    case 1:
+        output->append( "E-type", toArray( engine.getMean() ) );
+        output->append( "conditional variance", toArray( engine.getVariance() ) );
+        break;
+    case 2:
+        output->append( "prob. above " + QString::number( parameter ), toArray( engine.getProbabilityAbove( 0 ) ) );
+        output->append( "mean above " + QString::number( parameter ), toArray( engine.getMeanAbove( 0 ) ) );
+        break;
+    case 3:
+        output->append( "quantile " + QString::number( parameter ), toArray( engine.getQuantile( 0 ) ) );
+        break;
+    case 4:
+        output->append( "lower limit", toArray( engine.getQuantile( 0 ) ) );
+        output->append( "upper limit", toArray( engine.getQuantile( 1 ) ) );
+        break;
+    }
+    output->writeToFS();
+
+    Application::instance()->logInfo( "Post-processing of realizations completed." );
+    return true;
+}
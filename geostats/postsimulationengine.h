@@ -0,0 +1,142 @@
+#ifndef POSTSIMULATIONENGINE_H
+#define POSTSIMULATIONENGINE_H
+
+#include <vector>
+#include <functional>
+#include <QString>
+
+class DataFile;
+class RealizationStore;
+class CartesianGrid;
+class GSLibParameterFile;
+
+/**
+ * The PostSimulationEngine class computes per-cell summaries of an ensemble of realizations (e.g. from SGSIM, SISIM
+ * or MCRFSim) reading each realization only once, so the realizations need not be held in memory altogether.
+ * This is an in-process replacement of GSLib's postsim program.
+ *
+ * For each cell it accumulates:
+ *   - the mean (E-type) and the variance with Welford's online algorithm;
+ *   - the number of values above each threshold and their sum (for the probability and the mean above thresholds);
+ *   - the quantiles for the given probabilities.  The quantiles are exact if the ensemble fits in the memory budget
+ *     (see EXACT_QUANTILES_MAX_BYTES), otherwise they are estimated with the P-square algorithm of Jain and Chlamtac
+ *     (1985), which keeps five markers per quantile.
+ *
+ * Non-finite values, values outside the trimming limits and no-data values are ignored.  Cells without valid values
+ * yield NaN.  The accumulation of each realization is split among threads over the cells.
+ */
+class PostSimulationEngine
+{
+public:
+    /** The ensemble above this size (in bytes) has its quantiles estimated instead of computed exactly. */
+    static const size_t EXACT_QUANTILES_MAX_BYTES;
+
+    /**
+     * @param nCells Number of values in each realization.
+     * @param nRealizations Number of realizations that will be added.
+     * @param thresholds Thresholds for getProbabilityAbove() and getMeanAbove().
+     * @param probabilities Cumulative probabilities (between 0 and 1) of the quantiles for getQuantile().
+     * @param trimMin,trimMax Values outside these limits are ignored.
+     * @param nThreads Zero means the number of logical processors.
+     */
+    PostSimulationEngine( long nCells,
+                          int nRealizations,
+                          const std::vector<double>& thresholds,
+                          const std::vector<double>& probabilities,
+                          double trimMin = -1e21,
+                          double trimMax = 1e21,
+                          unsigned int nThreads = 0 );
+
+    /** Sets a value to be ignored (e.g. the no-data value of the realizations file). */
+    void setNoDataValue( double noDataValue );
+
+    /** Accumulates one realization.  values must have nCells elements. */
+    void addRealization( const std::vector<double>& values );
+
+    /** Accumulates the first nRealizations realizations of a store, reading one realization at a time.
+     * Returns false if the store does not match the number of cells or has fewer realizations. */
+    bool addRealizationsFromStore( const RealizationStore& store );
+
+    /** Accumulates the realizations stored as columns (starting with 0) of a data file (e.g. the output of MCRFSim
+     * saved in the simulation grid).  The file is loaded if necessary.  Returns false if the file has fewer data
+     * lines than cells. */
+    bool addRealizationsFromColumns( DataFile* dataFile, const std::vector<int>& columns );
+
+    int getRealizationCount() const { return m_nRealizationsAdded; }
+    bool areQuantilesExact() const { return m_exactQuantiles; }
+
+    //@{
+    /** Per-cell results (NaN for cells without valid values). */
+    std::vector<double> getMean() const;
+    std::vector<double> getVariance() const;
+    std::vector<double> getProbabilityAbove( int iThreshold ) const;
+    std::vector<double> getMeanAbove( int iThreshold ) const;
+    std::vector<double> getQuantile( int iProbability ) const;
+    //@}
+
+    /**
+     * Runs the post-processing set in the parameters of GSLib's postsim program (only the number of realizations,
+     * the trimming limits and the output option are used) on the realizations stacked in the first variable of
+     * a grid file.  The realizations are read through the grid's RealizationStore (see
+     * RealizationStore::openForGrid()), so the grid file is parsed only once for all the ensemble tools.  The results are written as a grid file with the same geometry as the realizations' grid
+     * (overwriting outputPath) with -999 as no-data value, like postsim.  Returns false on failure.
+     */
+    static bool runPostsim( GSLibParameterFile* postsimParameters,
+                            CartesianGrid* realizations,
+                            const QString& outputPath );
+
+    /** Same as runPostsim() above for realizations stored as columns of a grid. */
+    static bool runPostsim( GSLibParameterFile* postsimParameters,
+                            CartesianGrid* grid,
+                            const std::vector<int>& columns,
+                            const QString& outputPath );
+
+    /** Same as runPostsim() above for the realizations of a store.  grid gives the geometry of the realizations. */
+    static bool runPostsim( GSLibParameterFile* postsimParameters,
+                            const RealizationStore& store,
+                            CartesianGrid* grid,
+                            const QString& outputPath );
+
+private:
+    long m_nCells;
+    int m_nRealizations;
+    std::vector<double> m_thresholds;
+    std::vector<double> m_probabilities;
+    double m_trimMin;
+    double m_trimMax;
+    bool m_hasNoDataValue;
+    double m_noDataValue;
+    unsigned int m_nThreads;
+    int m_nRealizationsAdded;
+
+    //Welford's accumulators.
+    std::vector<int> m_counts;
+    std::vector<double> m_means;
+    std::vector<double> m_M2s;
+
+    //per cell and per threshold.
+    std::vector<int> m_countsAbove;
+    std::vector<double> m_sumsAbove;
+
+    /** If true, the valid values of each cell are kept in m_values (m_nRealizations values per cell).
+     * Otherwise, m_values holds the P-square markers (heights and positions) per cell and per probability. */
+    bool m_exactQuantiles;
+    std::vector<double> m_values;
+
+    /** Accumulates the value of cell. */
+    void accumulate( long cell, double value );
+
+    /** Runs f( firstCell, lastCell ) over ranges of cells in parallel. */
+    template <typename F> void forEachCellRange( F f ) const;
+
+    /** The common part of the runPostsim() overloads: addRealizations() feeds the realizations to the engine. */
+    static bool runPostsim( GSLibParameterFile* postsimParameters,
+                            CartesianGrid* grid,
+                            const QString& outputPath,
+                            const std::function< bool( PostSimulationEngine& ) >& addRealizations );
+
+    /** Returns the quantile of the first count (sorted) values with the probability mid-point convention. */
+    static double quantileOfSorted( const double* values, int count, double probability );
+};
+
+#endif // POSTSIMULATIONENGINE_H
@@ -17,6 +17,10 @@
 #include <QValueAxis>
 
 #include <thread>
+#include <cmath>
+#include <limits>
+
+#include <Eigen/Dense>
 
 #include <gsl/gsl_rng.h>
 #include <gsl/gsl_randist.h>
@@ -113,36 +117,146 @@ void taskEvaluateObjetiveInRangeOfIndividualsForGenetic(
         int iIndividual_final,
         std::vector< Individual >& population  //-->output parameter
         ) {
-    for( int iInd = iIndividual_initial; iInd <= iIndividual_final; ++iInd ){
-        Individual& ind = population[iInd];
-        ind.m_fValue = quad3DTrendModelFitRef.objectiveFunction( ind.m_parameters );
-    }
+    //gather the parameters of the individuals so they are all evaluated in a single pass over the data
+    int nIndividuals = iIndividual_final - iIndividual_initial + 1;
+    if( nIndividuals <= 0 )
+        return;
+    std::vector< Quad3DTrendModelFittingAuxDefs::Parameters > parameters( nIndividuals );
+    for( int iInd = 0; iInd < nIndividuals; ++iInd )
+        parameters[iInd] = population[iIndividual_initial + iInd].m_parameters;
+    std::vector< double > fValues( nIndividuals );
+    quad3DTrendModelFitRef.objectiveFunction( parameters.data(), nIndividuals, fValues.data() );
+    for( int iInd = 0; iInd < nIndividuals; ++iInd )
+        population[iIndividual_initial + iInd].m_fValue = fValues[iInd];
+}
+
+/**
+ * Updates the upper triangular factor R of the QR decomposition of a tall matrix with more rows (a block).
+ * This allows computing the R factor of a matrix with millions of rows in blocks (TSQR) with little memory.
+ * @param R The current R factor (square upper triangular matrix).  It is updated in place.
+ * @param block The rows to add to the decomposition (same number of columns as R).
+ */
+void updateTSQR( Eigen::MatrixXd& R, const Eigen::Ref< const Eigen::MatrixXd >& block ) {
+    Eigen::MatrixXd stacked( R.rows() + block.rows(), R.cols() );
+    stacked << R, block;
+    Eigen::HouseholderQR< Eigen::MatrixXd > qr( stacked );
+    R = qr.matrixQR().topRows( R.cols() ).triangularView< Eigen::Upper >();
 }
 
+/**
+ * The code for multithreaded QR factorization of the least squares problem for a range of samples.
+ * The matrix factored is [A|b], where A has the values of the nine model terms at the sample locations
+ * and b are the sample values.  Its 10x10 R factor holds all that is needed to solve the least squares
+ * problem: the 9x9 R factor of A, Q^T.b and the norm of the residuals.
+ * OUTPUT PARAMETER:
+ * @param R The 10x10 upper triangular R factor of [A|b] for the samples in the range.
+ */
+void taskFactorRangeOfSamples( const double* xs, const double* ys, const double* zs, const double* values,
+                               int iSample_initial,
+                               int iSample_final,
+                               Eigen::MatrixXd& R //-->output parameter
+                               ) {
+    constexpr int N_COLUMNS = Quad3DTrendModelFittingAuxDefs::N_PARAMS + 1;
+    R = Eigen::MatrixXd::Zero( N_COLUMNS, N_COLUMNS );
+    //the samples are processed in blocks, so the factorizations are done by Eigen's vectorized kernels.
+    constexpr int BLOCK_SIZE = 1024;
+    Eigen::MatrixXd Ab( BLOCK_SIZE, N_COLUMNS );
+    for( int iStart = iSample_initial; iStart <= iSample_final; iStart += BLOCK_SIZE ){
+        int n = std::min( BLOCK_SIZE, iSample_final - iStart + 1 );
+        for( int i = 0; i < n; ++i ){
+            double x = xs[iStart + i];
+            double y = ys[iStart + i];
+            double z = zs[iStart + i];
+            Ab(i,0) = x*x; Ab(i,1) = x*y; Ab(i,2) = x*z;
+            Ab(i,3) = y*y; Ab(i,4) = y*z; Ab(i,5) = z*z;
+            Ab(i,6) = x;   Ab(i,7) = y;   Ab(i,8) = z;
+            Ab(i,9) = values[iStart + i];
+        }
+        updateTSQR( R, Ab.topRows( n ) );
+    }
+}
 
 Quadratic3DTrendModelFitting::Quadratic3DTrendModelFitting( DataFile* dataFile, Attribute* attribute ) :
-    m_attribute(attribute), m_dataFile(dataFile)
+    m_attribute(attribute), m_dataFile(dataFile), m_isDataCached(false)
 {}
 
 double Quadratic3DTrendModelFitting::objectiveFunction( const Quad3DTrendModelFittingAuxDefs::Parameters& parameters ) const
 {
-    //the sum to compute the error mean to be returned
-    double sum = 0.0;
+    if( ! m_isDataCached )
+        cacheData();
+    double result;
+    objectiveFunction( &parameters, 1, &result );
+    return result;
+}
+
+void Quadratic3DTrendModelFitting::objectiveFunction( const Quad3DTrendModelFittingAuxDefs::Parameters* parameters,
+                                                      int nParameterSets,
+                                                      double* results ) const
+{
+    assert( m_isDataCached && "Quadratic3DTrendModelFitting::objectiveFunction(): data not cached.  Call cacheData() first." );
+
+    const Eigen::Index nSamples = m_values.size();
+    //the mean error is undefined without samples (the callers report that)
+    if( nSamples == 0 ){
+        for( int iSet = 0; iSet < nParameterSets; ++iSet )
+            results[iSet] = std::numeric_limits<double>::quiet_NaN();
+        return;
+    }
+    for( int iSet = 0; iSet < nParameterSets; ++iSet )
+        results[iSet] = 0.0;
+
+    //the data are processed in blocks that fit in the CPU cache (4 arrays x 2048 values x 8 bytes = 64kB)
+    //and all the sets of parameters are evaluated against a block before moving to the next one.
+    constexpr Eigen::Index BLOCK_SIZE = 2048;
+    for( Eigen::Index iStart = 0; iStart < nSamples; iStart += BLOCK_SIZE ){
+        const Eigen::Index n = std::min( BLOCK_SIZE, nSamples - iStart );
+        Eigen::Map< const Eigen::ArrayXd > x( m_xs.data() + iStart, n );
+        Eigen::Map< const Eigen::ArrayXd > y( m_ys.data() + iStart, n );
+        Eigen::Map< const Eigen::ArrayXd > z( m_zs.data() + iStart, n );
+        Eigen::Map< const Eigen::ArrayXd > observedValues( m_values.data() + iStart, n );
+        for( int iSet = 0; iSet < nParameterSets; ++iSet ){
+            const Quad3DTrendModelFittingAuxDefs::Parameters& p = parameters[iSet];
+            // use the trend model (defined by its parameters) to predict the values at the data locations.
+            // a*x*x + b*x*y + c*x*z + d*y*y + e*y*z + f*z*z + g*x + h*y + i*z is factored to save multiplications.
+            // Eigen evaluates this expression with SIMD instructions without temporary arrays.
+            // z is zero for 2D data sets, thus z-bearing terms vanish.
+            results[iSet] += ( observedValues - ( x * ( p.a * x + p.b * y + p.c * z + p.g ) +
+                                                  y * ( p.d * y + p.e * z + p.h ) +
+                                                  z * ( p.f * z + p.i ) ) ).abs().sum();
+        }
+    }
+
+    //return the mean of the absolute prediction errors
+    for( int iSet = 0; iSet < nParameterSets; ++iSet )
+        results[iSet] /= nSamples;
+}
+
+void Quadratic3DTrendModelFitting::cacheData() const
+{
+    // Fetch data from the data source.
+    m_dataFile->loadData();
 
     //get the no-data value in numeric form to improve performance
     double NDV = m_dataFile->getNoDataValueAsDouble();
     bool hasNDV = m_dataFile->hasNoDataValue();
 
     //if data is 2D, then the z-bearing terms are invariant.
-    constexpr int IS_3D = 1;
-    constexpr int IS_2D = 0;
-    int is3D = m_dataFile->isTridimensional() ? IS_3D : IS_2D;
+    bool is3D = m_dataFile->isTridimensional();
 
     uint16_t indexOfDependentVariable = m_attribute->getAttributeGEOEASgivenIndex()-1;
 
+    uint64_t nRows = m_dataFile->getDataLineCount();
+    m_xs.clear();
+    m_ys.clear();
+    m_zs.clear();
+    m_values.clear();
+    m_xs.reserve( nRows );
+    m_ys.reserve( nRows );
+    m_zs.reserve( nRows );
+    m_values.reserve( nRows );
+
     //for each observation
-    uint64_t count = 0;
-    for( int iRow = 0; iRow < m_dataFile->getDataLineCount(); iRow++ ){
+    for( uint64_t iRow = 0; iRow < nRows; iRow++ ){
         //get the observed value
         double observedValue = m_dataFile->dataConst( iRow, indexOfDependentVariable );
         //if observed value is valid (not no-data-value)
@@ -150,35 +264,14 @@ double Quadratic3DTrendModelFitting::objectiveFunction( const Quad3DTrendModelFi
             // get the xyz location of the current sample.
             double x, y, z;
             m_dataFile->getDataSpatialLocation( iRow, x, y, z );
-            // use the current trend model (defined by its parameters)
-            // to predict the value at the data location
-            double predictedValue;
-            switch (is3D) { //if is slower than a switch
-                case IS_3D:
-                    predictedValue = parameters.a * x * x +
-                    parameters.b * x * y +
-                    parameters.c * x * z +
-                    parameters.d * y * y +
-                    parameters.e * y * z +
-                    parameters.f * z * z +
-                    parameters.g * x +
-                    parameters.h * y +
-                    parameters.i * z ;
-                    break;
-                case IS_2D: //z-bearing terms are invariant in 2D datasets
-                    predictedValue = parameters.a * x * x +
-                    parameters.b * x * y +
-                    parameters.d * y * y +
-                    parameters.g * x +
-                    parameters.h * y;
-            }
-            //accumulate the observed - predicted differences (prediction errors)
-            double error = observedValue - predictedValue;
-            sum += std::abs(error);
-            count++;
+            m_xs.push_back( x );
+            m_ys.push_back( y );
+            m_zs.push_back( is3D ? z : 0.0 );
+            m_values.push_back( observedValue );
         }
     }
-    return sum / count;
+
+    m_isDataCached = true;
 }
 
 void Quadratic3DTrendModelFitting::initDomain( Quad3DTrendModelFittingAuxDefs::ParametersDomain& domain,
@@ -223,8 +316,13 @@ Quad3DTrendModelFittingAuxDefs::Parameters Quadratic3DTrendModelFitting::process
         return Quad3DTrendModelFittingAuxDefs::Parameters();
     }
 
-    // Fetch data from the data source.
-    m_dataFile->loadData();
+    // Fetch data from the data source into the data cache used by the objective function.
+    cacheData();
+    if( m_values.empty() ){
+        Application::instance()->logError( "Quadratic3DTrendModelFitting::processWithGenetic(): no samples to fit "
+                                           "the trend model to." );
+        return Quad3DTrendModelFittingAuxDefs::Parameters();
+    }
 
     //Initialize the optimization domain (boundary conditions)
     Quad3DTrendModelFittingAuxDefs::ParametersDomain domain;
@@ -400,10 +498,7 @@ Quad3DTrendModelFittingAuxDefs::Parameters Quadratic3DTrendModelFitting::process
         progressDialog.hide();
 
         //evaluate the individuals of final population
-        for( uint iInd = 0; iInd < population.size(); ++iInd ){
-            Individual& ind = population[iInd];
-            ind.m_fValue = objectiveFunction( ind.m_parameters );
-        }
+        taskEvaluateObjetiveInRangeOfIndividualsForGenetic( *this, 0, population.size()-1, population );
 
         //sort the population in ascending order (lower value == better fitness)
         std::sort( population.begin(), population.end() );
@@ -434,10 +529,10 @@ Quad3DTrendModelFittingAuxDefs::Parameters Quadratic3DTrendModelFitting::process
 //non-linear least squares solver.
 struct data {
     size_t count;
-    double* x;
-    double* y;
-    double* z;
-    double* value;
+    const double* x;
+    const double* y;
+    const double* z;
+    const double* value;
 };
 
 //locally defined C-style function for use with GSL's non-linear least squares solver.
@@ -448,10 +543,10 @@ int cost_f (const gsl_vector* model_parameters_x,
 
     // get data information
     size_t data_count =  static_cast<struct data *>(data)->count;
-    double *x =          static_cast<struct data *>(data)->x;
-    double *y =          static_cast<struct data *>(data)->y;
-    double *z =          static_cast<struct data *>(data)->z;
-    double *data_value = static_cast<struct data *>(data)->value;
+    const double *x =          static_cast<struct data *>(data)->x;
+    const double *y =          static_cast<struct data *>(data)->y;
+    const double *z =          static_cast<struct data *>(data)->z;
+    const double *data_value = static_cast<struct data *>(data)->value;
 
     // get trend model parameters
     double p0 = gsl_vector_get (model_parameters_x, 0);
@@ -497,9 +592,9 @@ int cost_df ( const gsl_vector * model_parameters_x,
 
     // get data information
     size_t data_count = static_cast<struct data *>(data)->count;
-    double *x =         static_cast<struct data *>(data)->x;
-    double *y =         static_cast<struct data *>(data)->y;
-    double *z =         static_cast<struct data *>(data)->z;
+    const double *x =         static_cast<struct data *>(data)->x;
+    const double *y =         static_cast<struct data *>(data)->y;
+    const double *z =         static_cast<struct data *>(data)->z;
 
     for (size_t i = 0; i < data_count; i++) {
         // An element of the Jacobian matrix: J(i,j) = ∂fi / ∂xj,
@@ -552,46 +647,110 @@ void iteration_callback( const size_t iter,
     }
 }
 
-Quad3DTrendModelFittingAuxDefs::Parameters Quadratic3DTrendModelFitting::processWithNonLinearLeastSquares() const
+Quad3DTrendModelFittingAuxDefs::Parameters Quadratic3DTrendModelFitting::processWithLinearLeastSquares( unsigned int nThreads ) const
 {
-    // load dataset
-    m_dataFile->loadData();
+    constexpr int N_PARAMS = Quad3DTrendModelFittingAuxDefs::N_PARAMS;
 
-    // set whether the data is 2D or 3D in Cartesian space
-    bool is3D = m_dataFile->isTridimensional();
+    if( nThreads == 0 )
+        nThreads = std::max( 1U, std::thread::hardware_concurrency() );
 
-    // determine the number of valid samples (no NDV)
-    size_t number_of_valid_samples = 0;
+    // load the sample locations and values into the data cache
+    cacheData();
+    const size_t number_of_samples = m_values.size();
+    if( number_of_samples == 0 ){
+        Application::instance()->logError( "Quadratic3DTrendModelFitting::processWithLinearLeastSquares(): "
+                                           "no samples to fit the trend model to." );
+        return Quad3DTrendModelFittingAuxDefs::Parameters();
+    }
+    if( number_of_samples < N_PARAMS ){
+        Application::instance()->logError( "Quadratic3DTrendModelFitting::processWithLinearLeastSquares(): "
+                                           "too few valid samples (" + QString::number( number_of_samples ) +
+                                           ") to fit the trend model." );
+        return Quad3DTrendModelFittingAuxDefs::Parameters();
+    }
+    nThreads = std::min<size_t>( nThreads, number_of_samples );
+
+    //distribute as evenly as possible (load balance) the samples amongst the threads.
+    std::vector< std::pair< int, int > > samplesIndexesRanges = Util::generateSubRanges( 0, number_of_samples-1, nThreads );
+
+    //create and start the threads.  Each thread factors the least squares problem for a range of samples.
+    std::vector< Eigen::MatrixXd > partialRs( nThreads );
     {
-        if( ! m_dataFile->hasNoDataValue() ){
-            number_of_valid_samples = m_dataFile->getDataLineCount();
-        } else {
-            double NDV = m_dataFile->getNoDataValueAsDouble();
-            int iColumn = m_attribute->getAttributeGEOEASgivenIndex() - 1;
-            for( int iRow = 0; iRow < m_dataFile->getDataLineCount(); iRow++){
-                double sample_value = m_dataFile->data( iRow, iColumn );
-                if( ! Util::almostEqual2sComplement( NDV, sample_value, 1 ))
-                    number_of_valid_samples++;
-            }
+        std::thread threads[nThreads];
+        unsigned int iThread = 0;
+        for( const std::pair< int, int >& samplesIndexesRange : samplesIndexesRanges ) {
+            threads[iThread] = std::thread( taskFactorRangeOfSamples,
+                                            m_xs.data(), m_ys.data(), m_zs.data(), m_values.data(),
+                                            samplesIndexesRange.first,
+                                            samplesIndexesRange.second,
+                                            std::ref( partialRs[iThread] ) //--> OUTPUT PARAMETER
+                                            );
+            ++iThread;
         }
+        //wait for the threads to finish.
+        for( unsigned int iThread = 0; iThread < nThreads; ++iThread)
+            threads[iThread].join();
     }
 
+    //merge the partial factorizations
+    Eigen::MatrixXd R = partialRs[0];
+    for( unsigned int iThread = 1; iThread < nThreads; ++iThread )
+        updateTSQR( R, partialRs[iThread] );
+
+    // the least squares solution is that of R.x = Q^T.b.  The columns are scaled to unit norm, otherwise
+    // the very different magnitudes of the terms with large coordinates (e.g. UTM) would hinder rank detection.
+    // Terms that are zero for all samples (e.g. z-bearing terms of 2D data) are set to zero.
+    Eigen::MatrixXd RA = R.topLeftCorner( N_PARAMS, N_PARAMS );
+    Eigen::VectorXd Qtb = R.col( N_PARAMS ).head( N_PARAMS );
+    Eigen::VectorXd scaling( N_PARAMS );
+    for( int i = 0; i < N_PARAMS; ++i ){
+        double norm = RA.col( i ).norm();
+        scaling(i) = norm > 0.0 ? 1.0 / norm : 0.0;
+    }
+
+    // solve.  The complete orthogonal decomposition yields the minimum-norm solution
+    // should the system be rank-deficient (e.g. samples lying on a plane or a line).
+    Eigen::CompleteOrthogonalDecomposition< Eigen::MatrixXd > cod( RA * scaling.asDiagonal() );
+    Eigen::VectorXd solution = scaling.asDiagonal() * cod.solve( Qtb );
+
+    Quad3DTrendModelFittingAuxDefs::Parameters result;
+    for( int i = 0; i < N_PARAMS; ++i )
+        result[i] = solution(i);
+
+    // output execution summary (the last diagonal element of R is the norm of the residuals of full-rank solutions)
+    Application::instance()->logInfo( "Quadratic3DTrendModelFitting::processWithLinearLeastSquares(): " +
+                                      QString::number( number_of_samples ) + " samples, rank = " +
+                                      QString::number( cod.rank() ) + "/" + QString::number( N_PARAMS ) +
+                                      ", RMS error = " + QString::number( std::abs( R( N_PARAMS, N_PARAMS ) ) / std::sqrt( number_of_samples ) ) +
+                                      ", mean absolute error = " + QString::number( objectiveFunction( result ) ) + "." );
+    for( int i = 0; i < N_PARAMS; ++i )
+        Application::instance()->logInfo( "p" + QString::number(i) + " = " + QString::number( result[i] ) );
+
+    return result;
+}
+
+Quad3DTrendModelFittingAuxDefs::Parameters Quadratic3DTrendModelFitting::processWithNonLinearLeastSquares() const
+{
+    // the linear least squares solution is the starting point (it also fills the data cache).
+    Quad3DTrendModelFittingAuxDefs::Parameters startingPoint = processWithLinearLeastSquares();
+    if( std::isnan( startingPoint.a ) )
+        return startingPoint; //too few samples (the error has already been reported)
+
+    // set whether the data is 2D or 3D in Cartesian space
+    bool is3D = m_dataFile->isTridimensional();
+
     // select non-linear least squares method (so far GSL only supports TRS).
     // TRS = Trust Region Subproblem.  This means that in a small 9-D cube around a given
     //       x,y,z location, the trend model is assumed near-constant value.
     const gsl_multifit_nlinear_type* T = gsl_multifit_nlinear_trust;
 
     // set the sizes of the problem
-    const size_t number_of_samples        = number_of_valid_samples;
+    const size_t number_of_samples        = m_values.size();
     constexpr size_t number_of_parameters = Quad3DTrendModelFittingAuxDefs::N_PARAMS;
 
-    // allocate data structures for algorithm operation
-    double* x           = new double[number_of_samples];
-    double* y           = new double[number_of_samples];
-    double* z           = new double[number_of_samples];
-    double* data_values = new double[number_of_samples];
-    double* weights     = new double[number_of_samples];
-    struct data dataSet = { number_of_samples, x, y, z, data_values };
+    // the data to be fitted are those in the data cache
+    std::vector< double > weights( number_of_samples, 1.0 );
+    struct data dataSet = { number_of_samples, m_xs.data(), m_ys.data(), m_zs.data(), m_values.data() };
 
     // GSL documentation is not very clear as to whatever this actually does but it is necessary.
     gsl_rng_env_setup();
@@ -606,23 +765,6 @@ Quad3DTrendModelFittingAuxDefs::Parameters Quadratic3DTrendModelFitting::process
     fdf.p = number_of_parameters;
     fdf.params = &dataSet;
 
-    // read the data to be fitted into the arrays
-    {
-        bool hasNDV = m_dataFile->hasNoDataValue();
-        double NDV = m_dataFile->getNoDataValueAsDouble();
-        int iColumn = m_attribute->getAttributeGEOEASgivenIndex() - 1;
-        size_t iDataArray = 0;
-        for( int iDataFileRow = 0; iDataFileRow < m_dataFile->getDataLineCount(); iDataFileRow++){
-            double sample_value = m_dataFile->data( iDataFileRow, iColumn );
-            if( ! hasNDV || ! Util::almostEqual2sComplement( NDV, sample_value, 1 )) {
-                data_values[iDataArray] = sample_value;
-                m_dataFile->getDataSpatialLocation( iDataFileRow, x[iDataArray], y[iDataArray], z[iDataArray] );
-                weights[iDataArray] = 1.0;
-                iDataArray++;
-            }
-        }
-    }
-
     // from this point on, the data file's contents are no longer needed, so deallocate them
     // to free up memory space
     m_dataFile->freeLoadedData();
@@ -634,11 +776,13 @@ Quad3DTrendModelFittingAuxDefs::Parameters Quadratic3DTrendModelFitting::process
     // initialize solver with starting point and weights
     //                         0    1    2     3    4   5     6    7    8
     //                         x² + xy + xz +  y²+ yz + z² +  x +  y +  z
-    double params_init[9] = { 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0 }; /* starting parameter values */
+    double params_init[9]; /* starting parameter values */
+    for( int i = 0; i < Quad3DTrendModelFittingAuxDefs::N_PARAMS; ++i )
+        params_init[i] = startingPoint[i];
     if( ! is3D ) //zero-out z-bearing terms
         params_init[2] = params_init[4] = params_init[5] = params_init[8] = 0.0;
-    gsl_vector_view parameters = gsl_vector_view_array (params_init, number_of_parameters);
-    gsl_vector_view wts =        gsl_vector_view_array (weights,     number_of_samples);
+    gsl_vector_view parameters = gsl_vector_view_array (params_init,    number_of_parameters);
+    gsl_vector_view wts =        gsl_vector_view_array (weights.data(), number_of_samples);
     gsl_multifit_nlinear_winit (&parameters.vector, &wts.vector, &fdf, workspace);
 
     // compute initial cost function
@@ -720,11 +864,6 @@ Quad3DTrendModelFittingAuxDefs::Parameters Quadratic3DTrendModelFitting::process
     gsl_multifit_nlinear_free (workspace);
     gsl_matrix_free (covar);
     gsl_rng_free (trusted_region);
-    delete[] x;
-    delete[] y;
-    delete[] z;
-    delete[] data_values;
-    delete[] weights;
 
     // return best-fit trend model
     auto get_par = [workspace](size_t i){ return gsl_vector_get(workspace->x, i); };
@@ -97,10 +97,28 @@ public:
 
     /** The objective function for an optimization process to find a minimum (ideally the global one).
      * @param parameters The parameters of the model to test.
-     * @return The sum of the differences between all the observed and predicted values.
+     * @return The mean of the absolute differences between all the observed and predicted values.
+     * @note The first call caches the data (see cacheData()), thus it is not thread-safe.
      */
     double objectiveFunction (const Quad3DTrendModelFittingAuxDefs::Parameters& parameters) const;
 
+    /** Evaluates the objective function for many sets of parameters in a single pass over the data.
+     * The data are traversed in blocks small enough to stay in the CPU cache while all the sets of
+     * parameters are evaluated against them and the evaluations are vectorized (SIMD) with Eigen.
+     * cacheData() must have been called before, so this method can be called from many threads at once.
+     * @param results Output array with one objective function value per set of parameters.  The values are NaN
+     *                if there are no samples.
+     */
+    void objectiveFunction( const Quad3DTrendModelFittingAuxDefs::Parameters* parameters,
+                            int nParameterSets,
+                            double* results ) const;
+
+    /** Reads the sample locations and values (skipping the no-data values) into contiguous arrays, which
+     * are used by the objective function and by the fitting methods.  This is called automatically by the
+     * processWith*() methods.  The z coordinates of 2D data sets are set to zero, so the z-bearing terms vanish.
+     */
+    void cacheData() const;
+
 
     /** Method called by a method of optimization to initialize the
      *  parameter domain (boundary conditions) and the set of parameters.
@@ -149,6 +167,21 @@ public:
                             double windowWindowShiftThreshold
             ) const;
 
+    /** Performs the trend model fitting by ordinary (linear) least squares.  The trend model is linear in its
+     * nine parameters, so the exact least squares solution is found directly, without iterations.  The problem
+     * is factored with Householder QR in blocks of samples, in parallel, and the partial factors are merged
+     * (TSQR), which takes a fraction of a second even for millions of samples.  QR is used instead of the normal
+     * equations because the quadratic terms of real-world coordinates (e.g. UTM) make the latter too
+     * ill-conditioned.
+     * @param nThreads Number of parallel execution threads.  Zero means the number of hardware threads.
+     * @returns The set of parameters of the fit trend model.  An all-NaN set of parameters is returned if
+     *          there are too few valid samples.
+     */
+    Quad3DTrendModelFittingAuxDefs::Parameters processWithLinearLeastSquares( unsigned int nThreads = 0 ) const;
+
+    /** Performs the trend model fitting with GSL's non-linear least squares solver (trust region method).
+     * The solver starts from the solution of processWithLinearLeastSquares().
+     */
     Quad3DTrendModelFittingAuxDefs::Parameters processWithNonLinearLeastSquares() const;
 
 
@@ -156,6 +189,14 @@ private:
     Attribute* m_attribute;
     DataFile* m_dataFile;
 
+    //-------------data cache (see cacheData())-----------
+    mutable std::vector< double > m_xs;
+    mutable std::vector< double > m_ys;
+    mutable std::vector< double > m_zs;
+    mutable std::vector< double > m_values;
+    mutable bool m_isDataCached;
+    //---------------------------------------------------
+
     /** The objective function values collected during the last execution
      * of an optimization method.
      */
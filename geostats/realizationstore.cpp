@@ -0,0 +1,364 @@
+#include "realizationstore.h"
+#include "domain/application.h"
+#include "domain/cartesiangrid.h"
+#include "domain/project.h"
+#include "util.h"
+
+#include <QFileInfo>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+const int RealizationStore::DEFAULT_CELLS_PER_CHUNK = 16384;
+
+namespace {
+    /** The file layout (values in the machine's byte order):
+     *   header (HEADER_SIZE bytes): magic, version, value type, compression flag, nCells, nRealizations,
+     *                               cells per chunk and the offset of the index (zero while the store is written);
+     *   the chunks, in the order they were written;
+     *   the index: offset and size (two int64) of each chunk, realization by realization. */
+    const char MAGIC[8] = { 'G', 'R', 'Y', 'R', 'E', 'A', 'L', 'S' };
+    const uint32_t VERSION = 1;
+    const int HEADER_SIZE = 64;
+
+    /** Above this number of chunks the cache of decompressed chunks is emptied. */
+    const size_t MIN_CHUNK_CACHE_SIZE = 64;
+}
+
+RealizationStore::RealizationStore() :
+    m_nCells( 0 ),
+    m_nRealizations( 0 ),
+    m_cellsPerChunk( DEFAULT_CELLS_PER_CHUNK ),
+    m_nChunksPerRealization( 0 ),
+    m_valueType( ValueType::FLOAT64 ),
+    m_compressed( false ),
+    m_writing( false ),
+    m_writeFailed( false ),
+    m_mappedFile( nullptr )
+{
+}
+
+RealizationStore::~RealizationStore()
+{
+    close();
+}
+
+bool RealizationStore::create(const QString &path,
+                              long nCells,
+                              int nRealizations,
+                              ValueType valueType,
+                              bool compressed,
+                              int cellsPerChunk)
+{
+    close();
+    m_file.setFileName( path );
+    if( ! m_file.open( QFile::ReadWrite | QFile::Truncate ) ){
+        Application::instance()->logError( "RealizationStore::create(): could not create " + path + "." );
+        return false;
+    }
+    m_nCells = nCells;
+    m_nRealizations = nRealizations;
+    m_cellsPerChunk = std::max( 1, cellsPerChunk );
+    m_nChunksPerRealization = ( m_nCells + m_cellsPerChunk - 1 ) / m_cellsPerChunk;
+    m_valueType = valueType;
+    m_compressed = compressed;
+    m_index.assign( (size_t)m_nChunksPerRealization * m_nRealizations, ChunkLocation{ 0, 0 } );
+    m_writeFailed = false;
+    if( ! writeHeader( 0 ) ){
+        Application::instance()->logError( "RealizationStore::create(): could not write to " + path + "." );
+        m_file.close();
+        return false;
+    }
+    m_writing = true;
+    return true;
+}
+
+bool RealizationStore::writeHeader(int64_t indexOffset)
+{
+    QByteArray header( HEADER_SIZE, '\0' );
+    char* h = header.data();
+    uint8_t valueType = (uint8_t)m_valueType;
+    uint8_t compressed = m_compressed ? 1 : 0;
+    int64_t nCells = m_nCells;
+    int32_t nRealizations = m_nRealizations;
+    int32_t cellsPerChunk = m_cellsPerChunk;
+    std::memcpy( h, MAGIC, 8 );
+    std::memcpy( h + 8, &VERSION, 4 );
+    std::memcpy( h + 12, &valueType, 1 );
+    std::memcpy( h + 13, &compressed, 1 );
+    std::memcpy( h + 16, &nCells, 8 );
+    std::memcpy( h + 24, &nRealizations, 4 );
+    std::memcpy( h + 28, &cellsPerChunk, 4 );
+    std::memcpy( h + 32, &indexOffset, 8 );
+    return m_file.seek( 0 ) && m_file.write( header ) == HEADER_SIZE;
+}
+
+int RealizationStore::getCellCountOfChunk(int iChunk) const
+{
+    return std::min( (long)m_cellsPerChunk, m_nCells - (long)iChunk * m_cellsPerChunk );
+}
+
+bool RealizationStore::writeRealization(int iRealization, const double *values)
+{
+    if( ! m_writing || iRealization < 0 || iRealization >= m_nRealizations ){
+        Application::instance()->logError( "RealizationStore::writeRealization(): store not open for writing or invalid"
+                                           " realization number: " + QString::number( iRealization ) + "." );
+        return false;
+    }
+    const int valueSize = getValueSize();
+    for( int iChunk = 0; iChunk < m_nChunksPerRealization; ++iChunk ){
+        //encode (and compress) the chunk out of the critical section.
+        const int count = getCellCountOfChunk( iChunk );
+        const double* chunkValues = values + (long)iChunk * m_cellsPerChunk;
+        QByteArray bytes( count * valueSize, Qt::Uninitialized );
+        if( m_valueType == ValueType::FLOAT32 ){
+            float* out = reinterpret_cast<float*>( bytes.data() );
+            for( int i = 0; i < count; ++i )
+                out[i] = (float)chunkValues[i];
+        } else
+            std::memcpy( bytes.data(), chunkValues, count * sizeof(double) );
+        if( m_compressed )
+            bytes = qCompress( bytes );
+
+        std::unique_lock<std::mutex> lock( m_mutex );
+        int64_t offset = m_file.size();
+        if( ! m_file.seek( offset ) || m_file.write( bytes ) != bytes.size() ){
+            //the store is unusable from now on: finish() fails.
+            m_writeFailed = true;
+            lock.unlock();
+            Application::instance()->logError( "RealizationStore::writeRealization(): failed to write realization #" +
+                                               QString::number( iRealization + 1 ) + " to " + m_file.fileName() + "." );
+            return false;
+        }
+        m_index[ (size_t)iRealization * m_nChunksPerRealization + iChunk ] = ChunkLocation{ offset, bytes.size() };
+    }
+    return true;
+}
+
+bool RealizationStore::writeRealization(int iRealization, const std::vector<double> &values)
+{
+    if( (long)values.size() != m_nCells ){
+        Application::instance()->logError( "RealizationStore::writeRealization(): the realization has " +
+                                           QString::number( values.size() ) + " values instead of " +
+                                           QString::number( m_nCells ) + "." );
+        return false;
+    }
+    return writeRealization( iRealization, values.data() );
+}
+
+bool RealizationStore::finish()
+{
+    if( ! m_writing )
+        return false;
+    m_writing = false;
+    int64_t indexOffset = m_file.size();
+    qint64 indexSize = m_index.size() * sizeof(ChunkLocation);
+    //the header gets the index offset only if everything else was written, so an incomplete store never opens.
+    bool ok = ! m_writeFailed && m_file.seek( indexOffset ) &&
+              m_file.write( reinterpret_cast<const char*>( m_index.data() ), indexSize ) == indexSize;
+    ok = ok && m_file.flush() && writeHeader( indexOffset );
+    ok = ok && m_file.flush();
+    m_file.close();
+    if( ! ok )
+        Application::instance()->logError( "RealizationStore::finish(): failed to write " + m_file.fileName() + "." );
+    return ok;
+}
+
+bool RealizationStore::open(const QString &path)
+{
+    close();
+    m_file.setFileName( path );
+    if( ! m_file.open( QFile::ReadOnly ) ){
+        Application::instance()->logError( "RealizationStore::open(): could not open " + path + "." );
+        return false;
+    }
+    QByteArray header = m_file.read( HEADER_SIZE );
+    const char* h = header.constData();
+    uint32_t version = 0;
+    uint8_t valueType = 0, compressed = 0;
+    int64_t nCells = 0, indexOffset = 0;
+    int32_t nRealizations = 0, cellsPerChunk = 0;
+    if( header.size() == HEADER_SIZE ){
+        std::memcpy( &version, h + 8, 4 );
+        std::memcpy( &valueType, h + 12, 1 );
+        std::memcpy( &compressed, h + 13, 1 );
+        std::memcpy( &nCells, h + 16, 8 );
+        std::memcpy( &nRealizations, h + 24, 4 );
+        std::memcpy( &cellsPerChunk, h + 28, 4 );
+        std::memcpy( &indexOffset, h + 32, 8 );
+    }
+    if( header.size() != HEADER_SIZE || std::memcmp( h, MAGIC, 8 ) || version != VERSION ||
+        indexOffset == 0 || cellsPerChunk <= 0 || valueType > (uint8_t)ValueType::FLOAT32 ){
+        Application::instance()->logError( "RealizationStore::open(): " + path + " is not a realization store"
+                                           " or it was not finished." );
+        m_file.close();
+        return false;
+    }
+    m_nCells = nCells;
+    m_nRealizations = nRealizations;
+    m_cellsPerChunk = cellsPerChunk;
+    m_nChunksPerRealization = ( m_nCells + m_cellsPerChunk - 1 ) / m_cellsPerChunk;
+    m_valueType = (ValueType)valueType;
+    m_compressed = compressed != 0;
+    m_index.resize( (size_t)m_nChunksPerRealization * m_nRealizations );
+    qint64 indexSize = m_index.size() * sizeof(ChunkLocation);
+    m_file.seek( indexOffset );
+    if( m_file.read( reinterpret_cast<char*>( m_index.data() ), indexSize ) != indexSize ){
+        Application::instance()->logError( "RealizationStore::open(): the index of " + path + " is truncated." );
+        m_file.close();
+        return false;
+    }
+    //uncompressed chunks are read directly from the mapped file (falls back to reading if mapping fails).
+    if( ! m_compressed )
+        m_mappedFile = m_file.map( 0, m_file.size() );
+    return true;
+}
+
+bool RealizationStore::openForGrid(CartesianGrid *grid)
+{
+    //the store is a cache: it goes to the project's tmp directory rather than next to the user's files
+    QString storePath = Application::instance()->getProject()->getTmpPath() + '/' +
+                        QFileInfo( grid->getPath() ).fileName() + ".rstore";
+    QFileInfo storeInfo( storePath );
+    if( ! storeInfo.exists() || storeInfo.lastModified() < QFileInfo( grid->getPath() ).lastModified() ){
+        Application::instance()->logInfo( "Indexing the realizations in " + grid->getPath() + "..." );
+        long nCells = (long)grid->getNX() * grid->getNY() * grid->getNZ();
+        if( ! importStackFile( grid->getPath(), 0, nCells, grid->getNReal(), storePath ) )
+            return false;
+    }
+    return open( storePath );
+}
+
+void RealizationStore::close()
+{
+    if( m_writing )
+        finish();
+    if( m_mappedFile ){
+        m_file.unmap( m_mappedFile );
+        m_mappedFile = nullptr;
+    }
+    if( m_file.isOpen() )
+        m_file.close();
+    m_chunkCache.clear();
+}
+
+QByteArray RealizationStore::getChunk(int iRealization, int iChunk) const
+{
+    const ChunkLocation& location = m_index[ (size_t)iRealization * m_nChunksPerRealization + iChunk ];
+    if( location.offset == 0 )
+        return QByteArray();
+    if( m_mappedFile )
+        return QByteArray::fromRawData( reinterpret_cast<const char*>( m_mappedFile + location.offset ), location.size );
+
+    std::unique_lock<std::mutex> lock( m_mutex );
+    auto it = m_chunkCache.find( location.offset );
+    if( it != m_chunkCache.end() )
+        return it->second;
+    m_file.seek( location.offset );
+    QByteArray bytes = m_file.read( location.size );
+    if( ! m_compressed )
+        return bytes;
+    bytes = qUncompress( bytes );
+    //the cache holds at least a whole column of chunks, so a run of getCellDistribution() calls reads each chunk once.
+    if( m_chunkCache.size() >= std::max( MIN_CHUNK_CACHE_SIZE, (size_t)m_nRealizations ) )
+        m_chunkCache.clear();
+    m_chunkCache[ location.offset ] = bytes;
+    return bytes;
+}
+
+void RealizationStore::decode(const char *bytes, int count, double *values) const
+{
+    if( m_valueType == ValueType::FLOAT32 ){
+        for( int i = 0; i < count; ++i ){
+            float value;
+            std::memcpy( &value, bytes + i * 4, 4 );
+            values[i] = value;
+        }
+    } else
+        std::memcpy( values, bytes, count * sizeof(double) );
+}
+
+void RealizationStore::readCells(int iRealization, long firstCell, long lastCell, double *values) const
+{
+    const int valueSize = getValueSize();
+    long cell = firstCell;
+    while( cell <= lastCell ){
+        int iChunk = cell / m_cellsPerChunk;
+        long chunkFirstCell = (long)iChunk * m_cellsPerChunk;
+        int count = std::min( lastCell, chunkFirstCell + getCellCountOfChunk( iChunk ) - 1 ) - cell + 1;
+        QByteArray chunk = getChunk( iRealization, iChunk );
+        if( chunk.isEmpty() )
+            std::fill( values, values + count, std::numeric_limits<double>::quiet_NaN() );
+        else
+            decode( chunk.constData() + ( cell - chunkFirstCell ) * valueSize, count, values );
+        values += count;
+        cell += count;
+    }
+}
+
+std::vector<double> RealizationStore::getRealization(int iRealization) const
+{
+    std::vector<double> result( m_nCells );
+    if( m_nCells > 0 )
+        readCells( iRealization, 0, m_nCells - 1, result.data() );
+    return result;
+}
+
+std::vector<double> RealizationStore::getCellDistribution(long cell) const
+{
+    std::vector<double> result( m_nRealizations );
+    for( int iRealization = 0; iRealization < m_nRealizations; ++iRealization )
+        readCells( iRealization, cell, cell, &result[ iRealization ] );
+    return result;
+}
+
+bool RealizationStore::importStackFile(const QString &geoeasPath,
+                                       int column,
+                                       long nCells,
+                                       int nRealizations,
+                                       const QString &storePath,
+                                       ValueType valueType,
+                                       bool compressed)
+{
+    QFile file( geoeasPath );
+    if( ! file.open( QFile::ReadOnly | QFile::Text ) ){
+        Application::instance()->logError( "RealizationStore::importStackFile(): could not open " + geoeasPath + "." );
+        return false;
+    }
+
+    //skip the header: title, number of variables and the variable names.
+    file.readLine();
+    int nVariables = Util::getFirstNumber( QString( file.readLine() ) );
+    for( int iVariable = 0; iVariable < nVariables; ++iVariable )
+        file.readLine();
+
+    RealizationStore store;
+    if( ! store.create( storePath, nCells, nRealizations, valueType, compressed ) )
+        return false;
+    std::vector<double> values( nCells );
+    for( int iRealization = 0; iRealization < nRealizations; ++iRealization ){
+        for( long cell = 0; cell < nCells; ++cell ){
+            QByteArray line = file.readLine();
+            if( line.isEmpty() ){
+                Application::instance()->logError( "RealizationStore::importStackFile(): " + geoeasPath +
+                                                   " ends before realization #" + QString::number( iRealization + 1 ) +
+                                                   " is complete." );
+                store.close();
+                QFile::remove( storePath );
+                return false;
+            }
+            values[ cell ] = Util::getGEOEASLineValue( line.constData(), line.size(), column );
+        }
+        if( ! store.writeRealization( iRealization, values ) ){
+            store.close();
+            QFile::remove( storePath );
+            return false;
+        }
+    }
+    if( ! store.finish() ){
+        QFile::remove( storePath );
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,137 @@
+#ifndef REALIZATIONSTORE_H
+#define REALIZATIONSTORE_H
+
+#include <QString>
+#include <QFile>
+#include <QByteArray>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <cstdint>
+
+class CartesianGrid;
+
+/**
+ * The RealizationStore class is a binary container of an ensemble of realizations (nRealizations x nCells values)
+ * allowing random access to any single realization or to the distribution of any cell across the realizations
+ * without reading or parsing the whole ensemble, as it is necessary with stacked GEO-EAS files.
+ *
+ * The values of each realization are split in chunks of a fixed number of cells, which can be written in any order
+ * (e.g. by concurrent simulation threads).  The values can be stored as 64-bit or as 32-bit floats (enough for
+ * categorical codes and most continuous variables) and the chunks can be compressed with zlib.  The file ends with
+ * an index of the chunk locations.  Uncompressed files are memory-mapped for reading.
+ *
+ * The cells follow the GEO-EAS grid order: cell = i + j*nI + k*nJ*nI.  Cells never written yield NaN.
+ */
+class RealizationStore
+{
+public:
+    enum class ValueType : uint8_t {
+        FLOAT64 = 0,
+        FLOAT32 = 1
+    };
+
+    /** The default number of cells per chunk. */
+    static const int DEFAULT_CELLS_PER_CHUNK;
+
+    RealizationStore();
+    ~RealizationStore();
+
+    /** Creates (or overwrites) a store file for writing.  Returns false if the file could not be created. */
+    bool create( const QString& path,
+                 long nCells,
+                 int nRealizations,
+                 ValueType valueType = ValueType::FLOAT64,
+                 bool compressed = false,
+                 int cellsPerChunk = DEFAULT_CELLS_PER_CHUNK );
+
+    /** Writes the values (nCells values) of the given realization (starting with 0).  Returns false on failure.
+     * @note This method is safe to call from multiple threads, which can compress their realizations concurrently.
+     */
+    bool writeRealization( int iRealization, const double* values );
+    bool writeRealization( int iRealization, const std::vector<double>& values );
+
+    /** Writes the index and closes the file.  The store must be finished before it can be opened for reading.
+     * Returns false on failure, including the failure of a previous writeRealization() call. */
+    bool finish();
+
+    /** Opens an existing store file for reading.  Returns false if the file is not a complete store. */
+    bool open( const QString& path );
+
+    /**
+     * Opens the store kept in the project's tmp directory for a grid file with realizations stacked in its first
+     * variable (e.g. the output of sgsim).  The grid file is converted first if the store does not exist or is
+     * older than the grid file.
+     */
+    bool openForGrid( CartesianGrid* grid );
+
+    /** Closes the store.  A store being written is finished. */
+    void close();
+
+    bool isOpen() const { return m_file.isOpen(); }
+    QString getPath() const { return m_file.fileName(); }
+    long getCellCount() const { return m_nCells; }
+    int getRealizationCount() const { return m_nRealizations; }
+
+    /** Reads the values of a realization (starting with 0). */
+    std::vector<double> getRealization( int iRealization ) const;
+
+    /** Reads the values of a cell in all realizations. */
+    std::vector<double> getCellDistribution( long cell ) const;
+
+    /** Reads the values of a range of cells of a realization into values (lastCell - firstCell + 1 values). */
+    void readCells( int iRealization, long firstCell, long lastCell, double* values ) const;
+
+    /**
+     * Converts realizations stacked in a column (starting with 0) of a GEO-EAS file (e.g. the output of sgsim)
+     * into a store, reading the GEO-EAS file only once.  Returns false on failure.
+     */
+    static bool importStackFile( const QString& geoeasPath,
+                                 int column,
+                                 long nCells,
+                                 int nRealizations,
+                                 const QString& storePath,
+                                 ValueType valueType = ValueType::FLOAT64,
+                                 bool compressed = false );
+
+private:
+    /** The location of a chunk in the file. */
+    struct ChunkLocation {
+        int64_t offset;
+        int64_t size;
+    };
+
+    long m_nCells;
+    int m_nRealizations;
+    int m_cellsPerChunk;
+    int m_nChunksPerRealization;
+    ValueType m_valueType;
+    bool m_compressed;
+    bool m_writing;
+    /** Set if a chunk could not be written. */
+    bool m_writeFailed;
+
+    mutable QFile m_file;
+    /** The whole file when memory-mapped (uncompressed stores only), otherwise nullptr. */
+    uchar* m_mappedFile;
+    /** Chunk locations indexed by iRealization * m_nChunksPerRealization + iChunk.  Offset zero means not written. */
+    std::vector<ChunkLocation> m_index;
+
+    /** Serializes the file accesses and the chunk cache. */
+    mutable std::mutex m_mutex;
+    /** Recently decompressed chunks (compressed stores only). */
+    mutable std::map< int64_t, QByteArray > m_chunkCache;
+
+    int getValueSize() const { return m_valueType == ValueType::FLOAT32 ? 4 : 8; }
+    int getCellCountOfChunk( int iChunk ) const;
+    bool writeHeader( int64_t indexOffset );
+
+    /** Returns the uncompressed bytes of a chunk (empty if the chunk was not written).
+     * For memory-mapped stores, returns a QByteArray that refers to the mapped bytes without copying them. */
+    QByteArray getChunk( int iRealization, int iChunk ) const;
+
+    /** Converts count stored values into doubles. */
+    void decode( const char* bytes, int count, double* values ) const;
+};
+
+#endif // REALIZATIONSTORE_H
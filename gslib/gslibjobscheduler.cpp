@@ -0,0 +1,244 @@
+#include "gslibjobscheduler.h"
+
+#include "domain/application.h"
+#include "domain/project.h"
+
+#include <QDir>
+#include <QFile>
+#include <QEventLoop>
+
+/*static*/ GSLibJobScheduler* GSLibJobScheduler::s_instance = nullptr;
+
+/////////////////////////////////////////////  GSLibJob  /////////////////////////////////////////////////////////////
+
+GSLibJob::GSLibJob( uint id, const QString programName, const QString workingDirectory, bool parFromStdIn ) :
+    id( id ),
+    programName( programName ),
+    workingDirectory( workingDirectory ),
+    parFilePath( QDir( workingDirectory ).absoluteFilePath( "parameters.par" ) ),
+    parFromStdIn( parFromStdIn ),
+    status( GSLibJobStatus::CREATED ),
+    exitCode( 0 ),
+    m_process( nullptr ),
+    m_wallTimeMilliseconds( 0 )
+{
+}
+
+QString GSLibJob::makeFilePath( const QString fileName ) const
+{
+    return QDir( workingDirectory ).absoluteFilePath( fileName );
+}
+
+double GSLibJob::getWallTime() const
+{
+    switch( status ){
+    case GSLibJobStatus::RUNNING:
+        return m_timer.elapsed() / 1000.0;
+    case GSLibJobStatus::FINISHED:
+    case GSLibJobStatus::FAILED:
+        return m_wallTimeMilliseconds / 1000.0;
+    default:
+        return 0.0;
+    }
+}
+
+QString GSLibJob::getStatusText() const
+{
+    switch( status ){
+    case GSLibJobStatus::CREATED:  return "created";
+    case GSLibJobStatus::QUEUED:   return "queued";
+    case GSLibJobStatus::RUNNING:  return "running";
+    case GSLibJobStatus::FINISHED:
+        if( ! standardError.trimmed().isEmpty() )
+            return "finished with errors";
+        return "finished";
+    case GSLibJobStatus::FAILED:   return "failed";
+    }
+    return "unknown";
+}
+
+/////////////////////////////////////////////  GSLibJobScheduler  ////////////////////////////////////////////////////
+
+GSLibJobScheduler::GSLibJobScheduler() : QObject(),
+    m_nextJobId( 1 ),
+    m_runningJobsCount( 0 ),
+    m_maxConcurrentJobs( Application::instance()->getMaxConcurrentGSLibJobsSetting() )
+{
+}
+
+GSLibJobScheduler *GSLibJobScheduler::instance()
+{
+    if( ! GSLibJobScheduler::s_instance )
+        s_instance = new GSLibJobScheduler();
+    return s_instance;
+}
+
+GSLibJobPtr GSLibJobScheduler::createJob( const QString programName, bool parFromStdIn )
+{
+    //make an unique directory in the project's tmp directory for the job
+    QString workingDirectory = Application::instance()->getProject()->generateUniqueTmpFilePath( "job" );
+    if( ! QDir().mkpath( workingDirectory ) )
+        Application::instance()->logError( "GSLibJobScheduler::createJob(): could not create the working directory " +
+                                           workingDirectory + " for " + programName + "." );
+
+    return GSLibJobPtr( new GSLibJob( m_nextJobId++, programName, workingDirectory, parFromStdIn ) );
+}
+
+void GSLibJobScheduler::submit( GSLibJobPtr job, std::function<void (const GSLibJob &)> onCompletion )
+{
+    job->m_onCompletion = onCompletion;
+    job->status = GSLibJobStatus::QUEUED;
+    m_jobs.push_back( job );
+    m_queue.push_back( job );
+    emit jobStatusChanged( job->id );
+    startQueuedJobs();
+}
+
+void GSLibJobScheduler::waitForAll()
+{
+    if( m_queue.empty() && m_runningJobsCount == 0 )
+        return;
+    //a local event loop keeps the GUI alive while the client code waits.
+    QEventLoop eventLoop;
+    connect( this, SIGNAL(allJobsFinished()), &eventLoop, SLOT(quit()) );
+    eventLoop.exec();
+}
+
+void GSLibJobScheduler::setMaxConcurrentJobs( uint value )
+{
+    m_maxConcurrentJobs = std::max( 1U, value );
+    Application::instance()->setMaxConcurrentGSLibJobsSetting( m_maxConcurrentJobs );
+    startQueuedJobs();
+}
+
+void GSLibJobScheduler::removeFinishedJobs( bool removeWorkingDirectories )
+{
+    std::vector< GSLibJobPtr > remainingJobs;
+    for( GSLibJobPtr job : m_jobs ){
+        if( job->status == GSLibJobStatus::FINISHED || job->status == GSLibJobStatus::FAILED ){
+            if( removeWorkingDirectories )
+                QDir( job->workingDirectory ).removeRecursively();
+        } else
+            remainingJobs.push_back( job );
+    }
+    m_jobs.swap( remainingJobs );
+}
+
+void GSLibJobScheduler::startQueuedJobs()
+{
+    while( m_runningJobsCount < m_maxConcurrentJobs && ! m_queue.empty() ){
+        GSLibJobPtr job = m_queue.front();
+        m_queue.pop_front();
+        if( start( job ) )
+            ++m_runningJobsCount;
+        else
+            finish( job, GSLibJobStatus::FAILED, -1 );
+    }
+}
+
+bool GSLibJobScheduler::start( GSLibJobPtr job )
+{
+    //build the entire path to the program executable if only a name is given.
+    QString exePath = job->programName;
+    bool programNameHasPath = exePath.contains('/') || exePath.contains('\\') ;
+    if( ! programNameHasPath )
+        exePath = QDir( Application::instance()->getGSLibPathSetting() ).filePath( job->programName );
+
+    //test whether the executable exists (for some reason, some GSLib executables simply causes the program
+    // to hang if missing).
+    QString exeFilePath = exePath;
+#ifdef Q_OS_WIN
+    exeFilePath += ".exe";
+#endif
+    if( ! QFile::exists( exeFilePath ) ){
+        job->standardError = "GSLib program not found or with permission denied: " + exeFilePath;
+        return false;
+    }
+
+    QStringList arguments;
+    if( ! job->parFromStdIn )
+        arguments << job->parFilePath;
+
+    //each job runs in its own directory, so scratch files of concurrent runs do not collide.
+    job->m_process = new QProcess( this );
+    job->m_process->setWorkingDirectory( job->workingDirectory );
+    connect( job->m_process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(onJobFinished(int,QProcess::ExitStatus)) );
+    connect( job->m_process, SIGNAL(errorOccurred(QProcess::ProcessError)), this, SLOT(onJobError(QProcess::ProcessError)) );
+
+    job->status = GSLibJobStatus::RUNNING;
+    job->m_timer.start();
+    job->m_process->start( exePath, arguments );
+    if( job->parFromStdIn ){
+        //Sometimes the newcokb3d program asks a "are you sure" question, hence the 'y'.
+        job->m_process->write( QString( job->parFilePath ).append('\n').append('y').append('\n').toStdString().c_str() );
+    }
+    emit jobStatusChanged( job->id );
+    return true;
+}
+
+void GSLibJobScheduler::finish( GSLibJobPtr job, GSLibJobStatus finalStatus, int exitCode )
+{
+    job->status = finalStatus;
+    job->exitCode = exitCode;
+    if( job->m_timer.isValid() )
+        job->m_wallTimeMilliseconds = job->m_timer.elapsed();
+
+    //capture the program's outputs and dispose of the process object.
+    if( job->m_process ){
+        job->standardOutput += QString( job->m_process->readAllStandardOutput() );
+        job->standardError  += QString( job->m_process->readAllStandardError() );
+        job->m_process->deleteLater();
+        job->m_process = nullptr;
+    }
+
+    //report
+    QString report = "GSLibJobScheduler: job #" + QString::number( job->id ) + " (" + job->programName + ") " +
+                     job->getStatusText() + " in " + QString::number( job->getWallTime(), 'f', 1 ) + "s.";
+    if( finalStatus == GSLibJobStatus::FAILED || ! job->standardError.trimmed().isEmpty() ){
+        Application::instance()->logError( report );
+        Application::instance()->logError( job->standardError );
+    } else
+        Application::instance()->logInfo( report );
+
+    emit jobStatusChanged( job->id );
+
+    //notify the client code
+    if( job->m_onCompletion )
+        job->m_onCompletion( *job );
+}
+
+GSLibJobPtr GSLibJobScheduler::findJob( QObject *process ) const
+{
+    for( GSLibJobPtr job : m_jobs )
+        if( job->m_process == process )
+            return job;
+    return GSLibJobPtr();
+}
+
+void GSLibJobScheduler::onJobFinished( int exitCode, QProcess::ExitStatus exitStatus )
+{
+    GSLibJobPtr job = findJob( sender() );
+    if( ! job )
+        return;
+    --m_runningJobsCount;
+    finish( job, exitStatus == QProcess::NormalExit ? GSLibJobStatus::FINISHED : GSLibJobStatus::FAILED, exitCode );
+    startQueuedJobs();
+    if( m_queue.empty() && m_runningJobsCount == 0 )
+        emit allJobsFinished();
+}
+
+void GSLibJobScheduler::onJobError( QProcess::ProcessError error )
+{
+    //only start failures are handled here, since crashes are also reported via the finished() signal.
+    if( error != QProcess::FailedToStart )
+        return;
+    GSLibJobPtr job = findJob( sender() );
+    if( ! job )
+        return;
+    --m_runningJobsCount;
+    job->standardError += "Program file is missing or you lack execution permission on it.";
+    finish( job, GSLibJobStatus::FAILED, -1 );
+    startQueuedJobs();
+    if( m_queue.empty() && m_runningJobsCount == 0 )
+        emit allJobsFinished();
+}
@@ -0,0 +1,164 @@
+#ifndef GSLIBJOBSCHEDULER_H
+#define GSLIBJOBSCHEDULER_H
+
+#include <QObject>
+#include <QProcess>
+#include <QElapsedTimer>
+#include <functional>
+#include <memory>
+#include <deque>
+#include <vector>
+
+/** The possible states of a GSLibJob. */
+enum class GSLibJobStatus : int {
+    CREATED,  //!< Job created, but not submitted yet.
+    QUEUED,   //!< Job waiting for a free slot to run.
+    RUNNING,  //!< Program running.
+    FINISHED, //!< Program terminated normally (this does not mean it did not report errors to stderr).
+    FAILED    //!< Program failed to start, crashed or was not found.
+};
+
+/**
+ * A GSLibJob represents an execution of a GSLib program managed by the GSLibJobScheduler.
+ * Each job has its own working directory (under the project's tmp directory), so several instances
+ * of the same program can run concurrently without overwriting each other's parameter, output, debug
+ * or scratch files.
+ */
+class GSLibJob
+{
+public:
+    GSLibJob( uint id, const QString programName, const QString workingDirectory, bool parFromStdIn );
+
+    /** Returns a path to a file inside this job's working directory.  Client code should use this to
+     * set the output paths in the parameter file, so the outputs of concurrent jobs do not clash. */
+    QString makeFilePath( const QString fileName ) const;
+
+    /** Returns the job's wall time in seconds.  For running jobs, the elapsed time so far is returned.
+     * Returns zero for jobs that have not started yet. */
+    double getWallTime() const;
+
+    /** Returns a text describing the job's status (e.g. for display). */
+    QString getStatusText() const;
+
+    /** The unique identifier of the job in the scheduler. */
+    const uint id;
+    /** The name of the GSLib program (e.g. "gam") or a complete path to an executable. */
+    const QString programName;
+    /** The isolated working directory of the job. */
+    const QString workingDirectory;
+    /** The path to the parameter file of the job (inside the working directory).  Client code must save
+     * the parameter file to this path before submitting the job. */
+    const QString parFilePath;
+    /** See the parFromStdIn parameter of GSLib::runProgram(). */
+    const bool parFromStdIn;
+
+    GSLibJobStatus status;
+    /** The exit code of the program.  Only meaningful if status == FINISHED. */
+    int exitCode;
+    /** The text the program wrote to the standard output. */
+    QString standardOutput;
+    /** The text the program wrote to the standard error. */
+    QString standardError;
+
+private:
+    friend class GSLibJobScheduler;
+    QProcess* m_process;
+    QElapsedTimer m_timer;
+    qint64 m_wallTimeMilliseconds;
+    std::function< void( const GSLibJob& ) > m_onCompletion;
+};
+typedef std::shared_ptr< GSLibJob > GSLibJobPtr;
+
+/**
+ * The GSLibJobScheduler runs many GSLib programs concurrently, up to a configurable number of simultaneous
+ * processes (see Application::getMaxConcurrentGSLibJobsSetting()).  Jobs in excess wait in a queue.
+ * This is useful to post-process many realizations (e.g. running gam, postsim or histpltsim per realization)
+ * in parallel instead of calling GSLib::runProgram() in a loop.
+ *
+ * Typical usage:
+ *
+ *     GSLibJobPtr job = GSLibJobScheduler::instance()->createJob( "gam" );
+ *     gpf.getParameter<GSLibParFile*>(3)->_path = job->makeFilePath( "gam.out" );
+ *     gpf.save( job->parFilePath );
+ *     GSLibJobScheduler::instance()->submit( job, []( const GSLibJob& job ){ ... } );
+ *     ...
+ *     GSLibJobScheduler::instance()->waitForAll(); //optional: blocks the client code, but not the GUI.
+ *
+ * The jobs run as child processes driven by the Qt event loop, thus the GUI remains responsive.
+ */
+class GSLibJobScheduler : public QObject
+{
+
+    Q_OBJECT
+
+public:
+
+    static GSLibJobScheduler* instance();
+
+    /**
+     * Creates a new job with its own working directory in the project's tmp directory.
+     * The job is not run until it is passed to submit().
+     */
+    GSLibJobPtr createJob( const QString programName, bool parFromStdIn = false );
+
+    /**
+     * Enqueues a job for execution.  It starts immediately if there is a free slot.
+     * @param onCompletion An optional callback called in the GUI thread when the job finishes or fails.
+     */
+    void submit( GSLibJobPtr job, std::function< void( const GSLibJob& ) > onCompletion = nullptr );
+
+    /**
+     * Returns only when there are no more queued or running jobs.  The GUI remains responsive meanwhile.
+     */
+    void waitForAll();
+
+    /** Sets the maximum number of GSLib programs running at the same time.  This setting is persisted. */
+    void setMaxConcurrentJobs( uint value );
+    uint getMaxConcurrentJobs() const { return m_maxConcurrentJobs; }
+
+    /** Returns all the jobs submitted (queued, running and finished) since the last call to removeFinishedJobs(). */
+    const std::vector< GSLibJobPtr >& getJobs() const { return m_jobs; }
+
+    uint getRunningJobsCount() const { return m_runningJobsCount; }
+    uint getQueuedJobsCount() const { return m_queue.size(); }
+
+    /** Removes the finished and failed jobs from the list returned by getJobs().
+     * @param removeWorkingDirectories If true, the working directories of the jobs are deleted from the file system.
+     *        Make sure nothing refers to the files in them anymore.
+     */
+    void removeFinishedJobs( bool removeWorkingDirectories );
+
+signals:
+    /** Emitted when a job changes status (e.g. from QUEUED to RUNNING). */
+    void jobStatusChanged( uint jobId );
+    /** Emitted when the last queued or running job finishes. */
+    void allJobsFinished();
+
+private:
+    GSLibJobScheduler();
+    static GSLibJobScheduler* s_instance;
+
+    /** Starts queued jobs until all slots are taken or the queue is empty. */
+    void startQueuedJobs();
+
+    /** Starts the program of a job.  Returns false if the program could not be started. */
+    bool start( GSLibJobPtr job );
+
+    /** Wraps up a job (e.g. captures its output, calls its completion callback, etc.). */
+    void finish( GSLibJobPtr job, GSLibJobStatus finalStatus, int exitCode );
+
+    /** Returns the job whose process is the given one.  Returns a null pointer if not found. */
+    GSLibJobPtr findJob( QObject* process ) const;
+
+    std::vector< GSLibJobPtr > m_jobs;
+    std::deque< GSLibJobPtr > m_queue;
+    uint m_nextJobId;
+    uint m_runningJobsCount;
+    uint m_maxConcurrentJobs;
+
+private slots:
+    void onJobFinished( int exitCode, QProcess::ExitStatus exitStatus );
+    void onJobError( QProcess::ProcessError error );
+};
+
+#endif // GSLIBJOBSCHEDULER_H
@@ -0,0 +1,103 @@
+#include "gslibjobsdialog.h"
+#include "ui_gslibjobsdialog.h"
+
+#include "gslib/gslibjobscheduler.h"
+
+#include <QTimer>
+#include <QMessageBox>
+
+GSLibJobsDialog::GSLibJobsDialog(QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::GSLibJobsDialog),
+    m_timer( new QTimer( this ) )
+{
+    ui->setupUi(this);
+
+    //deletes dialog from memory upon user closing it
+    this->setAttribute(Qt::WA_DeleteOnClose);
+
+    GSLibJobScheduler* scheduler = GSLibJobScheduler::instance();
+
+    ui->spinMaxConcurrentJobs->setValue( scheduler->getMaxConcurrentJobs() );
+
+    ui->tblJobs->setColumnCount( 5 );
+    ui->tblJobs->setHorizontalHeaderLabels( QStringList() << "#" << "Program" << "Status" << "Wall time (s)" << "Working directory" );
+
+    connect( ui->spinMaxConcurrentJobs, SIGNAL(valueChanged(int)), this, SLOT(onMaxConcurrentJobsChanged(int)) );
+    connect( ui->btnRemoveFinished, SIGNAL(clicked()), this, SLOT(onRemoveFinished()) );
+    connect( ui->tblJobs, SIGNAL(itemSelectionChanged()), this, SLOT(onJobSelected()) );
+    connect( scheduler, SIGNAL(jobStatusChanged(uint)), this, SLOT(onUpdateJobsTable()) );
+    connect( m_timer, SIGNAL(timeout()), this, SLOT(onUpdateJobsTable()) );
+    m_timer->start( 1000 );
+
+    onUpdateJobsTable();
+}
+
+GSLibJobsDialog::~GSLibJobsDialog()
+{
+    delete ui;
+}
+
+void GSLibJobsDialog::onUpdateJobsTable()
+{
+    GSLibJobScheduler* scheduler = GSLibJobScheduler::instance();
+    const std::vector< GSLibJobPtr >& jobs = scheduler->getJobs();
+
+    ui->tblJobs->setRowCount( jobs.size() );
+    int iRow = 0;
+    for( const GSLibJobPtr& job : jobs ){
+        QString wallTime;
+        if( job->status != GSLibJobStatus::QUEUED && job->status != GSLibJobStatus::CREATED )
+            wallTime = QString::number( job->getWallTime(), 'f', 1 );
+        QStringList cells;
+        cells << QString::number( job->id ) << job->programName << job->getStatusText()
+              << wallTime << job->workingDirectory;
+        for( int iColumn = 0; iColumn < cells.size(); ++iColumn ){
+            QTableWidgetItem* item = ui->tblJobs->item( iRow, iColumn );
+            if( ! item ){
+                item = new QTableWidgetItem();
+                ui->tblJobs->setItem( iRow, iColumn, item );
+            }
+            item->setText( cells[iColumn] );
+            if( job->status == GSLibJobStatus::FAILED || ! job->standardError.trimmed().isEmpty() )
+                item->setForeground( Qt::red );
+            else
+                item->setForeground( palette().text() );
+        }
+        ++iRow;
+    }
+
+    ui->lblSummary->setText( QString::number( scheduler->getRunningJobsCount() ) + " running, " +
+                             QString::number( scheduler->getQueuedJobsCount() ) + " queued." );
+}
+
+void GSLibJobsDialog::onMaxConcurrentJobsChanged(int value)
+{
+    GSLibJobScheduler::instance()->setMaxConcurrentJobs( value );
+}
+
+void GSLibJobsDialog::onRemoveFinished()
+{
+    int ret = QMessageBox::question( this, "Confirm removal",
+                                     "Remove the finished jobs from the list and delete their working directories?",
+                                     QMessageBox::Yes | QMessageBox::No );
+    if( ret != QMessageBox::Yes )
+        return;
+    GSLibJobScheduler::instance()->removeFinishedJobs( true );
+    ui->txtJobOutput->clear();
+    onUpdateJobsTable();
+}
+
+void GSLibJobsDialog::onJobSelected()
+{
+    QList<QTableWidgetItem*> selected = ui->tblJobs->selectedItems();
+    if( selected.isEmpty() )
+        return;
+    uint jobId = ui->tblJobs->item( selected.first()->row(), 0 )->text().toUInt();
+    for( const GSLibJobPtr& job : GSLibJobScheduler::instance()->getJobs() )
+        if( job->id == jobId ){
+            ui->txtJobOutput->setPlainText( job->standardOutput +
+                                            ( job->standardError.isEmpty() ? "" : "\n--- stderr ---\n" + job->standardError ) );
+            return;
+        }
+}
@@ -0,0 +1,38 @@
+#ifndef GSLIBJOBSDIALOG_H
+#define GSLIBJOBSDIALOG_H
+
+#include <QDialog>
+
+namespace Ui {
+class GSLibJobsDialog;
+}
+
+class QTimer;
+
+/**
+ * The GSLibJobsDialog is a dashboard of the jobs in the GSLibJobScheduler: it lists the queued,
+ * running and finished GSLib programs with their wall times and shows the captured outputs
+ * of the selected job.
+ */
+class GSLibJobsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit GSLibJobsDialog(QWidget *parent = nullptr);
+    ~GSLibJobsDialog();
+
+private:
+    Ui::GSLibJobsDialog *ui;
+
+    /** Refreshes the wall times of the running jobs periodically. */
+    QTimer* m_timer;
+
+private slots:
+    void onUpdateJobsTable();
+    void onMaxConcurrentJobsChanged( int value );
+    void onRemoveFinished();
+    void onJobSelected();
+};
+
+#endif // GSLIBJOBSDIALOG_H
@@ -12,6 +12,52 @@
 #include "../igslibparameterfinder.h"
 #include "geostats/geostatsutils.h"
 
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+#include <mutex>
+
+namespace {
+
+    /** Creates a parameter object of the given template type name (e.g. "double").
+     *  Returns nullptr if the type is not recognized. */
+    GSLibParType* makeParameterOfType( const QString& type_name, const QString& var_name, const QString& tag_description ){
+        if( type_name == "double" )        return new GSLibParDouble(var_name,"",tag_description);
+        if( type_name == "file" )          return new GSLibParFile(var_name,"",tag_description);
+        if( type_name == "dir" )           return new GSLibParDir(var_name,"",tag_description);
+        if( type_name == "input" )         return new GSLibParInputData();
+        if( type_name == "int" )           return new GSLibParInt(var_name,"",tag_description);
+        if( type_name == "limits_double" ) return new GSLibParLimitsDouble(var_name,"",tag_description);
+        if( type_name == "option" )        return new GSLibParOption(var_name,"",tag_description);
+        if( type_name == "range" )         return new GSLibParRange(var_name,"",tag_description);
+        if( type_name == "string" )        return new GSLibParString(var_name,"",tag_description);
+        if( type_name == "uint" )          return new GSLibParUInt(var_name,"",tag_description);
+        if( type_name == "var_weight" )    return new GSLibParVarWeight(var_name,"",tag_description);
+        if( type_name == "grid" )          return new GSLibParGrid(var_name,"",tag_description);
+        if( type_name == "color" )         return new GSLibParColor(var_name,"",tag_description);
+        if( type_name == "repeat" )        return new GSLibParRepeat();
+        if( type_name == "vmodel" )        return new GSLibParVModel(var_name, "", tag_description);
+        return nullptr;
+    }
+
+    /** A parsed template kept for the session. */
+    struct RegisteredTemplate {
+        QDateTime lastModified;
+        GSLibParameterFile* prototype;
+    };
+
+    /** The parsed templates by template file path. */
+    QHash<QString, RegisteredTemplate> g_templateRegistry;
+    std::mutex g_templateRegistryMutex;
+
+    /** Session counters of template parsing and cloning. */
+    uint g_templateParseCount = 0;
+    qint64 g_templateParseNanoseconds = 0;
+    uint g_templateCloneCount = 0;
+    qint64 g_templateCloneNanoseconds = 0;
+}
+
 GSLibParameterFile::GSLibParameterFile(const QString program_name)
 {
 
@@ -24,6 +70,13 @@ GSLibParameterFile::GSLibParameterFile(const QString program_name)
     //last <repeat> is initially nullptr, of course.
     _last_repeat = nullptr;
 
+    //a template already parsed in this session is just cloned
+    if( copyFromTemplateRegistry( template_path ) )
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
     QFile inputFile( template_path );
     if( ! inputFile.exists() ){
         QString msg("ERROR: parameter file template ");
@@ -47,6 +100,8 @@ GSLibParameterFile::GSLibParameterFile(const QString program_name)
           }
        }
        inputFile.close();
+
+       addToTemplateRegistry( template_path, timer.nsecsElapsed() );
     }
 }
 
@@ -69,6 +124,85 @@ GSLibParameterFile::~GSLibParameterFile()
     //TODO: Delete the objects in _params
 }
 
+bool GSLibParameterFile::copyFromTemplateRegistry(const QString &template_path)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QDateTime lastModified = QFileInfo( template_path ).lastModified();
+    std::unique_lock<std::mutex> lock( g_templateRegistryMutex );
+    QHash<QString, RegisteredTemplate>::iterator it = g_templateRegistry.find( template_path );
+    //the template file may have been regenerated or edited since it was parsed
+    if( it == g_templateRegistry.end() || it->lastModified != lastModified )
+        return false;
+    GSLibParameterFile* prototype = it->prototype;
+    this->_header = prototype->_header;
+    for( GSLibParType* param : prototype->_params )
+        this->_params.append( param->clone() );
+    ++g_templateCloneCount;
+    g_templateCloneNanoseconds += timer.nsecsElapsed();
+    return true;
+}
+
+void GSLibParameterFile::addToTemplateRegistry(const QString &template_path, qint64 parse_nanoseconds)
+{
+    //the prototype is a clone made before this object's parameters can be changed
+    GSLibParameterFile* prototype = new GSLibParameterFile();
+    prototype->_program_name = this->_program_name;
+    prototype->_header = this->_header;
+    for( GSLibParType* param : this->_params ){
+        GSLibParType* clone = param->clone();
+        if( ! clone ){
+            Application::instance()->logWarn( "GSLibParameterFile::addToTemplateRegistry(): parameters of type \"" +
+                                              param->getTypeName() + "\" do not support cloning.  Template " +
+                                              template_path + " will be parsed every time." );
+            qDeleteAll( prototype->_params );
+            delete prototype;
+            return;
+        }
+        prototype->_params.append( clone );
+    }
+    std::unique_lock<std::mutex> lock( g_templateRegistryMutex );
+    ++g_templateParseCount;
+    g_templateParseNanoseconds += parse_nanoseconds;
+    QHash<QString, RegisteredTemplate>::iterator it = g_templateRegistry.find( template_path );
+    if( it != g_templateRegistry.end() ){
+        qDeleteAll( it->prototype->_params );
+        delete it->prototype;
+    }
+    g_templateRegistry.insert( template_path, { QFileInfo( template_path ).lastModified(), prototype } );
+}
+
+void GSLibParameterFile::getTemplateRegistryCounters(uint &parse_count, qint64 &parse_microseconds,
+                                                     uint &clone_count, qint64 &clone_microseconds)
+{
+    std::unique_lock<std::mutex> lock( g_templateRegistryMutex );
+    parse_count = g_templateParseCount;
+    parse_microseconds = g_templateParseNanoseconds / 1000;
+    clone_count = g_templateCloneCount;
+    clone_microseconds = g_templateCloneNanoseconds / 1000;
+}
+
+void GSLibParameterFile::clearTemplateRegistry()
+{
+    uint parse_count, clone_count;
+    qint64 parse_microseconds, clone_microseconds;
+    getTemplateRegistryCounters( parse_count, parse_microseconds, clone_count, clone_microseconds );
+    if( parse_count > 0 )
+        Application::instance()->logInfo( "GSLib parameter templates: " + QString::number( parse_count ) + " parsed in " +
+                                          QString::number( parse_microseconds ) + "us, " + QString::number( clone_count ) +
+                                          " cloned in " + QString::number( clone_microseconds ) + "us." );
+    std::unique_lock<std::mutex> lock( g_templateRegistryMutex );
+    for( RegisteredTemplate& registered : g_templateRegistry ){
+        qDeleteAll( registered.prototype->_params );
+        delete registered.prototype;
+    }
+    g_templateRegistry.clear();
+    g_templateParseCount = 0;
+    g_templateParseNanoseconds = 0;
+    g_templateCloneCount = 0;
+    g_templateCloneNanoseconds = 0;
+}
+
 void GSLibParameterFile::setDefaultValues()
 {
     if( this->_program_name == "histplt" ){
@@ -466,87 +600,63 @@ bool GSLibParameterFile::parseType( uint line_indentation, QString tag, QList<GS
     QString var_name = Util::getRefNameFromTag( tag ); //parameters are normally anonymous
     bool hasPlusSign = Util::hasPlusSign( tag ); //the plus (+) sign in a tag denotes a variable length multivalued paramater.
 
-    //create a list of objects representing all parameter types available
-    //takes the opportunity to assign the variable name and description to all potential types at once
-    QList<GSLibParType*> param_types;
-    param_types.append( new GSLibParDouble(var_name,"",tag_description) );
-    param_types.append( new GSLibParFile(var_name,"",tag_description) );
-    param_types.append( new GSLibParDir(var_name,"",tag_description) );
-    param_types.append( new GSLibParInputData() );
-    param_types.append( new GSLibParInt(var_name,"",tag_description) );
-    param_types.append( new GSLibParLimitsDouble(var_name,"",tag_description) );
-    param_types.append( new GSLibParOption(var_name,"",tag_description) );
-    param_types.append( new GSLibParRange(var_name,"",tag_description) );
-    param_types.append( new GSLibParString(var_name,"",tag_description) );
-    param_types.append( new GSLibParUInt(var_name,"",tag_description) );
-    param_types.append( new GSLibParVarWeight(var_name,"",tag_description) );
-    param_types.append( new GSLibParGrid(var_name,"",tag_description) );
-    param_types.append( new GSLibParColor(var_name,"",tag_description) );
-    param_types.append( new GSLibParRepeat() );
-    param_types.append( new GSLibParVModel(var_name, "", tag_description) );
-    //test all available types
-    bool type_recognized = false;
-    for ( int i = 0; i < param_types.size(); ++i)
-    {
-        //parameter type found: add to the object's structure
-        if( type_name.compare( param_types[i]->getTypeName() ) == 0){
-            //parses the tag options for those types that have them.
-            if( type_name == "option" || type_name == "range" || type_name == "repeat" ){
-                std::vector< std::pair<QString, QString> > tagOptions = Util::getTagOptions( tag );
-                QString reference_par_name = Util::getReferenceName( tag );
-                if( type_name == "option" ){
-                    GSLibParOption* popt = (GSLibParOption*)param_types[i];
-                    for(std::vector< std::pair<QString, QString> >::iterator it = tagOptions.begin(); it != tagOptions.end(); ++it) {
-                        std::pair<QString, QString> option = *it;
-                        popt->addOption( option.first.toInt(), option.second );
-                    }
-                }else if( type_name == "range" ){
-                    GSLibParRange* prng = (GSLibParRange*)param_types[i];
-                    std::pair<QString, QString> min = tagOptions.front();
-                    std::pair<QString, QString> max = tagOptions.back();
-                    prng->_min = min.first.toDouble();
-                    prng->_min_label = min.second;
-                    prng->_max = max.first.toDouble();
-                    prng->_max_label = max.second;
-                }else if( type_name == "repeat" ){
-                    GSLibParRepeat* prep = (GSLibParRepeat*)param_types[i];
-                    _last_repeat = prep; //save pointer to the last <repeat> for next subordinate tags
-                    prep->_ref_par_name = reference_par_name;
-                }
+    //create only the object of the tag's type
+    //takes the opportunity to assign the variable name and description
+    GSLibParType* param = makeParameterOfType( type_name, var_name, tag_description );
+    if( ! param )
+        return false;
+
+    //parses the tag options for those types that have them.
+    if( type_name == "option" || type_name == "range" || type_name == "repeat" ){
+        std::vector< std::pair<QString, QString> > tagOptions = Util::getTagOptions( tag );
+        QString reference_par_name = Util::getReferenceName( tag );
+        if( type_name == "option" ){
+            GSLibParOption* popt = (GSLibParOption*)param;
+            for(std::vector< std::pair<QString, QString> >::iterator it = tagOptions.begin(); it != tagOptions.end(); ++it) {
+                std::pair<QString, QString> option = *it;
+                popt->addOption( option.first.toInt(), option.second );
             }
-            if( line_indentation > 0 ){
-                //if line indentation is not zero, it means that the paramter is under
-                // a structure (likely to be a <repeat> tag, so it is added to last processed structure
-                // instead of being directly added to the parameter file object
-                if( ! _last_repeat )
-                    Application::instance()->logError( "ERROR: indented tag without structure (e.g. <repeat> tag)." );
-                else{
-                    if( ! hasPlusSign ){ //paramater is not variably multivalued
-                        if( _last_repeat == param_types[i] )
-                            Application::instance()->logError( "ERROR: a <repeat> tag being added as a child parameter of itself.  This is likely caused by a bug or unsupported nesting syntax in the template parameter file." );
-                        else
-                            _last_repeat->_original_parameters.append( param_types[i] );
-                    }
-                    else
-                        this->addAsMultiValued( &(_last_repeat->_original_parameters), param_types[i] );
-                }
-            }else{
-                //reset last <repeat> if indentation gets back to zero, unless the parameter object to be added
-                //is itself a <repeat>
-                if( ! param_types[i]->isRepeat() )
-                    _last_repeat = nullptr;
-                if( ! hasPlusSign ) //paramater is not variably multivalued
-                    params->append( param_types[i] );
+        }else if( type_name == "range" ){
+            GSLibParRange* prng = (GSLibParRange*)param;
+            std::pair<QString, QString> min = tagOptions.front();
+            std::pair<QString, QString> max = tagOptions.back();
+            prng->_min = min.first.toDouble();
+            prng->_min_label = min.second;
+            prng->_max = max.first.toDouble();
+            prng->_max_label = max.second;
+        }else if( type_name == "repeat" ){
+            GSLibParRepeat* prep = (GSLibParRepeat*)param;
+            _last_repeat = prep; //save pointer to the last <repeat> for next subordinate tags
+            prep->_ref_par_name = reference_par_name;
+        }
+    }
+    if( line_indentation > 0 ){
+        //if line indentation is not zero, it means that the paramter is under
+        // a structure (likely to be a <repeat> tag, so it is added to last processed structure
+        // instead of being directly added to the parameter file object
+        if( ! _last_repeat )
+            Application::instance()->logError( "ERROR: indented tag without structure (e.g. <repeat> tag)." );
+        else{
+            if( ! hasPlusSign ){ //paramater is not variably multivalued
+                if( _last_repeat == param )
+                    Application::instance()->logError( "ERROR: a <repeat> tag being added as a child parameter of itself.  This is likely caused by a bug or unsupported nesting syntax in the template parameter file." );
                 else
-                    this->addAsMultiValued( params, param_types[i] );
+                    _last_repeat->_original_parameters.append( param );
             }
-            type_recognized = true;
+            else
+                this->addAsMultiValued( &(_last_repeat->_original_parameters), param );
         }
-        //parameter type not found: discard
+    }else{
+        //reset last <repeat> if indentation gets back to zero, unless the parameter object to be added
+        //is itself a <repeat>
+        if( ! param->isRepeat() )
+            _last_repeat = nullptr;
+        if( ! hasPlusSign ) //paramater is not variably multivalued
+            params->append( param );
         else
-            delete param_types[i];
+            this->addAsMultiValued( params, param );
     }
-    return type_recognized;
+    return true;
 }
 
 void GSLibParameterFile::parseParFileLine(const QString line, GSLibParType *par)
@@ -24,6 +24,9 @@ class GSLibParameterFile
 public:
     /**
      * @brief constructs the object by loading the parameter file template for the given program.
+     * The templates are parsed only once per session (or again if the template file changes): the parsed
+     * parameters are kept in a registry and the following objects for the same program receive deep copies
+     * of them (each object needs its own copy since the parameters are changed directly by the callers).
      * @param program_name Name of the target GSLib program, e.g. histplt.
      */
     GSLibParameterFile( const QString program_name );
@@ -148,6 +151,16 @@ public: //-------static functions---------------
       */
     static void generateParameterFileTemplates( const QString directory_path );
 
+    /**
+     * Returns the number of templates parsed and of parameter sets cloned from parsed templates in this session
+     * and the time spent in each.
+     */
+    static void getTemplateRegistryCounters( uint& parse_count, qint64& parse_microseconds,
+                                             uint& clone_count, qint64& clone_microseconds );
+
+    /** Logs the template registry counters and discards the parsed templates (e.g. when the project closes). */
+    static void clearTemplateRegistry();
+
 protected:
     /**
       * the header of the parameter file
@@ -171,6 +184,13 @@ protected:
       * the structure of this object.
       */
     void parseTemplateLine( const QString line );
+    /**
+     * Fills this object with a copy of the parameters of the given template if it was already parsed and
+     * did not change since.  Returns false otherwise.
+     */
+    bool copyFromTemplateRegistry( const QString& template_path );
+    /** Keeps a copy of the parameters just parsed from the given template for the next objects. */
+    void addToTemplateRegistry( const QString& template_path, qint64 parse_nanoseconds );
     /**
      * Internal function for code reuse.
      * @param line_indentation The text line indentation found in file.  This value is used to define the scope of a <repeat> tag.
@@ -22,7 +22,7 @@ QWidget *GSLibParColor::getWidget()
 
 GSLibParColor *GSLibParColor::clone()
 {
-    GSLibParColor* new_par = new GSLibParColor("","",_description);
+    GSLibParColor* new_par = new GSLibParColor(_name,_label,_description);
     new_par->_color_code = _color_code;
     return new_par;
 }
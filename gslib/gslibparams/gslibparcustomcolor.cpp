@@ -29,7 +29,7 @@ bool GSLibParCustomColor::update()
 
 GSLibParCustomColor *GSLibParCustomColor::clone()
 {
-    GSLibParCustomColor *new_par = new GSLibParCustomColor("","",_description);
+    GSLibParCustomColor *new_par = new GSLibParCustomColor(_name,_label,_description);
     new_par->_r = _r;
     new_par->_g = _g;
     new_par->_b = _b;
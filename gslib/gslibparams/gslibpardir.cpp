@@ -29,7 +29,7 @@ bool GSLibParDir::update()
 
 GSLibParDir *GSLibParDir::clone()
 {
-    GSLibParDir *new_par = new GSLibParDir("","",_description);
+    GSLibParDir *new_par = new GSLibParDir(_name,_label,_description);
     new_par->_path = _path;
     return new_par;
 }
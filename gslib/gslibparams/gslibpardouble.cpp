@@ -39,7 +39,7 @@ bool GSLibParDouble::update()
 
 GSLibParDouble *GSLibParDouble::clone()
 {
-    GSLibParDouble *result = new GSLibParDouble("", "", "");
+    GSLibParDouble *result = new GSLibParDouble(_name, _label, _description);
     result->_value = this->_value;
     return result;
 }
@@ -29,7 +29,7 @@ bool GSLibParFile::update()
 
 GSLibParFile *GSLibParFile::clone()
 {
-    GSLibParFile *new_par = new GSLibParFile("","",_description);
+    GSLibParFile *new_par = new GSLibParFile(_name,_label,_description);
     new_par->_path = _path;
     return new_par;
 }
@@ -110,3 +110,15 @@ bool GSLibParGrid::update()
     ((WidgetGSLibParGrid*)this->_widget)->updateValue( this );
     return true;
 }
+
+GSLibParGrid *GSLibParGrid::clone()
+{
+    GSLibParGrid *new_par = new GSLibParGrid(_name, _label, _description);
+    delete new_par->_specs_x;
+    new_par->_specs_x = _specs_x->clone();
+    delete new_par->_specs_y;
+    new_par->_specs_y = _specs_y->clone();
+    delete new_par->_specs_z;
+    new_par->_specs_z = _specs_z->clone();
+    return new_par;
+}
@@ -40,6 +40,7 @@ public:
     QString getTypeName() {return "grid";}
     QWidget* getWidget();
     bool update();
+    GSLibParGrid* clone();
     bool isCollection() { return true; }
 };
 
@@ -73,3 +73,14 @@ bool GSLibParInputData::update()
     ((WidgetGSLibParInputData*)this->_widget)->updateValue( this );
     return true;
 }
+
+GSLibParInputData *GSLibParInputData::clone()
+{
+    GSLibParInputData *new_par = new GSLibParInputData();
+    new_par->_file_with_data._path = _file_with_data._path;
+    for( GSLibParVarWeight* var_wgt_pair : _var_wgt_pairs )
+        new_par->_var_wgt_pairs.append( var_wgt_pair->clone() );
+    new_par->_trimming_limits._min = _trimming_limits._min;
+    new_par->_trimming_limits._max = _trimming_limits._max;
+    return new_par;
+}
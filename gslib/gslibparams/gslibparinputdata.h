@@ -41,6 +41,7 @@ public:
     QString getTypeName() {return "input";}
     QWidget* getWidget();
     bool update();
+    GSLibParInputData* clone();
     bool isCollection() { return true; }
 };
 
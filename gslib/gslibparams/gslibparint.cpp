@@ -29,7 +29,7 @@ bool GSLibParInt::update()
 
 GSLibParInt *GSLibParInt::clone()
 {
-    GSLibParInt *new_par = new GSLibParInt("","",_description);
+    GSLibParInt *new_par = new GSLibParInt(_name,_label,_description);
     new_par->_value = _value;
     return new_par;
 }
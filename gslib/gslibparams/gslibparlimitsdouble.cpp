@@ -3,7 +3,9 @@
 #include "widgets/widgetgslibparlimitsdouble.h"
 
 GSLibParLimitsDouble::GSLibParLimitsDouble(const QString name, const QString label, const QString description)
-    : GSLibParType(name, label, description)
+    : GSLibParType(name, label, description),
+      _min(0.0),
+      _max(0.0)
 {
 }
 
@@ -26,3 +28,11 @@ bool GSLibParLimitsDouble::update()
     ((WidgetGSLibParLimitsDouble*)this->_widget)->updateValue( this );
     return true;
 }
+
+GSLibParLimitsDouble *GSLibParLimitsDouble::clone()
+{
+    GSLibParLimitsDouble *new_par = new GSLibParLimitsDouble(_name, _label, _description);
+    new_par->_min = _min;
+    new_par->_max = _max;
+    return new_par;
+}
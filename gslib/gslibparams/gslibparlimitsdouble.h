@@ -22,6 +22,7 @@ public:
     QString getTypeName() {return "limits_double";}
     QWidget* getWidget();
     bool update();
+    GSLibParLimitsDouble* clone();
     bool isCollection() { return false; }
 };
 
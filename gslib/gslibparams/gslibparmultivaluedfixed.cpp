@@ -71,7 +71,7 @@ bool GSLibParMultiValuedFixed::update()
 
 GSLibParMultiValuedFixed *GSLibParMultiValuedFixed::clone()
 {
-    GSLibParMultiValuedFixed* new_par = new GSLibParMultiValuedFixed("", "", _description);
+    GSLibParMultiValuedFixed* new_par = new GSLibParMultiValuedFixed(_name, _label, _description);
     for( QList<GSLibParType*>::iterator it = _parameters.begin(); it != _parameters.end(); ++it ){
         GSLibParType* sub_par = (*it)->clone();
         if( sub_par ){
@@ -34,7 +34,7 @@ bool GSLibParOption::update()
 
 GSLibParOption *GSLibParOption::clone()
 {
-    GSLibParOption *result = new GSLibParOption("","","");
+    GSLibParOption *result = new GSLibParOption(_name,_label,_description);
     result->_selected_value = this->_selected_value;
     result->_options = QMap<int, QString>( this->_options );
     return result;
@@ -3,7 +3,10 @@
 #include "widgets/widgetgslibparrange.h"
 
 GSLibParRange::GSLibParRange(const QString name, const QString label, const QString description) :
-    GSLibParType(name, label, description)
+    GSLibParType(name, label, description),
+    _min(0.0),
+    _max(0.0),
+    _value(0.0)
 {
 }
 
@@ -26,3 +29,14 @@ bool GSLibParRange::update()
     ((WidgetGSLibParRange*)this->_widget)->updateValue( this );
     return true;
 }
+
+GSLibParRange *GSLibParRange::clone()
+{
+    GSLibParRange *new_par = new GSLibParRange(_name, _label, _description);
+    new_par->_min = _min;
+    new_par->_max = _max;
+    new_par->_min_label = _min_label;
+    new_par->_max_label = _max_label;
+    new_par->_value = _value;
+    return new_par;
+}
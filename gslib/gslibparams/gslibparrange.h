@@ -23,6 +23,7 @@ public:
     QString getTypeName() {return "range";}
     QWidget* getWidget();
     bool update();
+    GSLibParRange* clone();
     bool isCollection() { return false; }
 };
 
@@ -29,7 +29,7 @@ bool GSLibParString::update()
 
 GSLibParString *GSLibParString::clone()
 {
-    GSLibParString* new_par = new GSLibParString("","",_value);
+    GSLibParString* new_par = new GSLibParString(_name,_label,_description);
     new_par->_value = _value;
     return new_par;
 }
@@ -34,7 +34,7 @@ bool GSLibParUInt::update()
 
 GSLibParUInt *GSLibParUInt::clone()
 {
-    GSLibParUInt *new_par = new GSLibParUInt("","",_description);
+    GSLibParUInt *new_par = new GSLibParUInt(_name,_label,_description);
     new_par->_value = _value;
     return new_par;
 }
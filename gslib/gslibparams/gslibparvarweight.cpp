@@ -1,7 +1,9 @@
 #include "gslibparvarweight.h"
 
 GSLibParVarWeight::GSLibParVarWeight(const QString name, const QString label, const QString description) :
-    GSLibParType(name, label, description)
+    GSLibParType(name, label, description),
+    _var_index(0),
+    _wgt_index(0)
 {
 }
 
@@ -11,3 +13,11 @@ GSLibParVarWeight::GSLibParVarWeight(uint var_index, uint wgt_index) :
     _wgt_index(wgt_index)
 {
 }
+
+GSLibParVarWeight *GSLibParVarWeight::clone()
+{
+    GSLibParVarWeight *new_par = new GSLibParVarWeight(_name, _label, _description);
+    new_par->_var_index = _var_index;
+    new_par->_wgt_index = _wgt_index;
+    return new_par;
+}
@@ -25,6 +25,7 @@ public:
      */
     void save(QTextStream */*out*/){ throw InvalidMethodException(); }
     QString getTypeName() {return "var_weight";}
+    GSLibParVarWeight* clone();
     bool isCollection() { return false; }
 };
 
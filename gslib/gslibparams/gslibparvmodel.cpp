@@ -113,7 +113,7 @@ GSLibParVModel *GSLibParVModel::clone()
 {
     //delete the parameter objects instantiated by default.
 
-    GSLibParVModel* new_par = new GSLibParVModel("", "", _description);
+    GSLibParVModel* new_par = new GSLibParVModel(_name, _label, _description);
 
     delete new_par->_nst_and_nugget; //TODO: not good practice (delete members of other objects)
     new_par->_nst_and_nugget = _nst_and_nugget->clone();
@@ -5,6 +5,7 @@
 #include "imagejockey/svd/svdfactor.h"
 #include "imagejockey/widgets/ijquick3dviewer.h"
 #include "imagejockey/imagejockeyutils.h"
+#include "imagejockey/scattereddatainterpolator.h"
 #include <vtkSmartPointer.h>
 #include <vtkPoints.h>
 #include <vtkFloatArray.h>
@@ -82,6 +83,12 @@ void EMDAnalysisDialog::onPerformEMD()
                                     (spectral::index)nK,
                                     0.0);
 
+    //the interpolators keep the grid geometry and the factorizations between the sifting steps.
+    //one for each envelope, since the maxima and the minima are at different locations.
+    ScatteredDataInterpolator maximaInterpolator( *m_inputGrid );
+    ScatteredDataInterpolator minimaInterpolator( *m_inputGrid );
+    int maxSamplesPerInterpolation = ui->spinMaxSamplesPerInterpolation->value();
+
     IJGridViewerWidget ijgw2( true, false, true );
     ijgw2.setWindowTitle( "mean envelope" );
     ijgw2.show();
@@ -165,22 +172,22 @@ void EMDAnalysisDialog::onPerformEMD()
         spectral::array interpolatedMaximaEnvelope;
         spectral::array interpolatedMinimaEnvelope;
         if( ui->cmbInterpolationMethod->currentText() == "Shepard" ){
-            interpolatedMaximaEnvelope = ImageJockeyUtils::interpolateNullValuesShepard( localMaximaEnvelope,
-                                                            *m_inputGrid,
+            interpolatedMaximaEnvelope = maximaInterpolator.interpolateShepard( localMaximaEnvelope,
                                                             ui->dblSpinPowerParameter->value(),
+                                                            maxSamplesPerInterpolation,
                                                             ui->dblSpinMaxDistance->value(),
                                                             NDV );
 
-            interpolatedMinimaEnvelope = ImageJockeyUtils::interpolateNullValuesShepard( localMinimaEnvelope,
-                                                            *m_inputGrid,
+            interpolatedMinimaEnvelope = minimaInterpolator.interpolateShepard( localMinimaEnvelope,
                                                             ui->dblSpinPowerParameter->value(),
+                                                            maxSamplesPerInterpolation,
                                                             ui->dblSpinMaxDistance->value(),
                                                             NDV );
         } else {
             int status;
-            interpolatedMaximaEnvelope = ImageJockeyUtils::interpolateNullValuesThinPlateSpline( localMaximaEnvelope,
-                                                            *m_inputGrid,
+            interpolatedMaximaEnvelope = maximaInterpolator.interpolateThinPlateSpline( localMaximaEnvelope,
                                                             ui->dblSpinLambda->value(),
+                                                            maxSamplesPerInterpolation,
                                                             status );
             if( status ){
                 QMessageBox::critical( this, "Error",
@@ -188,9 +195,9 @@ void EMDAnalysisDialog::onPerformEMD()
                                        QString::number( status ));
                 return;
             }
-            interpolatedMinimaEnvelope = ImageJockeyUtils::interpolateNullValuesThinPlateSpline( localMinimaEnvelope,
-                                                            *m_inputGrid,
+            interpolatedMinimaEnvelope = minimaInterpolator.interpolateThinPlateSpline( localMinimaEnvelope,
                                                             ui->dblSpinLambda->value(),
+                                                            maxSamplesPerInterpolation,
                                                             status );
             if( status ){
                 QMessageBox::critical( this, "Error",
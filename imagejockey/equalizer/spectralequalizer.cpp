@@ -0,0 +1,190 @@
+#include "spectralequalizer.h"
+#include "../ijabstractcartesiangrid.h"
+#include "../imagejockeyutils.h"
+#include "spectral/spectral.h"
+
+#include <complex>
+#include <mutex>
+#include <algorithm>
+
+//defined in gaborutils.cpp: FFTW's planner is not thread-safe.
+extern std::mutex mutexFFTW;
+
+namespace {
+    /** The band lists are discarded when there are more than this (e.g. after many changes to the frequency window). */
+    const size_t MAX_CACHED_BANDS = 256;
+}
+
+SpectralEqualizer::SpectralEqualizer() :
+    m_grid( nullptr ),
+    m_amplitudeVariableIndex( -1 ),
+    m_phaseVariableIndex( -1 ),
+    m_nI( 0 ), m_nJ( 0 ), m_nK( 0 ),
+    m_spectrumIsValid( false ),
+    m_plan( nullptr ),
+    m_planInput( nullptr ),
+    m_planOutput( nullptr )
+{
+}
+
+SpectralEqualizer::~SpectralEqualizer()
+{
+    destroyPlan();
+}
+
+void SpectralEqualizer::setGrid(IJAbstractCartesianGrid *grid, int amplitudeVariableIndex)
+{
+    if( grid == m_grid && amplitudeVariableIndex == m_amplitudeVariableIndex && grid &&
+        grid->getNI() == m_nI && grid->getNJ() == m_nJ && grid->getNK() == m_nK )
+        return;
+    m_grid = grid;
+    m_amplitudeVariableIndex = amplitudeVariableIndex;
+    m_bands.clear();
+    invalidateSpectrum();
+    destroyPlan();
+    if( grid ){
+        m_nI = grid->getNI();
+        m_nJ = grid->getNJ();
+        m_nK = grid->getNK();
+    } else {
+        m_nI = m_nJ = m_nK = 0;
+    }
+}
+
+void SpectralEqualizer::invalidateSpectrum()
+{
+    m_spectrumIsValid = false;
+    std::vector<double>().swap( m_spectrum );
+}
+
+void SpectralEqualizer::equalize(double centralFrequency,
+                                 const QList<QPointF> &areaOfInfluence,
+                                 const QList<QPointF> &halfBand,
+                                 double delta_dB,
+                                 double dB_reference)
+{
+    if( ! m_grid || m_amplitudeVariableIndex < 0 )
+        return;
+    const std::vector<long>& cells = getBandCells( centralFrequency, areaOfInfluence, halfBand );
+    m_grid->equalizeCells( cells, delta_dB, m_amplitudeVariableIndex, dB_reference );
+    if( m_spectrumIsValid )
+        updateSpectrum( cells );
+}
+
+const std::vector<long> &SpectralEqualizer::getBandCells(double centralFrequency,
+                                                         const QList<QPointF> &areaOfInfluence,
+                                                         const QList<QPointF> &halfBand)
+{
+    std::map<double, Band>::iterator it = m_bands.find( centralFrequency );
+    if( it != m_bands.end() &&
+        it->second.areaOfInfluence == areaOfInfluence &&
+        it->second.halfBand == halfBand )
+        return it->second.cells;
+
+    if( it == m_bands.end() && m_bands.size() >= MAX_CACHED_BANDS )
+        m_bands.clear();
+
+    Band& band = m_bands[ centralFrequency ];
+    band.areaOfInfluence = areaOfInfluence;
+    band.halfBand = halfBand;
+
+    //the cells in the band
+    m_grid->getCellsWithin( areaOfInfluence, halfBand, band.cells );
+
+    //the cells in the opposite band, to preserve the Fourier image's symmetry
+    QList<QPointF> mirroredAreaOfInfluence = areaOfInfluence;
+    QList<QPointF> mirroredHalfBand = halfBand;
+    ImageJockeyUtils::mirror2D( mirroredAreaOfInfluence, m_grid->getCenterLocation() );
+    ImageJockeyUtils::mirror2D( mirroredHalfBand, m_grid->getCenterLocation() );
+    std::vector<long> mirroredCells;
+    m_grid->getCellsWithin( mirroredAreaOfInfluence, mirroredHalfBand, mirroredCells );
+
+    //a cell in both lists is equalized twice, like when each area is equalized separately.
+    band.cells.insert( band.cells.end(), mirroredCells.begin(), mirroredCells.end() );
+    return band.cells;
+}
+
+void SpectralEqualizer::updateSpectrum(const std::vector<long> &cells)
+{
+    const long nI = m_nI;
+    const long nJ = m_nJ;
+    const long nK = m_nK;
+    for( long cell : cells ){
+        //the cell in the shifted Fourier image (GSLib scan order)
+        long iShift = cell % nI;
+        long jShift = ( cell / nI ) % nJ;
+        long kShift = cell / ( nI * nJ );
+        //the cell in the de-shifted spectrum (inverse of the de-shift in ImageJockeyUtils::prepareToFFTW3reverseFFT())
+        long i = ( iShift + nI - nI/2 ) % nI;
+        long j = ( jShift + nJ - nJ/2 ) % nJ;
+        long k = ( kShift + nK - nK/2 ) % nK;
+        long idxReady = k + nK * ( j + nJ * i );
+        //convert it to rectangular form
+        std::complex<double> value = std::polar( m_grid->getData( m_amplitudeVariableIndex, iShift, jShift, kShift ),
+                                                 m_grid->getData( m_phaseVariableIndex, iShift, jShift, kShift ) );
+        m_spectrum[ 2 * idxReady ] = value.real();
+        m_spectrum[ 2 * idxReady + 1 ] = value.imag();
+    }
+}
+
+bool SpectralEqualizer::reverseFFT(int phaseVariableIndex, spectral::array &output)
+{
+    if( ! m_grid || m_amplitudeVariableIndex < 0 || phaseVariableIndex < 0 )
+        return false;
+
+    const size_t nCells = (size_t)m_nI * m_nJ * m_nK;
+
+    //build the spectrum only for the first preview or if the phases changed.
+    if( ! m_spectrumIsValid || phaseVariableIndex != m_phaseVariableIndex ){
+        spectral::complex_array dataReady( (spectral::index)m_nI,
+                                           (spectral::index)m_nJ,
+                                           (spectral::index)m_nK );
+        if( ! ImageJockeyUtils::prepareToFFTW3reverseFFT( m_grid,
+                                                          m_amplitudeVariableIndex,
+                                                          m_grid,
+                                                          phaseVariableIndex,
+                                                          dataReady ) )
+            return false;
+        m_spectrum.resize( 2 * nCells );
+        for( size_t i = 0; i < nCells; ++i ){
+            m_spectrum[ 2 * i ] = dataReady.d_[i][0];
+            m_spectrum[ 2 * i + 1 ] = dataReady.d_[i][1];
+        }
+        m_phaseVariableIndex = phaseVariableIndex;
+        m_spectrumIsValid = true;
+    }
+
+    //the plan is made only once per grid.
+    if( ! m_plan ){
+        std::unique_lock<std::mutex> lck( mutexFFTW, std::defer_lock );
+        lck.lock();
+        m_planInput = (fftw_complex *)fftw_malloc( sizeof(fftw_complex) * nCells );
+        m_planOutput = (double *)fftw_malloc( sizeof(double) * nCells );
+        m_plan = fftw_plan_dft_c2r_3d( m_nI, m_nJ, m_nK, m_planInput, m_planOutput, FFTW_ESTIMATE );
+        lck.unlock();
+    }
+
+    //the c2r transform overwrites its input, so it works on a copy of the spectrum.
+    std::copy( m_spectrum.begin(), m_spectrum.end(), &m_planInput[0][0] );
+    fftw_execute( m_plan );
+
+    output = spectral::array( (spectral::index)m_nI, (spectral::index)m_nJ, (spectral::index)m_nK );
+    std::copy( m_planOutput, m_planOutput + nCells, output.d_.begin() );
+    return true;
+}
+
+void SpectralEqualizer::destroyPlan()
+{
+    std::unique_lock<std::mutex> lck( mutexFFTW, std::defer_lock );
+    lck.lock();
+    if( m_plan )
+        fftw_destroy_plan( m_plan );
+    if( m_planInput )
+        fftw_free( m_planInput );
+    if( m_planOutput )
+        fftw_free( m_planOutput );
+    lck.unlock();
+    m_plan = nullptr;
+    m_planInput = nullptr;
+    m_planOutput = nullptr;
+}
@@ -0,0 +1,99 @@
+#ifndef SPECTRALEQUALIZER_H
+#define SPECTRALEQUALIZER_H
+
+#include <QList>
+#include <QPointF>
+#include <vector>
+#include <map>
+#include <fftw3.h>
+
+class IJAbstractCartesianGrid;
+
+namespace spectral {
+    struct array;
+}
+
+/**
+ * The SpectralEqualizer class applies the edits made with the equalizer sliders to a Fourier image (amplitudes and
+ * phases in polar form with the low frequencies shifted to the center) and computes its reverse FFT incrementally.
+ *
+ * The cells affected by each equalizer band (its area of influence clipped by the half-band and their mirrors about
+ * the center of the grid) are found only once and kept in index lists keyed by the band's central frequency, so
+ * moving a slider only visits the cells of its band instead of scanning the whole grid with polygon tests.  The lists
+ * are recomputed automatically when the band geometry changes (e.g. the user rotates the azimuth).
+ *
+ * The rectangular de-shifted spectrum ready for FFTW is built once and then kept up to date by converting only the
+ * cells changed by the sliders, so a preview costs just one inverse FFT with a cached FFTW plan.
+ */
+class SpectralEqualizer
+{
+public:
+    SpectralEqualizer();
+    ~SpectralEqualizer();
+
+    SpectralEqualizer( const SpectralEqualizer& ) = delete;
+    SpectralEqualizer& operator=( const SpectralEqualizer& ) = delete;
+
+    /** Sets the grid and the variable with the amplitudes to be edited.  This discards all cached data
+     * if either differs from the current ones. */
+    void setGrid( IJAbstractCartesianGrid* grid, int amplitudeVariableIndex );
+
+    /** Discards the cached spectrum.  Call this when the grid values change by means other than equalize()
+     * (e.g. the grid is reloaded from file). */
+    void invalidateSpectrum();
+
+    /**
+     * Amplifies (dB > 0) or attenuates (dB < 0) the amplitudes in a band and in its mirror about the center of the grid.
+     * @param centralFrequency The band's central frequency.  It identifies the band in the cache.
+     * @param areaOfInfluence The geometry of the band.
+     * @param halfBand Clips the area of influence (e.g. the azimuth tolerance).
+     * @param dB_reference The value corresponding to 0dB.
+     */
+    void equalize( double centralFrequency,
+                   const QList<QPointF>& areaOfInfluence,
+                   const QList<QPointF>& halfBand,
+                   double delta_dB,
+                   double dB_reference );
+
+    /**
+     * Computes the reverse FFT of the current amplitudes with the phases in the given variable.  The output array is
+     * resized to the grid dimensions.  As usual with FFTW, the values are not divided by the number of cells.
+     * Returns false if the spectrum could not be built.
+     */
+    bool reverseFFT( int phaseVariableIndex, spectral::array& output );
+
+private:
+    /** The cells affected by an equalizer band and the geometry they were computed from. */
+    struct Band {
+        QList<QPointF> areaOfInfluence;
+        QList<QPointF> halfBand;
+        std::vector<long> cells;
+    };
+
+    IJAbstractCartesianGrid* m_grid;
+    int m_amplitudeVariableIndex;
+    int m_phaseVariableIndex;
+    int m_nI, m_nJ, m_nK;
+
+    std::map<double, Band> m_bands;
+
+    /** The de-shifted spectrum in rectangular form and in FFTW scan order (interleaved real and imaginary parts). */
+    std::vector<double> m_spectrum;
+    bool m_spectrumIsValid;
+
+    fftw_plan m_plan;
+    fftw_complex* m_planInput;
+    double* m_planOutput;
+
+    /** Returns the cells of a band, computing them if the band is new or its geometry changed. */
+    const std::vector<long>& getBandCells( double centralFrequency,
+                                           const QList<QPointF>& areaOfInfluence,
+                                           const QList<QPointF>& halfBand );
+
+    /** Converts the given cells (GSLib linear indexes) of the Fourier image into the cached spectrum. */
+    void updateSpectrum( const std::vector<long>& cells );
+
+    void destroyPlan();
+};
+
+#endif // SPECTRALEQUALIZER_H
@@ -4,35 +4,56 @@
 #include "imagejockey/widgets/ijgridviewerwidget.h"
 #include "imagejockey/svd/svdfactor.h"
 #include "spectral/spectral.h"
-#include <itkStatisticsImageFilter.h>
-#include <itkAbsImageFilter.h>
 #include <QProgressDialog>
 #include <thread>
+#include <atomic>
+#include <chrono>
+
+/** The code for multithreaded scan *////////////////////////
+/** Computes the metrics of the Gabor responses of the frequency-azimuth pairs fetched
+ * from the shared counter until all pairs are done.  Each thread takes the next pair when it finishes
+ * the current one, so the threads are kept busy until the end of the scan. */
+void taskScanFrequencyAzimuthPairs( const GaborFFTConvolver& convolver,
+                                    const std::vector< std::pair<spectral::index, spectral::index> >& fAzPairs,
+                                    const std::vector<double>& fSchedule,
+                                    const std::vector<double>& azSchedule,
+                                    double meanMajorAxis,
+                                    double meanMinorAxis,
+                                    double sigmaMajorAxis,
+                                    double sigmaMinorAxis,
+                                    bool useMaximum,
+                                    std::atomic<size_t>& nextPair,
+                                    std::atomic<size_t>& donePairsCount,
+                                    spectral::array& gridData ){
+    spectral::complex_array response;
+    for( size_t iPair = nextPair++; iPair < fAzPairs.size(); iPair = nextPair++ ){
+        spectral::index iF = fAzPairs[iPair].first;
+        spectral::index iAz = fAzPairs[iPair].second;
+
+        //compute the Gabor response (real and imaginary parts) of a given frequency-azimuth pair
+        convolver.computeComplexGaborResponse( fSchedule[iF],
+                                               azSchedule[iAz],
+                                               meanMajorAxis,
+                                               meanMinorAxis,
+                                               sigmaMajorAxis,
+                                               sigmaMinorAxis,
+                                               response );
+
+        //compute the metrics
+        double max = 0.0;
+        double mean = 0.0;
+        for( spectral::index i = 0; i < response.size(); ++i ){
+            double amplitude = std::hypot( response[i][0], response[i][1] );
+            if( amplitude > max )
+                max = amplitude;
+            mean += amplitude;
+        }
+        mean /= response.size();
 
-/** The code for multithreaded convolution *////////////////////////
-void taskConvolution( double frequency,
-             double azimuth,
-             double meanMajorAxis,
-             double meanMinorAxis,
-             double sigmaMajorAxis,
-             double sigmaMinorAxis,
-             int kernelSizeI,
-             int kernelSizeJ,
-             const spectral::array &inputGrid,
-             bool imaginaryPart,
-             GaborUtils::ImageTypePtr* response
-           ){
-             *response =
-                GaborUtils::computeGaborResponse( frequency,
-                                                  azimuth,
-                                                  meanMajorAxis,
-                                                  meanMinorAxis,
-                                                  sigmaMajorAxis,
-                                                  sigmaMinorAxis,
-                                                  kernelSizeI,
-                                                  kernelSizeJ,
-                                                  inputGrid,
-                                                  imaginaryPart );
+        //assing the metric to the frequency/azimuth space (each pair has its own element, so no locking is needed)
+        gridData( iF, iAz ) = useMaximum ? max : mean;
+        ++donePairsCount;
+    }
 }
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -95,15 +116,9 @@ void GaborScanDialog::updateFrequAzSelectionDisplay()
 
 void GaborScanDialog::onScan()
 {
-    typedef itk::StatisticsImageFilter<GaborUtils::ImageType> StatisticsImageFilterType;
-    typedef itk::AbsImageFilter <GaborUtils::ImageType, GaborUtils::ImageType> AbsImageFilterType;
-
     double az0 = 0.0;
     double az1 = 180.0;
 
-    int nI = m_inputGrid->getNI();
-    int nJ = m_inputGrid->getNJ();
-
     //get the user settings
     double azStep = ui->txtAzStep->text().toDouble();
     double fStep = ui->txtFStep->text().toDouble();
@@ -123,100 +138,58 @@ void GaborScanDialog::onScan()
     for( double frequency = f0; frequency <= f1; frequency += fStep )
         fSchedule.push_back( frequency );
 
+    //define the list of frequency-azimuth pairs to scan
+    std::vector< std::pair<spectral::index, spectral::index> > fAzPairs;
+    for( spectral::index iAz = 0; iAz < static_cast<spectral::index>( azSchedule.size() ); ++iAz )
+        for( spectral::index iF = 0; iF < static_cast<spectral::index>( fSchedule.size() ); ++iF )
+            fAzPairs.push_back( { iF, iAz } );
+
     //////////////////////////////////
     QProgressDialog progressDialog;
     progressDialog.show();
     progressDialog.setLabelText("Scanning responses of Gabor frequencies and azimuths...");
     progressDialog.setMinimum( 0 );
-    progressDialog.setMaximum( azSchedule.size() * fSchedule.size() );
+    progressDialog.setMaximum( fAzPairs.size() );
     progressDialog.show();
+    QApplication::processEvents();
     /////////////////////////////////
 
     //create a grid object to receive the metric values during the scan
     spectral::array gridData( static_cast<spectral::index>(fSchedule.size()),
                               static_cast<spectral::index>(azSchedule.size()) );
 
+    //the spectrum of the input image is computed once for the entire scan
+    GaborFFTConvolver convolver( *inputImage, m_kernelSizeI, m_kernelSizeJ );
 
     //scan frequencies and azimuths
-    spectral::index iAz = 0;
-    const int MEAN = 0;
-    const int MAX = 1;
-    int whichMetric = 2;
-    if( ui->cmbMetric->currentText() == "mean" )
-        whichMetric = MEAN;
-    if( ui->cmbMetric->currentText() == "maximum" )
-        whichMetric = MAX;
-    for( const double& azimuth : azSchedule ){
-        spectral::index iF = 0;
-        for( const double& frequency : fSchedule ){
-            //update the progress dialog
-            progressDialog.setValue( progressDialog.value()+1 );
-            QApplication::processEvents();
-            //compute the Gabor responses of a given frequency-azimuth pair
-
-            //run the imaginary part in a separate thread
-            GaborUtils::ImageTypePtr responseImagPart;
-            std::thread thread = std::thread( taskConvolution,
-                                  frequency,
-                                  azimuth,
-                                    m_meanMajorAxis,
-                                    m_meanMinorAxis,
-                                    m_sigmaMajorAxis,
-                                    m_sigmaMinorAxis,
-                                    m_kernelSizeI,
-                                    m_kernelSizeJ,
-                                    *inputImage,
-                                    true,
-                                    &responseImagPart
-                                  );
-
-            GaborUtils::ImageTypePtr responseRealPart =
-                    GaborUtils::computeGaborResponse( frequency,
-                                                      azimuth,
-                                                      m_meanMajorAxis,
-                                                      m_meanMinorAxis,
-                                                      m_sigmaMajorAxis,
-                                                      m_sigmaMinorAxis,
-                                                      m_kernelSizeI,
-                                                      m_kernelSizeJ,
-                                                      *inputImage,
-                                                      false);
-
-            //wait for the imaginary part thread to finish.
-            thread.join();
-
-            //compute the metrics
-            GaborUtils::realType max = std::numeric_limits<GaborUtils::realType>::min();
-            GaborUtils::realType mean = 0.0;
-            for(unsigned int j = 0; j < nJ; ++j)
-                for(unsigned int i = 0; i < nI; ++i){
-                    itk::Index<GaborUtils::gridDim> index;
-                    index[0] = i;
-                    index[1] = j;
-                    GaborUtils::realType rValue = responseRealPart->GetPixel( index );
-                    GaborUtils::realType iValue = responseImagPart->GetPixel( index );
-                    std::complex<GaborUtils::realType> cValue( rValue, iValue );
-                    GaborUtils::realType amplitude = std::abs( cValue );
-                    if( amplitude > max )
-                        max = amplitude;
-                    mean += amplitude;
-                }
-            mean /= ( nI * nJ );
-
-            //get the metric
-            double metric;
-            switch( whichMetric ){
-            case MEAN: metric = mean; break;
-            case MAX: metric = max; break;
-            default: metric = 0.0;
-            }
-
-            //assing the metric to the frequency/azimuth space
-            gridData(iF, iAz) = metric;
-            ++iF;
-        }
-        ++iAz;
+    bool useMaximum = ( ui->cmbMetric->currentText() == "maximum" );
+    unsigned int nThreads = std::max( 1u, std::min<unsigned int>( std::thread::hardware_concurrency(), fAzPairs.size() ) );
+    std::atomic<size_t> nextPair( 0 );
+    std::atomic<size_t> donePairsCount( 0 );
+    std::thread threads[nThreads];
+    for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+        threads[iThread] = std::thread( taskScanFrequencyAzimuthPairs,
+                                        std::cref( convolver ),
+                                        std::cref( fAzPairs ),
+                                        std::cref( fSchedule ),
+                                        std::cref( azSchedule ),
+                                        m_meanMajorAxis,
+                                        m_meanMinorAxis,
+                                        m_sigmaMajorAxis,
+                                        m_sigmaMinorAxis,
+                                        useMaximum,
+                                        std::ref( nextPair ),
+                                        std::ref( donePairsCount ),
+                                        std::ref( gridData ) );
+
+    //update the progress dialog while the threads work
+    while( donePairsCount < fAzPairs.size() ){
+        progressDialog.setValue( static_cast<int>( donePairsCount.load() ) );
+        QApplication::processEvents();
+        std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
     }
+    for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+        threads[iThread].join();
 
     //show the scan result
     SVDFactor* grid = new SVDFactor( std::move(gridData),
@@ -2,6 +2,7 @@
 #include "imagejockey/imagejockeyutils.h"
 #include <itkImageDuplicator.h>
 #include <mutex>
+#include <cmath>
 
 std::mutex mutexFFTW; //spectral::conv2d calls FFTW, which crashes when called concurrently
 
@@ -399,3 +400,124 @@ GaborUtils::ImageTypePtr GaborUtils::convertSpectralArrayToITKImage( const spect
     return output;
 }
 
+
+GaborFFTConvolver::GaborFFTConvolver(const spectral::array &inputGrid, int kernelSizeI, int kernelSizeJ) :
+    m_nI( inputGrid.M() ),
+    m_nJ( inputGrid.N() ),
+    m_kernelSizeI( kernelSizeI ),
+    m_kernelSizeJ( kernelSizeJ ),
+    m_paddedNI( getFFTFriendlySize( inputGrid.M() + kernelSizeI - 1 ) ),
+    m_paddedNJ( getFFTFriendlySize( inputGrid.N() + kernelSizeJ - 1 ) )
+{
+    size_t paddedSize = (size_t)m_paddedNI * m_paddedNJ;
+    m_inputSpectrum = (fftw_complex *)fftw_malloc( sizeof(fftw_complex) * paddedSize );
+    fftw_complex* buffer = (fftw_complex *)fftw_malloc( sizeof(fftw_complex) * paddedSize );
+
+    //the plans are out-of-place, so they can be executed with other arrays (fftw_execute_dft()) allocated
+    //with fftw_malloc(), which guarantees the same alignment
+    {
+        std::unique_lock<std::mutex> lck (mutexFFTW); //FFTW planner is not thread-safe
+        m_forwardPlan  = fftw_plan_dft_2d( m_paddedNI, m_paddedNJ, buffer, m_inputSpectrum, FFTW_FORWARD,  FFTW_ESTIMATE );
+        m_backwardPlan = fftw_plan_dft_2d( m_paddedNI, m_paddedNJ, buffer, m_inputSpectrum, FFTW_BACKWARD, FFTW_ESTIMATE );
+    }
+
+    //zero-pad the input image (unvalued cells are taken as zeros, as in spectral::conv2d())
+    for( size_t i = 0; i < paddedSize; ++i )
+        buffer[i][0] = buffer[i][1] = 0.0;
+    for( int i = 0; i < m_nI; ++i )
+        for( int j = 0; j < m_nJ; ++j ){
+            double value = inputGrid( i, j, 0 );
+            buffer[ (size_t)i * m_paddedNJ + j ][0] = std::isfinite( value ) ? value : 0.0;
+        }
+
+    //compute the spectrum of the input image once
+    fftw_execute_dft( m_forwardPlan, buffer, m_inputSpectrum );
+
+    fftw_free( buffer );
+}
+
+GaborFFTConvolver::~GaborFFTConvolver()
+{
+    {
+        std::unique_lock<std::mutex> lck (mutexFFTW);
+        fftw_destroy_plan( m_forwardPlan );
+        fftw_destroy_plan( m_backwardPlan );
+    }
+    fftw_free( m_inputSpectrum );
+}
+
+void GaborFFTConvolver::computeComplexGaborResponse(double frequency,
+                                                    double azimuth,
+                                                    double meanMajorAxis,
+                                                    double meanMinorAxis,
+                                                    double sigmaMajorAxis,
+                                                    double sigmaMinorAxis,
+                                                    spectral::complex_array &response) const
+{
+    //make the real and imaginary kernels, normalized as in GaborUtils::computeGaborResponse()
+    spectral::array kernelReal = GaborUtils::convertITKImageToSpectralArray(
+                *GaborUtils::createGaborKernel( frequency, azimuth, meanMajorAxis, meanMinorAxis,
+                                                sigmaMajorAxis, sigmaMinorAxis, m_kernelSizeI, m_kernelSizeJ, false ) );
+    spectral::array kernelImag = GaborUtils::convertITKImageToSpectralArray(
+                *GaborUtils::createGaborKernel( frequency, azimuth, meanMajorAxis, meanMinorAxis,
+                                                sigmaMajorAxis, sigmaMinorAxis, m_kernelSizeI, m_kernelSizeJ, true ) );
+    spectral::normalize( kernelReal );
+    spectral::normalize( kernelImag );
+
+    //zero-pad the complex kernel
+    size_t paddedSize = (size_t)m_paddedNI * m_paddedNJ;
+    fftw_complex* bufferA = (fftw_complex *)fftw_malloc( sizeof(fftw_complex) * paddedSize );
+    fftw_complex* bufferB = (fftw_complex *)fftw_malloc( sizeof(fftw_complex) * paddedSize );
+    for( size_t i = 0; i < paddedSize; ++i )
+        bufferA[i][0] = bufferA[i][1] = 0.0;
+    for( int i = 0; i < kernelReal.M(); ++i )
+        for( int j = 0; j < kernelReal.N(); ++j ){
+            double realValue = kernelReal( i, j, 0 );
+            double imagValue = kernelImag( i, j, 0 );
+            bufferA[ (size_t)i * m_paddedNJ + j ][0] = std::isfinite( realValue ) ? realValue : 0.0;
+            bufferA[ (size_t)i * m_paddedNJ + j ][1] = std::isfinite( imagValue ) ? imagValue : 0.0;
+        }
+
+    //convolution theorem: the response is the inverse FFT of the product of the spectra.
+    //since the input image is real, the real and imaginary parts of the result are the
+    //convolutions of the image with the real and imaginary kernels, respectively.
+    fftw_execute_dft( m_forwardPlan, bufferA, bufferB );
+    for( size_t i = 0; i < paddedSize; ++i ){
+        double re = bufferB[i][0] * m_inputSpectrum[i][0] - bufferB[i][1] * m_inputSpectrum[i][1];
+        double im = bufferB[i][0] * m_inputSpectrum[i][1] + bufferB[i][1] * m_inputSpectrum[i][0];
+        bufferB[i][0] = re;
+        bufferB[i][1] = im;
+    }
+    fftw_execute_dft( m_backwardPlan, bufferB, bufferA );
+
+    //take the central part of the full convolution as spectral::project() does in
+    //GaborUtils::computeGaborResponse(), and undo the scaling of FFTW's unnormalized transforms.
+    int fullNI = m_nI + m_kernelSizeI - 1;
+    int fullNJ = m_nJ + m_kernelSizeJ - 1;
+    int offsetI = fullNI / 2 - m_nI / 2;
+    int offsetJ = fullNJ / 2 - m_nJ / 2;
+    double scale = 1.0 / paddedSize;
+    if( response.M() != m_nI || response.N() != m_nJ || response.size() != (spectral::index)m_nI * m_nJ )
+        response = spectral::complex_array( m_nI, m_nJ );
+    for( int i = 0; i < m_nI; ++i )
+        for( int j = 0; j < m_nJ; ++j ){
+            const fftw_complex& value = bufferA[ (size_t)( i + offsetI ) * m_paddedNJ + ( j + offsetJ ) ];
+            response( i, j )[0] = value[0] * scale;
+            response( i, j )[1] = value[1] * scale;
+        }
+
+    fftw_free( bufferA );
+    fftw_free( bufferB );
+}
+
+int GaborFFTConvolver::getFFTFriendlySize(int minSize)
+{
+    for( int size = std::max( 1, minSize ); ; ++size ){
+        int remainder = size;
+        for( int factor : { 2, 3, 5, 7 } )
+            while( remainder % factor == 0 )
+                remainder /= factor;
+        if( remainder == 1 )
+            return size;
+    }
+}
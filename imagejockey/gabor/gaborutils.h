@@ -2,6 +2,7 @@
 #define GABORUTILS_H
 
 #include "imagejockey/ijabstractcartesiangrid.h"
+#include "spectral/spectral.h"
 #include <itkGaborImageSource.h>
 #include <itkConvolutionImageFilter.h>
 #include <itkGaussianInterpolateImageFunction.h>
@@ -143,4 +144,57 @@ public:
     static ImageTypePtr convertSpectralArrayToITKImage( const spectral::array& input );
 };
 
+/**
+ * The GaborFFTConvolver class computes the Gabor responses of a given image to many kernels (e.g. in a
+ * frequency-azimuth scan).  The image's spectrum is computed only once, so each response costs one forward
+ * FFT of the kernel, one product and one inverse FFT.  Furthermore, the real and the imaginary kernels are
+ * combined into one complex kernel, so both parts of the response are obtained with a single pass.
+ * The results are the same of GaborUtils::computeGaborResponse( ..., const spectral::array& inputGrid, ... ).
+ * The FFTW plans are made once in the constructor, thus computeComplexGaborResponse() can be called
+ * concurrently from many threads.
+ */
+class GaborFFTConvolver
+{
+public:
+    /**
+     * @param inputGrid The input image.  Only the first slice is used and unvalued cells are taken as zeros.
+     * @param kernelSizeI The size of the kernels in number of cells in E-W direction.
+     * @param kernelSizeJ The size of the kernels in number of cells in N-S direction.
+     */
+    GaborFFTConvolver( const spectral::array& inputGrid, int kernelSizeI, int kernelSizeJ );
+    ~GaborFFTConvolver();
+
+    GaborFFTConvolver( const GaborFFTConvolver& ) = delete;
+    GaborFFTConvolver& operator=( const GaborFFTConvolver& ) = delete;
+
+    /**
+     * Computes the complex Gabor response of the input image for the given Gabor parameters
+     * (see GaborUtils::computeGaborResponse()).  The real part of the response is the response to the real kernel
+     * and the imaginary part of the response is the response to the imaginary kernel.  This method is thread-safe.
+     * @param response The output array, which is resized to the input image's nI x nJ.
+     */
+    void computeComplexGaborResponse( double frequency,
+                                      double azimuth,
+                                      double meanMajorAxis,
+                                      double meanMinorAxis,
+                                      double sigmaMajorAxis,
+                                      double sigmaMinorAxis,
+                                      spectral::complex_array& response ) const;
+
+    /** Returns a size greater than or equal to the given size whose only prime factors are 2, 3, 5 and 7,
+     * which are the sizes FFTW transforms fastest. */
+    static int getFFTFriendlySize( int minSize );
+
+private:
+    int m_nI, m_nJ;
+    int m_kernelSizeI, m_kernelSizeJ;
+    /** The size of the zero-padded arrays (at least image size + kernel size - 1, so the circular convolution
+     * has the linear convolution). */
+    int m_paddedNI, m_paddedNJ;
+    /** The FFT of the zero-padded input image. */
+    fftw_complex* m_inputSpectrum;
+    fftw_plan m_forwardPlan;
+    fftw_plan m_backwardPlan;
+};
+
 #endif // GABORUTILS_H
@@ -2,6 +2,9 @@
 #include "imagejockeyutils.h"
 #include <cmath>
 #include "spectral/spectral.h"
+#include <boost/geometry.hpp>
+#include <boost/geometry/geometries/point_xy.hpp>
+#include <boost/geometry/geometries/polygon.hpp>
 
 IJAbstractCartesianGrid::IJAbstractCartesianGrid()
 {
@@ -62,3 +65,87 @@ IJSpatialLocation IJAbstractCartesianGrid::getCenterLocation() const
     result._z = (zf + z0) / 2.0;
     return result;
 }
+
+void IJAbstractCartesianGrid::equalizeValues(const QList<QPointF> &area,
+                                             double delta_dB,
+                                             int variableIndex,
+                                             double dB_reference,
+                                             const QList<QPointF> &secondArea)
+{
+    std::vector<long> cells;
+    getCellsWithin( area, secondArea, cells );
+    equalizeCells( cells, delta_dB, variableIndex, dB_reference );
+}
+
+void IJAbstractCartesianGrid::getCellsWithin(const QList<QPointF> &area,
+                                             const QList<QPointF> &secondArea,
+                                             std::vector<long> &cells) const
+{
+    cells.clear();
+    if( area.isEmpty() )
+        return;
+
+    //some typedefs to shorten code
+    typedef boost::geometry::model::d2::point_xy<double> boostPoint2D;
+    typedef boost::geometry::model::polygon<boostPoint2D> boostPolygon;
+
+    //define a Boost polygon from the area geometry points
+    std::vector<boostPoint2D> points;
+    for( const QPointF& point : area )
+        points.push_back( boostPoint2D( point.x(), point.y() ) );
+    boostPolygon poly;
+    boost::geometry::assign_points( poly, points );
+
+    //define a Boost polygon from the second area (if not empty)
+    boostPolygon secondPoly;
+    if( ! secondArea.empty() ){
+        std::vector<boostPoint2D> secondPoints;
+        for( const QPointF& point : secondArea )
+            secondPoints.push_back( boostPoint2D( point.x(), point.y() ) );
+        boost::geometry::assign_points( secondPoly, secondPoints );
+    }
+
+    //get the 2D bounding box of the polygon
+    double minX = std::numeric_limits<double>::max();
+    double maxX = std::numeric_limits<double>::lowest();
+    double minY = std::numeric_limits<double>::max();
+    double maxY = std::numeric_limits<double>::lowest();
+    for( const QPointF& point : area ){
+        minX = std::min<double>( minX, point.x() );
+        maxX = std::max<double>( maxX, point.x() );
+        minY = std::min<double>( minY, point.y() );
+        maxY = std::max<double>( maxY, point.y() );
+    }
+
+    //scan the grid, testing each cell whether it lies within the area.
+    const long nI = getNI();
+    const long nJ = getNJ();
+    const long nK = getNK();
+    const bool isRotated = getRotation() != 0.0;
+    for( long k = 0; k < nK; ++k ){
+        // z coordinate is ignored: the areas are in the XY plane
+        for( long j = 0; j < nJ; ++j ){
+            double cellCenterY = getOriginY() + j * getCellSizeJ();
+            // The bounding box test is a faster test to promplty discard rows obviously outside.
+            // The rows of a rotated grid are not parallel to the X axis, so they cannot be discarded as a whole.
+            if( ! isRotated && ( cellCenterY < minY || cellCenterY > maxY ) )
+                continue;
+            for( long i = 0; i < nI; ++i ){
+                double cellCenterX = getOriginX() + i * getCellSizeI();
+                if( isRotated ){
+                    double cellCenterZ;
+                    getCellLocation( i, j, k, cellCenterX, cellCenterY, cellCenterZ );
+                }
+                boostPoint2D p(cellCenterX, cellCenterY);
+                // if the cell center lies within the area
+                if(     ImageJockeyUtils::isWithinBBox( cellCenterX, cellCenterY, minX, minY, maxX, maxY )
+                        &&
+                        boost::geometry::within(p, poly)
+                        &&
+                        ( secondArea.isEmpty() || boost::geometry::within(p, secondPoly) )   ){
+                    cells.push_back( i + nI * ( j + nJ * k ) );
+                }
+            }
+        }
+    }
+}
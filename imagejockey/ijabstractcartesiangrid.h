@@ -6,6 +6,9 @@
 #include <QString>
 #include <QIcon>
 #include <memory>
+#include <vector>
+#include <QList>
+#include <QPointF>
 
 class IJAbstractVariable;
 
@@ -118,12 +121,32 @@ public:
      * @param dB_reference The value corresponding to 0dB.
      * @param secondArea Another area used as spatial criterion.  If empty, this is not used.  If this area does
      *        not intersect the first area (area parameter) no cell will be selected.
+     * @note This scans the whole grid.  Client code that equalizes the same areas repeatedly (e.g. the equalizer
+     *       sliders) should collect the cells once with getCellsWithin() and then call equalizeCells().
      */
-    virtual void equalizeValues(QList<QPointF>& area,
-                                double delta_dB,
-                                int variableIndex,
-                                double dB_reference,
-                                const QList<QPointF>& secondArea = QList<QPointF>()) = 0;
+    void equalizeValues(const QList<QPointF>& area,
+                        double delta_dB,
+                        int variableIndex,
+                        double dB_reference,
+                        const QList<QPointF>& secondArea = QList<QPointF>());
+
+    /** Amplifies or attenuates the values of the given cells.  See equalizeValues() for the meaning of the parameters.
+     * @param cells The linear indexes of the cells (i + nI * ( j + nJ * k ) ).  A cell listed more than once is
+     *        equalized more than once.
+     */
+    virtual void equalizeCells(const std::vector<long>& cells,
+                               double delta_dB,
+                               int variableIndex,
+                               double dB_reference) = 0;
+
+    /** Fills the passed vector with the linear indexes (i + nI * ( j + nJ * k ) ) of the cells whose centers lie
+     * within the given area (and within the second area, if it is not empty) in ascending order.
+     * The cell centers of rotated grids are given by getCellLocation().  The areas are in the XY plane, so the
+     * z coordinate is not tested: in a 3D grid, the cells of every layer that lie within the areas are returned.
+     */
+    void getCellsWithin(const QList<QPointF>& area,
+                        const QList<QPointF>& secondArea,
+                        std::vector<long>& cells ) const;
 
     /** Save data to persistence (file, database, etc.). */
     virtual void saveData() = 0;
@@ -0,0 +1,239 @@
+#include "ijrastertilecache.h"
+#include "util.h"
+#include <qwt_scale_map.h>
+#include <qwt_color_map.h>
+#include <qwt_interval.h>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <thread>
+
+namespace {
+    /** Number of colours sampled from the colour map. */
+    const int COLOR_TABLE_SIZE = 1024;
+}
+
+IJRasterTileCache::IJRasterTileCache(int tileSize, unsigned int nThreads) :
+    m_tileSize( std::max( 16, tileSize ) ),
+    m_nThreads( nThreads ),
+    m_xWest( 0.0 ),
+    m_ySouth( 0.0 ),
+    m_dx( 1.0 ),
+    m_dy( 1.0 ),
+    m_ready( false ),
+    m_colorMin( 0.0 ),
+    m_colorMax( 0.0 )
+{
+    if( m_nThreads == 0 )
+        m_nThreads = std::max( 1u, std::thread::hardware_concurrency() );
+}
+
+void IJRasterTileCache::setRaster(int nI, int nJ,
+                                  double xWest, double ySouth,
+                                  double dx, double dy,
+                                  const ValueFunction &valueFunction)
+{
+    clear();
+    if( nI < 1 || nJ < 1 || dx <= 0.0 || dy <= 0.0 )
+        return;
+    m_xWest = xWest;
+    m_ySouth = ySouth;
+    m_dx = dx;
+    m_dy = dy;
+
+    //level 0: read the raster values, which is the costly part.
+    {
+        Level level0;
+        level0.nI = nI;
+        level0.nJ = nJ;
+        level0.values.resize( (size_t)nI * nJ );
+        runInParallel( nJ, [&]( int firstJ, int lastJ ){
+            for( int j = firstJ; j <= lastJ; ++j )
+                for( int i = 0; i < nI; ++i )
+                    level0.values[ (size_t)j * nI + i ] = valueFunction( i, j );
+        });
+        m_levels.push_back( std::move( level0 ) );
+    }
+
+    //the next levels average 2x2 cells of the previous level (ignoring NaNs) until there is a single cell.
+    while( m_levels.back().nI > 1 || m_levels.back().nJ > 1 ){
+        const Level& fine = m_levels.back();
+        Level coarse;
+        coarse.nI = ( fine.nI + 1 ) / 2;
+        coarse.nJ = ( fine.nJ + 1 ) / 2;
+        coarse.values.resize( (size_t)coarse.nI * coarse.nJ );
+        runInParallel( coarse.nJ, [&]( int firstJ, int lastJ ){
+            for( int j = firstJ; j <= lastJ; ++j )
+                for( int i = 0; i < coarse.nI; ++i ){
+                    double sum = 0.0;
+                    int count = 0;
+                    for( int fj = 2 * j; fj < std::min( 2 * j + 2, fine.nJ ); ++fj )
+                        for( int fi = 2 * i; fi < std::min( 2 * i + 2, fine.nI ); ++fi ){
+                            float value = fine.values[ (size_t)fj * fine.nI + fi ];
+                            if( ! std::isnan( value ) ){
+                                sum += value;
+                                ++count;
+                            }
+                        }
+                    coarse.values[ (size_t)j * coarse.nI + i ] =
+                            count > 0 ? sum / count : std::numeric_limits<float>::quiet_NaN();
+                }
+        });
+        m_levels.push_back( std::move( coarse ) );
+    }
+
+    m_ready = true;
+}
+
+void IJRasterTileCache::clear()
+{
+    m_ready = false;
+    m_levels.clear();
+    m_tiles.clear();
+}
+
+void IJRasterTileCache::runInParallel(int n, const std::function<void (int, int)> &task) const
+{
+    if( n < 1 )
+        return;
+    unsigned int nThreads = std::max( 1, std::min( (int)m_nThreads, n ) );
+    std::vector< std::pair< int, int > > ranges = Util::generateSubRanges( 0, n - 1, nThreads );
+    std::thread threads[nThreads];
+    for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+        threads[iThread] = std::thread( task, ranges[iThread].first, ranges[iThread].second );
+    for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+        threads[iThread].join();
+}
+
+void IJRasterTileCache::makeTile(const TileKey &key, std::vector<QRgb> &tile) const
+{
+    const Level& level = m_levels[ key.level ];
+    const double colorScale = ( m_colorMax > m_colorMin ) ?
+                                  ( COLOR_TABLE_SIZE - 1 ) / ( m_colorMax - m_colorMin ) : 0.0;
+    tile.assign( (size_t)m_tileSize * m_tileSize, 0u );
+    int i0 = key.tileI * m_tileSize;
+    int j0 = key.tileJ * m_tileSize;
+    int nTexelsI = std::min( m_tileSize, level.nI - i0 );
+    int nTexelsJ = std::min( m_tileSize, level.nJ - j0 );
+    for( int b = 0; b < nTexelsJ; ++b ){
+        const float* values = level.values.data() + (size_t)( j0 + b ) * level.nI + i0;
+        QRgb* texels = tile.data() + (size_t)b * m_tileSize;
+        for( int a = 0; a < nTexelsI; ++a ){
+            float value = values[a];
+            if( std::isnan( value ) )
+                continue; //unvalued cells are transparent
+            double position = ( value - m_colorMin ) * colorScale;
+            int iColor = (int)std::round( std::max( 0.0, std::min( (double)( COLOR_TABLE_SIZE - 1 ), position ) ) );
+            texels[a] = m_colorTable[ iColor ];
+        }
+    }
+}
+
+QImage IJRasterTileCache::render(const QwtScaleMap &xMap,
+                                 const QwtScaleMap &yMap,
+                                 const QRectF &area,
+                                 const QSize &imageSize,
+                                 const QwtColorMap &colorMap,
+                                 const QwtInterval &interval)
+{
+    if( ! m_ready || imageSize.isEmpty() )
+        return QImage();
+
+    //sample the colour map and discard the tiles if the colours changed.
+    {
+        std::vector<QRgb> colorTable( COLOR_TABLE_SIZE );
+        const double width = interval.width();
+        for( int iColor = 0; iColor < COLOR_TABLE_SIZE; ++iColor )
+            colorTable[iColor] = colorMap.rgb( interval, interval.minValue() + width * iColor / ( COLOR_TABLE_SIZE - 1 ) );
+        if( colorTable != m_colorTable || interval.minValue() != m_colorMin || interval.maxValue() != m_colorMax ){
+            m_tiles.clear();
+            m_colorTable = std::move( colorTable );
+            m_colorMin = interval.minValue();
+            m_colorMax = interval.maxValue();
+        }
+    }
+
+    //select the coarsest level whose cells are not larger than the pixels.
+    int iLevel = 0;
+    {
+        double cellsPerPixel = std::min( area.width() / imageSize.width() / m_dx,
+                                         area.height() / imageSize.height() / m_dy );
+        if( cellsPerPixel >= 2.0 )
+            iLevel = std::min( (int)std::floor( std::log2( cellsPerPixel ) ), (int)m_levels.size() - 1 );
+    }
+    const Level& level = m_levels[ iLevel ];
+    const double texelDX = m_dx * ( 1 << iLevel );
+    const double texelDY = m_dy * ( 1 << iLevel );
+
+    //the texel of each column and of each row of pixels (-1 if outside the raster).
+    std::vector<int> columnTexels( imageSize.width() );
+    std::vector<int> rowTexels( imageSize.height() );
+    int minTexelI = level.nI, maxTexelI = -1;
+    int minTexelJ = level.nJ, maxTexelJ = -1;
+    for( int x = 0; x < imageSize.width(); ++x ){
+        double t = std::floor( ( xMap.invTransform( x ) - m_xWest ) / texelDX );
+        columnTexels[x] = ( t >= 0.0 && t < level.nI ) ? (int)t : -1;
+        if( columnTexels[x] >= 0 ){
+            minTexelI = std::min( minTexelI, columnTexels[x] );
+            maxTexelI = std::max( maxTexelI, columnTexels[x] );
+        }
+    }
+    for( int y = 0; y < imageSize.height(); ++y ){
+        double t = std::floor( ( yMap.invTransform( y ) - m_ySouth ) / texelDY );
+        rowTexels[y] = ( t >= 0.0 && t < level.nJ ) ? (int)t : -1;
+        if( rowTexels[y] >= 0 ){
+            minTexelJ = std::min( minTexelJ, rowTexels[y] );
+            maxTexelJ = std::max( maxTexelJ, rowTexels[y] );
+        }
+    }
+
+    QImage image( imageSize, QImage::Format_ARGB32 );
+    image.fill( 0u );
+    if( maxTexelI < 0 || maxTexelJ < 0 ) //the area does not intersect the raster
+        return image;
+
+    //build the missing tiles of the area in parallel.
+    const int firstTileI = minTexelI / m_tileSize, lastTileI = maxTexelI / m_tileSize;
+    const int firstTileJ = minTexelJ / m_tileSize, lastTileJ = maxTexelJ / m_tileSize;
+    const int nTilesI = lastTileI - firstTileI + 1;
+    std::vector<TileKey> missingTiles;
+    for( int tileJ = firstTileJ; tileJ <= lastTileJ; ++tileJ )
+        for( int tileI = firstTileI; tileI <= lastTileI; ++tileI ){
+            TileKey key = { iLevel, tileI, tileJ };
+            if( m_tiles.find( key ) == m_tiles.end() )
+                missingTiles.push_back( key );
+        }
+    if( ! missingTiles.empty() ){
+        std::vector< std::vector<QRgb> > newTiles( missingTiles.size() );
+        runInParallel( (int)missingTiles.size(), [&]( int first, int last ){
+            for( int iTile = first; iTile <= last; ++iTile )
+                makeTile( missingTiles[iTile], newTiles[iTile] );
+        });
+        for( size_t iTile = 0; iTile < missingTiles.size(); ++iTile )
+            m_tiles[ missingTiles[iTile] ] = std::move( newTiles[iTile] );
+    }
+    std::vector<const QRgb*> tiles( (size_t)nTilesI * ( lastTileJ - firstTileJ + 1 ) );
+    for( int tileJ = firstTileJ; tileJ <= lastTileJ; ++tileJ )
+        for( int tileI = firstTileI; tileI <= lastTileI; ++tileI ){
+            TileKey key = { iLevel, tileI, tileJ };
+            tiles[ ( tileJ - firstTileJ ) * nTilesI + ( tileI - firstTileI ) ] = m_tiles[ key ].data();
+        }
+
+    //composite the tiles.
+    for( int y = 0; y < imageSize.height(); ++y ){
+        int texelJ = rowTexels[y];
+        if( texelJ < 0 )
+            continue;
+        QRgb* line = reinterpret_cast<QRgb*>( image.scanLine( y ) );
+        const QRgb* const * tilesRow = tiles.data() + ( texelJ / m_tileSize - firstTileJ ) * nTilesI;
+        const size_t rowOffset = (size_t)( texelJ % m_tileSize ) * m_tileSize;
+        for( int x = 0; x < imageSize.width(); ++x ){
+            int texelI = columnTexels[x];
+            if( texelI < 0 )
+                continue;
+            line[x] = tilesRow[ texelI / m_tileSize - firstTileI ][ rowOffset + texelI % m_tileSize ];
+        }
+    }
+
+    return image;
+}
@@ -0,0 +1,109 @@
+#ifndef IJRASTERTILECACHE_H
+#define IJRASTERTILECACHE_H
+
+#include <QImage>
+#include <QRectF>
+#include <QSize>
+#include <vector>
+#include <map>
+#include <functional>
+
+class QwtScaleMap;
+class QwtColorMap;
+class QwtInterval;
+
+/**
+ * The IJRasterTileCache class speeds up the rendering of large 2D grids (e.g. 4000x4000 Fourier images) in Qwt plots.
+ * Instead of querying the grid for the value under each pixel at every repaint, the grid values are read once by
+ * worker threads into a pyramid of levels: level 0 has the grid's resolution and each next level has half the
+ * resolution of the previous one (its cells are the averages of 2x2 cells).  The levels are colour-mapped into
+ * square tiles by worker threads on demand and the tiles are cached, so repaints after pans and zooms only composite
+ * cached tiles from the level closest to the screen resolution.
+ *
+ * The tiles are keyed by level and position.  They are discarded when the raster is replaced (setRaster(), which must
+ * be called whenever the grid, the variable, the slice or the values change, e.g. after equalizer edits) and when the
+ * colour table or its interval change (detected in render()).
+ *
+ * The worker threads are joined before setRaster() and render() return, so the grid is never read while client code
+ * changes it.
+ */
+class IJRasterTileCache
+{
+public:
+    /** Returns the value of cell (i,j) as it is to be colour-mapped (NaN means no value).  It is called from
+     *  several threads, so it must only read data. */
+    typedef std::function<double( int i, int j )> ValueFunction;
+
+    /**
+     * @param tileSize Width and height of the tiles in cells.
+     * @param nThreads Number of threads used to read the raster and to build tiles.  Zero means the number of logical processors.
+     */
+    IJRasterTileCache( int tileSize = 256, unsigned int nThreads = 0 );
+
+    IJRasterTileCache( const IJRasterTileCache& ) = delete;
+    IJRasterTileCache& operator=( const IJRasterTileCache& ) = delete;
+
+    /**
+     * Discards the cached data and reads a new raster.
+     * @param xWest Coordinate of the west edge of the first column of cells.
+     * @param ySouth Coordinate of the south edge of the first row of cells.
+     */
+    void setRaster( int nI, int nJ,
+                    double xWest, double ySouth,
+                    double dx, double dy,
+                    const ValueFunction& valueFunction );
+
+    /** Discards the raster.  isReady() returns false until the next setRaster(). */
+    void clear();
+
+    /** Returns whether there is a raster to render. */
+    bool isReady() const { return m_ready; }
+
+    /**
+     * Renders an area of the raster following the conventions of QwtPlotRasterItem::renderImage(): the pixel (x,y)
+     * of the returned image shows the value at (xMap.invTransform(x), yMap.invTransform(y)).  The cells outside the
+     * raster are transparent.  Returns a null image if there is no raster.
+     */
+    QImage render( const QwtScaleMap& xMap,
+                   const QwtScaleMap& yMap,
+                   const QRectF& area,
+                   const QSize& imageSize,
+                   const QwtColorMap& colorMap,
+                   const QwtInterval& interval );
+
+private:
+    /** A level of the pyramid: nI x nJ values with i varying faster. */
+    struct Level {
+        int nI, nJ;
+        std::vector<float> values;
+    };
+
+    struct TileKey {
+        int level, tileI, tileJ;
+        bool operator<( const TileKey& other ) const {
+            if( level != other.level ) return level < other.level;
+            if( tileJ != other.tileJ ) return tileJ < other.tileJ;
+            return tileI < other.tileI;
+        }
+    };
+
+    int m_tileSize;
+    unsigned int m_nThreads;
+
+    double m_xWest, m_ySouth, m_dx, m_dy;
+    std::vector<Level> m_levels;
+    bool m_ready;
+
+    /** Colours sampled from the colour map in the interval [m_colorMin, m_colorMax] of the cached tiles. */
+    std::vector<QRgb> m_colorTable;
+    double m_colorMin, m_colorMax;
+    std::map<TileKey, std::vector<QRgb>> m_tiles;
+
+    /** Colour-maps a tile of a level into a tileSize x tileSize buffer (the cells outside the level are transparent). */
+    void makeTile( const TileKey& key, std::vector<QRgb>& tile ) const;
+
+    /** Runs task(first, last) for sub-ranges of [0, n-1] (inclusive) with up to m_nThreads threads. */
+    void runInParallel( int n, const std::function<void( int, int )>& task ) const;
+};
+
+#endif // IJRASTERTILECACHE_H
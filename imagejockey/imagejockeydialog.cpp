@@ -9,6 +9,7 @@
 #include "spectrogram1dparameters.h"
 #include "spectrogram1dplot.h"
 #include "equalizer/equalizerwidget.h"
+#include "equalizer/spectralequalizer.h"
 #include "imagejockeyutils.h"
 #include "svd/svdparametersdialog.h"
 #include "svd/svdfactor.h"
@@ -29,6 +30,7 @@ ImageJockeyDialog::ImageJockeyDialog(const std::vector<IJAbstractCartesianGrid *
     QDialog(parent),
     ui(new Ui::ImageJockeyDialog),
     m_spectrogram1Dparams( new Spectrogram1DParameters() ),
+    m_spectralEqualizer( new SpectralEqualizer() ),
     m_numberOfSVDFactorsSetInTheDialog( 0 ),
     m_grids( grids )
 {
@@ -153,6 +155,7 @@ ImageJockeyDialog::~ImageJockeyDialog()
 {
     delete ui;
     delete m_spectrogram1Dparams;
+    delete m_spectralEqualizer;
     emit infoOccurred("ImageJockeyDialog destroyed.");
 }
 
@@ -174,6 +177,9 @@ void ImageJockeyDialog::onUpdateGridPlot(IJAbstractVariable *var)
     //set the attribute
     m_gridPlot->setVariable( var );
 
+    //the equalizer edits this variable from now on
+    m_spectralEqualizer->setGrid( var->getParentGrid(), var->getIndexInParentGrid() );
+
     //read decibel extrema before assigning them to the widgets to prevent
     //that some unpredicted signal/slot chaining causes unpredicted behavior
     double dBmin = m_gridPlot->getScaleMinValue();
@@ -267,17 +273,13 @@ void ImageJockeyDialog::equalizerAdjusted(double centralFrequency, double delta_
     //to clip the area-of-influence
     QList<QPointF> halfBand = m_spectrogram1Dparams->getHalfBandGeometry();
 
-    //perform the equalization of values
-    cg->equalizeValues( aoi, delta_dB, var->getIndexInParentGrid(), m_wheelColorDecibelReference->value(), halfBand );
-
-    //mirror the area of influence about the center of the 2D spectrogram
-    ImageJockeyUtils::mirror2D( aoi, cg->getCenterLocation() );
-
-    //mirror the half-band geometry about the center of the 2D spectrogram
-    ImageJockeyUtils::mirror2D( halfBand, cg->getCenterLocation() );
+    //perform the equalization of values in the area and in the opposite area to preserve the
+    //2D spectrogram's symmetry (the cells of each band are found only once).
+    m_spectralEqualizer->setGrid( cg, var->getIndexInParentGrid() );
+    m_spectralEqualizer->equalize( centralFrequency, aoi, halfBand, delta_dB, m_wheelColorDecibelReference->value() );
 
-    //perform the equalization in the opposite area to preserve the 2D spectrogram's symmetry
-    cg->equalizeValues( aoi, delta_dB, var->getIndexInParentGrid(), m_wheelColorDecibelReference->value(), halfBand );
+    //the cached image of the 2D spectrogram is no longer valid
+    m_gridPlot->invalidateRasterCache();
 
     //update the 2D spectrogram plot
     spectrogramGridReplot();
@@ -310,34 +312,18 @@ void ImageJockeyDialog::preview()
     if( ! cg )
         return;
 
-    //create the array with the input de-shifted and in rectangular form.
-    spectral::complex_array dataReady( (spectral::index)cg->getNI(),
-                                       (spectral::index)cg->getNJ(),
-                                       (spectral::index)cg->getNK() );
-
-    //De-shift frequencies, convert the complex numbers to rectangular form ( a + bi ) and
-    //change the scan order from GSLib convention to FFTW3 convention.
-    if( ! ImageJockeyUtils::prepareToFFTW3reverseFFT( cg,
-                                                m_varAmplitudeSelector->getSelectedVariableIndex(),
-                                                cg,
-                                                m_varPhaseSelector->getSelectedVariableIndex(),
-                                                dataReady ) ){
-        return;
-    }
-
-    //Create the output array.
-    spectral::array outputData( (spectral::index)cg->getNI(),
-                                (spectral::index)cg->getNJ(),
-                                (spectral::index)cg->getNK() );
-
-    //Apply reverse FFT.
+    //Apply reverse FFT.  The de-shifted spectrum in rectangular form (FFTW3 convention) is built in the first
+    //preview and then only the cells changed by the equalizer are updated.
+    spectral::array outputData;
     {
         QProgressDialog progressDialog;
         progressDialog.setRange(0,0);
         progressDialog.show();
         progressDialog.setLabelText("Computing RFFT...");
         QCoreApplication::processEvents(); //let Qt repaint widgets
-        spectral::backward( outputData, dataReady );
+        m_spectralEqualizer->setGrid( cg, m_varAmplitudeSelector->getSelectedVariableIndex() );
+        if( ! m_spectralEqualizer->reverseFFT( m_varPhaseSelector->getSelectedVariableIndex(), outputData ) )
+            return;
     }
 
 	//fftw's RFFT requires that the result be divided by the number of cells.
@@ -368,6 +354,12 @@ void ImageJockeyDialog::restore()
     //reread data from filesystem.
     cg->dataWillBeRequested();
 
+    //the spectrum cached for the preview is no longer valid
+    m_spectralEqualizer->invalidateSpectrum();
+
+    //the cached image of the 2D spectrogram is no longer valid
+    m_gridPlot->invalidateRasterCache();
+
     //update the 2D spectrogram plot
     spectrogramGridReplot();
 
@@ -406,8 +398,9 @@ void ImageJockeyDialog::onSVD()
 	spectral::SVD svd = spectral::svd( *a );
 	progressDialog.hide();
 
-    //get the list with the factor weights (information quantity)
-    spectral::array weights = svd.factor_weights();
+    //get the list with the factor weights (fraction of the data's energy), the same measure used
+    //when the factors are split further in the SVD analysis dialog
+    spectral::array weights = svd.energy_weights();
     emit infoOccurred("ImageJockeyDialog::onSVD(): " + QString::number( weights.data().size() ) + " factor(s) were found.");
 
     //User enters number of SVD factors
@@ -444,6 +437,7 @@ void ImageJockeyDialog::onSVD()
         SVDAnalysisDialog* svdad = new SVDAnalysisDialog( this );
         connect( svdad, SIGNAL(sumOfFactorsComputed(spectral::array*)),
                  this, SLOT(onSumOfFactorsWasComputed(spectral::array*)) );
+        connect( svdad, SIGNAL(info(QString)), this, SIGNAL(infoOccurred(QString)) );
         svdad->setTree( factorTree );
         //setting these enables RFFT preview in the SVD Analysis dialog
         svdad->setGridWithPhaseForPossibleRFFT( cg, m_varPhaseSelector->getSelectedVariableIndex() );
@@ -480,6 +474,9 @@ void ImageJockeyDialog::onSumOfFactorsWasComputed(spectral::array *sumOfFactors)
     IJAbstractCartesianGrid* cg = m_cgSelector->getSelectedGrid();
     cg->appendAsNewVariable(new_variable_name, *sumOfFactors );
 
+    //the grid may have been reloaded
+    m_spectralEqualizer->invalidateSpectrum();
+
     //discard the computed sum
 	delete sumOfFactors;
 }
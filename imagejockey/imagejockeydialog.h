@@ -13,6 +13,7 @@ class GRCompass;
 class Spectrogram1DParameters;
 class Spectrogram1DPlot;
 class EqualizerWidget;
+class SpectralEqualizer;
 class SVDFactor;
 
 namespace spectral {
@@ -86,6 +87,9 @@ private:
     /** The set of sliders to attenuate or amplify frequency components. */
     EqualizerWidget* m_equalizerWidget;
 
+    /** Applies the equalizer edits to the Fourier image and computes the preview incrementally. */
+    SpectralEqualizer* m_spectralEqualizer;
+
     /** The number of SVD factors set by the user in the SVD curve dialog. */
     int m_numberOfSVDFactorsSetInTheDialog;
 
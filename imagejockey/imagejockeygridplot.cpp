@@ -14,6 +14,7 @@
 #include <qwt_matrix_raster_data.h>
 #include <QPen>
 #include <cmath>
+#include <memory>
 
 #include <qapplication.h>
 
@@ -22,6 +23,7 @@
 #include "spectrogram1dparameters.h"
 #include "ijmatrix3x3.h"
 #include "imagejockeyutils.h"
+#include "ijrastertilecache.h"
 #include "svd/svdfactor.h"
 
 //////////////////////////////////////////////ZOOMER CLASS////////////////////////////
@@ -98,6 +100,39 @@ public:
     void setDecibelRefValue( double value ){
         m_decibelRefValue = value;
     }
+    /** Makes the tile cache read the values of the variable as they are returned by value(). */
+    void setUpTileCache( IJRasterTileCache& cache ) const {
+        //rotated grids are left to value()
+        if( ! m_var || m_cg->getRotation() != 0.0 ){
+            cache.clear();
+            return;
+        }
+        IJAbstractCartesianGrid* cg = m_cg;
+        int columnIndex = m_var->getIndexInParentGrid();
+        double decibelRefValue = m_decibelRefValue;
+        int nI = cg->getNI();
+        int nJ = cg->getNJ();
+        //getData() may load data and is not thread-safe, so the values are copied here, in the
+        //GUI thread, and the worker threads of the cache only read the copy.
+        cg->dataWillBeRequested();
+        std::shared_ptr< std::vector<double> > values( new std::vector<double>( (size_t)nI * nJ ) );
+        for( int j = 0; j < nJ; ++j )
+            for( int i = 0; i < nI; ++i ){
+                double value = cg->getData( columnIndex, i, j, 0 );
+                (*values)[ (size_t)j * nI + i ] = cg->isNoDataValue( value ) ?
+                                                   std::numeric_limits<double>::quiet_NaN() : value;
+            }
+        cache.setRaster( nI, nJ,
+                         cg->getOriginX() - cg->getCellSizeI() / 2.0,
+                         cg->getOriginY() - cg->getCellSizeJ() / 2.0,
+                         cg->getCellSizeI(), cg->getCellSizeJ(),
+                         [values, nI, decibelRefValue]( int i, int j ){
+                             double value = (*values)[ (size_t)j * nI + i ];
+                             if( std::isnan( value ) )
+                                 return value;
+                             return ImageJockeyUtils::dB( std::abs(value), decibelRefValue, 0.0000001 );
+                         } );
+    }
 private:
     /** The variable being displayed. */
     IJAbstractVariable* m_var;
@@ -153,6 +188,36 @@ public:
     void setColorScale( ColorScaleForSVDFactor setting ){
         m_colorScaleForSVDFactor = setting;
     }
+    /** Makes the tile cache read the values of the current plane of the factor as they are returned by value(). */
+    void setUpTileCache( IJRasterTileCache& cache ) const {
+        if( ! m_factor ){
+            cache.clear();
+            return;
+        }
+        SVDFactor* factor = m_factor;
+        SVDFactorPlaneOrientation orientation = factor->getPlaneOrientation();
+        uint slice = factor->getCurrentSlice();
+        bool isLog = ( m_colorScaleForSVDFactor == ColorScaleForSVDFactor::LOG );
+        double dx = factor->getCurrentPlaneDX();
+        double dy = factor->getCurrentPlaneDY();
+        cache.setRaster( factor->getCurrentPlaneNX(), factor->getCurrentPlaneNY(),
+                         factor->getCurrentPlaneX0() - dx / 2.0,
+                         factor->getCurrentPlaneY0() - dy / 2.0,
+                         dx, dy,
+                         [factor, orientation, slice, isLog]( int i, int j ){
+                             double value;
+                             switch( orientation ){
+                                 case SVDFactorPlaneOrientation::XZ: value = factor->dataIJK( i, slice, j ); break;
+                                 case SVDFactorPlaneOrientation::YZ: value = factor->dataIJK( slice, i, j ); break;
+                                 default: value = factor->dataIJK( i, j, slice );
+                             }
+                             if( factor->isNDV( value ) )
+                                 value = std::numeric_limits<double>::quiet_NaN();
+                             if( isLog )
+                                 value = std::log10( std::abs( value ) );
+                             return value;
+                         } );
+    }
 
 private:
 	/** The SVD Factor being displayed. */
@@ -263,6 +328,27 @@ public:
     }
 };
 
+/////////////////////////////////////////////A SPECTROGRAM RENDERED FROM CACHED TILES/////////////////////////////
+class TiledSpectrogram: public QwtPlotSpectrogram
+{
+public:
+    /** The tiles of the raster being displayed.  The raster must be set by client code. */
+    IJRasterTileCache& tileCache() { return m_tileCache; }
+
+    /** Composites cached tiles if there is a raster in the cache, otherwise the image is rendered pixel by pixel
+     * from the raster data as usual. */
+    virtual QImage renderImage( const QwtScaleMap &xMap, const QwtScaleMap &yMap,
+                                const QRectF &area, const QSize &imageSize ) const {
+        if( m_tileCache.isReady() && colorMap() )
+            return m_tileCache.render( xMap, yMap, area, imageSize, *colorMap(), data()->interval( Qt::ZAxis ) );
+        return QwtPlotSpectrogram::renderImage( xMap, yMap, area, imageSize );
+    }
+
+private:
+    //renderImage() is const in Qwt, but it fills the cache.
+    mutable IJRasterTileCache m_tileCache;
+};
+
 /////////////////////////////////////////////THE IMAGE JOCKEY PLOT CLASS ITSELF/////////////////////////////
 ImageJockeyGridPlot::ImageJockeyGridPlot( QWidget *parent ):
     QwtPlot( parent ),
@@ -275,7 +361,7 @@ ImageJockeyGridPlot::ImageJockeyGridPlot( QWidget *parent ):
     m_curve1DSpectrogramHalfBand1( nullptr ),
     m_curve1DSpectrogramHalfBand2( nullptr )
 {
-    m_spectrogram = new QwtPlotSpectrogram();
+    m_spectrogram = new TiledSpectrogram();
     m_spectrogram->setRenderThreadCount( 0 ); // use system specific thread count
     m_spectrogram->setCachePolicy( QwtPlotRasterItem::PaintCache );
 
@@ -352,6 +438,7 @@ void ImageJockeyGridPlot::setVariable(IJAbstractVariable *var)
     }
 
 	m_spectrogram->setData( m_spectrumData );
+    updateTileCache();
 
     //redefine color scale/legend
     const QwtInterval zInterval = m_spectrogram->data()->interval( Qt::ZAxis );
@@ -376,6 +463,7 @@ void ImageJockeyGridPlot::setSVDFactor(SVDFactor * svdFactor)
 	m_factorData->setFactor( svdFactor );
 
 	m_spectrogram->setData( m_factorData );
+    updateTileCache();
 
 	//redefine color scale/legend
 	const QwtInterval zInterval = m_spectrogram->data()->interval( Qt::ZAxis );
@@ -397,6 +485,7 @@ void ImageJockeyGridPlot::setSVDFactor(SVDFactor * svdFactor)
 void ImageJockeyGridPlot::setColorScaleForSVDFactor(ColorScaleForSVDFactor setting)
 {
     m_factorData->setColorScale( setting );
+    updateTileCache();
     replot();
     repaint();
 }
@@ -421,10 +510,27 @@ void ImageJockeyGridPlot::pan()
 
 void ImageJockeyGridPlot::forceUpdate()
 {
+    //the slice or the values may have changed
+    updateTileCache();
     //this causes a redraw
     setColorScaleMax( getScaleMaxValue() );
 }
 
+void ImageJockeyGridPlot::invalidateRasterCache()
+{
+    updateTileCache();
+    m_spectrogram->invalidateCache();
+    replot();
+}
+
+void ImageJockeyGridPlot::updateTileCache()
+{
+    if( m_spectrogram->data() == m_factorData )
+        m_factorData->setUpTileCache( m_spectrogram->tileCache() );
+    else
+        m_spectrumData->setUpTileCache( m_spectrogram->tileCache() );
+}
+
 void ImageJockeyGridPlot::showContour( bool on )
 {
     m_spectrogram->setDisplayMode( QwtPlotSpectrogram::ContourMode, on );
@@ -526,6 +632,7 @@ void ImageJockeyGridPlot::setColorScaleMin(double value)
 void ImageJockeyGridPlot::setDecibelRefValue(double value)
 {
     m_spectrumData->setDecibelRefValue( value );
+    updateTileCache();
     setColorMap( ImageJockeyGridPlot::RGBMap );
     m_spectrumData->setInterval( Qt::ZAxis, QwtInterval( m_colorScaleMin, m_colorScaleMax ) );
 
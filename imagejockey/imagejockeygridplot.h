@@ -3,7 +3,7 @@
 
 #include <qwt_plot.h>
 
-class QwtPlotSpectrogram;
+class TiledSpectrogram;
 class IJAbstractVariable;
 class SpectrogramData;
 class QwtPlotZoomer;
@@ -58,6 +58,10 @@ public:
     /** Sometimes calling replot() is not enough. */
     void forceUpdate();
 
+    /** Makes the plot re-read the values of the variable or SVD factor being displayed.
+     * Client code must call this after changing the values (e.g. with the equalizer). */
+    void invalidateRasterCache();
+
 signals:
 	/** This signal is triggered when an error occurs. */
 	void errorOccurred( QString message );
@@ -76,7 +80,8 @@ public Q_SLOTS:
     void draw1DSpectrogramBand();
 
 private:
-    QwtPlotSpectrogram *m_spectrogram;
+    /** The spectrogram renders large grids from a cache of colour-mapped tiles. */
+    TiledSpectrogram *m_spectrogram;
 
     int m_mapType;
     int m_alpha;
@@ -104,6 +109,9 @@ private:
 
     QwtPlotCurve *m_curve1DSpectrogramHalfBand1;
     QwtPlotCurve *m_curve1DSpectrogramHalfBand2;
+
+    /** Reads the values of the variable or SVD factor being displayed into the tile cache. */
+    void updateTileCache();
 };
 
 #endif // IMAGEJOCKEYGRIDPLOT_H
@@ -373,17 +373,20 @@ public:
     /** Skeletonizes gridded data so only values along thin lines remain. */
     static spectral::array skeletonize( const spectral::array& inputData );
 
-    /** Performs the mean filter on the passed gridded data.
+    /** Performs the mean filter on the passed gridded data with a summed-area table (see spectral/filters.h).
+     * Uninformed cells are ignored in the windows and remain uninformed.
      * @param windowSize The size of the convolution kernel in cells.  Zero results in a simply copy of values.
      */
     static spectral::array meanFilter(const spectral::array& inputData, int windowSize);
 
-    /** Performs the median filter on the passed gridded data.
+    /** Performs the median filter on the passed gridded data with a sliding histogram (see spectral/filters.h).
+     * Uninformed cells are ignored in the windows and remain uninformed.
      * @param windowSize The size of the convolution kernel in cells.  Zero results in a simply copy of values.
      */
     static spectral::array medianFilter(const spectral::array& inputData, int windowSize);
 
-    /** Performs the Gaussian filter on the passed gridded data.
+    /** Performs the Gaussian filter on the passed gridded data with a separable recursive filter
+     * (see spectral/filters.h).  Uninformed cells are ignored and remain uninformed.
      * @param sigma The standard deviation (in cell count units) parameter of the Gaussian-bell-shaped
      *              kernel of the filter.
      */
@@ -0,0 +1,543 @@
+#include "scattereddatainterpolator.h"
+#include "ijabstractcartesiangrid.h"
+#include "util.h"
+#include <cmath>
+#include <thread>
+#include <algorithm>
+#include <numeric>
+#include <boost/geometry.hpp>
+#include <boost/geometry/index/rtree.hpp>
+
+namespace bg = boost::geometry;
+namespace bgi = boost::geometry::index;
+
+namespace {
+
+typedef bg::model::point<double, 3, bg::cs::cartesian> SamplePoint;
+typedef std::pair<SamplePoint, size_t> SamplePointAndIndex;
+typedef bgi::rtree< SamplePointAndIndex, bgi::rstar<16,5,5,32> > SampleRtree;
+
+typedef bg::model::point<double, 2, bg::cs::cartesian> PlanePoint;
+typedef bg::model::box<PlanePoint> PlaneBox;
+typedef std::pair<PlanePoint, size_t> PlanePointAndIndex;
+typedef std::pair<PlaneBox, size_t> PlaneBoxAndIndex;
+typedef bgi::rtree< PlanePointAndIndex, bgi::rstar<16,5,5,32> > PlanePointRtree;
+typedef bgi::rtree< PlaneBoxAndIndex, bgi::rstar<16,5,5,32> > PlaneBoxRtree;
+
+/** The Thin Plate Spline basis function.  It takes the squared distance, since
+ * r^2*log(r) = 0.5 * r^2 * log(r^2), which spares a square root. */
+inline double tpsBasis( double r2 ){
+    if( r2 <= 0.0 )
+        return 0.0;
+    return 0.5 * r2 * std::log( r2 );
+}
+
+/** The compactly supported weight of a partition of unity patch.
+ * u and v are the coordinates normalized to [-1, 1] in the patch support. */
+inline double puWeight( double u, double v ){
+    if( u <= -1.0 || u >= 1.0 || v <= -1.0 || v >= 1.0 )
+        return 0.0;
+    double wu = 1.0 - u * u;
+    double wv = 1.0 - v * v;
+    return wu * wu * wv * wv;
+}
+
+/** A rectangle in the quadtree used to define the partition of unity patches. */
+struct QuadtreeNode {
+    double xmin, xmax, ymin, ymax;
+    std::vector<size_t> sampleIndexes;
+};
+
+/** Splits the domain recursively until each leaf has at most maxSamples samples.  Empty leaves are kept,
+ * since the patches must cover the whole domain. */
+template< typename SampleType >
+void buildQuadtreeLeaves( QuadtreeNode& node,
+                          const std::vector<SampleType>& samples,
+                          size_t maxSamples,
+                          int depth,
+                          std::vector<QuadtreeNode>& leaves ){
+    //a maximum depth prevents endless recursion with many coincident samples
+    if( node.sampleIndexes.size() <= maxSamples || depth >= 24 ){
+        leaves.push_back( std::move( node ) );
+        return;
+    }
+    double xmid = ( node.xmin + node.xmax ) / 2.0;
+    double ymid = ( node.ymin + node.ymax ) / 2.0;
+    QuadtreeNode children[4] = { { node.xmin, xmid,      node.ymin, ymid,      {} },
+                                 { xmid,      node.xmax, node.ymin, ymid,      {} },
+                                 { node.xmin, xmid,      ymid,      node.ymax, {} },
+                                 { xmid,      node.xmax, ymid,      node.ymax, {} } };
+    for( size_t iSample : node.sampleIndexes ){
+        const SampleType& s = samples[iSample];
+        int iChild = ( s.x < xmid ? 0 : 1 ) + ( s.y < ymid ? 0 : 2 );
+        children[iChild].sampleIndexes.push_back( iSample );
+    }
+    node.sampleIndexes.clear();
+    for( QuadtreeNode& child : children )
+        buildQuadtreeLeaves( child, samples, maxSamples, depth + 1, leaves );
+}
+
+} //namespace
+
+ScatteredDataInterpolator::ScatteredDataInterpolator(IJAbstractCartesianGrid &gridMesh, unsigned int nThreads) :
+    m_gridMesh( gridMesh ),
+    m_nThreads( nThreads ),
+    m_tpsFactorizationsLambda( std::numeric_limits<double>::quiet_NaN() )
+{
+    if( m_nThreads == 0 )
+        m_nThreads = std::max( 1u, std::thread::hardware_concurrency() );
+
+    m_nI = m_gridMesh.getNI();
+    m_nJ = m_gridMesh.getNJ();
+    m_nK = m_gridMesh.getNK();
+
+    //the cell locations are computed once, since getCellLocation() is virtual and
+    //may involve rotations.
+    size_t nCells = (size_t)m_nI * m_nJ * m_nK;
+    m_cellXs.resize( nCells );
+    m_cellYs.resize( nCells );
+    m_cellZs.resize( nCells );
+    for( int i = 0; i < m_nI; ++i )
+        for( int j = 0; j < m_nJ; ++j )
+            for( int k = 0; k < m_nK; ++k ){
+                size_t index = getCellIndex( i, j, k );
+                m_gridMesh.getCellLocation( i, j, k, m_cellXs[index], m_cellYs[index], m_cellZs[index] );
+            }
+}
+
+std::vector<ScatteredDataInterpolator::Sample> ScatteredDataInterpolator::collectSamples(
+                                                  const spectral::array &inputData, int kSlice) const
+{
+    std::vector<Sample> samples;
+    int kFirst = 0;
+    int kLast = std::min<int>( m_nK, inputData.K() ) - 1;
+    if( kSlice >= 0 )
+        kFirst = kLast = kSlice;
+    int nI = std::min<int>( m_nI, inputData.M() );
+    int nJ = std::min<int>( m_nJ, inputData.N() );
+    //traversed in the order of the cell indexes
+    for( int i = 0; i < nI; ++i )
+        for( int j = 0; j < nJ; ++j )
+            for( int k = kFirst; k <= kLast; ++k ){
+                double value = inputData( i, j, k );
+                if( std::isfinite( value ) ){
+                    size_t index = getCellIndex( i, j, k );
+                    samples.push_back( { m_cellXs[index], m_cellYs[index], m_cellZs[index], value, index } );
+                }
+            }
+    return samples;
+}
+
+/////////////////////////////////////////////////////// Shepard ///////////////////////////////////////////////
+
+namespace {
+
+/** Interpolates the cells with linear indexes in [iFirst, iLast]. */
+void taskShepardRangeOfCells( const std::vector<double>& cellXs,
+                              const std::vector<double>& cellYs,
+                              const std::vector<double>& cellZs,
+                              const std::vector<double>& sampleValues,
+                              const SampleRtree& rtree,
+                              const std::vector<double>& inputValues,
+                              double powerParameter,
+                              unsigned int nNeighbors,
+                              double maxDistance,
+                              double nullValue,
+                              int iFirst, int iLast,
+                              std::vector<double>& outputValues ){
+    const bool isPower2 = ( powerParameter == 2.0 );
+    const double maxDistance2 = maxDistance * maxDistance;
+    std::vector< SamplePointAndIndex > neighbors;
+    neighbors.reserve( nNeighbors );
+    for( int iCell = iFirst; iCell <= iLast; ++iCell ){
+        //cells with samples keep their values
+        double inputValue = inputValues[iCell];
+        if( std::isfinite( inputValue ) ){
+            outputValues[iCell] = inputValue;
+            continue;
+        }
+        double x = cellXs[iCell];
+        double y = cellYs[iCell];
+        double z = cellZs[iCell];
+        neighbors.clear();
+        rtree.query( bgi::nearest( SamplePoint( x, y, z ), nNeighbors ), std::back_inserter( neighbors ) );
+        double sumWeights = 0.0;
+        double sumWeightedValues = 0.0;
+        for( const SamplePointAndIndex& neighbor : neighbors ){
+            double dx = neighbor.first.get<0>() - x;
+            double dy = neighbor.first.get<1>() - y;
+            double dz = neighbor.first.get<2>() - z;
+            double d2 = dx * dx + dy * dy + dz * dz;
+            if( d2 > maxDistance2 )
+                continue;
+            double weight = isPower2 ? 1.0 / d2 : 1.0 / std::pow( d2, powerParameter / 2.0 );
+            sumWeights += weight;
+            sumWeightedValues += weight * sampleValues[ neighbor.second ];
+        }
+        if( sumWeights > 0.0 )
+            outputValues[iCell] = sumWeightedValues / sumWeights;
+        else
+            outputValues[iCell] = nullValue;
+    }
+}
+
+} //namespace
+
+spectral::array ScatteredDataInterpolator::interpolateShepard(const spectral::array &inputData,
+                                                              double powerParameter,
+                                                              int nNeighbors,
+                                                              double maxDistanceFactor,
+                                                              double nullValue)
+{
+    spectral::array result( static_cast<spectral::index>(m_nI),
+                            static_cast<spectral::index>(m_nJ),
+                            static_cast<spectral::index>(m_nK), nullValue );
+
+    //index the samples
+    std::vector<Sample> samples = collectSamples( inputData, -1 );
+    if( samples.empty() )
+        return result;
+    std::vector<SamplePointAndIndex> indexEntries;
+    std::vector<double> sampleValues;
+    indexEntries.reserve( samples.size() );
+    sampleValues.reserve( samples.size() );
+    for( size_t iSample = 0; iSample < samples.size(); ++iSample ){
+        const Sample& s = samples[iSample];
+        indexEntries.push_back( { SamplePoint( s.x, s.y, s.z ), iSample } );
+        sampleValues.push_back( s.value );
+    }
+    SampleRtree rtree( indexEntries.begin(), indexEntries.end() ); //bulk load (packing algorithm)
+
+    //the input values in the same cell order of the output
+    size_t nCells = m_cellXs.size();
+    std::vector<double> inputValues( nCells, std::numeric_limits<double>::quiet_NaN() );
+    for( const Sample& s : samples )
+        inputValues[s.cellIndex] = s.value;
+
+    //the maximum distance is a fraction of the grid's diagonal, as in vtkShepardMethod
+    double maxDistance = std::numeric_limits<double>::infinity();
+    if( maxDistanceFactor < 1.0 ){
+        double dx = m_gridMesh.getCellSizeI() * m_nI;
+        double dy = m_gridMesh.getCellSizeJ() * m_nJ;
+        double dz = m_gridMesh.getCellSizeK() * m_nK;
+        maxDistance = maxDistanceFactor * std::sqrt( dx * dx + dy * dy + dz * dz );
+    }
+
+    //interpolate the cells in parallel
+    unsigned int nNeighborsToUse = std::max( 1, std::min<int>( nNeighbors, samples.size() ) );
+    unsigned int nThreads = std::max( 1u, std::min<unsigned int>( m_nThreads, nCells ) );
+    std::vector< std::pair< int, int > > cellRanges = Util::generateSubRanges( 0, nCells-1, nThreads );
+    std::thread threads[nThreads];
+    for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+        threads[iThread] = std::thread( taskShepardRangeOfCells,
+                                        std::cref( m_cellXs ), std::cref( m_cellYs ), std::cref( m_cellZs ),
+                                        std::cref( sampleValues ),
+                                        std::cref( rtree ),
+                                        std::cref( inputValues ),
+                                        powerParameter,
+                                        nNeighborsToUse,
+                                        maxDistance,
+                                        nullValue,
+                                        cellRanges[iThread].first,
+                                        cellRanges[iThread].second,
+                                        std::ref( result.data() ) );
+    for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+        threads[iThread].join();
+
+    return result;
+}
+
+/////////////////////////////////////////////////// Thin Plate Spline ///////////////////////////////////////////
+
+namespace {
+
+/** Solves the Thin Plate Spline systems of the patches with indexes in [iFirst, iLast].
+ * The patches whose factorization is in the cache only need the back substitution.
+ * The new factorizations are stored in newFactorizations.
+ * Sets the flag in failed if any solution is innacurate. */
+template< typename SampleType, typename PatchType, typename FactorizationType >
+void taskSolveRangeOfPatches( const std::vector<SampleType>& samples,
+                              double lambda,
+                              const std::vector< const FactorizationType* >& cachedFactorizations,
+                              int iFirst, int iLast,
+                              std::vector<PatchType>& patches,
+                              std::vector<FactorizationType>& newFactorizations,
+                              std::vector<char>& failed ){
+    for( int iPatch = iFirst; iPatch <= iLast; ++iPatch ){
+        PatchType& patch = patches[iPatch];
+        size_t p = patch.sampleIndexes.size();
+
+        //the right hand side
+        Eigen::VectorXd b = Eigen::VectorXd::Zero( p + 3 );
+        for( size_t i = 0; i < p; ++i )
+            b( i ) = samples[ patch.sampleIndexes[i] ].value;
+
+        const FactorizationType* factorization = cachedFactorizations[iPatch];
+        if( ! factorization ){
+            FactorizationType& newFactorization = newFactorizations[iPatch];
+            Eigen::MatrixXd& L = newFactorization.L;
+            L = Eigen::MatrixXd::Zero( p + 3, p + 3 );
+            // Fill K (p x p, upper left of L) and calculate
+            // mean edge length from control points
+            double a = 0.0;
+            for( size_t i = 0; i < p; ++i ){
+                const SampleType& si = samples[ patch.sampleIndexes[i] ];
+                for( size_t j = i + 1; j < p; ++j ){
+                    const SampleType& sj = samples[ patch.sampleIndexes[j] ];
+                    double dx = si.x - sj.x;
+                    double dy = si.y - sj.y;
+                    double r2 = dx * dx + dy * dy;
+                    L( i, j ) = L( j, i ) = tpsBasis( r2 );
+                    a += std::sqrt( r2 ) * 2;
+                }
+            }
+            a /= static_cast<double>( p * p );
+            // Fill the rest of L
+            for( size_t i = 0; i < p; ++i ){
+                const SampleType& si = samples[ patch.sampleIndexes[i] ];
+                // diagonal: reqularization parameters (lambda * a^2)
+                L( i, i ) = lambda * ( a * a );
+                // P (p x 3, upper right) and P transposed (3 x p, bottom left)
+                L( i, p+0 ) = L( p+0, i ) = 1.0;
+                L( i, p+1 ) = L( p+1, i ) = si.x - patch.centerX;
+                L( i, p+2 ) = L( p+2, i ) = si.y - patch.centerY;
+            }
+            newFactorization.qr.compute( L );
+            factorization = &newFactorization;
+        }
+
+        patch.coefficients = factorization->qr.solve( b );
+
+        //test for solution for acccuracy, since Eigen doesn't do divisions by zero.
+        if( ! patch.coefficients.allFinite() ||
+              ( factorization->L * patch.coefficients - b ).norm() > 0.01 * b.norm() + 1e-12 )
+            failed[iPatch] = 1;
+    }
+}
+
+/** Evaluates the blended patch splines in the cells of the first slice with i in [iFirst, iLast]. */
+template< typename SampleType, typename PatchType >
+void taskEvaluateRangeOfRows( const std::vector<double>& cellXs,
+                              const std::vector<double>& cellYs,
+                              const std::vector<SampleType>& samples,
+                              const std::vector<PatchType>& patches,
+                              const PlaneBoxRtree& patchesIndex,
+                              int nJ, int nK,
+                              int iFirst, int iLast,
+                              std::vector<double>& outputValues ){
+    std::vector< PlaneBoxAndIndex > coveringPatches;
+    for( int i = iFirst; i <= iLast; ++i )
+        for( int j = 0; j < nJ; ++j ){
+            size_t iOutput = (size_t)i * nJ + j;
+            size_t iCell = iOutput * nK;
+            double x = cellXs[iCell];
+            double y = cellYs[iCell];
+            coveringPatches.clear();
+            patchesIndex.query( bgi::intersects( PlanePoint( x, y ) ), std::back_inserter( coveringPatches ) );
+            double sumWeights = 0.0;
+            double sumWeightedValues = 0.0;
+            for( const PlaneBoxAndIndex& coveringPatch : coveringPatches ){
+                const PatchType& patch = patches[ coveringPatch.second ];
+                double halfWidth = ( patch.xmax - patch.xmin ) / 2.0;
+                double halfHeight = ( patch.ymax - patch.ymin ) / 2.0;
+                double weight = puWeight( ( x - ( patch.xmin + halfWidth ) ) / halfWidth,
+                                          ( y - ( patch.ymin + halfHeight ) ) / halfHeight );
+                if( weight <= 0.0 )
+                    continue;
+                size_t p = patch.sampleIndexes.size();
+                const Eigen::VectorXd& c = patch.coefficients;
+                double h = c( p+0 ) + c( p+1 ) * ( x - patch.centerX ) + c( p+2 ) * ( y - patch.centerY );
+                for( size_t ii = 0; ii < p; ++ii ){
+                    const SampleType& s = samples[ patch.sampleIndexes[ii] ];
+                    double dx = s.x - x;
+                    double dy = s.y - y;
+                    h += c( ii ) * tpsBasis( dx * dx + dy * dy );
+                }
+                sumWeights += weight;
+                sumWeightedValues += weight * h;
+            }
+            if( sumWeights > 0.0 )
+                outputValues[iOutput] = sumWeightedValues / sumWeights;
+        }
+}
+
+} //namespace
+
+spectral::array ScatteredDataInterpolator::interpolateThinPlateSpline(const spectral::array &inputData,
+                                                                      double lambda,
+                                                                      int nPointsPerPatch,
+                                                                      int &status)
+{
+    //the minimum number of samples of a patch so its spline is not a degenerate plane
+    const size_t MIN_SAMPLES_PER_PATCH = 8;
+    //the patch supports are the quadtree leaves enlarged by this fraction of their sizes at each side
+    const double SUPPORT_MARGIN = 0.25;
+
+    //populate a vector with the samples in the first slice: x, y, data value
+    std::vector<Sample> samples = collectSamples( inputData, 0 );
+    if( samples.size() < 3 ){
+        status = 1;
+        return spectral::array();
+    }
+    size_t nMaxSamplesPerLeaf = std::max<size_t>( MIN_SAMPLES_PER_PATCH, nPointsPerPatch );
+    size_t nMaxSamplesPerPatch = 4 * nMaxSamplesPerLeaf;
+
+    //the domain is the bounding box of the cells of the first slice
+    QuadtreeNode root;
+    root.xmin = root.ymin =  std::numeric_limits<double>::max();
+    root.xmax = root.ymax = -std::numeric_limits<double>::max();
+    for( int i = 0; i < m_nI; ++i )
+        for( int j = 0; j < m_nJ; ++j ){
+            size_t iCell = getCellIndex( i, j, 0 );
+            root.xmin = std::min( root.xmin, m_cellXs[iCell] );
+            root.xmax = std::max( root.xmax, m_cellXs[iCell] );
+            root.ymin = std::min( root.ymin, m_cellYs[iCell] );
+            root.ymax = std::max( root.ymax, m_cellYs[iCell] );
+        }
+    //avoid degenerate supports in grids with a single row or column
+    double epsilon = std::max( m_gridMesh.getCellSizeI(), m_gridMesh.getCellSizeJ() ) / 2.0;
+    root.xmin -= epsilon; root.xmax += epsilon;
+    root.ymin -= epsilon; root.ymax += epsilon;
+    root.sampleIndexes.resize( samples.size() );
+    std::iota( root.sampleIndexes.begin(), root.sampleIndexes.end(), 0 );
+
+    //split the domain into the patches
+    std::vector<QuadtreeNode> leaves;
+    buildQuadtreeLeaves( root, samples, nMaxSamplesPerLeaf, 0, leaves );
+
+    //index the samples for the patch neighborhood queries
+    std::vector<PlanePointAndIndex> sampleIndexEntries;
+    sampleIndexEntries.reserve( samples.size() );
+    for( size_t iSample = 0; iSample < samples.size(); ++iSample )
+        sampleIndexEntries.push_back( { PlanePoint( samples[iSample].x, samples[iSample].y ), iSample } );
+    PlanePointRtree samplesIndex( sampleIndexEntries.begin(), sampleIndexEntries.end() );
+
+    //define the patches: the supports and the samples in them
+    std::vector<TPSPatch> patches( leaves.size() );
+    std::vector<PlaneBoxAndIndex> patchIndexEntries;
+    patchIndexEntries.reserve( leaves.size() );
+    for( size_t iPatch = 0; iPatch < leaves.size(); ++iPatch ){
+        const QuadtreeNode& leaf = leaves[iPatch];
+        TPSPatch& patch = patches[iPatch];
+        double marginX = ( leaf.xmax - leaf.xmin ) * SUPPORT_MARGIN;
+        double marginY = ( leaf.ymax - leaf.ymin ) * SUPPORT_MARGIN;
+        patch.xmin = leaf.xmin - marginX;
+        patch.xmax = leaf.xmax + marginX;
+        patch.ymin = leaf.ymin - marginY;
+        patch.ymax = leaf.ymax + marginY;
+        patch.centerX = ( patch.xmin + patch.xmax ) / 2.0;
+        patch.centerY = ( patch.ymin + patch.ymax ) / 2.0;
+        PlaneBox support( PlanePoint( patch.xmin, patch.ymin ), PlanePoint( patch.xmax, patch.ymax ) );
+        patchIndexEntries.push_back( { support, iPatch } );
+        std::vector<PlanePointAndIndex> patchSamples;
+        samplesIndex.query( bgi::intersects( support ), std::back_inserter( patchSamples ) );
+        //too few samples (e.g. a leaf in an empty region): use the nearest ones
+        //too many samples (e.g. a leaf next to a dense cluster): keep the nearest ones
+        if( patchSamples.size() < MIN_SAMPLES_PER_PATCH || patchSamples.size() > nMaxSamplesPerPatch ){
+            size_t nSamplesToUse = std::min( samples.size(), patchSamples.size() < MIN_SAMPLES_PER_PATCH ?
+                                                                 MIN_SAMPLES_PER_PATCH : nMaxSamplesPerPatch );
+            patchSamples.clear();
+            samplesIndex.query( bgi::nearest( PlanePoint( patch.centerX, patch.centerY ), nSamplesToUse ),
+                                std::back_inserter( patchSamples ) );
+        }
+        //the samples are sorted by cell so the set of samples is a key to reuse factorizations
+        for( const PlanePointAndIndex& patchSample : patchSamples )
+            patch.sampleIndexes.push_back( patchSample.second );
+        std::sort( patch.sampleIndexes.begin(), patch.sampleIndexes.end() );
+    }
+
+    //the factorizations depend on lambda
+    if( lambda != m_tpsFactorizationsLambda ){
+        m_tpsFactorizationsCache.clear();
+        m_tpsFactorizationsLambda = lambda;
+    }
+
+    //look up the patches whose samples did not change since the previous call.
+    //the samples are ordered by cell index, so sorted sample indexes yield sorted cell indexes
+    std::vector< std::vector<size_t> > patchKeys( patches.size() );
+    std::vector< const TPSFactorization* > cachedFactorizations( patches.size(), nullptr );
+    for( size_t iPatch = 0; iPatch < patches.size(); ++iPatch ){
+        std::vector<size_t>& key = patchKeys[iPatch];
+        key.reserve( patches[iPatch].sampleIndexes.size() );
+        for( size_t iSample : patches[iPatch].sampleIndexes )
+            key.push_back( samples[iSample].cellIndex );
+        std::map< std::vector<size_t>, TPSFactorization >::const_iterator it = m_tpsFactorizationsCache.find( key );
+        if( it != m_tpsFactorizationsCache.end() ){
+            //the patch center may differ even with the same samples
+            if( patches[iPatch].centerX == it->second.centerX && patches[iPatch].centerY == it->second.centerY )
+                cachedFactorizations[iPatch] = &it->second;
+        }
+    }
+
+    //solve the patch systems in parallel
+    std::vector<TPSFactorization> newFactorizations( patches.size() );
+    for( size_t iPatch = 0; iPatch < patches.size(); ++iPatch ){
+        newFactorizations[iPatch].centerX = patches[iPatch].centerX;
+        newFactorizations[iPatch].centerY = patches[iPatch].centerY;
+    }
+    std::vector<char> failed( patches.size(), 0 );
+    {
+        unsigned int nThreads = std::max<unsigned int>( 1, std::min<size_t>( m_nThreads, patches.size() ) );
+        std::vector< std::pair< int, int > > patchRanges = Util::generateSubRanges( 0, patches.size()-1, nThreads );
+        std::thread threads[nThreads];
+        for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+            threads[iThread] = std::thread( taskSolveRangeOfPatches< Sample, TPSPatch, TPSFactorization >,
+                                            std::cref( samples ),
+                                            lambda,
+                                            std::cref( cachedFactorizations ),
+                                            patchRanges[iThread].first,
+                                            patchRanges[iThread].second,
+                                            std::ref( patches ),
+                                            std::ref( newFactorizations ),
+                                            std::ref( failed ) );
+        for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+            threads[iThread].join();
+    }
+    if( std::find( failed.begin(), failed.end(), 1 ) != failed.end() ){
+        status = 3;
+        return spectral::array();
+    }
+
+    //keep the factorizations of this call for the next one
+    {
+        std::map< std::vector<size_t>, TPSFactorization > newCache;
+        for( size_t iPatch = 0; iPatch < patches.size(); ++iPatch ){
+            std::vector<size_t>& key = patchKeys[iPatch];
+            if( newCache.find( key ) != newCache.end() )
+                continue;
+            if( cachedFactorizations[iPatch] ){
+                TPSFactorization& cachedFactorization = m_tpsFactorizationsCache[key];
+                newCache.emplace( std::move( key ), std::move( cachedFactorization ) );
+            } else
+                newCache.emplace( std::move( key ), std::move( newFactorizations[iPatch] ) );
+        }
+        m_tpsFactorizationsCache = std::move( newCache );
+    }
+
+    //evaluate the blended splines in the grid cells in parallel
+    spectral::array result( static_cast<spectral::index>(m_nI),
+                            static_cast<spectral::index>(m_nJ),
+                            static_cast<spectral::index>(1) );
+    PlaneBoxRtree patchesIndex( patchIndexEntries.begin(), patchIndexEntries.end() );
+    {
+        unsigned int nThreads = std::max( 1, std::min<int>( m_nThreads, m_nI ) );
+        std::vector< std::pair< int, int > > rowRanges = Util::generateSubRanges( 0, m_nI-1, nThreads );
+        std::thread threads[nThreads];
+        for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+            threads[iThread] = std::thread( taskEvaluateRangeOfRows< Sample, TPSPatch >,
+                                            std::cref( m_cellXs ),
+                                            std::cref( m_cellYs ),
+                                            std::cref( samples ),
+                                            std::cref( patches ),
+                                            std::cref( patchesIndex ),
+                                            m_nJ, m_nK,
+                                            rowRanges[iThread].first,
+                                            rowRanges[iThread].second,
+                                            std::ref( result.data() ) );
+        for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+            threads[iThread].join();
+    }
+
+    status = 0;
+    return result;
+}
@@ -0,0 +1,108 @@
+#ifndef SCATTEREDDATAINTERPOLATOR_H
+#define SCATTEREDDATAINTERPOLATOR_H
+
+#include <vector>
+#include <map>
+#include <limits>
+#include <Eigen/Dense>
+#include "spectral/spectral.h"
+
+class IJAbstractCartesianGrid;
+
+/**
+ * The ScatteredDataInterpolator class fills the unvalued cells of gridded data by interpolating the
+ * valued cells.  It is meant to be used in iterative algorithms that interpolate many arrays defined
+ * on the same grid (e.g. the envelope interpolations of each sifting step in Empirical Mode Decomposition),
+ * so it keeps state between calls: the cell center coordinates are computed only once and the
+ * factorizations of the Thin Plate Spline systems are reused whenever the set of valued cells of a patch
+ * does not change between calls.
+ *
+ * This class is an alternative to ImageJockeyUtils::interpolateNullValuesShepard() and
+ * ImageJockeyUtils::interpolateNullValuesThinPlateSpline(), which use all data points to interpolate each
+ * cell and, thus, do not scale to large grids.  Here, the samples are indexed with an R-Tree and:
+ * 1) Shepard's method uses only the N nearest samples to each cell;
+ * 2) The Thin Plate Spline is localized with a partition of unity: the domain is split with a quadtree
+ *    into patches with at most N samples, a small Thin Plate Spline is solved for each patch and the
+ *    patch splines are blended with compactly supported weights.  This replaces one dense O(n^3) system
+ *    with many small independent systems, which are solved in parallel.
+ */
+class ScatteredDataInterpolator
+{
+public:
+    /**
+     * @param gridMesh The grid geometry.  It must outlive this object.
+     * @param nThreads Number of threads used in the interpolations.  Zero means the number of logical processors.
+     */
+    ScatteredDataInterpolator( IJAbstractCartesianGrid& gridMesh, unsigned int nThreads = 0 );
+
+    /**
+     * Interpolates invalid values ( std::isfinite() returns false ) from valid values in the passed array with
+     * Shepard's method (inverse distance weighting).  The cells with valid values keep their values.
+     * @param nNeighbors The maximum number of nearest samples used to interpolate each cell.
+     * @param maxDistanceFactor The maximum distance of influence of the samples as a fraction of the grid's
+     *                          diagonal, as in vtkShepardMethod.  Values greater than or equal to 1.0 mean
+     *                          no limit.  The cells without samples within this distance are set to nullValue.
+     */
+    spectral::array interpolateShepard( const spectral::array& inputData,
+                                        double powerParameter = 2.0,
+                                        int nNeighbors = 32,
+                                        double maxDistanceFactor = 1.0,
+                                        double nullValue = std::numeric_limits<double>::quiet_NaN() );
+
+    /**
+     * Interpolates invalid values ( std::isfinite() returns false ) from valid values in the passed array with
+     * a partition-of-unity localized Thin Plate Spline.  As in ImageJockeyUtils::interpolateNullValuesThinPlateSpline(),
+     * the input data must be 2D (only data at first z-slice will be processed).
+     * @param lambda Set to 0.0 to force the spline pass through all points.  Larger values make the spline smoother.
+     *               The regularization is lambda times the square of the mean distance between the samples of each patch.
+     * @param nPointsPerPatch The maximum number of samples in the quadtree leaves.  The actual systems are somewhat
+     *                        larger, since the patches overlap.
+     * @param status Check this value for execution termination status: 0 = OK; 1 = less than three samples,
+     *               3 = innacurate solution.  Do not use the returned array if the execution fails.
+     */
+    spectral::array interpolateThinPlateSpline( const spectral::array& inputData,
+                                                double lambda,
+                                                int nPointsPerPatch,
+                                                int& status );
+
+private:
+    /** A sample used in the interpolations. */
+    struct Sample {
+        double x, y, z, value;
+        size_t cellIndex;
+    };
+
+    /** The local Thin Plate Spline of a partition of unity patch. */
+    struct TPSPatch {
+        double xmin, xmax, ymin, ymax; //the support (the weight is zero outside it)
+        std::vector<size_t> sampleIndexes; //indexes into the samples vector
+        double centerX, centerY; //the coordinates are centered for better conditioning
+        Eigen::VectorXd coefficients; //n weights of the basis functions followed by the 3 terms of the plane
+    };
+
+    /** A factored Thin Plate Spline system that can be reused for new values at the same locations. */
+    struct TPSFactorization {
+        double centerX, centerY; //the coordinates were centered at the patch center
+        Eigen::MatrixXd L;
+        Eigen::ColPivHouseholderQR<Eigen::MatrixXd> qr;
+    };
+
+    /** Collects the valid samples in the given z-slice (-1 means all slices). */
+    std::vector<Sample> collectSamples( const spectral::array& inputData, int kSlice ) const;
+
+    /** Returns the linear index of a cell in the cell center arrays.  It is the same of spectral::array's elements. */
+    size_t getCellIndex( int i, int j, int k ) const { return ( (size_t)i * m_nJ + j ) * m_nK + k; }
+
+    IJAbstractCartesianGrid& m_gridMesh;
+    unsigned int m_nThreads;
+    int m_nI, m_nJ, m_nK;
+
+    /** The cell center coordinates. */
+    std::vector<double> m_cellXs, m_cellYs, m_cellZs;
+
+    /** The Thin Plate Spline factorizations of the last call keyed by the sorted cell indexes of the samples. */
+    std::map< std::vector<size_t>, TPSFactorization > m_tpsFactorizationsCache;
+    double m_tpsFactorizationsLambda;
+};
+
+#endif // SCATTEREDDATAINTERPOLATOR_H
@@ -7,6 +7,7 @@
 #include <QMessageBox>
 #include <QProgressDialog>
 #include <QtCore>
+#include <algorithm>
 #include "svdfactorsel/svdfactorsselectiondialog.h"
 #include "../widgets/ijgridviewerwidget.h"
 #include "../imagejockeyutils.h"
@@ -177,8 +178,14 @@ void SVDAnalysisDialog::onFactorizeFurther()
     progressDialog.setLabelText("Computing SVD factors...");
     progressDialog.show();
     QCoreApplication::processEvents();
-	spectral::SVD svd = spectral::svd( m_right_clicked_factor->getFactorData() );
+    //Only the leading factors are computed, which is much faster than the full SVD for large grids.
+    spectral::truncated_svd_settings settings;
+    settings.target_energy = 0.9999;
+    spectral::SVD svd = spectral::svd_truncated( m_right_clicked_factor->getFactorData(), settings );
     progressDialog.hide();
+    emit info( "SVDAnalysisDialog::onFactorizeFurther(): " + QString::number( svd.n_factors() ) +
+               " SVD factors computed (retained energy: " + QString::number( svd.energy_ratio( svd.n_factors() ) * 100.0 ) +
+               "%; relative approximation error: " + QString::number( svd.approximation_error( svd.n_factors() ) ) + ")." );
 
 	//get the grid geometry parameters (useful for displaying)
 	double x0 = m_right_clicked_factor->getX0();
@@ -188,8 +195,8 @@ void SVDAnalysisDialog::onFactorizeFurther()
 	double dy = m_right_clicked_factor->getDY();
 	double dz = m_right_clicked_factor->getDZ();
 
-	//get the list with the factor weights (information quantity)
-	spectral::array weights = svd.factor_weights();
+	//get the list with the factor weights (fraction of the energy of the factor being split)
+	spectral::array weights = svd.energy_weights();
 
     //tests whether the factor is factorizable (not fundamental)
     if( weights[0] > 0.999999 ){
@@ -209,7 +216,7 @@ void SVDAnalysisDialog::onFactorizeFurther()
 	int userResponse = svdfsd->exec();
 	if( userResponse != QDialog::Accepted )
 		return;
-	long numberOfFactors = m_numberOfSVDFactorsSetInTheDialog;
+	long numberOfFactors = std::min<long>( m_numberOfSVDFactorsSetInTheDialog, weights.data().size() );
 
 	//Get the desired SVD factors
 	{
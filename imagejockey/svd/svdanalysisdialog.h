@@ -51,6 +51,9 @@ signals:
      */
     void sumOfFactorsComputed( spectral::array* sumOfFactors );
 
+    /** Emitted to report informative messages (e.g. the accuracy of a factorization). */
+    void info( QString message );
+
 private:
     Ui::SVDAnalysisDialog *ui;
 	SVDFactorTree *m_tree;
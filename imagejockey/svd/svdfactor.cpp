@@ -2,10 +2,6 @@
 #include <QInputDialog>
 #include <QMessageBox>
 #include <algorithm>
-#include <boost/geometry.hpp>
-#include <boost/geometry/geometries/point_xy.hpp>
-#include <boost/geometry/geometries/polygon.hpp>
-#include <boost/scoped_array.hpp>
 #include "../ijabstractvariable.h"
 #include "../imagejockeyutils.h"
 #include "spectral/spectral.h"
@@ -46,7 +42,7 @@ double SVDFactor::getSVDFactorTreeSplitThreshold(bool reset)
         //ask the user once for the default tree split threshold
         bool ok;
         int percentage = QInputDialog::getInt(nullptr, "Further SVD factoring threshold",
-									 "Split information content in percentage parts (%):", 50, 0, 50, 5, &ok);
+									 "Split energy (information content) in percentage parts (%):", 50, 0, 50, 5, &ok);
         if (ok)
             setting = percentage / 100.0;
         else
@@ -590,83 +586,34 @@ void SVDFactor::getAllVariables(std::vector<IJAbstractVariable *> &result)
     result.push_back( m_variableProxy );
 }
 
-void SVDFactor::equalizeValues(QList<QPointF> &area,
-                               double delta_dB,
-                               int variableIndex,
-                               double dB_reference,
-                               const QList<QPointF> &secondArea)
-{
-    //some typedefs to shorten code
-    typedef boost::geometry::model::d2::point_xy<double> boostPoint2D;
-    typedef boost::geometry::model::polygon<boostPoint2D> boostPolygon;
-
-    //define a Boost polygon from the area geometry points
-    const std::size_t n = area.size();
-    boost::scoped_array<boostPoint2D> points(new boostPoint2D[n]); //scoped_array frees memory when its scope ends.
-    for(std::size_t i = 0; i < n; ++i)
-        points[i] = boostPoint2D( area[i].x(), area[i].y() );
-    boostPolygon poly;
-    boost::geometry::assign_points( poly, std::make_pair(&points[0], &points[0] + n));
-
-    //define a Boost polygon from the second area (if not empty)
-    boostPolygon secondPoly;
-    if( ! secondArea.empty() ){
-        const std::size_t n = secondArea.size();
-        boost::scoped_array<boostPoint2D> secondPoints(new boostPoint2D[n]); //scoped_array frees memory when its scope ends.
-        for(std::size_t i = 0; i < n; ++i)
-            secondPoints[i] = boostPoint2D( secondArea[i].x(), secondArea[i].y() );
-        boost::geometry::assign_points( secondPoly, std::make_pair(&secondPoints[0], &secondPoints[0] + n));
-    }
-
-    //get the 2D bounding box of the polygon
-    double minX = std::numeric_limits<double>::max();
-    double maxX = std::numeric_limits<double>::lowest();
-    double minY = std::numeric_limits<double>::max();
-    double maxY = std::numeric_limits<double>::lowest();
-    QList<QPointF>::iterator it = area.begin();
-    for( ; it != area.end(); ++it){
-        minX = std::min<double>( minX, (*it).x() );
-        maxX = std::max<double>( maxX, (*it).x() );
-        minY = std::min<double>( minY, (*it).y() );
-        maxY = std::max<double>( maxY, (*it).y() );
-    }
-
-    //scan the grid, testing each cell whether it lies within the area.
-    //TODO: this code assumes no grid rotation and that the grid is 2D.
-    for( int k = 0; k < getNK(); ++k ){
-        // z coordinate is ignored in 2D spectrograms
-        for( int j = 0; j < getNJ(); ++j ){
-            double cellCenterY = getOriginY() + j * getCellSizeJ();
-            for( int i = 0; i < getNI(); ++i ){
-                double cellCenterX = getOriginX() + i * getCellSizeJ();
-                boostPoint2D p(cellCenterX, cellCenterY);
-                // if the cell center lies within the area
-                // The bounding box test is a faster test to promplty discard cells obviously outside.
-                if(     ImageJockeyUtils::isWithinBBox( cellCenterX, cellCenterY, minX, minY, maxX, maxY )
-                        &&
-                        boost::geometry::within(p, poly)
-                        &&
-                        ( secondArea.isEmpty() || boost::geometry::within(p, secondPoly) )   ){
-                    // get the grid value as is
-                    double value = getData( variableIndex, i, j, k );
-                    // determine whether the value is negative
-                    bool isNegative = value < 0.0;
-                    // get the absolute value
-                    value = std::abs(value);
-                    // get the absolute value in dB
-                    double value_dB = ImageJockeyUtils::dB( value, dB_reference, 0.00001);
-                    // apply adjustment in dB
-                    value_dB += delta_dB;
-                    // attenuate/amplify the absolute value
-                    value = std::pow( 10.0d, value_dB / 10.0/*DECIBEL_SCALE_FACTOR*/ ) * dB_reference;
-                    // add negative sign if the original value was negative
-                    if( isNegative )
-                        value = -value;
-                    // set the amplified/attenuated value to the grid
-                    (*m_factorData)(i, j, k) = value;
-                }
-            }
-        }
+void SVDFactor::equalizeCells(const std::vector<long> &cells,
+                              double delta_dB,
+                              int variableIndex,
+                              double dB_reference)
+{
+    const long nI = getNI();
+    const long nJ = getNJ();
+    for( long cell : cells ){
+        int i = cell % nI;
+        int j = ( cell / nI ) % nJ;
+        int k = cell / ( nI * nJ );
+        // get the grid value as is
+        double value = getData( variableIndex, i, j, k );
+        // determine whether the value is negative
+        bool isNegative = value < 0.0;
+        // get the absolute value
+        value = std::abs(value);
+        // get the absolute value in dB
+        double value_dB = ImageJockeyUtils::dB( value, dB_reference, 0.00001);
+        // apply adjustment in dB
+        value_dB += delta_dB;
+        // attenuate/amplify the absolute value
+        value = std::pow( 10.0d, value_dB / 10.0/*DECIBEL_SCALE_FACTOR*/ ) * dB_reference;
+        // add negative sign if the original value was negative
+        if( isNegative )
+            value = -value;
+        // set the amplified/attenuated value to the grid
+        (*m_factorData)(i, j, k) = value;
     }
 }
 
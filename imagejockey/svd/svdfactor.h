@@ -33,7 +33,8 @@ public:
     /**
 	 * @param factorData The array of values of the factor.
 	 * @param number The factor number in the series. This number is used to make the factor name.
-	 * @param weight The information contribution of the factor, normally a value between 0.0 and 1.0.
+	 * @param weight The information contribution of the factor, normally a value between 0.0 and 1.0.  It is
+	 *        the fraction of the parent's energy (squared Frobenius norm) the factor accounts for (see spectral::SVD::energy_weights()).
 	 * @param x0 Grid origin (useful for viewers).
 	 * @param y0 Grid origin (useful for viewers).
 	 * @param z0 Grid origin (useful for viewers).
@@ -119,7 +120,9 @@ public:
     //@{
     /** These methods control data selection in 3D volumes for a 2D slice viewer. */
     void setCurrentSlice( uint slice ){ m_currentSlice = slice; }
+    uint getCurrentSlice() const { return m_currentSlice; }
     void setPlaneOrientation( SVDFactorPlaneOrientation orientation );
+    SVDFactorPlaneOrientation getPlaneOrientation() const { return m_currentPlaneOrientation; }
     //@}
 
     /** Adds this factor's data array's values to the passed array's values.
@@ -263,7 +266,7 @@ public:
     virtual IJAbstractVariable *getVariableByName(QString){ return m_variableProxy; }
     virtual void getAllVariables(std::vector<IJAbstractVariable *> &result);
     virtual IJAbstractVariable *getVariableByIndex(int){ return m_variableProxy; }
-    virtual void equalizeValues(QList<QPointF> &area, double delta_dB, int variableIndex, double dB_reference, const QList<QPointF> &secondArea);
+    virtual void equalizeCells(const std::vector<long> &cells, double delta_dB, int variableIndex, double dB_reference);
     virtual void saveData();
 	virtual spectral::array *createSpectralArray(int variableIndex);
     virtual spectral::complex_array *createSpectralComplexArray(int variableIndex1, int variableIndex2);
@@ -4,6 +4,8 @@
 
 #include <QLineSeries>
 #include <QValueAxis>
+#include <algorithm>
+#include <numeric>
 
 SVDFactorsSelectionDialog::SVDFactorsSelectionDialog(const std::vector<double> & weights,
                                                      bool deleteSelfOnClose,
@@ -35,7 +37,7 @@ SVDFactorsSelectionDialog::SVDFactorsSelectionDialog(const std::vector<double> &
 	chart->legend()->hide();
 	chart->addSeries(series);
 	chart->createDefaultAxes();
-	chart->setTitle("SVD factor cumulative information content curve");
+	chart->setTitle("SVD factor cumulative energy curve");
 	chart->axisY( series )->setMax(100.0);
 	chart->axisY( series )->setMin(0.0);
 	chart->axisY( series )->setTitleText("%");
@@ -71,16 +73,18 @@ void SVDFactorsSelectionDialog::onGetAllFactors()
 
 void SVDFactorsSelectionDialog::onGetAllFactorsUpTo100()
 {
-    //get the factor number that reaches 100% of information content
+    //get the factor number that reaches 100% of the energy of the given factors, which may be less than
+    //the total energy if only the leading factors were computed (see spectral::svd_truncated())
+    double total = std::accumulate( m_weights.cbegin(), m_weights.cend(), 0.0 );
     std::vector<double>::const_iterator it = m_weights.cbegin();
     double cumulative = 0.0;
     uint i = 1;
     for(i = 1; it != m_weights.cend(); ++it, ++i){
         cumulative += *it;
-        if( cumulative > 0.99999 )
+        if( cumulative > total * 0.99999 )
             break;
     }
-    m_numberOfFactors = i;
+    m_numberOfFactors = std::min<uint>( i, m_weights.size() );
     emit numberOfFactorsSelected( m_numberOfFactors );
     accept();
 }
@@ -2,6 +2,7 @@
 #define VARIOGRAPHICDECOMPOSITIONDIALOG_H
 
 #include <QDialog>
+#include <memory>
 
 namespace Ui {
 class VariographicDecompositionDialog;
@@ -11,6 +12,8 @@ class IJCartesianGridSelector;
 class IJVariableSelector;
 class IJAbstractVariable;
 class IJAbstractCartesianGrid;
+class VariographicOptimizer;
+struct VariographicParametersDomain;
 namespace spectral {
     class array;
     class complex_array;
@@ -66,7 +69,7 @@ private:
 	std::vector< IJAbstractCartesianGrid* > m_grids;
 
 	/** Computes the SVD factors for the given variable of the given grid.
-	 * @param infoContentToKeepForSVD The ammount of information content to keep, for example, 0.95 for 95%.
+	 * @param infoContentToKeepForSVD The fraction of the data's energy to keep, for example, 0.99 for 99%.
 	 *        The lower, the less SVD factors are generated, at the cost of accuracy.
 	 */
 	void doSVDonData(const spectral::array* gridInputData,
@@ -106,6 +109,21 @@ private:
                                      const spectral::array &B,
                                      const spectral::array &I ) const;
 
+    /** Creates the optimization engine with the data of the selected grid and variable.  The engine
+     * reports its progress to this dialog's info() signal. */
+    std::unique_ptr<VariographicOptimizer> makeVariographicOptimizer();
+
+    /** Returns the default domain of the variographic parameters for the selected grid. */
+    VariographicParametersDomain makeDefaultDomain( const VariographicOptimizer& optimizer );
+
+    /** Displays the theoretical varmaps and the geological factors corresponding to the given parameters.
+     * @param displayModelAndInputVarmaps If true, the variogram model surface and the input's varmap are
+     *        also displayed.
+     */
+    void displayVariographicDecompositionResults( const VariographicOptimizer& optimizer,
+                                                  const spectral::array& parameters,
+                                                  bool displayModelAndInputVarmaps );
+
 
 private Q_SLOTS:
 	void doVariographicDecomposition();
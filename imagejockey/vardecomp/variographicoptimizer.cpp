@@ -0,0 +1,901 @@
+#include "variographicoptimizer.h"
+
+#include "imagejockey/ijabstractcartesiangrid.h"
+#include "imagejockey/ijvariographicmodel2d.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+
+extern std::mutex mutexFFTW; //defined in gaborutils.cpp: the FFTW planner is not thread-safe
+
+namespace {
+
+//////////////////////////////CLASS FOR THE GENETIC ALGORITHM//////////////////////////////
+
+class Individual{
+public:
+    //constructors
+    Individual() = delete;
+    Individual( int nNumberOfParameters ) :
+        parameters( (spectral::index)nNumberOfParameters ),
+        fValue( std::numeric_limits<double>::max() )
+    {}
+    Individual( const spectral::array& pparameters ) :
+        parameters( pparameters ),
+        fValue( std::numeric_limits<double>::max() )
+    {}
+
+    //methods
+    std::pair<Individual, Individual> crossOver( const Individual& otherIndividual,
+                                                 int pointOfCrossOver ) const {
+        assert( parameters.size() && otherIndividual.parameters.size() &&
+            "Individual::crossOver(): Either operands have zero parameters.") ;
+        Individual child1( parameters.size() ), child2( parameters.size() );
+        for( int iParameter = 0; iParameter < parameters.size(); ++iParameter ){
+            if( iParameter < pointOfCrossOver ){
+                child1.parameters[iParameter] = parameters[iParameter];
+                child2.parameters[iParameter] = otherIndividual.parameters[iParameter];
+            } else {
+                child1.parameters[iParameter] = otherIndividual.parameters[iParameter];
+                child2.parameters[iParameter] = parameters[iParameter];
+            }
+        }
+        return { child1, child2 };
+    }
+    void mutate( double mutationRate,
+                 const spectral::array& lowBoundaries,
+                 const spectral::array& highBoundaries ){
+        assert( lowBoundaries.size() == parameters.size() && highBoundaries.size() == parameters.size() &&
+            "Individual::mutate(): the boundaries and the parameters have different number of elements." );
+        //compute the mutation probability for a single gene (parameter)
+        double probOfMutation = 1.0 / parameters.size() * mutationRate;
+        //traverse all genes (parameters)
+        for( int iPar = 0; iPar < parameters.size(); ++iPar ){
+            //draw a value between 0.0 and 1.0 from an uniform distribution
+            double p = std::rand() / (double)RAND_MAX;
+            //if a mutation is due...
+            if( p < probOfMutation ) {
+                //perform mutation by randomly sorting a value within the domain.
+                double LO = lowBoundaries[iPar];
+                double HI = highBoundaries[iPar];
+                parameters[iPar] = LO + std::rand() / (RAND_MAX/(HI-LO));
+            }
+        }
+    }
+
+    //member variables
+    spectral::array parameters;
+    double fValue;
+
+    //operators
+    bool operator<( const Individual& otherIndividual ) const {
+        return fValue < otherIndividual.fValue;
+    }
+};
+typedef Individual Solution; //make a synonym just for code readbility
+
+/** Evaluates the fitness of all individuals as one batch. */
+void evaluatePopulation( const VariographicOptimizer& optimizer, std::vector< Individual >& population ){
+    std::vector< spectral::array > parameters;
+    parameters.reserve( population.size() );
+    for( const Individual& ind : population )
+        parameters.push_back( ind.parameters );
+    std::vector< double > fValues = optimizer.evaluateBatch( parameters );
+    for( size_t iInd = 0; iInd < population.size(); ++iInd )
+        population[iInd].fValue = fValues[iInd];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+
+} //anonymous namespace
+
+VariographicOptimizer::VariographicOptimizer( const IJAbstractCartesianGrid &gridWithGeometry,
+                                              const spectral::array &inputData,
+                                              int m,
+                                              unsigned int nThreads ) :
+    m_m( m ),
+    m_nI( gridWithGeometry.getNI() ),
+    m_nJ( gridWithGeometry.getNJ() ),
+    m_nK( gridWithGeometry.getNK() ),
+    m_objective( VariographicObjective::FOURIER_INTEGRAL_FITTING ),
+    m_inputData( inputData ),
+    m_spectrumSize( (size_t)m_nI * m_nJ * ( m_nK / 2 + 1 ) ),
+    m_job( nullptr ),
+    m_jobSize( 0 ),
+    m_nextJobItem( 0 ),
+    m_nBusyWorkers( 0 ),
+    m_jobGeneration( 0 ),
+    m_stopWorkers( false )
+{
+    assert( inputData.M() == m_nI && inputData.N() == m_nJ && inputData.K() == m_nK &&
+            "VariographicOptimizer::VariographicOptimizer(): input data and grid have different dimensions." );
+
+    if( nThreads == 0 )
+        nThreads = std::max( 1u, std::thread::hardware_concurrency() );
+
+    size_t nCells = (size_t)m_nI * m_nJ * m_nK;
+
+    //cache the offsets of the cell centers to the grid center
+    {
+        double xc = gridWithGeometry.getCenterX();
+        double yc = gridWithGeometry.getCenterY();
+        m_cellDXs.resize( nCells );
+        m_cellDYs.resize( nCells );
+        for( int i = 0; i < m_nI; ++i )
+            for( int j = 0; j < m_nJ; ++j )
+                for( int k = 0; k < m_nK; ++k ){
+                    double cellX, cellY, cellZ;
+                    gridWithGeometry.getCellLocation( i, j, k, cellX, cellY, cellZ );
+                    size_t index = ( (size_t)i * m_nJ + j ) * m_nK + k;
+                    m_cellDXs[index] = cellX - xc;
+                    m_cellDYs[index] = cellY - yc;
+                }
+    }
+
+    //allocate the workspaces (the calling thread uses the last one)
+    m_workspaces.resize( nThreads );
+    for( Workspace& workspace : m_workspaces ){
+        workspace.surface = spectral::array( (spectral::index)m_nI, (spectral::index)m_nJ, (spectral::index)m_nK, 0.0 );
+        workspace.realBuffer = (double*)fftw_malloc( sizeof(double) * nCells );
+        workspace.spectrumBuffer = (fftw_complex*)fftw_malloc( sizeof(fftw_complex) * m_spectrumSize );
+    }
+
+    //make the FFTW plans (they are reused with the buffers of all workspaces, which have the same alignment)
+    {
+        std::unique_lock<std::mutex> lck( mutexFFTW );
+        m_forwardPlan = fftw_plan_dft_r2c_3d( m_nI, m_nJ, m_nK,
+                                              m_workspaces[0].realBuffer, m_workspaces[0].spectrumBuffer,
+                                              FFTW_MEASURE );
+        m_backwardPlan = fftw_plan_dft_c2r_3d( m_nI, m_nJ, m_nK,
+                                               m_workspaces[0].spectrumBuffer, m_workspaces[0].realBuffer,
+                                               FFTW_MEASURE );
+    }
+
+    //compute the FFT of the input data to cache its phases and to compute its varmap
+    Workspace& workspace = m_workspaces[0];
+    std::copy( m_inputData.d_.begin(), m_inputData.d_.end(), workspace.realBuffer );
+    fftw_execute_dft_r2c( m_forwardPlan, workspace.realBuffer, workspace.spectrumBuffer );
+    m_inputPhaseCos.resize( m_spectrumSize );
+    m_inputPhaseSin.resize( m_spectrumSize );
+    for( size_t i = 0; i < m_spectrumSize; ++i ){
+        std::complex<double> value( workspace.spectrumBuffer[i][0], workspace.spectrumBuffer[i][1] );
+        double phase = std::arg( value );
+        m_inputPhaseCos[i] = std::cos( phase );
+        m_inputPhaseSin[i] = std::sin( phase );
+        //the FFT of a varmap is a^2 + b^2 as magnitude and zeros as phase,
+        //where a = real part of FFT; b = imaginary part of FFT.
+        workspace.spectrumBuffer[i][0] = std::norm( value );
+        workspace.spectrumBuffer[i][1] = 0.0;
+    }
+
+    //get the varmap of the input data by reverse FFT
+    fftw_execute_dft_c2r( m_backwardPlan, workspace.spectrumBuffer, workspace.realBuffer );
+    spectral::array varmap( (spectral::index)m_nI, (spectral::index)m_nJ, (spectral::index)m_nK );
+    for( size_t i = 0; i < nCells; ++i )
+        varmap.d_[i] = workspace.realBuffer[i] / nCells; //fftw requires that the values of r-FFT be divided by the number of cells
+
+    //put h=0 of the varmap at the center of the grid
+    m_inputVarmap = spectral::shiftByHalf( varmap );
+
+    //start the worker threads (the calling thread is also used, so one less thread is needed)
+    for( unsigned int iThread = 0; iThread < nThreads - 1; ++iThread )
+        m_workers.emplace_back( &VariographicOptimizer::workerLoop, this, (int)iThread );
+}
+
+VariographicOptimizer::~VariographicOptimizer()
+{
+    {
+        std::unique_lock<std::mutex> lck( m_poolMutex );
+        m_stopWorkers = true;
+    }
+    m_poolWakeUp.notify_all();
+    for( std::thread& worker : m_workers )
+        worker.join();
+
+    {
+        std::unique_lock<std::mutex> lck( mutexFFTW );
+        fftw_destroy_plan( m_forwardPlan );
+        fftw_destroy_plan( m_backwardPlan );
+    }
+    for( Workspace& workspace : m_workspaces ){
+        fftw_free( workspace.realBuffer );
+        fftw_free( workspace.spectrumBuffer );
+    }
+}
+
+int VariographicOptimizer::getNumberOfParameters() const
+{
+    return m_m * IJVariographicStructure2D::getNumberOfParameters();
+}
+
+void VariographicOptimizer::makeBounds( const VariographicParametersDomain &domain,
+                                        spectral::array &wMin,
+                                        spectral::array &wMax ) const
+{
+    wMin = spectral::array( (spectral::index)getNumberOfParameters(), 0.0 );
+    wMax = spectral::array( (spectral::index)getNumberOfParameters(), 1.0 );
+    for(int i = 0, iGeoFactor = 0; iGeoFactor < m_m; ++iGeoFactor )
+        for( int iPar = 0; iPar < IJVariographicStructure2D::getNumberOfParameters(); ++iPar, ++i )
+            switch( iPar ){
+            case 0: wMin[i] = domain.minAxis;         wMax[i] = domain.maxAxis;         break;
+            case 1: wMin[i] = domain.minRatio;        wMax[i] = domain.maxRatio;        break;
+            case 2: wMin[i] = domain.minAzimuth;      wMax[i] = domain.maxAzimuth;      break;
+            case 3: wMin[i] = domain.minContribution; wMax[i] = domain.maxContribution; break;
+            }
+}
+
+spectral::array VariographicOptimizer::computeVariographicSurface( const spectral::array &parameters ) const
+{
+    spectral::array surface( (spectral::index)m_nI, (spectral::index)m_nJ, (spectral::index)m_nK, 0.0 );
+    computeVariographicSurface( parameters, surface );
+    return surface;
+}
+
+void VariographicOptimizer::computeVariographicSurface( const spectral::array &parameters,
+                                                        spectral::array &surface ) const
+{
+    //this is the same of IJVariographicStructure2D::addContributionToModelGrid() with the spheric model
+    //and inverted values, but with the cell offsets cached.
+    int nParameters = IJVariographicStructure2D::getNumberOfParameters();
+    int nStructures = parameters.size() / nParameters;
+    size_t nCells = m_cellDXs.size();
+    for( int iGeoFactor = 0; iGeoFactor < nStructures; ++iGeoFactor ){
+        double a     = parameters[ iGeoFactor * nParameters + 0 ];
+        double b     = a * parameters[ iGeoFactor * nParameters + 1 ];
+        double theta = parameters[ iGeoFactor * nParameters + 2 ];
+        double c     = parameters[ iGeoFactor * nParameters + 3 ];
+        double cosTheta = std::cos( theta );
+        double sinTheta = std::sin( theta );
+        for( size_t i = 0; i < nCells; ++i ){
+            double x = m_cellDXs[i] * cosTheta - m_cellDYs[i] * sinTheta;
+            double y = m_cellDXs[i] * sinTheta + m_cellDYs[i] * cosTheta;
+            double h = std::sqrt((x/a)*(x/a) + (y/b)*(y/b));
+            double semivariance;
+            if( h >= 0.0 && h <= 1.0 )
+               semivariance = c * ( 3.0 * h/2.0 - h*h*h/2.0 ); //spheric model
+            else
+               semivariance = c ;
+            //invert the semivariance values to match the geometry of the varmap
+            surface.d_[i] += c - semivariance;
+        }
+    }
+}
+
+double VariographicOptimizer::evaluate( const spectral::array &parameters ) const
+{
+    return evaluate( parameters, m_workspaces.back() );
+}
+
+double VariographicOptimizer::evaluate( const spectral::array &parameters, Workspace &workspace ) const
+{
+    //generate the variogram model surface
+    std::fill( workspace.surface.d_.begin(), workspace.surface.d_.end(), 0.0 );
+    computeVariographicSurface( parameters, workspace.surface );
+    const std::vector<double>& surface = workspace.surface.d_;
+    size_t nCells = surface.size();
+
+    if( m_objective == VariographicObjective::VARMAP_FITTING ){
+        double sum = 0.0;
+        for( size_t i = 0; i < nCells; ++i )
+            sum += std::abs( m_inputVarmap.d_[i] - surface[i] );
+        return sum / nCells;
+    }
+
+    //Apply the principle of the Fourier Integral Method to obtain what would the map be
+    //if it actually had the theoretical variogram model
+
+    //shift the varmap by half so h=0 is at the origin
+    double* realBuffer = workspace.realBuffer;
+    for( int i = 0; i < m_nI; ++i ){
+        int i_shift = (i + m_nI/2) % m_nI;
+        for( int j = 0; j < m_nJ; ++j ){
+            int j_shift = (j + m_nJ/2) % m_nJ;
+            for( int k = 0; k < m_nK; ++k ){
+                int k_shift = (k + m_nK/2) % m_nK;
+                realBuffer[ ( (size_t)i_shift * m_nJ + j_shift ) * m_nK + k_shift ] = surface[ ( (size_t)i * m_nJ + j ) * m_nK + k ];
+            }
+        }
+    }
+
+    //compute FFT of the theoretical varmap
+    fftw_complex* spectrum = workspace.spectrumBuffer;
+    fftw_execute_dft_r2c( m_forwardPlan, realBuffer, spectrum );
+
+    //combine the square root of the amplitudes of the varmap FFT with the phases of the input
+    for( size_t i = 0; i < m_spectrumSize; ++i ){
+        double amplitudeSQRT = std::sqrt( std::sqrt( spectrum[i][0] * spectrum[i][0] + spectrum[i][1] * spectrum[i][1] ) );
+        spectrum[i][0] = amplitudeSQRT * m_inputPhaseCos[i];
+        spectrum[i][1] = amplitudeSQRT * m_inputPhaseSin[i];
+    }
+
+    //compute the reverse FFT to get the map
+    fftw_execute_dft_c2r( m_backwardPlan, spectrum, realBuffer );
+
+    //compute the objective function metric
+    //(fftw3's reverse FFT requires that the values of output be divided by the number of cells)
+    double sum = 0.0;
+    for( size_t i = 0; i < nCells; ++i )
+        sum += std::abs( m_inputData.d_[i] - realBuffer[i] / nCells );
+    return sum;
+}
+
+std::vector<double> VariographicOptimizer::evaluateBatch( const std::vector<spectral::array> &parameters ) const
+{
+    std::vector<double> result( parameters.size() );
+    parallelFor( parameters.size(), [&]( int i, int iWorkspace ){
+        result[i] = evaluate( parameters[i], m_workspaces[iWorkspace] );
+    });
+    return result;
+}
+
+spectral::array VariographicOptimizer::computeGradient( const spectral::array &parameters, double epsilon ) const
+{
+    int nParameters = parameters.size();
+    //Make sets of parameters slightly shifted to the right (more positive) and to the left (more negative)
+    //along each parameter.
+    std::vector< spectral::array > shiftedParameters;
+    shiftedParameters.reserve( 2 * nParameters );
+    for( int iParameter = 0; iParameter < nParameters; ++iParameter ){
+        spectral::array vwFromRight( parameters );
+        vwFromRight[iParameter] += epsilon;
+        shiftedParameters.push_back( vwFromRight );
+        spectral::array vwFromLeft( parameters );
+        vwFromLeft[iParameter] -= epsilon;
+        shiftedParameters.push_back( vwFromLeft );
+    }
+    std::vector< double > fValues = evaluateBatch( shiftedParameters );
+    //Compute (numerically) the partial derivatives.
+    spectral::array gradient( (spectral::index)nParameters );
+    for( int iParameter = 0; iParameter < nParameters; ++iParameter )
+        gradient[iParameter] = ( fValues[ 2 * iParameter ] - fValues[ 2 * iParameter + 1 ] ) / ( 2 * epsilon );
+    return gradient;
+}
+
+spectral::array VariographicOptimizer::runSimulatedAnnealing( const spectral::array &initialParameters,
+                                                              const spectral::array &wMin,
+                                                              const spectral::array &wMax,
+                                                              const SimulatedAnnealingParameters &parameters ) const
+{
+    double f_Tinitial = parameters.initialTemperature;
+    double f_Tfinal = parameters.finalTemperature;
+    //Returns the current “temperature” of the system.  It yields a log curve that decays as the step number increase.
+    // The initial temperature plays an important role: curve starting with 5.000 is steeper than another that starts with 1.000.
+    //  This means the the lower the temperature, the more linear the temperature decreases.
+    // i_stepNumber: the current step number of the annealing process ( 0 = first ).
+    auto temperature = [=](int i_stepNumber) { return f_Tinitial * std::exp( -i_stepNumber / (double)1000 * (1.5 * std::log10( f_Tinitial ) ) ); };
+    /*Returns the probability of acceptance of the energy state for the next iteration.
+      This allows acceptance of higher values to break free from local minima.
+      f_eCurrent: current energy of the system.
+      f_eNew: energy level of the next step.
+      f_T: current “temperature” of the system.*/
+    auto probAcceptance = [=]( double f_eCurrent, double f_eNewLocal, double f_T ) {
+       //If the new state is more energetic, calculates a probability of acceptance
+       //which is as high as the current “temperature” of the process.  The “temperature”
+       //diminishes with iterations.
+       if ( f_eNewLocal > f_eCurrent )
+          return ( f_T - f_Tfinal ) / ( f_Tinitial - f_Tfinal );
+       //If the new state is less energetic, the probability of acceptance is 100% (natural search for minima).
+       else
+          return 1.0 - ( f_T - f_Tfinal ) / ( f_Tinitial - f_Tfinal );
+    };
+    //Get the number of parameters.
+    int i_nPar = initialParameters.size();
+    //Make a copy of the initial state (parameter set).
+    spectral::array L_wCurrent( initialParameters );
+    //Computes the “energy” of the current state (set of parameters).
+    //The “energy” in this case is how different the image as given the parameters is with respect
+    //the data grid, considered the reference image.
+    double f_eCurrent = evaluate( L_wCurrent );
+    //The parameters variations (maxes - mins)
+    spectral::array L_wDelta = wMax - wMin;
+    //the initial state is the lowest energy state so far.
+    double f_lowestEnergyFound = f_eCurrent;
+    spectral::array L_wOfLowestEnergyFound( L_wCurrent );
+    //...................Main annealing loop...................
+    int k = 0;
+    for( ; k < parameters.maxSteps; ++k ){
+        //Get current temperature.
+        double f_T = temperature( k );
+        //Randomly searches for a neighboring state with respect to current state.
+        spectral::array L_wNew( L_wCurrent );
+        for( int i = 0; i < i_nPar; ++i ){ //for each parameter
+           //Ensures that the values randomly obtained are inside the domain.
+           double f_tmp = 0.0;
+           while( true ){
+              double LO = L_wCurrent[i] - (parameters.maxHopFactor * L_wDelta[i]);
+              double HI = L_wCurrent[i] + (parameters.maxHopFactor * L_wDelta[i]);
+              f_tmp = LO + std::rand() / (RAND_MAX/(HI-LO)) ;
+              if ( f_tmp >= wMin[i] && f_tmp <= wMax[i] )
+                 break;
+           }
+           //Updates the parameter value.
+           L_wNew[i] = f_tmp;
+        }
+        //Computes the “energy” of the neighboring state.
+        double f_eNew = evaluate( L_wNew );
+        //Changes states stochastically.  There is a probability of acceptance of a more energetic state so
+        //the optimization search starts near the global minimum and is not trapped in local minima (hopefully).
+        double f_probMov = probAcceptance( f_eCurrent, f_eNew, f_T );
+        if( f_probMov >= ( (double)std::rand() / RAND_MAX ) ) {//draws a value between 0.0 and 1.0
+            L_wCurrent = L_wNew; //replaces the current state with the neighboring random state
+            f_eCurrent = f_eNew;
+            //if the energy is the record low, store it, just in case the SA loop ends without converging.
+            if( f_eNew < f_lowestEnergyFound ){
+                f_lowestEnergyFound = f_eNew;
+                L_wOfLowestEnergyFound = L_wCurrent;
+            }
+        }
+        notifyProgress( "SA step #" + std::to_string( k ) + ": energy level " + std::to_string( f_eCurrent ),
+                        k, f_lowestEnergyFound );
+    }
+    // Delivers the set of parameters near the global minimum (hopefully) for the Gradient Descent algorithm.
+    // The SA loop may end in a higher energy state, so we return the lowest found in that case
+    notifyProgress( "SA completed. Using the state of lowest energy found (" + std::to_string( f_lowestEnergyFound ) + ").",
+                    k, f_lowestEnergyFound );
+    return L_wOfLowestEnergyFound;
+}
+
+spectral::array VariographicOptimizer::runGradientDescent( const spectral::array &initialParameters,
+                                                           const spectral::array &wMin,
+                                                           const spectral::array &wMax,
+                                                           const GradientDescentParameters &parameters ) const
+{
+    spectral::array vw( initialParameters );
+    double currentF = evaluate( vw );
+    //the candidates of the alpha reduction steps are evaluated in batches as large as the number of threads.
+    int alphaBatchSize = m_workspaces.size();
+    for( int iOptStep = 0; iOptStep < parameters.maxSteps; ++iOptStep ){
+
+        //Compute the gradient vector of objective function with the current [w] parameters.
+        spectral::array gradient = computeGradient( vw, parameters.epsilon );
+
+        //Update the system's parameters according to gradient descent.
+        //halves alpha until we get a descent (current gradient vector may result in overshooting)
+        double nextF = currentF;
+        bool descended = false;
+        double alpha = parameters.initialAlpha;
+        for( int iAlphaReductionStep = 0; iAlphaReductionStep < parameters.maxAlphaReductionSteps && ! descended; ){
+            std::vector< spectral::array > candidates;
+            for( ; iAlphaReductionStep < parameters.maxAlphaReductionSteps &&
+                   (int)candidates.size() < alphaBatchSize; ++iAlphaReductionStep, alpha /= 2.0 ){
+                spectral::array new_vw = vw - gradient * alpha;
+                //Impose domain constraints to the parameters.
+                for( int i = 0; i < new_vw.size(); ++i )
+                    new_vw[i] = std::min( std::max( new_vw[i], wMin[i] ), wMax[i] );
+                candidates.push_back( new_vw );
+            }
+            std::vector< double > fValues = evaluateBatch( candidates );
+            //take the first (largest alpha) candidate that descends
+            for( size_t iCandidate = 0; iCandidate < candidates.size(); ++iCandidate )
+                if( fValues[iCandidate] < currentF ){
+                    vw = candidates[iCandidate];
+                    nextF = fValues[iCandidate];
+                    descended = true;
+                    break;
+                }
+        }
+        if( ! descended ){
+            notifyProgress( "GD: reached maximum alpha reduction steps.", iOptStep, currentF );
+            break;
+        }
+
+        //Check the convergence criterion.
+        double ratio = currentF / nextF;
+        currentF = nextF;
+        notifyProgress( "GD step #" + std::to_string( iOptStep ) + ": F(k)/F(k+1) ratio: " + std::to_string( ratio ),
+                        iOptStep, currentF );
+        if( ratio < (1.0 + parameters.convergenceCriterion) )
+            break;
+    }
+    return vw;
+}
+
+spectral::array VariographicOptimizer::runLineSearchWithRestarts( const spectral::array &wMin,
+                                                                  const spectral::array &wMax,
+                                                                  const LineSearchWithRestartsParameters &parameters ) const
+{
+    int nParameters = getNumberOfParameters();
+    spectral::array L_wMin( wMin );
+    spectral::array L_wMax( wMax );
+    spectral::array L_wDelta = wMax - wMin;
+
+    //define the step as a function of iteration number (the alpha-k in Grosan and Abraham (2009))
+    //first iteration must be 1.
+    auto alpha_k = [=](int k) { return 2.0 + 3.0 / std::pow(2, k*k + 1); };
+
+    //the line search restarting loop
+    spectral::array vw_bestSolution( (spectral::index)nParameters );
+    for( int t = 0; t < parameters.nRestarts; ++t){
+
+        //generate sarting points randomly within the domain
+        std::vector< spectral::array > startingPoints;
+        for( int iSP = 0; iSP < parameters.nStartingPoints; ++iSP )
+            startingPoints.push_back( drawRandomPoint( L_wMin, L_wMax ) );
+        std::vector< double > fOfStartingPoints = evaluateBatch( startingPoints );
+
+        //----------------loop of line search algorithm----------------
+        double fOfBestSolution = std::numeric_limits<double>::max();
+        //for each step
+        for( int k = 1; k <= parameters.maxSteps; ++k ){
+            //make a candidate point for each starting point with a vector from the current point.
+            std::vector< spectral::array > candidates;
+            for( int i = 0; i < parameters.nStartingPoints; ++i ){
+                spectral::array vw_candidate( (spectral::index)nParameters );
+                for( int j = 0; j < nParameters; ++j ){
+                    double p_k = -1.0 + std::rand() / ( RAND_MAX / 2.0);//author suggests -1 or drawn from [0.0 1.0] for best results
+                    vw_candidate[j] = startingPoints[i][j] + p_k * L_wDelta[j] * alpha_k( k );
+                    if( vw_candidate[j] > L_wMax[j] )
+                        vw_candidate[j] = L_wMax[j];
+                    if( vw_candidate[j] < L_wMin[j] )
+                        vw_candidate[j] = L_wMin[j];
+                }
+                candidates.push_back( vw_candidate );
+            }
+            //evaluate the objective function for the candidate points
+            std::vector< double > fOfCandidates = evaluateBatch( candidates );
+            for( int i = 0; i < parameters.nStartingPoints; ++i ){
+                //if the candidate point improves the objective function...
+                if( fOfCandidates[i] < fOfStartingPoints[i] ){
+                    //...make it the current point.
+                    startingPoints[i] = candidates[i];
+                    fOfStartingPoints[i] = fOfCandidates[i];
+                    //keep track of the best solution
+                    if( fOfCandidates[i] < fOfBestSolution ){
+                        fOfBestSolution = fOfCandidates[i];
+                        vw_bestSolution = candidates[i];
+                    }
+                }
+            }
+            notifyProgress( "LSRS restart #" + std::to_string( t ) + ", step #" + std::to_string( k ),
+                            k, fOfBestSolution );
+        } // search for best solution
+        //---------------------------------------------------------------------------
+
+        //update the domain limits depending on the partial derivatives at the best solution
+        //this usually reduces the size of the domain so the next set of starting
+        //points have a higher probability to be drawn near a global optimum.
+        spectral::array gradient = computeGradient( vw_bestSolution, parameters.epsilon );
+        for( int iParameter = 0; iParameter < nParameters; ++iParameter ){
+            if( gradient[iParameter] > 0 )
+                L_wMax[ iParameter ] = vw_bestSolution[ iParameter ];
+            else if( gradient[iParameter] < 0 )
+                L_wMin[ iParameter ] = vw_bestSolution[ iParameter ];
+        }
+    } //restart loop
+    return vw_bestSolution;
+}
+
+spectral::array VariographicOptimizer::runParticleSwarm( const spectral::array &wMin,
+                                                         const spectral::array &wMax,
+                                                         const ParticleSwarmParameters &parameters ) const
+{
+    int nParticles = parameters.nParticles;
+
+    //Init the population of particles, their velocity vectors and their best position
+    std::vector< spectral::array > particles_pw;
+    std::vector< spectral::array > velocities_vw;
+    for( int iParticle = 0; iParticle < nParticles; ++iParticle ){
+        //create a particle with a random position in the domain.
+        particles_pw.push_back( drawRandomPoint( wMin, wMax ) );
+        //the velocities are initialized with zeros
+        velocities_vw.push_back( spectral::array( (spectral::index)getNumberOfParameters(), 0.0 ) );
+    }
+    //the best position of a particle is initialized as the starting position
+    std::vector< spectral::array > pbests_pbw( particles_pw );
+    std::vector< double > fOfParticles = evaluateBatch( particles_pw );
+    std::vector< double > fOfpbests( fOfParticles );
+
+    //Init the global best postion (best of the best positions amongst the particles)
+    int iBest = std::min_element( fOfpbests.begin(), fOfpbests.end() ) - fOfpbests.begin();
+    spectral::array gbest_pw = pbests_pbw[ iBest ];
+    double fOfgbest = fOfpbests[ iBest ];
+
+    //optimization steps
+    for( int iStep = 0; iStep < parameters.maxSteps; ++iStep){
+
+        //get a candidate position and velocity of each particle
+        std::vector< spectral::array > candidate_particles;
+        std::vector< spectral::array > candidate_velocities;
+        for( int iParticle = 0; iParticle < nParticles; ++iParticle ){
+            const spectral::array& pw = particles_pw[ iParticle ];
+            const spectral::array& vw = velocities_vw[ iParticle ];
+            const spectral::array& pbw = pbests_pbw[ iParticle ];
+
+            spectral::array candidate_particle( pw.size() );
+            spectral::array candidate_velocity( pw.size() );
+
+            double rand1 = (std::rand()/(double)RAND_MAX);
+            double rand2 = (std::rand()/(double)RAND_MAX);
+
+            for( int i = 0; i < pw.size(); ++i ){
+                candidate_velocity[i] = parameters.inertiaWeight * vw[i] +
+                                        parameters.accelerationConstant1 * rand1 * ( pbw[i] - pw[i] ) +
+                                        parameters.accelerationConstant2 * rand2 * ( gbest_pw[i] - pw[i] );
+                candidate_particle[i] = pw[i] + candidate_velocity[i];
+
+                //performs a "bounce" of the particle if it "hits" the boundaries of the domain
+                double overshoot = candidate_particle[i] - wMax[i];
+                if( overshoot > 0 )
+                    candidate_particle[i] = wMax[i] - overshoot;
+                double undershoot = wMin[i] - candidate_particle[i];
+                if( undershoot > 0 )
+                    candidate_particle[i] = wMin[i] + undershoot;
+            }
+            candidate_particles.push_back( candidate_particle );
+            candidate_velocities.push_back( candidate_velocity );
+        }
+
+        //evaluate the objective function for the candidate positions
+        std::vector< double > fOfCandidates = evaluateBatch( candidate_particles );
+
+        for( int iParticle = 0; iParticle < nParticles; ++iParticle ){
+            double fCandidate = fOfCandidates[ iParticle ];
+            //if the candidate position improves the objective function
+            if( fCandidate < fOfParticles[ iParticle ] ){
+                //update the postion and the velocity
+                particles_pw[ iParticle ] = candidate_particles[ iParticle ];
+                velocities_vw[ iParticle ] = candidate_velocities[ iParticle ];
+                fOfParticles[ iParticle ] = fCandidate;
+            }
+            //if the candidate position improves over the best of the particle
+            if( fCandidate < fOfpbests[iParticle] ){
+                fOfpbests[iParticle] = fCandidate;
+                pbests_pbw[ iParticle ] = candidate_particles[ iParticle ];
+            }
+            //if the candidate position improves over the global best
+            if( fCandidate < fOfgbest ){
+                fOfgbest = fCandidate;
+                gbest_pw = candidate_particles[ iParticle ];
+            }
+        }
+        notifyProgress( "PSO step #" + std::to_string( iStep ), iStep, fOfgbest );
+    } // for each step
+
+    return gbest_pw;
+}
+
+spectral::array VariographicOptimizer::runGeneticAlgorithm( const spectral::array &wMin,
+                                                            const spectral::array &wMax,
+                                                            const GeneticAlgorithmParameters &parameters ) const
+{
+    size_t nPopulationSize = parameters.populationSize;
+    size_t nSelectionSize = parameters.selectionSize;
+
+    //sanity checks
+    if( nSelectionSize >= nPopulationSize ||
+        nPopulationSize % 2 + nSelectionSize % 2 ||
+        parameters.pointOfCrossover >= getNumberOfParameters() ){
+        notifyProgress( "Genetic algorithm: selection pool size must be less than population size, sizes must be even numbers "
+                        "and the point of crossover must be less than the number of parameters.", 0,
+                        std::numeric_limits<double>::max() );
+        return spectral::array();
+    }
+
+    //the main algorithm loop
+    std::vector< Individual > population;
+    for( int iGen = 0; iGen < parameters.maxGenerations; ++iGen ){
+
+        //Init or refill the population with randomly generated individuals.
+        while( population.size() < nPopulationSize )
+            population.push_back( Individual( drawRandomPoint( wMin, wMax ) ) );
+
+        //evaluate the individuals of current population
+        evaluatePopulation( *this, population );
+
+        //sort the population in ascending order (lower value == better fitness)
+        std::sort( population.begin(), population.end() );
+
+        //clip the population (the excessive worst fit individuals die)
+        while( population.size() > nPopulationSize )
+            population.pop_back();
+
+        notifyProgress( "Genetic algorithm generation #" + std::to_string( iGen ), iGen, population.front().fValue );
+
+        //perform selection by binary tournament
+        std::vector< Individual > selection;
+        for( size_t iSel = 0; iSel < nSelectionSize; ++iSel ){
+            //draw two different individuals at random from the population for the tournament.
+            //(the indexes are drawn with the modulo, since scaling rand() by the last index almost never draws the last individual)
+            int tournCandidate1 = std::rand() % population.size();
+            int tournCandidate2 = tournCandidate1;
+            while( tournCandidate2 == tournCandidate1 )
+                tournCandidate2 = std::rand() % population.size();
+            //add the best of tournament to the selection pool
+            selection.push_back( std::min( population[tournCandidate1], population[tournCandidate2] ) );
+        }
+
+        //perform crossover and mutation on the selected individuals
+        std::vector< Individual > nextGen;
+        while( ! selection.empty() ){
+            //draw two different selected individuals at random for crossover.
+            int parentIndex1 = std::rand() % selection.size();
+            int parentIndex2 = parentIndex1;
+            while( parentIndex2 == parentIndex1 )
+                parentIndex2 = std::rand() % selection.size();
+            Individual parent1 = selection[ parentIndex1 ];
+            Individual parent2 = selection[ parentIndex2 ];
+            //remove the parents from the pool (the one with the greatest index first, so the other index remains valid)
+            selection.erase( selection.begin() + std::max( parentIndex1, parentIndex2 ) );
+            selection.erase( selection.begin() + std::min( parentIndex1, parentIndex2 ) );
+            //draw a value between 0.0 and 1.0 from an uniform distribution
+            double p = std::rand() / (double)RAND_MAX;
+            //if crossover is due...
+            if( p < parameters.probabilityOfCrossOver ){
+                //crossover
+                std::pair< Individual, Individual> offspring = parent1.crossOver( parent2, parameters.pointOfCrossover );
+                Individual child1 = offspring.first;
+                Individual child2 = offspring.second;
+                //mutate all
+                child1.mutate( parameters.mutationRate, wMin, wMax );
+                child2.mutate( parameters.mutationRate, wMin, wMax );
+                parent1.mutate( parameters.mutationRate, wMin, wMax );
+                parent2.mutate( parameters.mutationRate, wMin, wMax );
+                //add them to the next generation pool
+                nextGen.push_back( child1 );
+                nextGen.push_back( child2 );
+                nextGen.push_back( parent1 );
+                nextGen.push_back( parent2 );
+            } else { //no crossover took place
+                //simply mutate and insert the parents into the next generation pool
+                parent1.mutate( parameters.mutationRate, wMin, wMax );
+                parent2.mutate( parameters.mutationRate, wMin, wMax );
+                nextGen.push_back( parent1 );
+                nextGen.push_back( parent2 );
+            }
+        }
+
+        //make the next generation
+        population = nextGen;
+    } //main algorithm loop
+
+    if( population.empty() )
+        return drawRandomPoint( wMin, wMax );
+
+    //evaluate the individuals of final population
+    evaluatePopulation( *this, population );
+
+    //return the parameters of the best individual (set of parameters)
+    return std::min_element( population.begin(), population.end() )->parameters;
+}
+
+spectral::array VariographicOptimizer::runBruteForce( const spectral::array &wMin,
+                                                      const spectral::array &wMax,
+                                                      const BruteForceParameters &parameters ) const
+{
+    Solution bestSolution( getNumberOfParameters() );
+    for( int iStep = 0; iStep < parameters.maxSteps; ++iStep ){
+        //Init the randomly generated solutions within the domain.
+        std::vector< Solution > solutions;
+        while( (int)solutions.size() < parameters.populationSize )
+            solutions.push_back( Solution( drawRandomPoint( wMin, wMax ) ) );
+
+        //evaluate the solutions of current set
+        evaluatePopulation( *this, solutions );
+
+        //saves the best solution if it was improved
+        const Solution& bestOfStep = *std::min_element( solutions.begin(), solutions.end() );
+        if( bestOfStep.fValue < bestSolution.fValue )
+            bestSolution = bestOfStep;
+
+        notifyProgress( "Brute force step #" + std::to_string( iStep ), iStep, bestSolution.fValue );
+    }
+    return bestSolution.parameters;
+}
+
+void VariographicOptimizer::computeGeologicalFactors( const spectral::array &parameters,
+                                                      std::vector<spectral::array> &varmaps,
+                                                      std::vector<spectral::array> &geologicalFactors ) const
+{
+    int nParameters = IJVariographicStructure2D::getNumberOfParameters();
+    size_t nCells = m_cellDXs.size();
+    varmaps.clear();
+    geologicalFactors.clear();
+    for( int iGeoFactor = 0; iGeoFactor < m_m; ++iGeoFactor ) {
+        //compute the theoretical varmap for one geologic factor
+        spectral::array structureParameters( (spectral::index)nParameters );
+        for( int iPar = 0; iPar < nParameters; ++iPar )
+            structureParameters[iPar] = parameters[ iGeoFactor * nParameters + iPar ];
+        spectral::array geoFactorVarMap = computeVariographicSurface( structureParameters );
+
+        //compute FFT of the theoretical varmap
+        Workspace& workspace = m_workspaces.back();
+        spectral::array tmp = spectral::shiftByHalf( geoFactorVarMap );
+        std::copy( tmp.d_.begin(), tmp.d_.end(), workspace.realBuffer );
+        fftw_execute_dft_r2c( m_forwardPlan, workspace.realBuffer, workspace.spectrumBuffer );
+
+        //convert sqrt(varmap amplitudes) and the phases of the input to rectangular form
+        for( size_t i = 0; i < m_spectrumSize; ++i ){
+            fftw_complex& value = workspace.spectrumBuffer[i];
+            double amplitudeSQRT = std::sqrt( std::sqrt( value[0] * value[0] + value[1] * value[1] ) );
+            value[0] = amplitudeSQRT * m_inputPhaseCos[i];
+            value[1] = amplitudeSQRT * m_inputPhaseSin[i];
+        }
+
+        //compute the reverse FFT to get the geological factor
+        fftw_execute_dft_c2r( m_backwardPlan, workspace.spectrumBuffer, workspace.realBuffer );
+        spectral::array geoFactor( (spectral::index)m_nI, (spectral::index)m_nJ, (spectral::index)m_nK );
+        for( size_t i = 0; i < nCells; ++i )
+            geoFactor.d_[i] = workspace.realBuffer[i] / nCells; //fftw3's reverse FFT requires that the values of output be divided by the number of cells
+
+        varmaps.push_back( std::move( geoFactorVarMap ) );
+        geologicalFactors.push_back( std::move( geoFactor ) );
+    }
+}
+
+void VariographicOptimizer::parallelFor( int n, const std::function<void (int, int)> &job ) const
+{
+    if( n <= 0 )
+        return;
+    int iCallerWorkspace = m_workspaces.size() - 1;
+    //no need to wake the workers up for a single item or if there are no workers
+    if( m_workers.empty() || n == 1 ){
+        for( int i = 0; i < n; ++i )
+            job( i, iCallerWorkspace );
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lck( m_poolMutex );
+        m_job = &job;
+        m_jobSize = n;
+        m_nextJobItem = 0;
+        m_nBusyWorkers = m_workers.size();
+        ++m_jobGeneration;
+    }
+    m_poolWakeUp.notify_all();
+    //the calling thread also works
+    runJobItems( job, n, iCallerWorkspace );
+    //wait for the workers to finish their items
+    std::unique_lock<std::mutex> lck( m_poolMutex );
+    m_poolJobDone.wait( lck, [this]{ return m_nBusyWorkers == 0; } );
+    m_job = nullptr;
+}
+
+void VariographicOptimizer::workerLoop( int iWorkspace )
+{
+    unsigned int lastJobGeneration = 0;
+    while( true ){
+        const std::function<void( int, int )>* job;
+        int n;
+        {
+            std::unique_lock<std::mutex> lck( m_poolMutex );
+            m_poolWakeUp.wait( lck, [&]{ return m_stopWorkers || m_jobGeneration != lastJobGeneration; } );
+            if( m_stopWorkers )
+                return;
+            lastJobGeneration = m_jobGeneration;
+            job = m_job;
+            n = m_jobSize;
+        }
+        runJobItems( *job, n, iWorkspace );
+        {
+            std::unique_lock<std::mutex> lck( m_poolMutex );
+            if( --m_nBusyWorkers == 0 )
+                m_poolJobDone.notify_one();
+        }
+    }
+}
+
+void VariographicOptimizer::runJobItems( const std::function<void (int, int)> &job, int n, int iWorkspace ) const
+{
+    for( int i = m_nextJobItem++; i < n; i = m_nextJobItem++ )
+        job( i, iWorkspace );
+}
+
+spectral::array VariographicOptimizer::drawRandomPoint( const spectral::array &wMin, const spectral::array &wMax )
+{
+    spectral::array point( wMin.size() );
+    for( int i = 0; i < point.size(); ++i ){
+        double LO = wMin[i];
+        double HI = wMax[i];
+        point[i] = LO + std::rand() / (RAND_MAX/(HI-LO));
+    }
+    return point;
+}
+
+void VariographicOptimizer::notifyProgress( const std::string &message, int step, double bestObjectiveValue ) const
+{
+    if( m_progressListener )
+        m_progressListener( message, step, bestObjectiveValue );
+}
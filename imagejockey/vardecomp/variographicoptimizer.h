@@ -0,0 +1,262 @@
+#ifndef VARIOGRAPHICOPTIMIZER_H
+#define VARIOGRAPHICOPTIMIZER_H
+
+#include "spectral/spectral.h"
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+class IJAbstractCartesianGrid;
+
+/** The objective functions available to fit the variographic structures. */
+enum class VariographicObjective : int {
+    VARMAP_FITTING,           //!< Mean absolute difference between the varmap of the input and the variogram model surface (direct fitting).
+    FOURIER_INTEGRAL_FITTING  //!< Sum of absolute differences between the input and the map obtained from the variogram model
+                              //!< with the Fourier Integral Method (indirect fitting).
+};
+
+/** The domain of the parameters of each variographic structure. */
+struct VariographicParametersDomain {
+    double minAxis, maxAxis;
+    double minRatio, maxRatio;
+    double minAzimuth, maxAzimuth;
+    double minContribution, maxContribution;
+};
+
+struct SimulatedAnnealingParameters {
+    double initialTemperature;
+    double finalTemperature;
+    int maxSteps;
+    /** Maximum random "hop" as a fraction of the domain size. */
+    double maxHopFactor;
+};
+
+struct GradientDescentParameters {
+    int maxSteps;
+    /** The epsilon for the numerical partial derivatives. */
+    double epsilon;
+    double initialAlpha;
+    int maxAlphaReductionSteps;
+    /** The optimization stops when F(k)/F(k+1) is less than 1.0 + convergenceCriterion. */
+    double convergenceCriterion;
+};
+
+struct LineSearchWithRestartsParameters {
+    int maxSteps;
+    int nStartingPoints;
+    int nRestarts;
+    /** The epsilon for the numerical partial derivatives. */
+    double epsilon;
+};
+
+struct ParticleSwarmParameters {
+    int maxSteps;
+    int nParticles;
+    double inertiaWeight;
+    double accelerationConstant1;
+    double accelerationConstant2;
+};
+
+struct GeneticAlgorithmParameters {
+    int maxGenerations;
+    /** Number of individuals.  Must be an even number. */
+    int populationSize;
+    /** Size of the selection pool.  Must be an even number less than populationSize. */
+    int selectionSize;
+    double probabilityOfCrossOver;
+    /** The parameter index where crossover switches.  Must be less than the number of parameters. */
+    int pointOfCrossover;
+    /** How many parameters are expected to change per mutation.  0.0 means no mutation. */
+    double mutationRate;
+};
+
+struct BruteForceParameters {
+    int maxSteps;
+    /** Number of random solutions evaluated per step. */
+    int populationSize;
+};
+
+/**
+ * The VariographicOptimizer class is the headless engine of the Variographic Decomposition: it fits m
+ * variographic structures (spheric model) to a gridded input data by minimizing one of the objective functions in
+ * VariographicObjective with several optimization algorithms.  It does not depend on GUI objects, so decompositions can
+ * be scripted and benchmarked without VariographicDecompositionDialog.
+ *
+ * The parameters vector is [w]=[axis0,ratio0,az0,cc0,axis1,ratio1,...] (see IJVariographicStructure2D).
+ *
+ * The costly setup is done only once in the constructor and reused by every objective function evaluation: the
+ * varmap of the input, the phases of the input's Fourier transform, the cell offsets to the grid center and the
+ * FFTW plans.  The objective function is evaluated in batches (e.g. all the 2n shifted parameter vectors of a numerical
+ * gradient or all the individuals of a population) by a pool of threads that lives as long as the optimizer object.
+ *
+ * The random numbers are drawn from std::rand(), so std::srand() can be used to seed the optimizations.
+ */
+class VariographicOptimizer
+{
+public:
+    /** Signature of functions that receive progress notifications: a message, the current step and the
+     * best objective function value found so far. */
+    typedef std::function<void( const std::string& message, int step, double bestObjectiveValue )> ProgressListener;
+
+    /**
+     * @param gridWithGeometry The grid whose geometry is used to compute the variogram model surfaces.  It is
+     *                         only used in the constructor.
+     * @param inputData The input data, whose dimensions must match those of gridWithGeometry.
+     * @param m The number of variographic structures (geological factors).
+     * @param nThreads Number of threads used to evaluate the objective function.  Zero means the number of logical processors.
+     */
+    VariographicOptimizer( const IJAbstractCartesianGrid& gridWithGeometry,
+                           const spectral::array& inputData,
+                           int m,
+                           unsigned int nThreads = 0 );
+    ~VariographicOptimizer();
+
+    VariographicOptimizer( const VariographicOptimizer& ) = delete;
+    VariographicOptimizer& operator=( const VariographicOptimizer& ) = delete;
+
+    /** Sets the objective function minimized by the optimization algorithms. Default is FOURIER_INTEGRAL_FITTING. */
+    void setObjective( VariographicObjective objective ) { m_objective = objective; }
+    VariographicObjective getObjective() const { return m_objective; }
+
+    /** Sets a function to be called with progress information during the optimizations (e.g. to log or to update a GUI). */
+    void setProgressListener( ProgressListener listener ) { m_progressListener = listener; }
+
+    /** Returns the number of free parameters (m times the number of parameters of a variographic structure). */
+    int getNumberOfParameters() const;
+
+    /** Returns the input data. */
+    const spectral::array& getInputData() const { return m_inputData; }
+
+    /** Returns the varmap of the input data with h=0 at the center of the grid. */
+    const spectral::array& getInputVarmap() const { return m_inputVarmap; }
+
+    /** Fills the vectors of lower and upper bounds of the parameters from the given domain. */
+    void makeBounds( const VariographicParametersDomain& domain, spectral::array& wMin, spectral::array& wMax ) const;
+
+    /** Returns the variogram model surface (varmap-like, with h=0 at the center and the values inverted) of the given
+     * parameters. */
+    spectral::array computeVariographicSurface( const spectral::array& parameters ) const;
+
+    /** Evaluates the objective function for one parameters vector. */
+    double evaluate( const spectral::array& parameters ) const;
+
+    /** Evaluates the objective function for many parameters vectors in parallel. */
+    std::vector<double> evaluateBatch( const std::vector<spectral::array>& parameters ) const;
+
+    /** Computes the gradient of the objective function with central differences.  The 2n objective
+     * function evaluations are done as one batch. */
+    spectral::array computeGradient( const spectral::array& parameters, double epsilon ) const;
+
+    /** Minimizes the objective function with Simulated Annealing.  Returns the state of lowest energy found. */
+    spectral::array runSimulatedAnnealing( const spectral::array& initialParameters,
+                                           const spectral::array& wMin,
+                                           const spectral::array& wMax,
+                                           const SimulatedAnnealingParameters& parameters ) const;
+
+    /** Minimizes the objective function with Gradient Descent.  The parameters are clamped to [wMin, wMax]. */
+    spectral::array runGradientDescent( const spectral::array& initialParameters,
+                                        const spectral::array& wMin,
+                                        const spectral::array& wMax,
+                                        const GradientDescentParameters& parameters ) const;
+
+    /** Minimizes the objective function with the line search with restarts proposed by Grosan and Abraham (2009):
+     * A Novel Global Optimization Technique for High Dimensional Functions. */
+    spectral::array runLineSearchWithRestarts( const spectral::array& wMin,
+                                               const spectral::array& wMax,
+                                               const LineSearchWithRestartsParameters& parameters ) const;
+
+    /** Minimizes the objective function with (synchronous) Particle Swarm Optimization: all particles of a step are
+     * evaluated as one batch and the global best is updated at the end of the step. */
+    spectral::array runParticleSwarm( const spectral::array& wMin,
+                                      const spectral::array& wMax,
+                                      const ParticleSwarmParameters& parameters ) const;
+
+    /** Minimizes the objective function with a Genetic Algorithm (binary tournament selection).
+     * Returns an empty array if the parameters are inconsistent. */
+    spectral::array runGeneticAlgorithm( const spectral::array& wMin,
+                                         const spectral::array& wMax,
+                                         const GeneticAlgorithmParameters& parameters ) const;
+
+    /** Minimizes the objective function by evaluating random solutions. */
+    spectral::array runBruteForce( const spectral::array& wMin,
+                                   const spectral::array& wMax,
+                                   const BruteForceParameters& parameters ) const;
+
+    /**
+     * Applies the principle of the Fourier Integral Method to get the geological factors: for each variographic
+     * structure, the square root of the amplitudes of the Fourier transform of its variogram model surface is combined
+     * with the phases of the Fourier transform of the input to make a Factorial Kriging-like separation.
+     * @param varmaps Output: the variogram model surface of each structure.
+     * @param geologicalFactors Output: the geological factor of each structure.
+     */
+    void computeGeologicalFactors( const spectral::array& parameters,
+                                   std::vector<spectral::array>& varmaps,
+                                   std::vector<spectral::array>& geologicalFactors ) const;
+
+private:
+    /** Buffers used by one thread to evaluate the objective function. */
+    struct Workspace {
+        spectral::array surface;
+        double* realBuffer;
+        fftw_complex* spectrumBuffer;
+    };
+
+    int m_m;
+    int m_nI, m_nJ, m_nK;
+    VariographicObjective m_objective;
+    ProgressListener m_progressListener;
+
+    spectral::array m_inputData;
+    spectral::array m_inputVarmap;
+    /** The cell center offsets to the grid center (same layout of spectral::array). */
+    std::vector<double> m_cellDXs, m_cellDYs;
+    /** Cosines and sines of the phases of the input's Fourier transform (half-spectrum of the r2c transform). */
+    std::vector<double> m_inputPhaseCos, m_inputPhaseSin;
+    size_t m_spectrumSize;
+
+    fftw_plan m_forwardPlan;
+    fftw_plan m_backwardPlan;
+
+    /** One workspace per thread (the calling thread uses the last one). */
+    mutable std::vector<Workspace> m_workspaces;
+
+    //------------------------------the persistent worker pool---------------------------
+    std::vector<std::thread> m_workers;
+    mutable std::mutex m_poolMutex;
+    mutable std::condition_variable m_poolWakeUp;
+    mutable std::condition_variable m_poolJobDone;
+    mutable const std::function<void( int, int )>* m_job; //job( index of item, index of workspace )
+    mutable int m_jobSize;
+    mutable std::atomic<int> m_nextJobItem;
+    mutable int m_nBusyWorkers;
+    mutable unsigned int m_jobGeneration;
+    bool m_stopWorkers;
+
+    /** Runs job(i, iWorkspace) for i in [0, n) with the worker threads and the calling thread. */
+    void parallelFor( int n, const std::function<void( int, int )>& job ) const;
+
+    /** The loop of the worker threads. */
+    void workerLoop( int iWorkspace );
+
+    /** Runs the items of the current job until there are no more items. */
+    void runJobItems( const std::function<void( int, int )>& job, int n, int iWorkspace ) const;
+    //------------------------------------------------------------------------------------
+
+    /** Computes the variogram model surface into the given array (which must be zeroed). */
+    void computeVariographicSurface( const spectral::array& parameters, spectral::array& surface ) const;
+
+    /** Evaluates the objective function with the buffers of the given workspace. */
+    double evaluate( const spectral::array& parameters, Workspace& workspace ) const;
+
+    /** Returns a random point uniformly distributed in [wMin, wMax]. */
+    static spectral::array drawRandomPoint( const spectral::array& wMin, const spectral::array& wMax );
+
+    void notifyProgress( const std::string& message, int step, double bestObjectiveValue ) const;
+};
+
+#endif // VARIOGRAPHICOPTIMIZER_H
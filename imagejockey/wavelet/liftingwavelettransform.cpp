@@ -0,0 +1,304 @@
+#include "liftingwavelettransform.h"
+#include "util.h"
+#include <cmath>
+#include <thread>
+#include <algorithm>
+
+namespace {
+
+/** Returns the position of a cell in a line of n cells with whole-sample symmetric extension at both ends
+ * (e.g. -1 -> 1 and n -> n-2).  This preserves the parity of the position, so an even (odd) position is
+ * always mapped to an even (odd) cell. */
+inline spectral::index reflect( spectral::index position, spectral::index n ){
+    if( position < 0 )
+        return -position;
+    if( position > n - 1 )
+        return 2 * ( n - 1 ) - position;
+    return position;
+}
+
+} //namespace
+
+/** The code for multithreaded transform of lines *////////////////////////
+void taskTransformLines( const LiftingWaveletTransform& transform,
+                         spectral::array& data, int axis,
+                         const spectral::index* regionSizes,
+                         int lineLevels, bool isInverse,
+                         spectral::index iFirstLine, spectral::index iLastLine ){
+    const spectral::index strides[3] = { data.N() * data.K(), data.K(), 1 };
+    //the two axes other than the transformed one
+    const int axisA = ( axis == 0 ) ? 1 : 0;
+    const int axisB = ( axis == 2 ) ? 1 : 2;
+    std::vector<spectral::index> lowPassSizes = LiftingWaveletTransform::getLowPassSizes( regionSizes[axis], lineLevels );
+    std::vector<double> workspace;
+    for( spectral::index iLine = iFirstLine; iLine <= iLastLine; ++iLine ){
+        spectral::index a = iLine / regionSizes[axisB];
+        spectral::index b = iLine % regionSizes[axisB];
+        double* line = data.data().data() + a * strides[axisA] + b * strides[axisB];
+        if( ! isInverse ){
+            for( int iLevel = 0; iLevel < lineLevels; ++iLevel )
+                transform.transformLine( line, lowPassSizes[iLevel], strides[axis], false, workspace );
+        } else {
+            for( int iLevel = lineLevels - 1; iLevel >= 0; --iLevel )
+                transform.transformLine( line, lowPassSizes[iLevel], strides[axis], true, workspace );
+        }
+    }
+}
+///////////////////////////////////////////////////////////////////////////////
+
+LiftingWaveletTransform::LiftingWaveletTransform(LiftingWaveletKernel kernel, unsigned int nThreads) :
+    m_evenScale( 1.0 ),
+    m_oddScale( 1.0 ),
+    m_nThreads( nThreads )
+{
+    if( m_nThreads == 0 )
+        m_nThreads = std::max( 1u, std::thread::hardware_concurrency() );
+
+    const double SQRT2 = std::sqrt( 2.0 );
+    const double SQRT3 = std::sqrt( 3.0 );
+    switch ( kernel ) {
+    case LiftingWaveletKernel::HAAR:
+        m_steps.push_back( { true,  -1.0, 0.0, 0, 0 } );
+        m_steps.push_back( { false,  0.5, 0.0, 0, 0 } );
+        m_evenScale = SQRT2;
+        m_oddScale = 1.0 / SQRT2;
+        break;
+    case LiftingWaveletKernel::DAUBECHIES_4:
+        //factorization from Daubechies and Sweldens (1998), "Factoring wavelet transforms into lifting steps".
+        m_steps.push_back( { true,  -SQRT3,                        0.0, 0,  0 } );
+        m_steps.push_back( { false,  SQRT3 / 4.0, ( SQRT3 - 2.0 ) / 4.0, 0, -1 } );
+        m_steps.push_back( { true,   1.0,                          0.0, 1,  0 } );
+        m_evenScale = ( SQRT3 + 1.0 ) / SQRT2;
+        m_oddScale  = ( SQRT3 - 1.0 ) / SQRT2;
+        break;
+    case LiftingWaveletKernel::CDF_5_3:
+        m_steps.push_back( { true,  -0.5,  -0.5,  0, 1 } );
+        m_steps.push_back( { false,  0.25,  0.25, -1, 0 } );
+        m_evenScale = SQRT2;
+        m_oddScale = 1.0 / SQRT2;
+        break;
+    case LiftingWaveletKernel::CDF_9_7:
+    {
+        const double ALPHA = -1.586134342059924;
+        const double BETA  = -0.052980118572961;
+        const double GAMMA =  0.882911075530934;
+        const double DELTA =  0.443506852043971;
+        const double K     =  1.149604398860241;
+        m_steps.push_back( { true,  ALPHA, ALPHA,  0, 1 } );
+        m_steps.push_back( { false, BETA,  BETA,  -1, 0 } );
+        m_steps.push_back( { true,  GAMMA, GAMMA,  0, 1 } );
+        m_steps.push_back( { false, DELTA, DELTA, -1, 0 } );
+        m_evenScale = K;
+        m_oddScale = 1.0 / K;
+        break;
+    }
+    }
+}
+
+void LiftingWaveletTransform::transformLine(double *line, spectral::index n, spectral::index stride,
+                                            bool isInverse, std::vector<double> &workspace) const
+{
+    //a single cell is its own smooth part
+    if( n < 2 )
+        return;
+
+    //split the line into its polyphase parts: the even cells (low-pass part) go to the first half of
+    //the workspace and the odd cells (high-pass part) to the second half.
+    spectral::index nEven = ( n + 1 ) / 2;
+    spectral::index nOdd = n / 2;
+    workspace.resize( n );
+    double* even = workspace.data();
+    double* odd = even + nEven;
+    if( ! isInverse ){
+        for( spectral::index i = 0; i < nEven; ++i )
+            even[i] = line[ 2 * i * stride ];
+        for( spectral::index i = 0; i < nOdd; ++i )
+            odd[i] = line[ ( 2 * i + 1 ) * stride ];
+    } else {
+        //the coefficients are in pyramidal layout: low-pass part followed by the high-pass part
+        for( spectral::index i = 0; i < n; ++i )
+            workspace[i] = line[ i * stride ];
+        for( spectral::index i = 0; i < nEven; ++i )
+            even[i] /= m_evenScale;
+        for( spectral::index i = 0; i < nOdd; ++i )
+            odd[i] /= m_oddScale;
+    }
+
+    //apply the lifting steps (in reverse order and with the opposite sign for the inverse transform).
+    //the neighbor positions are computed in the interleaved line, so the symmetric extension is correct
+    //for both parts.
+    int nSteps = m_steps.size();
+    for( int iStepCount = 0; iStepCount < nSteps; ++iStepCount ){
+        const LiftingStep& step = m_steps[ isInverse ? nSteps - 1 - iStepCount : iStepCount ];
+        double sign = isInverse ? -1.0 : 1.0;
+        if( step.updatesOdd ){
+            for( spectral::index i = 0; i < nOdd; ++i ){
+                spectral::index pos0 = reflect( 2 * ( i + step.offset0 ), n );
+                spectral::index pos1 = reflect( 2 * ( i + step.offset1 ), n );
+                odd[i] += sign * ( step.w0 * even[ pos0 / 2 ] + step.w1 * even[ pos1 / 2 ] );
+            }
+        } else {
+            for( spectral::index i = 0; i < nEven; ++i ){
+                spectral::index pos0 = reflect( 2 * ( i + step.offset0 ) + 1, n );
+                spectral::index pos1 = reflect( 2 * ( i + step.offset1 ) + 1, n );
+                even[i] += sign * ( step.w0 * odd[ pos0 / 2 ] + step.w1 * odd[ pos1 / 2 ] );
+            }
+        }
+    }
+
+    //write the result back to the line
+    if( ! isInverse ){
+        for( spectral::index i = 0; i < nEven; ++i )
+            line[ i * stride ] = even[i] * m_evenScale;
+        for( spectral::index i = 0; i < nOdd; ++i )
+            line[ ( nEven + i ) * stride ] = odd[i] * m_oddScale;
+    } else {
+        for( spectral::index i = 0; i < nEven; ++i )
+            line[ 2 * i * stride ] = even[i];
+        for( spectral::index i = 0; i < nOdd; ++i )
+            line[ ( 2 * i + 1 ) * stride ] = odd[i];
+    }
+}
+
+void LiftingWaveletTransform::transformAxis(spectral::array &data, int axis, const spectral::index regionSizes[],
+                                            int lineLevels, bool isInverse) const
+{
+    if( regionSizes[axis] < 2 || lineLevels < 1 )
+        return;
+
+    const int axisA = ( axis == 0 ) ? 1 : 0;
+    const int axisB = ( axis == 2 ) ? 1 : 2;
+    spectral::index nLines = regionSizes[axisA] * regionSizes[axisB];
+
+    unsigned int nThreads = std::max<spectral::index>( 1, std::min<spectral::index>( m_nThreads, nLines ) );
+    std::vector< std::pair< int, int > > lineRanges = Util::generateSubRanges( 0, nLines - 1, nThreads );
+    std::thread threads[nThreads];
+    for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+        threads[iThread] = std::thread( taskTransformLines,
+                                        std::cref( *this ),
+                                        std::ref( data ),
+                                        axis,
+                                        regionSizes,
+                                        lineLevels,
+                                        isInverse,
+                                        lineRanges[iThread].first,
+                                        lineRanges[iThread].second );
+    for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+        threads[iThread].join();
+}
+
+void LiftingWaveletTransform::forward(spectral::array &data, int nLevels, bool interleaved) const
+{
+    if( nLevels < 0 )
+        nLevels = getMaxLevels( data );
+    const spectral::index sizes[3] = { data.M(), data.N(), data.K() };
+
+    if( interleaved ){
+        //each level transforms the smooth part left by the previous level along all axes
+        std::vector<spectral::index> lowPassSizes[3];
+        for( int axis = 0; axis < 3; ++axis )
+            lowPassSizes[axis] = getLowPassSizes( sizes[axis], nLevels );
+        for( int iLevel = 0; iLevel < nLevels; ++iLevel ){
+            const spectral::index regionSizes[3] = { lowPassSizes[0][iLevel],
+                                                     lowPassSizes[1][iLevel],
+                                                     lowPassSizes[2][iLevel] };
+            for( int axis = 0; axis < 3; ++axis )
+                transformAxis( data, axis, regionSizes, 1, false );
+        }
+    } else {
+        //the full multi-level transform along one axis, then along the next
+        for( int axis = 0; axis < 3; ++axis )
+            transformAxis( data, axis, sizes, nLevels, false );
+    }
+}
+
+void LiftingWaveletTransform::inverse(spectral::array &coefficients, int nLevels, bool interleaved) const
+{
+    if( nLevels < 0 )
+        nLevels = getMaxLevels( coefficients );
+    const spectral::index sizes[3] = { coefficients.M(), coefficients.N(), coefficients.K() };
+
+    if( interleaved ){
+        std::vector<spectral::index> lowPassSizes[3];
+        for( int axis = 0; axis < 3; ++axis )
+            lowPassSizes[axis] = getLowPassSizes( sizes[axis], nLevels );
+        for( int iLevel = nLevels - 1; iLevel >= 0; --iLevel ){
+            const spectral::index regionSizes[3] = { lowPassSizes[0][iLevel],
+                                                     lowPassSizes[1][iLevel],
+                                                     lowPassSizes[2][iLevel] };
+            for( int axis = 2; axis >= 0; --axis )
+                transformAxis( coefficients, axis, regionSizes, 1, true );
+        }
+    } else {
+        for( int axis = 2; axis >= 0; --axis )
+            transformAxis( coefficients, axis, sizes, nLevels, true );
+    }
+}
+
+void LiftingWaveletTransform::inverseBandLimited(spectral::array &coefficients,
+                                                 int nLevels,
+                                                 bool interleaved,
+                                                 int minLevel,
+                                                 int maxLevel,
+                                                 bool keepSmooth) const
+{
+    if( nLevels < 0 )
+        nLevels = getMaxLevels( coefficients );
+    limitBand( coefficients, nLevels, minLevel, maxLevel, keepSmooth );
+    inverse( coefficients, nLevels, interleaved );
+}
+
+void LiftingWaveletTransform::limitBand(spectral::array &coefficients,
+                                        int nLevels,
+                                        int minLevel,
+                                        int maxLevel,
+                                        bool keepSmooth)
+{
+    std::vector<spectral::index> lowPassSizesI = getLowPassSizes( coefficients.M(), nLevels );
+    std::vector<spectral::index> lowPassSizesJ = getLowPassSizes( coefficients.N(), nLevels );
+    std::vector<spectral::index> lowPassSizesK = getLowPassSizes( coefficients.K(), nLevels );
+
+    for( spectral::index i = 0; i < coefficients.M(); ++i ){
+        int levelI = getLevel( i, lowPassSizesI );
+        for( spectral::index j = 0; j < coefficients.N(); ++j ){
+            int levelJ = getLevel( j, lowPassSizesJ );
+            for( spectral::index k = 0; k < coefficients.K(); ++k ){
+                int level = std::max( { levelI, levelJ, getLevel( k, lowPassSizesK ) } );
+                bool keep = ( level < 0 ) ? keepSmooth : ( level >= minLevel && level <= maxLevel );
+                if( ! keep )
+                    coefficients( i, j, k ) = 0.0;
+            }
+        }
+    }
+}
+
+int LiftingWaveletTransform::getMaxLevels(const spectral::array &data)
+{
+    spectral::index minSize = 0;
+    for( spectral::index size : { data.M(), data.N(), data.K() } )
+        if( size > 1 && ( minSize == 0 || size < minSize ) )
+            minSize = size;
+    int nLevels = 0;
+    for( spectral::index size = minSize; size > 1; size = ( size + 1 ) / 2 )
+        ++nLevels;
+    return nLevels;
+}
+
+std::vector<spectral::index> LiftingWaveletTransform::getLowPassSizes(spectral::index n, int nLevels)
+{
+    std::vector<spectral::index> result( nLevels + 1 );
+    result[0] = n;
+    for( int iLevel = 1; iLevel <= nLevels; ++iLevel )
+        result[iLevel] = ( result[iLevel-1] + 1 ) / 2;
+    return result;
+}
+
+int LiftingWaveletTransform::getLevel(spectral::index position, const std::vector<spectral::index> &lowPassSizes)
+{
+    int nLevels = lowPassSizes.size() - 1;
+    //the coarsest level is the closest to the smooth part (top-left corner).
+    for( int iLevel = nLevels; iLevel >= 1; --iLevel )
+        if( position < lowPassSizes[iLevel] )
+            return nLevels - iLevel - 1;
+    return nLevels - 1;
+}
@@ -0,0 +1,114 @@
+#ifndef LIFTINGWAVELETTRANSFORM_H
+#define LIFTINGWAVELETTRANSFORM_H
+
+#include "spectral/spectral.h"
+#include <vector>
+
+/** The wavelets implemented with the lifting scheme in LiftingWaveletTransform. */
+enum class LiftingWaveletKernel : int {
+    HAAR,           //!< Haar wavelet (orthonormal).
+    DAUBECHIES_4,   //!< Daubechies wavelet with 4 coefficients (orthonormal).
+    CDF_5_3,        //!< Cohen-Daubechies-Feauveau 5/3 (LeGall) biorthogonal wavelet, the same of the B-Spline (2,2).
+    CDF_9_7         //!< Cohen-Daubechies-Feauveau 9/7 biorthogonal wavelet (the one of JPEG 2000).
+};
+
+/**
+ * The LiftingWaveletTransform class performs multi-level Discrete Wavelet Transforms of 1D, 2D and 3D
+ * spectral::array objects of any size.  Unlike GSL's DWT (see WaveletUtils), there is no need to pad the data
+ * to a square grid with power-of-two dimensions: the wavelets are factored into lifting steps (Sweldens, 1996),
+ * which are applied in place to each line of cells along each axis, with symmetric extension at the borders,
+ * so lines of odd lengths are supported.  The lines along an axis are transformed in parallel.
+ *
+ * The coefficients are stored in the same cells of the input data in the usual pyramidal layout: at each level, the
+ * low-pass (smooth) part of a line is moved to its first ceil(n/2) cells and the high-pass (detail) part is moved to
+ * the remaining floor(n/2) cells.  The next level transforms only the low-pass part.  For power-of-two square grids,
+ * this is the same layout of GSL's 2D DWT, so level 0 is the coarsest detail level and level nLevels-1 is the finest.
+ */
+class LiftingWaveletTransform
+{
+public:
+    /**
+     * @param kernel The wavelet.
+     * @param nThreads Number of threads used to transform the lines of cells.  Zero means the number of logical processors.
+     */
+    LiftingWaveletTransform( LiftingWaveletKernel kernel, unsigned int nThreads = 0 );
+
+    /**
+     * Performs the forward transform in place.
+     * @param nLevels Number of decomposition levels.  Negative values mean the maximum (see getMaxLevels()).
+     * @param interleaved If true, each level transforms all axes before the next level (non-standard or Mallat
+     *                    decomposition), otherwise, the full multi-level transform is performed along one axis
+     *                    then along the next (standard decomposition).
+     */
+    void forward( spectral::array& data, int nLevels = -1, bool interleaved = true ) const;
+
+    /** Performs the inverse transform in place.  The parameters must be the same used in forward(). */
+    void inverse( spectral::array& coefficients, int nLevels = -1, bool interleaved = true ) const;
+
+    /**
+     * Performs a band-limited reconstruction in place: the detail coefficients of the levels outside
+     * [minLevel, maxLevel] are zeroed out before the inverse transform.
+     * @param keepSmooth If false, the coarsest smooth coefficients are also zeroed out.
+     */
+    void inverseBandLimited( spectral::array& coefficients,
+                             int nLevels,
+                             bool interleaved,
+                             int minLevel,
+                             int maxLevel,
+                             bool keepSmooth = true ) const;
+
+    /** Zeroes out the detail coefficients of the levels outside [minLevel, maxLevel] (and the coarsest smooth
+     * coefficients if keepSmooth is false).  The level of a coefficient is the finest level among its axes.
+     * This also applies to the coefficients of GSL's DWT, which have the same layout. */
+    static void limitBand( spectral::array& coefficients,
+                           int nLevels,
+                           int minLevel,
+                           int maxLevel,
+                           bool keepSmooth = true );
+
+    /** Returns the maximum number of decomposition levels for the given array, that is, the number of
+     * times its smallest axis (ignoring axes with one cell) can be halved until it has one cell. */
+    static int getMaxLevels( const spectral::array& data );
+
+    /** Returns the sizes of the low-pass part of an axis with n cells after each level (element 0 is n itself,
+     * element nLevels is the size of the coarsest smooth part).  Sizes stop decreasing at one cell. */
+    static std::vector<spectral::index> getLowPassSizes( spectral::index n, int nLevels );
+
+    /** Returns the level (0 = coarsest) of the coefficient at the given position along an axis, or -1 if it is
+     * in the coarsest smooth part.
+     * @param lowPassSizes The result of getLowPassSizes() for the axis. */
+    static int getLevel( spectral::index position, const std::vector<spectral::index>& lowPassSizes );
+
+private:
+    /** A lifting step: the cells of one polyphase part (even or odd cells) are updated with a weighted sum of
+     * two neighbors from the other part. */
+    struct LiftingStep {
+        bool updatesOdd;     //!< true: odd[n] += w0 * even[n + offset0] + w1 * even[n + offset1] (a.k.a. predict step);
+                             //!< false: even[n] += w0 * odd[n + offset0] + w1 * odd[n + offset1] (a.k.a. update step).
+        double w0, w1;
+        int offset0, offset1;
+    };
+
+    std::vector<LiftingStep> m_steps;
+    double m_evenScale;  //!< Scaling applied to the low-pass part after the lifting steps.
+    double m_oddScale;   //!< Scaling applied to the high-pass part after the lifting steps.
+    unsigned int m_nThreads;
+
+    /** Transforms one line of n cells stored with the given stride (forward or inverse). */
+    void transformLine( double* line, spectral::index n, spectral::index stride, bool isInverse,
+                        std::vector<double>& workspace ) const;
+
+    /** Transforms (forward or inverse) all lines along the given axis (0, 1 or 2) in the sub-array
+     * [0, regionSizes[0]) x [0, regionSizes[1]) x [0, regionSizes[2]).  Each line is transformed with
+     * lineLevels levels. */
+    void transformAxis( spectral::array& data, int axis, const spectral::index regionSizes[3],
+                        int lineLevels, bool isInverse ) const;
+
+    friend void taskTransformLines( const LiftingWaveletTransform& transform,
+                                    spectral::array& data, int axis,
+                                    const spectral::index* regionSizes,
+                                    int lineLevels, bool isInverse,
+                                    spectral::index iFirstLine, spectral::index iLastLine );
+};
+
+#endif // LIFTINGWAVELETTRANSFORM_H
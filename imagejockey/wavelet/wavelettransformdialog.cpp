@@ -140,6 +140,8 @@ WaveletFamily WaveletTransformDialog::getSelectedWaveletFamily()
         waveletFamily = WaveletFamily::HAAR;
     } else if( waveletFamilyName == "B-Spline" ){
         waveletFamily = WaveletFamily::B_SPLINE;
+    } else if( waveletFamilyName == "CDF 9/7" ){
+        waveletFamily = WaveletFamily::CDF_9_7;
     } else {
         QMessageBox::critical( this, "Error", QString("WaveletTransformDialog::getSelectedWaveletFamily(): Unknown wavelet family: " + waveletFamilyName));
     }
@@ -170,8 +172,8 @@ void WaveletTransformDialog::onPerformTransform()
     ui->txtThresholdMin2->setText( "0.0" );
     ui->txtThresholdMax2->setText( QString::number( m_DWTbuffer.max() ) );
 
-    // determine the number of levels (assumes the DWT transform is square).
-    int numberOfLevels = std::log2( m_DWTbuffer.M() );
+    // determine the number of levels.
+    int numberOfLevels = WaveletUtils::getNumberOfLevels( m_DWTbuffer );
 
     // reconfigure the level spin boxes accoring to the number of levels.
     ui->spinLevelMin->setMinimum( 0 );
@@ -213,6 +215,11 @@ void WaveletTransformDialog::onWaveletFamilySelected( QString waveletFamilyName
         ui->cmbWaveletType->addItem( "i=3, j=9", QVariant( 309 ));
         return;
     }
+    if( waveletFamilyName == "CDF 9/7" ){
+        //this wavelet is not in GSL, it is computed only with the lifting scheme (see WaveletUtils::getLiftingKernel())
+        ui->cmbWaveletType->addItem( "9/7", QVariant( 907 ));
+        return;
+    }
     QMessageBox::critical( this, "Error", QString("WaveletTransformDialog::onWaveletFamilySelected(): Unknown wavelet family: " + waveletFamilyName));
 }
 
@@ -220,20 +227,21 @@ void WaveletTransformDialog::onSaveDWTResultAsGrid()
 {
     int nI = m_DWTbuffer.M();
     int nJ = m_DWTbuffer.N();
+    //the sizes of the smooth part after each level (see LiftingWaveletTransform), for the grids of any size
+    int numberOfLevels = WaveletUtils::getNumberOfLevels( m_DWTbuffer );
+    std::vector<spectral::index> lowPassSizesI = LiftingWaveletTransform::getLowPassSizes( nI, numberOfLevels );
+    std::vector<spectral::index> lowPassSizesJ = LiftingWaveletTransform::getLowPassSizes( nJ, numberOfLevels );
     spectral::array scaleField( nI, nJ, 1, 0.0 );
     spectral::array orientationField( nI, nJ, 1, 0.0 );
     for( int j = 0; j < nJ; ++j)
         for( int i = 0; i < nI; ++i){
-            if( i == 0 && j == 0 ){ //the value at i=0;j=0 is the smooth factor (global mean)
+            //set the level value
+            int levelI = LiftingWaveletTransform::getLevel( i, lowPassSizesI );
+            int levelJ = LiftingWaveletTransform::getLevel( j, lowPassSizesJ );
+            if( levelI < 0 && levelJ < 0 ){ //the values at the top-left corner are the smooth factor (global mean)
                 scaleField      ( i, j, 0 ) = -1.0;
                 orientationField( i, j, 0 ) = -1.0;
             } else {
-                //set the level value
-                double intpart;
-                std::modf ( std::log2( i ), &intpart );
-                int levelI = static_cast<int>( intpart );
-                std::modf ( std::log2( j ), &intpart );
-                int levelJ = static_cast<int>( intpart );
                 scaleField( i, j, 0 ) = std::max( levelI, levelJ );
                 //set the orientation field (vertical, diagonals, horizontal)
                 int orientation = 1;
@@ -278,12 +286,15 @@ void WaveletTransformDialog::onPreviewBacktransformedResult()
     bool interleaved = ( ui->cmbMethod->currentIndex() == 0 );
     bool centered = ui->chkWaveletCentered->isChecked();
 
+    //the reconstruction uses only the levels in the scale filter
     spectral::array backtrans = WaveletUtils::backtrans( m_inputGrid,
                                                          m_DWTbuffer,
                                                          getSelectedWaveletFamily(),
                                                          waveletType,
                                                          centered,
-                                                         interleaved );
+                                                         interleaved,
+                                                         ui->spinLevelMin->value(),
+                                                         ui->spinLevelMax->value() );
     debugGrid( backtrans );
 }
 
@@ -312,13 +323,16 @@ void WaveletTransformDialog::updateDisplay()
         //convert the array into an ITK image object
         GaborUtils::ImageTypePtr inputAsITK = GaborUtils::convertSpectralArrayToITKImage( *inputAsArray );
 
-        //mirror pad the image to the needed dimension (power of 2)
-        int nPowerOf2;
-        GaborUtils::ImageTypePtr inputMirrorPadded = WaveletUtils::squareAndMirrorPad( inputAsITK, nPowerOf2 );
+        //mirror pad the image to the dimension of the DWT result if it was computed by GSL (power of 2)
+        spectral::array inputMirrorPaddedAsArray;
+        if( m_DWTbuffer.M() != inputAsArray->M() || m_DWTbuffer.N() != inputAsArray->N() ){
+            int nPowerOf2;
+            GaborUtils::ImageTypePtr inputMirrorPadded = WaveletUtils::squareAndMirrorPad( inputAsITK, nPowerOf2 );
 
-        //convert the padded square image to array object.
-        spectral::array inputMirrorPaddedAsArray =
-                GaborUtils::convertITKImageToSpectralArray( *inputMirrorPadded );
+            //convert the padded square image to array object.
+            inputMirrorPaddedAsArray = GaborUtils::convertITKImageToSpectralArray( *inputMirrorPadded );
+        } else
+            inputMirrorPaddedAsArray = *inputAsArray;
 
         //convert the padded square image array into VTK grid.
         vtkSmartPointer<vtkImageData> out = vtkSmartPointer<vtkImageData>::New();
@@ -426,11 +440,31 @@ void WaveletTransformDialog::updateDisplay()
         //                         |________________|/
         //
 
-        // determine the number of levels (assumes the DWT transform is square).
-        int numberOfLevels = std::log2( m_DWTbuffer.M() );
+        //  For grids of any size transformed with the lifting scheme (see LiftingWaveletTransform), the layout is the
+        //  same, but the sub-grids of a level are not necessarily square and the smooth part may have more than one cell.
+
+        // determine the number of levels.
+        int numberOfLevels = WaveletUtils::getNumberOfLevels( m_DWTbuffer );
+
+        // get the sizes of the smooth part along each axis after each level.
+        std::vector<spectral::index> lowPassSizesI = LiftingWaveletTransform::getLowPassSizes( m_DWTbuffer.M(), numberOfLevels );
+        std::vector<spectral::index> lowPassSizesJ = LiftingWaveletTransform::getLowPassSizes( m_DWTbuffer.N(), numberOfLevels );
+
+        // returns the range [start, end) of the cells of a level along an axis: the detail (high-pass) part or the smooth (low-pass) part.
+        auto getLevelRange = [numberOfLevels]( const std::vector<spectral::index>& lowPassSizes, int iLevel, bool detail,
+                                               int& start, int& end ){
+            if( detail ){
+                start = lowPassSizes[ numberOfLevels - iLevel ];
+                end   = lowPassSizes[ numberOfLevels - iLevel - 1 ];
+            } else {
+                start = 0;
+                end   = lowPassSizes[ numberOfLevels - iLevel ];
+            }
+        };
 
-        // determine the number of cells in the three cubes (assumes the DWT transform is square).
-        int numberOfCells = m_DWTbuffer.M() * m_DWTbuffer.M() - 1;
+        // determine the number of cells in the three cubes (all cells but the ones of the smooth part).
+        int numberOfCells = m_DWTbuffer.M() * m_DWTbuffer.N() -
+                            lowPassSizesI[ numberOfLevels ] * lowPassSizesJ[ numberOfLevels ];
 
         double gridCellWidth  = m_inputGrid->getCellSizeI();
         double gridCellLength = m_inputGrid->getCellSizeJ();
@@ -446,13 +480,16 @@ void WaveletTransformDialog::updateDisplay()
         // for each level (0, 1, 2, 3, ...) of the scalograms
         int vertexIndex = 0;
         for( int iLevel = 0; iLevel < numberOfLevels; ++iLevel ){
-            int numberOfRowsInLevel = ( 1 << iLevel );
-            int numberOfColsInLevel = numberOfRowsInLevel;
-            double cellWidth = gridWidth / numberOfColsInLevel;
-            double cellLength = gridLength / numberOfRowsInLevel;
             double cellHeight = gridWidth / numberOfLevels; //2D: make cell hight equal one of the areal grid sizes divided by the number of levels so the scalograms look like cubes
             //for each scalogram (a, b and c) = (N-S, E-W, diagonals)
             for( char cScalogram = 'a'; cScalogram <= 'c'; ++cScalogram ){
+                int iStart, iEnd, jStart, jEnd;
+                getLevelRange( lowPassSizesI, iLevel, cScalogram == 'a' || cScalogram == 'c', iStart, iEnd );
+                getLevelRange( lowPassSizesJ, iLevel, cScalogram == 'b' || cScalogram == 'c', jStart, jEnd );
+                int numberOfColsInLevel = iEnd - iStart;
+                int numberOfRowsInLevel = jEnd - jStart;
+                double cellWidth = gridWidth / numberOfColsInLevel;
+                double cellLength = gridLength / numberOfRowsInLevel;
                 for( int jCell = 0; jCell < numberOfColsInLevel; ++jCell ){
                     for( int iCell = 0; iCell < numberOfRowsInLevel; ++iCell ){
                         double xOffset = 0;
@@ -519,19 +556,13 @@ void WaveletTransformDialog::updateDisplay()
                 //compute the input grid indexes ranges to read the data
                 //from the correct sub-grid corresponding to current level and current
                 //scalogram
-                int levelDim = 1 << iLevel;
-                int iStart = 0;
-                int jStart = 0;
-                if( cScalogram == 'b' || cScalogram == 'c' )
-                    iStart = levelDim;
-                if( cScalogram == 'a' || cScalogram == 'c' )
-                    jStart = levelDim;
-                int iEnd = iStart + levelDim;
-                int jEnd = jStart + levelDim;
+                int iStart, iEnd, jStart, jEnd;
+                getLevelRange( lowPassSizesI, iLevel, cScalogram == 'a' || cScalogram == 'c', iStart, iEnd );
+                getLevelRange( lowPassSizesJ, iLevel, cScalogram == 'b' || cScalogram == 'c', jStart, jEnd );
                 //read the values from the sub-grid
-                for( int jCell = jStart; jCell < jEnd; ++jCell ){
-                    for( int iCell = iStart; iCell < iEnd; ++iCell ){
-                        double value = m_DWTbuffer( jCell, iCell, 0 ); // i index is N-S-wise (see the loop to build geometry further above)
+                for( int iCell = iStart; iCell < iEnd; ++iCell ){
+                    for( int jCell = jStart; jCell < jEnd; ++jCell ){
+                        double value = m_DWTbuffer( iCell, jCell, 0 ); // j index is N-S-wise (see the loop to build geometry further above)
                         //assign the coefficient to the data array
                         values->InsertNextValue( std::abs( value ) );
                         //set the visibility flag accoring to the filter settings
@@ -653,12 +684,15 @@ void WaveletTransformDialog::onSaveBacktransformedResult()
     bool interleaved = ( ui->cmbMethod->currentIndex() == 0 );
     bool centered = ui->chkWaveletCentered->isChecked();
 
+    //the reconstruction uses only the levels in the scale filter
     spectral::array backtrans = WaveletUtils::backtrans( m_inputGrid,
                                                          m_DWTbuffer,
                                                          getSelectedWaveletFamily(),
                                                          waveletType,
                                                          centered,
-                                                         interleaved );
+                                                         interleaved,
+                                                         ui->spinLevelMin->value(),
+                                                         ui->spinLevelMax->value() );
 
     QString proposed_name = m_inputGrid->getVariableByIndex( m_inputVariableIndex )->getVariableName();
     proposed_name += "_filtered";
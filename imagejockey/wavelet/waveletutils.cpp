@@ -7,6 +7,7 @@
 
 #include <gsl/gsl_sort.h>
 #include <itkMirrorPadImageFilter.h>
+#include <algorithm>
 
 WaveletUtils::WaveletUtils()
 {
@@ -23,6 +24,14 @@ spectral::array WaveletUtils::transform( IJAbstractCartesianGrid *cg,
     cg->dataWillBeRequested();
     spectral::arrayPtr inputAsArray( cg->createSpectralArray( variableIndex ) );
 
+    //if possible, use the lifting scheme, which neither needs padding nor is limited to 2D.
+    LiftingWaveletKernel liftingKernel;
+    if( getLiftingKernel( waveletFamily, waveletType, liftingKernel ) ){
+        spectral::array result( *inputAsArray );
+        LiftingWaveletTransform( liftingKernel ).forward( result, -1, interleaved );
+        return result;
+    }
+
     //convert the array into an image object
     GaborUtils::ImageTypePtr inputAsITK = GaborUtils::convertSpectralArrayToITKImage( *inputAsArray );
 
@@ -94,8 +103,29 @@ spectral::array WaveletUtils::backtrans(IJAbstractCartesianGrid *gridWithOrigina
                                         WaveletFamily waveletFamily,
                                         int waveletType,
                                         bool centered,
-                                        bool interleaved)
+                                        bool interleaved,
+                                        int minLevel,
+                                        int maxLevel)
 {
+    //the lifting scheme yields coefficients in a grid with the same dimensions of the original grid.
+    LiftingWaveletKernel liftingKernel;
+    if( getLiftingKernel( waveletFamily, waveletType, liftingKernel ) &&
+            input.M() == gridWithOriginalGeometry->getNI() &&
+            input.N() == gridWithOriginalGeometry->getNJ() &&
+            input.K() == gridWithOriginalGeometry->getNK() ){
+        spectral::array result( input );
+        if( maxLevel >= 0 )
+            LiftingWaveletTransform( liftingKernel ).inverseBandLimited( result, -1, interleaved, minLevel, maxLevel );
+        else
+            LiftingWaveletTransform( liftingKernel ).inverse( result, -1, interleaved );
+        return result;
+    }
+
+    //GSL's coefficients have the same layout, so the band is limited the same way.
+    spectral::array coefficients( input );
+    if( maxLevel >= 0 )
+        LiftingWaveletTransform::limitBand( coefficients, getNumberOfLevels( coefficients ), minLevel, maxLevel );
+
     //assuming the input grid is square and with dimension that is a power of 2.
     int nPowerOf2 = input.M();
 
@@ -103,7 +133,7 @@ spectral::array WaveletUtils::backtrans(IJAbstractCartesianGrid *gridWithOrigina
     double *data = new double[ nPowerOf2 * nPowerOf2 ];
     for( int j = 0; j < nPowerOf2; ++j )
         for( int i = 0; i < nPowerOf2; ++i )
-            data[ j * nPowerOf2 + i ] = input( i, j );
+            data[ j * nPowerOf2 + i ] = coefficients( i, j );
 
     //the wavelet
     gsl_wavelet *w = makeWavelet( waveletFamily, waveletType, centered );
@@ -148,6 +178,16 @@ void WaveletUtils::backtrans(double *data,
     //assuming the input array has a lenght that is a power of 2.
     int nPowerOf2 = 1 << nLog2nData;
 
+    //use the lifting scheme if the wavelet is supported (the layout of the coefficients is the same of GSL's)
+    LiftingWaveletKernel liftingKernel;
+    if( getLiftingKernel( waveletFamily, waveletType, liftingKernel ) ){
+        spectral::array coefficients( (spectral::index)nPowerOf2, 1, 1, 0.0 );
+        std::copy( data, data + nPowerOf2, coefficients.data().begin() );
+        LiftingWaveletTransform( liftingKernel, 1 ).inverse( coefficients, nLog2nData );
+        std::copy( coefficients.data().begin(), coefficients.data().end(), data );
+        return;
+    }
+
     //the wavelet
     gsl_wavelet *w = makeWavelet( waveletFamily, waveletType, centered );
 
@@ -162,6 +202,38 @@ void WaveletUtils::backtrans(double *data,
     gsl_wavelet_workspace_free (work);
 }
 
+bool WaveletUtils::getLiftingKernel(WaveletFamily waveletFamily, int waveletType, LiftingWaveletKernel &kernel)
+{
+    switch ( waveletFamily ) {
+    case WaveletFamily::HAAR:
+        kernel = LiftingWaveletKernel::HAAR;
+        return true;
+    case WaveletFamily::DAUBECHIES:
+        if( waveletType == 4 ){
+            kernel = LiftingWaveletKernel::DAUBECHIES_4;
+            return true;
+        }
+        return false;
+    case WaveletFamily::B_SPLINE:
+        if( waveletType == 202 ){
+            kernel = LiftingWaveletKernel::CDF_5_3;
+            return true;
+        }
+        return false;
+    case WaveletFamily::CDF_9_7:
+        kernel = LiftingWaveletKernel::CDF_9_7;
+        return true;
+    default:
+        return false;
+    }
+}
+
+int WaveletUtils::getNumberOfLevels(const spectral::array &DWTcoefficients)
+{
+    //for the square power-of-two grids of GSL's DWT, this is log2 of the grid size.
+    return LiftingWaveletTransform::getMaxLevels( DWTcoefficients );
+}
+
 void WaveletUtils::fillRawArray(const GaborUtils::ImageTypePtr input, double *output)
 {
     //get input grid dimensions
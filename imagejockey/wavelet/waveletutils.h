@@ -2,6 +2,7 @@
 #define WAVELETUTILS_H
 
 #include "imagejockey/gabor/gaborutils.h"
+#include "imagejockey/wavelet/liftingwavelettransform.h"
 #include <gsl/gsl_wavelet2d.h>
 
 class IJAbstractCartesianGrid;
@@ -14,6 +15,7 @@ enum class WaveletFamily : int {
     DAUBECHIES,
     HAAR,
     B_SPLINE,
+    CDF_9_7,
     UNKNOWN
 };
 
@@ -24,6 +26,9 @@ public:
 
     /**
      * Performs 2D Discrete Wavelet Transform on gridded data.
+     * If the wavelet can be computed with the lifting scheme (see getLiftingKernel()), the transform is
+     * performed by LiftingWaveletTransform, which works with grids of any size, including 3D grids.  In this
+     * case, the returned grid has the same dimensions of the input grid.  Otherwise, GSL's DWT is used:
      * IMPORTANT: the returned grid is a square grid with a power of two size,
      *            for example: if the input grid is 120x100, the returned grid
      *            is 128x128.  This is a requirement for GSL DWT operation.
@@ -46,12 +51,21 @@ public:
                                       bool centered,
                                       bool interleaved );
 
+    /**
+     * Performs the inverse of transform().
+     * @param input The DWT coefficients as returned by transform().
+     * @param minLevel,maxLevel If maxLevel is not negative, the reconstruction is band-limited: the detail
+     *                          coefficients of the levels outside [minLevel, maxLevel] are ignored (0 = coarsest level,
+     *                          see LiftingWaveletTransform::limitBand()).
+     */
     static spectral::array backtrans(IJAbstractCartesianGrid *gridWithOriginalGeometry,
                                       const spectral::array& input,
                                       WaveletFamily waveletFamily,
                                       int waveletType,
                                       bool centered,
-                                      bool interleaved );
+                                      bool interleaved,
+                                      int minLevel = 0,
+                                      int maxLevel = -1 );
 
     /**
      * Does an inplace inverse 1D DWT in a raw double array. The result is put back in the data array.
@@ -67,6 +81,18 @@ public:
                            bool centered);
 
 
+    /**
+     * Returns whether the given wavelet can be computed with the lifting scheme (see LiftingWaveletTransform).
+     * If so, the corresponding lifting kernel is returned in the output parameter kernel.
+     * The centered variants of GSL's wavelets have no effect on the lifted wavelets.
+     */
+    static bool getLiftingKernel( WaveletFamily waveletFamily, int waveletType, LiftingWaveletKernel& kernel );
+
+    /**
+     * Returns the number of levels of a DWT result returned by transform().
+     */
+    static int getNumberOfLevels( const spectral::array& DWTcoefficients );
+
     /**
      * Fills the passed array of doubles with the values in the passed
      * image object.  The client code is responsible for correct allocation
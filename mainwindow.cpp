@@ -57,6 +57,7 @@
 #include "domain/faciestransitionmatrix.h"
 #include "domain/auxiliary/faciestransitionmatrixmaker.h"
 #include "domain/section.h"
+#include "domain/datamemorymanager.h"
 #include "util.h"
 #include "dialogs/nscoredialog.h"
 #include "dialogs/distributionmodelingdialog.h"
@@ -114,6 +115,7 @@
 #include "domain/auxiliary/valuestransferer.h"
 #include "domain/verticaltransiogrammodel.h"
 #include "geostats/mcrfsim.h"
+#include "gslib/gslibjobsdialog.h"
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -1528,6 +1530,12 @@ void MainWindow::openTransiographyBayesian()
     tbd->show();
 }
 
+void MainWindow::openGSLibJobs()
+{
+    GSLibJobsDialog* gjd = new GSLibJobsDialog( this );
+    gjd->show();
+}
+
 void MainWindow::onRemoveFile()
 {
     int ret = QMessageBox::warning(this, "Confirm removal operation",
@@ -2674,7 +2682,12 @@ void MainWindow::onRFFT()
 
 void MainWindow::onUpdateStatusBar()
 {
-    statusBar()->showMessage( "memory usage = " + Util::humanReadable( Util::getPhysicalRAMusage() ) + "B" );
+    QString message = "memory usage = " + Util::humanReadable( Util::getPhysicalRAMusage() ) + "B";
+    message += "; loaded data = " + Util::humanReadable( DataMemoryManager::instance()->getUsage() ) + "B";
+    int64_t budget = DataMemoryManager::instance()->getBudget();
+    if( budget > 0 )
+        message += " (budget = " + Util::humanReadable( budget ) + "B)";
+    statusBar()->showMessage( message );
 }
 
 void MainWindow::onRunStuffInUnattendedMode()
@@ -2813,8 +2826,9 @@ void MainWindow::onSVD()
     spectral::SVD svd = spectral::svd( *a );
     progressDialog.hide();
 
-    //get the list with the factor weights (information quantity)
-    spectral::array weights = svd.factor_weights();
+    //get the list with the factor weights (fraction of the data's energy), the same measure used
+    //when the factors are split further in the SVD analysis dialog
+    spectral::array weights = svd.energy_weights();
     Application::instance()->logInfo("MainWindow::onSVD(): " + QString::number( weights.data().size() ) + " factor(s) were found.");
 
     //User enters number of SVD factors
@@ -2854,6 +2868,7 @@ void MainWindow::onSVD()
         SVDAnalysisDialog* svdad = new SVDAnalysisDialog( this );
         connect( svdad, SIGNAL(sumOfFactorsComputed(spectral::array*)),
                  this, SLOT(onSumOfFactorsWasComputed(spectral::array*)) );
+        connect( svdad, SIGNAL(info(QString)), this, SLOT(onInfo(QString)) );
         svdad->setTree( factorTree );
         svdad->setDeleteTreeOnClose( true );
         svdad->show();
@@ -73,6 +73,7 @@ public slots:
     void openCokrigingNewcokb3d();
     void openTransiography();
     void openTransiographyBayesian();
+    void openGSLibJobs();
 
 private:
     Ui::MainWindow *ui;
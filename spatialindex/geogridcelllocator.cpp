@@ -0,0 +1,358 @@
+#include "geogridcelllocator.h"
+
+#include "domain/geogrid.h"
+#include "util.h"
+
+#include <thread>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+    /** The vertexes (local ids as in geogrid.h) of the six faces of a cell, counter-clockwise as seen from inside. */
+    const int FACE_VERTEXES[6][4] = { {0, 1, 2, 3},
+                                      {4, 7, 6, 5},
+                                      {0, 3, 7, 4},
+                                      {1, 5, 6, 2},
+                                      {0, 4, 5, 1},
+                                      {3, 2, 6, 7} };
+
+    /** The six tetrahedra (local vertex ids) forming a cell.  This is the same decomposition used
+     * by Hexahedron::isInside() (three pyramids, each split into two tetrahedra). */
+    const int TETRAHEDRA_VERTEXES[6][4] = { {3, 2, 6, 5},
+                                            {3, 1, 2, 5},
+                                            {3, 5, 6, 7},
+                                            {3, 4, 5, 7},
+                                            {3, 1, 5, 4},
+                                            {3, 0, 1, 4} };
+
+    /** Same as Tetrahedron::isSameSide(), but on raw coordinates and a query point lying
+     * on the plane is considered to be on the same side. */
+    inline bool isSameSide( const double* v1, const double* v2, const double* v3,
+                            const double* ref, const double* p ){
+        double ax = v2[0] - v1[0], ay = v2[1] - v1[1], az = v2[2] - v1[2];
+        double bx = v3[0] - v1[0], by = v3[1] - v1[1], bz = v3[2] - v1[2];
+        double nx = ay * bz - az * by;
+        double ny = az * bx - ax * bz;
+        double nz = ax * by - ay * bx;
+        double dotReferenceVertex = nx * ( ref[0] - v1[0] ) + ny * ( ref[1] - v1[1] ) + nz * ( ref[2] - v1[2] );
+        double dotQueryPoint      = nx * (   p[0] - v1[0] ) + ny * (   p[1] - v1[1] ) + nz * (   p[2] - v1[2] );
+        return dotQueryPoint == 0.0 || Util::sign( dotReferenceVertex ) == Util::sign( dotQueryPoint );
+    }
+
+    /** Same as Tetrahedron::isInside(), but on raw coordinates. */
+    inline bool isInsideTetrahedron( const double* v0, const double* v1, const double* v2, const double* v3,
+                                     const double* p ){
+        return isSameSide( v0, v1, v2, v3, p ) &&
+               isSameSide( v1, v2, v3, v0, p ) &&
+               isSameSide( v2, v3, v0, v1, p ) &&
+               isSameSide( v3, v0, v1, v2, p );
+    }
+
+    /** The maximum number of steps in a cell walk before resorting to the bucket search. */
+    const int MAX_WALK_STEPS = 32;
+
+    void taskLocateRange( const GeoGridCellLocator* locator,
+                          const std::vector<double>* xs,
+                          const std::vector<double>* ys,
+                          const std::vector<double>* zs,
+                          int iFirst, int iLast,
+                          std::vector<int>* cellIndexes ){
+        int lastHit = -1;
+        for( int iPoint = iFirst; iPoint <= iLast; ++iPoint ){
+            uint cellIndex;
+            if( locator->locate( (*xs)[iPoint], (*ys)[iPoint], (*zs)[iPoint], cellIndex, lastHit ) ){
+                (*cellIndexes)[iPoint] = cellIndex;
+                lastHit = cellIndex;
+            } else
+                (*cellIndexes)[iPoint] = -1;
+        }
+    }
+}
+
+GeoGridCellLocator::GeoGridCellLocator() :
+    m_nI( 0 ), m_nJ( 0 ), m_nK( 0 ),
+    m_x0( 0.0 ), m_y0( 0.0 ), m_z0( 0.0 ),
+    m_bucketDX( 1.0 ), m_bucketDY( 1.0 ), m_bucketDZ( 1.0 ),
+    m_nBucketsI( 0 ), m_nBucketsJ( 0 ), m_nBucketsK( 0 )
+{
+}
+
+void GeoGridCellLocator::build( GeoGrid *geoGrid )
+{
+    clear();
+
+    m_nI = geoGrid->getNI();
+    m_nJ = geoGrid->getNJ();
+    m_nK = geoGrid->getNK();
+    uint nCells = geoGrid->getMeshNumberOfCells();
+    uint nVertexes = geoGrid->getMeshNumberOfVertexes();
+    if( nCells == 0 || nVertexes == 0 )
+        return;
+
+    //copy the mesh to flat arrays and compute the extents of the mesh.
+    double minX, minY, minZ, maxX, maxY, maxZ;
+    minX = minY = minZ =  std::numeric_limits<double>::max();
+    maxX = maxY = maxZ = -std::numeric_limits<double>::max();
+    m_vertexCoords.resize( nVertexes * 3 );
+    for( uint iVertex = 0; iVertex < nVertexes; ++iVertex ){
+        double x, y, z;
+        geoGrid->getMeshVertexLocation( iVertex, x, y, z );
+        m_vertexCoords[ iVertex * 3 + 0 ] = x;
+        m_vertexCoords[ iVertex * 3 + 1 ] = y;
+        m_vertexCoords[ iVertex * 3 + 2 ] = z;
+        minX = std::min( minX, x ); maxX = std::max( maxX, x );
+        minY = std::min( minY, y ); maxY = std::max( maxY, y );
+        minZ = std::min( minZ, z ); maxZ = std::max( maxZ, z );
+    }
+    m_cellVertexIds.resize( nCells * 8 );
+    for( uint iCell = 0; iCell < nCells; ++iCell ){
+        uint vIds[8];
+        geoGrid->getMeshCellDefinition( iCell, vIds );
+        std::copy( vIds, vIds + 8, m_cellVertexIds.begin() + iCell * 8 );
+    }
+
+    //define the bucket grid.  Buckets are roughly twice the average cell size along
+    //each topological direction, so each bucket holds a handful of cells.
+    m_nBucketsI = std::max<uint>( 1, m_nI / 2 );
+    m_nBucketsJ = std::max<uint>( 1, m_nJ / 2 );
+    m_nBucketsK = std::max<uint>( 1, m_nK / 2 );
+    double tolerance = 1E-6 * std::max( { maxX - minX, maxY - minY, maxZ - minZ, 1.0 } );
+    m_x0 = minX - tolerance;
+    m_y0 = minY - tolerance;
+    m_z0 = minZ - tolerance;
+    m_bucketDX = ( maxX - minX + 2 * tolerance ) / m_nBucketsI;
+    m_bucketDY = ( maxY - minY + 2 * tolerance ) / m_nBucketsJ;
+    m_bucketDZ = ( maxZ - minZ + 2 * tolerance ) / m_nBucketsK;
+
+    //lambda that computes the range of buckets touched by the bounding box of a cell.
+    auto getBucketRange = [this]( uint iCell, uint (&min)[3], uint (&max)[3] ) {
+        double cellMin[3] = {  std::numeric_limits<double>::max(),
+                               std::numeric_limits<double>::max(),
+                               std::numeric_limits<double>::max() };
+        double cellMax[3] = { -std::numeric_limits<double>::max(),
+                              -std::numeric_limits<double>::max(),
+                              -std::numeric_limits<double>::max() };
+        for( int iV = 0; iV < 8; ++iV ){
+            const double* v = &m_vertexCoords[ m_cellVertexIds[ iCell * 8 + iV ] * 3 ];
+            for( int iAxis = 0; iAxis < 3; ++iAxis ){
+                cellMin[iAxis] = std::min( cellMin[iAxis], v[iAxis] );
+                cellMax[iAxis] = std::max( cellMax[iAxis], v[iAxis] );
+            }
+        }
+        min[0] = std::min<uint>( m_nBucketsI - 1, ( cellMin[0] - m_x0 ) / m_bucketDX );
+        min[1] = std::min<uint>( m_nBucketsJ - 1, ( cellMin[1] - m_y0 ) / m_bucketDY );
+        min[2] = std::min<uint>( m_nBucketsK - 1, ( cellMin[2] - m_z0 ) / m_bucketDZ );
+        max[0] = std::min<uint>( m_nBucketsI - 1, ( cellMax[0] - m_x0 ) / m_bucketDX );
+        max[1] = std::min<uint>( m_nBucketsJ - 1, ( cellMax[1] - m_y0 ) / m_bucketDY );
+        max[2] = std::min<uint>( m_nBucketsK - 1, ( cellMax[2] - m_z0 ) / m_bucketDZ );
+    };
+
+    //first pass: count the cells touching each bucket.
+    uint nBuckets = m_nBucketsI * m_nBucketsJ * m_nBucketsK;
+    m_bucketOffsets.assign( nBuckets + 1, 0 );
+    for( uint iCell = 0; iCell < nCells; ++iCell ){
+        uint min[3], max[3];
+        getBucketRange( iCell, min, max );
+        for( uint k = min[2]; k <= max[2]; ++k )
+            for( uint j = min[1]; j <= max[1]; ++j )
+                for( uint i = min[0]; i <= max[0]; ++i )
+                    ++m_bucketOffsets[ k * m_nBucketsJ * m_nBucketsI + j * m_nBucketsI + i + 1 ];
+    }
+
+    //turn the counts into offsets.
+    for( uint iBucket = 0; iBucket < nBuckets; ++iBucket )
+        m_bucketOffsets[ iBucket + 1 ] += m_bucketOffsets[ iBucket ];
+
+    //second pass: register the cells in the buckets.
+    m_bucketCells.resize( m_bucketOffsets.back() );
+    std::vector<uint> fillPositions( m_bucketOffsets.begin(), m_bucketOffsets.end() - 1 );
+    for( uint iCell = 0; iCell < nCells; ++iCell ){
+        uint min[3], max[3];
+        getBucketRange( iCell, min, max );
+        for( uint k = min[2]; k <= max[2]; ++k )
+            for( uint j = min[1]; j <= max[1]; ++j )
+                for( uint i = min[0]; i <= max[0]; ++i )
+                    m_bucketCells[ fillPositions[ k * m_nBucketsJ * m_nBucketsI + j * m_nBucketsI + i ]++ ] = iCell;
+    }
+}
+
+void GeoGridCellLocator::clear()
+{
+    //clear() does not guarantee memory is actually freed.
+    std::vector<double>().swap( m_vertexCoords );
+    std::vector<uint>().swap( m_cellVertexIds );
+    std::vector<uint>().swap( m_bucketOffsets );
+    std::vector<uint>().swap( m_bucketCells );
+    m_nBucketsI = m_nBucketsJ = m_nBucketsK = 0;
+}
+
+bool GeoGridCellLocator::isEmpty() const
+{
+    return m_bucketOffsets.empty();
+}
+
+bool GeoGridCellLocator::locate( double x, double y, double z, uint &cellIndex, int startCellIndex ) const
+{
+    //non-finite coordinates (e.g. NaN) are in no cell
+    if( isEmpty() || ! std::isfinite( x ) || ! std::isfinite( y ) || ! std::isfinite( z ) )
+        return false;
+    if( startCellIndex >= 0 && (uint)startCellIndex < m_cellVertexIds.size() / 8 &&
+        walk( x, y, z, startCellIndex, cellIndex ) )
+        return true;
+    return searchBucket( x, y, z, cellIndex );
+}
+
+void GeoGridCellLocator::locate( const std::vector<double> &xs,
+                                 const std::vector<double> &ys,
+                                 const std::vector<double> &zs,
+                                 std::vector<int> &cellIndexes,
+                                 unsigned int nThreads ) const
+{
+    int nPoints = xs.size();
+    cellIndexes.assign( nPoints, -1 );
+    if( nPoints == 0 )
+        return;
+    nThreads = std::max( 1U, std::min<unsigned int>( nThreads, nPoints ) );
+
+    //distribute contiguous ranges of points amongst the threads so each thread's queries remain coherent
+    std::vector< std::pair< int, int > > ranges = Util::generateSubRanges( 0, nPoints - 1, nThreads );
+
+    //create and start the threads.
+    std::thread threads[nThreads];
+    for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+        threads[iThread] = std::thread( taskLocateRange,
+                                        this,
+                                        &xs, &ys, &zs,
+                                        ranges[iThread].first,
+                                        ranges[iThread].second,
+                                        &cellIndexes );
+
+    //wait for the threads to finish.
+    for( unsigned int iThread = 0; iThread < nThreads; ++iThread )
+        threads[iThread].join();
+}
+
+bool GeoGridCellLocator::isInside( uint cellIndex, double x, double y, double z, int &exitFace ) const
+{
+    const double p[3] = { x, y, z };
+    const uint* vIds = &m_cellVertexIds[ cellIndex * 8 ];
+    const double* v[8];
+    for( int iV = 0; iV < 8; ++iV )
+        v[iV] = &m_vertexCoords[ vIds[iV] * 3 ];
+
+    //the exact test
+    for( int iTet = 0; iTet < 6; ++iTet ){
+        const int* t = TETRAHEDRA_VERTEXES[iTet];
+        if( isInsideTetrahedron( v[t[0]], v[t[1]], v[t[2]], v[t[3]], p ) ){
+            exitFace = -1;
+            return true;
+        }
+    }
+
+    //the location is outside: find the face plane the location is farthest out of.
+    //The faces are counter-clockwise as seen from inside, so their normals point inwards.
+    exitFace = -1;
+    double mostNegativeDistance = 0.0;
+    for( int iFace = 0; iFace < 6; ++iFace ){
+        const double* a = v[ FACE_VERTEXES[iFace][0] ];
+        const double* b = v[ FACE_VERTEXES[iFace][1] ];
+        const double* c = v[ FACE_VERTEXES[iFace][2] ];
+        const double* d = v[ FACE_VERTEXES[iFace][3] ];
+        //the normal of a (possibly non-planar) quadrilateral is the cross product of its diagonals
+        double d1x = c[0] - a[0], d1y = c[1] - a[1], d1z = c[2] - a[2];
+        double d2x = d[0] - b[0], d2y = d[1] - b[1], d2z = d[2] - b[2];
+        double nx = d1y * d2z - d1z * d2y;
+        double ny = d1z * d2x - d1x * d2z;
+        double nz = d1x * d2y - d1y * d2x;
+        double norm = std::sqrt( nx * nx + ny * ny + nz * nz );
+        if( norm == 0.0 )
+            continue; //collapsed face
+        double cx = ( a[0] + b[0] + c[0] + d[0] ) / 4.0;
+        double cy = ( a[1] + b[1] + c[1] + d[1] ) / 4.0;
+        double cz = ( a[2] + b[2] + c[2] + d[2] ) / 4.0;
+        double distance = ( nx * ( x - cx ) + ny * ( y - cy ) + nz * ( z - cz ) ) / norm;
+        if( distance < mostNegativeDistance ){
+            mostNegativeDistance = distance;
+            exitFace = iFace;
+        }
+    }
+    return false;
+}
+
+int GeoGridCellLocator::getNeighbor( uint cellIndex, int face ) const
+{
+    uint k = cellIndex / ( m_nJ * m_nI );
+    uint j = ( cellIndex - k * m_nJ * m_nI ) / m_nI;
+    uint i = cellIndex % m_nI;
+    //see the diagram in geogrid.h for the face numbering
+    switch( face ){
+    case 0: if( k == 0 )        return -1; --k; break;
+    case 1: if( k == m_nK - 1 ) return -1; ++k; break;
+    case 2: if( i == 0 )        return -1; --i; break;
+    case 3: if( i == m_nI - 1 ) return -1; ++i; break;
+    case 4: if( j == 0 )        return -1; --j; break;
+    case 5: if( j == m_nJ - 1 ) return -1; ++j; break;
+    default: return -1;
+    }
+    return k * m_nJ * m_nI + j * m_nI + i;
+}
+
+bool GeoGridCellLocator::walk( double x, double y, double z, uint startCellIndex, uint &cellIndex ) const
+{
+    int currentCell = startCellIndex;
+    int previousCell = -1;
+    for( int iStep = 0; iStep < MAX_WALK_STEPS && currentCell >= 0; ++iStep ){
+        int exitFace;
+        if( isInside( currentCell, x, y, z, exitFace ) ){
+            cellIndex = currentCell;
+            return true;
+        }
+        //the face planes do not point anywhere (warped cell) or the walk reached the border of the mesh.
+        if( exitFace < 0 )
+            return false;
+        int nextCell = getNeighbor( currentCell, exitFace );
+        //avoid ping-ponging between two cells
+        if( nextCell == previousCell )
+            return false;
+        previousCell = currentCell;
+        currentCell = nextCell;
+    }
+    return false;
+}
+
+bool GeoGridCellLocator::searchBucket( double x, double y, double z, uint &cellIndex ) const
+{
+    //get the bucket containing the location
+    double bi = ( x - m_x0 ) / m_bucketDX;
+    double bj = ( y - m_y0 ) / m_bucketDY;
+    double bk = ( z - m_z0 ) / m_bucketDZ;
+    //written so that NaN bucket coordinates fail too: they must not be cast to bucket indexes
+    if( ! ( bi >= 0.0 && bj >= 0.0 && bk >= 0.0 &&
+            bi < m_nBucketsI && bj < m_nBucketsJ && bk < m_nBucketsK ) )
+        return false; //location is outside the mesh's bounding box or not finite
+    uint iBucket = (uint)bk * m_nBucketsJ * m_nBucketsI + (uint)bj * m_nBucketsI + (uint)bi;
+
+    //test the cells whose bounding boxes touch the bucket
+    for( uint iPos = m_bucketOffsets[ iBucket ]; iPos < m_bucketOffsets[ iBucket + 1 ]; ++iPos ){
+        uint iCell = m_bucketCells[ iPos ];
+        //cheap bounding box rejection before the exact test
+        const uint* vIds = &m_cellVertexIds[ iCell * 8 ];
+        bool belowX = true, aboveX = true, belowY = true, aboveY = true, belowZ = true, aboveZ = true;
+        for( int iV = 0; iV < 8; ++iV ){
+            const double* v = &m_vertexCoords[ vIds[iV] * 3 ];
+            belowX &= v[0] > x; aboveX &= v[0] < x;
+            belowY &= v[1] > y; aboveY &= v[1] < y;
+            belowZ &= v[2] > z; aboveZ &= v[2] < z;
+        }
+        if( belowX || aboveX || belowY || aboveY || belowZ || aboveZ )
+            continue;
+        int exitFace;
+        if( isInside( iCell, x, y, z, exitFace ) ){
+            cellIndex = iCell;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,104 @@
+#ifndef GEOGRIDCELLLOCATOR_H
+#define GEOGRIDCELLLOCATOR_H
+
+#include <vector>
+#include <sys/types.h>
+
+class GeoGrid;
+
+/**
+ * The GeoGridCellLocator is a point-location structure specialized for the hexahedral (corner-point)
+ * cells of a GeoGrid.  It answers the question "which cell contains the location (x,y,z)?" much faster
+ * than the generic R-Tree in SpatialIndex followed by a Hexahedron::isInside() test, because:
+ *
+ *   - the mesh is copied to flat coordinate and connectivity arrays (no shared pointers, no allocations per query);
+ *   - cells are binned in a uniform 3D grid of buckets over their bounding boxes, so a query visits only
+ *     the few cells whose bounding boxes touch the bucket of the location;
+ *   - consecutive queries that are spatially coherent (e.g. scanning the cells of another grid) can start
+ *     from the cell of the previous hit and walk towards the location across the face planes of the cells,
+ *     which normally finds the cell in a few steps without touching the buckets at all.
+ *
+ * The point-in-cell test uses the same six-tetrahedra decomposition of Hexahedron::isInside(), except that
+ * locations lying exactly on the faces of the tetrahedra are considered inside.  Hexahedron::isInside() rejects
+ * them, which, for instance, fails for the centers of box-shaped cells as they lie on the internal faces of the
+ * decomposition.  The face planes used to steer the walk are
+ * computed on the fly from the flat vertex arrays rather than stored, as storing them would cost
+ * ~200 bytes per cell (~1GB for a 5M-cell grid).
+ *
+ * Once built, all the query methods are const and can be called concurrently from multiple threads.
+ */
+class GeoGridCellLocator
+{
+public:
+    GeoGridCellLocator();
+
+    /** Builds the locator from the mesh of the given GeoGrid.  The mesh must be loaded
+     * (see GeoGrid::loadMesh()).  Any previously built structure is discarded.
+     */
+    void build( GeoGrid* geoGrid );
+
+    /** Releases the memory used by the locator. */
+    void clear();
+
+    /** Returns whether the locator has not been built. */
+    bool isEmpty() const;
+
+    /**
+     * Returns, via output parameter, the index of the cell that contains the given location.
+     * Returns false if the location is outside the mesh or has non-finite coordinates.
+     * @param startCellIndex The index of a cell near the query location (e.g. the result of a previous query)
+     *                       to start a cell walk from.  Pass -1 to go straight to the bucket search.
+     */
+    bool locate( double x, double y, double z, uint& cellIndex, int startCellIndex = -1 ) const;
+
+    /**
+     * Locates many points at once, in parallel.  The query points are split into contiguous ranges, one per
+     * thread, and each thread walks from the cell of its previous hit, so passing points in a spatially coherent
+     * order (e.g. in the scan order of a grid) greatly improves performance.
+     * @param cellIndexes Output vector with the index of the cell containing each location or -1 if
+     *                    the location is outside the mesh.
+     */
+    void locate( const std::vector<double>& xs,
+                 const std::vector<double>& ys,
+                 const std::vector<double>& zs,
+                 std::vector<int>& cellIndexes,
+                 unsigned int nThreads ) const;
+
+private:
+    /** Returns whether the given location is inside the given cell.  If it is not, exitFace is set to the
+     * face (0-5, see the diagram in geogrid.h) across which the location is farthest out, which is the
+     * direction to step to in a cell walk.
+     */
+    bool isInside( uint cellIndex, double x, double y, double z, int& exitFace ) const;
+
+    /** Returns the index of the cell sharing the given face with the given cell or -1 if
+     * the face is at the border of the mesh. */
+    int getNeighbor( uint cellIndex, int face ) const;
+
+    /** Tries to locate the point by walking from cell to cell starting at startCellIndex. */
+    bool walk( double x, double y, double z, uint startCellIndex, uint& cellIndex ) const;
+
+    /** Tries to locate the point by testing the cells registered in the bucket containing the location. */
+    bool searchBucket( double x, double y, double z, uint& cellIndex ) const;
+
+    //--------------flat mesh data-----------------------
+    /** XYZ coordinates of the vertexes (3 values per vertex). */
+    std::vector<double> m_vertexCoords;
+    /** Vertex ids of the cells (8 values per cell). */
+    std::vector<uint> m_cellVertexIds;
+    //---------------------------------------------------
+
+    uint m_nI, m_nJ, m_nK;
+
+    //--------------bucket grid--------------------------
+    double m_x0, m_y0, m_z0;
+    double m_bucketDX, m_bucketDY, m_bucketDZ;
+    uint m_nBucketsI, m_nBucketsJ, m_nBucketsK;
+    /** Offsets into m_bucketCells of each bucket's list of cells (CSR layout, one extra entry at the end). */
+    std::vector<uint> m_bucketOffsets;
+    /** The indexes of the cells whose bounding boxes touch each bucket. */
+    std::vector<uint> m_bucketCells;
+    //---------------------------------------------------
+};
+
+#endif // GEOGRIDCELLLOCATOR_H
@@ -0,0 +1,487 @@
+/*
+Image filters for spectral::array grids.
+*/
+
+#include "filters.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <thread>
+
+namespace spectral
+{
+
+void parallel_for(index n, unsigned int n_threads, const std::function<void(index, index)> &f)
+{
+    if (n <= 0) {
+        return;
+    }
+    if (n_threads == 0) {
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    index n_ranges = std::max<index>(1, std::min<index>(n_threads, n));
+    if (n_ranges == 1) {
+        f(0, n);
+        return;
+    }
+    std::vector<std::thread> threads;
+    for (index t = 0; t < n_ranges; ++t) {
+        threads.emplace_back(f, n * t / n_ranges, n * (t + 1) / n_ranges);
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+namespace
+{
+
+// The extents and the strides of the three axes of an array ((i*N+j)*K+k layout).
+struct grid_axes {
+    explicit grid_axes(const array &a)
+    {
+        extent[0] = a.M();
+        extent[1] = a.N();
+        extent[2] = a.K();
+        stride[0] = a.N() * a.K();
+        stride[1] = a.K();
+        stride[2] = 1;
+    }
+
+    // The offset of the first cell of the l-th line along the given axis.
+    index line_start(int axis, index l) const
+    {
+        int b = axis == 0 ? 1 : 0;
+        int c = axis == 2 ? 1 : 2;
+        return (l / extent[c]) * stride[b] + (l % extent[c]) * stride[c];
+    }
+
+    index n_lines(int axis) const { return extent[0] * extent[1] * extent[2] / extent[axis]; }
+
+    index extent[3];
+    index stride[3];
+};
+
+// Applies f(line) to every line of the array along the given axis.
+// The lines are copied to contiguous buffers, so f may use the line as scratch.
+void filter_lines(std::vector<double> &data,
+                  const grid_axes &axes,
+                  int axis,
+                  unsigned int n_threads,
+                  const std::function<void(std::vector<double> &)> &f)
+{
+    const index length = axes.extent[axis];
+    const index stride = axes.stride[axis];
+    if (length < 2) {
+        return;
+    }
+    parallel_for(axes.n_lines(axis), n_threads, [&](index first, index last) {
+        std::vector<double> line(length);
+        for (index l = first; l < last; ++l) {
+            index start = axes.line_start(axis, l);
+            for (index x = 0; x < length; ++x) {
+                line[x] = data[start + x * stride];
+            }
+            f(line);
+            for (index x = 0; x < length; ++x) {
+                data[start + x * stride] = line[x];
+            }
+        }
+    });
+}
+
+// Running maximum (or minimum, depending on Compare) of a line over windows of half size r
+// with the van Herk/Gil-Werman algorithm: three comparisons per value regardless of r.
+template <typename Compare>
+void running_extremum(std::vector<double> &line, index r, double padding, Compare better)
+{
+    const index n = line.size();
+    r = std::min(r, n - 1);
+    const index w = 2 * r + 1;
+    const index padded = n + 2 * r;
+    std::vector<double> g(padded), h(padded);
+    auto value = [&](index x) { return (x < r || x >= n + r) ? padding : line[x - r]; };
+    for (index x = 0; x < padded; ++x) {
+        g[x] = (x % w == 0) ? value(x) : std::max(g[x - 1], value(x), better);
+    }
+    for (index x = padded - 1; x >= 0; --x) {
+        h[x] = (x % w == w - 1 || x == padded - 1) ? value(x) : std::max(h[x + 1], value(x), better);
+    }
+    for (index x = 0; x < n; ++x) {
+        line[x] = std::max(h[x], g[x + w - 1], better);
+    }
+}
+
+template <typename Compare>
+array extremum_filter(const array &in, int half_window_size, unsigned int n_threads, double padding, Compare better)
+{
+    array out(in.M(), in.N(), in.K());
+    for (index i = 0; i < in.size(); ++i) {
+        out.d_[i] = std::isfinite(in.d_[i]) ? in.d_[i] : padding;
+    }
+    if (half_window_size <= 0) {
+        return out;
+    }
+    grid_axes axes(in);
+    for (int axis = 0; axis < 3; ++axis) {
+        filter_lines(out.d_, axes, axis, n_threads, [&](std::vector<double> &line) {
+            running_extremum(line, half_window_size, padding, better);
+        });
+    }
+    return out;
+}
+
+// The ranks of the values currently in a sliding window: a bitset of ranks plus a Fenwick tree
+// with the number of ranks in each 64-bit word to find the k-th smallest rank in O(log n).
+class rank_window
+{
+public:
+    explicit rank_window(index n_ranks)
+        : bits_((n_ranks + 63) / 64, 0), tree_(bits_.size() + 1, 0), size_(0), top_(1)
+    {
+        while (top_ * 2 <= (index)bits_.size()) {
+            top_ *= 2;
+        }
+    }
+
+    void insert(index rank)
+    {
+        bits_[rank >> 6] |= std::uint64_t(1) << (rank & 63);
+        update(rank >> 6, 1);
+        ++size_;
+    }
+
+    void erase(index rank)
+    {
+        bits_[rank >> 6] &= ~(std::uint64_t(1) << (rank & 63));
+        update(rank >> 6, -1);
+        --size_;
+    }
+
+    index size() const { return size_; }
+
+    // The k-th smallest rank in the window (zero-based).
+    index kth(index k) const
+    {
+        index word = 0;
+        for (index step = top_; step > 0; step /= 2) {
+            if (word + step <= (index)bits_.size() && tree_[word + step] <= k) {
+                word += step;
+                k -= tree_[word];
+            }
+        }
+        std::uint64_t bits = bits_[word];
+        for (index bit = 0; bit < 64; ++bit) {
+            if ((bits >> bit) & 1) {
+                if (k == 0) {
+                    return word * 64 + bit;
+                }
+                --k;
+            }
+        }
+        return -1;
+    }
+
+private:
+    void update(index word, int delta)
+    {
+        for (index w = word + 1; w <= (index)bits_.size(); w += w & -w) {
+            tree_[w] += delta;
+        }
+    }
+
+    std::vector<std::uint64_t> bits_;
+    std::vector<index> tree_;
+    index size_;
+    index top_;
+};
+
+// Coefficients of the recursive Gaussian filter of Young and van Vliet (1995).
+struct recursive_gaussian {
+    explicit recursive_gaussian(double sigma)
+    {
+        double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330
+                                : 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+        double b0 = 1.57825 + 2.44413 * q + 1.4281 * q * q + 0.422205 * q * q * q;
+        b1 = (2.44413 * q + 2.85619 * q * q + 1.26661 * q * q * q) / b0;
+        b2 = -(1.4281 * q * q + 1.26661 * q * q * q) / b0;
+        b3 = (0.422205 * q * q * q) / b0;
+        B = 1.0 - (b1 + b2 + b3);
+    }
+
+    // Forward and backward passes with zero values outside the line.
+    void apply(std::vector<double> &line) const
+    {
+        const index n = line.size();
+        double w1 = 0.0, w2 = 0.0, w3 = 0.0;
+        for (index x = 0; x < n; ++x) {
+            double w = B * line[x] + b1 * w1 + b2 * w2 + b3 * w3;
+            w3 = w2;
+            w2 = w1;
+            w1 = w;
+            line[x] = w;
+        }
+        w1 = w2 = w3 = 0.0;
+        for (index x = n - 1; x >= 0; --x) {
+            double w = B * line[x] + b1 * w1 + b2 * w2 + b3 * w3;
+            w3 = w2;
+            w2 = w1;
+            w1 = w;
+            line[x] = w;
+        }
+    }
+
+    double B, b1, b2, b3;
+};
+
+} // namespace
+
+summed_area_table::summed_area_table(const array &in, unsigned int n_threads)
+    : M_(in.M()), N_(in.N()), K_(in.K()), shift_(0.0), sums_(in.size(), 0.0), counts_(in.size(), 0)
+{
+    index n_finite = 0;
+    for (index i = 0; i < in.size(); ++i) {
+        if (std::isfinite(in.d_[i])) {
+            shift_ += in.d_[i];
+            ++n_finite;
+        }
+    }
+    // an integral shift keeps the sums of integral (or dyadic) values exact
+    if (n_finite > 0) {
+        shift_ = std::round(shift_ / n_finite);
+    }
+    for (index i = 0; i < in.size(); ++i) {
+        if (std::isfinite(in.d_[i])) {
+            sums_[i] = in.d_[i] - shift_;
+            counts_[i] = 1;
+        }
+    }
+
+    // prefix sums along k, then j, then i
+    parallel_for(M_ * N_, n_threads, [&](index first, index last) {
+        for (index l = first; l < last; ++l) {
+            for (index k = 1; k < K_; ++k) {
+                sums_[l * K_ + k] += sums_[l * K_ + k - 1];
+                counts_[l * K_ + k] += counts_[l * K_ + k - 1];
+            }
+        }
+    });
+    parallel_for(M_, n_threads, [&](index first, index last) {
+        for (index i = first; i < last; ++i) {
+            for (index j = 1; j < N_; ++j) {
+                index row = (i * N_ + j) * K_;
+                for (index k = 0; k < K_; ++k) {
+                    sums_[row + k] += sums_[row - K_ + k];
+                    counts_[row + k] += counts_[row - K_ + k];
+                }
+            }
+        }
+    });
+    const index slice = N_ * K_;
+    parallel_for(slice, n_threads, [&](index first, index last) {
+        for (index i = 1; i < M_; ++i) {
+            for (index l = first; l < last; ++l) {
+                sums_[i * slice + l] += sums_[(i - 1) * slice + l];
+                counts_[i * slice + l] += counts_[(i - 1) * slice + l];
+            }
+        }
+    });
+}
+
+template <typename T>
+T summed_area_table::box(const std::vector<T> &table, index i0, index i1, index j0, index j1, index k0, index k1) const
+{
+    i0 = std::max<index>(i0, 0);
+    j0 = std::max<index>(j0, 0);
+    k0 = std::max<index>(k0, 0);
+    i1 = std::min<index>(i1, M_ - 1);
+    j1 = std::min<index>(j1, N_ - 1);
+    k1 = std::min<index>(k1, K_ - 1);
+    if (i0 > i1 || j0 > j1 || k0 > k1) {
+        return T(0);
+    }
+    auto at = [&](index i, index j, index k) {
+        return (i < 0 || j < 0 || k < 0) ? T(0) : table[(i * N_ + j) * K_ + k];
+    };
+    return at(i1, j1, k1) - at(i0 - 1, j1, k1) - at(i1, j0 - 1, k1) - at(i1, j1, k0 - 1)
+           + at(i0 - 1, j0 - 1, k1) + at(i0 - 1, j1, k0 - 1) + at(i1, j0 - 1, k0 - 1)
+           - at(i0 - 1, j0 - 1, k0 - 1);
+}
+
+index summed_area_table::count(index i0, index i1, index j0, index j1, index k0, index k1) const
+{
+    return box(counts_, i0, i1, j0, j1, k0, k1);
+}
+
+double summed_area_table::average(index i0, index i1, index j0, index j1, index k0, index k1) const
+{
+    index n = count(i0, i1, j0, j1, k0, k1);
+    if (n == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return shift_ + box(sums_, i0, i1, j0, j1, k0, k1) / n;
+}
+
+double summed_area_table::window_average(index i, index j, index k, int half_window_size) const
+{
+    return average(i - half_window_size, i + half_window_size,
+                   j - half_window_size, j + half_window_size,
+                   k - half_window_size, k + half_window_size);
+}
+
+array mean_filter(const array &in, int half_window_size, unsigned int n_threads)
+{
+    const double NDV = std::numeric_limits<double>::quiet_NaN();
+    half_window_size = std::max(0, half_window_size);
+    summed_area_table table(in, n_threads);
+    array out(in.M(), in.N(), in.K());
+    const index N = in.N(), K = in.K();
+    parallel_for(in.M(), n_threads, [&](index first, index last) {
+        for (index i = first; i < last; ++i) {
+            for (index j = 0; j < N; ++j) {
+                for (index k = 0; k < K; ++k) {
+                    index cell = (i * N + j) * K + k;
+                    out.d_[cell] = std::isfinite(in.d_[cell]) ? table.window_average(i, j, k, half_window_size) : NDV;
+                }
+            }
+        }
+    });
+    return out;
+}
+
+array median_filter(const array &in, int half_window_size, unsigned int n_threads)
+{
+    const double NDV = std::numeric_limits<double>::quiet_NaN();
+    const index r = std::max(0, half_window_size);
+
+    // rank the finite values (ties broken by position)
+    std::vector<index> sorted_cells;
+    sorted_cells.reserve(in.size());
+    for (index i = 0; i < in.size(); ++i) {
+        if (std::isfinite(in.d_[i])) {
+            sorted_cells.push_back(i);
+        }
+    }
+    std::sort(sorted_cells.begin(), sorted_cells.end(), [&](index a, index b) {
+        return in.d_[a] < in.d_[b] || (in.d_[a] == in.d_[b] && a < b);
+    });
+    std::vector<index> ranks(in.size(), -1);
+    for (index rank = 0; rank < (index)sorted_cells.size(); ++rank) {
+        ranks[sorted_cells[rank]] = rank;
+    }
+
+    // the window slides along the longest axis
+    grid_axes axes(in);
+    int a = 0;
+    for (int axis = 1; axis < 3; ++axis) {
+        if (axes.extent[axis] > axes.extent[a]) {
+            a = axis;
+        }
+    }
+    const int b = a == 0 ? 1 : 0;
+    const int c = a == 2 ? 1 : 2;
+    const index length = axes.extent[a];
+    const index stride = axes.stride[a];
+
+    array out(in.M(), in.N(), in.K(), NDV);
+    parallel_for(axes.n_lines(a), n_threads, [&](index first, index last) {
+        rank_window window(sorted_cells.size());
+        std::vector<index> cross_section;
+        auto add_slab = [&](index x) {
+            for (index offset : cross_section) {
+                index rank = ranks[x * stride + offset];
+                if (rank >= 0) {
+                    window.insert(rank);
+                }
+            }
+        };
+        auto remove_slab = [&](index x) {
+            for (index offset : cross_section) {
+                index rank = ranks[x * stride + offset];
+                if (rank >= 0) {
+                    window.erase(rank);
+                }
+            }
+        };
+        for (index l = first; l < last; ++l) {
+            // the offsets of the cells in the window's cross section
+            index pb = l / axes.extent[c];
+            index pc = l % axes.extent[c];
+            cross_section.clear();
+            for (index qb = std::max<index>(0, pb - r); qb <= std::min(axes.extent[b] - 1, pb + r); ++qb) {
+                for (index qc = std::max<index>(0, pc - r); qc <= std::min(axes.extent[c] - 1, pc + r); ++qc) {
+                    cross_section.push_back(qb * axes.stride[b] + qc * axes.stride[c]);
+                }
+            }
+            const index start = pb * axes.stride[b] + pc * axes.stride[c];
+            for (index x = 0; x <= std::min(r, length - 1); ++x) {
+                add_slab(x);
+            }
+            for (index x = 0; x < length; ++x) {
+                if (x > 0) {
+                    if (x + r < length) {
+                        add_slab(x + r);
+                    }
+                    if (x - r - 1 >= 0) {
+                        remove_slab(x - r - 1);
+                    }
+                }
+                index cell = start + x * stride;
+                if (ranks[cell] >= 0) {
+                    out.d_[cell] = in.d_[sorted_cells[window.kth(window.size() / 2)]];
+                }
+            }
+            for (index x = std::max<index>(0, length - 1 - r); x < length; ++x) {
+                remove_slab(x);
+            }
+        }
+    });
+    return out;
+}
+
+array gaussian_filter(const array &in, double sigma, unsigned int n_threads)
+{
+    const double NDV = std::numeric_limits<double>::quiet_NaN();
+    array out(in.M(), in.N(), in.K());
+    if (sigma < 0.5) {
+        for (index i = 0; i < in.size(); ++i) {
+            out.d_[i] = std::isfinite(in.d_[i]) ? in.d_[i] : NDV;
+        }
+        return out;
+    }
+
+    // normalized convolution: the values (zero where not finite) and the mask of finite values
+    // are smoothed alike and then divided.
+    std::vector<double> weights(in.size());
+    for (index i = 0; i < in.size(); ++i) {
+        bool is_finite = std::isfinite(in.d_[i]);
+        out.d_[i] = is_finite ? in.d_[i] : 0.0;
+        weights[i] = is_finite ? 1.0 : 0.0;
+    }
+    recursive_gaussian filter(sigma);
+    grid_axes axes(in);
+    for (int axis = 0; axis < 3; ++axis) {
+        filter_lines(out.d_, axes, axis, n_threads, [&](std::vector<double> &line) { filter.apply(line); });
+        filter_lines(weights, axes, axis, n_threads, [&](std::vector<double> &line) { filter.apply(line); });
+    }
+    for (index i = 0; i < in.size(); ++i) {
+        out.d_[i] = std::isfinite(in.d_[i]) ? out.d_[i] / weights[i] : NDV;
+    }
+    return out;
+}
+
+array max_filter(const array &in, int half_window_size, unsigned int n_threads)
+{
+    return extremum_filter(in, half_window_size, n_threads,
+                           -std::numeric_limits<double>::infinity(), std::less<double>());
+}
+
+array min_filter(const array &in, int half_window_size, unsigned int n_threads)
+{
+    return extremum_filter(in, half_window_size, n_threads,
+                           std::numeric_limits<double>::infinity(), std::greater<double>());
+}
+
+} // namespace spectral
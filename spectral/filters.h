@@ -0,0 +1,69 @@
+/*
+Image filters for spectral::array grids.
+
+All filters ignore the non-finite values (NaN, infinity) of the input and clip the windows at the borders of
+the grid.  Each pass costs O(N) regardless of the window size (except the median, whose cost grows with the
+area of the window's cross section) and is split among threads along rows or slices.
+*/
+
+#pragma once
+
+#include "spectral.h"
+
+#include <functional>
+
+namespace spectral
+{
+
+// Runs f(first, last) for contiguous sub-ranges [first, last) of [0, n) in parallel.
+// Zero threads means the number of logical processors.
+void parallel_for(index n, unsigned int n_threads, const std::function<void(index, index)> &f);
+
+// Summed-area table of the finite values of an array (and of their count), so the sum or the
+// average of any box-shaped window is computed in constant time.
+class summed_area_table
+{
+public:
+    explicit summed_area_table(const array &in, unsigned int n_threads = 0);
+
+    // Number of finite values in the box [i0, i1] x [j0, j1] x [k0, k1].  The box is clipped to the grid.
+    index count(index i0, index i1, index j0, index j1, index k0, index k1) const;
+
+    // Average of the finite values in the box [i0, i1] x [j0, j1] x [k0, k1].  The box is clipped to the grid.
+    // Returns NaN if the box has no finite values.
+    double average(index i0, index i1, index j0, index j1, index k0, index k1) const;
+
+    // Average of the finite values in the window of the given half size centered at (i, j, k),
+    // which may lie outside the grid.  This matches array::get_window_average().
+    double window_average(index i, index j, index k, int half_window_size) const;
+
+private:
+    index M_, N_, K_;
+    // The values are summed as differences to their (rounded) mean to preserve precision.
+    double shift_;
+    std::vector<double> sums_;
+    std::vector<int> counts_;
+
+    template <typename T>
+    T box(const std::vector<T> &table, index i0, index i1, index j0, index j1, index k0, index k1) const;
+};
+
+// Mean of the finite values in the (2*half_window_size+1)^3 window around each cell.
+// Non-finite cells remain NaN.
+array mean_filter(const array &in, int half_window_size, unsigned int n_threads = 0);
+
+// Median of the finite values in the (2*half_window_size+1)^3 window around each cell (the upper median if the
+// number of values is even).  The window slides along the longest axis of the grid updating a histogram of the
+// ranks of the values (Huang's algorithm), so the result is exact.  Non-finite cells remain NaN.
+array median_filter(const array &in, int half_window_size, unsigned int n_threads = 0);
+
+// Gaussian smoothing with the recursive filter of Young and van Vliet (1995) applied separably along each axis.
+// sigma is in cells.  The non-finite cells are treated with normalized convolution and remain NaN.
+array gaussian_filter(const array &in, double sigma, unsigned int n_threads = 0);
+
+// Maximum (or minimum) of the finite values in the (2*half_window_size+1)^3 window around each cell computed
+// separably with the van Herk/Gil-Werman algorithm.  Windows without finite values yield -infinity (or +infinity).
+array max_filter(const array &in, int half_window_size, unsigned int n_threads = 0);
+array min_filter(const array &in, int half_window_size, unsigned int n_threads = 0);
+
+} // namespace spectral
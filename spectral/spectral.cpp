@@ -7,10 +7,12 @@ With contributions by Paulo R. M. Carvalho (paulo.r.m.carvalho@gmail.com)
 */
 
 #include "spectral.h"
+#include "filters.h"
 #include <cmath>
 #include <Eigen/Dense>
 #include <complex>
 #include <numeric>
+#include <atomic>
 
 namespace spectral
 {
@@ -54,10 +56,10 @@ complex_array::complex_array(const complex_array &other)
 }
 
 complex_array::complex_array(complex_array &&other)
-	: ndim_(other.ndim_), M_(other.M_), N_(other.N_), K_(other.K_), d_(other.d_)
+	: size_(other.size_), ndim_(other.ndim_), M_(other.M_), N_(other.N_), K_(other.K_), d_(other.d_)
 {
     other.d_ = nullptr;
-    other = nullptr;
+    other.size_ = 0;
 }
 
 complex_array::complex_array(const Eigen::MatrixXd &m) : M_(m.rows()), N_(m.cols()), K_(1)
@@ -196,17 +198,25 @@ fftw_complex &complex_array::operator[](index i) { return d_[i]; }
 
 void complex_array::dot(const complex_array &a, const complex_array &other)
 {
+    const fftw_complex *pa = a.d_;
+    const fftw_complex *pb = other.d_;
     for (index i = 0; i < size_; ++i) {
-        d_[i][0] = a.real(i) * other.real(i) - a.imag(i) * other.imag(i);
-        d_[i][1] = a.real(i) * other.imag(i) + a.imag(i) * other.real(i);
+        double ar = pa[i][0], ai = pa[i][1];
+        double br = pb[i][0], bi = pb[i][1];
+        d_[i][0] = ar * br - ai * bi;
+        d_[i][1] = ar * bi + ai * br;
     }
 }
 
 void complex_array::dot_conj(const complex_array &a, const complex_array &b)
 {
+    const fftw_complex *pa = a.d_;
+    const fftw_complex *pb = b.d_;
     for (index i = 0; i < size_; ++i) {
-        d_[i][0] = a.real(i) * b.real(i) + a.imag(i) * b.imag(i);
-        d_[i][1] = -a.real(i) * b.imag(i) + a.imag(i) * b.real(i);
+        double ar = pa[i][0], ai = pa[i][1];
+        double br = pb[i][0], bi = pb[i][1];
+        d_[i][0] = ar * br + ai * bi;
+        d_[i][1] = -ar * bi + ai * br;
     }
 }
 
@@ -363,19 +373,49 @@ array &array::operator=(const array &other)
 
 array &array::operator+=(const array &other)
 {
-	for (size_t i = 0; i < other.d_.size(); ++i) {
-        d_[i] += other.d_[i];
-    }
+    apply(*this, [](double a, double b) { return a + b; }, *this, other);
+    return *this;
+}
 
+array &array::operator-=(const array &other)
+{
+    apply(*this, [](double a, double b) { return a - b; }, *this, other);
     return *this;
 }
 
-array array::operator*(double scalar) const
+array &array::operator+=(double scalar)
 {
-    array result( M_, N_, K_ );
-	for (size_t i = 0; i < d_.size(); ++i)
-        result.d_[i] = d_[i] * scalar;
-    return result;
+    apply(*this, [scalar](double a) { return a + scalar; }, *this);
+    return *this;
+}
+
+array &array::operator-=(double scalar)
+{
+    apply(*this, [scalar](double a) { return a - scalar; }, *this);
+    return *this;
+}
+
+array &array::operator*=(double scalar)
+{
+    apply(*this, [scalar](double a) { return a * scalar; }, *this);
+    return *this;
+}
+
+array &array::operator/=(double scalar)
+{
+    apply(*this, [scalar](double a) { return a / scalar; }, *this);
+    return *this;
+}
+
+array array::operator*(double scalar) const &
+{
+    return map([scalar](double a) { return a * scalar; }, *this);
+}
+
+array array::operator*(double scalar) &&
+{
+    *this *= scalar;
+    return std::move(*this);
 }
 
 array array::operator*(const array &other) const
@@ -385,36 +425,48 @@ array array::operator*(const array &other) const
     return to_array( tmpMe * tmpOther );
 }
 
-array array::operator/(double scalar) const
+array array::operator/(double scalar) const &
 {
-	array result( M_, N_, K_ );
-	for (size_t i = 0; i < d_.size(); ++i)
-		result.d_[i] = d_[i] / scalar;
-	return result;
+    return map([scalar](double a) { return a / scalar; }, *this);
 }
 
-array array::operator-(double scalar) const
+array array::operator/(double scalar) &&
 {
-	array result( M_, N_, K_ );
-	for (size_t i = 0; i < d_.size(); ++i)
-		result.d_[i] = d_[i] - scalar;
-	return result;
+    *this /= scalar;
+    return std::move(*this);
 }
 
-array array::operator-(const array &other) const
+array array::operator-(double scalar) const &
 {
-    array result( M_, N_, K_ );
-	for (size_t i = 0; i < d_.size(); ++i)
-        result.d_[i] = d_[i] - other.d_[i];
-    return result;
+    return map([scalar](double a) { return a - scalar; }, *this);
 }
 
-array array::operator+(const array &other) const
+array array::operator-(double scalar) &&
 {
-    array result( M_, N_, K_ );
-    for (size_t i = 0; i < d_.size(); ++i)
-        result.d_[i] = d_[i] + other.d_[i];
-    return result;
+    *this -= scalar;
+    return std::move(*this);
+}
+
+array array::operator-(const array &other) const &
+{
+    return map([](double a, double b) { return a - b; }, *this, other);
+}
+
+array array::operator-(const array &other) &&
+{
+    *this -= other;
+    return std::move(*this);
+}
+
+array array::operator+(const array &other) const &
+{
+    return map([](double a, double b) { return a + b; }, *this, other);
+}
+
+array array::operator+(const array &other) &&
+{
+    *this += other;
+    return std::move(*this);
 }
 
 array array::getVectorColumn(index j) const
@@ -515,20 +567,26 @@ double array::avg() const
     return std::accumulate( d_.begin(), d_.end(), 0.0) / d_.size();
 }
 
-array array::sqrt() const
+array array::sqrt() const &
 {
-    array result( M_, N_, K_ );
-    for (size_t i = 0; i < d_.size(); ++i)
-        result.d_[i] = std::sqrt( d_[i] );
-    return result;
+    return map([](double a) { return std::sqrt(a); }, *this);
 }
 
-array array::sqr() const
+array array::sqrt() &&
 {
-    array result( M_, N_, K_ );
-    for (size_t i = 0; i < d_.size(); ++i)
-        result.d_[i] = d_[i] * d_[i];
-    return result;
+    apply(*this, [](double a) { return std::sqrt(a); }, *this);
+    return std::move(*this);
+}
+
+array array::sqr() const &
+{
+    return map([](double a) { return a * a; }, *this);
+}
+
+array array::sqr() &&
+{
+    apply(*this, [](double a) { return a * a; }, *this);
+    return std::move(*this);
 }
 
 double array::euclideanLength() const
@@ -1692,10 +1750,12 @@ double sumOfAbsDifference(const array &one, const array &other)
 }
 
 array operator-(double theValue, const array & theArray){
-	array result( theArray.M(), theArray.N(), theArray.K() );
-	for( int i = 0; i < theArray.size(); ++i )
-		result.d_[i] = theValue - theArray.d_[i];
-	return result;
+	return map( [theValue]( double a ){ return theValue - a; }, theArray );
+}
+
+array operator-(double theValue, array && theArray){
+	apply( theArray, [theValue]( double a ){ return theValue - a; }, theArray );
+	return std::move( theArray );
 }
 
 void standardize(array &in)
@@ -1727,10 +1787,13 @@ double angle(const array & one, const array & other)
 
 array hadamard(const array &one, const array &other)
 {
-    array result( one.M(), one.N(), one.K() );
-    for( int i = 0; i < one.size(); ++i )
-        result.d_[i] = one.d_[i] * other.d_[i];
-    return result;
+    return map( []( double a, double b ){ return a * b; }, one, other );
+}
+
+array hadamard(array &&one, const array &other)
+{
+    apply( one, []( double a, double b ){ return a * b; }, one, other );
+    return std::move( one );
 }
 
 array joinColumnVectors(const std::vector<const array *> &columnVectors)
@@ -1796,43 +1859,52 @@ complex_array to_complex_array(const array & A, const array & B)
 	return a;
 }
 
+namespace {
+	std::complex<double> polar_of( const std::complex<double> &value )
+	{
+		return std::complex<double>( std::abs( value ), std::arg( value ) ); //magnitude and phase
+	}
+
+	std::complex<double> rectangular_of( const std::complex<double> &value )
+	{
+		return std::polar( value.real(), value.imag() ); //magnitude and phase to real and imaginary parts
+	}
+}
+
 complex_array to_polar_form(const complex_array & in)
 {
-	std::complex<double> value;
-	index M = in.M();
-	index N = in.N();
-	index K = in.K();
-	complex_array out(M, N, K);
-	for (index i = 0; i < in.size(); ++i) {
-		value.real( in(i)[0] ); //real part
-		value.imag( in(i)[1] ); //imaginary part
-		out(i)[0] = std::abs( value ); //get magnitude
-		out(i)[1] = std::arg( value ); //get phase
-	}
+	complex_array out;
+	apply( out, polar_of, in );
 	return out;
 }
 
+complex_array to_polar_form(complex_array && in)
+{
+	apply( in, polar_of, in );
+	return std::move( in );
+}
+
 complex_array to_rectangular_form(const complex_array & in)
 {
-	std::complex<double> value;
-	index M = in.M();
-	index N = in.N();
-	index K = in.K();
-	complex_array out(M, N, K);
-	for (index i = 0; i < in.size(); ++i) {
-		value = std::polar( in(i)[0], in(i)[1] );
-		out(i)[0] = value.real();
-		out(i)[1] = value.imag();
-	}
+	complex_array out;
+	apply( out, rectangular_of, in );
 	return out;
 }
 
+complex_array to_rectangular_form(complex_array && in)
+{
+	apply( in, rectangular_of, in );
+	return std::move( in );
+}
+
 array operator*(double theValue, const array & theArray)
 {
-	array result( theArray.M(), theArray.N(), theArray.K() );
-	for( int i = 0; i < theArray.size(); ++i )
-		result.d_[i] = theValue * theArray.d_[i];
-    return result;
+	return theArray * theValue;
+}
+
+array operator*(double theValue, array && theArray)
+{
+	return std::move( theArray ) * theValue;
 }
 
 array get_extrema_cells( const array &in,
@@ -1853,49 +1925,32 @@ array get_extrema_cells( const array &in,
     //create the local extrema array, initialized to no-data-values.
     spectral::array localExtrema( nI, nJ, nK, NDV );
 
-    //for each cell...
-    for( int k = 0; k < nK; ++k )
-        for( int j = 0; j < nJ; ++j )
-            for( int i = 0; i < nI; ++i ){
-                bool is_a_local_extrema = true;
-                //...get its value
-                double cellValue = in( i, j, k );
-                //...evaluate the neighboring values
-                for( int offsetK = -halfWindowSize; offsetK <= halfWindowSize; ++offsetK )
-                    for( int offsetJ = -halfWindowSize; offsetJ <= halfWindowSize; ++offsetJ )
-                        for( int offsetI = -halfWindowSize; offsetI <= halfWindowSize; ++offsetI ){
-                            int neighI = i + offsetI;
-                            int neighJ = j + offsetJ;
-                            int neighK = k + offsetK;
-                            //if's to handle border cases
-                            if( neighI >= 0 && neighI < nI &&
-                                neighJ >= 0 && neighJ < nJ &&
-                                neighK >= 0 && neighK < nK &&
-                                ! (neighI == i && neighJ == j && neighK == k) /*do not compare with itself*/ ){
-                                //get neighboring value
-                                double neighValue = in( neighI, neighJ, neighK );
-                                //if it is a valid value
-                                if( std::isfinite( neighValue )){
-                                    //if the cell value is less than a neighbor's...
-                                    if( extremaType == ExtremumType::MAXIMUM &&
-                                            cellValue < neighValue )
-                                        //...it can't be a local maximum
-                                        is_a_local_extrema = false;
-                                    //if the cell value is greater than a neighbor's...
-                                    if( extremaType == ExtremumType::MINIMUM &&
-                                            cellValue > neighValue )
-                                        //...it can't be a local minimum
-                                        is_a_local_extrema = false;
-                                }
-                            }
-                        } // --- evaluate the neighboring cells
-                //if the cell is a local extrema...
-                if( is_a_local_extrema && std::abs( cellValue ) >= thresholdAbs ){
-                    //... assign the value to the grid of the local maxima envelope
-                    localExtrema( i, j, k ) = cellValue;
-                    ++count;
-                }
-            } // --- for each cell
+    //the greatest (or least) valid value in the window around each cell (separable O(N) filter).
+    //A cell is a local extremum if it is not less (or greater) than any valid neighboring value.
+    spectral::array windowExtrema = ( extremaType == ExtremumType::MAXIMUM ) ?
+                                        max_filter( in, halfWindowSize ) :
+                                        min_filter( in, halfWindowSize );
+
+    //for each cell (in parallel)...
+    std::atomic<int> extremaCount( 0 );
+    parallel_for( in.size(), 0, [&]( index first, index last ){
+        int localCount = 0;
+        for( index cell = first; cell < last; ++cell ){
+            //...get its value
+            double cellValue = in.d_[cell];
+            bool is_a_local_extrema = ( extremaType == ExtremumType::MAXIMUM ) ?
+                                          cellValue >= windowExtrema.d_[cell] :
+                                          cellValue <= windowExtrema.d_[cell];
+            //if the cell is a local extrema...
+            if( is_a_local_extrema && std::abs( cellValue ) >= thresholdAbs ){
+                //... assign the value to the grid of the local maxima envelope
+                localExtrema.d_[cell] = cellValue;
+                ++localCount;
+            }
+        }
+        extremaCount += localCount;
+    });
+    count += extremaCount;
 
     return localExtrema;
 }
@@ -1995,46 +2050,55 @@ array get_ridges_or_valleys(const array &in,
     //create the local extrema array, initialized to no-data-values.
     spectral::array localExtrema( nI, nJ, nK, NDV );
 
-    //for each cell...
-    for( int k = 0; k < nK; ++k )
-        for( int j = 0; j < nJ; ++j )
-            for( int i = 0; i < nI; ++i ){
-                //...get its value
-                double cellValue = in( i, j, k );
-                if( ! std::isfinite( cellValue ) )
-                    continue;
-                //scan the directions
-                for( int dir_vert = window_set_vert::LEVEL; dir_vert <= window_set_vert::VERTICAL; ++dir_vert )
-                    for( int dir_area = window_set_area::N_S; dir_area <= window_set_area::SE_NW; ++dir_area ){
-                        //get the steps so we have to opposing windows with the target cell in between
-                        window_steps win_steps = get_steps( static_cast<window_set_area>( dir_area ),
-                                                            static_cast<window_set_vert>( dir_vert ),
-                                                            halfWindowSize + 1 ); //+1 to not include the target cell in the windows
-                        //get the averages in two opposed windows with the target cell in between them
-                        double avg1 = in.get_window_average( i + win_steps.win1.stepI,
-                                                             j + win_steps.win1.stepJ,
-                                                             k + win_steps.win1.stepK,
-                                                             halfWindowSize );
-                        double avg2 = in.get_window_average( i + win_steps.win2.stepI,
-                                                             j + win_steps.win2.stepJ,
-                                                             k + win_steps.win2.stepK,
-                                                             halfWindowSize );
-                        //if both averages exist
-                        if( std::isfinite(avg1) && std::isfinite(avg2) ){
-                            //compute the errors with repect to the target cell
-                            double e1 = cellValue - avg1;
-                            double e2 = cellValue - avg2;
-                            //if the sign of the errors are the same, the cell belongs
-                            //to a ridge or valley (depends in whether the signs are positive or negative)
-                            if( ( ( e1 > 0.0 && e2 > 0.0 && extremaType == ExtremumType::MAXIMUM ) ||
-                                ( e1 < 0.0 && e2 < 0.0 && extremaType == ExtremumType::MINIMUM ) ) &&
-                                     std::abs( cellValue ) >= thresholdAbs ){
-                                localExtrema( i, j, k ) = cellValue;
-                                ++count;
+    //the window averages are looked up in constant time in a summed-area table.
+    summed_area_table windowAverages( in );
+
+    //for each cell (slices in parallel)...
+    std::atomic<int> extremaCount( 0 );
+    parallel_for( nI, 0, [&]( index firstI, index lastI ){
+        int localCount = 0;
+        for( int i = firstI; i < lastI; ++i )
+            for( int j = 0; j < nJ; ++j )
+                for( int k = 0; k < nK; ++k ){
+                    //...get its value
+                    double cellValue = in( i, j, k );
+                    if( ! std::isfinite( cellValue ) )
+                        continue;
+                    //scan the directions
+                    for( int dir_vert = window_set_vert::LEVEL; dir_vert <= window_set_vert::VERTICAL; ++dir_vert )
+                        for( int dir_area = window_set_area::N_S; dir_area <= window_set_area::SE_NW; ++dir_area ){
+                            //get the steps so we have to opposing windows with the target cell in between
+                            window_steps win_steps = get_steps( static_cast<window_set_area>( dir_area ),
+                                                                static_cast<window_set_vert>( dir_vert ),
+                                                                halfWindowSize + 1 ); //+1 to not include the target cell in the windows
+                            //get the averages in two opposed windows with the target cell in between them
+                            double avg1 = windowAverages.window_average( i + win_steps.win1.stepI,
+                                                                         j + win_steps.win1.stepJ,
+                                                                         k + win_steps.win1.stepK,
+                                                                         halfWindowSize );
+                            double avg2 = windowAverages.window_average( i + win_steps.win2.stepI,
+                                                                         j + win_steps.win2.stepJ,
+                                                                         k + win_steps.win2.stepK,
+                                                                         halfWindowSize );
+                            //if both averages exist
+                            if( std::isfinite(avg1) && std::isfinite(avg2) ){
+                                //compute the errors with repect to the target cell
+                                double e1 = cellValue - avg1;
+                                double e2 = cellValue - avg2;
+                                //if the sign of the errors are the same, the cell belongs
+                                //to a ridge or valley (depends in whether the signs are positive or negative)
+                                if( ( ( e1 > 0.0 && e2 > 0.0 && extremaType == ExtremumType::MAXIMUM ) ||
+                                    ( e1 < 0.0 && e2 < 0.0 && extremaType == ExtremumType::MINIMUM ) ) &&
+                                         std::abs( cellValue ) >= thresholdAbs ){
+                                    localExtrema( i, j, k ) = cellValue;
+                                    ++localCount;
+                                }
                             }
                         }
-                    }
-            }
+                }
+        extremaCount += localCount;
+    });
+    count += extremaCount;
 
     return localExtrema;
 }
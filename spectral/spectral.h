@@ -68,9 +68,10 @@ struct complex_array {
 
     fftw_complex &operator[](index i);
 
+    // this = a * other (element-wise).  this may be a or other.
     void dot(const complex_array &a, const complex_array &other);
 
-    // this  = a * b
+    // this  = a * b (b conjugated, element-wise).  this may be a or b.
     void dot_conj(const complex_array &a, const complex_array &b);
 
     fftw_array_raw data();
@@ -106,19 +107,33 @@ struct array {
     array &operator=(array &&other);
     array &operator=(const array &other);
 
+    // in-place element-wise arithmetic
     array &operator+=(const array &other);
-
-    array operator*( double scalar ) const;
-
+    array &operator-=(const array &other);
+    array &operator+=(double scalar);
+    array &operator-=(double scalar);
+    array &operator*=(double scalar);
+    array &operator/=(double scalar);
+
+    // The element-wise operators have overloads for temporaries that reuse their storage, so chains
+    // like (a - b).sqr() / n allocate a single array.  See also spectral::apply() to fuse whole expressions.
+    array operator*( double scalar ) const &;
+    array operator*( double scalar ) &&;
+
+    // matrix product
     array operator*( const array &other ) const;
 
-    array operator/( double scalar ) const;
+    array operator/( double scalar ) const &;
+    array operator/( double scalar ) &&;
 
-    array operator-( double scalar ) const;
+    array operator-( double scalar ) const &;
+    array operator-( double scalar ) &&;
 
-    array operator-( const array &other ) const;
+    array operator-( const array &other ) const &;
+    array operator-( const array &other ) &&;
 
-    array operator+( const array &other ) const;
+    array operator+( const array &other ) const &;
+    array operator+( const array &other ) &&;
 
 	array getVectorColumn( index j ) const;
 
@@ -150,8 +165,10 @@ struct array {
 	double max() const;
 	double min() const;
     double avg() const; //average or mean value
-    array sqrt() const; //square root of each element of this array
-    array sqr() const;  //square of each element of this array
+    array sqrt() const &; //square root of each element of this array
+    array sqrt() &&;
+    array sqr() const &;  //square of each element of this array
+    array sqr() &&;
 
 	double euclideanLength() const;
 
@@ -177,8 +194,70 @@ struct array {
 typedef std::shared_ptr< array > arrayPtr;
 
 array operator-( double theValue, const array& theArray );
+array operator-( double theValue, array&& theArray );
 
 array operator*( double theValue, const array& theArray );
+array operator*( double theValue, array&& theArray );
+
+namespace detail {
+// A plain loop over raw pointers, so the compiler can vectorize it.
+template <typename F, typename... Pointers>
+void apply_loop( double *out, index n, F &f, const double *first, Pointers... others )
+{
+    for( index i = 0; i < n; ++i )
+        out[i] = f( first[i], others[i]... );
+}
+}
+
+/**
+ * Fused element-wise kernel: computes out(i) = f( first(i), others(i)... ) for every element in a single pass,
+ * so a chain of arithmetic becomes one loop without intermediate arrays, e.g.
+ * spectral::apply( out, []( double re, double im ){ return re * re + im * im; }, re, im ).
+ * out takes the dimensions of first and may be one of the inputs.  All inputs must have the same size.
+ */
+template <typename F, typename... Arrays>
+void apply( array &out, F f, const array &first, const Arrays &... others )
+{
+    const index n = first.size();
+    if( &out != &first ){
+        out.ndim_ = first.ndim_;
+        out.M_ = first.M_;
+        out.N_ = first.N_;
+        out.K_ = first.K_;
+        if( out.size() != n )
+            out.d_.resize( n );
+    }
+    detail::apply_loop( out.d_.data(), n, f, first.d_.data(), others.d_.data()... );
+}
+
+/** Same as apply() but returns a new array. */
+template <typename F, typename... Arrays>
+array map( F f, const array &first, const Arrays &... others )
+{
+    array out;
+    apply( out, f, first, others... );
+    return out;
+}
+
+/**
+ * Fused element-wise kernel for complex arrays: computes out(i) = f( in(i) ) with std::complex<double>
+ * values in a single pass.  out takes the dimensions of in and may be in.
+ */
+template <typename F>
+void apply( complex_array &out, F f, const complex_array &in )
+{
+    if( &out != &in && ( out.size() != in.size() || ! out.d_ ) ){
+        out = complex_array( in.M(), in.N(), in.K() );
+    }
+    const index n = in.size();
+    fftw_complex *o = out.d_;
+    const fftw_complex *a = in.d_;
+    for( index i = 0; i < n; ++i ){
+        std::complex<double> value = f( std::complex<double>( a[i][0], a[i][1] ) );
+        o[i][0] = value.real();
+        o[i][1] = value.imag();
+    }
+}
 
 // fft 1D
 void foward(complex_array &out, double *in, index M);
@@ -315,6 +394,7 @@ double angle( const array &one, const array &other );
  * Both operands must have the same dimension and the result is another
  * array with the same dimension of the operands. */
 array hadamard( const array &one, const array &other );
+array hadamard( array &&one, const array &other );
 
 /** Makes a new array by joining the passed column vectors in a container.
  * All the input vectors must have the same number of elements.
@@ -338,11 +418,13 @@ std::pair< array, array > eig( const array &input );
  * (real and imaginary parts) to polar form (magnitude and phase).
  */
 complex_array to_polar_form(const complex_array & in );
+complex_array to_polar_form(complex_array && in ); //converts in place
 
 /** Converts a complex array (supposedly coming from a Fourier transform) that is in polar form
  * (magnitude and phase) to Cartesian form (real and imaginary parts).
  */
 complex_array to_rectangular_form(const complex_array & in );
+complex_array to_rectangular_form(complex_array && in ); //converts in place
 
 
 /**
@@ -6,13 +6,25 @@ Year: 2017
 
 #include <Eigen/Dense>
 #include <Eigen/SVD>
+#include <Eigen/QR>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
 
 namespace spectral
 {
 
 SVD::SVD(const array &A, array &&U, array &&S, array &&V)
+    : SVD(A, std::move(U), std::move(S), std::move(V), -1.0)
+{
+}
+
+SVD::SVD(const array &A, array &&U, array &&S, array &&V, double total_energy)
     : U_(std::move(U)), S_(std::move(S)), V_(std::move(V)), M_(A.M()), N_(A.N()),
-      K_(A.K()), A_(A)
+      K_(A.K()), E_(total_energy), A_(A)
 {
     if (M_ < 1)
         M_ = 1;
@@ -20,6 +32,13 @@ SVD::SVD(const array &A, array &&U, array &&S, array &&V)
         N_ = 1;
     if (K_ < 1)
         K_ = 1;
+
+    if (E_ < 0) {
+        E_ = 0;
+        for (index i = 0; i < S_.M(); ++i) {
+            E_ += S_.d_[i] * S_.d_[i];
+        }
+    }
 }
 
 array &SVD::U() { return U_; }
@@ -35,20 +54,17 @@ size_t SVD::n_factors() { return S_.M(); }
 void SVD::factor(array &f, size_t i)
 {
 	if ((index)i < S_.M()) {
-        Eigen::MatrixXd u = to_2d(U_);
-
-        Eigen::MatrixXd s = Eigen::MatrixXd::Zero(M_, N_ * K_);
-
-        s(i, i) = S_(0, i);
-
-        Eigen::MatrixXd v = to_2d(V_).transpose();
-        Eigen::MatrixXd c = u * s * v;
+        // f = u_i * s_i * v_i^T, where u_i and v_i are the i-th columns of U and V.
+        double s = S_.d_[i];
+        size_t NK = N_ * K_;
 
         for (size_t m = 0; m < M_; ++m) {
-            for (size_t n = 0; n < N_; ++n) {
-                for (size_t k = 0; k < K_; ++k) {
-                    f(m, n, k) += c(m, n * K_ + k);
-                }
+            double us = U_(m, i) * s;
+            if (us == 0.0)
+                continue;
+            double *row = f.d_.data() + m * NK;
+            for (size_t c = 0; c < NK; ++c) {
+                row[c] += us * V_(c, i);
             }
         }
     }
@@ -129,6 +145,39 @@ array SVD::factor_weights()
     return w;
 }
 
+array SVD::energy_weights()
+{
+    array w(S_.M(), 1, 1, 0);
+
+    if (E_ > 0) {
+        for (index i = 0; i < S_.M(); ++i) {
+            w(i) = S_.d_[i] * S_.d_[i] / E_;
+        }
+    }
+
+    return w;
+}
+
+double SVD::energy_ratio(size_t n)
+{
+    if (E_ <= 0)
+        return 1.0;
+
+    double e = 0;
+    for (index i = 0; i < S_.M() && i < (index)n; ++i) {
+        e += S_.d_[i] * S_.d_[i];
+    }
+
+    return std::min(1.0, e / E_);
+}
+
+double SVD::approximation_error(size_t n)
+{
+    // A_n is the orthogonal projection of A onto the first n left singular vectors,
+    // so ||A - A_n||^2 = ||A||^2 - sum of the first n squared singular values.
+    return std::sqrt(std::max(0.0, 1.0 - energy_ratio(n)));
+}
+
 SVD SVD::compute(const array &A) { return svd(A); }
 
 array SVD::solve(const array &A, const array &b) { return svd_lsq_solve(A, b); }
@@ -145,6 +194,181 @@ SVD svd(const array &A)
     return SVD(A, std::move(U), std::move(S), std::move(V));
 }
 
+namespace
+{
+
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMajorMatrix;
+
+// Runs f(first, last) for contiguous sub-ranges [first, last) of [0, n) in parallel.
+template <typename F>
+void parallel_ranges(Eigen::Index n, unsigned int n_threads, F f)
+{
+    Eigen::Index n_ranges = std::max<Eigen::Index>(1, std::min<Eigen::Index>(n_threads, n));
+    if (n_ranges == 1) {
+        f(0, n);
+        return;
+    }
+    std::vector<std::thread> threads;
+    for (Eigen::Index t = 0; t < n_ranges; ++t) {
+        threads.emplace_back(f, n * t / n_ranges, n * (t + 1) / n_ranges);
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+// The products with A are split into slabs of columns (the j slices of the grid) processed in parallel.
+class sliced_operator
+{
+public:
+    sliced_operator(const Eigen::Map<const RowMajorMatrix> &a, unsigned int n_threads)
+        : a_(a), n_threads_(n_threads)
+    {
+    }
+
+    // returns A * X
+    Eigen::MatrixXd times(const Eigen::MatrixXd &X) const
+    {
+        Eigen::Index n_ranges = std::max<Eigen::Index>(1, std::min<Eigen::Index>(n_threads_, a_.cols()));
+        std::vector<Eigen::MatrixXd> partials(n_ranges);
+        parallel_ranges(n_ranges, n_threads_, [&](Eigen::Index first, Eigen::Index last) {
+            for (Eigen::Index t = first; t < last; ++t) {
+                Eigen::Index c0 = a_.cols() * t / n_ranges;
+                Eigen::Index c1 = a_.cols() * (t + 1) / n_ranges;
+                partials[t].noalias() = a_.middleCols(c0, c1 - c0) * X.middleRows(c0, c1 - c0);
+            }
+        });
+        Eigen::MatrixXd result = partials[0];
+        for (Eigen::Index t = 1; t < n_ranges; ++t) {
+            result += partials[t];
+        }
+        return result;
+    }
+
+    // returns A^T * X
+    Eigen::MatrixXd transpose_times(const Eigen::MatrixXd &X) const
+    {
+        Eigen::MatrixXd result(a_.cols(), X.cols());
+        parallel_ranges(a_.cols(), n_threads_, [&](Eigen::Index c0, Eigen::Index c1) {
+            result.middleRows(c0, c1 - c0).noalias() = a_.middleCols(c0, c1 - c0).transpose() * X;
+        });
+        return result;
+    }
+
+private:
+    const Eigen::Map<const RowMajorMatrix> &a_;
+    unsigned int n_threads_;
+};
+
+// Makes the columns of Y orthonormal and orthogonal to the columns of Q.
+void orthonormalize(Eigen::MatrixXd &Y, const Eigen::MatrixXd &Q)
+{
+    // projecting twice avoids the loss of orthogonality of classical Gram-Schmidt.
+    for (int pass = 0; pass < 2 && Q.cols() > 0; ++pass) {
+        Y -= Q * (Q.transpose() * Y);
+    }
+    Eigen::HouseholderQR<Eigen::MatrixXd> qr(Y);
+    Y = qr.householderQ() * Eigen::MatrixXd::Identity(Y.rows(), Y.cols());
+}
+
+} // namespace
+
+SVD svd_truncated(const array &A, const truncated_svd_settings &settings)
+{
+    index M = std::max<index>(1, A.M());
+    index NK = std::max<index>(1, A.N()) * std::max<index>(1, A.K());
+
+    // the array layout is the row-major layout of to_2d(A), so there is no need to copy A.
+    Eigen::Map<const RowMajorMatrix> a(A.d_.data(), M, NK);
+
+    unsigned int n_threads = settings.n_threads;
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    sliced_operator op(a, n_threads);
+
+    double total_energy = a.squaredNorm();
+    index rank_bound = std::min(M, NK);
+    index max_factors = settings.max_factors > 0 ? std::min<index>(settings.max_factors, rank_bound) : rank_bound;
+    index max_basis = std::min<index>(rank_bound, max_factors + settings.oversampling);
+    index block_size = std::max<index>(1, settings.block_size);
+
+    std::mt19937 rng(settings.seed);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    // Q: orthonormal basis of the range of A; B = Q^T A.
+    Eigen::MatrixXd Q(M, 0);
+    Eigen::MatrixXd B(0, NK);
+    double captured_energy = 0;
+    bool target_reached = false;
+
+    while (Q.cols() < max_basis && total_energy > 0) {
+        index b = std::min<index>(target_reached ? std::max<index>(1, settings.oversampling) : block_size,
+                                  max_basis - Q.cols());
+
+        Eigen::MatrixXd omega(NK, b);
+        for (index i = 0; i < omega.size(); ++i) {
+            omega.data()[i] = normal(rng);
+        }
+        Eigen::MatrixXd Y = op.times(omega);
+        for (int q = 0; q < settings.power_iterations; ++q) {
+            orthonormalize(Y, Q);
+            Eigen::MatrixXd Z = op.transpose_times(Y);
+            Eigen::HouseholderQR<Eigen::MatrixXd> qr(Z);
+            Z = qr.householderQ() * Eigen::MatrixXd::Identity(Z.rows(), Z.cols());
+            Y = op.times(Z);
+        }
+        orthonormalize(Y, Q);
+
+        Eigen::MatrixXd Bb = op.transpose_times(Y).transpose();
+        double block_energy = Bb.squaredNorm();
+
+        Eigen::MatrixXd Qn(M, Q.cols() + b);
+        Qn << Q, Y;
+        Q.swap(Qn);
+        Eigen::MatrixXd Bn(B.rows() + b, NK);
+        Bn << B, Bb;
+        B.swap(Bn);
+        captured_energy += block_energy;
+
+        if (target_reached)
+            break;
+        // the range of A is exhausted (A has low rank).
+        if (block_energy <= 1e-14 * total_energy)
+            break;
+        if (captured_energy >= settings.target_energy * total_energy) {
+            if (settings.oversampling == 0)
+                break;
+            target_reached = true;
+        }
+    }
+
+    if (Q.cols() == 0) {
+        // A is null.
+        return SVD(A, array(M, (index)1, 0.0), array((index)1, (index)1, 0.0), array(NK, (index)1, 0.0),
+                   total_energy);
+    }
+
+    // SVD of the small matrix B = Ub S V^T, then A ~ Q B = (Q Ub) S V^T.
+    Eigen::BDCSVD<Eigen::MatrixXd> svd(B, Eigen::ComputeThinU | Eigen::ComputeThinV);
+    const Eigen::VectorXd &s = svd.singularValues();
+
+    // keep the fewest factors that retain the target energy.
+    index n = 0;
+    double retained = 0;
+    while (n < s.size() && n < max_factors) {
+        retained += s(n) * s(n);
+        ++n;
+        if (retained >= settings.target_energy * total_energy)
+            break;
+    }
+
+    Eigen::MatrixXd u = Q * svd.matrixU().leftCols(n);
+    Eigen::MatrixXd sn = s.head(n);
+    Eigen::MatrixXd v = svd.matrixV().leftCols(n);
+
+    return SVD(A, to_array(u), to_array(sn), to_array(v), total_energy);
+}
+
 array svd_lsq_solve(const array &A, const array &B)
 {
     auto a = to_2d(A);
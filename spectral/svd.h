@@ -14,6 +14,9 @@ class SVD
 {
 public:
     SVD(const array &A, array &&U, array &&S, array &&V);
+    // total_energy is the squared Frobenius norm of A, needed when U, S and V hold only
+    // the leading factors (truncated SVD).  A negative value means the sum of squares of S.
+    SVD(const array &A, array &&U, array &&S, array &&V, double total_energy);
 
     array &U();
     array &S();
@@ -32,6 +35,14 @@ public:
 
     array factor_weights();
 
+    // squared singular values divided by the energy of A (the squared Frobenius norm),
+    // which is meaningful also when only the leading factors were computed.
+    array energy_weights();
+    // fraction of the energy of A retained by the first n factors.
+    double energy_ratio(size_t n);
+    // relative error ||A - A_n||_F / ||A||_F of the approximation with the first n factors.
+    double approximation_error(size_t n);
+
     static SVD compute(const array &A);
     static array solve(const array &A, const array &b);
 
@@ -44,10 +55,36 @@ private:
     size_t N_;
     size_t K_;
 
+    double E_;
+
     const array &A_;
 };
 
 SVD svd(const array &A);
+
+// settings of svd_truncated().
+struct truncated_svd_settings {
+    // stop when the factors retain this fraction of the energy of A.
+    double target_energy = 1.0;
+    // maximum number of factors (0 means no limit other than the rank of A).
+    size_t max_factors = 0;
+    // number of basis vectors added to the range of A at each iteration.
+    size_t block_size = 8;
+    // extra basis vectors computed after the target is reached to improve the accuracy of the last factors.
+    size_t oversampling = 8;
+    // power iterations per block: more iterations are needed if the singular values decay slowly.
+    int power_iterations = 1;
+    // number of threads for the products with A (0 means the number of logical processors).
+    unsigned int n_threads = 0;
+    unsigned int seed = 0;
+};
+
+// Computes only the leading factors of the SVD with the randomized range finder of
+// Halko, Martinsson and Tropp (2011).  The basis of the range of A is grown in blocks
+// until it retains the target energy, so it is much faster than svd() for large grids
+// whose information is concentrated in a few factors.  U, S and V are thin:
+// M x n, n x 1 and (N*K) x n.
+SVD svd_truncated(const array &A, const truncated_svd_settings &settings = truncated_svd_settings());
 array svd_lsq_solve(const array &A, const array &b);
 
 } // namespace spectral
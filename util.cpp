@@ -30,6 +30,7 @@
 #include "gslib/gslib.h"
 #include "graphviz/graphviz.h"
 #include "dialogs/displayplotdialog.h"
+#include "dialogs/nativeplotdialog.h"
 #include "dialogs/distributioncolumnrolesdialog.h"
 #include <QDir>
 #include <QFileInfo>
@@ -46,6 +47,8 @@
 #include <QStringBuilder>
 #include <QMessageBox>
 #include <algorithm>
+#include <thread>
+#include <limits>
 
 //includes for getPhysicalRAMusage()
 #ifdef Q_OS_WIN
@@ -297,6 +300,26 @@ uint Util::getFirstNumber(const QString line)
     return result;
 }
 
+double Util::getGEOEASLineValue(const char *line, int length, int column)
+{
+    auto isSeparator = []( char c ){ return c == ' ' || c == '\t' || c == ',' || c == '\r' || c == '\n'; };
+    int i = 0;
+    for( int iColumn = 0; ; ++iColumn ){
+        while( i < length && isSeparator( line[i] ) )
+            ++i;
+        int start = i;
+        while( i < length && ! isSeparator( line[i] ) )
+            ++i;
+        if( start == i )
+            return std::numeric_limits<double>::quiet_NaN();
+        if( iColumn == column ){
+            bool ok;
+            double value = QByteArray::fromRawData( line + start, i - start ).toDouble( &ok );
+            return ok ? value : std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+}
+
 QString Util::getValuesFromParFileLine(const QString line)
 {
     QString result;
@@ -633,6 +656,23 @@ void Util::createGEOEASGridFile(const QString gridDescription,
 
 bool Util::viewGrid(Attribute *variable, QWidget* parent = 0, bool modal, CategoryDefinition *cd)
 {
+    //render the plot natively, if so configured and if the grid can be rendered natively
+    NativePlotDialog *npd = nullptr;
+    if( Application::instance()->getUseNativePlotsSetting() ){
+        npd = NativePlotDialog::makePixelPlot( variable, cd, parent );
+        if( ! npd )
+            Application::instance()->logInfo( "Util::viewGrid(): the native plot only renders non-rotated Cartesian"
+                                              " grids.  Using pixelplt instead." );
+    }
+    if( npd ){
+        if( modal ){
+            int response = npd->exec();
+            return response == QDialog::Accepted;
+        }
+        npd->show();
+        return false;
+    }
+
     //get input data file
     //the parent component of an attribute is a file
     //assumes the file is a Cartesian Grid, since the user is calling pixelplt
@@ -753,6 +793,17 @@ bool Util::viewGrid(Attribute *variable, QWidget* parent = 0, bool modal, Catego
 
 bool Util::viewPointSet(Attribute *variable, QWidget *parent, bool modal)
 {
+    //render the plot natively, if so configured
+    if( Application::instance()->getUseNativePlotsSetting() ){
+        NativePlotDialog *npd = NativePlotDialog::makeLocationMap( variable, parent );
+        if( modal ){
+            int response = npd->exec();
+            return response == QDialog::Accepted;
+        }
+        npd->show();
+        return false;
+    }
+
     //get input data file
     //the parent component of an attribute is a file
     //assumes the file is a Point Set, since the user is calling locmap
@@ -845,6 +896,13 @@ bool Util::viewPointSet(Attribute *variable, QWidget *parent, bool modal)
 
 void Util::viewXPlot(Attribute *xVariable, Attribute *yVariable, QWidget *parent, Attribute *zVariable)
 {
+    //render the plot natively, if so configured
+    if( Application::instance()->getUseNativePlotsSetting() ){
+        NativePlotDialog *npd = NativePlotDialog::makeCrossPlot( xVariable, yVariable, zVariable, parent );
+        npd->show(); //show() makes dialog modalless
+        return;
+    }
+
     //get the selected attributes
     Attribute* var1 = xVariable;
     Attribute* var2 = yVariable;
@@ -1805,6 +1863,17 @@ void Util::assureNonZeroWindow(double &outMin,
 
 bool Util::viewHistogram(Attribute *at, QWidget *parent, bool modal)
 {
+    //render the plot natively, if so configured
+    if( Application::instance()->getUseNativePlotsSetting() ){
+        NativePlotDialog *npd = NativePlotDialog::makeHistogram( at, parent );
+        if( modal ){
+            int response = npd->exec();
+            return response == QDialog::Accepted;
+        }
+        npd->show();
+        return false;
+    }
+
     //get input data file
     //the parent component of an attribute is a file
     DataFile* input_data_file = dynamic_cast<DataFile*>(at->getContainingFile());
@@ -1979,36 +2048,31 @@ spectral::array Util::getVarmapFIM(const spectral::array &inputData)
     spectral::array temp = inputData; //make local copy because spectral::foward()'s parameters are not const
     spectral::foward( inputFFT, temp );
 
-    //convert the FT of the input to polar form
-    spectral::complex_array inputFFTpolar = spectral::to_polar_form( inputFFT );
-
-    //get the amplitudes
-    spectral::array inputFFTamplitudes = spectral::real( inputFFTpolar );
-
-    //get the spectral density
+    //replace each complex value of the FT by the spectral density (squared amplitude) with zero phase,
+    //which in rectangular form is just a real number, in a single pass over the FT.
     //NOTE: the division by ( nI * nJ * nK ) is due to FFTW's implementation's issue with scale. It is not from theory.
-    spectral::array inputSpectralDensity = inputFFTamplitudes.sqr() / static_cast<double>( nI * nJ * nK );
-
-    //make a polar FT image with the spectral density as amplitudes and0 zeros as phases
-    spectral::array zeroPhases( nI, nJ, nK, 0.0 );
-    spectral::complex_array varmapFFTpolar = spectral::to_complex_array( inputSpectralDensity, zeroPhases );
-
-    //convert the FT to Cartesian form
-    spectral::complex_array varmapFFT = spectral::to_rectangular_form(  varmapFFTpolar );
+    const double nCells = static_cast<double>( nI * nJ * nK );
+    spectral::apply( inputFFT,
+                     [nCells]( std::complex<double> value ){ return std::complex<double>( std::norm( value ) / nCells, 0.0 ); },
+                     inputFFT );
 
     //get the covariance values by reversing the FT
     spectral::array varmap( nI, nJ, nK, 0.0 );
-    spectral::backward( varmap, varmapFFT );
+    spectral::backward( varmap, inputFFT );
 
     //centralize h=0 for ease of interpretation
     varmap = spectral::shiftByHalf( varmap );
 
     //put the covariance in the correct scale (FFTW implementation characteristic, not from theory)
-    varmap = varmap / static_cast<double>( nI * nJ * nK );
-    varmap = varmap - varmap.min();
+    varmap /= nCells;
 
     //convert covariance values to semivariances (zero @ h=0)
-    varmap = varmap.max() - varmap;
+    //this is ( max - min ) - ( value - min ) computed in one pass.
+    const double minCovariance = varmap.min();
+    const double maxCovariance = varmap.max();
+    spectral::apply( varmap,
+                     [minCovariance, maxCovariance]( double value ){ return ( maxCovariance - minCovariance ) - ( value - minCovariance ); },
+                     varmap );
 
     return varmap;
 }
@@ -2276,7 +2340,14 @@ std::vector<hFTM> Util::computeFaciesTransitionMatrices(std::vector<Attribute*>&
         hFTMs.push_back( { h, ftmAll } );
     }
 
-    //for each file (each categorical attribute)
+    if( hFTMs.empty() )
+        return hFTMs;
+    const int nFacies = hFTMs.front().second.getRowCount();
+
+    //for each file (each categorical attribute), locate its data along its trajectory only once for all separations.
+    //this reads the files, so it is done serially.
+    std::vector< FTMMakerAdapters::TrajectoryIndex > trajectories;
+    std::vector< std::vector< int > > faciesIndexes;
     for( Attribute* at : categoricalAttributes ){
         //get the data file
         DataFile* dataFile = dynamic_cast<DataFile*>( at->getContainingFile() );
@@ -2286,37 +2357,51 @@ std::vector<hFTM> Util::computeFaciesTransitionMatrices(std::vector<Attribute*>&
         if( dataFile->getFileType() == "SEGMENTSET" ){
             //load data from file system
             dataFile->readFromFS();
-            //make an auxiliary object to count facies transitions at given separations
-            FaciesTransitionMatrixMaker<SegmentSet> ftmMaker( dynamic_cast<SegmentSet*>(dataFile),
-                                                              at->getAttributeGEOEASgivenIndex()-1 );
-            //for each separation h
-            for( hFTM& hftm : hFTMs ){
-                Application::instance()->logInfo("   working on h = " + QString::number( hftm.first ) + "...");
-                QApplication::processEvents();
-                //make a Facies Transion Matrix for a given h
-                FaciesTransitionMatrix ftm = ftmMaker.makeAlongTrajectory( hftm.first, toleranceCoefficient * hftm.first );
-                //add its counts to the global FTM for a given h
-                hftm.second.add( ftm );
-            }
+            trajectories.push_back( FTMMakerAdapters::makeTrajectoryIndex( dynamic_cast<SegmentSet*>(dataFile),
+                                                                           at->getAttributeGEOEASgivenIndex()-1 ) );
         } else if ( dataFile->getFileType() == "POINTSET" ) {
             //load data from file system
             dataFile->readFromFS();
-            //make an auxiliary object to count facies transitions at given separations
-            FaciesTransitionMatrixMaker<PointSet> ftmMaker( dynamic_cast<PointSet*>(dataFile),
-                                                              at->getAttributeGEOEASgivenIndex()-1 );
-            //for each separation h
-            for( hFTM& hftm : hFTMs ){
-                Application::instance()->logInfo("   working on h = " + QString::number( hftm.first ) + "...");
-                QApplication::processEvents();
-                //make a Facies Transion Matrix for a given h
-                FaciesTransitionMatrix ftm = ftmMaker.makeAlongTrajectory( hftm.first, toleranceCoefficient * hftm.first );
-                //add its counts to the global FTM for a given h
-                hftm.second.add( ftm );
-            }
+            trajectories.push_back( FTMMakerAdapters::makeTrajectoryIndex( dynamic_cast<PointSet*>(dataFile),
+                                                                           at->getAttributeGEOEASgivenIndex()-1 ) );
         } else {
             Application::instance()->logError("Util::computeFaciesTransitionMatrix(): Data files of type " +
                                                dataFile->getFileType()+ " not currently supported.  Transiogram calculation will be incomplete or not done at all.", true);
+            continue;
         }
+        //the category definition is assumed the same for all variables.
+        faciesIndexes.push_back( trajectories.back().getFaciesIndexes( hFTMs.front().second ) );
+    }
+
+    //count the facies transitions of every file at every separation h in parallel.
+    const int nTasks = trajectories.size() * hFTMs.size();
+    std::vector< std::vector< double > > counts( nTasks, std::vector< double >( nFacies * nFacies, 0.0 ) );
+    if( nTasks > 0 ){
+        Application::instance()->logInfo("Counting facies transitions...");
+        QApplication::processEvents();
+        unsigned int nThreads = std::max( 1, std::min( (int)std::thread::hardware_concurrency(), nTasks ) );
+        std::vector< std::pair< int, int > > ranges = Util::generateSubRanges( 0, nTasks - 1, nThreads );
+        std::vector< std::thread > threads;
+        for( const std::pair< int, int >& range : ranges )
+            threads.push_back( std::thread( [&, range](){
+                for( int iTask = range.first; iTask <= range.second; ++iTask ){
+                    int iTrajectory = iTask / hFTMs.size();
+                    double h = hFTMs[ iTask % hFTMs.size() ].first;
+                    trajectories[ iTrajectory ].countTransitions( h, toleranceCoefficient * h,
+                                                                  faciesIndexes[ iTrajectory ], nFacies,
+                                                                  counts[ iTask ] );
+                }
+            }));
+        for( std::thread& thread : threads )
+            thread.join();
+    }
+
+    //add the counts to the global FTM of each h
+    for( int iTask = 0; iTask < nTasks; ++iTask ){
+        FaciesTransitionMatrix& ftm = hFTMs[ iTask % hFTMs.size() ].second;
+        for( int i = 0; i < nFacies; ++i )
+            for( int j = 0; j < nFacies; ++j )
+                ftm.addCount( i, j, counts[ iTask ][ i * nFacies + j ] );
     }
 
     return hFTMs;
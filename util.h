@@ -227,6 +227,13 @@ public:
      */
     static uint getFirstNumber(const QString line);
 
+    /**
+     * Returns the value in the given column (starting with 0) of a GEO-EAS data line, which needs not be
+     * null-terminated.  Returns NaN if the line has fewer columns or the value is not a number.
+     * This is much faster than splitting the line into QStrings when reading large files.
+     */
+    static double getGEOEASLineValue( const char* line, int length, int column );
+
     /**
      * Returns the part of a GSLib parameter file line before the hiphen signaling the
      * line comment.
@@ -328,6 +335,7 @@ public:
      * @param parent Parent QWidget for the plot dialog.
      * @param modal If true, the method returns only when the user closes the Plot Dialog.
      * @param cd If informed, the grid is renderd as a categorical variable.
+     * @note If Application::getUseNativePlotsSetting() is true, the plot is rendered by PixelPlotWidget instead.
      * @return True if modal == true and if the user did not cancel the Plot Dialog; false
      * otherwise.
      */
@@ -339,6 +347,7 @@ public:
      * variable in a point set file.
      * @param parent Parent QWidget for the plot dialog.
      * @param modal If true, the method returns only when the user closes the Plot Dialog.
+     * @note If Application::getUseNativePlotsSetting() is true, the plot is rendered by LocationMapWidget instead.
      */
     static bool viewPointSet(Attribute *variable, QWidget *parent, bool modal = false);
 
@@ -347,6 +356,7 @@ public:
      * a crossplot between two or three variable.
      * @param parent Parent QWidget for the plot dialog.
      * @note This method assumes all variables belong to the same parent file.
+     * @note If Application::getUseNativePlotsSetting() is true, the plot is rendered by ScatterPlotWidget instead.
      */
     static void viewXPlot(Attribute *xVariable, Attribute *yVariable, QWidget *parent,
                           Attribute *zVariable = nullptr);
@@ -621,6 +631,7 @@ public:
      * @param modal If true, the method returns only when the user closes the Plot Dialog.
      * @return True if modal == true and if the user did not cancel the Plot Dialog; false
      * otherwise.
+     * @note If Application::getUseNativePlotsSetting() is true, the plot is rendered by HistogramPlotWidget instead.
      */
     static bool viewHistogram(Attribute *at, QWidget *parent = nullptr,
                               bool modal = false);
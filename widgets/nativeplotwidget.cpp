@@ -0,0 +1,746 @@
+#include "nativeplotwidget.h"
+
+#include "util.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    //margins around the plot area in pixels
+    const int LEFT_MARGIN   = 70;
+    const int RIGHT_MARGIN  = 15;
+    const int TOP_MARGIN    = 30;
+    const int BOTTOM_MARGIN = 45;
+
+    /** Returns a "nice" step (1, 2 or 5 times a power of ten) to divide the given range in about nSteps steps. */
+    double getNiceStep( double range, int nSteps ){
+        if( range <= 0.0 )
+            return 1.0;
+        double rawStep = range / nSteps;
+        double magnitude = std::pow( 10.0, std::floor( std::log10( rawStep ) ) );
+        double normalized = rawStep / magnitude;
+        if( normalized < 1.5 )
+            return magnitude;
+        if( normalized < 3.5 )
+            return 2.0 * magnitude;
+        if( normalized < 7.5 )
+            return 5.0 * magnitude;
+        return 10.0 * magnitude;
+    }
+
+    /** Expands a [min, max] window by the given fraction of its size at each side and
+     * makes sure it has non-zero size. */
+    void padWindow( double& min, double& max, double fraction ){
+        if( Util::almostEqual2sComplement( min, max, 1 ) ){
+            double delta = std::abs( min ) > 0.0 ? std::abs( min ) / 10.0 : 1.0;
+            min -= delta;
+            max += delta;
+            return;
+        }
+        double pad = ( max - min ) * fraction;
+        min -= pad;
+        max += pad;
+    }
+
+    /** Returns the min and max of the values. */
+    void getMinMax( const std::vector<double>& values, double& min, double& max ){
+        min = std::numeric_limits<double>::max();
+        max = -std::numeric_limits<double>::max();
+        for( double value : values ){
+            min = std::min( min, value );
+            max = std::max( max, value );
+        }
+        if( values.empty() ){
+            min = 0.0;
+            max = 1.0;
+        }
+    }
+}
+
+NativePlotWidget::NativePlotWidget(QWidget *parent) : QWidget(parent),
+    m_xMin( 0.0 ), m_xMax( 1.0 ), m_yMin( 0.0 ), m_yMax( 1.0 ),
+    m_logX( false ),
+    m_keepAspectRatio( false ),
+    m_rightMarginWidth( 0 )
+{
+    setMinimumSize( 400, 300 );
+    setBackgroundRole( QPalette::Base );
+    setAutoFillBackground( true );
+}
+
+void NativePlotWidget::setLogScaleX(bool value)
+{
+    m_logX = value;
+    update();
+}
+
+QImage NativePlotWidget::renderToImage(const QSize &size)
+{
+    QImage image( size, QImage::Format_ARGB32 );
+    image.fill( Qt::white );
+    QPainter painter( &image );
+    paint( painter, QRect( QPoint( 0, 0 ), size ) );
+    return image;
+}
+
+void NativePlotWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED( event );
+    QPainter painter( this );
+    paint( painter, rect() );
+}
+
+void NativePlotWidget::setWindow(double xMin, double xMax, double yMin, double yMax)
+{
+    m_xMin = xMin;
+    m_xMax = xMax;
+    m_yMin = yMin;
+    m_yMax = yMax;
+}
+
+double NativePlotWidget::toScreenX(double x, const QRect &plotArea) const
+{
+    double t;
+    if( m_logX && m_xMin > 0.0 ){
+        double lMin = std::log10( m_xMin );
+        double lMax = std::log10( m_xMax );
+        t = ( std::log10( std::max( x, m_xMin ) ) - lMin ) / ( lMax - lMin );
+    } else
+        t = ( x - m_xMin ) / ( m_xMax - m_xMin );
+    return plotArea.left() + t * plotArea.width();
+}
+
+double NativePlotWidget::toScreenY(double y, const QRect &plotArea) const
+{
+    double t = ( y - m_yMin ) / ( m_yMax - m_yMin );
+    return plotArea.bottom() - t * plotArea.height();
+}
+
+QRgb NativePlotWidget::getRainbowColor(double t) const
+{
+    //sample the rainbow color table only once (Util::getColorFromValue() is too slow to be called per pixel).
+    if( m_rainbow.empty() ){
+        m_rainbow.reserve( 256 );
+        for( int i = 0; i < 256; ++i )
+            m_rainbow.push_back( Util::getColorFromValue( i / 255.0, ColorTable::RAINBOW, 0.0, 1.0 ).rgb() );
+    }
+    if( ! ( t > 0.0 ) ) //also catches NaN
+        return m_rainbow.front();
+    if( t >= 1.0 )
+        return m_rainbow.back();
+    return m_rainbow[ static_cast<int>( t * 255.0 + 0.5 ) ];
+}
+
+void NativePlotWidget::paintColorScale(QPainter &painter, const QRect &area, double min, double max, const QString &caption)
+{
+    const int barWidth = 20;
+    QFontMetrics fm = painter.fontMetrics();
+    painter.setPen( Qt::black );
+    painter.drawText( area.left(), area.top() + fm.ascent(), caption );
+    QRect bar( area.left(), area.top() + fm.height() + 5, barWidth, area.height() - fm.height() - 10 );
+    if( bar.height() < 10 )
+        return;
+    for( int iRow = 0; iRow <= bar.height(); ++iRow ){
+        painter.setPen( QColor( getRainbowColor( 1.0 - iRow / static_cast<double>( bar.height() ) ) ) );
+        painter.drawLine( bar.left(), bar.top() + iRow, bar.right(), bar.top() + iRow );
+    }
+    painter.setPen( Qt::black );
+    painter.setBrush( Qt::NoBrush );
+    painter.drawRect( bar );
+    const int nTicks = 5;
+    for( int iTick = 0; iTick <= nTicks; ++iTick ){
+        double t = iTick / static_cast<double>( nTicks );
+        int y = bar.bottom() - static_cast<int>( t * bar.height() );
+        painter.drawLine( bar.right(), y, bar.right() + 4, y );
+        painter.drawText( bar.right() + 7, y + fm.ascent() / 2, QString::number( min + t * ( max - min ), 'g', 4 ) );
+    }
+}
+
+void NativePlotWidget::paint(QPainter &painter, const QRect &area)
+{
+    painter.fillRect( area, Qt::white );
+
+    QRect plotArea = area.adjusted( LEFT_MARGIN, TOP_MARGIN, -( RIGHT_MARGIN + m_rightMarginWidth ), -BOTTOM_MARGIN );
+    if( plotArea.width() < 10 || plotArea.height() < 10 )
+        return;
+
+    //shrink the plot area to the aspect ratio of the data window if required (e.g. maps)
+    if( m_keepAspectRatio && m_xMax > m_xMin && m_yMax > m_yMin ){
+        double dataAspect = ( m_xMax - m_xMin ) / ( m_yMax - m_yMin );
+        double areaAspect = plotArea.width() / static_cast<double>( plotArea.height() );
+        if( dataAspect > areaAspect ){
+            int newHeight = static_cast<int>( plotArea.width() / dataAspect );
+            plotArea.setTop( plotArea.top() + ( plotArea.height() - newHeight ) / 2 );
+            plotArea.setHeight( newHeight );
+        } else {
+            int newWidth = static_cast<int>( plotArea.height() * dataAspect );
+            plotArea.setWidth( newWidth );
+        }
+    }
+
+    //title
+    QFont font = painter.font();
+    QFont titleFont = font;
+    titleFont.setBold( true );
+    painter.setFont( titleFont );
+    painter.setPen( Qt::black );
+    painter.drawText( QRect( area.left(), area.top(), area.width(), TOP_MARGIN ), Qt::AlignCenter, m_title );
+    painter.setFont( font );
+
+    //the plot contents
+    painter.save();
+    painter.setClipRect( plotArea );
+    paintPlotArea( painter, plotArea );
+    painter.restore();
+
+    paintAxes( painter, plotArea );
+
+    //the side area (e.g. color scale)
+    if( m_rightMarginWidth > 0 ){
+        QRect sideArea( plotArea.right() + RIGHT_MARGIN, plotArea.top(), m_rightMarginWidth, plotArea.height() );
+        painter.save();
+        paintSideArea( painter, sideArea );
+        painter.restore();
+    }
+}
+
+void NativePlotWidget::paintAxes(QPainter &painter, const QRect &plotArea)
+{
+    QFontMetrics fm = painter.fontMetrics();
+    painter.setPen( Qt::black );
+    painter.setBrush( Qt::NoBrush );
+    painter.drawRect( plotArea );
+
+    //X axis ticks
+    if( m_logX && m_xMin > 0.0 ){
+        for( int exponent = static_cast<int>( std::floor( std::log10( m_xMin ) ) );
+             exponent <= static_cast<int>( std::ceil( std::log10( m_xMax ) ) ); ++exponent ){
+            double value = std::pow( 10.0, exponent );
+            if( value < m_xMin || value > m_xMax )
+                continue;
+            int x = static_cast<int>( toScreenX( value, plotArea ) );
+            painter.drawLine( x, plotArea.bottom(), x, plotArea.bottom() + 5 );
+            QString label = QString::number( value, 'g', 4 );
+            painter.drawText( x - fm.width( label ) / 2, plotArea.bottom() + 7 + fm.ascent(), label );
+        }
+    } else {
+        double step = getNiceStep( m_xMax - m_xMin, 6 );
+        for( double value = std::ceil( m_xMin / step ) * step; value <= m_xMax + step * 1E-6; value += step ){
+            int x = static_cast<int>( toScreenX( value, plotArea ) );
+            painter.drawLine( x, plotArea.bottom(), x, plotArea.bottom() + 5 );
+            QString label = QString::number( std::abs( value ) < step * 1E-6 ? 0.0 : value, 'g', 6 );
+            painter.drawText( x - fm.width( label ) / 2, plotArea.bottom() + 7 + fm.ascent(), label );
+        }
+    }
+
+    //Y axis ticks
+    {
+        double step = getNiceStep( m_yMax - m_yMin, 6 );
+        for( double value = std::ceil( m_yMin / step ) * step; value <= m_yMax + step * 1E-6; value += step ){
+            int y = static_cast<int>( toScreenY( value, plotArea ) );
+            painter.drawLine( plotArea.left() - 5, y, plotArea.left(), y );
+            QString label = QString::number( std::abs( value ) < step * 1E-6 ? 0.0 : value, 'g', 6 );
+            painter.drawText( plotArea.left() - 8 - fm.width( label ), y + fm.ascent() / 2, label );
+        }
+    }
+
+    //axes labels
+    painter.drawText( QRect( plotArea.left(), plotArea.bottom() + 7 + fm.height(), plotArea.width(), fm.height() ),
+                      Qt::AlignCenter, m_xLabel );
+    painter.save();
+    painter.translate( plotArea.left() - LEFT_MARGIN + 2, plotArea.center().y() );
+    painter.rotate( -90.0 );
+    painter.drawText( QRect( -plotArea.height() / 2, 0, plotArea.height(), fm.height() ), Qt::AlignCenter, m_yLabel );
+    painter.restore();
+}
+
+/////////////////////////////////////////////  HistogramPlotWidget  ////////////////////////////////////////////////
+
+HistogramPlotWidget::HistogramPlotWidget(QWidget *parent) : NativePlotWidget( parent ),
+    m_nBins( 40 ),
+    m_cumulative( false ),
+    m_mean( 0.0 ), m_stdDev( 0.0 ), m_min( 0.0 ), m_max( 0.0 ),
+    m_lowerQuartile( 0.0 ), m_median( 0.0 ), m_upperQuartile( 0.0 )
+{
+    setRightMarginWidth( 170 );
+    setYLabel( "Frequency" );
+}
+
+void HistogramPlotWidget::setData(const std::vector<double> &values, const std::vector<double> &weights)
+{
+    //sort the values along with their weights (needed to compute the quantiles)
+    m_sortedValuesAndWeights.clear();
+    m_sortedValuesAndWeights.reserve( values.size() );
+    double sumWeights = 0.0;
+    for( size_t i = 0; i < values.size(); ++i ){
+        double weight = weights.empty() ? 1.0 : weights[i];
+        m_sortedValuesAndWeights.push_back( { values[i], weight } );
+        sumWeights += weight;
+    }
+    std::sort( m_sortedValuesAndWeights.begin(), m_sortedValuesAndWeights.end() );
+    if( sumWeights > 0.0 )
+        for( std::pair<double, double>& valueAndWeight : m_sortedValuesAndWeights )
+            valueAndWeight.second /= sumWeights;
+
+    //compute the summary statistics
+    m_mean = 0.0;
+    for( const std::pair<double, double>& valueAndWeight : m_sortedValuesAndWeights )
+        m_mean += valueAndWeight.first * valueAndWeight.second;
+    double variance = 0.0;
+    for( const std::pair<double, double>& valueAndWeight : m_sortedValuesAndWeights )
+        variance += ( valueAndWeight.first - m_mean ) * ( valueAndWeight.first - m_mean ) * valueAndWeight.second;
+    m_stdDev = std::sqrt( variance );
+    if( ! m_sortedValuesAndWeights.empty() ){
+        m_min = m_sortedValuesAndWeights.front().first;
+        m_max = m_sortedValuesAndWeights.back().first;
+        double cumulative = 0.0;
+        bool lowerQuartileSet = false, medianSet = false, upperQuartileSet = false;
+        for( const std::pair<double, double>& valueAndWeight : m_sortedValuesAndWeights ){
+            cumulative += valueAndWeight.second;
+            if( ! lowerQuartileSet && cumulative >= 0.25 ){ m_lowerQuartile = valueAndWeight.first; lowerQuartileSet = true; }
+            if( ! medianSet && cumulative >= 0.50 ){ m_median = valueAndWeight.first; medianSet = true; }
+            if( ! upperQuartileSet && cumulative >= 0.75 ){ m_upperQuartile = valueAndWeight.first; upperQuartileSet = true; }
+        }
+    }
+
+    updateBins();
+}
+
+void HistogramPlotWidget::setNumberOfBins(int value)
+{
+    m_nBins = std::max( 1, value );
+    updateBins();
+}
+
+void HistogramPlotWidget::setCumulative(bool value)
+{
+    m_cumulative = value;
+    updateBins();
+}
+
+void HistogramPlotWidget::setLogScaleX(bool value)
+{
+    NativePlotWidget::setLogScaleX( value );
+    updateBins();
+}
+
+void HistogramPlotWidget::updateBins()
+{
+    m_frequencies.assign( m_nBins, 0.0 );
+
+    //define the value range of the bins
+    double xMin = m_min;
+    double xMax = m_max;
+    bool useLog = isLogScaleX();
+    if( useLog ){
+        //non-positive values cannot be shown in log scale
+        xMin = std::numeric_limits<double>::max();
+        for( const std::pair<double, double>& valueAndWeight : m_sortedValuesAndWeights )
+            if( valueAndWeight.first > 0.0 ){
+                xMin = valueAndWeight.first;
+                break;
+            }
+        if( xMin > xMax ){
+            useLog = false;
+            xMin = m_min;
+        }
+    }
+    if( useLog ){
+        if( Util::almostEqual2sComplement( xMin, xMax, 1 ) ){
+            xMin /= 10.0;
+            xMax *= 10.0;
+        }
+    } else
+        padWindow( xMin, xMax, 0.0 );
+
+    //compute the frequencies
+    double binMin = useLog ? std::log10( xMin ) : xMin;
+    double binMax = useLog ? std::log10( xMax ) : xMax;
+    double binWidth = ( binMax - binMin ) / m_nBins;
+    for( const std::pair<double, double>& valueAndWeight : m_sortedValuesAndWeights ){
+        if( useLog && valueAndWeight.first <= 0.0 )
+            continue;
+        double value = useLog ? std::log10( valueAndWeight.first ) : valueAndWeight.first;
+        int iBin = static_cast<int>( ( value - binMin ) / binWidth );
+        iBin = std::max( 0, std::min( m_nBins - 1, iBin ) );
+        m_frequencies[iBin] += valueAndWeight.second;
+    }
+    if( m_cumulative )
+        for( int iBin = 1; iBin < m_nBins; ++iBin )
+            m_frequencies[iBin] += m_frequencies[iBin - 1];
+
+    double maxFrequency = m_cumulative ? 1.0 : 0.0;
+    for( double frequency : m_frequencies )
+        maxFrequency = std::max( maxFrequency, frequency );
+    if( maxFrequency <= 0.0 )
+        maxFrequency = 1.0;
+
+    setWindow( xMin, xMax, 0.0, maxFrequency * 1.05 );
+    setYLabel( m_cumulative ? "Cumulative frequency" : "Frequency" );
+    update();
+}
+
+void HistogramPlotWidget::paintPlotArea(QPainter &painter, const QRect &plotArea)
+{
+    bool useLog = isLogScaleX() && m_xMin > 0.0;
+    double binMin = useLog ? std::log10( m_xMin ) : m_xMin;
+    double binMax = useLog ? std::log10( m_xMax ) : m_xMax;
+    double binWidth = ( binMax - binMin ) / m_nBins;
+    painter.setPen( Qt::black );
+    painter.setBrush( QColor( 100, 149, 237 ) );
+    double yZero = toScreenY( 0.0, plotArea );
+    for( int iBin = 0; iBin < m_nBins; ++iBin ){
+        if( m_frequencies[iBin] <= 0.0 )
+            continue;
+        double edge0 = binMin + iBin * binWidth;
+        double edge1 = edge0 + binWidth;
+        if( useLog ){
+            edge0 = std::pow( 10.0, edge0 );
+            edge1 = std::pow( 10.0, edge1 );
+        }
+        double x0 = toScreenX( edge0, plotArea );
+        double x1 = toScreenX( edge1, plotArea );
+        double y = toScreenY( m_frequencies[iBin], plotArea );
+        painter.drawRect( QRectF( x0, y, x1 - x0, yZero - y ) );
+    }
+}
+
+void HistogramPlotWidget::paintSideArea(QPainter &painter, const QRect &sideArea)
+{
+    QStringList lines;
+    lines << "Number of data " + QString::number( m_sortedValuesAndWeights.size() )
+          << "mean " + QString::number( m_mean, 'g', 5 )
+          << "std. dev. " + QString::number( m_stdDev, 'g', 5 )
+          << "coef. of var. " + ( m_mean != 0.0 ? QString::number( m_stdDev / m_mean, 'g', 4 ) : QString( "undefined" ) )
+          << ""
+          << "maximum " + QString::number( m_max, 'g', 5 )
+          << "upper quartile " + QString::number( m_upperQuartile, 'g', 5 )
+          << "median " + QString::number( m_median, 'g', 5 )
+          << "lower quartile " + QString::number( m_lowerQuartile, 'g', 5 )
+          << "minimum " + QString::number( m_min, 'g', 5 );
+    painter.setPen( Qt::black );
+    int lineHeight = painter.fontMetrics().height();
+    for( int iLine = 0; iLine < lines.size(); ++iLine )
+        painter.drawText( sideArea.left(), sideArea.top() + ( iLine + 1 ) * lineHeight, lines[iLine] );
+}
+
+/////////////////////////////////////////////  ScatterPlotWidget  //////////////////////////////////////////////////
+
+ScatterPlotWidget::ScatterPlotWidget(QWidget *parent) : NativePlotWidget( parent ),
+    m_zMin( 0.0 ), m_zMax( 1.0 ),
+    m_correlation( 0.0 ),
+    m_maxPointsToDraw( 20000 ),
+    m_drewDensity( false ),
+    m_maxDensity( 0 )
+{
+    setRightMarginWidth( 130 );
+}
+
+void ScatterPlotWidget::setData(const std::vector<double> &xs, const std::vector<double> &ys, const std::vector<double> &zs)
+{
+    m_xs = xs;
+    m_ys = ys;
+    m_zs = zs;
+
+    double xMin, xMax, yMin, yMax;
+    getMinMax( m_xs, xMin, xMax );
+    getMinMax( m_ys, yMin, yMax );
+    getMinMax( m_zs, m_zMin, m_zMax );
+    padWindow( xMin, xMax, 0.02 );
+    padWindow( yMin, yMax, 0.02 );
+    setWindow( xMin, xMax, yMin, yMax );
+
+    //Pearson's correlation coefficient
+    size_t n = std::min( m_xs.size(), m_ys.size() );
+    double meanX = 0.0, meanY = 0.0;
+    for( size_t i = 0; i < n; ++i ){
+        meanX += m_xs[i];
+        meanY += m_ys[i];
+    }
+    if( n > 0 ){
+        meanX /= n;
+        meanY /= n;
+    }
+    double covXY = 0.0, varX = 0.0, varY = 0.0;
+    for( size_t i = 0; i < n; ++i ){
+        covXY += ( m_xs[i] - meanX ) * ( m_ys[i] - meanY );
+        varX  += ( m_xs[i] - meanX ) * ( m_xs[i] - meanX );
+        varY  += ( m_ys[i] - meanY ) * ( m_ys[i] - meanY );
+    }
+    m_correlation = ( varX > 0.0 && varY > 0.0 ) ? covXY / std::sqrt( varX * varY ) : 0.0;
+
+    update();
+}
+
+void ScatterPlotWidget::paintPlotArea(QPainter &painter, const QRect &plotArea)
+{
+    size_t n = std::min( m_xs.size(), m_ys.size() );
+    bool hasZ = m_zs.size() >= n && n > 0;
+    m_drewDensity = n > m_maxPointsToDraw;
+
+    if( ! m_drewDensity ){
+        //draw each point
+        painter.setRenderHint( QPainter::Antialiasing );
+        painter.setPen( Qt::NoPen );
+        painter.setBrush( Qt::black );
+        for( size_t i = 0; i < n; ++i ){
+            if( hasZ )
+                painter.setBrush( QColor( getRainbowColor( ( m_zs[i] - m_zMin ) / ( m_zMax - m_zMin ) ) ) );
+            painter.drawEllipse( QPointF( toScreenX( m_xs[i], plotArea ), toScreenY( m_ys[i], plotArea ) ), 2.5, 2.5 );
+        }
+        return;
+    }
+
+    //bin the points in small screen cells and color each cell by the number of points in it.
+    const int cellSize = 3;
+    int nCellsX = plotArea.width() / cellSize + 1;
+    int nCellsY = plotArea.height() / cellSize + 1;
+    std::vector<uint> counts( nCellsX * nCellsY, 0 );
+    for( size_t i = 0; i < n; ++i ){
+        int cellX = static_cast<int>( ( toScreenX( m_xs[i], plotArea ) - plotArea.left() ) / cellSize );
+        int cellY = static_cast<int>( ( toScreenY( m_ys[i], plotArea ) - plotArea.top() ) / cellSize );
+        if( cellX >= 0 && cellX < nCellsX && cellY >= 0 && cellY < nCellsY )
+            ++counts[ cellY * nCellsX + cellX ];
+    }
+    m_maxDensity = *std::max_element( counts.begin(), counts.end() );
+    double logMaxDensity = std::log( 1.0 + m_maxDensity );
+    QImage densityImage( nCellsX, nCellsY, QImage::Format_ARGB32 );
+    densityImage.fill( Qt::transparent );
+    for( int cellY = 0; cellY < nCellsY; ++cellY ){
+        QRgb* scanLine = reinterpret_cast<QRgb*>( densityImage.scanLine( cellY ) );
+        for( int cellX = 0; cellX < nCellsX; ++cellX ){
+            uint count = counts[ cellY * nCellsX + cellX ];
+            if( count > 0 )
+                scanLine[cellX] = getRainbowColor( std::log( 1.0 + count ) / logMaxDensity );
+        }
+    }
+    painter.drawImage( QRectF( plotArea.left(), plotArea.top(), nCellsX * cellSize, nCellsY * cellSize ), densityImage );
+}
+
+void ScatterPlotWidget::paintSideArea(QPainter &painter, const QRect &sideArea)
+{
+    size_t n = std::min( m_xs.size(), m_ys.size() );
+    int lineHeight = painter.fontMetrics().height();
+    painter.setPen( Qt::black );
+    painter.drawText( sideArea.left(), sideArea.top() + lineHeight,     "Number of data " + QString::number( n ) );
+    painter.drawText( sideArea.left(), sideArea.top() + 2 * lineHeight, "correlation " + QString::number( m_correlation, 'f', 3 ) );
+    QRect scaleArea = sideArea.adjusted( 0, 4 * lineHeight, 0, 0 );
+    if( m_drewDensity )
+        paintColorScale( painter, scaleArea, 0.0, std::log10( 1.0 + m_maxDensity ), "log10(count)" );
+    else if( m_zs.size() >= n && n > 0 )
+        paintColorScale( painter, scaleArea, m_zMin, m_zMax, "Z" );
+}
+
+/////////////////////////////////////////////  LocationMapWidget  //////////////////////////////////////////////////
+
+LocationMapWidget::LocationMapWidget(QWidget *parent) : NativePlotWidget( parent ),
+    m_colorMin( 0.0 ), m_colorMax( 1.0 ),
+    m_maxPointsToDraw( 20000 )
+{
+    setRightMarginWidth( 110 );
+    setKeepAspectRatio( true );
+    setXLabel( "X" );
+    setYLabel( "Y" );
+}
+
+void LocationMapWidget::setData(const std::vector<double> &xs, const std::vector<double> &ys, const std::vector<double> &values)
+{
+    m_xs = xs;
+    m_ys = ys;
+    m_values = values;
+
+    double xMin, xMax, yMin, yMax;
+    getMinMax( m_xs, xMin, xMax );
+    getMinMax( m_ys, yMin, yMax );
+    getMinMax( m_values, m_colorMin, m_colorMax );
+    padWindow( xMin, xMax, 0.02 );
+    padWindow( yMin, yMax, 0.02 );
+    setWindow( xMin, xMax, yMin, yMax );
+
+    update();
+}
+
+void LocationMapWidget::paintPlotArea(QPainter &painter, const QRect &plotArea)
+{
+    size_t n = std::min( std::min( m_xs.size(), m_ys.size() ), m_values.size() );
+    double colorRange = m_colorMax - m_colorMin;
+    if( colorRange == 0.0 )
+        colorRange = 1.0;
+
+    if( n <= m_maxPointsToDraw ){
+        //draw each point as a colored circle
+        painter.setRenderHint( QPainter::Antialiasing );
+        painter.setPen( QPen( Qt::black, 0.5 ) );
+        for( size_t i = 0; i < n; ++i ){
+            painter.setBrush( QColor( getRainbowColor( ( m_values[i] - m_colorMin ) / colorRange ) ) );
+            painter.drawEllipse( QPointF( toScreenX( m_xs[i], plotArea ), toScreenY( m_ys[i], plotArea ) ), 3.5, 3.5 );
+        }
+        return;
+    }
+
+    //aggregate the points in small screen cells and color each cell by the mean of its points.
+    const int cellSize = 3;
+    int nCellsX = plotArea.width() / cellSize + 1;
+    int nCellsY = plotArea.height() / cellSize + 1;
+    std::vector<double> sums( nCellsX * nCellsY, 0.0 );
+    std::vector<uint> counts( nCellsX * nCellsY, 0 );
+    for( size_t i = 0; i < n; ++i ){
+        int cellX = static_cast<int>( ( toScreenX( m_xs[i], plotArea ) - plotArea.left() ) / cellSize );
+        int cellY = static_cast<int>( ( toScreenY( m_ys[i], plotArea ) - plotArea.top() ) / cellSize );
+        if( cellX >= 0 && cellX < nCellsX && cellY >= 0 && cellY < nCellsY ){
+            sums[ cellY * nCellsX + cellX ] += m_values[i];
+            ++counts[ cellY * nCellsX + cellX ];
+        }
+    }
+    QImage meanImage( nCellsX, nCellsY, QImage::Format_ARGB32 );
+    meanImage.fill( Qt::transparent );
+    for( int cellY = 0; cellY < nCellsY; ++cellY ){
+        QRgb* scanLine = reinterpret_cast<QRgb*>( meanImage.scanLine( cellY ) );
+        for( int cellX = 0; cellX < nCellsX; ++cellX ){
+            uint count = counts[ cellY * nCellsX + cellX ];
+            if( count > 0 )
+                scanLine[cellX] = getRainbowColor( ( sums[ cellY * nCellsX + cellX ] / count - m_colorMin ) / colorRange );
+        }
+    }
+    painter.drawImage( QRectF( plotArea.left(), plotArea.top(), nCellsX * cellSize, nCellsY * cellSize ), meanImage );
+}
+
+void LocationMapWidget::paintSideArea(QPainter &painter, const QRect &sideArea)
+{
+    paintColorScale( painter, sideArea, m_colorMin, m_colorMax, "Value" );
+}
+
+/////////////////////////////////////////////  PixelPlotWidget  ////////////////////////////////////////////////////
+
+PixelPlotWidget::PixelPlotWidget(QWidget *parent) : NativePlotWidget( parent ),
+    m_nI( 0 ), m_nJ( 0 ), m_nK( 0 ),
+    m_x0( 0.0 ), m_y0( 0.0 ), m_dx( 1.0 ), m_dy( 1.0 ),
+    m_slice( 0 ),
+    m_colorMin( 0.0 ), m_colorMax( 1.0 )
+{
+    setRightMarginWidth( 110 );
+    setKeepAspectRatio( true );
+    setXLabel( "X" );
+    setYLabel( "Y" );
+}
+
+void PixelPlotWidget::setData(uint nI, uint nJ, uint nK, double x0, double y0, double dx, double dy, const std::vector<double> &values)
+{
+    m_nI = nI;
+    m_nJ = nJ;
+    m_nK = nK;
+    m_x0 = x0;
+    m_y0 = y0;
+    m_dx = dx;
+    m_dy = dy;
+    m_values = values;
+    m_slice = 0;
+
+    //the color scale covers all the valued cells
+    m_colorMin = std::numeric_limits<double>::max();
+    m_colorMax = -std::numeric_limits<double>::max();
+    for( double value : m_values )
+        if( ! std::isnan( value ) ){
+            m_colorMin = std::min( m_colorMin, value );
+            m_colorMax = std::max( m_colorMax, value );
+        }
+    if( m_colorMin > m_colorMax ){
+        m_colorMin = 0.0;
+        m_colorMax = 1.0;
+    }
+
+    //the grid coordinates are those of the cell centers
+    setWindow( m_x0 - m_dx / 2.0, m_x0 + ( m_nI - 0.5 ) * m_dx,
+               m_y0 - m_dy / 2.0, m_y0 + ( m_nJ - 0.5 ) * m_dy );
+
+    updateSliceImage();
+}
+
+void PixelPlotWidget::setCategories(const std::map<int, QColor> &categoryColors, const std::map<int, QString> &categoryNames)
+{
+    m_categoryColors = categoryColors;
+    m_categoryNames = categoryNames;
+    updateSliceImage();
+}
+
+void PixelPlotWidget::setSlice(uint k)
+{
+    m_slice = std::min( k, m_nK > 0 ? m_nK - 1 : 0 );
+    updateSliceImage();
+}
+
+void PixelPlotWidget::setColorScaleRange(double min, double max)
+{
+    m_colorMin = min;
+    m_colorMax = max;
+    updateSliceImage();
+}
+
+void PixelPlotWidget::updateSliceImage()
+{
+    if( m_nI == 0 || m_nJ == 0 || m_values.size() < static_cast<size_t>( m_nI ) * m_nJ * ( m_slice + 1 ) ){
+        m_sliceImage = QImage();
+        update();
+        return;
+    }
+    double colorRange = m_colorMax - m_colorMin;
+    if( colorRange == 0.0 )
+        colorRange = 1.0;
+    m_sliceImage = QImage( m_nI, m_nJ, QImage::Format_ARGB32 );
+    m_sliceImage.fill( Qt::transparent );
+    const double* sliceValues = m_values.data() + static_cast<size_t>( m_slice ) * m_nI * m_nJ;
+    for( uint j = 0; j < m_nJ; ++j ){
+        //image rows go from top to bottom, whereas grid rows go from south to north.
+        QRgb* scanLine = reinterpret_cast<QRgb*>( m_sliceImage.scanLine( m_nJ - 1 - j ) );
+        for( uint i = 0; i < m_nI; ++i ){
+            double value = sliceValues[ j * m_nI + i ];
+            if( std::isnan( value ) )
+                continue;
+            if( m_categoryColors.empty() )
+                scanLine[i] = getRainbowColor( ( value - m_colorMin ) / colorRange );
+            else {
+                std::map<int, QColor>::const_iterator it = m_categoryColors.find( static_cast<int>( value ) );
+                if( it != m_categoryColors.end() )
+                    scanLine[i] = it->second.rgb();
+            }
+        }
+    }
+    update();
+}
+
+void PixelPlotWidget::paintPlotArea(QPainter &painter, const QRect &plotArea)
+{
+    if( m_sliceImage.isNull() )
+        return;
+    //cells are drawn as crisp rectangles (no smoothing)
+    painter.setRenderHint( QPainter::SmoothPixmapTransform, false );
+    QRectF target( QPointF( toScreenX( m_xMin, plotArea ), toScreenY( m_yMax, plotArea ) ),
+                   QPointF( toScreenX( m_xMax, plotArea ), toScreenY( m_yMin, plotArea ) ) );
+    painter.drawImage( target, m_sliceImage );
+}
+
+void PixelPlotWidget::paintSideArea(QPainter &painter, const QRect &sideArea)
+{
+    if( m_categoryColors.empty() ){
+        paintColorScale( painter, sideArea, m_colorMin, m_colorMax, "Value" );
+        return;
+    }
+    //categorical legend
+    int lineHeight = painter.fontMetrics().height() + 4;
+    int iLine = 0;
+    for( const std::pair<const int, QColor>& codeAndColor : m_categoryColors ){
+        int y = sideArea.top() + iLine * lineHeight;
+        painter.setPen( Qt::black );
+        painter.setBrush( codeAndColor.second );
+        painter.drawRect( sideArea.left(), y, 14, lineHeight - 4 );
+        QString name = QString::number( codeAndColor.first );
+        std::map<int, QString>::const_iterator it = m_categoryNames.find( codeAndColor.first );
+        if( it != m_categoryNames.end() )
+            name = it->second;
+        painter.drawText( sideArea.left() + 20, y + painter.fontMetrics().ascent(), name );
+        ++iLine;
+    }
+}
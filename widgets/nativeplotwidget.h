@@ -0,0 +1,249 @@
+#ifndef NATIVEPLOTWIDGET_H
+#define NATIVEPLOTWIDGET_H
+
+#include <QWidget>
+#include <QColor>
+#include <QImage>
+#include <vector>
+#include <map>
+
+/**
+ * The NativePlotWidget is the base class of the plot widgets that render the usual GSLib plots (histplt,
+ * scatplt, locmap and pixelplt) directly with QPainter, that is, without running a GSLib program to write
+ * a PostScript file and Ghostscript to rasterize it.  The data are passed once to the widgets, which
+ * then repaint from memory, so changing the plot settings (e.g. number of bins or slice) updates the
+ * plot immediately.
+ *
+ * This base class draws the frame, the axes with their ticks and labels and the title.  The subclasses
+ * draw their contents in paintPlotArea().
+ */
+class NativePlotWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit NativePlotWidget( QWidget *parent = nullptr );
+
+    void setTitle( const QString& title ){ m_title = title; update(); }
+    void setXLabel( const QString& label ){ m_xLabel = label; update(); }
+    void setYLabel( const QString& label ){ m_yLabel = label; update(); }
+
+    /** Sets logarithmic scale for the X axis.  Non-positive values are not plotted in log scale. */
+    virtual void setLogScaleX( bool value );
+    bool isLogScaleX() const { return m_logX; }
+
+    /** Renders the plot to an image of the given size (e.g. to save it to a file). */
+    QImage renderToImage( const QSize& size );
+
+protected:
+    void paintEvent( QPaintEvent *event ) override;
+
+    /** Draws the plot contents inside the area delimited by the axes.  The painter is clipped to the area. */
+    virtual void paintPlotArea( QPainter& painter, const QRect& plotArea ) = 0;
+
+    /** Draws additional elements outside the plot area (e.g. color scales, statistics).
+     * @param sideArea The area at the right side of the plot reserved with setRightMarginWidth(). */
+    virtual void paintSideArea( QPainter& painter, const QRect& sideArea ){ Q_UNUSED(painter); Q_UNUSED(sideArea); }
+
+    /** Sets the data window (the ranges of values shown in the axes). */
+    void setWindow( double xMin, double xMax, double yMin, double yMax );
+
+    /** Sets the width of the area at the right side of the plot (see paintSideArea()). */
+    void setRightMarginWidth( int value ){ m_rightMarginWidth = value; }
+
+    /** Makes the plot area keep the aspect ratio of the data window (e.g. for maps). */
+    void setKeepAspectRatio( bool value ){ m_keepAspectRatio = value; }
+
+    /** Converts a value in data units to screen coordinates. */
+    double toScreenX( double x, const QRect& plotArea ) const;
+    double toScreenY( double y, const QRect& plotArea ) const;
+
+    /** Returns a color from the rainbow color table.  The color table is sampled once, so this is
+     * fast enough to be called for each point or pixel.
+     * @param t The value normalized to [0.0, 1.0] (values outside are clamped). */
+    QRgb getRainbowColor( double t ) const;
+
+    /** Draws a vertical color scale for the given range in the given area. */
+    void paintColorScale( QPainter& painter, const QRect& area, double min, double max, const QString& caption );
+
+    double m_xMin, m_xMax, m_yMin, m_yMax;
+
+private:
+    /** Does the painting of the whole plot to any paint device. */
+    void paint( QPainter& painter, const QRect& area );
+    void paintAxes( QPainter& painter, const QRect& plotArea );
+
+    QString m_title;
+    QString m_xLabel;
+    QString m_yLabel;
+    bool m_logX;
+    bool m_keepAspectRatio;
+    int m_rightMarginWidth;
+    mutable std::vector<QRgb> m_rainbow;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Histogram with summary statistics, similar to the output of GSLib's histplt.
+ */
+class HistogramPlotWidget : public NativePlotWidget
+{
+    Q_OBJECT
+
+public:
+    explicit HistogramPlotWidget( QWidget *parent = nullptr );
+
+    /** Sets the values (no-data values must be already removed).
+     * @param weights Declustering weights for each value.  Pass an empty vector for equal weights.
+     */
+    void setData( const std::vector<double>& values, const std::vector<double>& weights = std::vector<double>() );
+
+    void setNumberOfBins( int value );
+    int getNumberOfBins() const { return m_nBins; }
+
+    /** Shows the cumulative frequencies instead of the frequencies. */
+    void setCumulative( bool value );
+
+    /** The bins are evenly spaced in log scale. */
+    void setLogScaleX( bool value ) override;
+
+protected:
+    void paintPlotArea( QPainter& painter, const QRect& plotArea ) override;
+    void paintSideArea( QPainter& painter, const QRect& sideArea ) override;
+
+private:
+    /** Recomputes the bin frequencies (called when data or settings change). */
+    void updateBins();
+
+    /** The values sorted in ascending order with their weights (normalized to sum 1.0). */
+    std::vector< std::pair<double, double> > m_sortedValuesAndWeights;
+    std::vector<double> m_frequencies;
+    int m_nBins;
+    bool m_cumulative;
+
+    //summary statistics
+    double m_mean, m_stdDev, m_min, m_max, m_lowerQuartile, m_median, m_upperQuartile;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Cross plot of two variables, optionally colored by a third variable, similar to GSLib's scatplt.
+ * Above a given number of points, the points are not drawn individually.  Instead, the plot area
+ * is binned in small screen cells and each cell is colored by the number of points falling in it
+ * (a point density map), which takes the same time for any zoom and is more informative for large
+ * data sets, where individual points would overlap anyway.
+ */
+class ScatterPlotWidget : public NativePlotWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ScatterPlotWidget( QWidget *parent = nullptr );
+
+    /** Sets the values (no-data values must be already removed).
+     * @param zs The values of an optional third variable used to color the points.  Pass an empty vector for none.
+     */
+    void setData( const std::vector<double>& xs, const std::vector<double>& ys,
+                  const std::vector<double>& zs = std::vector<double>() );
+
+    /** Sets the number of points above which the point density map is drawn instead. */
+    void setMaxPointsToDraw( uint value ){ m_maxPointsToDraw = value; update(); }
+    uint getMaxPointsToDraw() const { return m_maxPointsToDraw; }
+
+protected:
+    void paintPlotArea( QPainter& painter, const QRect& plotArea ) override;
+    void paintSideArea( QPainter& painter, const QRect& sideArea ) override;
+
+private:
+    std::vector<double> m_xs, m_ys, m_zs;
+    double m_zMin, m_zMax;
+    double m_correlation;
+    uint m_maxPointsToDraw;
+    /** Set by paintPlotArea() when the density map was drawn, so the side area shows the count scale. */
+    bool m_drewDensity;
+    uint m_maxDensity;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Map of point data colored by value, similar to GSLib's locmap.  Above a given number of points,
+ * the points are aggregated in small screen cells, which are colored by the mean of their points.
+ */
+class LocationMapWidget : public NativePlotWidget
+{
+    Q_OBJECT
+
+public:
+    explicit LocationMapWidget( QWidget *parent = nullptr );
+
+    /** Sets the locations and values (no-data values must be already removed). */
+    void setData( const std::vector<double>& xs, const std::vector<double>& ys, const std::vector<double>& values );
+
+    void setColorScaleRange( double min, double max ){ m_colorMin = min; m_colorMax = max; update(); }
+    double getColorScaleMin() const { return m_colorMin; }
+    double getColorScaleMax() const { return m_colorMax; }
+
+    void setMaxPointsToDraw( uint value ){ m_maxPointsToDraw = value; update(); }
+    uint getMaxPointsToDraw() const { return m_maxPointsToDraw; }
+
+protected:
+    void paintPlotArea( QPainter& painter, const QRect& plotArea ) override;
+    void paintSideArea( QPainter& painter, const QRect& sideArea ) override;
+
+private:
+    std::vector<double> m_xs, m_ys, m_values;
+    double m_colorMin, m_colorMax;
+    uint m_maxPointsToDraw;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Map of a horizontal slice of a regular grid, similar to GSLib's pixelplt.  The slice is
+ * rasterized to an image with one pixel per grid cell, which is then scaled to the plot area.
+ */
+class PixelPlotWidget : public NativePlotWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PixelPlotWidget( QWidget *parent = nullptr );
+
+    /** Sets the grid geometry and values.  Cell values must be ordered as in GSLib grids (i fastest, k slowest).
+     * Unvalued cells (e.g. no-data values) must be set to NaN.
+     */
+    void setData( uint nI, uint nJ, uint nK, double x0, double y0, double dx, double dy, const std::vector<double>& values );
+
+    /** Makes the plot categorical, with the given colors and names per category code. */
+    void setCategories( const std::map<int, QColor>& categoryColors, const std::map<int, QString>& categoryNames );
+
+    void setSlice( uint k );
+    uint getSlice() const { return m_slice; }
+    uint getNK() const { return m_nK; }
+
+    void setColorScaleRange( double min, double max );
+    double getColorScaleMin() const { return m_colorMin; }
+    double getColorScaleMax() const { return m_colorMax; }
+
+protected:
+    void paintPlotArea( QPainter& painter, const QRect& plotArea ) override;
+    void paintSideArea( QPainter& painter, const QRect& sideArea ) override;
+
+private:
+    /** Rasterizes the current slice to m_sliceImage. */
+    void updateSliceImage();
+
+    uint m_nI, m_nJ, m_nK;
+    double m_x0, m_y0, m_dx, m_dy;
+    std::vector<double> m_values;
+    std::map<int, QColor> m_categoryColors;
+    std::map<int, QString> m_categoryNames;
+    uint m_slice;
+    double m_colorMin, m_colorMax;
+    QImage m_sliceImage;
+};
+
+#endif // NATIVEPLOTWIDGET_H